@@ -10,12 +10,24 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/bitmap.h>
 #include <linux/device.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include "internal.h"
 
+/*
+ * dirty has a bit per register written through the cache, which may thus
+ * differ from its reset default; only those are synced.  block holds the
+ * values in the device format for the sync, which runs under the map lock.
+ */
+struct regcache_flat_data {
+	unsigned long *dirty;
+	void *block;
+	unsigned int data[];
+};
+
 static inline unsigned int regcache_flat_get_index(const struct regmap *map,
 						   unsigned int reg)
 {
@@ -25,28 +37,47 @@ static inline unsigned int regcache_flat_get_index(const struct regmap *map,
 static int regcache_flat_init(struct regmap *map)
 {
 	int i;
-	unsigned int *cache;
+	unsigned int n;
+	struct regcache_flat_data *cache;
 
 	if (!map || map->reg_stride_order < 0 || !map->max_register)
 		return -EINVAL;
 
-	map->cache = kcalloc(regcache_flat_get_index(map, map->max_register)
-			     + 1, sizeof(unsigned int), GFP_KERNEL);
-	if (!map->cache)
+	n = regcache_flat_get_index(map, map->max_register) + 1;
+
+	cache = kzalloc(sizeof(*cache) + n * sizeof(unsigned int), GFP_KERNEL);
+	if (!cache)
 		return -ENOMEM;
 
-	cache = map->cache;
+	cache->dirty = kcalloc(BITS_TO_LONGS(n), sizeof(unsigned long),
+			       GFP_KERNEL);
+	cache->block = kcalloc(n, map->cache_word_size, GFP_KERNEL);
+	if (!cache->dirty || !cache->block) {
+		kfree(cache->block);
+		kfree(cache->dirty);
+		kfree(cache);
+		return -ENOMEM;
+	}
 
 	for (i = 0; i < map->num_reg_defaults; i++)
-		cache[regcache_flat_get_index(map, map->reg_defaults[i].reg)] =
+		cache->data[regcache_flat_get_index(map,
+				map->reg_defaults[i].reg)] =
 				map->reg_defaults[i].def;
 
+	map->cache = cache;
+
 	return 0;
 }
 
 static int regcache_flat_exit(struct regmap *map)
 {
-	kfree(map->cache);
+	struct regcache_flat_data *cache = map->cache;
+
+	if (cache) {
+		kfree(cache->block);
+		kfree(cache->dirty);
+	}
+	kfree(cache);
 	map->cache = NULL;
 
 	return 0;
@@ -55,9 +86,9 @@ static int regcache_flat_exit(struct regmap *map)
 static int regcache_flat_read(struct regmap *map,
 			      unsigned int reg, unsigned int *value)
 {
-	unsigned int *cache = map->cache;
+	struct regcache_flat_data *cache = map->cache;
 
-	*value = cache[regcache_flat_get_index(map, reg)];
+	*value = cache->data[regcache_flat_get_index(map, reg)];
 
 	return 0;
 }
@@ -65,13 +96,36 @@ static int regcache_flat_read(struct regmap *map,
 static int regcache_flat_write(struct regmap *map, unsigned int reg,
 			       unsigned int value)
 {
-	unsigned int *cache = map->cache;
+	struct regcache_flat_data *cache = map->cache;
+	unsigned int index = regcache_flat_get_index(map, reg);
 
-	cache[regcache_flat_get_index(map, reg)] = value;
+	cache->data[index] = value;
+	__set_bit(index, cache->dirty);
 
 	return 0;
 }
 
+/*
+ * Write back the dirty registers, with one bulk write per run of adjacent
+ * ones when the bus can do raw writes.
+ */
+static int regcache_flat_sync(struct regmap *map, unsigned int min,
+			      unsigned int max)
+{
+	struct regcache_flat_data *cache = map->cache;
+	unsigned int start = regcache_flat_get_index(map, min);
+	unsigned int end = regcache_flat_get_index(map, max) + 1;
+	unsigned int i;
+
+	/* regcache_sync_block() wants the values in the device format */
+	i = start;
+	for_each_set_bit_from(i, cache->dirty, end)
+		regcache_set_val(map, cache->block, i, cache->data[i]);
+
+	return regcache_sync_block(map, cache->block, cache->dirty, 0,
+				   start, end);
+}
+
 struct regcache_ops regcache_flat_ops = {
 	.type = REGCACHE_FLAT,
 	.name = "flat",
@@ -79,4 +133,5 @@ struct regcache_ops regcache_flat_ops = {
 	.exit = regcache_flat_exit,
 	.read = regcache_flat_read,
 	.write = regcache_flat_write,
+	.sync = regcache_flat_sync,
 };
@@ -438,6 +438,12 @@ struct snd_ac97_build_ops {
 	void (*update_jacks) (struct snd_ac97 *ac97);	/* for jack-sharing */
 };
 
+/* a register write of a sequence */
+struct snd_ac97_reg_seq {
+	unsigned short reg;
+	unsigned short val;
+};
+
 struct snd_ac97_bus_ops {
 	void (*reset) (struct snd_ac97 *ac97);
 	void (*warm_reset)(struct snd_ac97 *ac97);
@@ -445,6 +451,11 @@ struct snd_ac97_bus_ops {
 	unsigned short (*read) (struct snd_ac97 *ac97, unsigned short reg);
 	void (*wait) (struct snd_ac97 *ac97);
 	void (*init) (struct snd_ac97 *ac97);
+	/* optional: write the registers in order, waiting for the codec
+	 * once per sequence rather than once per write
+	 */
+	void (*write_seq) (struct snd_ac97 *ac97,
+			   const struct snd_ac97_reg_seq *seq, unsigned int count);
 };
 
 struct snd_ac97_bus {
@@ -510,6 +521,7 @@ struct snd_ac97 {
 	unsigned int spdif_status;
 	unsigned short regs[0x80]; /* register cache */
 	DECLARE_BITMAP(reg_accessed, 0x80); /* bit flags */
+	DECLARE_BITMAP(reg_read_cached, 0x80); /* cached from a read only */
 	union {			/* vendor specific code */
 		struct {
 			unsigned short unchained[3];	// 0 = C34, 1 = C79, 2 = C69
@@ -572,6 +584,9 @@ const char *snd_ac97_get_short_name(struct snd_ac97 *ac97);
 void snd_ac97_write(struct snd_ac97 *ac97, unsigned short reg, unsigned short value);
 unsigned short snd_ac97_read(struct snd_ac97 *ac97, unsigned short reg);
 void snd_ac97_write_cache(struct snd_ac97 *ac97, unsigned short reg, unsigned short value);
+void snd_ac97_write_cache_seq(struct snd_ac97 *ac97,
+			      const struct snd_ac97_reg_seq *seq,
+			      unsigned int count);
 int snd_ac97_update(struct snd_ac97 *ac97, unsigned short reg, unsigned short value);
 int snd_ac97_update_bits(struct snd_ac97 *ac97, unsigned short reg, unsigned short mask, unsigned short value);
 #ifdef CONFIG_SND_AC97_POWER_SAVE
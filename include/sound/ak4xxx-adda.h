@@ -83,6 +83,9 @@ struct snd_akm4xxx {
 
 void snd_akm4xxx_write(struct snd_akm4xxx *ak, int chip, unsigned char reg,
 		       unsigned char val);
+void snd_akm4xxx_write_regs(struct snd_akm4xxx *ak, int chip,
+			    unsigned char reg, const unsigned char *vals,
+			    int count);
 void snd_akm4xxx_reset(struct snd_akm4xxx *ak, int state);
 void snd_akm4xxx_init(struct snd_akm4xxx *ak);
 int snd_akm4xxx_build_controls(struct snd_akm4xxx *ak);
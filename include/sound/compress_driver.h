@@ -46,6 +46,7 @@ struct snd_compr_ops;
  * @total_bytes_available: cumulative number of bytes made available in
  *	the ring buffer
  * @total_bytes_transferred: cumulative bytes transferred by offload DSP
+ * @status: status page mapped by the application, if any
  * @sleep: poll sleep
  * @private_data: driver private data pointer
  */
@@ -58,6 +59,7 @@ struct snd_compr_runtime {
 	u32 fragments;
 	u64 total_bytes_available;
 	u64 total_bytes_transferred;
+	struct snd_compr_mmap_status *status;
 	wait_queue_head_t sleep;
 	void *private_data;
 };
@@ -69,9 +71,11 @@ struct snd_compr_runtime {
  * @runtime: pointer to runtime structure
  * @device: device pointer
  * @error_work: delayed work used when closing the stream due to an error
+ * @status_work: refreshes the mapped status page after fragment completion
  * @direction: stream direction, playback/recording
  * @metadata_set: metadata set flag, true when set
  * @next_track: has userspace signal next track transition, true when set
+ * @partial_drain: undergoing partial_drain for stream, true when set
  * @private_data: pointer to DSP private data
  */
 struct snd_compr_stream {
@@ -80,9 +84,11 @@ struct snd_compr_stream {
 	struct snd_compr_runtime *runtime;
 	struct snd_compr *device;
 	struct delayed_work error_work;
+	struct work_struct status_work;
 	enum snd_compr_direction direction;
 	bool metadata_set;
 	bool next_track;
+	bool partial_drain;
 	void *private_data;
 };
 
@@ -103,7 +109,9 @@ struct snd_compr_stream {
  * @pointer: Retrieve current h/w pointer information. Mandatory
  * @copy: Copy the compressed data to/from userspace, Optional
  * Can't be implemented if DSP supports mmap
- * @mmap: DSP mmap method to mmap DSP memory
+ * @mmap: DSP mmap method to mmap DSP memory, Optional
+ * The application then moves its pointer with SNDRV_COMPRESS_ACK, which is
+ * passed on to @ack
  * @ack: Ack for DSP when data is written to audio buffer, Optional
  * Not valid if copy is implemented
  * @get_caps: Retrieve DSP capabilities, mandatory
@@ -178,6 +186,8 @@ int snd_compress_new(struct snd_card *card, int device,
  */
 static inline void snd_compr_fragment_elapsed(struct snd_compr_stream *stream)
 {
+	if (stream->runtime->status)
+		schedule_work(&stream->status_work);
 	wake_up(&stream->runtime->sleep);
 }
 
@@ -186,7 +196,15 @@ static inline void snd_compr_drain_notify(struct snd_compr_stream *stream)
 	if (snd_BUG_ON(!stream))
 		return;
 
-	stream->runtime->state = SNDRV_PCM_STATE_SETUP;
+	/* a partial drain ends with the next track playing */
+	if (stream->partial_drain) {
+		stream->runtime->state = SNDRV_PCM_STATE_RUNNING;
+		stream->partial_drain = false;
+	} else {
+		stream->runtime->state = SNDRV_PCM_STATE_SETUP;
+	}
+	if (stream->runtime->status)
+		schedule_work(&stream->status_work);
 	wake_up(&stream->runtime->sleep);
 }
 
@@ -23,10 +23,20 @@
  */
 
 #include <linux/wait.h>
+#include <linux/hashtable.h>
+#include <linux/timer.h>
+#include <linux/spinlock.h>
 #include <sound/asound.h>
 
 #define snd_kcontrol_chip(kcontrol) ((kcontrol)->private_data)
 
+/*
+ * kernel-only access bit: the values read via the get callback are cached
+ * by the core until the next put or snd_ctl_invalidate_cache() call;
+ * ignored for volatile controls
+ */
+#define SNDRV_CTL_ELEM_ACCESS_CACHED	(1<<27)
+
 struct snd_kcontrol;
 typedef int (snd_kcontrol_info_t) (struct snd_kcontrol * kcontrol, struct snd_ctl_elem_info * uinfo);
 typedef int (snd_kcontrol_get_t) (struct snd_kcontrol * kcontrol, struct snd_ctl_elem_value * ucontrol);
@@ -63,10 +73,13 @@ struct snd_kcontrol_new {
 struct snd_kcontrol_volatile {
 	struct snd_ctl_file *owner;	/* locked */
 	unsigned int access;	/* access rights */
+	void *cache;		/* cached value, for ACCESS_CACHED */
+	unsigned int cache_gen;	/* cache is valid if equal to kctl's */
 };
 
 struct snd_kcontrol {
 	struct list_head list;		/* list of controls */
+	struct hlist_node hnode;	/* card->ctl_hash entry */
 	struct snd_ctl_elem_id id;
 	unsigned int count;		/* count of same elements */
 	snd_kcontrol_info_t *info;
@@ -79,6 +92,8 @@ struct snd_kcontrol {
 	unsigned long private_value;
 	void *private_data;
 	void (*private_free)(struct snd_kcontrol *kcontrol);
+	spinlock_t cache_lock;		/* protects the cached values */
+	unsigned int cache_gen;		/* bumped at each invalidation */
 	struct snd_kcontrol_volatile vd[0];	/* volatile data */
 };
 
@@ -86,6 +101,7 @@ struct snd_kcontrol {
 
 struct snd_kctl_event {
 	struct list_head list;	/* list of events */
+	struct hlist_node hnode;	/* snd_ctl_file.events_hash entry */
 	struct snd_ctl_elem_id id;
 	unsigned int mask;
 };
@@ -110,6 +126,10 @@ struct snd_ctl_file {
 	struct fasync_struct *fasync;
 	int subscribed;			/* read interface is activated */
 	struct list_head events;	/* waiting events for read */
+	DECLARE_HASHTABLE(events_hash, 5);	/* waiting events by numid */
+	unsigned long event_window;	/* wakeup deferral in jiffies */
+	bool events_ready;		/* readers were woken for the events */
+	struct timer_list event_timer;	/* ends the wakeup deferral */
 };
 
 #define snd_ctl_file(n) list_entry(n, struct snd_ctl_file, list)
@@ -127,8 +147,10 @@ int snd_ctl_remove(struct snd_card * card, struct snd_kcontrol * kcontrol);
 int snd_ctl_replace(struct snd_card *card, struct snd_kcontrol *kcontrol, bool add_on_replace);
 int snd_ctl_remove_id(struct snd_card * card, struct snd_ctl_elem_id *id);
 int snd_ctl_rename_id(struct snd_card * card, struct snd_ctl_elem_id *src_id, struct snd_ctl_elem_id *dst_id);
+void snd_ctl_rename(struct snd_card *card, struct snd_kcontrol *kctl, const char *name);
 int snd_ctl_activate_id(struct snd_card *card, struct snd_ctl_elem_id *id,
 			int active);
+void snd_ctl_invalidate_cache(struct snd_kcontrol *kcontrol);
 struct snd_kcontrol *snd_ctl_find_numid(struct snd_card * card, unsigned int numid);
 struct snd_kcontrol *snd_ctl_find_id(struct snd_card * card, struct snd_ctl_elem_id *id);
 
@@ -246,6 +268,9 @@ snd_ctl_add_slave_uncached(struct snd_kcontrol *master,
 int snd_ctl_add_vmaster_hook(struct snd_kcontrol *kctl,
 			     void (*hook)(void *private_data, int),
 			     void *private_data);
+int snd_ctl_add_vmaster_batch(struct snd_kcontrol *kctl,
+			      void (*batch)(void *private_data, bool begin),
+			      void *private_data);
 void snd_ctl_sync_vmaster(struct snd_kcontrol *kctl, bool hook_only);
 #define snd_ctl_sync_vmaster_hook(kctl)	snd_ctl_sync_vmaster(kctl, true)
 int snd_ctl_apply_vmaster_slaves(struct snd_kcontrol *kctl,
@@ -29,6 +29,10 @@
 #include <linux/pm.h>			/* pm_message_t */
 #include <linux/stringify.h>
 #include <linux/printk.h>
+#include <linux/hashtable.h>
+#include <linux/radix-tree.h>
+#include <linux/workqueue.h>
+#include <linux/cpumask.h>
 
 /* number of supported soundcards */
 #ifdef CONFIG_SND_DYNAMIC_MINORS
@@ -39,6 +43,9 @@
 
 #define CONFIG_SND_MAJOR	116	/* standard configuration */
 
+/* SCHED_FIFO priority of the sound RT threads */
+#define SNDRV_RT_PRIO		(MAX_USER_RT_PRIO / 2)
+
 /* forward declarations */
 struct pci_dev;
 struct module;
@@ -89,6 +96,17 @@ struct snd_device {
 
 #define snd_device(n) list_entry(n, struct snd_device, list)
 
+/* size of the control lookup table, see snd_ctl_find_id() */
+#define SND_CTL_HASH_BITS	8
+
+/* a part of the card setup run in parallel, see snd_card_async_schedule() */
+struct snd_card_work {
+	struct work_struct work;
+	struct snd_card *card;
+	void (*func)(struct snd_card_work *cwork);
+	unsigned int seq;
+};
+
 /* main structure for soundcard */
 
 struct snd_card {
@@ -116,7 +134,11 @@ struct snd_card {
 	rwlock_t ctl_files_rwlock;	/* ctl_files list lock */
 	int controls_count;		/* count of all controls */
 	int user_ctl_count;		/* count of all user controls */
+	atomic_t ctl_serial;		/* bumped at each control notification */
 	struct list_head controls;	/* all controls for this card */
+	DECLARE_HASHTABLE(ctl_hash, SND_CTL_HASH_BITS); /* controls by id */
+	struct radix_tree_root ctl_numids;	/* controls by numid */
+	bool ctl_numids_incomplete;	/* ctl_numids unusable, walk the list */
 	struct list_head ctl_files;	/* active control files */
 
 	struct snd_info_entry *proc_root;	/* root for soundcard specific files */
@@ -134,6 +156,17 @@ struct snd_card {
 	const struct attribute_group *dev_groups[4]; /* assigned sysfs attr */
 	bool registered;		/* card_dev is registered? */
 
+	/* parallel setup, see snd_card_async_schedule() */
+	unsigned int async_scheduled;	/* works scheduled so far */
+	unsigned int async_done;	/* works completed, in order */
+	wait_queue_head_t async_wait;
+	struct snd_card_work register_work; /* snd_card_register_async() */
+	int register_err;		/* its error, for the next register */
+
+	/* CPUs for the card's interrupt and deferred work, see "cpus" */
+	cpumask_var_t cpus;		/* empty: no restriction */
+	int irq;			/* IRQ following @cpus, or -1 */
+
 #ifdef CONFIG_PM
 	unsigned int power_state;	/* power state */
 	wait_queue_head_t power_sleep;
@@ -244,9 +277,19 @@ int snd_card_free(struct snd_card *card);
 int snd_card_free_when_closed(struct snd_card *card);
 void snd_card_set_id(struct snd_card *card, const char *id);
 int snd_card_register(struct snd_card *card);
+int snd_card_register_async(struct snd_card *card);
+void snd_card_async_schedule(struct snd_card *card,
+			     struct snd_card_work *cwork,
+			     void (*func)(struct snd_card_work *cwork));
+void snd_card_async_wait_turn(struct snd_card_work *cwork);
+void snd_card_async_synchronize(struct snd_card *card);
 int snd_card_info_init(void);
 int snd_card_add_dev_attr(struct snd_card *card,
 			  const struct attribute_group *group);
+void snd_card_set_irq(struct snd_card *card, int irq);
+int snd_card_cpu(struct snd_card *card);
+void snd_card_bind_task(struct snd_card *card, struct task_struct *task,
+			const struct cpumask *cpus);
 int snd_component_add(struct snd_card *card, const char *component);
 int snd_card_file_add(struct snd_card *card, struct file *file);
 int snd_card_file_remove(struct snd_card *card, struct file *file);
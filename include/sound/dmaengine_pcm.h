@@ -38,6 +38,7 @@ int snd_hwparams_to_dma_slave_config(const struct snd_pcm_substream *substream,
 int snd_dmaengine_pcm_trigger(struct snd_pcm_substream *substream, int cmd);
 snd_pcm_uframes_t snd_dmaengine_pcm_pointer(struct snd_pcm_substream *substream);
 snd_pcm_uframes_t snd_dmaengine_pcm_pointer_no_residue(struct snd_pcm_substream *substream);
+void snd_dmaengine_pcm_use_period_timer(struct snd_pcm_substream *substream);
 
 int snd_dmaengine_pcm_open(struct snd_pcm_substream *substream,
 	struct dma_chan *chan);
@@ -111,6 +112,19 @@ void snd_dmaengine_pcm_set_config_from_dai_data(
  * The PCM streams have custom channel names specified.
  */
 #define SND_DMAENGINE_PCM_FLAG_CUSTOM_CHANNEL_NAME BIT(4)
+/*
+ * Signal periods from a timer and let the DMA run the whole buffer without
+ * interrupts, for controllers with expensive per-period interrupts.  Needs
+ * a channel that reports the residue per burst, ignored otherwise.
+ */
+#define SND_DMAENGINE_PCM_FLAG_PERIOD_TIMER BIT(5)
+/*
+ * Keep the playback buffer in the on-chip RAM ("iram" gen_pool) of the DMA
+ * controller, sized to what the pool has left, so that playback does not
+ * keep the external memory awake.  Falls back to regular memory if there
+ * is no pool.
+ */
+#define SND_DMAENGINE_PCM_FLAG_IRAM BIT(6)
 
 /**
  * struct snd_dmaengine_pcm_config - Configuration data for dmaengine based PCM
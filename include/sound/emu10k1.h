@@ -1629,6 +1629,7 @@ struct snd_emu10k1_fx8010 {
 	struct snd_emu10k1_fx8010_pcm pcm[8];
 	spinlock_t irq_lock;
 	struct snd_emu10k1_fx8010_irq *irq_handlers;
+	unsigned int *code;		/* copy of the microcode memory */
 };
 
 struct snd_emu10k1_midi {
@@ -1797,7 +1798,6 @@ struct snd_emu10k1 {
 	unsigned int *saved_gpr;
 	unsigned int *tram_val_saved;
 	unsigned int *tram_addr_saved;
-	unsigned int *saved_icode;
 	unsigned int *p16v_saved;
 	unsigned int saved_a_iocfg, saved_hcfg;
 	bool suspend;
@@ -1837,6 +1837,7 @@ int snd_emu10k1_done(struct snd_emu10k1 * emu);
 /* I/O functions */
 unsigned int snd_emu10k1_ptr_read(struct snd_emu10k1 * emu, unsigned int reg, unsigned int chn);
 void snd_emu10k1_ptr_write(struct snd_emu10k1 *emu, unsigned int reg, unsigned int chn, unsigned int data);
+void snd_emu10k1_ptr_write_block(struct snd_emu10k1 *emu, unsigned int reg, const unsigned int *data, unsigned int count);
 unsigned int snd_emu10k1_ptr20_read(struct snd_emu10k1 * emu, unsigned int reg, unsigned int chn);
 void snd_emu10k1_ptr20_write(struct snd_emu10k1 *emu, unsigned int reg, unsigned int chn, unsigned int data);
 int snd_emu10k1_spi_write(struct snd_emu10k1 * emu, unsigned int data);
@@ -87,6 +87,19 @@ struct snd_emux_operators {
 /*
  * emuX wavetable
  */
+/* per-state voice lists, in the order of preference for a new note */
+enum {
+	SNDRV_EMUX_VOICE_FREE,		/* off, without hardware channel */
+	SNDRV_EMUX_VOICE_OFF,		/* off, channel still assigned */
+	SNDRV_EMUX_VOICE_RELEASED,	/* released or release pending */
+	SNDRV_EMUX_VOICE_PLAYING,	/* note on */
+	SNDRV_EMUX_VOICE_STANDBY,	/* prepared, to be triggered */
+	SNDRV_EMUX_VOICE_LISTS
+};
+
+/* released/playing voices asked whether they've finished, per list */
+#define SNDRV_EMUX_PROBE_VOICES	4
+
 struct snd_emux {
 
 	struct snd_card *card;	/* assigned card */
@@ -111,6 +124,7 @@ struct snd_emux {
 	struct snd_emux_voice *voices;	/* Voices (EMU 'channel') */
 	int use_time;	/* allocation counter */
 	spinlock_t voice_lock;	/* Lock for voice access */
+	struct list_head voice_list[SNDRV_EMUX_VOICE_LISTS]; /* oldest first */
 	struct mutex register_mutex;
 	int client;		/* For the sequencer client */
 	int ports[SNDRV_EMUX_MAX_PORTS];	/* The ports for this device */
@@ -173,6 +187,7 @@ struct snd_emux_voice {
 #define SNDRV_EMUX_ST_PENDING 	(0x10|SNDRV_EMUX_ST_ON)	/* Note will be released */
 #define SNDRV_EMUX_ST_LOCKED		0x100	/* Not accessible */
 
+	struct list_head list;	/* in emu->voice_list[] by state */
 	unsigned int  time;	/* An allocation time */
 	unsigned char note;	/* Note currently assigned to this voice */
 	unsigned char key;
@@ -238,5 +253,9 @@ int snd_emux_free(struct snd_emux *emu);
 void snd_emux_terminate_all(struct snd_emux *emu);
 void snd_emux_lock_voice(struct snd_emux *emu, int voice);
 void snd_emux_unlock_voice(struct snd_emux *emu, int voice);
+void snd_emux_voice_set_state(struct snd_emux_voice *vp, int state);
+struct snd_emux_voice *
+snd_emux_find_voice(struct snd_emux *emu, int active_only,
+		    int (*finished)(struct snd_emux_voice *vp));
 
 #endif /* __SOUND_EMUX_SYNTH_H */
@@ -14,6 +14,9 @@
 
 int snd_hdac_regmap_init(struct hdac_device *codec);
 void snd_hdac_regmap_exit(struct hdac_device *codec);
+int snd_hdac_regmap_sync(struct hdac_device *codec);
+void snd_hdac_regmap_batch_begin(struct hdac_device *codec);
+int snd_hdac_regmap_batch_end(struct hdac_device *codec);
 int snd_hdac_regmap_add_vendor_verb(struct hdac_device *codec,
 				    unsigned int verb);
 int snd_hdac_regmap_read_raw(struct hdac_device *codec, unsigned int reg,
@@ -70,6 +70,8 @@ struct hdac_device {
 	/* verb exec op override */
 	int (*exec_verb)(struct hdac_device *dev, unsigned int cmd,
 			 unsigned int flags, unsigned int *res);
+	int (*exec_verbs)(struct hdac_device *dev, const unsigned int *cmds,
+			  unsigned int *res, unsigned int count);
 
 	/* widgets */
 	unsigned int num_nodes;
@@ -88,6 +90,22 @@ struct hdac_device {
 	bool lazy_cache:1;	/* don't wake up for writes */
 	bool caps_overwriting:1; /* caps overwrite being in process */
 	bool cache_coef:1;	/* cache COEF read/write too */
+
+	/* writes batched during snd_hdac_regmap_sync() or a batch started
+	 * by snd_hdac_regmap_batch_begin()
+	 */
+	struct task_struct *sync_task;
+	unsigned int sync_num;
+	unsigned int sync_cmds[32];
+	bool sync_batch;		/* in snd_hdac_regmap_batch_begin() */
+	int sync_batch_pm_lock;
+	int sync_err;			/* flush error in the regmap unlock */
+	struct mutex regmap_lock;	/* regmap lock, flushes a cache sync */
+
+	/* partial cache sync after a resume keeping the codec state */
+	DECLARE_BITMAP(sync_nids, 256);	/* NIDs written only to the cache */
+	bool sync_partial;		/* sync only the NIDs in sync_nids */
+	unsigned int sync_reset_seq;	/* bus->reset_seq at suspend */
 };
 
 /* device/driver type used for matching */
@@ -118,6 +136,8 @@ unsigned int snd_hdac_make_cmd(struct hdac_device *codec, hda_nid_t nid,
 			       unsigned int verb, unsigned int parm);
 int snd_hdac_exec_verb(struct hdac_device *codec, unsigned int cmd,
 		       unsigned int flags, unsigned int *res);
+int snd_hdac_exec_verbs(struct hdac_device *codec, const unsigned int *cmds,
+			unsigned int *res, unsigned int count);
 int snd_hdac_read(struct hdac_device *codec, hda_nid_t nid,
 		  unsigned int verb, unsigned int parm, unsigned int *res);
 int _snd_hdac_read_parm(struct hdac_device *codec, hda_nid_t nid, int parm,
@@ -202,6 +222,12 @@ struct hdac_bus_ops {
 	/* get a response from the last command */
 	int (*get_response)(struct hdac_bus *bus, unsigned int addr,
 			    unsigned int *res);
+	/* send multiple commands to a codec and collect the responses,
+	 * optional; -EOPNOTSUPP falls back to the single command ops
+	 */
+	int (*command_batch)(struct hdac_bus *bus, unsigned int addr,
+			     const unsigned int *cmds, unsigned int *res,
+			     unsigned int count);
 	/* control the link power  */
 	int (*link_power)(struct hdac_bus *bus, bool enable);
 };
@@ -241,6 +267,10 @@ struct hdac_rb {
 	unsigned short rp, wp;	/* RIRB read/write pointers */
 	int cmds[HDA_MAX_CODECS];	/* number of pending requests */
 	u32 res[HDA_MAX_CODECS];	/* last read value */
+	/* response array of a batched submission, if any */
+	unsigned int *batch_res[HDA_MAX_CODECS];
+	unsigned int batch_pos[HDA_MAX_CODECS];
+	unsigned int batch_len[HDA_MAX_CODECS];
 };
 
 /*
@@ -294,12 +324,16 @@ struct hdac_bus {
 	/* CORB/RIRB and position buffers */
 	struct snd_dma_buffer rb;
 	struct snd_dma_buffer posbuf;
+#ifdef CONFIG_SND_HDA_DSP_LOADER
+	struct snd_dma_buffer dsp_buf;	/* kept for the next DSP loading */
+#endif
 
 	/* hdac_stream linked list */
 	struct list_head stream_list;
 
 	/* operation state */
 	bool chip_init:1;		/* h/w initialized */
+	unsigned int reset_seq;		/* bumped when codecs may lose state */
 
 	/* behavior flags */
 	bool sync_write:1;		/* sync after verb write */
@@ -310,10 +344,12 @@ struct hdac_bus {
 	bool corbrp_self_clear:1;	/* CORBRP clears itself after reset */
 
 	int bdl_pos_adj;		/* BDL position adjustment */
+	int bdl_subperiods;	/* BDL entries with IOC per period */
 
 	/* locks */
 	spinlock_t reg_lock;
 	struct mutex cmd_mutex;
+	wait_queue_head_t rirb_wq;	/* woken up at receiving responses */
 
 	/* i915 component interface */
 	struct i915_audio_component *audio_component;
@@ -328,6 +364,12 @@ int snd_hdac_bus_exec_verb(struct hdac_bus *bus, unsigned int addr,
 			   unsigned int cmd, unsigned int *res);
 int snd_hdac_bus_exec_verb_unlocked(struct hdac_bus *bus, unsigned int addr,
 				    unsigned int cmd, unsigned int *res);
+int snd_hdac_bus_exec_verbs(struct hdac_bus *bus, unsigned int addr,
+			    const unsigned int *cmds, unsigned int *res,
+			    unsigned int count);
+int snd_hdac_bus_exec_verbs_unlocked(struct hdac_bus *bus, unsigned int addr,
+				     const unsigned int *cmds,
+				     unsigned int *res, unsigned int count);
 void snd_hdac_bus_queue_event(struct hdac_bus *bus, u32 res, u32 res_ex);
 
 int snd_hdac_bus_add_device(struct hdac_bus *bus, struct hdac_device *codec);
@@ -345,6 +387,8 @@ static inline void snd_hdac_codec_link_down(struct hdac_device *codec)
 }
 
 int snd_hdac_bus_send_cmd(struct hdac_bus *bus, unsigned int val);
+int snd_hdac_bus_send_cmds(struct hdac_bus *bus, const unsigned int *vals,
+			   unsigned int count);
 int snd_hdac_bus_get_response(struct hdac_bus *bus, unsigned int addr,
 			      unsigned int *res);
 int snd_hdac_bus_parse_capabilities(struct hdac_bus *bus);
@@ -420,6 +464,12 @@ struct hdac_stream {
 	unsigned int frags;	/* number for period in the play buffer */
 	unsigned int fifo_size;	/* FIFO size */
 
+	/* sub-period IOCs, see snd_hdac_stream_period_irq() */
+	unsigned int subperiods;	/* IOCs per period, 0 = off */
+	unsigned int subperiod_bytes;	/* size of non-last sub-periods */
+	unsigned int subperiod_adj;	/* bdl_pos_adj bytes in front */
+	unsigned int subperiod_last;	/* last handled period index */
+
 	void __iomem *sd_addr;	/* stream descriptor pointer */
 
 	u32 sd_int_sta_mask;	/* stream int status mask */
@@ -466,6 +516,7 @@ struct hdac_stream *snd_hdac_get_stream(struct hdac_bus *bus,
 int snd_hdac_stream_setup(struct hdac_stream *azx_dev);
 void snd_hdac_stream_cleanup(struct hdac_stream *azx_dev);
 int snd_hdac_stream_setup_periods(struct hdac_stream *azx_dev);
+bool snd_hdac_stream_period_irq(struct hdac_stream *azx_dev, unsigned int pos);
 int snd_hdac_stream_set_params(struct hdac_stream *azx_dev,
 				unsigned int format_val);
 void snd_hdac_stream_start(struct hdac_stream *azx_dev, bool fresh_start);
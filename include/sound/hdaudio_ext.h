@@ -4,6 +4,10 @@
 
 #include <sound/hdaudio.h>
 
+#define HDAC_EXT_MAX_STREAMS	BITS_PER_LONG
+
+struct hdac_ext_stream;
+
 /**
  * hdac_ext_bus: HDAC extended bus for extended HDA caps
  *
@@ -12,6 +16,9 @@
  * @hlink_list: link list of HDA links
  * @lock: lock for link mgmt
  * @cmd_dma_state: state of cmd DMAs: CORB and RIRB
+ * @host_free: free host streams per direction, by stream index
+ * @link_free: free link streams per direction, by stream index
+ * @stream_tbl: streams by stream index
  */
 struct hdac_ext_bus {
 	struct hdac_bus bus;
@@ -22,6 +29,11 @@ struct hdac_ext_bus {
 
 	struct mutex lock;
 	bool cmd_dma_state;
+
+	/* protected by bus.reg_lock */
+	unsigned long host_free[2];
+	unsigned long link_free[2];
+	struct hdac_ext_stream *stream_tbl[HDAC_EXT_MAX_STREAMS];
 };
 
 int snd_hdac_ext_bus_init(struct hdac_ext_bus *sbus, struct device *dev,
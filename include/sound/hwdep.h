@@ -23,6 +23,7 @@
  */
 
 #include <sound/asound.h>
+#include <sound/memalloc.h>
 #include <linux/poll.h>
 
 struct snd_hwdep;
@@ -74,9 +75,17 @@ struct snd_hwdep {
 	int used;			/* reference counter */
 	unsigned int dsp_loaded;	/* bit fields of loaded dsp indices */
 	unsigned int exclusive:1;	/* exclusive access mode */
+
+	/* mmap'able DSP image buffer, see snd_hwdep_set_dsp_buffer() */
+	int dsp_buffer_type;
+	struct device *dsp_buffer_dev;
+	size_t dsp_buffer_bytes;
+	struct snd_dma_buffer dsp_buffer;	/* allocated at the first mmap */
 };
 
 extern int snd_hwdep_new(struct snd_card *card, char *id, int device,
 			 struct snd_hwdep **rhwdep);
+void snd_hwdep_set_dsp_buffer(struct snd_hwdep *hw, int type,
+			      struct device *dev, size_t size);
 
 #endif /* __SOUND_HWDEP_H */
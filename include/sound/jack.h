@@ -82,6 +82,8 @@ struct snd_jack {
 	char name[100];
 	unsigned int key[6];   /* Keep in sync with definitions above */
 #endif /* CONFIG_SND_JACK_INPUT_DEV */
+	int status;		/* last reported status */
+	bool reported;		/* status is valid */
 	void *private_data;
 	void (*private_free)(struct snd_jack *);
 };
@@ -83,12 +83,16 @@ struct snd_sg_page {
 	dma_addr_t addr;
 };
 
+struct sg_table;
+
 struct snd_sg_buf {
 	int size;	/* allocated byte size */
 	int pages;	/* allocated pages */
 	int tblsize;	/* allocated table size */
 	struct snd_sg_page *table;	/* address table */
 	struct page **page_table;	/* page table (for vmap/vunmap) */
+	unsigned int *contig;	/* continuous pages from each page on */
+	struct sg_table *sgt;	/* set when mapped via IOMMU */
 	struct device *dev;
 };
 
@@ -145,12 +149,21 @@ static inline void *snd_sgbuf_get_ptr(struct snd_dma_buffer *dmab,
 /* allocate/release a buffer */
 int snd_dma_alloc_pages(int type, struct device *dev, size_t size,
 			struct snd_dma_buffer *dmab);
+int snd_dma_alloc_pages_node(int type, struct device *dev, size_t size,
+			     struct snd_dma_buffer *dmab, int nid);
 int snd_dma_alloc_pages_fallback(int type, struct device *dev, size_t size,
                                  struct snd_dma_buffer *dmab);
 void snd_dma_free_pages(struct snd_dma_buffer *dmab);
 
+/* allocate/release a buffer via the recycling pool */
+int snd_dma_pool_alloc(int type, struct device *dev, size_t size,
+		       struct snd_dma_buffer *dmab, int nid);
+void snd_dma_pool_free(struct snd_dma_buffer *dmab);
+void snd_dma_pool_flush(struct device *dev);
+
 /* basic memory allocation functions */
 void *snd_malloc_pages(size_t size, gfp_t gfp_flags);
+void *snd_malloc_pages_node(size_t size, gfp_t gfp_flags, int nid);
 void snd_free_pages(void *ptr, size_t size);
 
 #endif /* __SOUND_MEMALLOC_H */
@@ -315,6 +315,8 @@ struct snd_opl3 {
 
 	struct snd_hwdep *hwdep;
 	spinlock_t reg_lock;
+	spinlock_t shadow_lock;		/* serializes the shadowed writes */
+	unsigned short reg_shadow[0x200];	/* last written, >0xff unknown */
 	struct snd_card *card;		/* The card that this belongs to */
 	unsigned char fm_mode;		/* OPL mode, see SNDRV_DM_FM_MODE_XXX */
 	unsigned char rhythm;		/* percussion mode flag */
@@ -355,6 +357,18 @@ void snd_opl3_interrupt(struct snd_hwdep * hw);
 int snd_opl3_new(struct snd_card *card, unsigned short hardware,
 		 struct snd_opl3 **ropl3);
 int snd_opl3_init(struct snd_opl3 *opl3);
+
+/* a register write of a burst, see snd_opl3_reg_write_burst() */
+struct snd_opl3_reg {
+	unsigned short cmd;		/* OPL3_LEFT/RIGHT | register */
+	unsigned char val;
+};
+
+void snd_opl3_reg_write_burst(struct snd_opl3 *opl3,
+			      const struct snd_opl3_reg *regs, int count);
+void snd_opl3_reg_write(struct snd_opl3 *opl3, unsigned short cmd,
+			unsigned char val);
+void snd_opl3_reg_invalidate(struct snd_opl3 *opl3);
 int snd_opl3_create(struct snd_card *card,
 		    unsigned long l_port, unsigned long r_port,
 		    unsigned short hardware,
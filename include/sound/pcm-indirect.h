@@ -87,6 +87,106 @@ snd_pcm_indirect_playback_transfer(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * vectored transfer: the whole window that can be moved at once is passed
+ * to the driver in a single call, split into the contiguous pieces where
+ * the hw or the sw ring buffer wraps around.  Since neither side can wrap
+ * more than once per window, there are at most three pieces.
+ *
+ * The window is bounded only by what the driver sets up: hw_queue_size
+ * for playback (the whole hw_buffer_size when zero), and the free space
+ * of the sw buffer for capture.  A driver gets larger windows by giving
+ * its hardware a larger ring, not from the helpers.
+ */
+#define SNDRV_PCM_INDIRECT_MAX_VEC	3
+
+struct snd_pcm_indirect_vec {
+	unsigned int hw_data;	/* Offset in hw ring buffer */
+	unsigned int sw_data;	/* Offset in sw ring buffer */
+	unsigned int bytes;	/* Contiguous bytes in both buffers */
+};
+
+typedef void (*snd_pcm_indirect_copy_vec_t)(struct snd_pcm_substream *substream,
+					    struct snd_pcm_indirect *rec,
+					    const struct snd_pcm_indirect_vec *vec,
+					    unsigned int count);
+
+/*
+ * split bytes from the current hw_data/sw_data into vec[] and advance both
+ * offsets; returns the number of pieces
+ */
+static inline unsigned int
+snd_pcm_indirect_fill_vec(struct snd_pcm_indirect *rec,
+			  struct snd_pcm_indirect_vec *vec, unsigned int bytes)
+{
+	unsigned int count = 0;
+
+	while (bytes && count < SNDRV_PCM_INDIRECT_MAX_VEC) {
+		unsigned int hw_to_end = rec->hw_buffer_size - rec->hw_data;
+		unsigned int sw_to_end = rec->sw_buffer_size - rec->sw_data;
+		unsigned int size = bytes;
+		if (hw_to_end < size)
+			size = hw_to_end;
+		if (sw_to_end < size)
+			size = sw_to_end;
+		if (! size)
+			break;
+		vec[count].hw_data = rec->hw_data;
+		vec[count].sw_data = rec->sw_data;
+		vec[count].bytes = size;
+		count++;
+		rec->hw_data += size;
+		if (rec->hw_data == rec->hw_buffer_size)
+			rec->hw_data = 0;
+		rec->sw_data += size;
+		if (rec->sw_data == rec->sw_buffer_size)
+			rec->sw_data = 0;
+		bytes -= size;
+	}
+	return count;
+}
+
+/*
+ * helper function for playback ack callback, vectored version;
+ * copy is called at most once per call
+ */
+static inline int
+snd_pcm_indirect_playback_transfer_vec(struct snd_pcm_substream *substream,
+				       struct snd_pcm_indirect *rec,
+				       snd_pcm_indirect_copy_vec_t copy)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	snd_pcm_uframes_t appl_ptr = runtime->control->appl_ptr;
+	snd_pcm_sframes_t diff = appl_ptr - rec->appl_ptr;
+	struct snd_pcm_indirect_vec vec[SNDRV_PCM_INDIRECT_MAX_VEC];
+	unsigned int i, count;
+	int qsize, bytes;
+
+	if (diff) {
+		if (diff < -(snd_pcm_sframes_t) (runtime->boundary / 2))
+			diff += runtime->boundary;
+		if (diff < 0)
+			return -EINVAL;
+		rec->sw_ready += (int)frames_to_bytes(runtime, diff);
+		rec->appl_ptr = appl_ptr;
+	}
+	qsize = rec->hw_queue_size ? rec->hw_queue_size : rec->hw_buffer_size;
+	bytes = qsize - rec->hw_ready;
+	if (rec->sw_ready < bytes)
+		bytes = rec->sw_ready;
+	if (bytes <= 0)
+		return 0;
+	count = snd_pcm_indirect_fill_vec(rec, vec, bytes);
+	if (! count)
+		return 0;
+	copy(substream, rec, vec, count);
+	for (i = 0; i < count; i++) {
+		rec->hw_ready += vec[i].bytes;
+		rec->sw_ready -= vec[i].bytes;
+	}
+	return 0;
+}
+
 /*
  * helper function for playback pointer callback
  * ptr = current byte pointer
@@ -155,6 +255,46 @@ snd_pcm_indirect_capture_transfer(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * helper function for capture ack callback, vectored version;
+ * copy is called at most once per call
+ */
+static inline int
+snd_pcm_indirect_capture_transfer_vec(struct snd_pcm_substream *substream,
+				      struct snd_pcm_indirect *rec,
+				      snd_pcm_indirect_copy_vec_t copy)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	snd_pcm_uframes_t appl_ptr = runtime->control->appl_ptr;
+	snd_pcm_sframes_t diff = appl_ptr - rec->appl_ptr;
+	struct snd_pcm_indirect_vec vec[SNDRV_PCM_INDIRECT_MAX_VEC];
+	unsigned int i, count;
+	int bytes;
+
+	if (diff) {
+		if (diff < -(snd_pcm_sframes_t) (runtime->boundary / 2))
+			diff += runtime->boundary;
+		if (diff < 0)
+			return -EINVAL;
+		rec->sw_ready -= frames_to_bytes(runtime, diff);
+		rec->appl_ptr = appl_ptr;
+	}
+	bytes = rec->sw_buffer_size - rec->sw_ready;
+	if (rec->hw_ready < bytes)
+		bytes = rec->hw_ready;
+	if (bytes <= 0)
+		return 0;
+	count = snd_pcm_indirect_fill_vec(rec, vec, bytes);
+	if (! count)
+		return 0;
+	copy(substream, rec, vec, count);
+	for (i = 0; i < count; i++) {
+		rec->hw_ready -= vec[i].bytes;
+		rec->sw_ready += vec[i].bytes;
+	}
+	return 0;
+}
+
 /*
  * helper function for capture pointer callback,
  * ptr = current byte pointer
@@ -30,6 +30,9 @@
 #include <linux/mm.h>
 #include <linux/bitops.h>
 #include <linux/pm_qos.h>
+#include <linux/hrtimer.h>
+#include <linux/refcount.h>
+#include <linux/workqueue.h>
 
 #define snd_pcm_substream_chip(substream) ((substream)->private_data)
 #define snd_pcm_chip(pcm) ((pcm)->private_data)
@@ -71,6 +74,10 @@ struct snd_pcm_ops {
 	int (*hw_params)(struct snd_pcm_substream *substream,
 			 struct snd_pcm_hw_params *params);
 	int (*hw_free)(struct snd_pcm_substream *substream);
+	/* apply a change of the period and buffer sizes only, in place;
+	 * leaves the setup unchanged on failure */
+	int (*hw_reconfig)(struct snd_pcm_substream *substream,
+			   struct snd_pcm_hw_params *params);
 	int (*prepare)(struct snd_pcm_substream *substream);
 	int (*trigger)(struct snd_pcm_substream *substream, int cmd);
 	snd_pcm_uframes_t (*pointer)(struct snd_pcm_substream *substream);
@@ -89,6 +96,8 @@ struct snd_pcm_ops {
 			     unsigned long offset);
 	int (*mmap)(struct snd_pcm_substream *substream, struct vm_area_struct *vma);
 	int (*ack)(struct snd_pcm_substream *substream);
+	int (*latency)(struct snd_pcm_substream *substream,
+		       struct snd_pcm_latency *latency);
 };
 
 /*
@@ -217,8 +226,13 @@ struct snd_pcm_ops {
 
 struct snd_pcm_file {
 	struct snd_pcm_substream *substream;
-	int no_compat_mmap;
+	int compat_mmap;		/* 32-bit layout of status/control mmap */
 	unsigned int user_pversion;	/* supported protocol version */
+	struct mutex splice_mutex;	/* protects the splice_frame state */
+	unsigned char *splice_frame;	/* partial frame left by splice_write */
+	unsigned int splice_frame_bytes;
+	unsigned int splice_fill;
+	struct snd_pcm_mmap_control *fanout; /* private control of a fan-out reader */
 };
 
 struct snd_pcm_hw_rule;
@@ -371,6 +385,7 @@ struct snd_pcm_runtime {
 	unsigned int rate_num;
 	unsigned int rate_den;
 	unsigned int no_period_wakeup: 1;
+	unsigned int live_status: 1;	/* publish hw_ptr with seqcount */
 
 	/* -- SW params -- */
 	int tstamp_mode;		/* mmap timestamp is updated */
@@ -381,6 +396,8 @@ struct snd_pcm_runtime {
 						noise is nearest than this */
 	snd_pcm_uframes_t silence_size;	/* Silence filling size */
 	snd_pcm_uframes_t boundary;	/* pointers wrap point */
+	unsigned int wakeup_frames;	/* hrtimer wakeup granularity */
+	unsigned int fanout_readers;	/* attached fan-out capture readers */
 
 	snd_pcm_uframes_t silence_start; /* starting pointer to silence area */
 	snd_pcm_uframes_t silence_filled; /* size filled with silence */
@@ -390,6 +407,8 @@ struct snd_pcm_runtime {
 	/* -- mmap -- */
 	struct snd_pcm_mmap_status *status;
 	struct snd_pcm_mmap_control *control;
+	struct snd_pcm_tstamp_ring *tstamp_ring; /* period interrupt history */
+	struct snd_pcm_compat_mmap *compat_mmap; /* records of 32-bit clients */
 
 	/* -- locking / scheduling -- */
 	snd_pcm_uframes_t twake; 	/* do transfer (!poll) wakeup if non-zero */
@@ -401,9 +420,14 @@ struct snd_pcm_runtime {
 	void *private_data;
 	void (*private_free)(struct snd_pcm_runtime *runtime);
 
+	/* -- in-kernel user, called at each period under the stream lock -- */
+	void (*period_notify)(struct snd_pcm_substream *substream);
+	void *period_notify_data;
+
 	/* -- hardware description -- */
 	struct snd_pcm_hardware hw;
 	struct snd_pcm_hw_constraints hw_constraints;
+	struct snd_pcm_refine_cache *refine_cache; /* HW_REFINE results */
 
 	/* -- timer -- */
 	unsigned int timer_resolution;	/* timer resolution */
@@ -416,6 +440,10 @@ struct snd_pcm_runtime {
 
 	struct snd_dma_buffer *dma_buffer_p;	/* allocated buffer */
 
+	/* -- interleaved access on non-interleaved hardware -- */
+	void *deinterleave_buf;		/* bounce buffer, NULL if unused */
+	snd_pcm_uframes_t deinterleave_frames;	/* frames per copy block */
+
 	/* -- audio timestamp config -- */
 	struct snd_pcm_audio_tstamp_config audio_tstamp_config;
 	struct snd_pcm_audio_tstamp_report audio_tstamp_report;
@@ -431,11 +459,66 @@ struct snd_pcm_group {		/* keep linked substreams */
 	spinlock_t lock;
 	struct mutex mutex;
 	struct list_head substreams;
+	refcount_t refs;
 	int count;
 };
 
 struct pid;
 
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+#define SNDRV_PCM_FLIGHT_EVENTS	32
+
+enum {
+	SNDRV_PCM_FLIGHT_HWPTR,		/* pointer update, arg = in interrupt */
+	SNDRV_PCM_FLIGHT_STATE,		/* state change, arg = new state */
+	SNDRV_PCM_FLIGHT_XRUN,
+};
+
+struct snd_pcm_flight_event {
+	u64 time_ns;
+	snd_pcm_uframes_t pos;		/* driver position, pointer updates */
+	snd_pcm_uframes_t hw_ptr;	/* before the update */
+	snd_pcm_uframes_t appl_ptr;
+	unsigned char type;
+	unsigned char arg;
+};
+
+/* ring of the last events; written under the stream lock */
+struct snd_pcm_flight_rec {
+	unsigned int head;		/* events recorded so far */
+	struct snd_pcm_flight_event ev[SNDRV_PCM_FLIGHT_EVENTS];
+};
+#endif
+
+#ifdef CONFIG_SND_PCM_STATS
+#define SNDRV_PCM_STATS_BUCKETS	16
+
+/* hot paths whose CPU cost is accounted */
+enum {
+	SNDRV_PCM_STATS_COST_PERIOD,	/* snd_pcm_period_elapsed() */
+	SNDRV_PCM_STATS_COST_HW_PTR,	/* snd_pcm_update_hw_ptr0() */
+	SNDRV_PCM_STATS_COST_XFER,	/* __snd_pcm_lib_xfer(), w/o sleeping */
+	SNDRV_PCM_STATS_COST_POLL,	/* poll() */
+	SNDRV_PCM_STATS_COST_NUM
+};
+
+struct snd_pcm_stats_cost {
+	u64 calls;
+	u64 cycles;
+};
+
+/* log2 histograms of the stream timing; protected by the stream lock */
+struct snd_pcm_stats {
+	unsigned int xruns;
+	u64 last_period_ns;	/* time of the last period interrupt */
+	unsigned int period_jitter[SNDRV_PCM_STATS_BUCKETS];	/* usec */
+	unsigned int hw_ptr_delta[SNDRV_PCM_STATS_BUCKETS];	/* frames */
+	unsigned int wakeup_latency[SNDRV_PCM_STATS_BUCKETS];	/* usec */
+	unsigned int wakeup_avail[SNDRV_PCM_STATS_BUCKETS];	/* frames */
+	struct snd_pcm_stats_cost cost[SNDRV_PCM_STATS_COST_NUM];
+};
+#endif
+
 struct snd_pcm_substream {
 	struct snd_pcm *pcm;
 	struct snd_pcm_str *pstr;
@@ -447,6 +530,11 @@ struct snd_pcm_substream {
 	size_t buffer_bytes_max;	/* limit ring buffer size */
 	struct snd_dma_buffer dma_buffer;
 	size_t dma_max;
+	size_t dma_default;		/* preallocation size asked by the driver */
+	size_t dma_learned;		/* largest buffer since the last resize */
+	struct delayed_work prealloc_work;	/* automatic preallocation resize */
+	unsigned char buffer_policy;	/* SNDRV_PCM_BUFFER_POLICY_XXX */
+	bool buffer_marked;		/* buffer pages changed per policy */
 	/* -- hardware operations -- */
 	const struct snd_pcm_ops *ops;
 	/* -- runtime information -- */
@@ -455,6 +543,7 @@ struct snd_pcm_substream {
 	struct snd_timer *timer;		/* timer */
 	unsigned timer_running: 1;	/* time is running */
 	unsigned wait_time;	/* time in ms for R/W to wait for avail */
+	struct hrtimer wakeup_timer;	/* sw_params wakeup_frames */
 	/* -- next substream -- */
 	struct snd_pcm_substream *next;
 	/* -- linked substreams -- */
@@ -483,7 +572,20 @@ struct snd_pcm_substream {
 #ifdef CONFIG_SND_PCM_XRUN_DEBUG
 	struct snd_info_entry *proc_xrun_injection_entry;
 #endif
+#ifdef CONFIG_SND_PCM_STATS
+	struct snd_info_entry *proc_stats_entry;
+#endif
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+	struct snd_info_entry *proc_flight_entry;
+#endif
 #endif /* CONFIG_SND_VERBOSE_PROCFS */
+#ifdef CONFIG_SND_PCM_STATS
+	struct snd_pcm_stats stats;
+#endif
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+	struct snd_pcm_flight_rec flight;
+	struct snd_pcm_flight_rec flight_xrun;	/* copy taken at the last xrun */
+#endif
 	/* misc flags */
 	unsigned int hw_opened: 1;
 };
@@ -530,6 +632,8 @@ struct snd_pcm {
 	void (*private_free) (struct snd_pcm *pcm);
 	bool internal; /* pcm is for internal use only */
 	bool nonatomic; /* whole PCM operations are in non-atomic context */
+	bool prealloc_resize; /* buffers only via snd_pcm_lib_malloc_pages() */
+	struct snd_pcm *shared; /* shared playback device mixing into this one */
 #if IS_ENABLED(CONFIG_SND_PCM_OSS)
 	struct snd_pcm_oss oss;
 #endif
@@ -548,6 +652,8 @@ int snd_pcm_new_internal(struct snd_card *card, const char *id, int device,
 		int playback_count, int capture_count,
 		struct snd_pcm **rpcm);
 int snd_pcm_new_stream(struct snd_pcm *pcm, int stream, int substream_count);
+int snd_pcm_new_shared(struct snd_pcm *pcm, int device, int clients,
+		       unsigned int rate);
 
 #if IS_ENABLED(CONFIG_SND_PCM_OSS)
 struct snd_pcm_notify {
@@ -1079,6 +1185,21 @@ void snd_pcm_set_sync(struct snd_pcm_substream *substream);
 int snd_pcm_lib_ioctl(struct snd_pcm_substream *substream,
 		      unsigned int cmd, void *arg);                      
 void snd_pcm_period_elapsed(struct snd_pcm_substream *substream);
+void snd_pcm_position_update(struct snd_pcm_substream *substream);
+
+/* periods signalled from an hrtimer instead of DMA interrupts */
+struct snd_pcm_period_timer {
+	struct snd_pcm_substream *substream;
+	struct hrtimer timer;
+	ktime_t period_time;
+	bool running;
+};
+
+void snd_pcm_period_timer_init(struct snd_pcm_period_timer *pt,
+			       struct snd_pcm_substream *substream);
+void snd_pcm_period_timer_start(struct snd_pcm_period_timer *pt);
+void snd_pcm_period_timer_stop(struct snd_pcm_period_timer *pt);
+void snd_pcm_period_timer_sync(struct snd_pcm_period_timer *pt);
 snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 				     void *buf, bool interleaved,
 				     snd_pcm_uframes_t frames, bool in_kernel);
@@ -1208,6 +1329,29 @@ int snd_pcm_lib_preallocate_pages_for_all(struct snd_pcm *pcm,
 int snd_pcm_lib_malloc_pages(struct snd_pcm_substream *substream, size_t size);
 int snd_pcm_lib_free_pages(struct snd_pcm_substream *substream);
 
+/* caching policy of the buffer allocated via snd_pcm_lib_malloc_pages();
+ * applied to the kernel mapping at allocation and to the mmap.  Choose a
+ * non-cached policy for the hardware that doesn't snoop the CPU caches.
+ */
+enum {
+	SNDRV_PCM_BUFFER_POLICY_CACHED,		/* cached (default) */
+	SNDRV_PCM_BUFFER_POLICY_WC,		/* write-combined */
+	SNDRV_PCM_BUFFER_POLICY_UNCACHED,	/* uncached */
+};
+
+/**
+ * snd_pcm_set_buffer_policy - set the caching policy of the PCM buffer
+ * @substream: PCM substream
+ * @policy: SNDRV_PCM_BUFFER_POLICY_XXX
+ *
+ * Call this before snd_pcm_lib_malloc_pages(), e.g. at open.
+ */
+static inline void snd_pcm_set_buffer_policy(struct snd_pcm_substream *substream,
+					     int policy)
+{
+	substream->buffer_policy = policy;
+}
+
 int _snd_pcm_lib_alloc_vmalloc_buffer(struct snd_pcm_substream *substream,
 				      size_t size, gfp_t gfp_flags);
 int snd_pcm_lib_free_vmalloc_buffer(struct snd_pcm_substream *substream);
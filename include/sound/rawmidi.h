@@ -47,6 +47,7 @@
 
 struct snd_rawmidi;
 struct snd_rawmidi_substream;
+struct snd_rawmidi_thru_link;
 struct snd_seq_port_info;
 struct pid;
 
@@ -71,11 +72,32 @@ struct snd_rawmidi_runtime {
 	/* midi stream buffer */
 	unsigned char *buffer;	/* buffer for MIDI data */
 	size_t buffer_size;	/* size of buffer */
+	int buffer_ref;		/* buffer accessed without the lock */
 	size_t appl_ptr;	/* application pointer */
 	size_t hw_ptr;		/* hardware pointer */
 	size_t avail_min;	/* min avail for wakeup */
 	size_t avail;		/* max used buffer for wakeup */
 	size_t xruns;		/* over/underruns counter */
+	/* input framing, SNDRV_RAWMIDI_MODE_XXX */
+	unsigned int framing;
+	unsigned int clock_type;
+	/* mmap; once set up, buffer is allocated with vmalloc_user() */
+	struct snd_rawmidi_mmap_control *mmap_control;
+	u64 mmap_appl;		/* mmap_control->appl_ptr applied so far */
+	/* in-kernel MIDI thru [input] */
+	struct snd_rawmidi_thru_link __rcu *thru;
+	/*
+	 * lockless input: snd_rawmidi_receive() owns hw_ptr and rx_in and
+	 * doesn't take the lock; the reader owns the rest under the lock
+	 */
+	bool lockless;
+	unsigned long rx_in;	/* bytes stored */
+	unsigned long rx_out;	/* bytes consumed */
+	unsigned long rx_xruns;	/* bytes dropped */
+	unsigned long rx_woken;	/* rx_out at the last wakeup */
+	unsigned long rx_seen;	/* rx_in last picked up by the reader */
+	unsigned long rx_xruns_seen;
+	unsigned int rx_copying;	/* reads copying without the lock */
 	/* misc */
 	spinlock_t lock;
 	wait_queue_head_t sleep;
@@ -88,6 +110,13 @@ struct snd_rawmidi_runtime {
 	void (*private_free)(struct snd_rawmidi_substream *substream);
 };
 
+/* per-CPU traffic counters of a substream, see /proc/asound/cardX/midiY */
+struct snd_rawmidi_stats {
+	unsigned long events;		/* receive calls [input], acks [output] */
+	unsigned long dropped;		/* bytes lost on overrun or drop */
+	unsigned long max_queued;	/* peak bytes held in the buffer */
+};
+
 struct snd_rawmidi_substream {
 	struct list_head list;		/* list of all substream for given stream */
 	int stream;			/* direction */
@@ -97,6 +126,7 @@ struct snd_rawmidi_substream {
 		     active_sensing: 1; /* send active sensing when close */
 	int use_count;			/* use counter (for output) */
 	size_t bytes;
+	struct snd_rawmidi_stats __percpu *stats;
 	struct snd_rawmidi *rmidi;
 	struct snd_rawmidi_str *pstr;
 	char name[32];
@@ -132,6 +162,9 @@ struct snd_rawmidi {
 
 	const struct snd_rawmidi_global_ops *ops;
 
+	/* snd_rawmidi_receive() is never called concurrently for a substream */
+	bool lockless_input;
+
 	struct snd_rawmidi_str streams[2];
 
 	void *private_data;
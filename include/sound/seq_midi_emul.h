@@ -53,6 +53,10 @@ struct snd_midi_channel {
 	short gm_rpn_fine_tuning; 	/* Master fine tuning */
 	short gm_rpn_coarse_tuning;	/* Master coarse tuning */
 
+	/* values last passed to the control callback, -1 if none yet */
+	short sent_control[128];
+	short sent_pressure;
+	int sent_pitchbend;		/* INT_MIN if none yet */
 };
 
 /*
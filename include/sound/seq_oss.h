@@ -77,6 +77,8 @@ struct snd_seq_oss_callback {
 
 /* default max queue length: configurable by module option */
 #define SNDRV_SEQ_OSS_MAX_QLEN		1024
+/* default write queue length: configurable by module option */
+#define SNDRV_SEQ_OSS_MAX_WQLEN		2000
 
 
 /*
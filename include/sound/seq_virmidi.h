@@ -41,6 +41,15 @@ struct snd_virmidi {
 	struct snd_seq_event event;
 	struct snd_virmidi_dev *rdev;
 	struct snd_rawmidi_substream *substream;
+	/* bulk SysEx output: a whole message is sent as one event */
+	unsigned char *sysex_buf;
+	unsigned int sysex_size;
+	unsigned int sysex_len;
+	bool in_sysex;
+	/* a full buffer is swapped out and dispatched from the work */
+	unsigned char *sysex_flush_buf;
+	unsigned int sysex_flush_len;
+	struct work_struct sysex_work;
 };
 
 #define SNDRV_VIRMIDI_SUBSCRIBE		(1<<0)
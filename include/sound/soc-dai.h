@@ -272,6 +272,8 @@ struct snd_soc_dai_driver {
 	unsigned int symmetric_rates:1;
 	unsigned int symmetric_channels:1;
 	unsigned int symmetric_samplebits:1;
+	/* FE DAI resamples, DPCM may run BEs at a rate of their own */
+	unsigned int rate_conversion:1;
 
 	/* probe ordering - for components with runtime dependencies */
 	int probe_order;
@@ -421,6 +421,9 @@ void snd_soc_dapm_reset_cache(struct snd_soc_dapm_context *dapm);
 /* dapm events */
 void snd_soc_dapm_stream_event(struct snd_soc_pcm_runtime *rtd, int stream,
 	int event);
+void snd_soc_dapm_stream_mark(struct snd_soc_pcm_runtime *rtd, int stream,
+	int event);
+void snd_soc_dapm_stream_sync(struct snd_soc_card *card, int event);
 void snd_soc_dapm_shutdown(struct snd_soc_card *card);
 
 /* external DAPM widget events */
@@ -624,6 +627,12 @@ struct snd_soc_dapm_widget {
 	struct list_head dirty;
 	int endpoints[2];
 
+	/* power sequencing cost, shown in debugfs */
+	u64 event_ns;				/* in event callbacks */
+	u64 write_ns;				/* in its register writes */
+	u64 pop_ns;				/* in pop_time waits */
+	unsigned int power_count;		/* power changes */
+
 	struct clk *clk;
 };
 
@@ -658,6 +667,11 @@ struct snd_soc_dapm_context {
 	/* used during DAPM updates */
 	enum snd_soc_bias_level target_bias_level;
 	struct list_head list;
+	struct list_head seq_pending; /* widgets of a parallel sequence level */
+	struct list_head seq_group; /* those written in the current round */
+	unsigned int seq_mask, seq_value; /* the write of seq_group */
+	s64 seq_write_ns;
+	bool seq_active; /* had widgets at the current level */
 
 	int (*stream_event)(struct snd_soc_dapm_context *dapm, int event);
 	int (*set_bias_level)(struct snd_soc_dapm_context *dapm,
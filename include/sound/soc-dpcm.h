@@ -104,6 +104,11 @@ struct snd_soc_dpcm_runtime {
 	enum snd_soc_dpcm_state state;
 
 	int trigger_pending; /* trigger cmd + 1 if pending, 0 if not */
+
+	/* connected widgets as of card->dapm_route_gen == path_gen */
+	struct snd_soc_dapm_widget_list *path_cache;
+	unsigned int path_gen;
+	int path_count;
 };
 
 /* can this BE stop and free */
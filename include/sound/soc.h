@@ -18,6 +18,7 @@
 #include <linux/types.h>
 #include <linux/notifier.h>
 #include <linux/workqueue.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/regmap.h>
@@ -148,6 +149,28 @@
 	.get = snd_soc_get_volsw, .put = snd_soc_put_volsw, \
 	.private_value = SOC_DOUBLE_R_VALUE(reg_left, reg_right, xshift, \
 					    xmax, xinvert) }
+#define SOC_SINGLE_RAMP(xname, reg, shift, max, invert) \
+{	.iface = SNDRV_CTL_ELEM_IFACE_MIXER, .name = xname, \
+	.info = snd_soc_info_volsw, .get = snd_soc_get_volsw, \
+	.put = snd_soc_put_volsw_ramp, \
+	.private_value = SOC_SINGLE_VALUE(reg, shift, max, invert, 0) }
+#define SOC_DOUBLE_RAMP(xname, reg, shift_left, shift_right, max, invert) \
+{	.iface = SNDRV_CTL_ELEM_IFACE_MIXER, .name = (xname),\
+	.info = snd_soc_info_volsw, .get = snd_soc_get_volsw, \
+	.put = snd_soc_put_volsw_ramp, \
+	.private_value = SOC_DOUBLE_VALUE(reg, shift_left, shift_right, \
+					  max, invert, 0) }
+#define SOC_DOUBLE_R_RAMP(xname, reg_left, reg_right, xshift, xmax, xinvert) \
+{	.iface = SNDRV_CTL_ELEM_IFACE_MIXER, .name = (xname), \
+	.info = snd_soc_info_volsw, \
+	.get = snd_soc_get_volsw, .put = snd_soc_put_volsw_ramp, \
+	.private_value = SOC_DOUBLE_R_VALUE(reg_left, reg_right, xshift, \
+					    xmax, xinvert) }
+#define SOC_VOLSW_RAMP_TIME(xname, xms) \
+{	.iface = SNDRV_CTL_ELEM_IFACE_MIXER, .name = (xname), \
+	.info = snd_soc_info_volsw_ramp_time, \
+	.get = snd_soc_get_volsw_ramp_time, \
+	.put = snd_soc_put_volsw_ramp_time, .private_value = (xms) }
 #define SOC_DOUBLE_R_RANGE_TLV(xname, reg_left, reg_right, xshift, xmin, \
 			       xmax, xinvert, tlv_array)		\
 {	.iface = SNDRV_CTL_ELEM_IFACE_MIXER, .name = (xname),\
@@ -640,6 +663,16 @@ int snd_soc_put_volsw(struct snd_kcontrol *kcontrol,
 	struct snd_ctl_elem_value *ucontrol);
 #define snd_soc_get_volsw_2r snd_soc_get_volsw
 #define snd_soc_put_volsw_2r snd_soc_put_volsw
+int snd_soc_info_volsw_ramp_time(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_info *uinfo);
+int snd_soc_get_volsw_ramp_time(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol);
+int snd_soc_put_volsw_ramp_time(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol);
+int snd_soc_put_volsw_ramp(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol);
+void snd_soc_volsw_ramp_init(struct snd_soc_card *card);
+void snd_soc_volsw_ramp_free(struct snd_soc_card *card);
 int snd_soc_get_volsw_sx(struct snd_kcontrol *kcontrol,
 	struct snd_ctl_elem_value *ucontrol);
 int snd_soc_put_volsw_sx(struct snd_kcontrol *kcontrol,
@@ -1091,6 +1124,15 @@ struct snd_soc_dai_link {
 	/* DPCM used FE & BE merged format */
 	unsigned int dpcm_merged_format:1;
 
+	/* run BE hw_params and prepare of this FE concurrently; the BEs
+	 * must not share components that aren't safe for that */
+	unsigned int dpcm_parallel_be:1;
+
+	/* run hw_params, prepare and mute of the CODEC DAIs concurrently;
+	 * the CODECs must not share registers or driver state, and gain
+	 * most on independent control buses */
+	unsigned int parallel_codecs:1;
+
 	/* pmdown_time is ignored at stop */
 	unsigned int ignore_pmdown_time:1;
 
@@ -1210,6 +1252,8 @@ struct snd_soc_card {
 	const struct snd_soc_dapm_route *of_dapm_routes;
 	int num_of_dapm_routes;
 	bool fully_routed;
+	/* power contexts in parallel within a DAPM sequence level */
+	bool parallel_dapm_seq;
 
 	struct work_struct deferred_resume_work;
 
@@ -1220,10 +1264,18 @@ struct snd_soc_card {
 	struct list_head paths;
 	struct list_head dapm_list;
 	struct list_head dapm_dirty;
+	unsigned int dapm_route_gen;	/* bumped on any DAPM route change */
 
 	/* attached dynamic objects */
 	struct list_head dobj_list;
 
+	/* running volume ramps, see snd_soc_put_volsw_ramp() */
+	struct list_head volsw_ramps;
+	struct mutex volsw_ramp_mutex;
+	struct hrtimer volsw_ramp_timer;
+	struct work_struct volsw_ramp_work;
+	bool volsw_ramps_stopped;
+
 	/* Generic DAPM context for the card */
 	struct snd_soc_dapm_context dapm;
 	struct snd_soc_dapm_stats dapm_stats;
@@ -1252,6 +1304,7 @@ struct snd_soc_pcm_runtime {
 	int fe_compr;
 
 	long pmdown_time;
+	unsigned long pmdown_deadline;	/* pending playback power down, jiffies */
 
 	/* runtime devices */
 	struct snd_pcm *pcm;
@@ -1265,6 +1318,9 @@ struct snd_soc_pcm_runtime {
 	struct snd_soc_dai **codec_dais;
 	unsigned int num_codecs;
 
+	/* DAI capabilities of the link, intersected at PCM creation */
+	struct snd_soc_pcm_stream dai_caps[2];
+
 	struct delayed_work delayed_work;
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_dpcm_root;
@@ -1277,6 +1333,7 @@ struct snd_soc_pcm_runtime {
 	/* bit field */
 	unsigned int dev_registered:1;
 	unsigned int pop_wait:1;
+	unsigned int pmdown_shift:2;	/* pmdown_time scale from reopens */
 };
 
 /* mixer control */
@@ -22,6 +22,7 @@
  *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
  */
 
+#include <crypto/sha.h>
 #include <sound/sfnt_info.h>
 #include <sound/util_mem.h>
 
@@ -48,9 +49,24 @@ struct snd_sf_sample {
 	struct soundfont_sample_info v;
 	int counter;
 	struct snd_util_memblk *block;	/* allocated data block */
+	struct snd_sf_shared *shared;	/* block shared with identical ones */
 	struct snd_sf_sample *next;
 };
 
+/*
+ * A loaded data block, shared by all samples with the same wave data
+ * and layout, whichever soundfont they belong to.
+ */
+struct snd_sf_shared {
+	u8 digest[SHA256_DIGEST_SIZE];	/* of the wave data */
+	struct soundfont_sample_info key;	/* as passed by user-space */
+	struct soundfont_sample_info v;	/* as set up by sample_new */
+	struct snd_util_memblk *block;
+	long count;
+	int refcount;
+	struct snd_sf_shared *next;
+};
+
 /*
  * This represents all the information relating to a soundfont.
  */
@@ -96,6 +112,7 @@ struct snd_sf_list {
 	struct mutex presets_mutex;
 	spinlock_t lock;
 	struct snd_util_memhdr *memhdr;
+	struct snd_sf_shared *shared;	/* loaded blocks by contents */
 };
 
 /* Prototypes for soundfont.c */
@@ -25,6 +25,8 @@
 
 #include <sound/asound.h>
 #include <linux/interrupt.h>
+#include <linux/cpumask.h>
+#include <linux/kthread.h>
 
 #define snd_timer_chip(timer) ((timer)->private_data)
 
@@ -50,6 +52,13 @@
 #define SNDRV_TIMER_FLG_CHANGE	0x00000001
 #define SNDRV_TIMER_FLG_RESCHED	0x00000002	/* need reschedule */
 
+/* how the slow (non-fast) callbacks are delivered */
+#define SNDRV_TIMER_DISPATCH_TASKLET	0	/* one tasklet per timer */
+#define SNDRV_TIMER_DISPATCH_WORK	1	/* work on each instance's CPU */
+#define SNDRV_TIMER_DISPATCH_KTHREAD	2	/* RT kthread per timer */
+
+struct snd_timer_work;
+
 struct snd_timer;
 
 struct snd_timer_hardware {
@@ -85,11 +94,17 @@ struct snd_timer {
 	struct snd_timer_hardware hw;
 	spinlock_t lock;
 	struct list_head device_list;
+	struct hlist_node hash_node;	/* snd_timer_hash, keyed by timer id */
 	struct list_head open_list_head;
 	struct list_head active_list_head;
 	struct list_head ack_list_head;
 	struct list_head sack_list_head; /* slow ack list head */
 	struct tasklet_struct task_queue;
+	int dispatch;			/* SNDRV_TIMER_DISPATCH_* */
+	struct snd_timer_work __percpu *cpu_works; /* DISPATCH_WORK */
+	cpumask_var_t sack_cpus;	/* CPUs with pending slow callbacks */
+	struct kthread_worker *kworker;	/* DISPATCH_KTHREAD */
+	struct kthread_work kwork;
 	int max_instances;	/* upper limit of timer instances */
 	int num_instances;	/* current number of timer instances */
 };
@@ -116,11 +131,13 @@ struct snd_timer_instance {
 	int slave_class;
 	unsigned int slave_id;
 	struct list_head open_list;
+	struct hlist_node slave_hash;	/* masters and pending slaves by slave id */
 	struct list_head active_list;
 	struct list_head ack_list;
 	struct list_head slave_list_head;
 	struct list_head slave_active_head;
 	struct snd_timer_instance *master;
+	int cpu;			/* CPU of the last start, for DISPATCH_WORK */
 };
 
 /*
@@ -132,6 +149,7 @@ void snd_timer_notify(struct snd_timer *timer, int event, struct timespec *tstam
 int snd_timer_global_new(char *id, int device, struct snd_timer **rtimer);
 int snd_timer_global_free(struct snd_timer *timer);
 int snd_timer_global_register(struct snd_timer *timer);
+int snd_timer_set_dispatch(struct snd_timer *timer, int dispatch);
 
 int snd_timer_open(struct snd_timer_instance **ti, char *owner, struct snd_timer_id *tid, unsigned int slave_id);
 int snd_timer_close(struct snd_timer_instance *timeri);
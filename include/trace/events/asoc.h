@@ -129,6 +129,50 @@ DEFINE_EVENT(snd_soc_dapm_widget, snd_soc_dapm_widget_event_done,
 
 );
 
+TRACE_EVENT(snd_soc_dapm_widget_time,
+
+	TP_PROTO(struct snd_soc_dapm_widget *w, int event, s64 ns),
+
+	TP_ARGS(w, event, ns),
+
+	TP_STRUCT__entry(
+		__string(	name,	w->name		)
+		__field(	int,	event		)
+		__field(	s64,	ns		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, w->name);
+		__entry->event = event;
+		__entry->ns = ns;
+	),
+
+	TP_printk("widget=%s event=%d took %lld ns", __get_str(name),
+		  (int)__entry->event, (long long)__entry->ns)
+);
+
+TRACE_EVENT(snd_soc_dapm_seq_time,
+
+	TP_PROTO(struct snd_soc_card *card, bool power_up, s64 ns),
+
+	TP_ARGS(card, power_up, ns),
+
+	TP_STRUCT__entry(
+		__string(	name,		card->name	)
+		__field(	bool,		power_up	)
+		__field(	s64,		ns		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, card->name);
+		__entry->power_up = power_up;
+		__entry->ns = ns;
+	),
+
+	TP_printk("card=%s power %s took %lld ns", __get_str(name),
+		  __entry->power_up ? "up" : "down", (long long)__entry->ns)
+);
+
 TRACE_EVENT(snd_soc_dapm_walk_done,
 
 	TP_PROTO(struct snd_soc_card *card),
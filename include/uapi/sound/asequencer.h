@@ -26,7 +26,7 @@
 #include <sound/asound.h>
 
 /** version of the sequencer */
-#define SNDRV_SEQ_VERSION SNDRV_PROTOCOL_VERSION(1, 0, 2)
+#define SNDRV_SEQ_VERSION SNDRV_PROTOCOL_VERSION(1, 0, 3)
 
 /**
  * definition of sequencer event types
@@ -553,6 +553,26 @@ struct snd_seq_port_subscribe {
 	char reserved[64];
 };
 
+/* queue dispatch context */
+#define SNDRV_SEQ_QUEUE_DISPATCH_TIMER		0	/* timer callback (default) */
+#define SNDRV_SEQ_QUEUE_DISPATCH_KTHREAD	1	/* dedicated SCHED_FIFO kthread */
+
+struct snd_seq_queue_dispatch {
+	int queue;		/* sequencer queue */
+	int mode;		/* SNDRV_SEQ_QUEUE_DISPATCH_XXX */
+	int cpu;		/* CPU the kthread is bound to, -1 = any */
+	int priority;		/* SCHED_FIFO priority of the kthread */
+	unsigned char reserved[16];	/* for future use */
+};
+
+/* batched event read/write; only fixed length events are allowed */
+struct snd_seq_event_batch {
+	__u64 events;		/* pointer to an array of struct snd_seq_event */
+	unsigned int count;	/* number of events in the array */
+	unsigned int done;	/* R/O: number of events processed */
+	unsigned char reserved[16];	/* for future use */
+};
+
 /* type of query subscription */
 #define SNDRV_SEQ_QUERY_SUBS_READ	0
 #define SNDRV_SEQ_QUERY_SUBS_WRITE	1
@@ -597,6 +617,8 @@ struct snd_seq_query_subs {
 #define SNDRV_SEQ_IOCTL_GET_QUEUE_STATUS _IOWR('S', 0x40, struct snd_seq_queue_status)
 #define SNDRV_SEQ_IOCTL_GET_QUEUE_TEMPO	_IOWR('S', 0x41, struct snd_seq_queue_tempo)
 #define SNDRV_SEQ_IOCTL_SET_QUEUE_TEMPO	_IOW ('S', 0x42, struct snd_seq_queue_tempo)
+#define SNDRV_SEQ_IOCTL_GET_QUEUE_DISPATCH _IOWR('S', 0x43, struct snd_seq_queue_dispatch)
+#define SNDRV_SEQ_IOCTL_SET_QUEUE_DISPATCH _IOW ('S', 0x44, struct snd_seq_queue_dispatch)
 #define SNDRV_SEQ_IOCTL_GET_QUEUE_TIMER	_IOWR('S', 0x45, struct snd_seq_queue_timer)
 #define SNDRV_SEQ_IOCTL_SET_QUEUE_TIMER	_IOW ('S', 0x46, struct snd_seq_queue_timer)
 #define SNDRV_SEQ_IOCTL_GET_QUEUE_CLIENT	_IOWR('S', 0x49, struct snd_seq_queue_client)
@@ -609,4 +631,7 @@ struct snd_seq_query_subs {
 #define SNDRV_SEQ_IOCTL_QUERY_NEXT_CLIENT	_IOWR('S', 0x51, struct snd_seq_client_info)
 #define SNDRV_SEQ_IOCTL_QUERY_NEXT_PORT	_IOWR('S', 0x52, struct snd_seq_port_info)
 
+#define SNDRV_SEQ_IOCTL_WRITE_BATCH	_IOWR('S', 0x60, struct snd_seq_event_batch)
+#define SNDRV_SEQ_IOCTL_READ_BATCH	_IOWR('S', 0x61, struct snd_seq_event_batch)
+
 #endif /* _UAPI__SOUND_ASEQUENCER_H */
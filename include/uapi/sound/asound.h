@@ -80,7 +80,7 @@ struct snd_cea_861_aud_if {
  *                                                                          *
  ****************************************************************************/
 
-#define SNDRV_HWDEP_VERSION		SNDRV_PROTOCOL_VERSION(1, 0, 1)
+#define SNDRV_HWDEP_VERSION		SNDRV_PROTOCOL_VERSION(1, 0, 2)
 
 enum {
 	SNDRV_HWDEP_IFACE_OPL2 = 0,
@@ -110,9 +110,10 @@ enum {
 	SNDRV_HWDEP_IFACE_LINE6,	/* Line6 USB processors */
 	SNDRV_HWDEP_IFACE_FW_MOTU,	/* MOTU FireWire series */
 	SNDRV_HWDEP_IFACE_FW_FIREFACE,	/* RME Fireface series */
+	SNDRV_HWDEP_IFACE_USB_PACKETS,	/* packet rings of usb-audio streams */
 
 	/* Don't forget to change the following: */
-	SNDRV_HWDEP_IFACE_LAST = SNDRV_HWDEP_IFACE_FW_FIREFACE
+	SNDRV_HWDEP_IFACE_LAST = SNDRV_HWDEP_IFACE_USB_PACKETS
 };
 
 struct snd_hwdep_info {
@@ -131,13 +132,21 @@ struct snd_hwdep_dsp_status {
 	unsigned int num_dsps;		/* R: number of DSP images to transfer */
 	unsigned int dsp_loaded;	/* R: bit flags indicating the loaded DSPs */
 	unsigned int chip_ready;	/* R: 1 = initialization finished */
-	unsigned char reserved[16];	/* reserved for future use */
+	unsigned int buffer_bytes;	/* R: size of the image buffer, 0 = none */
+	unsigned char reserved[12];	/* reserved for future use */
 };
 
+/*
+ * When buffer_bytes is set, the image buffer can be mapped at
+ * SNDRV_HWDEP_MMAP_OFFSET_DSP; an image written there is loaded by passing
+ * a NULL image pointer to SNDRV_HWDEP_IOCTL_DSP_LOAD.
+ */
+#define SNDRV_HWDEP_MMAP_OFFSET_DSP	0x80000000
+
 struct snd_hwdep_dsp_image {
 	unsigned int index;		/* W: DSP index */
 	unsigned char name[64];		/* W: ID (e.g. file name) */
-	unsigned char __user *image;	/* W: binary image */
+	unsigned char __user *image;	/* W: binary image, NULL = mapped buffer */
 	size_t length;			/* W: size of image in bytes */
 	unsigned long driver_data;	/* W: driver-specific data */
 };
@@ -153,7 +162,7 @@ struct snd_hwdep_dsp_image {
  *                                                                           *
  *****************************************************************************/
 
-#define SNDRV_PCM_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 14)
+#define SNDRV_PCM_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 21)
 
 typedef unsigned long snd_pcm_uframes_t;
 typedef signed long snd_pcm_sframes_t;
@@ -287,6 +296,7 @@ typedef int __bitwise snd_pcm_subformat_t;
 #define SNDRV_PCM_INFO_HAS_LINK_ESTIMATED_ATIME    0x04000000  /* report estimated link audio time */
 #define SNDRV_PCM_INFO_HAS_LINK_SYNCHRONIZED_ATIME 0x08000000  /* report synchronized audio/system time */
 
+#define SNDRV_PCM_INFO_MONOTONIC_POINTER 0x20000000	/* internal kernel flag - exact pointer, never goes back */
 #define SNDRV_PCM_INFO_DRAIN_TRIGGER	0x40000000		/* internal kernel flag - trigger in drain */
 #define SNDRV_PCM_INFO_FIFO_IN_FRAMES	0x80000000	/* internal kernel flag - FIFO size is in frames */
 
@@ -308,6 +318,7 @@ enum {
 	SNDRV_PCM_MMAP_OFFSET_DATA = 0x00000000,
 	SNDRV_PCM_MMAP_OFFSET_STATUS = 0x80000000,
 	SNDRV_PCM_MMAP_OFFSET_CONTROL = 0x81000000,
+	SNDRV_PCM_MMAP_OFFSET_TSTAMP_RING = 0x82000000, /* req. proto >= 2.0.18 */
 };
 
 union snd_pcm_sync_id {
@@ -367,6 +378,7 @@ typedef int snd_pcm_hw_param_t;
 #define SNDRV_PCM_HW_PARAMS_NORESAMPLE	(1<<0)	/* avoid rate resampling */
 #define SNDRV_PCM_HW_PARAMS_EXPORT_BUFFER	(1<<1)	/* export buffer */
 #define SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP	(1<<2)	/* disable period wakeups */
+#define SNDRV_PCM_HW_PARAMS_LIVE_STATUS	(1<<3)	/* seqcount on mmap'ed status */
 
 struct snd_interval {
 	unsigned int min, max;
@@ -419,7 +431,8 @@ struct snd_pcm_sw_params {
 	snd_pcm_uframes_t boundary;		/* pointers wrap point */
 	unsigned int proto;			/* protocol version */
 	unsigned int tstamp_type;		/* timestamp type (req. proto >= 2.0.12) */
-	unsigned char reserved[56];		/* reserved for future */
+	unsigned int wakeup_frames;		/* timer wakeup granularity (req. proto >= 2.0.16) */
+	unsigned char reserved[52];		/* reserved for future */
 };
 
 struct snd_pcm_channel_info {
@@ -463,9 +476,35 @@ struct snd_pcm_status {
 	unsigned char reserved[52-2*sizeof(struct timespec)]; /* must be filled with zero */
 };
 
+/* a record of the binary /proc/asound/pcm_status file, one per substream;
+ * the file is re-read from the position zero to get a fresh snapshot
+ */
+struct snd_pcm_status_record {
+	__u32 size;		/* sizeof(struct snd_pcm_status_record) */
+	__s32 card;
+	__s32 device;
+	__s32 subdevice;
+	__s32 stream;		/* SNDRV_PCM_STREAM_XXX */
+	__s32 state;		/* SNDRV_PCM_STATE_XXX, -1 when closed */
+	__s32 owner_pid;	/* -1 when closed */
+	__s32 format;		/* SNDRV_PCM_FORMAT_XXX, -1 when not set up */
+	__u32 rate;
+	__u32 channels;
+	__u32 xruns;		/* zero without the PCM statistics */
+	__u32 reserved;
+	__u64 period_size;	/* in frames */
+	__u64 buffer_size;	/* in frames */
+	__u64 hw_ptr;		/* as of the last position update */
+	__u64 appl_ptr;
+	__u64 avail;
+};
+
 struct snd_pcm_mmap_status {
 	snd_pcm_state_t state;		/* RO: state - SNDRV_PCM_STATE_XXXX */
-	int pad1;			/* Needed for 64 bit alignment */
+	int pad1;			/* Needed for 64 bit alignment;
+					 * RO: update sequence counter with
+					 * SNDRV_PCM_HW_PARAMS_LIVE_STATUS
+					 */
 	snd_pcm_uframes_t hw_ptr;	/* RO: hw ptr (0...boundary-1) */
 	struct timespec tstamp;		/* Timestamp */
 	snd_pcm_state_t suspended_state; /* RO: suspended stream state */
@@ -477,6 +516,25 @@ struct snd_pcm_mmap_control {
 	snd_pcm_uframes_t avail_min;	/* RW: min available frames for wakeup */
 };
 
+/* the state at one period interrupt */
+struct snd_pcm_tstamp_sample {
+	snd_pcm_uframes_t hw_ptr;	/* hw ptr after the update */
+	struct timespec tstamp;		/* system timestamp */
+	struct timespec audio_tstamp;	/* from sample counter or wall clock */
+};
+
+/*
+ * RO: one page mmapped at SNDRV_PCM_MMAP_OFFSET_TSTAMP_RING; the samples
+ * are written before head is advanced, so a reader takes head, reads the
+ * samples below it and checks that head did not move by entries meanwhile.
+ * The timestamps are valid with SNDRV_PCM_TSTAMP_ENABLE only.
+ */
+struct snd_pcm_tstamp_ring {
+	unsigned int head;		/* samples written; next slot is head % entries */
+	unsigned int entries;		/* number of slots */
+	struct snd_pcm_tstamp_sample samples[0];
+};
+
 #define SNDRV_PCM_SYNC_PTR_HWSYNC	(1<<0)	/* execute hwsync */
 #define SNDRV_PCM_SYNC_PTR_APPL		(1<<1)	/* get appl_ptr from driver (r/w op) */
 #define SNDRV_PCM_SYNC_PTR_AVAIL_MIN	(1<<2)	/* get avail_min from driver */
@@ -505,6 +563,77 @@ struct snd_xfern {
 	snd_pcm_uframes_t frames;
 };
 
+/* one interleaved transfer of a linked group member */
+struct snd_xferi_link {
+	int fd;				/* PCM file of the linked substream */
+	snd_pcm_sframes_t result;
+	void __user *buf;
+	snd_pcm_uframes_t frames;
+};
+
+struct snd_xferi_linked {
+	unsigned int count;		/* number of entries in xfers */
+	struct snd_xferi_link __user *xfers;
+};
+
+/* running setup of a stream taken over via SNDRV_PCM_IOCTL_HANDOFF;
+ * the layout is identical for 32 and 64 bit user-space
+ */
+struct snd_pcm_handoff {
+	int state;			/* R: SNDRV_PCM_STATE_* */
+	snd_pcm_access_t access;	/* R: hw params */
+	snd_pcm_format_t format;
+	snd_pcm_subformat_t subformat;
+	unsigned int channels;
+	unsigned int rate;
+	unsigned int periods;
+	unsigned int flags;		/* R: SNDRV_PCM_HW_PARAMS_* in effect */
+	int tstamp_mode;		/* R: sw params */
+	int tstamp_type;
+	unsigned int period_step;
+	unsigned int wakeup_frames;
+	__u64 period_size;
+	__u64 buffer_size;
+	__u64 avail_min;
+	__u64 start_threshold;
+	__u64 stop_threshold;
+	__u64 silence_threshold;
+	__u64 silence_size;
+	__u64 boundary;
+	__u64 appl_ptr;			/* R: current pointers */
+	__u64 hw_ptr;
+	unsigned char reserved[64];
+};
+
+/* stages of the SNDRV_PCM_IOCTL_LATENCY report */
+enum {
+	SNDRV_PCM_LATENCY_BUFFER = 0,	/* ring buffer, between hw_ptr and appl_ptr */
+	SNDRV_PCM_LATENCY_DRIVER,	/* delay the driver doesn't break down */
+	SNDRV_PCM_LATENCY_FIFO,		/* controller FIFO and DMA prefetch */
+	SNDRV_PCM_LATENCY_TRANSPORT,	/* queued bus transfers, e.g. USB URBs */
+	SNDRV_PCM_LATENCY_CODEC,	/* codec and converter pipeline */
+	SNDRV_PCM_LATENCY_LAST = SNDRV_PCM_LATENCY_CODEC,
+};
+
+#define SNDRV_PCM_LATENCY_STAGES	8
+
+struct snd_pcm_latency_stage {
+	__u64 frames;
+	__u64 ns;
+};
+
+/* per-stage latency breakdown; the stages add up to the total, which
+ * includes the SNDRV_PCM_IOCTL_DELAY value;
+ * the layout is identical for 32 and 64 bit user-space
+ */
+struct snd_pcm_latency {
+	int state;			/* R: SNDRV_PCM_STATE_* */
+	unsigned int rate;		/* R: frames per second */
+	struct snd_pcm_latency_stage stage[SNDRV_PCM_LATENCY_STAGES];
+	struct snd_pcm_latency_stage total;
+	unsigned char reserved[64];
+};
+
 enum {
 	SNDRV_PCM_TSTAMP_TYPE_GETTIMEOFDAY = 0,	/* gettimeofday equivalent */
 	SNDRV_PCM_TSTAMP_TYPE_MONOTONIC,	/* posix_clock_monotonic equivalent */
@@ -570,6 +699,7 @@ enum {
 #define SNDRV_PCM_IOCTL_HW_PARAMS	_IOWR('A', 0x11, struct snd_pcm_hw_params)
 #define SNDRV_PCM_IOCTL_HW_FREE		_IO('A', 0x12)
 #define SNDRV_PCM_IOCTL_SW_PARAMS	_IOWR('A', 0x13, struct snd_pcm_sw_params)
+#define SNDRV_PCM_IOCTL_HW_RECONFIG	_IOWR('A', 0x14, struct snd_pcm_hw_params)
 #define SNDRV_PCM_IOCTL_STATUS		_IOR('A', 0x20, struct snd_pcm_status)
 #define SNDRV_PCM_IOCTL_DELAY		_IOR('A', 0x21, snd_pcm_sframes_t)
 #define SNDRV_PCM_IOCTL_HWSYNC		_IO('A', 0x22)
@@ -590,8 +720,15 @@ enum {
 #define SNDRV_PCM_IOCTL_READI_FRAMES	_IOR('A', 0x51, struct snd_xferi)
 #define SNDRV_PCM_IOCTL_WRITEN_FRAMES	_IOW('A', 0x52, struct snd_xfern)
 #define SNDRV_PCM_IOCTL_READN_FRAMES	_IOR('A', 0x53, struct snd_xfern)
+#define SNDRV_PCM_IOCTL_XFERI_LINKED	_IOW('A', 0x54, struct snd_xferi_linked)
 #define SNDRV_PCM_IOCTL_LINK		_IOW('A', 0x60, int)
 #define SNDRV_PCM_IOCTL_UNLINK		_IO('A', 0x61)
+/* turn an O_APPEND capture handle into a fan-out reader (proto >= 2.0.17) */
+#define SNDRV_PCM_IOCTL_FANOUT		_IO('A', 0x62)
+/* become the owner of a stream received by fd passing (proto >= 2.0.19) */
+#define SNDRV_PCM_IOCTL_HANDOFF		_IOR('A', 0x63, struct snd_pcm_handoff)
+/* per-stage latency breakdown (proto >= 2.0.20) */
+#define SNDRV_PCM_IOCTL_LATENCY		_IOR('A', 0x64, struct snd_pcm_latency)
 
 /*****************************************************************************
  *                                                                           *
@@ -603,7 +740,7 @@ enum {
  *  Raw MIDI section - /dev/snd/midi??
  */
 
-#define SNDRV_RAWMIDI_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 0)
+#define SNDRV_RAWMIDI_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 3)
 
 enum {
 	SNDRV_RAWMIDI_STREAM_OUTPUT = 0,
@@ -629,14 +766,44 @@ struct snd_rawmidi_info {
 	unsigned char reserved[64];	/* reserved for future use */
 };
 
+#define SNDRV_RAWMIDI_MODE_FRAMING_MASK		(7<<0)
+#define SNDRV_RAWMIDI_MODE_FRAMING_SHIFT	0
+#define SNDRV_RAWMIDI_MODE_FRAMING_NONE		(0<<0)
+#define SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP	(1<<0)
+#define SNDRV_RAWMIDI_MODE_CLOCK_MASK		(7<<3)
+#define SNDRV_RAWMIDI_MODE_CLOCK_SHIFT		3
+#define SNDRV_RAWMIDI_MODE_CLOCK_NONE		(0<<3)
+#define SNDRV_RAWMIDI_MODE_CLOCK_REALTIME	(1<<3)
+#define SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC	(2<<3)
+#define SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW	(3<<3)
+
 struct snd_rawmidi_params {
 	int stream;
 	size_t buffer_size;		/* queue size in bytes */
 	size_t avail_min;		/* minimum avail bytes for wakeup */
 	unsigned int no_active_sensing: 1; /* do not send active sensing byte in close() */
-	unsigned char reserved[16];	/* reserved for future use */
+	unsigned int mode;		/* input only: SNDRV_RAWMIDI_MODE_XXX (proto >= 2.0.1) */
+	unsigned char reserved[12];	/* reserved for future use */
 };
 
+/*
+ * In the timestamp framing mode, the input is read as a sequence of
+ * these frames.  Each frame holds up to 16 bytes received at once, with
+ * the time of reception in the clock selected via the mode.
+ */
+#define SNDRV_RAWMIDI_FRAMING_DATA_LENGTH	16
+
+#define SNDRV_RAWMIDI_FRAME_TYPE_DEFAULT	0
+
+struct snd_rawmidi_framing_tstamp {
+	__u8 frame_type;		/* SNDRV_RAWMIDI_FRAME_TYPE_XXX */
+	__u8 length;			/* number of valid bytes in data */
+	__u8 reserved[2];
+	__u32 tv_nsec;			/* nanoseconds */
+	__u64 tv_sec;			/* seconds */
+	__u8 data[SNDRV_RAWMIDI_FRAMING_DATA_LENGTH];
+} __packed;
+
 struct snd_rawmidi_status {
 	int stream;
 	struct timespec tstamp;		/* Timestamp */
@@ -645,18 +812,70 @@ struct snd_rawmidi_status {
 	unsigned char reserved[16];	/* reserved for future use */
 };
 
+/*
+ * mmap support (proto >= 2.0.2): the data buffer and a control record of
+ * each stream can be mapped at the offsets below.  Both pointers count
+ * the bytes since the mapping was set up and wrap only at 2^64; the
+ * buffer offset is the pointer modulo buffer_size.  The application
+ * moves appl_ptr and calls SNDRV_RAWMIDI_IOCTL_SYNC_PTR to let the
+ * kernel pick up new output data.  Once mapped, read() and write() are
+ * not allowed on the stream.
+ */
+#define SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT		0x00000000
+#define SNDRV_RAWMIDI_MMAP_OFFSET_INPUT			0x40000000
+#define SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_CONTROL	0x80000000
+#define SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_CONTROL		0x81000000
+
+struct snd_rawmidi_mmap_control {
+	__u64 hw_ptr;		/* RO: bytes received (input) or sent (output) */
+	__u64 appl_ptr;		/* RW: bytes read (input) or written (output) */
+	__u32 buffer_size;	/* RO: size of the ring in the data area */
+	__u32 xruns;		/* RO: count of overruns (in bytes) */
+	unsigned char reserved[40];	/* reserved for future use */
+};
+
+/*
+ * MIDI thru (proto >= 2.0.3): the input of the file is forwarded in the
+ * kernel to the given output, which is opened in append mode.  The
+ * binding lasts until it is replaced, the card is set to -1, or the file
+ * is closed.  With a filter or a channel mask set, the input is parsed,
+ * and every forwarded message carries its status byte.
+ *
+ * Binding requires an fd of the output device opened for writing, which
+ * grants the same access as opening it; open it with O_APPEND to let
+ * the binding share a subdevice with it.  The fd may be closed after
+ * the call.
+ */
+#define SNDRV_RAWMIDI_THRU_FILTER_SYSEX		(1<<0)	/* drop system exclusive */
+#define SNDRV_RAWMIDI_THRU_FILTER_COMMON	(1<<1)	/* drop system common (0xf1-0xf6) */
+#define SNDRV_RAWMIDI_THRU_FILTER_REALTIME	(1<<2)	/* drop realtime except active sensing */
+#define SNDRV_RAWMIDI_THRU_FILTER_ACTIVE_SENSING (1<<3)	/* drop active sensing (0xfe) */
+
+struct snd_rawmidi_thru {
+	int card;			/* card of the output, -1 = unbind */
+	int device;			/* device of the output */
+	int subdevice;			/* subdevice of the output, -1 = any */
+	unsigned int filter;		/* SNDRV_RAWMIDI_THRU_FILTER_XXX */
+	unsigned short channels;	/* channels of voice messages to forward */
+	unsigned short pad;
+	int fd;				/* the output device opened for writing */
+	unsigned char reserved[12];	/* reserved for future use */
+};
+
 #define SNDRV_RAWMIDI_IOCTL_PVERSION	_IOR('W', 0x00, int)
 #define SNDRV_RAWMIDI_IOCTL_INFO	_IOR('W', 0x01, struct snd_rawmidi_info)
 #define SNDRV_RAWMIDI_IOCTL_PARAMS	_IOWR('W', 0x10, struct snd_rawmidi_params)
 #define SNDRV_RAWMIDI_IOCTL_STATUS	_IOWR('W', 0x20, struct snd_rawmidi_status)
 #define SNDRV_RAWMIDI_IOCTL_DROP	_IOW('W', 0x30, int)
 #define SNDRV_RAWMIDI_IOCTL_DRAIN	_IOW('W', 0x31, int)
+#define SNDRV_RAWMIDI_IOCTL_SYNC_PTR	_IOW('W', 0x40, int)
+#define SNDRV_RAWMIDI_IOCTL_THRU	_IOW('W', 0x50, struct snd_rawmidi_thru)
 
 /*
  *  Timer section - /dev/snd/timer
  */
 
-#define SNDRV_TIMER_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 6)
+#define SNDRV_TIMER_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 7)
 
 enum {
 	SNDRV_TIMER_CLASS_NONE = -1,
@@ -805,13 +1024,38 @@ struct snd_timer_tread {
 	unsigned int val;
 };
 
+/*
+ * Event ring shared via mmap() of a timer file in tread mode (proto >= 2.0.7)
+ *
+ * The kernel stores events at events[tail % size] and advances tail;
+ * user-space consumes from events[head % size] and advances head.  Both
+ * indices run freely.  While the ring is mapped, read() is not available
+ * and ticks are not merged into the previous event.
+ */
+struct snd_timer_ring_event {
+	int event;
+	unsigned int val;
+	__s64 tstamp_sec;
+	__s64 tstamp_nsec;
+};
+
+struct snd_timer_mmap_ring {
+	__u32 head;			/* RW: written by user-space */
+	unsigned char pad1[60];
+	__u32 tail;			/* RO: written by the kernel */
+	__u32 size;			/* RO: number of events */
+	__u32 overrun;			/* RO: events lost due to a full ring */
+	unsigned char pad2[52];
+	struct snd_timer_ring_event events[0];
+};
+
 /****************************************************************************
  *                                                                          *
  *        Section for driver control interface - /dev/snd/control?          *
  *                                                                          *
  ****************************************************************************/
 
-#define SNDRV_CTL_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 7)
+#define SNDRV_CTL_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 9)
 
 struct snd_ctl_card_info {
 	int card;			/* card number */
@@ -948,6 +1192,13 @@ struct snd_ctl_elem_value {
 	unsigned char reserved[128-sizeof(struct timespec)];
 };
 
+/* vectored ELEM_READ/ELEM_WRITE (proto >= 2.0.8) */
+struct snd_ctl_elem_values {
+	unsigned int count;		/* W: number of entries in values */
+	unsigned int done;		/* R: number of entries processed */
+	struct snd_ctl_elem_value __user *values;
+};
+
 struct snd_ctl_tlv {
 	unsigned int numid;	/* control element numeric identification */
 	unsigned int length;	/* in bytes aligned to 4 */
@@ -969,6 +1220,9 @@ struct snd_ctl_tlv {
 #define SNDRV_CTL_IOCTL_TLV_READ	_IOWR('U', 0x1a, struct snd_ctl_tlv)
 #define SNDRV_CTL_IOCTL_TLV_WRITE	_IOWR('U', 0x1b, struct snd_ctl_tlv)
 #define SNDRV_CTL_IOCTL_TLV_COMMAND	_IOWR('U', 0x1c, struct snd_ctl_tlv)
+#define SNDRV_CTL_IOCTL_ELEM_READV	_IOWR('U', 0x1d, struct snd_ctl_elem_values)
+#define SNDRV_CTL_IOCTL_ELEM_WRITEV	_IOWR('U', 0x1e, struct snd_ctl_elem_values)
+#define SNDRV_CTL_IOCTL_EVENT_WINDOW	_IOW('U', 0x1f, unsigned int)
 #define SNDRV_CTL_IOCTL_HWDEP_NEXT_DEVICE _IOWR('U', 0x20, int)
 #define SNDRV_CTL_IOCTL_HWDEP_INFO	_IOR('U', 0x21, struct snd_hwdep_info)
 #define SNDRV_CTL_IOCTL_PCM_NEXT_DEVICE	_IOR('U', 0x30, int)
@@ -31,7 +31,7 @@
 #include <sound/compress_params.h>
 
 
-#define SNDRV_COMPRESS_VERSION SNDRV_PROTOCOL_VERSION(0, 1, 2)
+#define SNDRV_COMPRESS_VERSION SNDRV_PROTOCOL_VERSION(0, 1, 4)
 /**
  * struct snd_compressed_buffer - compressed buffer
  * @fragment_size: size of buffer fragment in bytes
@@ -83,6 +83,33 @@ struct snd_compr_avail {
 	struct snd_compr_tstamp tstamp;
 } __attribute__((packed, aligned(4)));
 
+/**
+ * struct snd_compr_mmap_status - stream status shared with the application
+ * @seq: odd while the kernel updates the page, read the fields until it is
+ *	even and unchanged around them
+ * @state: stream state, SNDRV_PCM_STATE_*
+ * @tstamp: last timestamp from the DSP
+ * @avail: bytes the application can write (playback) or read (capture)
+ * @app_total: total bytes written by (playback) or for (capture) the app
+ * @dsp_total: total bytes consumed (playback) or read (capture) by the app
+ *
+ * Mapped read-only at SNDRV_COMPRESS_MMAP_OFFSET_STATUS; refreshed on every
+ * fragment completion and compress operation.
+ */
+struct snd_compr_mmap_status {
+	__u32 seq;
+	__u32 state;
+	struct snd_compr_tstamp tstamp;
+	__u32 pad;
+	__u64 avail;
+	__u64 app_total;
+	__u64 dsp_total;
+} __attribute__((packed, aligned(4)));
+
+/* mmap offsets: the ring buffer at 0, the status page above it */
+#define SNDRV_COMPRESS_MMAP_OFFSET_DATA		0x00000000
+#define SNDRV_COMPRESS_MMAP_OFFSET_STATUS	0x80000000
+
 enum snd_compr_direction {
 	SND_COMPRESS_PLAYBACK = 0,
 	SND_COMPRESS_CAPTURE
@@ -154,6 +181,8 @@ struct snd_compr_metadata {
  * SNDRV_COMPRESS_TSTAMP: get the current timestamp value
  * SNDRV_COMPRESS_AVAIL: get the current buffer avail value.
  * This also queries the tstamp properties
+ * SNDRV_COMPRESS_ACK: in mmap mode, tell how many bytes the application
+ * wrote to (playback) or consumed from (capture) the mapped ring buffer
  * SNDRV_COMPRESS_PAUSE: Pause the running stream
  * SNDRV_COMPRESS_RESUME: resume a paused stream
  * SNDRV_COMPRESS_START: Start a stream
@@ -174,6 +203,7 @@ struct snd_compr_metadata {
 						 struct snd_compr_metadata)
 #define SNDRV_COMPRESS_TSTAMP		_IOR('C', 0x20, struct snd_compr_tstamp)
 #define SNDRV_COMPRESS_AVAIL		_IOR('C', 0x21, struct snd_compr_avail)
+#define SNDRV_COMPRESS_ACK		_IOW('C', 0x22, __u32)
 #define SNDRV_COMPRESS_PAUSE		_IO('C', 0x30)
 #define SNDRV_COMPRESS_RESUME		_IO('C', 0x31)
 #define SNDRV_COMPRESS_START		_IO('C', 0x32)
@@ -181,11 +211,6 @@ struct snd_compr_metadata {
 #define SNDRV_COMPRESS_DRAIN		_IO('C', 0x34)
 #define SNDRV_COMPRESS_NEXT_TRACK	_IO('C', 0x35)
 #define SNDRV_COMPRESS_PARTIAL_DRAIN	_IO('C', 0x36)
-/*
- * TODO
- * 1. add mmap support
- *
- */
 #define SND_COMPR_TRIGGER_DRAIN 7 /*FIXME move this to pcm.h */
 #define SND_COMPR_TRIGGER_NEXT_TRACK 8
 #define SND_COMPR_TRIGGER_PARTIAL_DRAIN 9
@@ -23,6 +23,7 @@
 #include <linux/types.h>
 
 #define HDSP_MATRIX_MIXER_SIZE 2048
+#define HDSP_MAX_CHANNELS 26
 
 enum HDSP_IO_Type {
 	Digiface,
@@ -99,6 +100,20 @@ struct hdsp_9632_aeb {
 
 #define SNDRV_HDSP_IOCTL_GET_9632_AEB _IOR('H', 0x45, struct hdsp_9632_aeb)
 
+/*
+ * Layout of the PCM buffer as mapped by mmap(), for all channels at once:
+ * the samples of channel n start at offset[n] bytes (-1 if the channel is
+ * not available at the current rate) and are step bits apart.  The same
+ * layout applies to playback and capture.
+ */
+struct hdsp_channel_map {
+	unsigned int channels;
+	unsigned int step;
+	int offset[HDSP_MAX_CHANNELS];
+};
+
+#define SNDRV_HDSP_IOCTL_GET_CHANNEL_MAP _IOR('H', 0x46, struct hdsp_channel_map)
+
 /* typedefs for compatibility to user-space */
 typedef enum HDSP_IO_Type HDSP_IO_Type;
 typedef struct hdsp_peak_rms hdsp_peak_rms_t;
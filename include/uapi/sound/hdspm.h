@@ -221,6 +221,23 @@ struct hdspm_mixer_ioctl {
 /* use indirect access due to the limit of ioctl bit size */
 #define SNDRV_HDSPM_IOCTL_GET_MIXER _IOR('H', 0x44, struct hdspm_mixer_ioctl)
 
+/*
+ * Layout of the PCM buffers as mapped by mmap(), for all channels at
+ * once: the samples of channel n start at offset_in[n] (capture) or
+ * offset_out[n] (playback) bytes, -1 if the channel is not available at
+ * the current rate, and are step bits apart.
+ */
+struct hdspm_channel_map {
+	unsigned int channels_in;
+	unsigned int channels_out;
+	unsigned int step;
+	int offset_in[HDSPM_MAX_CHANNELS];
+	int offset_out[HDSPM_MAX_CHANNELS];
+};
+
+#define SNDRV_HDSPM_IOCTL_GET_CHANNEL_MAP \
+	_IOR('H', 0x49, struct hdspm_channel_map)
+
 /* typedefs for compatibility to user-space */
 typedef struct hdspm_peak_rms hdspm_peak_rms_t;
 typedef struct hdspm_config_info hdspm_config_info_t;
@@ -74,4 +74,29 @@ enum usb_stream_state {
 	usb_stream_xrun,
 };
 
+/*
+ * Packet log of a snd-usb-audio substream, mapped read-only through the
+ * "USB Packets" hwdep device at page offset 2 * pcm device + direction.
+ * Each packet sent or received is recorded at packet[head % packets]
+ * before head is incremented; offset and length are bytes in the PCM
+ * buffer mmap'ed through the PCM device.  freqm follows the feedback
+ * of the device, in frames per packet, Q16.16.
+ */
+#define USB_AUDIO_PACKETS_VERSION 1
+
+struct usb_audio_packets {
+	unsigned version;
+	unsigned state;		/* stopped, ready or running */
+	unsigned rate;
+	unsigned frame_size;
+	unsigned buffer_bytes;
+	unsigned datainterval;	/* log2 of the packet interval in frames */
+	unsigned freqn;		/* nominal frames per packet, Q16.16 */
+	unsigned freqm;		/* current frames per packet, Q16.16 */
+	unsigned frame_number;	/* USB frame at the last update */
+	unsigned packets;
+	unsigned head;
+	struct usb_stream_packet packet[0];
+};
+
 #endif /* _UAPI__SOUND_USB_STREAM_H */
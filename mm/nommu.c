@@ -241,6 +241,7 @@ void *__vmalloc_node_flags(unsigned long size, int node, gfp_t flags)
 {
 	return __vmalloc(size, flags, PAGE_KERNEL);
 }
+EXPORT_SYMBOL_GPL(__vmalloc_node_flags);
 
 void *vmalloc_user(unsigned long size)
 {
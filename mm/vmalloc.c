@@ -1825,6 +1825,7 @@ void *__vmalloc_node_flags_caller(unsigned long size, int node, gfp_t flags,
 {
 	return __vmalloc_node(size, 1, flags, PAGE_KERNEL, node, caller);
 }
+EXPORT_SYMBOL_GPL(__vmalloc_node_flags_caller);
 
 /**
  *	vmalloc  -  allocate virtually contiguous memory
@@ -104,6 +104,52 @@ static void aaci_ac97_write(struct snd_ac97 *ac97, unsigned short reg,
 	mutex_unlock(&aaci->ac97_sem);
 }
 
+/*
+ * Write a sequence of AC'97 registers.  The codec is selected and the
+ * mutex taken only once for the whole sequence; each write still gets
+ * the same frame period delay and wait as in aaci_ac97_write().
+ */
+static void aaci_ac97_write_seq(struct snd_ac97 *ac97,
+				const struct snd_ac97_reg_seq *seq,
+				unsigned int count)
+{
+	struct aaci *aaci = ac97->private_data;
+	unsigned int i;
+	int timeout;
+	u32 v;
+
+	if (ac97->num >= 4)
+		return;
+
+	mutex_lock(&aaci->ac97_sem);
+
+	aaci_ac97_select_codec(aaci, ac97);
+
+	for (i = 0; i < count; i++) {
+		/* See aaci_ac97_write() for the order */
+		writel(seq[i].val << 4, aaci->base + AACI_SL2TX);
+		writel(seq[i].reg << 12, aaci->base + AACI_SL1TX);
+
+		/* Initially, wait one frame period */
+		udelay(FRAME_PERIOD_US);
+
+		/* And then wait an additional eight frame periods */
+		timeout = FRAME_PERIOD_US * 8;
+		do {
+			udelay(1);
+			v = readl(aaci->base + AACI_SLFR);
+		} while ((v & (SLFR_1TXB|SLFR_2TXB)) && --timeout);
+
+		if (v & (SLFR_1TXB|SLFR_2TXB)) {
+			dev_err(&aaci->dev->dev,
+				"timeout waiting for write to complete\n");
+			break;
+		}
+	}
+
+	mutex_unlock(&aaci->ac97_sem);
+}
+
 /*
  * Read an AC'97 register.
  */
@@ -830,6 +876,7 @@ static const struct ac97_pcm ac97_defs[] = {
 static struct snd_ac97_bus_ops aaci_bus_ops = {
 	.write	= aaci_ac97_write,
 	.read	= aaci_ac97_read,
+	.write_seq = aaci_ac97_write_seq,
 };
 
 static int aaci_probe_ac97(struct aaci *aaci)
@@ -37,6 +37,7 @@
 #include <linux/types.h>
 #include <linux/uio.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <linux/module.h>
 #include <linux/compat.h>
 #include <sound/core.h>
@@ -68,6 +69,7 @@ struct snd_compr_file {
 };
 
 static void error_delayed_work(struct work_struct *work);
+static void snd_compr_status_work(struct work_struct *work);
 
 /*
  * a note on stream states used:
@@ -82,7 +84,10 @@ static void error_delayed_work(struct work_struct *work);
  * SNDRV_PCM_STATE_RUNNING: When stream has been started and is
  *	decoding/encoding and rendering/capturing data.
  * SNDRV_PCM_STATE_DRAINING: When stream is draining current data. This is done
- *	by calling SNDRV_COMPRESS_DRAIN.
+ *	by calling SNDRV_COMPRESS_DRAIN.  A partial drain (gapless playback)
+ *	also passes through this state; the data of the next track can be
+ *	written meanwhile and the stream goes back to RUNNING once the
+ *	driver reports the end of the previous track.
  * SNDRV_PCM_STATE_PAUSED: When stream is paused. This is done by calling
  *	SNDRV_COMPRESS_PAUSE. It can be stopped or resumed by calling
  *	SNDRV_COMPRESS_STOP or SNDRV_COMPRESS_RESUME respectively.
@@ -127,6 +132,7 @@ static int snd_compr_open(struct inode *inode, struct file *f)
 	}
 
 	INIT_DELAYED_WORK(&data->stream.error_work, error_delayed_work);
+	INIT_WORK(&data->stream.status_work, snd_compr_status_work);
 
 	data->stream.ops = compr->ops;
 	data->stream.direction = dirn;
@@ -171,7 +177,9 @@ static int snd_compr_free(struct inode *inode, struct file *f)
 	}
 
 	data->stream.ops->free(&data->stream);
-	kfree(data->stream.runtime->buffer);
+	cancel_work_sync(&data->stream.status_work);
+	free_page((unsigned long)runtime->status);
+	vfree(data->stream.runtime->buffer);
 	kfree(data->stream.runtime);
 	kfree(data);
 	return 0;
@@ -235,6 +243,40 @@ static inline size_t snd_compr_get_avail(struct snd_compr_stream *stream)
 	return snd_compr_calc_avail(stream, &avail);
 }
 
+/* refresh the mapped status page, called with the device lock held */
+static void snd_compr_update_status(struct snd_compr_stream *stream)
+{
+	struct snd_compr_runtime *runtime = stream->runtime;
+	struct snd_compr_mmap_status *status = runtime->status;
+	struct snd_compr_avail avail;
+	size_t bytes;
+
+	if (!status)
+		return;
+
+	bytes = snd_compr_calc_avail(stream, &avail);
+
+	WRITE_ONCE(status->seq, status->seq + 1);
+	smp_wmb();
+	status->state = runtime->state;
+	status->tstamp = avail.tstamp;
+	status->avail = bytes;
+	status->app_total = runtime->total_bytes_available;
+	status->dsp_total = runtime->total_bytes_transferred;
+	smp_wmb();
+	WRITE_ONCE(status->seq, status->seq + 1);
+}
+
+static void snd_compr_status_work(struct work_struct *work)
+{
+	struct snd_compr_stream *stream =
+		container_of(work, struct snd_compr_stream, status_work);
+
+	mutex_lock(&stream->device->lock);
+	snd_compr_update_status(stream);
+	mutex_unlock(&stream->device->lock);
+}
+
 static int
 snd_compr_ioctl_avail(struct snd_compr_stream *stream, unsigned long arg)
 {
@@ -303,12 +345,18 @@ static ssize_t snd_compr_write(struct file *f, const char __user *buf,
 
 	stream = &data->stream;
 	mutex_lock(&stream->device->lock);
-	/* write is allowed when stream is running or has been steup */
+	/* write is allowed when stream is running or has been steup, and
+	 * while the previous track drains so the next one is queued in time
+	 */
 	switch (stream->runtime->state) {
 	case SNDRV_PCM_STATE_SETUP:
 	case SNDRV_PCM_STATE_PREPARED:
 	case SNDRV_PCM_STATE_RUNNING:
 		break;
+	case SNDRV_PCM_STATE_DRAINING:
+		if (stream->partial_drain)
+			break;
+		/* fall through */
 	default:
 		mutex_unlock(&stream->device->lock);
 		return -EBADFD;
@@ -336,6 +384,7 @@ static ssize_t snd_compr_write(struct file *f, const char __user *buf,
 		pr_debug("stream prepared, Houston we are good to go\n");
 	}
 
+	snd_compr_update_status(stream);
 	mutex_unlock(&stream->device->lock);
 	return retval;
 }
@@ -385,15 +434,119 @@ static ssize_t snd_compr_read(struct file *f, char __user *buf,
 	}
 	if (retval > 0)
 		stream->runtime->total_bytes_transferred += retval;
+	snd_compr_update_status(stream);
 
 out:
 	mutex_unlock(&stream->device->lock);
 	return retval;
 }
 
+/* the ring is mappable if the driver maps it or the core owns it */
+static bool snd_compr_can_mmap(struct snd_compr_stream *stream)
+{
+	return stream->ops->mmap || !stream->ops->copy;
+}
+
+static int snd_compr_mmap_status(struct snd_compr_stream *stream,
+				 struct vm_area_struct *vma)
+{
+	struct snd_compr_runtime *runtime = stream->runtime;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	if (!runtime->status) {
+		runtime->status = (void *)get_zeroed_page(GFP_KERNEL);
+		if (!runtime->status)
+			return -ENOMEM;
+		snd_compr_update_status(stream);
+	}
+
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(runtime->status) >> PAGE_SHIFT,
+			       PAGE_SIZE, vma->vm_page_prot);
+}
+
+/*
+ * mmap mode: the application maps the ring buffer, either the one the
+ * driver maps from DSP memory or the core's own, and moves its pointer
+ * with SNDRV_COMPRESS_ACK instead of handing the data over with write()
+ * or read().  The status page gives the other side's progress.
+ */
 static int snd_compr_mmap(struct file *f, struct vm_area_struct *vma)
 {
-	return -ENXIO;
+	struct snd_compr_file *data = f->private_data;
+	struct snd_compr_stream *stream;
+	unsigned long offset;
+	int retval;
+
+	if (snd_BUG_ON(!data))
+		return -EFAULT;
+
+	stream = &data->stream;
+	offset = vma->vm_pgoff << PAGE_SHIFT;
+
+	mutex_lock(&stream->device->lock);
+	if (offset == SNDRV_COMPRESS_MMAP_OFFSET_STATUS)
+		retval = snd_compr_mmap_status(stream, vma);
+	else if (!snd_compr_can_mmap(stream))
+		retval = -ENXIO;
+	/* the buffer only exists once the params are set */
+	else if (stream->runtime->state == SNDRV_PCM_STATE_OPEN)
+		retval = -EBADFD;
+	else if (stream->ops->mmap)
+		retval = stream->ops->mmap(stream, vma);
+	else
+		retval = remap_vmalloc_range(vma, stream->runtime->buffer,
+					     vma->vm_pgoff);
+	mutex_unlock(&stream->device->lock);
+
+	return retval;
+}
+
+static int snd_compr_ack(struct snd_compr_stream *stream, unsigned long arg)
+{
+	struct snd_compr_runtime *runtime = stream->runtime;
+	size_t avail;
+	__u32 bytes;
+
+	if (!snd_compr_can_mmap(stream))
+		return -ENXIO;
+	if (get_user(bytes, (__u32 __user *)arg))
+		return -EFAULT;
+
+	switch (runtime->state) {
+	case SNDRV_PCM_STATE_OPEN:
+	case SNDRV_PCM_STATE_SUSPENDED:
+	case SNDRV_PCM_STATE_DISCONNECTED:
+		return -EBADFD;
+	case SNDRV_PCM_STATE_XRUN:
+		return -EPIPE;
+	default:
+		break;
+	}
+
+	avail = snd_compr_get_avail(stream);
+	if (bytes > avail)
+		return -EINVAL;
+
+	if (stream->ops->ack)
+		stream->ops->ack(stream, bytes);
+
+	if (stream->direction == SND_COMPRESS_PLAYBACK) {
+		runtime->total_bytes_available += bytes;
+		/* as for write(), data before START prepares the stream */
+		if (runtime->state == SNDRV_PCM_STATE_SETUP)
+			runtime->state = SNDRV_PCM_STATE_PREPARED;
+	} else {
+		runtime->total_bytes_transferred += bytes;
+	}
+
+	return 0;
 }
 
 static inline int snd_compr_get_poll(struct snd_compr_stream *stream)
@@ -434,6 +587,12 @@ static unsigned int snd_compr_poll(struct file *f, poll_table *wait)
 	/* check if we have at least one fragment to fill */
 	switch (stream->runtime->state) {
 	case SNDRV_PCM_STATE_DRAINING:
+		/* a partial drain keeps playing, wait for room as usual */
+		if (stream->partial_drain) {
+			if (avail >= stream->runtime->fragment_size)
+				retval = snd_compr_get_poll(stream);
+			break;
+		}
 		/* stream has been woken up after drain is complete
 		 * draining done so set stream state to stopped
 		 */
@@ -514,7 +673,8 @@ static int snd_compr_allocate_buffer(struct snd_compr_stream *stream,
 		 * the data from core
 		 */
 	} else {
-		buffer = kmalloc(buffer_size, GFP_KERNEL);
+		/* vmalloc_user() so that it can be mapped by the application */
+		buffer = vmalloc_user(buffer_size);
 		if (!buffer)
 			return -ENOMEM;
 	}
@@ -710,6 +870,8 @@ static int snd_compr_stop(struct snd_compr_stream *stream)
 		return -EPERM;
 	retval = stream->ops->trigger(stream, SNDRV_PCM_TRIGGER_STOP);
 	if (!retval) {
+		/* stopped mid partial drain, there is no next track to play */
+		stream->partial_drain = false;
 		snd_compr_drain_notify(stream);
 		stream->runtime->total_bytes_available = 0;
 		stream->runtime->total_bytes_transferred = 0;
@@ -726,6 +888,7 @@ static void error_delayed_work(struct work_struct *work)
 	mutex_lock(&stream->device->lock);
 
 	stream->ops->trigger(stream, SNDRV_PCM_TRIGGER_STOP);
+	stream->partial_drain = false;
 	wake_up(&stream->runtime->sleep);
 
 	mutex_unlock(&stream->device->lock);
@@ -841,9 +1004,11 @@ static int snd_compr_partial_drain(struct snd_compr_stream *stream)
 	if (stream->next_track == false)
 		return -EPERM;
 
+	stream->partial_drain = true;
 	retval = stream->ops->trigger(stream, SND_COMPR_TRIGGER_PARTIAL_DRAIN);
 	if (retval) {
 		pr_debug("Partial drain returned failure\n");
+		stream->partial_drain = false;
 		wake_up(&stream->runtime->sleep);
 		return retval;
 	}
@@ -895,6 +1060,9 @@ static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	case _IOC_NR(SNDRV_COMPRESS_AVAIL):
 		retval = snd_compr_ioctl_avail(stream, arg);
 		break;
+	case _IOC_NR(SNDRV_COMPRESS_ACK):
+		retval = snd_compr_ack(stream, arg);
+		break;
 	case _IOC_NR(SNDRV_COMPRESS_PAUSE):
 		retval = snd_compr_pause(stream);
 		break;
@@ -918,6 +1086,7 @@ static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 		break;
 
 	}
+	snd_compr_update_status(stream);
 	mutex_unlock(&stream->device->lock);
 	return retval;
 }
@@ -24,8 +24,10 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <linux/time.h>
 #include <linux/sched/signal.h>
+#include <linux/jhash.h>
 #include <sound/core.h>
 #include <sound/minors.h>
 #include <sound/info.h>
@@ -46,6 +48,33 @@ static LIST_HEAD(snd_control_ioctls);
 static LIST_HEAD(snd_control_compat_ioctls);
 #endif
 
+/*
+ * With an event window, readers are woken once per window instead of for
+ * each queued event; called with ctl->read_lock held.
+ */
+static bool snd_ctl_events_ready(struct snd_ctl_file *ctl)
+{
+	return !list_empty(&ctl->events) &&
+		(!ctl->event_window || ctl->events_ready);
+}
+
+static void snd_ctl_event_timer(unsigned long data)
+{
+	struct snd_ctl_file *ctl = (struct snd_ctl_file *)data;
+	unsigned long flags;
+	bool wake;
+
+	spin_lock_irqsave(&ctl->read_lock, flags);
+	wake = !list_empty(&ctl->events);
+	if (wake) {
+		ctl->events_ready = true;
+		wake_up(&ctl->change_sleep);
+	}
+	spin_unlock_irqrestore(&ctl->read_lock, flags);
+	if (wake)
+		kill_fasync(&ctl->fasync, SIGIO, POLL_IN);
+}
+
 static int snd_ctl_open(struct inode *inode, struct file *file)
 {
 	unsigned long flags;
@@ -77,8 +106,11 @@ static int snd_ctl_open(struct inode *inode, struct file *file)
 		goto __error;
 	}
 	INIT_LIST_HEAD(&ctl->events);
+	hash_init(ctl->events_hash);
 	init_waitqueue_head(&ctl->change_sleep);
 	spin_lock_init(&ctl->read_lock);
+	setup_timer(&ctl->event_timer, snd_ctl_event_timer,
+		    (unsigned long)ctl);
 	ctl->card = card;
 	for (i = 0; i < SND_CTL_SUBDEV_ITEMS; i++)
 		ctl->preferred_subdevice[i] = -1;
@@ -109,8 +141,10 @@ static void snd_ctl_empty_read_queue(struct snd_ctl_file * ctl)
 	while (!list_empty(&ctl->events)) {
 		cread = snd_kctl_event(ctl->events.next);
 		list_del(&cread->list);
+		hash_del(&cread->hnode);
 		kfree(cread);
 	}
+	ctl->events_ready = false;
 	spin_unlock_irqrestore(&ctl->read_lock, flags);
 }
 
@@ -128,6 +162,7 @@ static int snd_ctl_release(struct inode *inode, struct file *file)
 	write_lock_irqsave(&card->ctl_files_rwlock, flags);
 	list_del(&ctl->list);
 	write_unlock_irqrestore(&card->ctl_files_rwlock, flags);
+	del_timer_sync(&ctl->event_timer);
 	down_write(&card->controls_rwsem);
 	list_for_each_entry(control, &card->controls, list)
 		for (idx = 0; idx < control->count; idx++)
@@ -149,8 +184,10 @@ static int snd_ctl_release(struct inode *inode, struct file *file)
  * @id: the ctl element id to send notification
  *
  * This function adds an event record with the given id and mask, appends
- * to the list and wakes up the user-space for notification.  This can be
- * called in the atomic context.
+ * to the list and wakes up the user-space for notification.  An event
+ * already queued for the same numid is merged instead, and with an event
+ * window set by the reader, the wakeup is deferred until the window ends.
+ * This can be called in the atomic context.
  */
 void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 		    struct snd_ctl_elem_id *id)
@@ -163,6 +200,7 @@ void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 		return;
 	if (card->shutdown)
 		return;
+	atomic_inc(&card->ctl_serial);
 	read_lock(&card->ctl_files_rwlock);
 #if IS_ENABLED(CONFIG_SND_MIXER_OSS)
 	card->mixer_oss_change_count++;
@@ -171,7 +209,7 @@ void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 		if (!ctl->subscribed)
 			continue;
 		spin_lock_irqsave(&ctl->read_lock, flags);
-		list_for_each_entry(ev, &ctl->events, list) {
+		hash_for_each_possible(ctl->events_hash, ev, hnode, id->numid) {
 			if (ev->id.numid == id->numid) {
 				ev->mask |= mask;
 				goto _found;
@@ -182,10 +220,19 @@ void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 			ev->id = *id;
 			ev->mask = mask;
 			list_add_tail(&ev->list, &ctl->events);
+			hash_add(ctl->events_hash, &ev->hnode, id->numid);
 		} else {
 			dev_err(card->dev, "No memory available to allocate event\n");
 		}
 	_found:
+		if (ctl->event_window) {
+			/* the readers are woken when the window ends */
+			if (!ctl->events_ready && !timer_pending(&ctl->event_timer))
+				mod_timer(&ctl->event_timer,
+					  jiffies + ctl->event_window);
+			spin_unlock_irqrestore(&ctl->read_lock, flags);
+			continue;
+		}
 		wake_up(&ctl->change_sleep);
 		spin_unlock_irqrestore(&ctl->read_lock, flags);
 		kill_fasync(&ctl->fasync, SIGIO, POLL_IN);
@@ -228,6 +275,8 @@ static int snd_ctl_new(struct snd_kcontrol **kctl, unsigned int count,
 		(*kctl)->vd[idx].owner = file;
 	}
 	(*kctl)->count = count;
+	spin_lock_init(&(*kctl)->cache_lock);
+	(*kctl)->cache_gen = 1;
 
 	return 0;
 }
@@ -266,7 +315,10 @@ struct snd_kcontrol *snd_ctl_new1(const struct snd_kcontrol_new *ncontrol,
 		   SNDRV_CTL_ELEM_ACCESS_INACTIVE |
 		   SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE |
 		   SNDRV_CTL_ELEM_ACCESS_TLV_COMMAND |
-		   SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK);
+		   SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK |
+		   SNDRV_CTL_ELEM_ACCESS_CACHED);
+	if (access & SNDRV_CTL_ELEM_ACCESS_VOLATILE)
+		access &= ~SNDRV_CTL_ELEM_ACCESS_CACHED;
 
 	err = snd_ctl_new(&kctl, count, access, NULL);
 	if (err < 0)
@@ -306,14 +358,64 @@ EXPORT_SYMBOL(snd_ctl_new1);
  */
 void snd_ctl_free_one(struct snd_kcontrol *kcontrol)
 {
+	unsigned int idx;
+
 	if (kcontrol) {
 		if (kcontrol->private_free)
 			kcontrol->private_free(kcontrol);
+		for (idx = 0; idx < kcontrol->count; idx++)
+			kfree(kcontrol->vd[idx].cache);
 		kfree(kcontrol);
 	}
 }
 EXPORT_SYMBOL(snd_ctl_free_one);
 
+/*
+ * The controls are indexed by a hash of the id without the index, so that
+ * all elements of a multi-element control are found via the same entry,
+ * and by each of their numids.  The ids of an added control must be only
+ * changed via snd_ctl_rename_id() or snd_ctl_rename().
+ */
+static u32 snd_ctl_id_hash(const struct snd_ctl_elem_id *id)
+{
+	u32 h = jhash(id->name, strnlen(id->name, sizeof(id->name)), 0);
+
+	return jhash_3words(id->iface, id->device, id->subdevice, h);
+}
+
+/* called with card->controls_rwsem held for writing */
+static void snd_ctl_lookup_add(struct snd_card *card,
+			       struct snd_kcontrol *kctl)
+{
+	unsigned int idx;
+
+	hash_add(card->ctl_hash, &kctl->hnode, snd_ctl_id_hash(&kctl->id));
+	if (card->ctl_numids_incomplete)
+		return;
+	for (idx = 0; idx < kctl->count; idx++) {
+		if (radix_tree_insert(&card->ctl_numids,
+				      kctl->id.numid + idx, kctl) < 0) {
+			/* fall back to the list walk from now on */
+			card->ctl_numids_incomplete = true;
+			return;
+		}
+	}
+}
+
+/* called with card->controls_rwsem held for writing */
+static void snd_ctl_lookup_remove(struct snd_card *card,
+				  struct snd_kcontrol *kctl)
+{
+	unsigned int idx;
+
+	hash_del(&kctl->hnode);
+	for (idx = 0; idx < kctl->count; idx++)
+		if (radix_tree_lookup(&card->ctl_numids,
+				      kctl->id.numid + idx) == kctl)
+			radix_tree_delete(&card->ctl_numids,
+					  kctl->id.numid + idx);
+}
+
 static bool snd_ctl_remove_numid_conflict(struct snd_card *card,
 					  unsigned int count)
 {
@@ -323,6 +425,18 @@ static bool snd_ctl_remove_numid_conflict(struct snd_card *card,
 	if (card->last_numid >= UINT_MAX - count)
 		card->last_numid = 0;
 
+	if (!card->ctl_numids_incomplete) {
+		if (!radix_tree_gang_lookup(&card->ctl_numids, (void **)&kctl,
+					    card->last_numid + 1, 1))
+			return false;
+		if (kctl->id.numid < card->last_numid + 1 + count &&
+		    kctl->id.numid + kctl->count > card->last_numid + 1) {
+			card->last_numid = kctl->id.numid + kctl->count - 1;
+			return true;
+		}
+		return false;
+	}
+
 	list_for_each_entry(kctl, &card->controls, list) {
 		if (kctl->id.numid < card->last_numid + 1 + count &&
 		    kctl->id.numid + kctl->count > card->last_numid + 1) {
@@ -397,6 +511,7 @@ int snd_ctl_add(struct snd_card *card, struct snd_kcontrol *kcontrol)
 	card->controls_count += kcontrol->count;
 	kcontrol->id.numid = card->last_numid + 1;
 	card->last_numid += kcontrol->count;
+	snd_ctl_lookup_add(card, kcontrol);
 	id = kcontrol->id;
 	count = kcontrol->count;
 	up_write(&card->controls_rwsem);
@@ -464,6 +579,7 @@ int snd_ctl_replace(struct snd_card *card, struct snd_kcontrol *kcontrol,
 	card->controls_count += kcontrol->count;
 	kcontrol->id.numid = card->last_numid + 1;
 	card->last_numid += kcontrol->count;
+	snd_ctl_lookup_add(card, kcontrol);
 	id = kcontrol->id;
 	count = kcontrol->count;
 	up_write(&card->controls_rwsem);
@@ -495,6 +611,7 @@ int snd_ctl_remove(struct snd_card *card, struct snd_kcontrol *kcontrol)
 
 	if (snd_BUG_ON(!card || !kcontrol))
 		return -EINVAL;
+	snd_ctl_lookup_remove(card, kcontrol);
 	list_del(&kcontrol->list);
 	card->controls_count -= kcontrol->count;
 	id = kcontrol->id;
@@ -643,14 +760,37 @@ int snd_ctl_rename_id(struct snd_card *card, struct snd_ctl_elem_id *src_id,
 		up_write(&card->controls_rwsem);
 		return -ENOENT;
 	}
+	snd_ctl_lookup_remove(card, kctl);
 	kctl->id = *dst_id;
 	kctl->id.numid = card->last_numid + 1;
 	card->last_numid += kctl->count;
+	snd_ctl_lookup_add(card, kctl);
 	up_write(&card->controls_rwsem);
 	return 0;
 }
 EXPORT_SYMBOL(snd_ctl_rename_id);
 
+/**
+ * snd_ctl_rename - rename the control on the card
+ * @card: the card instance
+ * @kctl: the control to rename
+ * @name: the new name
+ *
+ * Renames the given control already added to the card, keeping its numid.
+ * Drivers must use this instead of writing kctl->id.name directly, as the
+ * controls are looked up by a hash of their id.
+ */
+void snd_ctl_rename(struct snd_card *card, struct snd_kcontrol *kctl,
+		    const char *name)
+{
+	down_write(&card->controls_rwsem);
+	snd_ctl_lookup_remove(card, kctl);
+	strlcpy(kctl->id.name, name, sizeof(kctl->id.name));
+	snd_ctl_lookup_add(card, kctl);
+	up_write(&card->controls_rwsem);
+}
+EXPORT_SYMBOL(snd_ctl_rename);
+
 /**
  * snd_ctl_find_numid - find the control instance with the given number-id
  * @card: the card instance
@@ -670,6 +810,8 @@ struct snd_kcontrol *snd_ctl_find_numid(struct snd_card *card, unsigned int numi
 
 	if (snd_BUG_ON(!card || !numid))
 		return NULL;
+	if (!card->ctl_numids_incomplete)
+		return radix_tree_lookup(&card->ctl_numids, numid);
 	list_for_each_entry(kctl, &card->controls, list) {
 		if (kctl->id.numid <= numid && kctl->id.numid + kctl->count > numid)
 			return kctl;
@@ -700,7 +842,8 @@ struct snd_kcontrol *snd_ctl_find_id(struct snd_card *card,
 		return NULL;
 	if (id->numid != 0)
 		return snd_ctl_find_numid(card, id->numid);
-	list_for_each_entry(kctl, &card->controls, list) {
+	hash_for_each_possible(card->ctl_hash, kctl, hnode,
+			       snd_ctl_id_hash(id)) {
 		if (kctl->id.iface != id->iface)
 			continue;
 		if (kctl->id.device != id->device)
@@ -842,7 +985,7 @@ static int snd_ctl_elem_info(struct snd_ctl_file *ctl,
 		index_offset = snd_ctl_get_ioff(kctl, &info->id);
 		vd = &kctl->vd[index_offset];
 		snd_ctl_build_ioff(&info->id, kctl, index_offset);
-		info->access = vd->access;
+		info->access = vd->access & ~SNDRV_CTL_ELEM_ACCESS_CACHED;
 		if (vd->owner) {
 			info->access |= SNDRV_CTL_ELEM_ACCESS_LOCK;
 			if (vd->owner == ctl)
@@ -875,6 +1018,70 @@ static int snd_ctl_elem_info_user(struct snd_ctl_file *ctl,
 	return result;
 }
 
+/**
+ * snd_ctl_invalidate_cache - drop the cached values of a control
+ * @kcontrol: the control instance
+ *
+ * Must be called by the driver of a control with
+ * %SNDRV_CTL_ELEM_ACCESS_CACHED whenever its value is changed by other
+ * means than the put callback, typically along with snd_ctl_notify().
+ *
+ * This can be called in the atomic context.
+ */
+void snd_ctl_invalidate_cache(struct snd_kcontrol *kcontrol)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&kcontrol->cache_lock, flags);
+	kcontrol->cache_gen++;
+	spin_unlock_irqrestore(&kcontrol->cache_lock, flags);
+}
+EXPORT_SYMBOL_GPL(snd_ctl_invalidate_cache);
+
+/*
+ * read via the cache: on a miss, the value from the get callback is stored
+ * only if no invalidation happened meanwhile.  Readers run concurrently
+ * under controls_rwsem, hence the spinlock.
+ */
+static int snd_ctl_elem_get_cached(struct snd_kcontrol *kctl,
+				   struct snd_kcontrol_volatile *vd,
+				   struct snd_ctl_elem_value *control)
+{
+	unsigned long flags;
+	unsigned int gen;
+	void *cache;
+	int err;
+
+	spin_lock_irqsave(&kctl->cache_lock, flags);
+	gen = kctl->cache_gen;
+	if (vd->cache && vd->cache_gen == gen) {
+		memcpy(&control->value, vd->cache, sizeof(control->value));
+		spin_unlock_irqrestore(&kctl->cache_lock, flags);
+		return 0;
+	}
+	spin_unlock_irqrestore(&kctl->cache_lock, flags);
+
+	err = kctl->get(kctl, control);
+	if (err < 0)
+		return err;
+
+	cache = NULL;
+	if (!vd->cache)
+		cache = kmalloc(sizeof(control->value), GFP_KERNEL);
+	spin_lock_irqsave(&kctl->cache_lock, flags);
+	if (!vd->cache) {
+		vd->cache = cache;
+		cache = NULL;
+	}
+	if (vd->cache && kctl->cache_gen == gen) {
+		memcpy(vd->cache, &control->value, sizeof(control->value));
+		vd->cache_gen = gen;
+	}
+	spin_unlock_irqrestore(&kctl->cache_lock, flags);
+	kfree(cache);
+	return err;
+}
+
 static int snd_ctl_elem_read(struct snd_card *card,
 			     struct snd_ctl_elem_value *control)
 {
@@ -892,6 +1099,8 @@ static int snd_ctl_elem_read(struct snd_card *card,
 		return -EPERM;
 
 	snd_ctl_build_ioff(&control->id, kctl, index_offset);
+	if (vd->access & SNDRV_CTL_ELEM_ACCESS_CACHED)
+		return snd_ctl_elem_get_cached(kctl, vd, control);
 	return kctl->get(kctl, control);
 }
 
@@ -922,8 +1131,9 @@ static int snd_ctl_elem_read_user(struct snd_card *card,
 	return result;
 }
 
-static int snd_ctl_elem_write(struct snd_card *card, struct snd_ctl_file *file,
-			      struct snd_ctl_elem_value *control)
+/* write the value; returns a positive value if it was changed */
+static int snd_ctl_elem_put(struct snd_card *card, struct snd_ctl_file *file,
+			    struct snd_ctl_elem_value *control)
 {
 	struct snd_kcontrol *kctl;
 	struct snd_kcontrol_volatile *vd;
@@ -943,6 +1153,18 @@ static int snd_ctl_elem_write(struct snd_card *card, struct snd_ctl_file *file,
 
 	snd_ctl_build_ioff(&control->id, kctl, index_offset);
 	result = kctl->put(kctl, control);
+	/* put may adjust the value, so let the next read fetch it again */
+	if (vd->access & SNDRV_CTL_ELEM_ACCESS_CACHED)
+		snd_ctl_invalidate_cache(kctl);
+	return result;
+}
+
+static int snd_ctl_elem_write(struct snd_card *card, struct snd_ctl_file *file,
+			      struct snd_ctl_elem_value *control)
+{
+	int result;
+
+	result = snd_ctl_elem_put(card, file, control);
 	if (result < 0)
 		return result;
 
@@ -983,6 +1205,92 @@ static int snd_ctl_elem_write_user(struct snd_ctl_file *file,
 	return result;
 }
 
+/* upper limit of the entries of a vectored read or write */
+#define MAX_ELEM_VALUES		1024
+
+/*
+ * vectored ELEM_READ/ELEM_WRITE: all entries are handled under a single
+ * acquisition of controls_rwsem, and the change events of a write are
+ * sent together afterwards.  Processing stops at the first failing entry;
+ * its error is returned and done tells how many entries were completed.
+ */
+static int snd_ctl_elem_rw_values(struct snd_ctl_file *file,
+				  struct snd_ctl_elem_values __user *_values,
+				  bool write)
+{
+	struct snd_card *card = file->card;
+	struct snd_ctl_elem_values values;
+	struct snd_ctl_elem_value *buf;
+	unsigned long *changed = NULL;
+	unsigned int i;
+	int result = 0;
+
+	if (copy_from_user(&values, _values, sizeof(values)))
+		return -EFAULT;
+	if (values.count > MAX_ELEM_VALUES)
+		return -EINVAL;
+	values.done = 0;
+	if (!values.count)
+		goto out;
+
+	buf = kvmalloc_array(values.count, sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	if (write) {
+		changed = kcalloc(BITS_TO_LONGS(values.count),
+				  sizeof(*changed), GFP_KERNEL);
+		if (!changed) {
+			result = -ENOMEM;
+			goto error;
+		}
+	}
+	if (copy_from_user(buf, values.values,
+			   values.count * sizeof(*buf))) {
+		result = -EFAULT;
+		goto error;
+	}
+
+	result = snd_power_wait(card, SNDRV_CTL_POWER_D0);
+	if (result < 0)
+		goto error;
+
+	if (write) {
+		down_write(&card->controls_rwsem);
+		for (i = 0; i < values.count; i++) {
+			result = snd_ctl_elem_put(card, file, &buf[i]);
+			if (result < 0)
+				break;
+			if (result > 0)
+				__set_bit(i, changed);
+		}
+		up_write(&card->controls_rwsem);
+		for_each_set_bit(i, changed, values.count)
+			snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
+				       &buf[i].id);
+	} else {
+		down_read(&card->controls_rwsem);
+		for (i = 0; i < values.count; i++) {
+			result = snd_ctl_elem_read(card, &buf[i]);
+			if (result < 0)
+				break;
+		}
+		up_read(&card->controls_rwsem);
+	}
+	values.done = i;
+	if (result > 0)
+		result = 0;
+
+	if (copy_to_user(values.values, buf, values.done * sizeof(*buf)))
+		result = -EFAULT;
+ error:
+	kfree(changed);
+	kvfree(buf);
+ out:
+	if (put_user(values.done, &_values->done))
+		result = -EFAULT;
+	return result;
+}
+
 static int snd_ctl_elem_lock(struct snd_ctl_file *file,
 			     struct snd_ctl_elem_id __user *_id)
 {
@@ -1430,6 +1738,29 @@ static int snd_ctl_subscribe_events(struct snd_ctl_file *file, int __user *ptr)
 	return 0;
 }
 
+/* longest accepted event window, in microseconds */
+#define MAX_EVENT_WINDOW	1000000
+
+static int snd_ctl_set_event_window(struct snd_ctl_file *file,
+				    unsigned int __user *ptr)
+{
+	unsigned int usecs;
+
+	if (get_user(usecs, ptr))
+		return -EFAULT;
+	if (usecs > MAX_EVENT_WINDOW)
+		return -EINVAL;
+	spin_lock_irq(&file->read_lock);
+	file->event_window = usecs ? usecs_to_jiffies(usecs) : 0;
+	/* release the events held back so far */
+	if (!list_empty(&file->events)) {
+		file->events_ready = true;
+		wake_up(&file->change_sleep);
+	}
+	spin_unlock_irq(&file->read_lock);
+	return 0;
+}
+
 static int call_tlv_handler(struct snd_ctl_file *file, int op_flag,
 			    struct snd_kcontrol *kctl,
 			    struct snd_ctl_elem_id *id,
@@ -1559,6 +1890,10 @@ static long snd_ctl_ioctl(struct file *file, unsigned int cmd, unsigned long arg
 		return snd_ctl_elem_read_user(card, argp);
 	case SNDRV_CTL_IOCTL_ELEM_WRITE:
 		return snd_ctl_elem_write_user(ctl, argp);
+	case SNDRV_CTL_IOCTL_ELEM_READV:
+		return snd_ctl_elem_rw_values(ctl, argp, false);
+	case SNDRV_CTL_IOCTL_ELEM_WRITEV:
+		return snd_ctl_elem_rw_values(ctl, argp, true);
 	case SNDRV_CTL_IOCTL_ELEM_LOCK:
 		return snd_ctl_elem_lock(ctl, argp);
 	case SNDRV_CTL_IOCTL_ELEM_UNLOCK:
@@ -1571,6 +1906,8 @@ static long snd_ctl_ioctl(struct file *file, unsigned int cmd, unsigned long arg
 		return snd_ctl_elem_remove(ctl, argp);
 	case SNDRV_CTL_IOCTL_SUBSCRIBE_EVENTS:
 		return snd_ctl_subscribe_events(ctl, ip);
+	case SNDRV_CTL_IOCTL_EVENT_WINDOW:
+		return snd_ctl_set_event_window(ctl, argp);
 	case SNDRV_CTL_IOCTL_TLV_READ:
 		down_read(&ctl->card->controls_rwsem);
 		err = snd_ctl_tlv_ioctl(ctl, argp, SNDRV_CTL_TLV_OP_READ);
@@ -1612,6 +1949,9 @@ static ssize_t snd_ctl_read(struct file *file, char __user *buffer,
 			    size_t count, loff_t * offset)
 {
 	struct snd_ctl_file *ctl;
+	struct snd_ctl_event ev;
+	struct snd_kctl_event *kev, *next;
+	LIST_HEAD(batch);
 	int err = 0;
 	ssize_t result = 0;
 
@@ -1623,47 +1963,51 @@ static ssize_t snd_ctl_read(struct file *file, char __user *buffer,
 	if (count < sizeof(struct snd_ctl_event))
 		return -EINVAL;
 	spin_lock_irq(&ctl->read_lock);
-	while (count >= sizeof(struct snd_ctl_event)) {
-		struct snd_ctl_event ev;
-		struct snd_kctl_event *kev;
-		while (list_empty(&ctl->events)) {
-			wait_queue_entry_t wait;
-			if ((file->f_flags & O_NONBLOCK) != 0 || result > 0) {
-				err = -EAGAIN;
-				goto __end_lock;
-			}
-			init_waitqueue_entry(&wait, current);
-			add_wait_queue(&ctl->change_sleep, &wait);
-			set_current_state(TASK_INTERRUPTIBLE);
+	while (!snd_ctl_events_ready(ctl)) {
+		wait_queue_entry_t wait;
+		if ((file->f_flags & O_NONBLOCK) != 0) {
 			spin_unlock_irq(&ctl->read_lock);
-			schedule();
-			remove_wait_queue(&ctl->change_sleep, &wait);
-			if (ctl->card->shutdown)
-				return -ENODEV;
-			if (signal_pending(current))
-				return -ERESTARTSYS;
-			spin_lock_irq(&ctl->read_lock);
+			return -EAGAIN;
 		}
-		kev = snd_kctl_event(ctl->events.next);
-		ev.type = SNDRV_CTL_EVENT_ELEM;
-		ev.data.elem.mask = kev->mask;
-		ev.data.elem.id = kev->id;
-		list_del(&kev->list);
+		init_waitqueue_entry(&wait, current);
+		add_wait_queue(&ctl->change_sleep, &wait);
+		set_current_state(TASK_INTERRUPTIBLE);
 		spin_unlock_irq(&ctl->read_lock);
-		kfree(kev);
-		if (copy_to_user(buffer, &ev, sizeof(struct snd_ctl_event))) {
-			err = -EFAULT;
-			goto __end;
-		}
+		schedule();
+		remove_wait_queue(&ctl->change_sleep, &wait);
+		if (ctl->card->shutdown)
+			return -ENODEV;
+		if (signal_pending(current))
+			return -ERESTARTSYS;
 		spin_lock_irq(&ctl->read_lock);
-		buffer += sizeof(struct snd_ctl_event);
+	}
+	/* take all the events fitting into the buffer at once */
+	while (count >= sizeof(struct snd_ctl_event) &&
+	       !list_empty(&ctl->events)) {
+		kev = snd_kctl_event(ctl->events.next);
+		list_move_tail(&kev->list, &batch);
+		hash_del(&kev->hnode);
 		count -= sizeof(struct snd_ctl_event);
-		result += sizeof(struct snd_ctl_event);
 	}
-      __end_lock:
+	if (list_empty(&ctl->events))
+		ctl->events_ready = false;
 	spin_unlock_irq(&ctl->read_lock);
-      __end:
-      	return result > 0 ? result : err;
+
+	list_for_each_entry_safe(kev, next, &batch, list) {
+		if (!err) {
+			ev.type = SNDRV_CTL_EVENT_ELEM;
+			ev.data.elem.mask = kev->mask;
+			ev.data.elem.id = kev->id;
+			if (copy_to_user(buffer, &ev, sizeof(ev))) {
+				err = -EFAULT;
+			} else {
+				buffer += sizeof(ev);
+				result += sizeof(ev);
+			}
+		}
+		kfree(kev);
+	}
+	return result > 0 ? result : err;
 }
 
 static unsigned int snd_ctl_poll(struct file *file, poll_table * wait)
@@ -1677,8 +2021,10 @@ static unsigned int snd_ctl_poll(struct file *file, poll_table * wait)
 	poll_wait(file, &ctl->change_sleep, wait);
 
 	mask = 0;
-	if (!list_empty(&ctl->events))
+	spin_lock_irq(&ctl->read_lock);
+	if (snd_ctl_events_ready(ctl))
 		mask |= POLLIN | POLLRDNORM;
+	spin_unlock_irq(&ctl->read_lock);
 
 	return mask;
 }
@@ -23,6 +23,8 @@
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/hrtimer.h>
+#include <linux/irq_work.h>
+#include <linux/cpumask.h>
 #include <sound/core.h>
 #include <sound/timer.h>
 
@@ -35,12 +37,53 @@ MODULE_ALIAS("snd-timer-" __stringify(SNDRV_TIMER_GLOBAL_HRTIMER));
 #define NANO_SEC	1000000000UL	/* 10^9 in sec */
 static unsigned int resolution;
 
+static unsigned int slack;
+module_param(slack, uint, 0644);
+MODULE_PARM_DESC(slack, "Allowed hrtimer slack in nsec (0 = exact expiry).");
+static bool per_cpu;
+module_param(per_cpu, bool, 0444);
+MODULE_PARM_DESC(per_cpu, "Create an additional hrtimer pinned to each online CPU.");
+
+/*
+ * The timer of subdevice 0 runs wherever it was started, while subdevice
+ * N + 1 is pinned to CPU N.  The tick length is per timer (t->hw.resolution)
+ * and can be changed via the global timer params while the timer is unused.
+ */
 struct snd_hrtimer {
 	struct snd_timer *timer;
 	struct hrtimer hrt;
 	bool in_callback;
+	int cpu;			/* pinned CPU, or -1 */
+#ifdef CONFIG_SMP
+	struct irq_work start_work;	/* arms the hrtimer on the pinned CPU */
+#endif
 };
 
+/* call with t->lock */
+static void snd_hrtimer_arm(struct snd_hrtimer *stime)
+{
+	struct snd_timer *t = stime->timer;
+
+	hrtimer_start_range_ns(&stime->hrt,
+			       ns_to_ktime(t->sticks * t->hw.resolution), slack,
+			       stime->cpu >= 0 ? HRTIMER_MODE_REL_PINNED :
+			       HRTIMER_MODE_REL);
+}
+
+#ifdef CONFIG_SMP
+static void snd_hrtimer_start_work(struct irq_work *work)
+{
+	struct snd_hrtimer *stime =
+		container_of(work, struct snd_hrtimer, start_work);
+	struct snd_timer *t = stime->timer;
+
+	spin_lock(&t->lock);
+	if (t->running && !stime->in_callback)
+		snd_hrtimer_arm(stime);
+	spin_unlock(&t->lock);
+}
+#endif
+
 static enum hrtimer_restart snd_hrtimer_callback(struct hrtimer *hrt)
 {
 	struct snd_hrtimer *stime = container_of(hrt, struct snd_hrtimer, hrt);
@@ -59,13 +102,13 @@ static enum hrtimer_restart snd_hrtimer_callback(struct hrtimer *hrt)
 	/* calculate the drift */
 	delta = ktime_sub(hrt->base->get_time(), hrtimer_get_expires(hrt));
 	if (delta > 0)
-		ticks += ktime_divns(delta, ticks * resolution);
+		ticks += ktime_divns(delta, ticks * t->hw.resolution);
 
 	snd_timer_interrupt(stime->timer, ticks);
 
 	spin_lock(&t->lock);
 	if (t->running) {
-		hrtimer_add_expires_ns(hrt, t->sticks * resolution);
+		hrtimer_add_expires_ns(hrt, t->sticks * t->hw.resolution);
 		ret = HRTIMER_RESTART;
 	}
 
@@ -82,9 +125,15 @@ static int snd_hrtimer_open(struct snd_timer *t)
 	stime = kzalloc(sizeof(*stime), GFP_KERNEL);
 	if (!stime)
 		return -ENOMEM;
-	hrtimer_init(&stime->hrt, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	stime->cpu = t->tmr_subdevice - 1;
+	hrtimer_init(&stime->hrt, CLOCK_MONOTONIC,
+		     stime->cpu >= 0 ? HRTIMER_MODE_REL_PINNED :
+		     HRTIMER_MODE_REL);
 	stime->timer = t;
 	stime->hrt.function = snd_hrtimer_callback;
+#ifdef CONFIG_SMP
+	init_irq_work(&stime->start_work, snd_hrtimer_start_work);
+#endif
 	t->private_data = stime;
 	return 0;
 }
@@ -99,6 +148,9 @@ static int snd_hrtimer_close(struct snd_timer *t)
 		stime->in_callback = 1; /* skip start/stop */
 		spin_unlock_irq(&t->lock);
 
+#ifdef CONFIG_SMP
+		irq_work_sync(&stime->start_work);
+#endif
 		hrtimer_cancel(&stime->hrt);
 		kfree(stime);
 		t->private_data = NULL;
@@ -112,8 +164,15 @@ static int snd_hrtimer_start(struct snd_timer *t)
 
 	if (stime->in_callback)
 		return 0;
-	hrtimer_start(&stime->hrt, ns_to_ktime(t->sticks * resolution),
-		      HRTIMER_MODE_REL);
+#ifdef CONFIG_SMP
+	/* a pinned hrtimer is queued on the CPU arming it */
+	if (stime->cpu >= 0 && stime->cpu != smp_processor_id() &&
+	    cpu_online(stime->cpu)) {
+		irq_work_queue_on(&stime->start_work, stime->cpu);
+		return 0;
+	}
+#endif
+	snd_hrtimer_arm(stime);
 	return 0;
 }
 
@@ -127,12 +186,32 @@ static int snd_hrtimer_stop(struct snd_timer *t)
 	return 0;
 }
 
+/* set the tick length; period_num / period_den in seconds */
+static int snd_hrtimer_set_period(struct snd_timer *t,
+				  unsigned long period_num,
+				  unsigned long period_den)
+{
+	u64 nsec;
+
+	if (!period_num || !period_den)
+		return -EINVAL;
+	nsec = div_u64((u64)period_num * NANO_SEC, period_den);
+	if (nsec < resolution || nsec > NANO_SEC)
+		return -EINVAL;
+	spin_lock_irq(&t->lock);
+	t->hw.resolution = nsec;
+	t->hw.ticks = NANO_SEC / t->hw.resolution;
+	spin_unlock_irq(&t->lock);
+	return 0;
+}
+
 static struct snd_timer_hardware hrtimer_hw = {
 	.flags =	SNDRV_TIMER_HW_AUTO | SNDRV_TIMER_HW_TASKLET,
 	.open =		snd_hrtimer_open,
 	.close =	snd_hrtimer_close,
 	.start =	snd_hrtimer_start,
 	.stop =		snd_hrtimer_stop,
+	.set_period =	snd_hrtimer_set_period,
 };
 
 /*
@@ -140,14 +219,13 @@ static struct snd_timer_hardware hrtimer_hw = {
  */
 
 static struct snd_timer *mytimer;
+static struct snd_timer **cpu_timers;
 
-static int __init snd_hrtimer_init(void)
+static int __init snd_hrtimer_create(int cpu, struct snd_timer **rtimer)
 {
 	struct snd_timer *timer;
 	int err;
 
-	resolution = hrtimer_resolution;
-
 	/* Create a new timer and set up the fields */
 	err = snd_timer_global_new("hrtimer", SNDRV_TIMER_GLOBAL_HRTIMER,
 				   &timer);
@@ -155,9 +233,16 @@ static int __init snd_hrtimer_init(void)
 		return err;
 
 	timer->module = THIS_MODULE;
-	strcpy(timer->name, "HR timer");
+	if (cpu < 0) {
+		strcpy(timer->name, "HR timer");
+	} else {
+		timer->tmr_subdevice = cpu + 1;
+		sprintf(timer->name, "HR timer CPU%d", cpu);
+	}
 	timer->hw = hrtimer_hw;
 	timer->hw.resolution = resolution;
+	timer->hw.resolution_min = resolution;
+	timer->hw.resolution_max = NANO_SEC;
 	timer->hw.ticks = NANO_SEC / resolution;
 	timer->max_instances = 100; /* lower the limit */
 
@@ -166,18 +251,61 @@ static int __init snd_hrtimer_init(void)
 		snd_timer_global_free(timer);
 		return err;
 	}
-	mytimer = timer; /* remember this */
-
+	*rtimer = timer;
 	return 0;
 }
 
-static void __exit snd_hrtimer_exit(void)
+static void snd_hrtimer_free_all(void)
 {
+	int cpu;
+
+	if (cpu_timers) {
+		for_each_possible_cpu(cpu)
+			if (cpu_timers[cpu])
+				snd_timer_global_free(cpu_timers[cpu]);
+		kfree(cpu_timers);
+		cpu_timers = NULL;
+	}
 	if (mytimer) {
 		snd_timer_global_free(mytimer);
 		mytimer = NULL;
 	}
 }
 
+static int __init snd_hrtimer_init(void)
+{
+	int cpu, err;
+
+	resolution = hrtimer_resolution;
+
+	err = snd_hrtimer_create(-1, &mytimer);
+	if (err < 0)
+		return err;
+
+	if (!per_cpu)
+		return 0;
+	cpu_timers = kcalloc(nr_cpu_ids, sizeof(*cpu_timers), GFP_KERNEL);
+	if (!cpu_timers) {
+		err = -ENOMEM;
+		goto error;
+	}
+	/* a pinned hrtimer migrates along when its CPU goes offline */
+	for_each_online_cpu(cpu) {
+		err = snd_hrtimer_create(cpu, &cpu_timers[cpu]);
+		if (err < 0)
+			goto error;
+	}
+	return 0;
+
+ error:
+	snd_hrtimer_free_all();
+	return err;
+}
+
+static void __exit snd_hrtimer_exit(void)
+{
+	snd_hrtimer_free_all();
+}
+
 module_init(snd_hrtimer_init);
 module_exit(snd_hrtimer_exit);
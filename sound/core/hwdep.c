@@ -26,6 +26,8 @@
 #include <linux/mutex.h>
 #include <linux/module.h>
 #include <linux/sched/signal.h>
+#include <linux/mm.h>
+#include <linux/dma-mapping.h>
 #include <sound/core.h>
 #include <sound/control.h>
 #include <sound/minors.h>
@@ -169,6 +171,11 @@ static int snd_hwdep_release(struct inode *inode, struct file * file)
 		err = hw->ops.release(hw, file);
 	if (hw->used > 0)
 		hw->used--;
+	/* no file left, so no mapping of the image buffer either */
+	if (!hw->used && hw->dsp_buffer.area) {
+		snd_dma_free_pages(&hw->dsp_buffer);
+		hw->dsp_buffer.area = NULL;
+	}
 	mutex_unlock(&hw->open_mutex);
 	wake_up(&hw->open_wait);
 
@@ -210,6 +217,7 @@ static int snd_hwdep_dsp_status(struct snd_hwdep *hw,
 		return -ENXIO;
 	memset(&info, 0, sizeof(info));
 	info.dsp_loaded = hw->dsp_loaded;
+	info.buffer_bytes = hw->dsp_buffer_bytes;
 	if ((err = hw->ops.dsp_status(hw, &info)) < 0)
 		return err;
 	if (copy_to_user(_info, &info, sizeof(info)))
@@ -231,7 +239,11 @@ static int snd_hwdep_dsp_load(struct snd_hwdep *hw,
 	/* check whether the dsp was already loaded */
 	if (hw->dsp_loaded & (1 << info.index))
 		return -EBUSY;
-	if (!access_ok(VERIFY_READ, info.image, info.length))
+	if (!info.image) {
+		/* the image was written to the mapped buffer */
+		if (!hw->dsp_buffer.area || info.length > hw->dsp_buffer_bytes)
+			return -EINVAL;
+	} else if (!access_ok(VERIFY_READ, info.image, info.length))
 		return -EFAULT;
 	err = hw->ops.dsp_load(hw, &info);
 	if (err < 0)
@@ -260,9 +272,44 @@ static long snd_hwdep_ioctl(struct file * file, unsigned int cmd,
 	return -ENOTTY;
 }
 
+static int snd_hwdep_dsp_buffer_mmap(struct snd_hwdep *hw,
+				     struct vm_area_struct *area)
+{
+	size_t size = area->vm_end - area->vm_start;
+	struct snd_dma_buffer *dmab = &hw->dsp_buffer;
+	int err = 0;
+
+	if (size > PAGE_ALIGN(hw->dsp_buffer_bytes))
+		return -EINVAL;
+	mutex_lock(&hw->open_mutex);
+	if (!dmab->area)
+		err = snd_dma_alloc_pages(hw->dsp_buffer_type,
+					  hw->dsp_buffer_dev,
+					  PAGE_ALIGN(hw->dsp_buffer_bytes),
+					  dmab);
+	mutex_unlock(&hw->open_mutex);
+	if (err < 0)
+		return err;
+
+	area->vm_pgoff = 0;
+	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+#ifndef CONFIG_X86 /* for avoiding warnings arch/x86/mm/pat.c */
+	if (IS_ENABLED(CONFIG_HAS_DMA) &&
+	    dmab->dev.type == SNDRV_DMA_TYPE_DEV)
+		return dma_mmap_coherent(dmab->dev.dev, area, dmab->area,
+					 dmab->addr, size);
+#endif
+	return remap_pfn_range(area, area->vm_start,
+			       page_to_pfn(virt_to_page(dmab->area)),
+			       size, area->vm_page_prot);
+}
+
 static int snd_hwdep_mmap(struct file * file, struct vm_area_struct * vma)
 {
 	struct snd_hwdep *hw = file->private_data;
+	if (hw->dsp_buffer_bytes &&
+	    vma->vm_pgoff == SNDRV_HWDEP_MMAP_OFFSET_DSP >> PAGE_SHIFT)
+		return snd_hwdep_dsp_buffer_mmap(hw, vma);
 	if (hw->ops.mmap)
 		return hw->ops.mmap(hw, file, vma);
 	return -ENXIO;
@@ -408,6 +455,31 @@ int snd_hwdep_new(struct snd_card *card, char *id, int device,
 }
 EXPORT_SYMBOL(snd_hwdep_new);
 
+/**
+ * snd_hwdep_set_dsp_buffer - set up an mmap'able DSP image buffer
+ * @hw: the hwdep instance
+ * @type: the DMA buffer type, SNDRV_DMA_TYPE_XXX
+ * @dev: the device pointer for the buffer allocation
+ * @size: the buffer size in bytes
+ *
+ * Lets userspace map a buffer of @size bytes at SNDRV_HWDEP_MMAP_OFFSET_DSP,
+ * write a DSP image there and load it with a NULL image pointer, so that
+ * the driver gets the image in place instead of copying it from the user
+ * pointer.  The dsp_load callback finds such an image at
+ * hw->dsp_buffer.area (and hw->dsp_buffer.addr for the device types).
+ *
+ * The buffer is allocated at the first mmap and freed when the last file
+ * of the device is closed.
+ */
+void snd_hwdep_set_dsp_buffer(struct snd_hwdep *hw, int type,
+			      struct device *dev, size_t size)
+{
+	hw->dsp_buffer_type = type;
+	hw->dsp_buffer_dev = dev;
+	hw->dsp_buffer_bytes = size;
+}
+EXPORT_SYMBOL(snd_hwdep_set_dsp_buffer);
+
 static int snd_hwdep_dev_free(struct snd_device *device)
 {
 	struct snd_hwdep *hwdep = device->device_data;
@@ -29,6 +29,8 @@
 #include <linux/ctype.h>
 #include <linux/pm.h>
 #include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/interrupt.h>
 
 #include <sound/core.h>
 #include <sound/control.h>
@@ -51,6 +53,8 @@ static const struct file_operations snd_shutdown_f_ops;
 static DECLARE_BITMAP(snd_cards_lock, SNDRV_CARDS);
 struct snd_card *snd_cards[SNDRV_CARDS];
 EXPORT_SYMBOL(snd_cards);
+/* cards with their id taken, waiting for snd_card_register_async() */
+static struct snd_card *snd_cards_registering[SNDRV_CARDS];
 
 static DEFINE_MUTEX(snd_card_mutex);
 
@@ -249,9 +253,12 @@ int snd_card_new(struct device *parent, int idx, const char *xid,
 	init_rwsem(&card->controls_rwsem);
 	rwlock_init(&card->ctl_files_rwlock);
 	INIT_LIST_HEAD(&card->controls);
+	hash_init(card->ctl_hash);
+	INIT_RADIX_TREE(&card->ctl_numids, GFP_KERNEL);
 	INIT_LIST_HEAD(&card->ctl_files);
 	spin_lock_init(&card->files_lock);
 	INIT_LIST_HEAD(&card->files_list);
+	init_waitqueue_head(&card->async_wait);
 #ifdef CONFIG_PM
 	init_waitqueue_head(&card->power_sleep);
 #endif
@@ -265,6 +272,11 @@ int snd_card_new(struct device *parent, int idx, const char *xid,
 	err = kobject_set_name(&card->card_dev.kobj, "card%d", idx);
 	if (err < 0)
 		goto __error;
+	card->irq = -1;
+	if (!zalloc_cpumask_var(&card->cpus, GFP_KERNEL)) {
+		err = -ENOMEM;
+		goto __error;
+	}
 
 	snprintf(card->irq_descr, sizeof(card->irq_descr), "%s:%s",
 		 dev_driver_string(card->dev), dev_name(&card->card_dev));
@@ -380,24 +392,11 @@ static const struct file_operations snd_shutdown_f_ops =
 	.fasync =	snd_disconnect_fasync
 };
 
-/**
- *  snd_card_disconnect - disconnect all APIs from the file-operations (user space)
- *  @card: soundcard structure
- *
- *  Disconnects all APIs from the file-operations (user space).
- *
- *  Return: Zero, otherwise a negative error code.
- *
- *  Note: The current implementation replaces all active file->f_op with special
- *        dummy file operations (they do nothing except release).
- */
-int snd_card_disconnect(struct snd_card *card)
+/* snd_card_disconnect() without waiting for the card works */
+static int __snd_card_disconnect(struct snd_card *card)
 {
 	struct snd_monitor_file *mfile;
 
-	if (!card)
-		return -EINVAL;
-
 	spin_lock(&card->files_lock);
 	if (card->shutdown) {
 		spin_unlock(&card->files_lock);
@@ -409,6 +408,7 @@ int snd_card_disconnect(struct snd_card *card)
 	/* phase 1: disable fops (user space) operations for ALSA API */
 	mutex_lock(&snd_card_mutex);
 	snd_cards[card->number] = NULL;
+	snd_cards_registering[card->number] = NULL;
 	clear_bit(card->number, snd_cards_lock);
 	mutex_unlock(&snd_card_mutex);
 	
@@ -450,6 +450,26 @@ int snd_card_disconnect(struct snd_card *card)
 #endif
 	return 0;	
 }
+
+/**
+ *  snd_card_disconnect - disconnect all APIs from the file-operations (user space)
+ *  @card: soundcard structure
+ *
+ *  Disconnects all APIs from the file-operations (user space).
+ *
+ *  Return: Zero, otherwise a negative error code.
+ *
+ *  Note: The current implementation replaces all active file->f_op with special
+ *        dummy file operations (they do nothing except release).
+ */
+int snd_card_disconnect(struct snd_card *card)
+{
+	if (!card)
+		return -EINVAL;
+
+	snd_card_async_synchronize(card);
+	return __snd_card_disconnect(card);
+}
 EXPORT_SYMBOL(snd_card_disconnect);
 
 static int snd_card_do_free(struct snd_card *card)
@@ -468,6 +488,7 @@ static int snd_card_do_free(struct snd_card *card)
 	}
 	if (card->release_completion)
 		complete(card->release_completion);
+	free_cpumask_var(card->cpus);
 	kfree(card);
 	return 0;
 }
@@ -540,8 +561,9 @@ static bool card_id_ok(struct snd_card *card, const char *id)
 	if (!snd_info_check_reserved_words(id))
 		return false;
 	for (i = 0; i < snd_ecards_limit; i++) {
-		if (snd_cards[i] && snd_cards[i] != card &&
-		    !strcmp(snd_cards[i]->id, id))
+		struct snd_card *c = snd_cards[i] ? : snd_cards_registering[i];
+
+		if (c && c != card && !strcmp(c->id, id))
 			return false;
 	}
 	return true;
@@ -685,9 +707,123 @@ card_number_show_attr(struct device *dev,
 
 static DEVICE_ATTR(number, S_IRUGO, card_number_show_attr, NULL);
 
+/*
+ * The "cpus" attribute holds a CPU list for the work of the card: the
+ * interrupt given to snd_card_set_irq(), the deferred works queued on
+ * snd_card_cpu() and the threads passed to snd_card_bind_task().  An
+ * empty list, the default, leaves them to the scheduler.  The mask is
+ * updated under snd_card_mutex and read locklessly: a reader racing
+ * with an update picks a CPU of either the old or the new set.
+ */
+static void card_apply_irq_affinity(struct snd_card *card)
+{
+	if (card->irq < 0)
+		return;
+	if (cpumask_empty(card->cpus))
+		irq_set_affinity_hint(card->irq, NULL);
+	else
+		irq_set_affinity_hint(card->irq, card->cpus);
+}
+
+static ssize_t
+card_cpus_show_attr(struct device *dev,
+		    struct device_attribute *attr, char *buf)
+{
+	struct snd_card *card = container_of(dev, struct snd_card, card_dev);
+	return snprintf(buf, PAGE_SIZE, "%*pbl\n", cpumask_pr_args(card->cpus));
+}
+
+static ssize_t
+card_cpus_store_attr(struct device *dev, struct device_attribute *attr,
+		     const char *buf, size_t count)
+{
+	struct snd_card *card = container_of(dev, struct snd_card, card_dev);
+	cpumask_var_t mask;
+	int err;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+	err = cpulist_parse(buf, mask);
+	if (!err && !cpumask_subset(mask, cpu_possible_mask))
+		err = -EINVAL;
+	if (!err) {
+		mutex_lock(&snd_card_mutex);
+		cpumask_copy(card->cpus, mask);
+		card_apply_irq_affinity(card);
+		mutex_unlock(&snd_card_mutex);
+	}
+	free_cpumask_var(mask);
+	return err ? err : count;
+}
+
+static DEVICE_ATTR(cpus, S_IRUGO | S_IWUSR, card_cpus_show_attr,
+		   card_cpus_store_attr);
+
+/**
+ * snd_card_set_irq - steer an interrupt with the card CPU list
+ * @card: card instance
+ * @irq: the interrupt of the card, or -1 to release the current one
+ *
+ * The interrupt follows the "cpus" attribute of the card from now on.
+ * Drivers must release it before free_irq(), which warns about an
+ * interrupt freed with an affinity hint.
+ */
+void snd_card_set_irq(struct snd_card *card, int irq)
+{
+	mutex_lock(&snd_card_mutex);
+	if (card->irq >= 0)
+		irq_set_affinity_hint(card->irq, NULL);
+	card->irq = irq;
+	if (!cpumask_empty(card->cpus))
+		card_apply_irq_affinity(card);
+	mutex_unlock(&snd_card_mutex);
+}
+EXPORT_SYMBOL_GPL(snd_card_set_irq);
+
+/**
+ * snd_card_cpu - the CPU for a deferred work of the card
+ * @card: card instance
+ *
+ * Return: %WORK_CPU_UNBOUND, i.e. the local CPU, when the list is empty
+ * or contains the current CPU, an online CPU of the list otherwise; to be
+ * passed to queue_work_on().
+ */
+int snd_card_cpu(struct snd_card *card)
+{
+	int cpu = raw_smp_processor_id();
+
+	if (cpumask_empty(card->cpus) || cpumask_test_cpu(cpu, card->cpus))
+		return WORK_CPU_UNBOUND;
+	cpu = cpumask_any_and(card->cpus, cpu_online_mask);
+	return cpu < nr_cpu_ids ? cpu : WORK_CPU_UNBOUND;
+}
+EXPORT_SYMBOL_GPL(snd_card_cpu);
+
+/**
+ * snd_card_bind_task - restrict a kernel thread to the card CPU list
+ * @card: card instance
+ * @task: the thread working for the card
+ * @cpus: the CPUs of the thread while the list is empty, or NULL
+ *
+ * While the list is empty, the thread goes back to @cpus, or is left as
+ * it is if that's NULL.  Call from process context, e.g. when the stream
+ * the thread serves is prepared, so that a change of the list is picked
+ * up at the next stream start.
+ */
+void snd_card_bind_task(struct snd_card *card, struct task_struct *task,
+			const struct cpumask *cpus)
+{
+	if (!cpumask_empty(card->cpus))
+		set_cpus_allowed_ptr(task, card->cpus);
+	else if (cpus)
+		set_cpus_allowed_ptr(task, cpus);
+}
+EXPORT_SYMBOL_GPL(snd_card_bind_task);
+
 static struct attribute *card_dev_attrs[] = {
 	&dev_attr_id.attr,
 	&dev_attr_number.attr,
+	&dev_attr_cpus.attr,
 	NULL
 };
 
@@ -718,23 +854,96 @@ int snd_card_add_dev_attr(struct snd_card *card,
 }
 EXPORT_SYMBOL_GPL(snd_card_add_dev_attr);
 
+static void snd_card_async_work(struct work_struct *work)
+{
+	struct snd_card_work *cwork =
+		container_of(work, struct snd_card_work, work);
+	struct snd_card *card = cwork->card;
+
+	cwork->func(cwork);
+	/* complete in the scheduling order even if func() didn't wait */
+	snd_card_async_wait_turn(cwork);
+	smp_store_release(&card->async_done, cwork->seq + 1);
+	wake_up_all(&card->async_wait);
+}
+
 /**
- *  snd_card_register - register the soundcard
- *  @card: soundcard structure
+ * snd_card_async_schedule - run a part of the card setup in parallel
+ * @card: soundcard structure
+ * @cwork: the work item, kept valid until snd_card_async_synchronize()
+ * @func: the setup function
  *
- *  This function registers all the devices assigned to the soundcard.
- *  Until calling this, the ALSA control interface is blocked from the
- *  external accesses.  Thus, you should call this function at the end
- *  of the initialization of the card.
+ * Queues @func to be called from a workqueue, so that independent parts
+ * of a card (e.g. codecs on a bus) can be probed concurrently.  The works
+ * complete in the order they were scheduled.  Since the device list of
+ * the card isn't locked, @func must not create card devices (PCMs,
+ * controls, jacks, ...) before calling snd_card_async_wait_turn(); this
+ * also keeps the device numbers identical to a serial probe.
  *
- *  Return: Zero otherwise a negative error code if the registration failed.
+ * Must be called from the probe context only, not from another work.
  */
-int snd_card_register(struct snd_card *card)
+void snd_card_async_schedule(struct snd_card *card,
+			     struct snd_card_work *cwork,
+			     void (*func)(struct snd_card_work *cwork))
 {
-	int err;
+	INIT_WORK(&cwork->work, snd_card_async_work);
+	cwork->card = card;
+	cwork->func = func;
+	cwork->seq = card->async_scheduled++;
+	queue_work(system_unbound_wq, &cwork->work);
+}
+EXPORT_SYMBOL_GPL(snd_card_async_schedule);
 
-	if (snd_BUG_ON(!card))
-		return -EINVAL;
+/**
+ * snd_card_async_wait_turn - wait until the preceding works are finished
+ * @cwork: the work item being executed
+ *
+ * Enters the ordered part of the work: returns once all works scheduled
+ * before @cwork on the same card have completed.
+ */
+void snd_card_async_wait_turn(struct snd_card_work *cwork)
+{
+	struct snd_card *card = cwork->card;
+
+	wait_event(card->async_wait,
+		   smp_load_acquire(&card->async_done) == cwork->seq);
+}
+EXPORT_SYMBOL_GPL(snd_card_async_wait_turn);
+
+/**
+ * snd_card_async_synchronize - wait for all works scheduled on the card
+ * @card: soundcard structure
+ *
+ * Called implicitly by snd_card_register() and snd_card_disconnect().
+ */
+void snd_card_async_synchronize(struct snd_card *card)
+{
+	wait_event(card->async_wait,
+		   smp_load_acquire(&card->async_done) ==
+		   card->async_scheduled);
+}
+EXPORT_SYMBOL_GPL(snd_card_async_synchronize);
+
+/* give the card a unique id; called with snd_card_mutex held */
+static void snd_card_assign_id(struct snd_card *card)
+{
+	if (*card->id) {
+		/* make a unique id name from the given string */
+		char tmpid[sizeof(card->id)];
+		memcpy(tmpid, card->id, sizeof(card->id));
+		snd_card_set_id_no_lock(card, tmpid, tmpid);
+	} else {
+		/* create an id from either shortname or longname */
+		const char *src;
+		src = *card->shortname ? card->shortname : card->longname;
+		snd_card_set_id_no_lock(card, src,
+					retrieve_id_from_card_name(src));
+	}
+}
+
+static int __snd_card_register(struct snd_card *card)
+{
+	int err;
 
 	if (!card->registered) {
 		err = device_add(&card->card_dev);
@@ -751,19 +960,9 @@ int snd_card_register(struct snd_card *card)
 		mutex_unlock(&snd_card_mutex);
 		return snd_info_card_register(card); /* register pending info */
 	}
-	if (*card->id) {
-		/* make a unique id name from the given string */
-		char tmpid[sizeof(card->id)];
-		memcpy(tmpid, card->id, sizeof(card->id));
-		snd_card_set_id_no_lock(card, tmpid, tmpid);
-	} else {
-		/* create an id from either shortname or longname */
-		const char *src;
-		src = *card->shortname ? card->shortname : card->longname;
-		snd_card_set_id_no_lock(card, src,
-					retrieve_id_from_card_name(src));
-	}
+	snd_card_assign_id(card);
 	snd_cards[card->number] = card;
+	snd_cards_registering[card->number] = NULL;
 	mutex_unlock(&snd_card_mutex);
 	init_info_for_card(card);
 #if IS_ENABLED(CONFIG_SND_MIXER_OSS)
@@ -772,8 +971,111 @@ int snd_card_register(struct snd_card *card)
 #endif
 	return 0;
 }
+
+/* the error of the last snd_card_register_async(), cleared once taken */
+static int snd_card_async_register_error(struct snd_card *card)
+{
+	int err = card->register_err;
+
+	card->register_err = 0;
+	return err;
+}
+
+/**
+ *  snd_card_register - register the soundcard
+ *  @card: soundcard structure
+ *
+ *  This function registers all the devices assigned to the soundcard.
+ *  Until calling this, the ALSA control interface is blocked from the
+ *  external accesses.  Thus, you should call this function at the end
+ *  of the initialization of the card.
+ *
+ *  Return: Zero otherwise a negative error code if the registration failed.
+ */
+int snd_card_register(struct snd_card *card)
+{
+	int err;
+
+	if (snd_BUG_ON(!card))
+		return -EINVAL;
+
+	/* all devices must be present before the registration */
+	snd_card_async_synchronize(card);
+
+	err = snd_card_async_register_error(card);
+	if (err < 0)
+		return err;
+	return __snd_card_register(card);
+}
 EXPORT_SYMBOL(snd_card_register);
 
+static void snd_card_register_work(struct snd_card_work *cwork)
+{
+	struct snd_card *card = cwork->card;
+	int err;
+
+	/* after the setup works scheduled before */
+	snd_card_async_wait_turn(cwork);
+	err = __snd_card_register(card);
+	if (err < 0) {
+		dev_err(card->dev, "card registration failed: %d\n", err);
+		/* don't leave the devices registered so far usable, as if
+		 * the driver had freed the card on a synchronous failure
+		 */
+		__snd_card_disconnect(card);
+	}
+	/* published to the waiters by snd_card_async_synchronize() */
+	card->register_err = err;
+}
+
+/**
+ *  snd_card_register_async - register the soundcard in the background
+ *  @card: soundcard structure
+ *
+ *  Like snd_card_register(), but the device registration (device nodes,
+ *  sysfs, proc) is done from a workqueue, so that the registration of
+ *  several cards at boot runs in parallel and the probe can return early.
+ *
+ *  The card index was already fixed by snd_card_new(), and the card id is
+ *  assigned here, so both are the same as with a serial registration.  The
+ *  card is visible to userspace once the work has finished;
+ *  snd_card_register(), snd_card_disconnect() and snd_card_free() wait
+ *  for it.  On a registration error, the error is logged and the card is
+ *  disconnected, so that userspace never sees a partly registered card;
+ *  the driver still frees it as usual.  The error is also returned by the
+ *  next snd_card_register() or snd_card_register_async() call on the card.
+ *
+ *  Must be called from the probe context, like snd_card_async_schedule().
+ *
+ *  Return: Zero, or a negative error code.
+ */
+int snd_card_register_async(struct snd_card *card)
+{
+	int err;
+
+	if (snd_BUG_ON(!card))
+		return -EINVAL;
+
+	/* the setup works and a previous registration must be done */
+	snd_card_async_synchronize(card);
+
+	err = snd_card_async_register_error(card);
+	if (err < 0)
+		return err;
+
+	mutex_lock(&snd_card_mutex);
+	if (!snd_cards[card->number]) {
+		snd_card_assign_id(card);
+		snd_cards_registering[card->number] = card;
+	}
+	mutex_unlock(&snd_card_mutex);
+
+	snd_card_async_schedule(card, &card->register_work,
+				snd_card_register_work);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_card_register_async);
+
 #ifdef CONFIG_SND_PROC_FS
 static void snd_card_info_read(struct snd_info_entry *entry,
 			       struct snd_info_buffer *buffer)
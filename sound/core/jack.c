@@ -33,6 +33,10 @@ struct snd_jack_kctl {
 };
 
 #ifdef CONFIG_SND_JACK_INPUT_DEV
+static bool jack_input_dev = true;
+module_param(jack_input_dev, bool, 0444);
+MODULE_PARM_DESC(jack_input_dev, "Report jacks also via input devices, not only via the jack controls.");
+
 static int jack_switch_types[SND_JACK_SWITCH_TYPES] = {
 	SW_HEADPHONE_INSERT,
 	SW_MICROPHONE_INSERT,
@@ -235,9 +239,9 @@ int snd_jack_new(struct snd_card *card, const char *id, int type,
 
 	jack->id = kstrdup(id, GFP_KERNEL);
 
-	/* don't creat input device for phantom jack */
-	if (!phantom_jack) {
 #ifdef CONFIG_SND_JACK_INPUT_DEV
+	/* don't creat input device for phantom jack */
+	if (!phantom_jack && jack_input_dev) {
 		int i;
 
 		jack->input_dev = input_allocate_device();
@@ -254,9 +258,8 @@ int snd_jack_new(struct snd_card *card, const char *id, int type,
 			if (type & (1 << i))
 				input_set_capability(jack->input_dev, EV_SW,
 						     jack_switch_types[i]);
-
-#endif /* CONFIG_SND_JACK_INPUT_DEV */
 	}
+#endif /* CONFIG_SND_JACK_INPUT_DEV */
 
 	err = snd_device_new(card, SNDRV_DEV_JACK, jack, &ops);
 	if (err < 0)
@@ -350,6 +353,9 @@ EXPORT_SYMBOL(snd_jack_set_key);
  *
  * @jack:   The jack to report status for
  * @status: The current status of the jack
+ *
+ * Reports of an unchanged status are dropped, so the drivers polling the
+ * jacks don't need to filter them.
  */
 void snd_jack_report(struct snd_jack *jack, int status)
 {
@@ -360,6 +366,10 @@ void snd_jack_report(struct snd_jack *jack, int status)
 
 	if (!jack)
 		return;
+	if (jack->reported && jack->status == status)
+		return;
+	jack->status = status;
+	jack->reported = true;
 
 	list_for_each_entry(jack_kctl, &jack->kctl_list, list)
 		snd_kctl_jack_report(jack->card, jack_kctl->kctl,
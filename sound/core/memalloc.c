@@ -25,6 +25,9 @@
 #include <linux/mm.h>
 #include <linux/dma-mapping.h>
 #include <linux/genalloc.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
 #include <sound/memalloc.h>
 
 /*
@@ -44,17 +47,34 @@
  */
 void *snd_malloc_pages(size_t size, gfp_t gfp_flags)
 {
-	int pg;
+	return snd_malloc_pages_node(size, gfp_flags, NUMA_NO_NODE);
+}
+EXPORT_SYMBOL(snd_malloc_pages);
+
+/**
+ * snd_malloc_pages_node - allocate pages with the given size on a node
+ * @size: the size to allocate in bytes
+ * @gfp_flags: the allocation conditions, GFP_XXX
+ * @nid: the preferred memory node, or %NUMA_NO_NODE
+ *
+ * Like snd_malloc_pages(), but prefers the memory of the given node.
+ *
+ * Return: The pointer of the buffer, or %NULL if no enough memory.
+ */
+void *snd_malloc_pages_node(size_t size, gfp_t gfp_flags, int nid)
+{
+	struct page *page;
 
 	if (WARN_ON(!size))
 		return NULL;
 	if (WARN_ON(!gfp_flags))
 		return NULL;
 	gfp_flags |= __GFP_COMP;	/* compound page lets parts be mapped */
-	pg = get_order(size);
-	return (void *) __get_free_pages(gfp_flags, pg);
+	page = alloc_pages_node(nid, gfp_flags & ~__GFP_HIGHMEM,
+				get_order(size));
+	return page ? page_address(page) : NULL;
 }
-EXPORT_SYMBOL(snd_malloc_pages);
+EXPORT_SYMBOL(snd_malloc_pages_node);
 
 /**
  * snd_free_pages - release the pages
@@ -173,6 +193,28 @@ static void snd_free_dev_iram(struct snd_dma_buffer *dmab)
  */
 int snd_dma_alloc_pages(int type, struct device *device, size_t size,
 			struct snd_dma_buffer *dmab)
+{
+	return snd_dma_alloc_pages_node(type, device, size, dmab, NUMA_NO_NODE);
+}
+EXPORT_SYMBOL(snd_dma_alloc_pages);
+
+/**
+ * snd_dma_alloc_pages_node - allocate the buffer area on the given node
+ * @type: the DMA buffer type
+ * @device: the device pointer
+ * @size: the buffer size to allocate
+ * @dmab: buffer allocation record to store the allocated data
+ * @nid: the preferred memory node, or %NUMA_NO_NODE
+ *
+ * Like snd_dma_alloc_pages().  The node is used for the buffer types that
+ * carry no device of their own, i.e. %SNDRV_DMA_TYPE_CONTINUOUS; the
+ * device types already allocate from the node of the device.
+ *
+ * Return: Zero if the buffer with the given size is allocated successfully,
+ * otherwise a negative value on error.
+ */
+int snd_dma_alloc_pages_node(int type, struct device *device, size_t size,
+			     struct snd_dma_buffer *dmab, int nid)
 {
 	if (WARN_ON(!size))
 		return -ENXIO;
@@ -184,8 +226,9 @@ int snd_dma_alloc_pages(int type, struct device *device, size_t size,
 	dmab->bytes = 0;
 	switch (type) {
 	case SNDRV_DMA_TYPE_CONTINUOUS:
-		dmab->area = snd_malloc_pages(size,
-					(__force gfp_t)(unsigned long)device);
+		dmab->area = snd_malloc_pages_node(size,
+					(__force gfp_t)(unsigned long)device,
+					nid);
 		dmab->addr = 0;
 		break;
 #ifdef CONFIG_HAS_DMA
@@ -219,7 +262,7 @@ int snd_dma_alloc_pages(int type, struct device *device, size_t size,
 	dmab->bytes = size;
 	return 0;
 }
-EXPORT_SYMBOL(snd_dma_alloc_pages);
+EXPORT_SYMBOL(snd_dma_alloc_pages_node);
 
 /**
  * snd_dma_alloc_pages_fallback - allocate the buffer area according to the given type with fallback
@@ -292,3 +335,226 @@ void snd_dma_free_pages(struct snd_dma_buffer *dmab)
 	}
 }
 EXPORT_SYMBOL(snd_dma_free_pages);
+
+/*
+ *
+ *  Recycling pool of the PCM buffers
+ *
+ */
+
+/* upper limit of the total size of the buffers kept in the pool */
+#define SND_DMA_POOL_MAX_BYTES	(4 * 1024 * 1024)
+
+struct snd_dma_pool_entry {
+	struct list_head list;
+	struct snd_dma_buffer dmab;
+	int nid;			/* node of the pages, or NUMA_NO_NODE */
+};
+
+static LIST_HEAD(snd_dma_pool);		/* most recently freed first */
+static DEFINE_MUTEX(snd_dma_pool_mutex);
+static size_t snd_dma_pool_bytes;
+
+static bool snd_dma_pool_type(int type)
+{
+	switch (type) {
+	case SNDRV_DMA_TYPE_CONTINUOUS:
+	case SNDRV_DMA_TYPE_DEV:
+	case SNDRV_DMA_TYPE_DEV_SG:
+		return true;
+	}
+	return false;		/* IRAM is too precious to be kept */
+}
+
+static void snd_dma_pool_release(struct list_head *head)
+{
+	struct snd_dma_pool_entry *e, *n;
+
+	list_for_each_entry_safe(e, n, head, list) {
+		snd_dma_free_pages(&e->dmab);
+		kfree(e);
+	}
+}
+
+/* move the least recently freed entries to @head until @bytes are gathered;
+ * returns the gathered size.  Call with snd_dma_pool_mutex held.
+ */
+static size_t snd_dma_pool_evict(size_t bytes, struct list_head *head)
+{
+	struct snd_dma_pool_entry *e;
+	size_t freed = 0;
+
+	while (freed < bytes && !list_empty(&snd_dma_pool)) {
+		e = list_last_entry(&snd_dma_pool, struct snd_dma_pool_entry,
+				    list);
+		list_move(&e->list, head);
+		snd_dma_pool_bytes -= e->dmab.bytes;
+		freed += e->dmab.bytes;
+	}
+	return freed;
+}
+
+/**
+ * snd_dma_pool_alloc - allocate a buffer, reusing a recycled one if possible
+ * @type: the DMA buffer type
+ * @device: the device pointer
+ * @size: the buffer size to allocate
+ * @dmab: buffer allocation record to store the allocated data
+ * @nid: the preferred memory node, or %NUMA_NO_NODE
+ *
+ * Like snd_dma_alloc_pages_node(), but takes a buffer of the same type,
+ * device and size from the pool filled by snd_dma_pool_free() first;
+ * a continuous buffer must also be on the given node.  The reused buffer
+ * is cleared.  When a new allocation fails, the pool is
+ * emptied and the allocation is retried once.
+ *
+ * Return: Zero if the buffer with the given size is allocated successfully,
+ * otherwise a negative value on error.
+ */
+int snd_dma_pool_alloc(int type, struct device *device, size_t size,
+		       struct snd_dma_buffer *dmab, int nid)
+{
+	struct snd_dma_pool_entry *e, *found = NULL;
+	LIST_HEAD(head);
+	int err;
+
+	mutex_lock(&snd_dma_pool_mutex);
+	list_for_each_entry(e, &snd_dma_pool, list) {
+		if (e->dmab.dev.type == type && e->dmab.dev.dev == device &&
+		    e->dmab.bytes == size &&
+		    (nid == NUMA_NO_NODE || e->nid == NUMA_NO_NODE ||
+		     e->nid == nid)) {
+			list_del(&e->list);
+			snd_dma_pool_bytes -= size;
+			found = e;
+			break;
+		}
+	}
+	mutex_unlock(&snd_dma_pool_mutex);
+
+	if (found) {
+		*dmab = found->dmab;
+		kfree(found);
+		memset(dmab->area, 0, dmab->bytes);
+		return 0;
+	}
+
+	err = snd_dma_alloc_pages_node(type, device, size, dmab, nid);
+	if (err != -ENOMEM)
+		return err;
+
+	/* give the cached memory back and try again */
+	mutex_lock(&snd_dma_pool_mutex);
+	snd_dma_pool_evict(snd_dma_pool_bytes, &head);
+	mutex_unlock(&snd_dma_pool_mutex);
+	if (list_empty(&head))
+		return err;
+	snd_dma_pool_release(&head);
+	return snd_dma_alloc_pages_node(type, device, size, dmab, nid);
+}
+EXPORT_SYMBOL(snd_dma_pool_alloc);
+
+/**
+ * snd_dma_pool_free - release a buffer to the recycling pool
+ * @dmab: the buffer allocation record to release
+ *
+ * Keeps the buffer allocated via snd_dma_pool_alloc() for reuse.  The pool
+ * is limited in size, returns memory to the system under pressure, and
+ * must be flushed via snd_dma_pool_flush() before the device goes away.
+ */
+void snd_dma_pool_free(struct snd_dma_buffer *dmab)
+{
+	struct snd_dma_pool_entry *e;
+	LIST_HEAD(head);
+
+	if (!snd_dma_pool_type(dmab->dev.type) ||
+	    dmab->bytes > SND_DMA_POOL_MAX_BYTES)
+		goto free;
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		goto free;
+	e->dmab = *dmab;
+	/* the device types follow the node of the device, see above */
+	if (dmab->dev.type == SNDRV_DMA_TYPE_CONTINUOUS)
+		e->nid = page_to_nid(virt_to_page(dmab->area));
+	else
+		e->nid = NUMA_NO_NODE;
+
+	mutex_lock(&snd_dma_pool_mutex);
+	list_add(&e->list, &snd_dma_pool);
+	snd_dma_pool_bytes += dmab->bytes;
+	if (snd_dma_pool_bytes > SND_DMA_POOL_MAX_BYTES)
+		snd_dma_pool_evict(snd_dma_pool_bytes - SND_DMA_POOL_MAX_BYTES,
+				   &head);
+	mutex_unlock(&snd_dma_pool_mutex);
+	snd_dma_pool_release(&head);
+	return;
+
+ free:
+	snd_dma_free_pages(dmab);
+}
+EXPORT_SYMBOL(snd_dma_pool_free);
+
+/**
+ * snd_dma_pool_flush - release the recycled buffers of a device
+ * @device: the device pointer given at the allocation
+ */
+void snd_dma_pool_flush(struct device *device)
+{
+	struct snd_dma_pool_entry *e, *n;
+	LIST_HEAD(head);
+
+	mutex_lock(&snd_dma_pool_mutex);
+	list_for_each_entry_safe(e, n, &snd_dma_pool, list) {
+		if (e->dmab.dev.dev == device) {
+			list_move(&e->list, &head);
+			snd_dma_pool_bytes -= e->dmab.bytes;
+		}
+	}
+	mutex_unlock(&snd_dma_pool_mutex);
+	snd_dma_pool_release(&head);
+}
+EXPORT_SYMBOL(snd_dma_pool_flush);
+
+static unsigned long snd_dma_pool_count(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	return READ_ONCE(snd_dma_pool_bytes) >> PAGE_SHIFT;
+}
+
+static unsigned long snd_dma_pool_scan(struct shrinker *shrink,
+				       struct shrink_control *sc)
+{
+	LIST_HEAD(head);
+	size_t freed;
+
+	/* don't let the reclaim wait for a pool user */
+	if (!mutex_trylock(&snd_dma_pool_mutex))
+		return SHRINK_STOP;
+	freed = snd_dma_pool_evict(sc->nr_to_scan << PAGE_SHIFT, &head);
+	mutex_unlock(&snd_dma_pool_mutex);
+	snd_dma_pool_release(&head);
+	return freed >> PAGE_SHIFT;
+}
+
+static struct shrinker snd_dma_pool_shrinker = {
+	.count_objects = snd_dma_pool_count,
+	.scan_objects = snd_dma_pool_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+int __init snd_dma_pool_init(void)
+{
+	return register_shrinker(&snd_dma_pool_shrinker);
+}
+
+void snd_dma_pool_exit(void)
+{
+	LIST_HEAD(head);
+
+	unregister_shrinker(&snd_dma_pool_shrinker);
+	mutex_lock(&snd_dma_pool_mutex);
+	snd_dma_pool_evict(snd_dma_pool_bytes, &head);
+	mutex_unlock(&snd_dma_pool_mutex);
+	snd_dma_pool_release(&head);
+}
@@ -52,6 +52,25 @@ static inline void do_convert(struct linear_priv *data,
 	memcpy(dst, p + data->dst_ofs, data->dst_bytes);
 }
 
+/*
+ * The destination may have another channel count than the source: the
+ * channels are then mapped the way the route plugin does, so that a
+ * format change and a channel reduction or extension at the same rate
+ * are done in a single pass, without the intermediate buffer.
+ */
+static const struct snd_pcm_plugin_channel *
+src_channel(struct snd_pcm_plugin *plugin,
+	    const struct snd_pcm_plugin_channel *src_channels, int channel)
+{
+	int nsrcs = plugin->src_format.channels;
+
+	if (nsrcs <= 1)
+		return &src_channels[0];
+	if (channel < nsrcs)
+		return &src_channels[channel];
+	return NULL;
+}
+
 static void convert(struct snd_pcm_plugin *plugin,
 		    const struct snd_pcm_plugin_channel *src_channels,
 		    struct snd_pcm_plugin_channel *dst_channels,
@@ -59,22 +78,24 @@ static void convert(struct snd_pcm_plugin *plugin,
 {
 	struct linear_priv *data = (struct linear_priv *)plugin->extra_data;
 	int channel;
-	int nchannels = plugin->src_format.channels;
+	int nchannels = plugin->dst_format.channels;
 	for (channel = 0; channel < nchannels; ++channel) {
+		const struct snd_pcm_plugin_channel *src_ch;
 		char *src;
 		char *dst;
 		int src_step, dst_step;
 		snd_pcm_uframes_t frames1;
-		if (!src_channels[channel].enabled) {
+		src_ch = src_channel(plugin, src_channels, channel);
+		if (!src_ch || !src_ch->enabled) {
 			if (dst_channels[channel].wanted)
 				snd_pcm_area_silence(&dst_channels[channel].area, 0, frames, plugin->dst_format.format);
 			dst_channels[channel].enabled = 0;
 			continue;
 		}
 		dst_channels[channel].enabled = 1;
-		src = src_channels[channel].area.addr + src_channels[channel].area.first / 8;
+		src = src_ch->area.addr + src_ch->area.first / 8;
 		dst = dst_channels[channel].area.addr + dst_channels[channel].area.first / 8;
-		src_step = src_channels[channel].area.step / 8;
+		src_step = src_ch->area.step / 8;
 		dst_step = dst_channels[channel].area.step / 8;
 		frames1 = frames;
 		while (frames1-- > 0) {
@@ -101,6 +122,8 @@ static snd_pcm_sframes_t linear_transfer(struct snd_pcm_plugin *plugin,
 			if (snd_BUG_ON(src_channels[channel].area.first % 8 ||
 				       src_channels[channel].area.step % 8))
 				return -ENXIO;
+		}
+		for (channel = 0; channel < plugin->dst_format.channels; channel++) {
 			if (snd_BUG_ON(dst_channels[channel].area.first % 8 ||
 				       dst_channels[channel].area.step % 8))
 				return -ENXIO;
@@ -159,8 +182,6 @@ int snd_pcm_plugin_build_linear(struct snd_pcm_substream *plug,
 
 	if (snd_BUG_ON(src_format->rate != dst_format->rate))
 		return -ENXIO;
-	if (snd_BUG_ON(src_format->channels != dst_format->channels))
-		return -ENXIO;
 	if (snd_BUG_ON(!snd_pcm_format_linear(src_format->format) ||
 		       !snd_pcm_format_linear(dst_format->format)))
 		return -ENXIO;
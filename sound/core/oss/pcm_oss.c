@@ -824,8 +824,12 @@ static int choose_rate(struct snd_pcm_substream *substream,
 	return snd_pcm_hw_param_near(substream, params, SNDRV_PCM_HW_PARAM_RATE, best_rate, NULL);
 }
 
-static int snd_pcm_oss_change_params(struct snd_pcm_substream *substream,
-				     bool trylock)
+/*
+ * Set the stream up for the OSS parameters, under params_lock.  With mmap
+ * the hardware has to take the mmap access and OSS format directly.
+ */
+static int snd_pcm_oss_change_params_locked(struct snd_pcm_substream *substream,
+					    bool mmap)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct snd_pcm_hw_params *params, *sparams;
@@ -839,11 +843,6 @@ static int snd_pcm_oss_change_params(struct snd_pcm_substream *substream,
 	const struct snd_mask *sformat_mask;
 	struct snd_mask mask;
 
-	if (trylock) {
-		if (!(mutex_trylock(&runtime->oss.params_lock)))
-			return -EAGAIN;
-	} else if (mutex_lock_interruptible(&runtime->oss.params_lock))
-		return -EINTR;
 	sw_params = kzalloc(sizeof(*sw_params), GFP_KERNEL);
 	params = kmalloc(sizeof(*params), GFP_KERNEL);
 	sparams = kmalloc(sizeof(*sparams), GFP_KERNEL);
@@ -853,6 +852,8 @@ static int snd_pcm_oss_change_params(struct snd_pcm_substream *substream,
 	}
 
 	if (atomic_read(&substream->mmap_count))
+		mmap = true;
+	if (mmap)
 		direct = 1;
 	else
 		direct = substream->oss.setup.direct;
@@ -861,9 +862,12 @@ static int snd_pcm_oss_change_params(struct snd_pcm_substream *substream,
 	_snd_pcm_hw_param_setinteger(sparams, SNDRV_PCM_HW_PARAM_PERIODS);
 	_snd_pcm_hw_param_min(sparams, SNDRV_PCM_HW_PARAM_PERIODS, 2, 0);
 	snd_mask_none(&mask);
-	if (atomic_read(&substream->mmap_count))
+	if (mmap) {
 		snd_mask_set(&mask, (__force int)SNDRV_PCM_ACCESS_MMAP_INTERLEAVED);
-	else {
+		/* a mono buffer has the same layout either way */
+		if (runtime->oss.channels == 1)
+			snd_mask_set(&mask, (__force int)SNDRV_PCM_ACCESS_MMAP_NONINTERLEAVED);
+	} else {
 		snd_mask_set(&mask, (__force int)SNDRV_PCM_ACCESS_RW_INTERLEAVED);
 		if (!direct)
 			snd_mask_set(&mask, (__force int)SNDRV_PCM_ACCESS_RW_NONINTERLEAVED);
@@ -1069,6 +1073,17 @@ static int snd_pcm_oss_change_params(struct snd_pcm_substream *substream,
 	kfree(sw_params);
 	kfree(params);
 	kfree(sparams);
+	return err;
+}
+
+static int snd_pcm_oss_change_params(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	int err;
+
+	if (mutex_lock_interruptible(&runtime->oss.params_lock))
+		return -EINTR;
+	err = snd_pcm_oss_change_params_locked(substream, false);
 	mutex_unlock(&runtime->oss.params_lock);
 	return err;
 }
@@ -1085,7 +1100,7 @@ static int snd_pcm_oss_get_active_substream(struct snd_pcm_oss_file *pcm_oss_fil
 		if (asubstream == NULL)
 			asubstream = substream;
 		if (substream->runtime->oss.params) {
-			err = snd_pcm_oss_change_params(substream, false);
+			err = snd_pcm_oss_change_params(substream);
 			if (err < 0)
 				return err;
 		}
@@ -1125,7 +1140,7 @@ static int snd_pcm_oss_make_ready(struct snd_pcm_substream *substream)
 		return 0;
 	runtime = substream->runtime;
 	if (runtime->oss.params) {
-		err = snd_pcm_oss_change_params(substream, false);
+		err = snd_pcm_oss_change_params(substream);
 		if (err < 0)
 			return err;
 	}
@@ -1291,6 +1306,23 @@ snd_pcm_sframes_t snd_pcm_oss_readv3(struct snd_pcm_substream *substream, void *
 }
 #endif /* CONFIG_SND_PCM_OSS_PLUGINS */
 
+/*
+ * Bytes to pass to snd_pcm_oss_write2()/read2() straight from the user
+ * buffer.  The plugin buffers hold a single period, but without plugins
+ * all the whole periods are transferred into the ring at once.
+ */
+static size_t snd_pcm_oss_direct_bytes(struct snd_pcm_substream *substream,
+				       size_t bytes)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+#ifdef CONFIG_SND_PCM_OSS_PLUGINS
+	if (runtime->oss.plugin_first)
+		return runtime->oss.period_bytes;
+#endif
+	return rounddown(bytes, runtime->oss.period_bytes);
+}
+
 static ssize_t snd_pcm_oss_write2(struct snd_pcm_substream *substream, const char *buf, size_t bytes, int in_kernel)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -1369,9 +1401,11 @@ static ssize_t snd_pcm_oss_write1(struct snd_pcm_substream *substream, const cha
 				}
 			}
 		} else {
+			size_t len = snd_pcm_oss_direct_bytes(substream, bytes);
+
 			tmp = snd_pcm_oss_write2(substream,
 						 (const char __force *)buf,
-						 runtime->oss.period_bytes, 0);
+						 len, 0);
 			if (tmp <= 0)
 				goto err;
 			runtime->oss.bytes += tmp;
@@ -1379,7 +1413,7 @@ static ssize_t snd_pcm_oss_write1(struct snd_pcm_substream *substream, const cha
 			bytes -= tmp;
 			xfer += tmp;
 			if ((substream->f_flags & O_NONBLOCK) != 0 &&
-			    tmp != runtime->oss.period_bytes)
+			    tmp != len)
 				break;
 		}
 	}
@@ -1459,7 +1493,7 @@ static ssize_t snd_pcm_oss_read1(struct snd_pcm_substream *substream, char __use
 			runtime->oss.buffer_used -= tmp;
 		} else {
 			tmp = snd_pcm_oss_read2(substream, (char __force *)buf,
-						runtime->oss.period_bytes, 0);
+						snd_pcm_oss_direct_bytes(substream, bytes), 0);
 			if (tmp <= 0)
 				goto err;
 			runtime->oss.bytes += tmp;
@@ -2115,7 +2149,7 @@ static int snd_pcm_oss_get_space(struct snd_pcm_oss_file *pcm_oss_file, int stre
 	runtime = substream->runtime;
 
 	if (runtime->oss.params &&
-	    (err = snd_pcm_oss_change_params(substream, false)) < 0)
+	    (err = snd_pcm_oss_change_params(substream)) < 0)
 		return err;
 
 	info.fragsize = runtime->oss.period_bytes;
@@ -2721,6 +2755,8 @@ static int snd_pcm_oss_mmap(struct file *file, struct vm_area_struct *area)
 	struct snd_pcm_oss_file *pcm_oss_file;
 	struct snd_pcm_substream *substream = NULL;
 	struct snd_pcm_runtime *runtime;
+	snd_pcm_access_t access, old_access;
+	bool reconfig;
 	int err;
 
 #ifdef OSS_DEBUG
@@ -2751,30 +2787,53 @@ static int snd_pcm_oss_mmap(struct file *file, struct vm_area_struct *area)
 	if (!(runtime->info & SNDRV_PCM_INFO_MMAP_VALID))
 		return -EIO;
 	if (runtime->info & SNDRV_PCM_INFO_INTERLEAVED)
-		runtime->access = SNDRV_PCM_ACCESS_MMAP_INTERLEAVED;
+		access = SNDRV_PCM_ACCESS_MMAP_INTERLEAVED;
+	else if (runtime->channels == 1 &&
+		 (runtime->info & SNDRV_PCM_INFO_NONINTERLEAVED))
+		access = SNDRV_PCM_ACCESS_MMAP_NONINTERLEAVED;
 	else
 		return -EIO;
-	
-	if (runtime->oss.params) {
-		/* use mutex_trylock() for params_lock for avoiding a deadlock
-		 * between mmap_sem and params_lock taken by
-		 * copy_from/to_user() in snd_pcm_oss_write/read()
-		 */
-		err = snd_pcm_oss_change_params(substream, true);
+
+	if (area->vm_pgoff != 0)
+		return -EINVAL;
+
+	/* use mutex_trylock() for params_lock for avoiding a deadlock
+	 * between mmap_sem and params_lock taken by
+	 * copy_from/to_user() in snd_pcm_oss_write/read()
+	 */
+	if (!mutex_trylock(&runtime->oss.params_lock))
+		return -EAGAIN;
+
+	/*
+	 * The plugins may only be there for the read/write access, try
+	 * to set the hardware up in the OSS format before giving up.
+	 */
+	reconfig = runtime->oss.params;
+#ifdef CONFIG_SND_PCM_OSS_PLUGINS
+	if (runtime->oss.plugin_first != NULL)
+		reconfig = true;
+#endif
+	if (reconfig) {
+		err = snd_pcm_oss_change_params_locked(substream, true);
 		if (err < 0)
-			return err;
+			goto restore;
 	}
 #ifdef CONFIG_SND_PCM_OSS_PLUGINS
-	if (runtime->oss.plugin_first != NULL)
-		return -EIO;
+	if (runtime->oss.plugin_first != NULL) {
+		err = -EIO;
+		goto restore;
+	}
 #endif
 
-	if (area->vm_pgoff != 0)
-		return -EINVAL;
-
+	old_access = runtime->access;
+	runtime->access = access;
 	err = snd_pcm_mmap_data(substream, file, area);
-	if (err < 0)
-		return err;
+	if (err < 0) {
+		runtime->access = old_access;
+		goto restore;
+	}
+	mutex_unlock(&runtime->oss.params_lock);
+
 	runtime->oss.mmap_bytes = area->vm_end - area->vm_start;
 	runtime->silence_threshold = 0;
 	runtime->silence_size = 0;
@@ -2786,6 +2845,13 @@ static int snd_pcm_oss_mmap(struct file *file, struct vm_area_struct *area)
 	runtime->stop_threshold = runtime->boundary;
 
 	return 0;
+
+restore:
+	/* set the read/write access up again on the next transfer */
+	if (reconfig)
+		runtime->oss.params = 1;
+	mutex_unlock(&runtime->oss.params_lock);
+	return err;
 }
 
 #ifdef CONFIG_SND_VERBOSE_PROCFS
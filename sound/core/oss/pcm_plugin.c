@@ -369,6 +369,7 @@ int snd_pcm_plug_format_plugins(struct snd_pcm_substream *plug,
 	snd_pcm_access_t src_access, dst_access;
 	struct snd_pcm_plugin *plugin = NULL;
 	int err;
+	int linear_next;
 	int stream = snd_pcm_plug_stream(plug);
 	int slave_interleaved = (params_channels(slave_params) == 1 ||
 				 params_access(slave_params) == SNDRV_PCM_ACCESS_RW_INTERLEAVED);
@@ -431,8 +432,20 @@ int snd_pcm_plug_format_plugins(struct snd_pcm_substream *plug,
 		src_access = dst_access;
 	}
 
+	/*
+	 * A linear format conversion changes the channel count in the same
+	 * pass, so don't add a route plugin in front of one.
+	 */
+	if (!snd_pcm_format_linear(srcformat.format))
+		linear_next = 0;
+	else if (!rate_match(srcformat.rate, dstformat.rate))
+		linear_next = srcformat.format != SNDRV_PCM_FORMAT_S16;
+	else
+		linear_next = srcformat.format != dstformat.format &&
+			      snd_pcm_format_linear(dstformat.format);
+
 	/* channels reduction */
-	if (srcformat.channels > dstformat.channels) {
+	if (srcformat.channels > dstformat.channels && !linear_next) {
 		tmpformat.channels = dstformat.channels;
 		err = snd_pcm_plugin_build_route(plug, &srcformat, &tmpformat, &plugin);
 		pdprintf("channels reduction: src=%i, dst=%i returns %i\n", srcformat.channels, tmpformat.channels, err);
@@ -452,6 +465,8 @@ int snd_pcm_plug_format_plugins(struct snd_pcm_substream *plug,
 		if (srcformat.format != SNDRV_PCM_FORMAT_S16) {
 			/* convert to S16 for resampling */
 			tmpformat.format = SNDRV_PCM_FORMAT_S16;
+			if (srcformat.channels > dstformat.channels)
+				tmpformat.channels = dstformat.channels;
 			err = snd_pcm_plugin_build_linear(plug,
 							  &srcformat, &tmpformat,
 							  &plugin);
@@ -492,6 +507,7 @@ int snd_pcm_plug_format_plugins(struct snd_pcm_substream *plug,
 		}
 		else if (snd_pcm_format_linear(srcformat.format) &&
 			 snd_pcm_format_linear(tmpformat.format)) {
+			tmpformat.channels = dstformat.channels;
 			err = snd_pcm_plugin_build_linear(plug,
 							  &srcformat, &tmpformat,
 							  &plugin);
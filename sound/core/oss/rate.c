@@ -20,6 +20,8 @@
  */
   
 #include <linux/time.h>
+#include <linux/module.h>
+#include <linux/mm.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include "pcm_plugin.h"
@@ -28,6 +30,136 @@
 #define BITS	(1<<SHIFT)
 #define R_MASK	(BITS-1)
 
+/*
+ *  Band-limited interpolation: a windowed sinc is sampled in PHASES
+ *  polyphase sets of coefficients, picked by the fractional position.
+ *  Downsampling stretches the filter to the destination rate, up to
+ *  MAX_DECIMATION; beyond that the stream is only partially filtered.
+ */
+#define PHASE_BITS	7
+#define PHASES		(1<<PHASE_BITS)
+#define SINC_OVERSAMPLE	32
+#define MAX_DECIMATION	8
+
+static int rate_quality = 1;
+module_param(rate_quality, int, 0644);
+MODULE_PARM_DESC(rate_quality, "Rate conversion quality (0 = linear interpolation, 1 = 8 zero crossings, 2 = 16 zero crossings).");
+
+/* Kaiser windowed sinc, cut off at 0.90 and 0.94 of Nyquist, Q15 */
+static const s16 rate_sinc_8[257] = {
+	29490, 29451, 29332, 29135, 28861, 28511, 28086, 27589,
+	27023, 26390, 25693, 24935, 24122, 23255, 22341, 21382,
+	20384, 19351, 18289, 17202, 16096, 14975, 13844, 12709,
+	11575, 10446, 9328, 8225, 7141, 6082, 5050, 4051,
+	3088, 2163, 1281, 444, -345, -1084, -1772, -2406,
+	-2986, -3510, -3978, -4390, -4747, -5047, -5292, -5484,
+	-5623, -5711, -5749, -5741, -5687, -5591, -5456, -5283,
+	-5077, -4839, -4574, -4283, -3972, -3642, -3298, -2942,
+	-2577, -2207, -1835, -1463, -1095, -733, -380, -37,
+	292, 605, 902, 1180, 1437, 1673, 1887, 2078,
+	2244, 2387, 2505, 2598, 2667, 2713, 2735, 2734,
+	2712, 2668, 2605, 2524, 2425, 2311, 2183, 2042,
+	1889, 1728, 1558, 1383, 1203, 1019, 835, 651,
+	468, 289, 114, -56, -218, -373, -519, -656,
+	-782, -897, -1000, -1091, -1170, -1237, -1291, -1333,
+	-1362, -1380, -1385, -1379, -1362, -1335, -1298, -1252,
+	-1198, -1136, -1067, -992, -913, -829, -741, -651,
+	-560, -467, -375, -283, -192, -104, -19, 64,
+	142, 216, 285, 348, 407, 459, 506, 546,
+	580, 608, 630, 646, 655, 659, 657, 650,
+	638, 621, 600, 574, 546, 514, 479, 441,
+	402, 362, 320, 277, 235, 192, 150, 108,
+	68, 29, -8, -43, -77, -108, -136, -162,
+	-185, -205, -223, -238, -250, -259, -265, -269,
+	-270, -269, -266, -261, -253, -244, -234, -222,
+	-208, -194, -179, -163, -146, -130, -113, -96,
+	-80, -64, -48, -33, -18, -4, 8, 20,
+	31, 41, 50, 58, 65, 70, 75, 78,
+	81, 83, 83, 83, 82, 81, 78, 76,
+	72, 68, 64, 60, 55, 50, 45, 40,
+	35, 31, 26, 21, 17, 13, 9, 6,
+	3, 0, -3, -5, -7, -9, -10, -11,
+	0,
+};
+
+static const s16 rate_sinc_16[513] = {
+	30801, 30757, 30624, 30405, 30098, 29708, 29234, 28680,
+	28049, 27344, 26568, 25727, 24822, 23861, 22847, 21785,
+	20682, 19541, 18370, 17174, 15958, 14729, 13492, 12253,
+	11018, 9792, 8582, 7392, 6228, 5095, 3996, 2937,
+	1922, 955, 38, -825, -1631, -2378, -3064, -3688,
+	-4248, -4744, -5175, -5541, -5844, -6083, -6259, -6375,
+	-6432, -6433, -6379, -6274, -6120, -5921, -5680, -5401,
+	-5087, -4742, -4370, -3975, -3562, -3133, -2693, -2246,
+	-1796, -1347, -901, -463, -36, 378, 774, 1151,
+	1506, 1837, 2142, 2419, 2667, 2885, 3072, 3227,
+	3350, 3440, 3499, 3527, 3524, 3491, 3429, 3340,
+	3225, 3085, 2924, 2742, 2542, 2326, 2096, 1854,
+	1603, 1345, 1082, 818, 553, 291, 33, -219,
+	-462, -695, -917, -1124, -1317, -1494, -1653, -1795,
+	-1918, -2021, -2104, -2168, -2211, -2235, -2239, -2223,
+	-2190, -2138, -2069, -1985, -1885, -1772, -1647, -1510,
+	-1364, -1209, -1049, -882, -713, -541, -369, -197,
+	-28, 137, 297, 451, 597, 735, 864, 982,
+	1089, 1184, 1267, 1337, 1394, 1438, 1468, 1485,
+	1490, 1481, 1460, 1427, 1382, 1327, 1262, 1187,
+	1104, 1014, 917, 814, 707, 596, 482, 367,
+	252, 137, 24, -87, -195, -298, -397, -490,
+	-576, -656, -728, -792, -848, -896, -934, -964,
+	-985, -997, -1000, -994, -980, -958, -929, -892,
+	-848, -798, -743, -682, -617, -548, -476, -402,
+	-326, -249, -172, -95, -19, 55, 127, 196,
+	262, 324, 382, 435, 483, 526, 563, 594,
+	620, 640, 654, 661, 663, 659, 650, 635,
+	616, 591, 562, 529, 492, 452, 409, 363,
+	316, 267, 216, 166, 115, 64, 15, -34,
+	-81, -126, -169, -210, -247, -282, -313, -341,
+	-365, -385, -402, -414, -423, -428, -429, -426,
+	-420, -410, -397, -381, -362, -340, -316, -290,
+	-263, -233, -203, -171, -139, -107, -74, -42,
+	-11, 20, 50, 79, 106, 131, 155, 177,
+	196, 213, 228, 241, 251, 259, 264, 267,
+	267, 265, 261, 255, 246, 236, 224, 211,
+	196, 179, 162, 144, 125, 106, 86, 66,
+	46, 27, 7, -12, -30, -47, -63, -79,
+	-93, -106, -117, -127, -136, -143, -149, -154,
+	-157, -158, -158, -157, -154, -150, -145, -139,
+	-132, -124, -115, -105, -95, -84, -73, -62,
+	-50, -39, -27, -16, -5, 6, 16, 26,
+	36, 44, 52, 59, 66, 72, 76, 80,
+	83, 86, 87, 88, 88, 87, 85, 83,
+	80, 76, 72, 68, 63, 57, 52, 46,
+	40, 33, 27, 21, 15, 9, 3, -3,
+	-8, -14, -19, -23, -27, -31, -34, -37,
+	-39, -41, -43, -44, -45, -45, -45, -44,
+	-43, -42, -40, -38, -36, -34, -31, -29,
+	-26, -23, -20, -16, -13, -10, -7, -4,
+	-1, 1, 4, 6, 9, 11, 13, 14,
+	16, 17, 18, 19, 20, 20, 20, 20,
+	20, 20, 19, 19, 18, 17, 16, 15,
+	14, 12, 11, 10, 8, 7, 6, 4,
+	3, 2, 1, -1, -2, -3, -3, -4,
+	-5, -6, -6, -7, -7, -7, -8, -8,
+	-8, -8, -8, -7, -7, -7, -7, -6,
+	-6, -5, -5, -4, -4, -3, -3, -2,
+	-2, -1, -1, -1, 0, 0, 0, 1,
+	1, 1, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2,
+	2, 1, 1, 1, 1, 1, 1, 1,
+	1, 0, 0, 0, 0, 0, 0, 0,
+	0,
+};
+
+struct rate_filter {
+	const s16 *sinc;
+	unsigned int zero_crossings;
+};
+
+static const struct rate_filter rate_filters[] = {
+	[1] = { rate_sinc_8, 8 },
+	[2] = { rate_sinc_16, 16 },
+};
+
 /*
  *  Basic rate conversion plugin
  */
@@ -35,6 +167,11 @@
 struct rate_channel {
 	signed short last_S1;
 	signed short last_S2;
+	/* filter state of the current transfer */
+	const signed short *src;
+	signed short *dst;
+	int src_step, dst_step;
+	s64 acc;
 };
  
 typedef void (*rate_f)(struct snd_pcm_plugin *plugin,
@@ -47,6 +184,10 @@ struct rate_priv {
 	unsigned int pos;
 	rate_f func;
 	snd_pcm_sframes_t old_src_frames, old_dst_frames;
+	unsigned int ntaps;	/* filter length, 0 for linear interpolation */
+	s16 *coef;		/* PHASES sets of ntaps coefficients */
+	s16 *hist;		/* input frames, the ring is stored twice */
+	unsigned int hist_pos;
 	struct rate_channel channels[0];
 };
 
@@ -59,6 +200,11 @@ static void rate_init(struct snd_pcm_plugin *plugin)
 		data->channels[channel].last_S1 = 0;
 		data->channels[channel].last_S2 = 0;
 	}
+	if (data->hist) {
+		memset(data->hist, 0, 2 * data->ntaps *
+		       plugin->src_format.channels * sizeof(*data->hist));
+		data->hist_pos = 0;
+	}
 }
 
 static void resample_expand(struct snd_pcm_plugin *plugin,
@@ -180,6 +326,115 @@ static void resample_shrink(struct snd_pcm_plugin *plugin,
 	data->pos = pos;
 }
 
+/* append the next source frame to the history of each channel */
+static void filter_push(struct snd_pcm_plugin *plugin, bool avail)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+	unsigned int nchannels = plugin->src_format.channels;
+	s16 *h = data->hist + data->hist_pos * nchannels;
+	s16 *h2 = h + data->ntaps * nchannels;
+	unsigned int channel;
+
+	for (channel = 0; channel < nchannels; channel++) {
+		struct rate_channel *rchannel = &data->channels[channel];
+
+		/* past the end of the source, repeat the last sample */
+		if (avail && rchannel->src) {
+			rchannel->last_S2 = *rchannel->src;
+			rchannel->src += rchannel->src_step;
+		}
+		h[channel] = h2[channel] = rchannel->last_S2;
+	}
+	if (++data->hist_pos == data->ntaps)
+		data->hist_pos = 0;
+}
+
+/* compute one destination frame, frac is the position past the centre */
+static void filter_frame(struct snd_pcm_plugin *plugin, unsigned int frac)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+	unsigned int nchannels = plugin->src_format.channels;
+	const s16 *coef = data->coef + (frac >> (SHIFT - PHASE_BITS)) * data->ntaps;
+	const s16 *h = data->hist + data->hist_pos * nchannels;
+	struct rate_channel *rchannel;
+	unsigned int channel, tap;
+	signed int val;
+
+	for (channel = 0; channel < nchannels; channel++)
+		data->channels[channel].acc = 0;
+	for (tap = 0; tap < data->ntaps; tap++, h += nchannels) {
+		for (channel = 0; channel < nchannels; channel++)
+			data->channels[channel].acc += (s32)coef[tap] * h[channel];
+	}
+	for (channel = 0; channel < nchannels; channel++) {
+		rchannel = &data->channels[channel];
+		if (!rchannel->dst)
+			continue;
+		val = rchannel->acc >> 15;
+		if (val < -32768)
+			val = -32768;
+		else if (val > 32767)
+			val = 32767;
+		*rchannel->dst = val;
+		rchannel->dst += rchannel->dst_step;
+	}
+}
+
+static void resample_filter(struct snd_pcm_plugin *plugin,
+			    const struct snd_pcm_plugin_channel *src_channels,
+			    struct snd_pcm_plugin_channel *dst_channels,
+			    int src_frames, int dst_frames)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+	struct rate_channel *rchannel;
+	unsigned int pos = data->pos;
+	unsigned int channel, frac;
+
+	for (channel = 0; channel < plugin->src_format.channels; channel++) {
+		rchannel = &data->channels[channel];
+		if (!src_channels[channel].enabled) {
+			if (dst_channels[channel].wanted)
+				snd_pcm_area_silence(&dst_channels[channel].area, 0, dst_frames, plugin->dst_format.format);
+			dst_channels[channel].enabled = 0;
+			rchannel->src = NULL;
+			rchannel->dst = NULL;
+			continue;
+		}
+		dst_channels[channel].enabled = 1;
+		rchannel->src = (signed short *)src_channels[channel].area.addr +
+			src_channels[channel].area.first / 8 / 2;
+		rchannel->dst = (signed short *)dst_channels[channel].area.addr +
+			dst_channels[channel].area.first / 8 / 2;
+		rchannel->src_step = src_channels[channel].area.step / 8 / 2;
+		rchannel->dst_step = dst_channels[channel].area.step / 8 / 2;
+	}
+
+	/* same stepping as resample_expand() and resample_shrink() */
+	if (plugin->src_format.rate < plugin->dst_format.rate) {
+		while (dst_frames-- > 0) {
+			if (pos & ~R_MASK) {
+				pos &= R_MASK;
+				filter_push(plugin, src_frames-- > 0);
+			}
+			filter_frame(plugin, pos);
+			pos += data->pitch;
+		}
+	} else {
+		while (dst_frames > 0) {
+			filter_push(plugin, src_frames-- > 0);
+			if (pos & ~R_MASK) {
+				pos &= R_MASK;
+				/* the destination frame fell between the last two */
+				frac = ((data->pitch - pos) << SHIFT) / data->pitch;
+				filter_frame(plugin, min_t(unsigned int, frac, R_MASK));
+				dst_frames--;
+			}
+			pos += data->pitch;
+		}
+	}
+	data->pos = pos;
+}
+
 static snd_pcm_sframes_t rate_src_frames(struct snd_pcm_plugin *plugin, snd_pcm_uframes_t frames)
 {
 	struct rate_priv *data;
@@ -297,6 +552,69 @@ static int rate_action(struct snd_pcm_plugin *plugin,
 	return 0;	/* silenty ignore other actions */
 }
 
+static void rate_private_free(struct snd_pcm_plugin *plugin)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+
+	kvfree(data->coef);
+}
+
+/*
+ * Sample the windowed sinc for every phase, normalized to unity gain.
+ * Tap j of a phase sits (ntaps / 2 - 1 - j + phase / PHASES) source
+ * frames before the destination frame.
+ */
+static int rate_init_filter(struct snd_pcm_plugin *plugin,
+			    const struct rate_filter *filter)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+	unsigned int src_rate = plugin->src_format.rate;
+	unsigned int dst_rate = plugin->dst_format.rate;
+	unsigned int len = filter->zero_crossings * SINC_OVERSAMPLE;
+	unsigned int scale = 1 << 16;
+	unsigned int half, phase, tap, i;
+	u64 idx;
+	s32 c, sum;
+	s16 *coef;
+
+	if (dst_rate < src_rate)
+		scale = max_t(unsigned int,
+			      div_u64((u64)dst_rate << 16, src_rate),
+			      (1 << 16) / MAX_DECIMATION);
+	half = DIV_ROUND_UP(filter->zero_crossings << 16, scale);
+	data->ntaps = 2 * half;
+	data->coef = kvzalloc((PHASES * data->ntaps +
+			       2 * data->ntaps * plugin->src_format.channels) *
+			      sizeof(s16), GFP_KERNEL);
+	if (!data->coef)
+		return -ENOMEM;
+	data->hist = data->coef + PHASES * data->ntaps;
+	plugin->private_free = rate_private_free;
+
+	for (phase = 0; phase < PHASES; phase++) {
+		coef = data->coef + phase * data->ntaps;
+		sum = 0;
+		for (tap = 0; tap < data->ntaps; tap++) {
+			idx = abs((int)(half - 1 - tap) * PHASES + (int)phase);
+			idx = (idx * SINC_OVERSAMPLE * scale) >> PHASE_BITS;
+			i = idx >> 16;
+			if (i >= len)
+				continue;
+			c = filter->sinc[i] +
+				(((filter->sinc[i + 1] - filter->sinc[i]) *
+				  (s32)(idx & 0xffff)) >> 16);
+			coef[tap] = ((s64)c * scale) >> 16;
+			sum += coef[tap];
+		}
+		if (sum <= 0)
+			continue;
+		for (tap = 0; tap < data->ntaps; tap++)
+			coef[tap] = clamp_t(s32, coef[tap] * 32768 / sum,
+					    -32768, 32767);
+	}
+	return 0;
+}
+
 int snd_pcm_plugin_build_rate(struct snd_pcm_substream *plug,
 			      struct snd_pcm_plugin_format *src_format,
 			      struct snd_pcm_plugin_format *dst_format,
@@ -336,6 +654,15 @@ int snd_pcm_plugin_build_rate(struct snd_pcm_substream *plug,
 		data->pitch = ((dst_format->rate << SHIFT) + (src_format->rate >> 1)) / src_format->rate;
 		data->func = resample_shrink;
 	}
+	if (rate_quality > 0) {
+		err = rate_init_filter(plugin, &rate_filters[min_t(int, rate_quality,
+						ARRAY_SIZE(rate_filters) - 1)]);
+		if (err < 0) {
+			snd_pcm_plugin_free(plugin);
+			return err;
+		}
+		data->func = resample_filter;
+	}
 	data->pos = 0;
 	rate_init(plugin);
 	data->old_src_frames = data->old_dst_frames = 0;
@@ -25,6 +25,8 @@
 #include <linux/time.h>
 #include <linux/mutex.h>
 #include <linux/device.h>
+#include <linux/mm.h>
+#include <linux/uaccess.h>
 #include <sound/core.h>
 #include <sound/minors.h>
 #include <sound/pcm.h>
@@ -444,17 +446,29 @@ static void snd_pcm_substream_proc_sw_params_read(struct snd_info_entry *entry,
 	snd_iprintf(buffer, "silence_threshold: %lu\n", runtime->silence_threshold);
 	snd_iprintf(buffer, "silence_size: %lu\n", runtime->silence_size);
 	snd_iprintf(buffer, "boundary: %lu\n", runtime->boundary);
+	if (runtime->wakeup_frames)
+		snd_iprintf(buffer, "wakeup_frames: %u\n",
+			    runtime->wakeup_frames);
  unlock:
 	mutex_unlock(&substream->pcm->open_mutex);
 }
 
+static const char * const latency_stage_names[] = {
+	[SNDRV_PCM_LATENCY_BUFFER] = "buffer",
+	[SNDRV_PCM_LATENCY_DRIVER] = "driver",
+	[SNDRV_PCM_LATENCY_FIFO] = "fifo",
+	[SNDRV_PCM_LATENCY_TRANSPORT] = "transport",
+	[SNDRV_PCM_LATENCY_CODEC] = "codec",
+};
+
 static void snd_pcm_substream_proc_status_read(struct snd_info_entry *entry,
 					       struct snd_info_buffer *buffer)
 {
 	struct snd_pcm_substream *substream = entry->private_data;
 	struct snd_pcm_runtime *runtime;
 	struct snd_pcm_status status;
-	int err;
+	struct snd_pcm_latency latency;
+	int i, err;
 
 	mutex_lock(&substream->pcm->open_mutex);
 	runtime = substream->runtime;
@@ -480,6 +494,16 @@ static void snd_pcm_substream_proc_status_read(struct snd_info_entry *entry,
 	snd_iprintf(buffer, "-----\n");
 	snd_iprintf(buffer, "hw_ptr      : %ld\n", runtime->status->hw_ptr);
 	snd_iprintf(buffer, "appl_ptr    : %ld\n", runtime->control->appl_ptr);
+	if (!snd_pcm_latency(substream, &latency)) {
+		snd_iprintf(buffer, "-----\n");
+		for (i = 0; i <= SNDRV_PCM_LATENCY_LAST; i++)
+			snd_iprintf(buffer, "latency %-9s: %llu frames, %llu ns\n",
+				    latency_stage_names[i],
+				    latency.stage[i].frames,
+				    latency.stage[i].ns);
+		snd_iprintf(buffer, "latency total    : %llu frames, %llu ns\n",
+			    latency.total.frames, latency.total.ns);
+	}
  unlock:
 	mutex_unlock(&substream->pcm->open_mutex);
 }
@@ -515,6 +539,131 @@ static void snd_pcm_xrun_debug_write(struct snd_info_entry *entry,
 }
 #endif
 
+#ifdef CONFIG_SND_PCM_STATS
+static void snd_pcm_stats_print(struct snd_info_buffer *buffer,
+				const char *name, const unsigned int *hist)
+{
+	int i;
+
+	snd_iprintf(buffer, "%s:", name);
+	for (i = 0; i < SNDRV_PCM_STATS_BUCKETS; i++)
+		snd_iprintf(buffer, " %u", hist[i]);
+	snd_iprintf(buffer, "\n");
+}
+
+static void snd_pcm_substream_proc_stats_read(struct snd_info_entry *entry,
+					      struct snd_info_buffer *buffer)
+{
+	static const char * const cost_names[SNDRV_PCM_STATS_COST_NUM] = {
+		[SNDRV_PCM_STATS_COST_PERIOD] = "period_elapsed",
+		[SNDRV_PCM_STATS_COST_HW_PTR] = "update_hw_ptr",
+		[SNDRV_PCM_STATS_COST_XFER] = "xfer",
+		[SNDRV_PCM_STATS_COST_POLL] = "poll",
+	};
+	struct snd_pcm_substream *substream = entry->private_data;
+	struct snd_pcm_stats stats;
+	u64 periods, total = 0;
+	int i;
+
+	snd_pcm_stream_lock_irq(substream);
+	stats = substream->stats;
+	snd_pcm_stream_unlock_irq(substream);
+
+	/* bucket N counts the values in [2^(N-1), 2^N), bucket 0 is zero */
+	snd_iprintf(buffer, "xruns: %u\n", stats.xruns);
+	snd_pcm_stats_print(buffer, "period_jitter_us", stats.period_jitter);
+	snd_pcm_stats_print(buffer, "hw_ptr_delta", stats.hw_ptr_delta);
+	snd_pcm_stats_print(buffer, "wakeup_latency_us", stats.wakeup_latency);
+	snd_pcm_stats_print(buffer, "wakeup_avail", stats.wakeup_avail);
+
+	/* CPU cost of the hot paths; the period one includes hw_ptr */
+	for (i = 0; i < SNDRV_PCM_STATS_COST_NUM; i++) {
+		const struct snd_pcm_stats_cost *c = &stats.cost[i];
+
+		snd_iprintf(buffer,
+			    "cost_%s: calls %llu cycles %llu avg %llu\n",
+			    cost_names[i], c->calls, c->cycles,
+			    c->calls ? div64_u64(c->cycles, c->calls) : 0);
+		total += c->cycles;
+	}
+	periods = stats.cost[SNDRV_PCM_STATS_COST_PERIOD].calls;
+	total -= stats.cost[SNDRV_PCM_STATS_COST_HW_PTR].cycles;
+	snd_iprintf(buffer, "cycles_per_period: %llu\n",
+		    periods ? div64_u64(total, periods) : 0);
+}
+
+static void snd_pcm_substream_proc_stats_write(struct snd_info_entry *entry,
+					       struct snd_info_buffer *buffer)
+{
+	struct snd_pcm_substream *substream = entry->private_data;
+
+	snd_pcm_stream_lock_irq(substream);
+	memset(&substream->stats, 0, sizeof(substream->stats));
+	snd_pcm_stream_unlock_irq(substream);
+}
+#endif /* CONFIG_SND_PCM_STATS */
+
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+/* print the ring oldest first, with times relative to the newest event */
+static void snd_pcm_flight_print(struct snd_info_buffer *buffer,
+				 const struct snd_pcm_flight_rec *rec)
+{
+	const struct snd_pcm_flight_event *ev, *last;
+	unsigned int i, n;
+
+	n = min_t(unsigned int, rec->head, SNDRV_PCM_FLIGHT_EVENTS);
+	if (!n) {
+		snd_iprintf(buffer, "  none\n");
+		return;
+	}
+	last = &rec->ev[(rec->head - 1) % SNDRV_PCM_FLIGHT_EVENTS];
+	for (i = rec->head - n; i != rec->head; i++) {
+		ev = &rec->ev[i % SNDRV_PCM_FLIGHT_EVENTS];
+		snd_iprintf(buffer, "  %8llu us ",
+			    div_u64(last->time_ns - ev->time_ns,
+				    NSEC_PER_USEC));
+		switch (ev->type) {
+		case SNDRV_PCM_FLIGHT_HWPTR:
+			snd_iprintf(buffer, "hwptr %s pos %lu",
+				    ev->arg ? "irq" : "pos", ev->pos);
+			break;
+		case SNDRV_PCM_FLIGHT_STATE:
+			snd_iprintf(buffer, "state %s", snd_pcm_state_name(
+					(__force snd_pcm_state_t)ev->arg));
+			break;
+		case SNDRV_PCM_FLIGHT_XRUN:
+			snd_iprintf(buffer, "xrun");
+			break;
+		}
+		snd_iprintf(buffer, " hw_ptr %lu appl_ptr %lu\n",
+			    ev->hw_ptr, ev->appl_ptr);
+	}
+}
+
+static void snd_pcm_substream_proc_flight_read(struct snd_info_entry *entry,
+					       struct snd_info_buffer *buffer)
+{
+	struct snd_pcm_substream *substream = entry->private_data;
+	struct snd_pcm_flight_rec *rec;
+
+	rec = kmalloc(sizeof(*rec), GFP_KERNEL);
+	if (!rec)
+		return;
+	snd_pcm_stream_lock_irq(substream);
+	*rec = substream->flight;
+	snd_pcm_stream_unlock_irq(substream);
+	snd_iprintf(buffer, "recent events (%u total):\n", rec->head);
+	snd_pcm_flight_print(buffer, rec);
+
+	snd_pcm_stream_lock_irq(substream);
+	*rec = substream->flight_xrun;
+	snd_pcm_stream_unlock_irq(substream);
+	snd_iprintf(buffer, "before the last xrun:\n");
+	snd_pcm_flight_print(buffer, rec);
+	kfree(rec);
+}
+#endif /* CONFIG_SND_PCM_FLIGHT_RECORDER */
+
 static int snd_pcm_stream_proc_init(struct snd_pcm_str *pstr)
 {
 	struct snd_pcm *pcm = pstr->pcm;
@@ -653,6 +802,36 @@ static int snd_pcm_substream_proc_init(struct snd_pcm_substream *substream)
 	substream->proc_xrun_injection_entry = entry;
 #endif /* CONFIG_SND_PCM_XRUN_DEBUG */
 
+#ifdef CONFIG_SND_PCM_STATS
+	entry = snd_info_create_card_entry(card, "stats",
+					   substream->proc_root);
+	if (entry) {
+		snd_info_set_text_ops(entry, substream,
+				      snd_pcm_substream_proc_stats_read);
+		entry->c.text.write = snd_pcm_substream_proc_stats_write;
+		entry->mode |= S_IWUSR;
+		if (snd_info_register(entry) < 0) {
+			snd_info_free_entry(entry);
+			entry = NULL;
+		}
+	}
+	substream->proc_stats_entry = entry;
+#endif /* CONFIG_SND_PCM_STATS */
+
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+	entry = snd_info_create_card_entry(card, "flight",
+					   substream->proc_root);
+	if (entry) {
+		snd_info_set_text_ops(entry, substream,
+				      snd_pcm_substream_proc_flight_read);
+		if (snd_info_register(entry) < 0) {
+			snd_info_free_entry(entry);
+			entry = NULL;
+		}
+	}
+	substream->proc_flight_entry = entry;
+#endif /* CONFIG_SND_PCM_FLIGHT_RECORDER */
+
 	return 0;
 }
 
@@ -669,6 +848,14 @@ static int snd_pcm_substream_proc_done(struct snd_pcm_substream *substream)
 #ifdef CONFIG_SND_PCM_XRUN_DEBUG
 	snd_info_free_entry(substream->proc_xrun_injection_entry);
 	substream->proc_xrun_injection_entry = NULL;
+#endif
+#ifdef CONFIG_SND_PCM_STATS
+	snd_info_free_entry(substream->proc_stats_entry);
+	substream->proc_stats_entry = NULL;
+#endif
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+	snd_info_free_entry(substream->proc_flight_entry);
+	substream->proc_flight_entry = NULL;
 #endif
 	snd_info_free_entry(substream->proc_root);
 	substream->proc_root = NULL;
@@ -734,6 +921,7 @@ int snd_pcm_new_stream(struct snd_pcm *pcm, int stream, int substream_count)
 		substream->stream = stream;
 		sprintf(substream->name, "subdevice #%i", idx);
 		substream->buffer_bytes_max = UINT_MAX;
+		snd_pcm_lib_preallocate_init(substream);
 		if (prev == NULL)
 			pstr->substream = substream;
 		else
@@ -753,10 +941,9 @@ int snd_pcm_new_stream(struct snd_pcm *pcm, int stream, int substream_count)
 			}
 		}
 		substream->group = &substream->self_group;
-		spin_lock_init(&substream->self_group.lock);
-		mutex_init(&substream->self_group.mutex);
-		INIT_LIST_HEAD(&substream->self_group.substreams);
+		snd_pcm_group_init(&substream->self_group);
 		list_add_tail(&substream->link_list, &substream->self_group.substreams);
+		substream->self_group.count = 1;
 		atomic_set(&substream->mmap_count, 0);
 		prev = substream;
 	}
@@ -956,7 +1143,11 @@ int snd_pcm_attach_substream(struct snd_pcm *pcm, int stream,
 		return -ENODEV;
 
 	card = pcm->card;
-	prefer_subdevice = snd_ctl_get_preferred_subdevice(card, SND_CTL_SUBDEV_PCM);
+	/* a NULL file is an open from the kernel, e.g. the shared device */
+	if (file)
+		prefer_subdevice = snd_ctl_get_preferred_subdevice(card, SND_CTL_SUBDEV_PCM);
+	else
+		prefer_subdevice = -1;
 
 	if (pcm->info_flags & SNDRV_PCM_INFO_HALF_DUPLEX) {
 		int opposite = !stream;
@@ -968,7 +1159,7 @@ int snd_pcm_attach_substream(struct snd_pcm *pcm, int stream,
 		}
 	}
 
-	if (file->f_flags & O_APPEND) {
+	if (file && (file->f_flags & O_APPEND)) {
 		if (prefer_subdevice < 0) {
 			if (pstr->substream_count > 1)
 				return -EINVAL; /* must be unique */
@@ -1021,13 +1212,16 @@ int snd_pcm_attach_substream(struct snd_pcm *pcm, int stream,
 
 	init_waitqueue_head(&runtime->sleep);
 	init_waitqueue_head(&runtime->tsleep);
+	hrtimer_init(&substream->wakeup_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	substream->wakeup_timer.function = snd_pcm_wakeup_timer_func;
 
 	runtime->status->state = SNDRV_PCM_STATE_OPEN;
 
 	substream->runtime = runtime;
 	substream->private_data = pcm->private_data;
 	substream->ref_count = 1;
-	substream->f_flags = file->f_flags;
+	substream->f_flags = file ? file->f_flags : 0;
 	substream->pid = get_pid(task_pid(current));
 	pstr->substream_opened++;
 	*rsubstream = substream;
@@ -1041,18 +1235,24 @@ void snd_pcm_detach_substream(struct snd_pcm_substream *substream)
 	if (PCM_RUNTIME_CHECK(substream))
 		return;
 	runtime = substream->runtime;
+	hrtimer_cancel(&substream->wakeup_timer);
 	if (runtime->private_free != NULL)
 		runtime->private_free(runtime);
 	snd_free_pages((void*)runtime->status,
 		       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_status)));
 	snd_free_pages((void*)runtime->control,
 		       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control)));
+	snd_free_pages(runtime->tstamp_ring, PAGE_SIZE);
+	snd_pcm_compat_mmap_free(runtime);
+	kfree(runtime->deinterleave_buf);
 	kfree(runtime->hw_constraints.rules);
+	kfree(runtime->refine_cache);
 	kfree(runtime);
 	substream->runtime = NULL;
 	put_pid(substream->pid);
 	substream->pid = NULL;
 	substream->pstr->substream_opened--;
+	snd_pcm_lib_preallocate_release(substream);
 }
 
 static ssize_t show_pcm_class(struct device *dev,
@@ -1234,7 +1434,162 @@ static void snd_pcm_proc_read(struct snd_info_entry *entry,
 	mutex_unlock(&register_mutex);
 }
 
+/*
+ * binary status of all substreams for the monitoring tools; the snapshot
+ * is taken at the read from the position zero, so that it can be polled
+ * via pread() without reopening.  The record buffer follows the number
+ * of substreams, up to the size limit of the file.
+ */
+#define SND_PCM_STATUS_FILE_SIZE	(256 * 1024)
+
+struct snd_pcm_status_file {
+	struct mutex lock;
+	size_t len;
+	size_t alloc;			/* records in rec */
+	struct snd_pcm_status_record *rec;
+};
+
+static void snd_pcm_status_record_fill(struct snd_pcm_substream *substream,
+				       struct snd_pcm_status_record *rec)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->size = sizeof(*rec);
+	rec->card = substream->pcm->card->number;
+	rec->device = substream->pcm->device;
+	rec->subdevice = substream->number;
+	rec->stream = substream->stream;
+	rec->state = -1;
+	rec->owner_pid = -1;
+	rec->format = -1;
+	if (!runtime)
+		return;
+
+	rec->owner_pid = pid_vnr(substream->pid);
+	snd_pcm_stream_lock_irq(substream);
+	rec->state = runtime->status->state;
+#ifdef CONFIG_SND_PCM_STATS
+	rec->xruns = substream->stats.xruns;
+#endif
+	if (rec->state != SNDRV_PCM_STATE_OPEN) {
+		rec->format = runtime->format;
+		rec->rate = runtime->rate;
+		rec->channels = runtime->channels;
+		rec->period_size = runtime->period_size;
+		rec->buffer_size = runtime->buffer_size;
+		rec->hw_ptr = runtime->status->hw_ptr;
+		rec->appl_ptr = runtime->control->appl_ptr;
+		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+			rec->avail = snd_pcm_playback_avail(runtime);
+		else
+			rec->avail = snd_pcm_capture_avail(runtime);
+	}
+	snd_pcm_stream_unlock_irq(substream);
+}
+
+static int snd_pcm_status_file_update(struct snd_pcm_status_file *sf)
+{
+	const size_t max = SND_PCM_STATUS_FILE_SIZE / sizeof(sf->rec[0]);
+	struct snd_pcm_substream *substream;
+	struct snd_pcm *pcm;
+	size_t n = 0;
+	int stream;
+
+	mutex_lock(&register_mutex);
+	list_for_each_entry(pcm, &snd_pcm_devices, list)
+		n += pcm->streams[0].substream_count +
+		     pcm->streams[1].substream_count;
+	n = min(n, max);
+	if (n > sf->alloc) {
+		kvfree(sf->rec);
+		sf->alloc = 0;
+		sf->len = 0;
+		sf->rec = kvmalloc_array(n, sizeof(sf->rec[0]), GFP_KERNEL);
+		if (!sf->rec) {
+			mutex_unlock(&register_mutex);
+			return -ENOMEM;
+		}
+		sf->alloc = n;
+	}
+
+	n = 0;
+	list_for_each_entry(pcm, &snd_pcm_devices, list) {
+		mutex_lock(&pcm->open_mutex);
+		for (stream = 0; stream < 2; stream++) {
+			for (substream = pcm->streams[stream].substream;
+			     substream && n < sf->alloc;
+			     substream = substream->next)
+				snd_pcm_status_record_fill(substream,
+							   &sf->rec[n++]);
+		}
+		mutex_unlock(&pcm->open_mutex);
+	}
+	mutex_unlock(&register_mutex);
+	sf->len = n * sizeof(sf->rec[0]);
+	return 0;
+}
+
+static int snd_pcm_status_file_open(struct snd_info_entry *entry,
+				    unsigned short mode, void **file_private_data)
+{
+	struct snd_pcm_status_file *sf;
+
+	sf = kzalloc(sizeof(*sf), GFP_KERNEL);
+	if (!sf)
+		return -ENOMEM;
+	mutex_init(&sf->lock);
+	*file_private_data = sf;
+	return 0;
+}
+
+static int snd_pcm_status_file_release(struct snd_info_entry *entry,
+				       unsigned short mode,
+				       void *file_private_data)
+{
+	struct snd_pcm_status_file *sf = file_private_data;
+
+	kvfree(sf->rec);
+	kfree(sf);
+	return 0;
+}
+
+static ssize_t snd_pcm_status_file_read(struct snd_info_entry *entry,
+					void *file_private_data,
+					struct file *file, char __user *buf,
+					size_t count, loff_t pos)
+{
+	struct snd_pcm_status_file *sf = file_private_data;
+	ssize_t ret;
+
+	mutex_lock(&sf->lock);
+	if (!pos) {
+		ret = snd_pcm_status_file_update(sf);
+		if (ret < 0)
+			goto unlock;
+	}
+	if (pos >= sf->len) {
+		ret = 0;
+		goto unlock;
+	}
+	count = min_t(size_t, count, sf->len - pos);
+	if (copy_to_user(buf, (char *)sf->rec + pos, count))
+		ret = -EFAULT;
+	else
+		ret = count;
+ unlock:
+	mutex_unlock(&sf->lock);
+	return ret;
+}
+
+static struct snd_info_entry_ops snd_pcm_status_file_ops = {
+	.open = snd_pcm_status_file_open,
+	.release = snd_pcm_status_file_release,
+	.read = snd_pcm_status_file_read,
+};
+
 static struct snd_info_entry *snd_pcm_proc_entry;
+static struct snd_info_entry *snd_pcm_proc_status_entry;
 
 static void snd_pcm_proc_init(void)
 {
@@ -1249,10 +1604,23 @@ static void snd_pcm_proc_init(void)
 		}
 	}
 	snd_pcm_proc_entry = entry;
+
+	entry = snd_info_create_module_entry(THIS_MODULE, "pcm_status", NULL);
+	if (entry) {
+		entry->content = SNDRV_INFO_CONTENT_DATA;
+		entry->c.ops = &snd_pcm_status_file_ops;
+		entry->size = SND_PCM_STATUS_FILE_SIZE;
+		if (snd_info_register(entry) < 0) {
+			snd_info_free_entry(entry);
+			entry = NULL;
+		}
+	}
+	snd_pcm_proc_status_entry = entry;
 }
 
 static void snd_pcm_proc_done(void)
 {
+	snd_info_free_entry(snd_pcm_proc_status_entry);
 	snd_info_free_entry(snd_pcm_proc_entry);
 }
 
@@ -1268,6 +1636,11 @@ static void snd_pcm_proc_done(void)
 
 static int __init alsa_pcm_init(void)
 {
+	int err;
+
+	err = snd_dma_pool_init();
+	if (err < 0)
+		return err;
 	snd_ctl_register_ioctl(snd_pcm_control_ioctl);
 	snd_ctl_register_ioctl_compat(snd_pcm_control_ioctl);
 	snd_pcm_proc_init();
@@ -1279,6 +1652,7 @@ static void __exit alsa_pcm_exit(void)
 	snd_ctl_unregister_ioctl(snd_pcm_control_ioctl);
 	snd_ctl_unregister_ioctl_compat(snd_pcm_control_ioctl);
 	snd_pcm_proc_done();
+	snd_dma_pool_exit();
 }
 
 module_init(alsa_pcm_init)
@@ -99,7 +99,8 @@ struct snd_pcm_sw_params32 {
 	u32 boundary;
 	u32 proto;
 	u32 tstamp_type;
-	unsigned char reserved[56];
+	u32 wakeup_frames;
+	unsigned char reserved[52];
 };
 
 /* recalcuate the boundary within 32bit */
@@ -133,6 +134,7 @@ static int snd_pcm_ioctl_sw_params_compat(struct snd_pcm_substream *substream,
 	    get_user(params.silence_threshold, &src->silence_threshold) ||
 	    get_user(params.silence_size, &src->silence_size) ||
 	    get_user(params.tstamp_type, &src->tstamp_type) ||
+	    get_user(params.wakeup_frames, &src->wakeup_frames) ||
 	    get_user(params.proto, &src->proto))
 		return -EFAULT;
 	/*
@@ -312,9 +314,9 @@ static int snd_pcm_status_user_x32(struct snd_pcm_substream *substream,
 }
 #endif /* CONFIG_X86_X32 */
 
-/* both for HW_PARAMS and HW_REFINE */
+/* for HW_PARAMS, HW_REFINE and HW_RECONFIG */
 static int snd_pcm_ioctl_hw_params_compat(struct snd_pcm_substream *substream,
-					  int refine, 
+					  int refine, bool reconfig,
 					  struct snd_pcm_hw_params32 __user *data32)
 {
 	struct snd_pcm_hw_params *data;
@@ -336,6 +338,8 @@ static int snd_pcm_ioctl_hw_params_compat(struct snd_pcm_substream *substream,
 
 	if (refine)
 		err = snd_pcm_hw_refine(substream, data);
+	else if (reconfig)
+		err = snd_pcm_hw_reconfig(substream, data);
 	else
 		err = snd_pcm_hw_params(substream, data);
 	if (err < 0)
@@ -524,6 +528,7 @@ static int snd_pcm_ioctl_sync_ptr_compat(struct snd_pcm_substream *substream,
 	sstatus.tstamp = status->tstamp;
 	sstatus.suspended_state = status->suspended_state;
 	sstatus.audio_tstamp = status->audio_tstamp;
+	snd_pcm_compat_mmap_update(runtime);
 	snd_pcm_stream_unlock_irq(substream);
 	if (put_user(sstatus.state, &src->s.status.state) ||
 	    put_user(sstatus.hw_ptr, &src->s.status.hw_ptr) ||
@@ -538,6 +543,178 @@ static int snd_pcm_ioctl_sync_ptr_compat(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * mmap of the status and control records for 32-bit clients
+ *
+ * The native records can't be shared with a 32-bit client because of the
+ * different layout, so it maps a copy in its own layout instead, allocated
+ * at the first mmap.  The core publishes the native records there at each
+ * update, and takes over the appl_ptr and avail_min that the client wrote
+ * at the next hw_ptr update, poll or ioctl.  The boundary set up via the
+ * 32-bit hw_params fits in 32 bits (see recalculate_boundary()), so the
+ * positions are copied as they are.
+ */
+struct snd_pcm_compat_mmap {
+	struct snd_pcm_mmap_status32 *status;
+	struct snd_pcm_mmap_control32 *control;
+	u32 appl_ptr;		/* the control values last seen there */
+	u32 avail_min;
+};
+
+void __snd_pcm_compat_mmap_sync(struct snd_pcm_runtime *runtime)
+{
+	struct snd_pcm_compat_mmap *cmap = runtime->compat_mmap;
+	u32 appl_ptr = READ_ONCE(cmap->control->appl_ptr);
+	u32 avail_min = READ_ONCE(cmap->control->avail_min);
+
+	if (appl_ptr != cmap->appl_ptr && appl_ptr < runtime->boundary)
+		runtime->control->appl_ptr = appl_ptr;
+	if (avail_min != cmap->avail_min)
+		runtime->control->avail_min = avail_min;
+	cmap->appl_ptr = appl_ptr;
+	cmap->avail_min = avail_min;
+}
+
+/*
+ * Publish a control value changed by the kernel, unless the client wrote
+ * the field since the last sync: the client's value is then kept for the
+ * next sync to take over, as the shadow still differs from it.
+ */
+static void snd_pcm_compat_mmap_publish(u32 *field, u32 *shadow, u32 val)
+{
+	if (val != *shadow && cmpxchg(field, *shadow, val) == *shadow)
+		*shadow = val;
+}
+
+void __snd_pcm_compat_mmap_update(struct snd_pcm_runtime *runtime)
+{
+	struct snd_pcm_compat_mmap *cmap = runtime->compat_mmap;
+	struct snd_pcm_mmap_status32 *status = cmap->status;
+
+	/* don't overwrite what the client wrote since the last sync */
+	__snd_pcm_compat_mmap_sync(runtime);
+
+	/* same sequence counter in pad1 as the native live status */
+	if (runtime->live_status) {
+		status->pad1++;
+		smp_wmb();
+	}
+	status->state = runtime->status->state;
+	status->hw_ptr = runtime->status->hw_ptr;
+	status->tstamp.tv_sec = runtime->status->tstamp.tv_sec;
+	status->tstamp.tv_nsec = runtime->status->tstamp.tv_nsec;
+	status->suspended_state = runtime->status->suspended_state;
+	status->audio_tstamp.tv_sec = runtime->status->audio_tstamp.tv_sec;
+	status->audio_tstamp.tv_nsec = runtime->status->audio_tstamp.tv_nsec;
+	if (runtime->live_status) {
+		smp_wmb();
+		status->pad1++;
+	}
+
+	snd_pcm_compat_mmap_publish(&cmap->control->appl_ptr, &cmap->appl_ptr,
+				    runtime->control->appl_ptr);
+	snd_pcm_compat_mmap_publish(&cmap->control->avail_min,
+				    &cmap->avail_min,
+				    runtime->control->avail_min);
+}
+
+static void snd_pcm_compat_mmap_sync_locked(struct snd_pcm_substream *substream)
+{
+	if (!substream->runtime || !substream->runtime->compat_mmap)
+		return;
+	snd_pcm_stream_lock_irq(substream);
+	snd_pcm_compat_mmap_sync(substream->runtime);
+	snd_pcm_stream_unlock_irq(substream);
+}
+
+static int snd_pcm_compat_mmap_alloc(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_compat_mmap *cmap;
+	int err = -ENOMEM;
+
+	if (runtime->compat_mmap)
+		return 0;
+	cmap = kzalloc(sizeof(*cmap), GFP_KERNEL);
+	if (!cmap)
+		return -ENOMEM;
+	cmap->status = snd_malloc_pages(PAGE_SIZE, GFP_KERNEL);
+	cmap->control = snd_malloc_pages(PAGE_SIZE, GFP_KERNEL);
+	if (!cmap->status || !cmap->control)
+		goto out;
+	memset(cmap->status, 0, PAGE_SIZE);
+	memset(cmap->control, 0, PAGE_SIZE);
+
+	snd_pcm_stream_lock_irq(substream);
+	if (!runtime->compat_mmap) {
+		runtime->compat_mmap = cmap;
+		__snd_pcm_compat_mmap_update(runtime);
+		cmap = NULL;
+	}
+	snd_pcm_stream_unlock_irq(substream);
+	err = 0;
+ out:
+	if (cmap) {
+		snd_free_pages(cmap->status, PAGE_SIZE);
+		snd_free_pages(cmap->control, PAGE_SIZE);
+		kfree(cmap);
+	}
+	return err;
+}
+
+void snd_pcm_compat_mmap_free(struct snd_pcm_runtime *runtime)
+{
+	struct snd_pcm_compat_mmap *cmap = runtime->compat_mmap;
+
+	if (!cmap)
+		return;
+	snd_free_pages(cmap->status, PAGE_SIZE);
+	snd_free_pages(cmap->control, PAGE_SIZE);
+	kfree(cmap);
+	runtime->compat_mmap = NULL;
+}
+
+static int snd_pcm_mmap_compat_fault(struct vm_fault *vmf)
+{
+	vmf->page = virt_to_page(vmf->vma->vm_private_data);
+	get_page(vmf->page);
+	return 0;
+}
+
+static const struct vm_operations_struct snd_pcm_vm_ops_compat =
+{
+	.fault =	snd_pcm_mmap_compat_fault,
+};
+
+/* mmap the 32-bit status or control record */
+int snd_pcm_mmap_compat(struct snd_pcm_substream *substream,
+			struct vm_area_struct *area)
+{
+	struct snd_pcm_compat_mmap *cmap;
+	int err;
+
+#ifdef CONFIG_X86_X32
+	/* X32 has 64bit timespec, the records don't match */
+	if (in_x32_syscall())
+		return -ENXIO;
+#endif
+	if (!(area->vm_flags & VM_READ))
+		return -EINVAL;
+	if (area->vm_end - area->vm_start != PAGE_SIZE)
+		return -EINVAL;
+	err = snd_pcm_compat_mmap_alloc(substream);
+	if (err < 0)
+		return err;
+	cmap = substream->runtime->compat_mmap;
+	area->vm_ops = &snd_pcm_vm_ops_compat;
+	if ((area->vm_pgoff << PAGE_SHIFT) == SNDRV_PCM_MMAP_OFFSET_STATUS)
+		area->vm_private_data = cmap->status;
+	else
+		area->vm_private_data = cmap->control;
+	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	return 0;
+}
+
 #ifdef CONFIG_X86_X32
 /* X32 ABI has 64bit timespec and 64bit alignment */
 struct snd_pcm_mmap_status_x32 {
@@ -632,6 +809,7 @@ static int snd_pcm_ioctl_sync_ptr_x32(struct snd_pcm_substream *substream,
 enum {
 	SNDRV_PCM_IOCTL_HW_REFINE32 = _IOWR('A', 0x10, struct snd_pcm_hw_params32),
 	SNDRV_PCM_IOCTL_HW_PARAMS32 = _IOWR('A', 0x11, struct snd_pcm_hw_params32),
+	SNDRV_PCM_IOCTL_HW_RECONFIG32 = _IOWR('A', 0x14, struct snd_pcm_hw_params32),
 	SNDRV_PCM_IOCTL_SW_PARAMS32 = _IOWR('A', 0x13, struct snd_pcm_sw_params32),
 	SNDRV_PCM_IOCTL_STATUS32 = _IOR('A', 0x20, struct snd_pcm_status32),
 	SNDRV_PCM_IOCTL_STATUS_EXT32 = _IOWR('A', 0x24, struct snd_pcm_status32),
@@ -666,11 +844,16 @@ static long snd_pcm_ioctl_compat(struct file *file, unsigned int cmd, unsigned l
 		return -ENOTTY;
 
 	/*
-	 * When PCM is used on 32bit mode, we need to disable
-	 * mmap of PCM status/control records because of the size
-	 * incompatibility.
+	 * When PCM is used on 32bit mode, the status/control records
+	 * are mapped in the 32bit layout because of the size
+	 * incompatibility.  Take over what the client wrote there.
 	 */
-	pcm_file->no_compat_mmap = 1;
+	pcm_file->compat_mmap = 1;
+	snd_pcm_compat_mmap_sync_locked(substream);
+
+	/* fan-out readers only get the layout-independent ioctls */
+	if (pcm_file->fanout)
+		return snd_pcm_common_ioctl(file, substream, cmd, argp);
 
 	switch (cmd) {
 	case SNDRV_PCM_IOCTL_PVERSION:
@@ -690,11 +873,16 @@ static long snd_pcm_ioctl_compat(struct file *file, unsigned int cmd, unsigned l
 	case SNDRV_PCM_IOCTL_XRUN:
 	case SNDRV_PCM_IOCTL_LINK:
 	case SNDRV_PCM_IOCTL_UNLINK:
+	case SNDRV_PCM_IOCTL_FANOUT:
+	case SNDRV_PCM_IOCTL_HANDOFF:
+	case SNDRV_PCM_IOCTL_LATENCY:
 		return snd_pcm_common_ioctl(file, substream, cmd, argp);
 	case SNDRV_PCM_IOCTL_HW_REFINE32:
-		return snd_pcm_ioctl_hw_params_compat(substream, 1, argp);
+		return snd_pcm_ioctl_hw_params_compat(substream, 1, false, argp);
 	case SNDRV_PCM_IOCTL_HW_PARAMS32:
-		return snd_pcm_ioctl_hw_params_compat(substream, 0, argp);
+		return snd_pcm_ioctl_hw_params_compat(substream, 0, false, argp);
+	case SNDRV_PCM_IOCTL_HW_RECONFIG32:
+		return snd_pcm_ioctl_hw_params_compat(substream, 0, true, argp);
 	case SNDRV_PCM_IOCTL_SW_PARAMS32:
 		return snd_pcm_ioctl_sw_params_compat(substream, argp);
 	case SNDRV_PCM_IOCTL_STATUS32:
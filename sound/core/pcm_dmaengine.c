@@ -33,6 +33,12 @@ struct dmaengine_pcm_runtime_data {
 	dma_cookie_t cookie;
 
 	unsigned int pos;
+	bool no_residue;	/* residue only updates per descriptor */
+	bool residue_burst;	/* residue updates per burst */
+
+	/* periods signalled by a timer, see snd_dmaengine_pcm_use_period_timer */
+	struct snd_pcm_period_timer timer;
+	bool period_timer;
 };
 
 static inline struct dmaengine_pcm_runtime_data *substream_to_prtd(
@@ -149,6 +155,18 @@ static void dmaengine_pcm_dma_complete(void *arg)
 	snd_pcm_period_elapsed(substream);
 }
 
+static void dmaengine_pcm_start_timer(struct dmaengine_pcm_runtime_data *prtd)
+{
+	if (prtd->period_timer)
+		snd_pcm_period_timer_start(&prtd->timer);
+}
+
+static void dmaengine_pcm_stop_timer(struct dmaengine_pcm_runtime_data *prtd)
+{
+	if (prtd->period_timer)
+		snd_pcm_period_timer_stop(&prtd->timer);
+}
+
 static int dmaengine_pcm_prepare_and_submit(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
@@ -156,17 +174,27 @@ static int dmaengine_pcm_prepare_and_submit(struct snd_pcm_substream *substream)
 	struct dma_async_tx_descriptor *desc;
 	enum dma_transfer_direction direction;
 	unsigned long flags = DMA_CTRL_ACK;
+	size_t period_len;
 
 	direction = snd_pcm_substream_to_dma_direction(substream);
 
-	if (!substream->runtime->no_period_wakeup)
-		flags |= DMA_PREP_INTERRUPT;
+	/*
+	 * With the period timer the DMA runs the buffer as a single period
+	 * and doesn't interrupt at all; positions come from the residue.
+	 */
+	if (prtd->period_timer) {
+		period_len = snd_pcm_lib_buffer_bytes(substream);
+	} else {
+		period_len = snd_pcm_lib_period_bytes(substream);
+		if (!substream->runtime->no_period_wakeup)
+			flags |= DMA_PREP_INTERRUPT;
+	}
 
 	prtd->pos = 0;
 	desc = dmaengine_prep_dma_cyclic(chan,
 		substream->runtime->dma_addr,
 		snd_pcm_lib_buffer_bytes(substream),
-		snd_pcm_lib_period_bytes(substream), direction, flags);
+		period_len, direction, flags);
 
 	if (!desc)
 		return -ENOMEM;
@@ -200,21 +228,26 @@ int snd_dmaengine_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		if (ret)
 			return ret;
 		dma_async_issue_pending(prtd->dma_chan);
+		dmaengine_pcm_start_timer(prtd);
 		break;
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		dmaengine_resume(prtd->dma_chan);
+		dmaengine_pcm_start_timer(prtd);
 		break;
 	case SNDRV_PCM_TRIGGER_SUSPEND:
+		dmaengine_pcm_stop_timer(prtd);
 		if (runtime->info & SNDRV_PCM_INFO_PAUSE)
 			dmaengine_pause(prtd->dma_chan);
 		else
 			dmaengine_terminate_async(prtd->dma_chan);
 		break;
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		dmaengine_pcm_stop_timer(prtd);
 		dmaengine_pause(prtd->dma_chan);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
+		dmaengine_pcm_stop_timer(prtd);
 		dmaengine_terminate_async(prtd->dma_chan);
 		break;
 	default:
@@ -244,7 +277,9 @@ EXPORT_SYMBOL_GPL(snd_dmaengine_pcm_pointer_no_residue);
  * @substream: PCM substream
  *
  * This function can be used as the PCM pointer callback for dmaengine based PCM
- * driver implementations.
+ * driver implementations.  If the channel only reports the residue per
+ * descriptor, which for a cyclic transfer means never, the position is taken
+ * from the period count instead of querying the channel.
  */
 snd_pcm_uframes_t snd_dmaengine_pcm_pointer(struct snd_pcm_substream *substream)
 {
@@ -254,6 +289,9 @@ snd_pcm_uframes_t snd_dmaengine_pcm_pointer(struct snd_pcm_substream *substream)
 	unsigned int buf_size;
 	unsigned int pos = 0;
 
+	if (prtd->no_residue)
+		return snd_dmaengine_pcm_pointer_no_residue(substream);
+
 	status = dmaengine_tx_status(prtd->dma_chan, prtd->cookie, &state);
 	if (status == DMA_IN_PROGRESS || status == DMA_PAUSED) {
 		buf_size = snd_pcm_lib_buffer_bytes(substream);
@@ -265,6 +303,27 @@ snd_pcm_uframes_t snd_dmaengine_pcm_pointer(struct snd_pcm_substream *substream)
 }
 EXPORT_SYMBOL_GPL(snd_dmaengine_pcm_pointer);
 
+/**
+ * snd_dmaengine_pcm_use_period_timer - Signal periods from a timer
+ * @substream: PCM substream
+ *
+ * Makes the DMA transfer run the whole buffer as a single cyclic period
+ * without interrupts and calls snd_pcm_period_elapsed() from an hrtimer at
+ * the period rate instead, so that short periods don't cost a DMA interrupt
+ * each.  Only useful with snd_dmaengine_pcm_pointer() on a channel which
+ * reports the residue per burst; with a per segment residue, the whole
+ * buffer is a single segment and the position would stand still.  Ignored
+ * on other channels.  Call it after snd_dmaengine_pcm_open().
+ */
+void snd_dmaengine_pcm_use_period_timer(struct snd_pcm_substream *substream)
+{
+	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
+
+	if (prtd->residue_burst)
+		prtd->period_timer = true;
+}
+EXPORT_SYMBOL_GPL(snd_dmaengine_pcm_use_period_timer);
+
 /**
  * snd_dmaengine_pcm_request_channel - Request channel for the dmaengine PCM
  * @filter_fn: Filter function used to request the DMA channel
@@ -302,6 +361,7 @@ int snd_dmaengine_pcm_open(struct snd_pcm_substream *substream,
 	struct dma_chan *chan)
 {
 	struct dmaengine_pcm_runtime_data *prtd;
+	struct dma_slave_caps dma_caps;
 	int ret;
 
 	if (!chan)
@@ -317,6 +377,15 @@ int snd_dmaengine_pcm_open(struct snd_pcm_substream *substream,
 		return -ENOMEM;
 
 	prtd->dma_chan = chan;
+	snd_pcm_period_timer_init(&prtd->timer, substream);
+
+	/* the granularity is fixed per channel, so look it up only once */
+	if (dma_get_slave_caps(chan, &dma_caps) == 0) {
+		prtd->no_residue = dma_caps.residue_granularity ==
+			DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+		prtd->residue_burst = dma_caps.residue_granularity ==
+			DMA_RESIDUE_GRANULARITY_BURST;
+	}
 
 	substream->runtime->private_data = prtd;
 
@@ -353,6 +422,7 @@ int snd_dmaengine_pcm_close(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
 
+	snd_pcm_period_timer_sync(&prtd->timer);
 	dmaengine_synchronize(prtd->dma_chan);
 	kfree(prtd);
 
@@ -370,6 +440,7 @@ int snd_dmaengine_pcm_close_release_chan(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
 
+	snd_pcm_period_timer_sync(&prtd->timer);
 	dmaengine_synchronize(prtd->dma_chan);
 	dma_release_channel(prtd->dma_chan);
 	kfree(prtd);
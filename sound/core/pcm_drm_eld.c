@@ -25,28 +25,60 @@ static unsigned int sad_max_channels(const u8 *sad)
 	return 1 + (sad[0] & 7);
 }
 
+/*
+ * The rules only need the highest channel count the sink takes at each of
+ * the eld_rates, so it is computed once from the SADs when the constraint
+ * is added and packed, four bits per rate, into the rule private value.
+ * The rules are then evaluated many times during the hw_params refinement
+ * without parsing the ELD again.
+ */
+#define ELD_CAPS_SHIFT		4
+#define ELD_CAPS_MASK		0xf
+
+static unsigned long eld_caps(const u8 *eld)
+{
+	unsigned long caps = 0;
+	unsigned int i, j, ch;
+	const u8 *sad;
+
+	sad = drm_eld_sad(eld);
+	if (!sad)
+		return 0;
+	for (i = drm_eld_sad_count(eld); i > 0; i--, sad += 3) {
+		ch = sad_max_channels(sad);
+		for (j = 0; j < ARRAY_SIZE(eld_rates); j++) {
+			if ((sad[1] & BIT(j)) &&
+			    ch > ((caps >> (j * ELD_CAPS_SHIFT)) & ELD_CAPS_MASK)) {
+				caps &= ~((unsigned long)ELD_CAPS_MASK << (j * ELD_CAPS_SHIFT));
+				caps |= (unsigned long)ch << (j * ELD_CAPS_SHIFT);
+			}
+		}
+	}
+	return caps;
+}
+
+static unsigned int eld_caps_channels(unsigned long caps, unsigned int rate)
+{
+	return (caps >> (rate * ELD_CAPS_SHIFT)) & ELD_CAPS_MASK;
+}
+
 static int eld_limit_rates(struct snd_pcm_hw_params *params,
 			   struct snd_pcm_hw_rule *rule)
 {
 	struct snd_interval *r = hw_param_interval(params, rule->var);
 	const struct snd_interval *c;
-	unsigned int rate_mask = 7, i;
-	const u8 *sad, *eld = rule->private;
-
-	sad = drm_eld_sad(eld);
-	if (sad) {
-		c = hw_param_interval_c(params, SNDRV_PCM_HW_PARAM_CHANNELS);
-
-		for (i = drm_eld_sad_count(eld); i > 0; i--, sad += 3) {
-			unsigned max_channels = sad_max_channels(sad);
-
-			/*
-			 * Exclude SADs which do not include the
-			 * requested number of channels.
-			 */
-			if (c->min <= max_channels)
-				rate_mask |= sad[1];
-		}
+	unsigned long caps = (unsigned long)rule->private;
+	unsigned int rate_mask = 7, i, ch;
+
+	c = hw_param_interval_c(params, SNDRV_PCM_HW_PARAM_CHANNELS);
+	for (i = 0; i < ARRAY_SIZE(eld_rates); i++) {
+		/*
+		 * Exclude rates of SADs which do not include the
+		 * requested number of channels.
+		 */
+		ch = eld_caps_channels(caps, i);
+		if (ch && c->min <= ch)
+			rate_mask |= BIT(i);
 	}
 
 	return snd_interval_list(r, ARRAY_SIZE(eld_rates), eld_rates,
@@ -59,39 +91,40 @@ static int eld_limit_channels(struct snd_pcm_hw_params *params,
 	struct snd_interval *c = hw_param_interval(params, rule->var);
 	const struct snd_interval *r;
 	struct snd_interval t = { .min = 1, .max = 2, .integer = 1, };
+	unsigned long caps = (unsigned long)rule->private;
 	unsigned int i;
-	const u8 *sad, *eld = rule->private;
 
-	sad = drm_eld_sad(eld);
-	if (sad) {
-		unsigned int rate_mask = 0;
-
-		/* Convert the rate interval to a mask */
-		r = hw_param_interval_c(params, SNDRV_PCM_HW_PARAM_RATE);
-		for (i = 0; i < ARRAY_SIZE(eld_rates); i++)
-			if (r->min <= eld_rates[i] && r->max >= eld_rates[i])
-				rate_mask |= BIT(i);
-
-		for (i = drm_eld_sad_count(eld); i > 0; i--, sad += 3)
-			if (rate_mask & sad[1])
-				t.max = max(t.max, sad_max_channels(sad));
-	}
+	r = hw_param_interval_c(params, SNDRV_PCM_HW_PARAM_RATE);
+	for (i = 0; i < ARRAY_SIZE(eld_rates); i++)
+		if (r->min <= eld_rates[i] && r->max >= eld_rates[i])
+			t.max = max(t.max, eld_caps_channels(caps, i));
 
 	return snd_interval_refine(c, &t);
 }
 
+/**
+ * snd_pcm_hw_constraint_eld - restrict rates and channels to an ELD
+ * @runtime: PCM runtime instance
+ * @eld: ELD of the sink
+ *
+ * The ELD is evaluated once at this call; a later change of the ELD
+ * contents takes effect at the next open.
+ *
+ * Return: Zero if successful, or a negative error code.
+ */
 int snd_pcm_hw_constraint_eld(struct snd_pcm_runtime *runtime, void *eld)
 {
+	void *caps = (void *)eld_caps(eld);
 	int ret;
 
 	ret = snd_pcm_hw_rule_add(runtime, 0, SNDRV_PCM_HW_PARAM_RATE,
-				  eld_limit_rates, eld,
+				  eld_limit_rates, caps,
 				  SNDRV_PCM_HW_PARAM_CHANNELS, -1);
 	if (ret < 0)
 		return ret;
 
 	ret = snd_pcm_hw_rule_add(runtime, 0, SNDRV_PCM_HW_PARAM_CHANNELS,
-				  eld_limit_channels, eld,
+				  eld_limit_channels, caps,
 				  SNDRV_PCM_HW_PARAM_RATE, -1);
 
 	return ret;
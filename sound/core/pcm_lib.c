@@ -63,6 +63,9 @@ void snd_pcm_playback_silence(struct snd_pcm_substream *substream, snd_pcm_ufram
 	snd_pcm_uframes_t frames, ofs, transfer;
 	int err;
 
+	/* the silence must not cover what a 32-bit client just wrote */
+	snd_pcm_compat_mmap_sync(runtime);
+
 	if (runtime->silence_size < runtime->boundary) {
 		snd_pcm_sframes_t noise_dist, n;
 		snd_pcm_uframes_t appl_ptr = READ_ONCE(runtime->control->appl_ptr);
@@ -158,6 +161,8 @@ static void xrun(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 
 	trace_xrun(substream);
+	snd_pcm_stats_xrun(substream);
+	snd_pcm_flight_xrun(substream);
 	if (runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE)
 		snd_pcm_gettime(runtime, (struct timespec *)&runtime->status->tstamp);
 	snd_pcm_stop(substream, SNDRV_PCM_STATE_XRUN);
@@ -208,10 +213,14 @@ int snd_pcm_update_state(struct snd_pcm_substream *substream,
 			return -EPIPE;
 		}
 	}
+	/* fan-out readers track their own appl_ptr, let them check */
 	if (runtime->twake) {
 		if (avail >= runtime->twake)
 			wake_up(&runtime->tsleep);
-	} else if (avail >= runtime->control->avail_min)
+		if (runtime->fanout_readers)
+			wake_up(&runtime->sleep);
+	} else if (avail >= runtime->control->avail_min ||
+		   runtime->fanout_readers)
 		wake_up(&runtime->sleep);
 	return 0;
 }
@@ -259,8 +268,8 @@ static void update_audio_tstamp(struct snd_pcm_substream *substream,
 	runtime->driver_tstamp = driver_tstamp;
 }
 
-static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
-				  unsigned int in_interrupt)
+static int __snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
+				    unsigned int in_interrupt)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	snd_pcm_uframes_t pos;
@@ -271,6 +280,7 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	struct timespec curr_tstamp;
 	struct timespec audio_tstamp;
 	int crossed_boundary = 0;
+	bool monotonic;
 
 	old_hw_ptr = runtime->status->hw_ptr;
 
@@ -314,9 +324,18 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	}
 	pos -= pos % runtime->min_align;
 	trace_hwptr(substream, pos, in_interrupt);
+	snd_pcm_flight_record(substream, SNDRV_PCM_FLIGHT_HWPTR,
+			      in_interrupt, pos);
 	hw_base = runtime->hw_ptr_base;
 	new_hw_ptr = hw_base + pos;
-	if (in_interrupt) {
+	/*
+	 * The driver promises a pointer that is exact at any time and never
+	 * goes back, so the interrupt heuristics below don't apply to it;
+	 * only a ring wrap is taken from the position, and a whole buffer
+	 * passed between two updates from the elapsed time.
+	 */
+	monotonic = runtime->hw.info & SNDRV_PCM_INFO_MONOTONIC_POINTER;
+	if (in_interrupt && !monotonic) {
 		/* we know that one period was processed */
 		/* delta = "expected next hw_ptr" for in_interrupt != 0 */
 		delta = runtime->hw_ptr_interrupt + runtime->period_size;
@@ -349,10 +368,11 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	if (delta < 0)
 		delta += runtime->boundary;
 
-	if (runtime->no_period_wakeup) {
+	if (runtime->no_period_wakeup || monotonic) {
 		snd_pcm_sframes_t xrun_threshold;
 		/*
-		 * Without regular period interrupts, we have to check
+		 * Without regular period interrupts, or without the
+		 * heuristics for a monotonic pointer, we have to check
 		 * the elapsed time to detect xruns.
 		 */
 		jdelta = curr_jiffies - runtime->hw_ptr_jiffies;
@@ -438,7 +458,9 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 
  no_delta_check:
 	if (runtime->status->hw_ptr == new_hw_ptr) {
+		snd_pcm_live_status_begin(runtime);
 		update_audio_tstamp(substream, &curr_tstamp, &audio_tstamp);
+		snd_pcm_live_status_end(runtime);
 		return 0;
 	}
 
@@ -455,6 +477,7 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 		if (runtime->hw_ptr_interrupt >= runtime->boundary)
 			runtime->hw_ptr_interrupt -= runtime->boundary;
 	}
+	snd_pcm_live_status_begin(runtime);
 	runtime->hw_ptr_base = hw_base;
 	runtime->status->hw_ptr = new_hw_ptr;
 	runtime->hw_ptr_jiffies = curr_jiffies;
@@ -464,10 +487,22 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	}
 
 	update_audio_tstamp(substream, &curr_tstamp, &audio_tstamp);
+	snd_pcm_live_status_end(runtime);
 
 	return snd_pcm_update_state(substream, runtime);
 }
 
+static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
+				  unsigned int in_interrupt)
+{
+	u64 cost = snd_pcm_stats_cost_begin();
+	int err;
+
+	err = __snd_pcm_update_hw_ptr0(substream, in_interrupt);
+	snd_pcm_stats_cost_end(substream, SNDRV_PCM_STATS_COST_HW_PTR, cost);
+	return err;
+}
+
 /* CAUTION: call it with irq disabled */
 int snd_pcm_update_hw_ptr(struct snd_pcm_substream *substream)
 {
@@ -1690,11 +1725,15 @@ static int snd_pcm_lib_ioctl_reset(struct snd_pcm_substream *substream,
 	unsigned long flags;
 	snd_pcm_stream_lock_irqsave(substream, flags);
 	if (snd_pcm_running(substream) &&
-	    snd_pcm_update_hw_ptr(substream) >= 0)
+	    snd_pcm_update_hw_ptr(substream) >= 0) {
+		snd_pcm_live_status_begin(runtime);
 		runtime->status->hw_ptr %= runtime->buffer_size;
-	else {
+		snd_pcm_live_status_end(runtime);
+	} else {
+		snd_pcm_live_status_begin(runtime);
 		runtime->status->hw_ptr = 0;
 		runtime->hw_ptr_wrap = 0;
+		snd_pcm_live_status_end(runtime);
 	}
 	snd_pcm_stream_unlock_irqrestore(substream, flags);
 	return 0;
@@ -1791,19 +1830,43 @@ EXPORT_SYMBOL(snd_pcm_lib_ioctl);
  * Even if more than one periods have elapsed since the last call, you
  * have to call this only once.
  */
+/* record the state at a period interrupt in the mmapped tstamp ring */
+static void snd_pcm_tstamp_ring_add(struct snd_pcm_runtime *runtime)
+{
+	struct snd_pcm_tstamp_ring *ring = runtime->tstamp_ring;
+	struct snd_pcm_tstamp_sample *sample;
+
+	if (!ring)
+		return;
+	sample = &ring->samples[ring->head % ring->entries];
+	sample->hw_ptr = runtime->status->hw_ptr;
+	sample->tstamp = runtime->status->tstamp;
+	sample->audio_tstamp = runtime->status->audio_tstamp;
+	smp_wmb();
+	WRITE_ONCE(ring->head, ring->head + 1);
+}
+
 void snd_pcm_period_elapsed(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime;
+	snd_pcm_uframes_t old_hw_ptr;
 	unsigned long flags;
+	u64 cost;
 
 	if (PCM_RUNTIME_CHECK(substream))
 		return;
 	runtime = substream->runtime;
 
 	snd_pcm_stream_lock_irqsave(substream, flags);
+	cost = snd_pcm_stats_cost_begin();
+	old_hw_ptr = runtime->status->hw_ptr;
 	if (!snd_pcm_running(substream) ||
 	    snd_pcm_update_hw_ptr0(substream, 1) < 0)
 		goto _end;
+	snd_pcm_stats_period(substream, old_hw_ptr);
+	snd_pcm_tstamp_ring_add(runtime);
+	if (runtime->period_notify)
+		runtime->period_notify(substream);
 
 #ifdef CONFIG_SND_PCM_TIMER
 	if (substream->timer_running)
@@ -1811,10 +1874,230 @@ void snd_pcm_period_elapsed(struct snd_pcm_substream *substream)
 #endif
  _end:
 	kill_fasync(&runtime->fasync, SIGIO, POLL_IN);
+	snd_pcm_stats_cost_end(substream, SNDRV_PCM_STATS_COST_PERIOD, cost);
 	snd_pcm_stream_unlock_irqrestore(substream, flags);
 }
 EXPORT_SYMBOL(snd_pcm_period_elapsed);
 
+/**
+ * snd_pcm_position_update - update the position between periods
+ * @substream: the pcm substream instance
+ *
+ * For drivers getting interrupts also within a period, e.g. at BDL entry
+ * boundaries.  The hw pointer is updated and the waiters are woken up
+ * as if the position was polled, but no period is accounted; the driver
+ * still calls snd_pcm_period_elapsed() at each period boundary.
+ */
+void snd_pcm_position_update(struct snd_pcm_substream *substream)
+{
+	unsigned long flags;
+
+	if (PCM_RUNTIME_CHECK(substream))
+		return;
+
+	snd_pcm_stream_lock_irqsave(substream, flags);
+	if (snd_pcm_running(substream))
+		snd_pcm_update_hw_ptr(substream);
+	snd_pcm_stream_unlock_irqrestore(substream, flags);
+}
+EXPORT_SYMBOL(snd_pcm_position_update);
+
+static enum hrtimer_restart snd_pcm_period_timer_fn(struct hrtimer *timer)
+{
+	struct snd_pcm_period_timer *pt =
+		container_of(timer, struct snd_pcm_period_timer, timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	snd_pcm_period_elapsed(pt->substream);
+
+	/* a restart meanwhile has queued the timer again already */
+	snd_pcm_stream_lock_irqsave(pt->substream, flags);
+	if (pt->running && !hrtimer_is_queued(timer)) {
+		hrtimer_forward_now(timer, pt->period_time);
+		ret = HRTIMER_RESTART;
+	}
+	snd_pcm_stream_unlock_irqrestore(pt->substream, flags);
+	return ret;
+}
+
+/**
+ * snd_pcm_period_timer_init - set up a period timer
+ * @pt: the period timer
+ * @substream: the pcm substream instance
+ *
+ * For drivers letting the DMA run the whole buffer without period
+ * interrupts; snd_pcm_period_elapsed() is called from an hrtimer at the
+ * period rate instead, while the position is still read from the
+ * hardware.  Call snd_pcm_period_timer_sync() before freeing @pt.
+ */
+void snd_pcm_period_timer_init(struct snd_pcm_period_timer *pt,
+			       struct snd_pcm_substream *substream)
+{
+	pt->substream = substream;
+	pt->running = false;
+	hrtimer_init(&pt->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pt->timer.function = snd_pcm_period_timer_fn;
+}
+EXPORT_SYMBOL(snd_pcm_period_timer_init);
+
+/**
+ * snd_pcm_period_timer_start - start the period timer
+ * @pt: the period timer
+ *
+ * Called from the trigger callback, with the stream lock held.  Nothing
+ * is started for a stream without period wakeups.
+ */
+void snd_pcm_period_timer_start(struct snd_pcm_period_timer *pt)
+{
+	struct snd_pcm_runtime *runtime = pt->substream->runtime;
+
+	if (runtime->no_period_wakeup)
+		return;
+
+	pt->period_time = ns_to_ktime(div_u64((u64)runtime->period_size *
+					      NSEC_PER_SEC, runtime->rate));
+	pt->running = true;
+	/* the callback may still run from before a stop; it won't forward
+	 * the timer queued here
+	 */
+	hrtimer_try_to_cancel(&pt->timer);
+	hrtimer_start(&pt->timer, pt->period_time, HRTIMER_MODE_REL);
+}
+EXPORT_SYMBOL(snd_pcm_period_timer_start);
+
+/**
+ * snd_pcm_period_timer_stop - stop the period timer
+ * @pt: the period timer
+ *
+ * Called from the trigger callback, with the stream lock held, which the
+ * timer callback takes; so the callback isn't waited for, it just won't
+ * rearm.
+ */
+void snd_pcm_period_timer_stop(struct snd_pcm_period_timer *pt)
+{
+	pt->running = false;
+	hrtimer_try_to_cancel(&pt->timer);
+}
+EXPORT_SYMBOL(snd_pcm_period_timer_stop);
+
+/**
+ * snd_pcm_period_timer_sync - wait for the period timer to stop
+ * @pt: the period timer
+ *
+ * Called from the close or hw_free callback, without the stream lock.
+ */
+void snd_pcm_period_timer_sync(struct snd_pcm_period_timer *pt)
+{
+	hrtimer_cancel(&pt->timer);
+}
+EXPORT_SYMBOL(snd_pcm_period_timer_sync);
+
+/*
+ * sw_params wakeup timer
+ *
+ * When the application asks for wakeups at a finer granularity than the
+ * period size, re-read the position from an hrtimer every wakeup_frames
+ * so that poll()/read()/write() sleepers are woken as soon as avail_min
+ * is reached instead of at the next period interrupt.
+ */
+static ktime_t snd_pcm_wakeup_interval(struct snd_pcm_runtime *runtime)
+{
+	return ns_to_ktime(div_u64((u64)runtime->wakeup_frames * NSEC_PER_SEC,
+				   runtime->rate));
+}
+
+enum hrtimer_restart snd_pcm_wakeup_timer_func(struct hrtimer *timer)
+{
+	struct snd_pcm_substream *substream =
+		container_of(timer, struct snd_pcm_substream, wakeup_timer);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	snd_pcm_stream_lock_irqsave(substream, flags);
+	if (!snd_pcm_running(substream) || !runtime->wakeup_frames)
+		goto unlock;
+	/* wakes up the sleepers via snd_pcm_update_state() */
+	snd_pcm_update_hw_ptr(substream);
+	/* the stream may have been stopped by an xrun, or restarted
+	 * (and thus re-queued) while we were waiting for the lock
+	 */
+	if (snd_pcm_running(substream) && !hrtimer_is_queued(timer)) {
+		hrtimer_forward_now(timer, snd_pcm_wakeup_interval(runtime));
+		ret = HRTIMER_RESTART;
+	}
+ unlock:
+	snd_pcm_stream_unlock_irqrestore(substream, flags);
+	return ret;
+}
+
+/* called under the stream lock when the stream (re)starts running */
+void snd_pcm_wakeup_timer_start(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	if (!runtime->wakeup_frames || !snd_pcm_running(substream))
+		return;
+	if (hrtimer_is_queued(&substream->wakeup_timer))
+		return;
+	hrtimer_start(&substream->wakeup_timer,
+		      snd_pcm_wakeup_interval(runtime), HRTIMER_MODE_REL);
+}
+
+#ifdef CONFIG_SND_PCM_STATS
+static void stats_add(unsigned int *hist, u64 val)
+{
+	int idx = val ? fls64(val) : 0;
+
+	if (idx >= SNDRV_PCM_STATS_BUCKETS)
+		idx = SNDRV_PCM_STATS_BUCKETS - 1;
+	hist[idx]++;
+}
+
+/* account the period interrupt; called with the stream lock held */
+void snd_pcm_stats_period(struct snd_pcm_substream *substream,
+			  snd_pcm_uframes_t old_hw_ptr)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_stats *stats = &substream->stats;
+	snd_pcm_sframes_t delta;
+	u64 now, interval, expected;
+
+	delta = runtime->status->hw_ptr - old_hw_ptr;
+	if (delta < 0)
+		delta += runtime->boundary;
+	stats_add(stats->hw_ptr_delta, delta);
+
+	now = ktime_get_ns();
+	if (stats->last_period_ns && runtime->rate) {
+		interval = now - stats->last_period_ns;
+		expected = div_u64((u64)runtime->period_size * NSEC_PER_SEC,
+				   runtime->rate);
+		if (interval > expected)
+			interval -= expected;
+		else
+			interval = expected - interval;
+		stats_add(stats->period_jitter,
+			  div_u64(interval, NSEC_PER_USEC));
+	}
+	stats->last_period_ns = now;
+}
+
+/* account the wakeup of a blocked reader/writer; called with the lock */
+void snd_pcm_stats_wakeup(struct snd_pcm_substream *substream,
+			  snd_pcm_uframes_t avail)
+{
+	struct snd_pcm_stats *stats = &substream->stats;
+
+	stats_add(stats->wakeup_avail, avail);
+	if (stats->last_period_ns)
+		stats_add(stats->wakeup_latency,
+			  div_u64(ktime_get_ns() - stats->last_period_ns,
+				  NSEC_PER_USEC));
+}
+#endif /* CONFIG_SND_PCM_STATS */
+
 /*
  * Wait until avail_min data becomes available
  * Returns a negative error code if any error occurs during operation.
@@ -1830,6 +2113,7 @@ static int wait_for_avail(struct snd_pcm_substream *substream,
 	int err = 0;
 	snd_pcm_uframes_t avail = 0;
 	long wait_time, tout;
+	bool slept = false;
 
 	init_waitqueue_entry(&wait, current);
 	set_current_state(TASK_INTERRUPTIBLE);
@@ -1868,11 +2152,15 @@ static int wait_for_avail(struct snd_pcm_substream *substream,
 			avail = snd_pcm_playback_avail(runtime);
 		else
 			avail = snd_pcm_capture_avail(runtime);
-		if (avail >= runtime->twake)
+		if (avail >= runtime->twake) {
+			if (slept)
+				snd_pcm_stats_wakeup(substream, avail);
 			break;
+		}
 		snd_pcm_stream_unlock_irq(substream);
 
 		tout = schedule_timeout(wait_time);
+		slept = true;
 
 		snd_pcm_stream_lock_irq(substream);
 		set_current_state(TASK_INTERRUPTIBLE);
@@ -2040,12 +2328,183 @@ static int noninterleaved_copy(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * Interleaved access on a non-interleaved buffer
+ *
+ * The interleaved data is processed in blocks of DEINTERLEAVE_BLOCK_BYTES,
+ * small enough to stay in the L1 cache while each channel of the block is
+ * gathered into (or scattered from) a contiguous run, and handed to the
+ * kernel-space transfer function of the non-interleaved layout.
+ */
+#define DEINTERLEAVE_BLOCK_BYTES	4096
+
+static void deinterleave_samples(void *dst, const void *src,
+				 snd_pcm_uframes_t frames,
+				 unsigned int stride, unsigned int width)
+{
+	for (; frames > 0; frames--, src += stride, dst += width) {
+		switch (width) {
+		case 1:
+			*(u8 *)dst = *(const u8 *)src;
+			break;
+		case 2:
+			*(u16 *)dst = *(const u16 *)src;
+			break;
+		case 4:
+			*(u32 *)dst = *(const u32 *)src;
+			break;
+		case 8:
+			*(u64 *)dst = *(const u64 *)src;
+			break;
+		default:
+			memcpy(dst, src, width);
+			break;
+		}
+	}
+}
+
+static void interleave_samples(void *dst, const void *src,
+			       snd_pcm_uframes_t frames,
+			       unsigned int stride, unsigned int width)
+{
+	for (; frames > 0; frames--, src += width, dst += stride) {
+		switch (width) {
+		case 1:
+			*(u8 *)dst = *(const u8 *)src;
+			break;
+		case 2:
+			*(u16 *)dst = *(const u16 *)src;
+			break;
+		case 4:
+			*(u32 *)dst = *(const u32 *)src;
+			break;
+		case 8:
+			*(u64 *)dst = *(const u64 *)src;
+			break;
+		default:
+			memcpy(dst, src, width);
+			break;
+		}
+	}
+}
+
+/* allocate (or release) the bounce buffer for the access adapter;
+ * called from hw_params and hw_free
+ */
+int snd_pcm_deinterleave_setup(struct snd_pcm_substream *substream,
+			       bool enable)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	unsigned int frame_bytes, width;
+	snd_pcm_uframes_t frames;
+
+	kfree(runtime->deinterleave_buf);
+	runtime->deinterleave_buf = NULL;
+	runtime->deinterleave_frames = 0;
+	/* a mono stream has the same layout in both access types */
+	if (!enable || runtime->channels < 2)
+		return 0;
+	if (runtime->sample_bits % 8)
+		return -EINVAL;
+
+	width = runtime->sample_bits / 8;
+	frame_bytes = runtime->frame_bits / 8;
+	frames = max_t(snd_pcm_uframes_t,
+		       DEINTERLEAVE_BLOCK_BYTES / frame_bytes, 1);
+	/* one interleaved block plus one channel run */
+	runtime->deinterleave_buf = kmalloc(frames * (frame_bytes + width),
+					    GFP_KERNEL);
+	if (!runtime->deinterleave_buf)
+		return -ENOMEM;
+	runtime->deinterleave_frames = frames;
+	return 0;
+}
+
+static int deinterleaved_copy(struct snd_pcm_substream *substream,
+			      snd_pcm_uframes_t hwoff, void *data,
+			      snd_pcm_uframes_t off,
+			      snd_pcm_uframes_t frames,
+			      pcm_transfer_f transfer, bool in_kernel)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	bool is_playback = substream->stream == SNDRV_PCM_STREAM_PLAYBACK;
+	unsigned int width = runtime->sample_bits / 8;
+	unsigned int frame_bytes = runtime->frame_bits / 8;
+	void *chbuf = runtime->deinterleave_buf +
+		runtime->deinterleave_frames * frame_bytes;
+	snd_pcm_uframes_t n;
+	unsigned long bytes;
+	void *block;
+	int c, err;
+
+	if (!data)
+		return noninterleaved_copy(substream, hwoff, NULL, 0, frames,
+					   transfer);
+
+	data += frames_to_bytes(runtime, off);
+	while (frames > 0) {
+		n = min(frames, runtime->deinterleave_frames);
+		bytes = frames_to_bytes(runtime, n);
+		block = in_kernel ? data : runtime->deinterleave_buf;
+		if (is_playback && !in_kernel &&
+		    copy_from_user(block, (void __user *)data, bytes))
+			return -EFAULT;
+		for (c = 0; c < runtime->channels; c++) {
+			if (is_playback) {
+				deinterleave_samples(chbuf, block + c * width,
+						     n, frame_bytes, width);
+				err = transfer(substream, c,
+					       samples_to_bytes(runtime, hwoff),
+					       chbuf, n * width);
+			} else {
+				err = transfer(substream, c,
+					       samples_to_bytes(runtime, hwoff),
+					       chbuf, n * width);
+				interleave_samples(block + c * width, chbuf,
+						   n, frame_bytes, width);
+			}
+			if (err < 0)
+				return err;
+		}
+		if (!is_playback && !in_kernel &&
+		    copy_to_user((void __user *)data, block, bytes))
+			return -EFAULT;
+		data += bytes;
+		hwoff += n;
+		frames -= n;
+	}
+	return 0;
+}
+
+static int deinterleaved_copy_user(struct snd_pcm_substream *substream,
+				   snd_pcm_uframes_t hwoff, void *data,
+				   snd_pcm_uframes_t off,
+				   snd_pcm_uframes_t frames,
+				   pcm_transfer_f transfer)
+{
+	return deinterleaved_copy(substream, hwoff, data, off, frames,
+				  transfer, false);
+}
+
+static int deinterleaved_copy_kernel(struct snd_pcm_substream *substream,
+				     snd_pcm_uframes_t hwoff, void *data,
+				     snd_pcm_uframes_t off,
+				     snd_pcm_uframes_t frames,
+				     pcm_transfer_f transfer)
+{
+	return deinterleaved_copy(substream, hwoff, data, off, frames,
+				  transfer, true);
+}
+
 /* fill silence on the given buffer position;
  * called from snd_pcm_playback_silence()
  */
 static int fill_silence_frames(struct snd_pcm_substream *substream,
 			       snd_pcm_uframes_t off, snd_pcm_uframes_t frames)
 {
+	if (substream->runtime->deinterleave_buf)
+		return noninterleaved_copy(substream, off, NULL, 0, frames,
+					   fill_silence);
 	if (substream->runtime->access == SNDRV_PCM_ACCESS_RW_INTERLEAVED ||
 	    substream->runtime->access == SNDRV_PCM_ACCESS_MMAP_INTERLEAVED)
 		return interleaved_copy(substream, off, NULL, 0, frames,
@@ -2108,6 +2567,12 @@ int pcm_lib_apply_appl_ptr(struct snd_pcm_substream *substream,
 	}
 
 	trace_applptr(substream, old_appl_ptr, appl_ptr);
+	snd_pcm_compat_mmap_update(runtime);
+
+	/* refresh the published hw_ptr at each ack in the live status mode */
+	if (runtime->live_status &&
+	    runtime->status->state == SNDRV_PCM_STATE_RUNNING)
+		snd_pcm_update_hw_ptr(substream);
 
 	return 0;
 }
@@ -2125,6 +2590,7 @@ snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 	pcm_transfer_f transfer;
 	bool nonblock;
 	bool is_playback;
+	u64 cost;
 	int err;
 
 	err = pcm_sanity_check(substream);
@@ -2136,7 +2602,11 @@ snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 		if (runtime->access != SNDRV_PCM_ACCESS_RW_INTERLEAVED &&
 		    runtime->channels > 1)
 			return -EINVAL;
-		writer = interleaved_copy;
+		if (runtime->deinterleave_buf)
+			writer = in_kernel ? deinterleaved_copy_kernel :
+				deinterleaved_copy_user;
+		else
+			writer = interleaved_copy;
 	} else {
 		if (runtime->access != SNDRV_PCM_ACCESS_RW_NONINTERLEAVED)
 			return -EINVAL;
@@ -2148,7 +2618,8 @@ snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 			transfer = fill_silence;
 		else
 			return -EINVAL;
-	} else if (in_kernel) {
+	} else if (in_kernel || runtime->deinterleave_buf) {
+		/* the adapter does the user copy itself via the bounce buffer */
 		if (substream->ops->copy_kernel)
 			transfer = substream->ops->copy_kernel;
 		else
@@ -2168,6 +2639,7 @@ snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 	nonblock = !!(substream->f_flags & O_NONBLOCK);
 
 	snd_pcm_stream_lock_irq(substream);
+	cost = snd_pcm_stats_cost_begin();
 	err = pcm_accessible_state(runtime);
 	if (err < 0)
 		goto _end_unlock;
@@ -2202,7 +2674,9 @@ snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 			}
 			runtime->twake = min_t(snd_pcm_uframes_t, size,
 					runtime->control->avail_min ? : 1);
+			snd_pcm_stats_cost_pause(&cost);
 			err = wait_for_avail(substream, &avail);
+			snd_pcm_stats_cost_resume(&cost);
 			if (err < 0)
 				goto _end_unlock;
 			if (!avail)
@@ -2251,6 +2725,7 @@ snd_pcm_sframes_t __snd_pcm_lib_xfer(struct snd_pcm_substream *substream,
 	runtime->twake = 0;
 	if (xfer > 0 && err >= 0)
 		snd_pcm_update_state(substream, runtime);
+	snd_pcm_stats_cost_end(substream, SNDRV_PCM_STATS_COST_XFER, cost);
 	snd_pcm_stream_unlock_irq(substream);
 	return xfer > 0 ? (snd_pcm_sframes_t)xfer : err;
 }
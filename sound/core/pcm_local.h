@@ -32,10 +32,198 @@ int pcm_lib_apply_appl_ptr(struct snd_pcm_substream *substream,
 int snd_pcm_update_state(struct snd_pcm_substream *substream,
 			 struct snd_pcm_runtime *runtime);
 int snd_pcm_update_hw_ptr(struct snd_pcm_substream *substream);
+int snd_pcm_latency(struct snd_pcm_substream *substream,
+		    struct snd_pcm_latency *latency);
+
+void snd_pcm_lib_preallocate_init(struct snd_pcm_substream *substream);
+void snd_pcm_lib_preallocate_release(struct snd_pcm_substream *substream);
+size_t snd_pcm_lib_buffer_bytes_max(struct snd_pcm_substream *substream);
+
+#ifdef CONFIG_COMPAT
+void __snd_pcm_compat_mmap_update(struct snd_pcm_runtime *runtime);
+void __snd_pcm_compat_mmap_sync(struct snd_pcm_runtime *runtime);
+void snd_pcm_compat_mmap_free(struct snd_pcm_runtime *runtime);
+int snd_pcm_mmap_compat(struct snd_pcm_substream *substream,
+			struct vm_area_struct *area);
+
+/*
+ * 32-bit clients map a copy of the status and control records in their
+ * own layout: publish the native records there after a change, and take
+ * over the appl_ptr and avail_min written by the client before using
+ * them.  Call with the stream lock held.
+ */
+static inline void snd_pcm_compat_mmap_update(struct snd_pcm_runtime *runtime)
+{
+	if (runtime->compat_mmap)
+		__snd_pcm_compat_mmap_update(runtime);
+}
+
+static inline void snd_pcm_compat_mmap_sync(struct snd_pcm_runtime *runtime)
+{
+	if (runtime->compat_mmap)
+		__snd_pcm_compat_mmap_sync(runtime);
+}
+#else
+static inline void snd_pcm_compat_mmap_update(struct snd_pcm_runtime *runtime) {}
+static inline void snd_pcm_compat_mmap_sync(struct snd_pcm_runtime *runtime) {}
+static inline void snd_pcm_compat_mmap_free(struct snd_pcm_runtime *runtime) {}
+static inline int snd_pcm_mmap_compat(struct snd_pcm_substream *substream,
+				      struct vm_area_struct *area)
+{
+	return -ENXIO;
+}
+#endif
+
+/*
+ * In the live status mode, the status record updates are wrapped with
+ * a sequence counter in pad1, so that the application reading the
+ * mmap'ed status page can detect a torn read: an odd value means that
+ * an update is in progress, and a changed value means that it has to
+ * retry.  The end of an update also refreshes the copy of 32-bit clients.
+ * Call with the stream lock held.
+ */
+static inline void snd_pcm_live_status_begin(struct snd_pcm_runtime *runtime)
+{
+	if (runtime->live_status) {
+		WRITE_ONCE(runtime->status->pad1, runtime->status->pad1 + 1);
+		smp_wmb();
+	}
+}
+
+static inline void snd_pcm_live_status_end(struct snd_pcm_runtime *runtime)
+{
+	if (runtime->live_status) {
+		smp_wmb();
+		WRITE_ONCE(runtime->status->pad1, runtime->status->pad1 + 1);
+	}
+	snd_pcm_compat_mmap_update(runtime);
+}
+
+void snd_pcm_group_init(struct snd_pcm_group *group);
+
+int snd_dma_pool_init(void);
+void snd_dma_pool_exit(void);
+
+int snd_pcm_deinterleave_setup(struct snd_pcm_substream *substream,
+			       bool enable);
+
+/* whether RW_INTERLEAVED can be emulated on non-interleaved-only hardware;
+ * the adapter copies via a kernel bounce buffer, so the driver must not
+ * rely on copy_user alone
+ */
+static inline bool
+snd_pcm_deinterleave_supported(struct snd_pcm_substream *substream)
+{
+	return !(substream->runtime->hw.info & SNDRV_PCM_INFO_INTERLEAVED) &&
+		(substream->runtime->hw.info & SNDRV_PCM_INFO_NONINTERLEAVED) &&
+		(substream->ops->copy_kernel || !substream->ops->copy_user);
+}
 
 void snd_pcm_playback_silence(struct snd_pcm_substream *substream,
 			      snd_pcm_uframes_t new_hw_ptr);
 
+#ifdef CONFIG_SND_PCM_STATS
+#include <linux/timex.h>
+
+void snd_pcm_stats_period(struct snd_pcm_substream *substream,
+			  snd_pcm_uframes_t old_hw_ptr);
+void snd_pcm_stats_wakeup(struct snd_pcm_substream *substream,
+			  snd_pcm_uframes_t avail);
+static inline void snd_pcm_stats_xrun(struct snd_pcm_substream *substream)
+{
+	substream->stats.xruns++;
+}
+/* restart the period interval measurement, e.g. at trigger start */
+static inline void snd_pcm_stats_restart(struct snd_pcm_substream *substream)
+{
+	substream->stats.last_period_ns = 0;
+}
+
+/*
+ * CPU cost accounting: begin() returns the start stamp, pause()/resume()
+ * exclude a sleep in between, end() adds up under the stream lock.
+ */
+static inline u64 snd_pcm_stats_cost_begin(void)
+{
+	return get_cycles();
+}
+static inline void snd_pcm_stats_cost_pause(u64 *cost)
+{
+	*cost = get_cycles() - *cost;
+}
+static inline void snd_pcm_stats_cost_resume(u64 *cost)
+{
+	*cost = get_cycles() - *cost;
+}
+static inline void snd_pcm_stats_cost_end(struct snd_pcm_substream *substream,
+					  int type, u64 cost)
+{
+	substream->stats.cost[type].calls++;
+	substream->stats.cost[type].cycles += get_cycles() - cost;
+}
+#else
+static inline void snd_pcm_stats_period(struct snd_pcm_substream *substream,
+					snd_pcm_uframes_t old_hw_ptr) {}
+static inline void snd_pcm_stats_wakeup(struct snd_pcm_substream *substream,
+					snd_pcm_uframes_t avail) {}
+static inline void snd_pcm_stats_xrun(struct snd_pcm_substream *substream) {}
+static inline void snd_pcm_stats_restart(struct snd_pcm_substream *substream) {}
+static inline u64 snd_pcm_stats_cost_begin(void) { return 0; }
+static inline void snd_pcm_stats_cost_pause(u64 *cost) {}
+static inline void snd_pcm_stats_cost_resume(u64 *cost) {}
+static inline void snd_pcm_stats_cost_end(struct snd_pcm_substream *substream,
+					  int type, u64 cost) {}
+#endif
+
+#ifdef CONFIG_SND_PCM_FLIGHT_RECORDER
+/* called with the stream lock held */
+static inline void snd_pcm_flight_record(struct snd_pcm_substream *substream,
+					 int type, int arg,
+					 snd_pcm_uframes_t pos)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_flight_rec *rec = &substream->flight;
+	struct snd_pcm_flight_event *ev;
+
+	ev = &rec->ev[rec->head % SNDRV_PCM_FLIGHT_EVENTS];
+	ev->time_ns = ktime_get_ns();
+	ev->pos = pos;
+	ev->hw_ptr = runtime->status->hw_ptr;
+	ev->appl_ptr = runtime->control->appl_ptr;
+	ev->type = type;
+	ev->arg = arg;
+	rec->head++;
+}
+
+static inline void snd_pcm_flight_state(struct snd_pcm_substream *substream)
+{
+	snd_pcm_flight_record(substream, SNDRV_PCM_FLIGHT_STATE,
+			      (__force int)substream->runtime->status->state, 0);
+}
+
+/* keep the events leading to the xrun, later ones overwrite the ring */
+static inline void snd_pcm_flight_xrun(struct snd_pcm_substream *substream)
+{
+	snd_pcm_flight_record(substream, SNDRV_PCM_FLIGHT_XRUN, 0, 0);
+	substream->flight_xrun = substream->flight;
+}
+#else
+static inline void snd_pcm_flight_record(struct snd_pcm_substream *substream,
+					 int type, int arg,
+					 snd_pcm_uframes_t pos) {}
+static inline void snd_pcm_flight_state(struct snd_pcm_substream *substream) {}
+static inline void snd_pcm_flight_xrun(struct snd_pcm_substream *substream) {}
+#endif
+
+enum hrtimer_restart snd_pcm_wakeup_timer_func(struct hrtimer *timer);
+void snd_pcm_wakeup_timer_start(struct snd_pcm_substream *substream);
+
+/* stop the sw_params wakeup timer; safe under the stream lock */
+static inline void snd_pcm_wakeup_timer_stop(struct snd_pcm_substream *substream)
+{
+	hrtimer_try_to_cancel(&substream->wakeup_timer);
+}
+
 #ifdef CONFIG_SND_PCM_TIMER
 void snd_pcm_timer_resolution_change(struct snd_pcm_substream *substream);
 void snd_pcm_timer_init(struct snd_pcm_substream *substream);
@@ -30,6 +30,10 @@
 #include <sound/pcm.h>
 #include <sound/info.h>
 #include <sound/initval.h>
+#include "pcm_local.h"
+#ifdef CONFIG_X86
+#include <asm/set_memory.h>
+#endif
 
 static int preallocate_dma = 1;
 module_param(preallocate_dma, int, 0444);
@@ -39,8 +43,28 @@ static int maximum_substreams = 4;
 module_param(maximum_substreams, int, 0444);
 MODULE_PARM_DESC(maximum_substreams, "Maximum substreams with preallocated DMA memory.");
 
+static bool contig_vmalloc;
+module_param(contig_vmalloc, bool, 0644);
+MODULE_PARM_DESC(contig_vmalloc, "Try physically contiguous memory for large vmalloc buffers.");
+
+static bool prealloc_auto;
+module_param(prealloc_auto, bool, 0644);
+MODULE_PARM_DESC(prealloc_auto, "Resize the preallocated buffers to the largest size used, on the PCMs that allow it.");
+
+static unsigned int prealloc_auto_delay = 60;
+module_param(prealloc_auto_delay, uint, 0644);
+MODULE_PARM_DESC(prealloc_auto_delay, "Idle time in seconds before shrinking an automatically grown buffer.");
+
 static const size_t snd_minimum_buffer = 16384;
 
+/* memory node of the card, used for the buffers allocated on its behalf */
+static int substream_to_node(struct snd_pcm_substream *substream)
+{
+	struct device *dev = substream->pcm->card->dev;
+
+	return dev ? dev_to_node(dev) : NUMA_NO_NODE;
+}
+
 
 /*
  * try to allocate as the large pages as possible.
@@ -55,8 +79,9 @@ static int preallocate_pcm_pages(struct snd_pcm_substream *substream, size_t siz
 	int err;
 
 	do {
-		if ((err = snd_dma_alloc_pages(dmab->dev.type, dmab->dev.dev,
-					       size, dmab)) < 0) {
+		if ((err = snd_dma_alloc_pages_node(dmab->dev.type,
+						    dmab->dev.dev, size, dmab,
+						    substream_to_node(substream))) < 0) {
 			if (err != -ENOMEM)
 				return err; /* fatal error */
 		} else
@@ -92,7 +117,11 @@ static void snd_pcm_lib_preallocate_dma_free(struct snd_pcm_substream *substream
  */
 int snd_pcm_lib_preallocate_free(struct snd_pcm_substream *substream)
 {
+	cancel_delayed_work_sync(&substream->prealloc_work);
 	snd_pcm_lib_preallocate_dma_free(substream);
+	/* the recycled buffers must not outlive the device */
+	if (substream->dma_buffer.dev.type != SNDRV_DMA_TYPE_UNKNOWN)
+		snd_dma_pool_flush(substream->dma_buffer.dev.dev);
 #ifdef CONFIG_SND_VERBOSE_PROCFS
 	snd_info_free_entry(substream->proc_prealloc_max_entry);
 	substream->proc_prealloc_max_entry = NULL;
@@ -160,27 +189,31 @@ static void snd_pcm_lib_preallocate_proc_write(struct snd_info_entry *entry,
 	size_t size;
 	struct snd_dma_buffer new_dmab;
 
+	mutex_lock(&substream->pcm->open_mutex);
 	if (substream->runtime) {
 		buffer->error = -EBUSY;
-		return;
+		goto unlock;
 	}
 	if (!snd_info_get_line(buffer, line, sizeof(line))) {
 		snd_info_get_str(str, line, sizeof(str));
 		size = simple_strtoul(str, NULL, 10) * 1024;
 		if ((size != 0 && size < 8192) || size > substream->dma_max) {
 			buffer->error = -EINVAL;
-			return;
+			goto unlock;
 		}
+		/* the automatic resizing keeps at least this size */
+		substream->dma_default = size;
 		if (substream->dma_buffer.bytes == size)
-			return;
+			goto unlock;
 		memset(&new_dmab, 0, sizeof(new_dmab));
 		new_dmab.dev = substream->dma_buffer.dev;
 		if (size > 0) {
-			if (snd_dma_alloc_pages(substream->dma_buffer.dev.type,
-						substream->dma_buffer.dev.dev,
-						size, &new_dmab) < 0) {
+			if (snd_dma_alloc_pages_node(substream->dma_buffer.dev.type,
+						     substream->dma_buffer.dev.dev,
+						     size, &new_dmab,
+						     substream_to_node(substream)) < 0) {
 				buffer->error = -ENOMEM;
-				return;
+				goto unlock;
 			}
 			substream->buffer_bytes_max = size;
 		} else {
@@ -192,6 +225,8 @@ static void snd_pcm_lib_preallocate_proc_write(struct snd_info_entry *entry,
 	} else {
 		buffer->error = -EINVAL;
 	}
+ unlock:
+	mutex_unlock(&substream->pcm->open_mutex);
 }
 
 static inline void preallocate_info_init(struct snd_pcm_substream *substream)
@@ -224,6 +259,97 @@ static inline void preallocate_info_init(struct snd_pcm_substream *substream)
 #define preallocate_info_init(s)
 #endif /* CONFIG_SND_VERBOSE_PROCFS */
 
+/*
+ * Automatic preallocation: snd_pcm_lib_malloc_pages() records the largest
+ * buffer used on the substream, and after the buffer is released, the
+ * preallocation is resized in the background to that size, but never
+ * below the size given by the driver.  A grown buffer shrinks back when
+ * it has not been needed again for prealloc_auto_delay seconds.  While
+ * the policy is on, hw_params may ask for buffers up to prealloc_max.
+ *
+ * This only applies to the PCMs with prealloc_resize set: a driver that
+ * uses substream->dma_buffer directly would get a larger buffer size
+ * than the one it has.
+ */
+static bool preallocate_auto(struct snd_pcm_substream *substream)
+{
+	return prealloc_auto && substream->pcm->prealloc_resize &&
+		preallocate_dma && substream->dma_max &&
+		substream->number < maximum_substreams;
+}
+
+static void preallocate_auto_schedule(struct snd_pcm_substream *substream)
+{
+	unsigned long delay;
+
+	if (!preallocate_auto(substream))
+		return;
+	if (substream->dma_learned > substream->dma_buffer.bytes)
+		delay = HZ;	/* grow soon */
+	else if (substream->dma_buffer.bytes > substream->dma_default)
+		delay = prealloc_auto_delay * HZ;
+	else
+		return;
+	mod_delayed_work(system_wq, &substream->prealloc_work, delay);
+}
+
+static void preallocate_auto_work(struct work_struct *work)
+{
+	struct snd_pcm_substream *substream =
+		container_of(work, struct snd_pcm_substream, prealloc_work.work);
+	struct snd_dma_buffer new_dmab;
+	size_t size;
+
+	mutex_lock(&substream->pcm->open_mutex);
+	/* an open substream reschedules when it is released */
+	if (!preallocate_auto(substream) || substream->runtime)
+		goto unlock;
+	size = max(substream->dma_learned, substream->dma_default);
+	size = PAGE_ALIGN(min(size, substream->dma_max));
+	substream->dma_learned = 0;
+	if (size == substream->dma_buffer.bytes)
+		goto unlock;
+
+	memset(&new_dmab, 0, sizeof(new_dmab));
+	new_dmab.dev = substream->dma_buffer.dev;
+	if (size && snd_dma_alloc_pages_node(substream->dma_buffer.dev.type,
+					     substream->dma_buffer.dev.dev,
+					     size, &new_dmab,
+					     substream_to_node(substream)) < 0) {
+		/* keep the current buffer */
+		pr_debug("ALSA pcmC%dD%d%c,%d: cannot resize preallocation to %zu\n",
+			 substream->pcm->card->number, substream->pcm->device,
+			 substream->stream ? 'c' : 'p', substream->number, size);
+		goto unlock;
+	}
+	snd_pcm_lib_preallocate_dma_free(substream);
+	substream->dma_buffer = new_dmab;
+	substream->buffer_bytes_max = size ? size : UINT_MAX;
+	/* check later whether the grown buffer is still needed */
+	preallocate_auto_schedule(substream);
+ unlock:
+	mutex_unlock(&substream->pcm->open_mutex);
+}
+
+void snd_pcm_lib_preallocate_init(struct snd_pcm_substream *substream)
+{
+	INIT_DELAYED_WORK(&substream->prealloc_work, preallocate_auto_work);
+}
+
+/* the substream is closed; a resize put off while it was open can run */
+void snd_pcm_lib_preallocate_release(struct snd_pcm_substream *substream)
+{
+	preallocate_auto_schedule(substream);
+}
+
+/* the upper limit of the buffer size for hw_params */
+size_t snd_pcm_lib_buffer_bytes_max(struct snd_pcm_substream *substream)
+{
+	if (preallocate_auto(substream))
+		return max(substream->buffer_bytes_max, substream->dma_max);
+	return substream->buffer_bytes_max;
+}
+
 /*
  * pre-allocate the buffer and create a proc file for the substream
  */
@@ -236,6 +362,7 @@ static int snd_pcm_lib_preallocate_pages1(struct snd_pcm_substream *substream,
 
 	if (substream->dma_buffer.bytes > 0)
 		substream->buffer_bytes_max = substream->dma_buffer.bytes;
+	substream->dma_default = substream->dma_buffer.bytes;
 	substream->dma_max = max;
 	preallocate_info_init(substream);
 	return 0;
@@ -314,6 +441,69 @@ struct page *snd_pcm_sgbuf_ops_page(struct snd_pcm_substream *substream, unsigne
 EXPORT_SYMBOL(snd_pcm_sgbuf_ops_page);
 #endif /* CONFIG_SND_DMA_SGBUF */
 
+#ifdef CONFIG_X86
+static void snd_pcm_buffer_set_memory(struct snd_dma_buffer *dmab, int policy)
+{
+	int pages;
+
+#ifdef CONFIG_SND_DMA_SGBUF
+	if (dmab->dev.type == SNDRV_DMA_TYPE_DEV_SG) {
+		struct snd_sg_buf *sgbuf = dmab->private_data;
+
+		if (policy == SNDRV_PCM_BUFFER_POLICY_WC)
+			set_pages_array_wc(sgbuf->page_table, sgbuf->pages);
+		else if (policy == SNDRV_PCM_BUFFER_POLICY_UNCACHED)
+			set_pages_array_uc(sgbuf->page_table, sgbuf->pages);
+		else
+			set_pages_array_wb(sgbuf->page_table, sgbuf->pages);
+		return;
+	}
+#endif
+
+	pages = (dmab->bytes + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	if (policy == SNDRV_PCM_BUFFER_POLICY_WC)
+		set_memory_wc((unsigned long)dmab->area, pages);
+	else if (policy == SNDRV_PCM_BUFFER_POLICY_UNCACHED)
+		set_memory_uc((unsigned long)dmab->area, pages);
+	else
+		set_memory_wb((unsigned long)dmab->area, pages);
+}
+
+/*
+ * apply the caching policy to the kernel mapping of the runtime buffer, or
+ * restore it before the buffer is released.  The other architectures get
+ * the attributes of the coherent DMA memory from the DMA API and need only
+ * the mmap part.
+ */
+static void snd_pcm_buffer_mark(struct snd_pcm_substream *substream, bool on)
+{
+	struct snd_dma_buffer *dmab = substream->runtime->dma_buffer_p;
+
+	if (substream->buffer_marked == on)
+		return;
+	if (on && substream->buffer_policy == SNDRV_PCM_BUFFER_POLICY_CACHED)
+		return;
+	if (!dmab || !dmab->area || !dmab->bytes)
+		return;
+	switch (dmab->dev.type) {
+	case SNDRV_DMA_TYPE_CONTINUOUS:
+	case SNDRV_DMA_TYPE_DEV:
+	case SNDRV_DMA_TYPE_DEV_SG:
+		break;
+	default:
+		return;
+	}
+	snd_pcm_buffer_set_memory(dmab, on ? substream->buffer_policy :
+				  SNDRV_PCM_BUFFER_POLICY_CACHED);
+	substream->buffer_marked = on;
+}
+#else
+static inline void snd_pcm_buffer_mark(struct snd_pcm_substream *substream,
+				       bool on)
+{
+}
+#endif
+
 /**
  * snd_pcm_lib_malloc_pages - allocate the DMA buffer
  * @substream: the substream to allocate the DMA buffer to
@@ -336,6 +526,8 @@ int snd_pcm_lib_malloc_pages(struct snd_pcm_substream *substream, size_t size)
 		       SNDRV_DMA_TYPE_UNKNOWN))
 		return -EINVAL;
 	runtime = substream->runtime;
+	if (size > substream->dma_learned)
+		substream->dma_learned = size;
 
 	if (runtime->dma_buffer_p) {
 		/* perphaps, we might free the large DMA memory region
@@ -355,15 +547,17 @@ int snd_pcm_lib_malloc_pages(struct snd_pcm_substream *substream, size_t size)
 		if (! dmab)
 			return -ENOMEM;
 		dmab->dev = substream->dma_buffer.dev;
-		if (snd_dma_alloc_pages(substream->dma_buffer.dev.type,
-					substream->dma_buffer.dev.dev,
-					size, dmab) < 0) {
+		if (snd_dma_pool_alloc(substream->dma_buffer.dev.type,
+				       substream->dma_buffer.dev.dev,
+				       size, dmab,
+				       substream_to_node(substream)) < 0) {
 			kfree(dmab);
 			return -ENOMEM;
 		}
 	}
 	snd_pcm_set_runtime_buffer(substream, dmab);
 	runtime->dma_bytes = size;
+	snd_pcm_buffer_mark(substream, true);
 	return 1;			/* area was changed */
 }
 EXPORT_SYMBOL(snd_pcm_lib_malloc_pages);
@@ -385,20 +579,44 @@ int snd_pcm_lib_free_pages(struct snd_pcm_substream *substream)
 	runtime = substream->runtime;
 	if (runtime->dma_area == NULL)
 		return 0;
+	snd_pcm_buffer_mark(substream, false);
 	if (runtime->dma_buffer_p != &substream->dma_buffer) {
-		/* it's a newly allocated buffer.  release it now. */
-		snd_dma_free_pages(runtime->dma_buffer_p);
+		/* it's a newly allocated buffer.  recycle it now. */
+		snd_dma_pool_free(runtime->dma_buffer_p);
 		kfree(runtime->dma_buffer_p);
 	}
 	snd_pcm_set_runtime_buffer(substream, NULL);
+	preallocate_auto_schedule(substream);
 	return 0;
 }
 EXPORT_SYMBOL(snd_pcm_lib_free_pages);
 
+/*
+ * A large "vmalloc" buffer may be taken from physically contiguous pages
+ * instead; the kernel then accesses it via the linear mapping, which is
+ * normally mapped with huge pages, instead of via 4k vmalloc PTEs.
+ */
+static void *alloc_contig_vmalloc_buffer(size_t size, gfp_t gfp_flags, int nid)
+{
+	if (!contig_vmalloc || size < PMD_SIZE)
+		return NULL;
+	return snd_malloc_pages_node(size, gfp_flags | __GFP_NORETRY |
+				     __GFP_NOWARN, nid);
+}
+
+static void free_vmalloc_buffer(struct snd_pcm_runtime *runtime)
+{
+	if (is_vmalloc_addr(runtime->dma_area))
+		vfree(runtime->dma_area);
+	else
+		snd_free_pages(runtime->dma_area, runtime->dma_bytes);
+}
+
 int _snd_pcm_lib_alloc_vmalloc_buffer(struct snd_pcm_substream *substream,
 				      size_t size, gfp_t gfp_flags)
 {
 	struct snd_pcm_runtime *runtime;
+	int nid;
 
 	if (PCM_RUNTIME_CHECK(substream))
 		return -EINVAL;
@@ -406,9 +624,14 @@ int _snd_pcm_lib_alloc_vmalloc_buffer(struct snd_pcm_substream *substream,
 	if (runtime->dma_area) {
 		if (runtime->dma_bytes >= size)
 			return 0; /* already large enough */
-		vfree(runtime->dma_area);
+		free_vmalloc_buffer(runtime);
 	}
-	runtime->dma_area = __vmalloc(size, gfp_flags, PAGE_KERNEL);
+	nid = substream_to_node(substream);
+	runtime->dma_area = alloc_contig_vmalloc_buffer(size, gfp_flags, nid);
+	if (!runtime->dma_area)
+		runtime->dma_area =
+			__vmalloc_node_flags_caller(size, nid, gfp_flags,
+						    __builtin_return_address(0));
 	if (!runtime->dma_area)
 		return -ENOMEM;
 	runtime->dma_bytes = size;
@@ -430,7 +653,8 @@ int snd_pcm_lib_free_vmalloc_buffer(struct snd_pcm_substream *substream)
 	if (PCM_RUNTIME_CHECK(substream))
 		return -EINVAL;
 	runtime = substream->runtime;
-	vfree(runtime->dma_area);
+	if (runtime->dma_area)
+		free_vmalloc_buffer(runtime);
 	runtime->dma_area = NULL;
 	return 0;
 }
@@ -449,6 +673,10 @@ EXPORT_SYMBOL(snd_pcm_lib_free_vmalloc_buffer);
 struct page *snd_pcm_lib_get_vmalloc_page(struct snd_pcm_substream *substream,
 					  unsigned long offset)
 {
-	return vmalloc_to_page(substream->runtime->dma_area + offset);
+	void *vaddr = substream->runtime->dma_area + offset;
+
+	if (!is_vmalloc_addr(vaddr))
+		return virt_to_page(vaddr);	/* contig_vmalloc buffer */
+	return vmalloc_to_page(vaddr);
 }
 EXPORT_SYMBOL(snd_pcm_lib_get_vmalloc_page);
@@ -414,16 +414,33 @@ int snd_pcm_format_set_silence(snd_pcm_format_t format, void *data, unsigned int
 		memset(data, *pat, bytes);
 		return 0;
 	}
-	/* non-zero samples, fill using a loop */
+	/* non-zero samples; use the wide memset for aligned buffers */
 	width /= 8;
 	dst = data;
-#if 0
-	while (samples--) {
-		memcpy(dst, pat, width);
-		dst += width;
+	if (width != 3 && IS_ALIGNED((unsigned long)dst, width)) {
+		u16 pat16;
+		u32 pat32;
+		u64 pat64;
+
+		switch (width) {
+		case 2:
+			memcpy(&pat16, pat, 2);
+			memset16(data, pat16, samples);
+			return 0;
+		case 4:
+			memcpy(&pat32, pat, 4);
+			memset32(data, pat32, samples);
+			return 0;
+		case 8:
+			memcpy(&pat64, pat, 8);
+			memset64(data, pat64, samples);
+			return 0;
+		}
 	}
-#else
-	/* a bit optimization for constant width */
+
+	/* otherwise fill using a loop, with a bit optimization for
+	 * constant width
+	 */
 	switch (width) {
 	case 2:
 		while (samples--) {
@@ -450,7 +467,6 @@ int snd_pcm_format_set_silence(snd_pcm_format_t format, void *data, unsigned int
 		}
 		break;
 	}
-#endif
 	return 0;
 }
 EXPORT_SYMBOL(snd_pcm_format_set_silence);
@@ -28,6 +28,10 @@
 #include <linux/pm_qos.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/highmem.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/splice.h>
+#include <linux/vmalloc.h>
 #include <sound/core.h>
 #include <sound/control.h>
 #include <sound/info.h>
@@ -84,38 +88,49 @@ static int snd_pcm_open(struct file *file, struct snd_pcm *pcm, int stream);
  *
  */
 
-static DEFINE_RWLOCK(snd_pcm_link_rwlock);
+/* serializes link/unlink against the actions that run without the
+ * stream lock (non-atomic actions, drain); never taken by the stream lock
+ */
 static DECLARE_RWSEM(snd_pcm_link_rwsem);
 
-/* Writer in rwsem may block readers even during its waiting in queue,
- * and this may lead to a deadlock when the code path takes read sem
- * twice (e.g. one in snd_pcm_action_nonatomic() and another in
- * snd_pcm_stream_lock()).  As a (suboptimal) workaround, let writer to
- * spin until it gets the lock.
- */
-static inline void down_write_nonblock(struct rw_semaphore *lock)
+/* bumped at each PCM state change; used for invalidating the refine cache */
+static atomic_t snd_pcm_state_serial = ATOMIC_INIT(0);
+
+void snd_pcm_group_init(struct snd_pcm_group *group)
 {
-	while (!down_write_trylock(lock))
-		cond_resched();
+	spin_lock_init(&group->lock);
+	mutex_init(&group->mutex);
+	INIT_LIST_HEAD(&group->substreams);
+	refcount_set(&group->refs, 1);
+	group->count = 0;
+}
+
+/* define group lock helpers */
+#define DEFINE_PCM_GROUP_LOCK(action, mutex_action) \
+static void snd_pcm_group_ ## action(struct snd_pcm_group *group, bool nonatomic) \
+{ \
+	if (nonatomic) \
+		mutex_ ## mutex_action(&group->mutex); \
+	else \
+		spin_ ## action(&group->lock); \
 }
 
+DEFINE_PCM_GROUP_LOCK(lock, lock);
+DEFINE_PCM_GROUP_LOCK(unlock, unlock);
+DEFINE_PCM_GROUP_LOCK(lock_irq, lock);
+DEFINE_PCM_GROUP_LOCK(unlock_irq, unlock);
+
 /**
  * snd_pcm_stream_lock - Lock the PCM stream
  * @substream: PCM substream
  *
  * This locks the PCM stream's spinlock or mutex depending on the nonatomic
- * flag of the given substream.  This also takes the global link rw lock
- * (or rw sem), too, for avoiding the race with linked streams.
+ * flag of the given substream.  Only the substream's own lock is taken;
+ * the linked streams are locked via their group in snd_pcm_action().
  */
 void snd_pcm_stream_lock(struct snd_pcm_substream *substream)
 {
-	if (substream->pcm->nonatomic) {
-		down_read_nested(&snd_pcm_link_rwsem, SINGLE_DEPTH_NESTING);
-		mutex_lock(&substream->self_group.mutex);
-	} else {
-		read_lock(&snd_pcm_link_rwlock);
-		spin_lock(&substream->self_group.lock);
-	}
+	snd_pcm_group_lock(&substream->self_group, substream->pcm->nonatomic);
 }
 EXPORT_SYMBOL_GPL(snd_pcm_stream_lock);
 
@@ -127,13 +142,7 @@ EXPORT_SYMBOL_GPL(snd_pcm_stream_lock);
  */
 void snd_pcm_stream_unlock(struct snd_pcm_substream *substream)
 {
-	if (substream->pcm->nonatomic) {
-		mutex_unlock(&substream->self_group.mutex);
-		up_read(&snd_pcm_link_rwsem);
-	} else {
-		spin_unlock(&substream->self_group.lock);
-		read_unlock(&snd_pcm_link_rwlock);
-	}
+	snd_pcm_group_unlock(&substream->self_group, substream->pcm->nonatomic);
 }
 EXPORT_SYMBOL_GPL(snd_pcm_stream_unlock);
 
@@ -147,9 +156,8 @@ EXPORT_SYMBOL_GPL(snd_pcm_stream_unlock);
  */
 void snd_pcm_stream_lock_irq(struct snd_pcm_substream *substream)
 {
-	if (!substream->pcm->nonatomic)
-		local_irq_disable();
-	snd_pcm_stream_lock(substream);
+	snd_pcm_group_lock_irq(&substream->self_group,
+			       substream->pcm->nonatomic);
 }
 EXPORT_SYMBOL_GPL(snd_pcm_stream_lock_irq);
 
@@ -161,18 +169,18 @@ EXPORT_SYMBOL_GPL(snd_pcm_stream_lock_irq);
  */
 void snd_pcm_stream_unlock_irq(struct snd_pcm_substream *substream)
 {
-	snd_pcm_stream_unlock(substream);
-	if (!substream->pcm->nonatomic)
-		local_irq_enable();
+	snd_pcm_group_unlock_irq(&substream->self_group,
+				 substream->pcm->nonatomic);
 }
 EXPORT_SYMBOL_GPL(snd_pcm_stream_unlock_irq);
 
 unsigned long _snd_pcm_stream_lock_irqsave(struct snd_pcm_substream *substream)
 {
 	unsigned long flags = 0;
-	if (!substream->pcm->nonatomic)
-		local_irq_save(flags);
-	snd_pcm_stream_lock(substream);
+	if (substream->pcm->nonatomic)
+		mutex_lock(&substream->self_group.mutex);
+	else
+		spin_lock_irqsave(&substream->self_group.lock, flags);
 	return flags;
 }
 EXPORT_SYMBOL_GPL(_snd_pcm_stream_lock_irqsave);
@@ -187,9 +195,10 @@ EXPORT_SYMBOL_GPL(_snd_pcm_stream_lock_irqsave);
 void snd_pcm_stream_unlock_irqrestore(struct snd_pcm_substream *substream,
 				      unsigned long flags)
 {
-	snd_pcm_stream_unlock(substream);
-	if (!substream->pcm->nonatomic)
-		local_irq_restore(flags);
+	if (substream->pcm->nonatomic)
+		mutex_unlock(&substream->self_group.mutex);
+	else
+		spin_unlock_irqrestore(&substream->self_group.lock, flags);
 }
 EXPORT_SYMBOL_GPL(snd_pcm_stream_unlock_irqrestore);
 
@@ -324,71 +333,67 @@ static int constrain_params_by_rules(struct snd_pcm_substream *substream,
 {
 	struct snd_pcm_hw_constraints *constrs =
 					&substream->runtime->hw_constraints;
-	unsigned int k;
-	unsigned int rstamps[constrs->rules_num];
-	unsigned int vstamps[SNDRV_PCM_HW_PARAM_LAST_INTERVAL + 1];
-	unsigned int stamp;
+	unsigned int rules_num = constrs->rules_num;
+	unsigned int depmasks[rules_num];
+	unsigned long pending[BITS_TO_LONGS(rules_num) + 1];
+	unsigned int k, i;
 	struct snd_pcm_hw_rule *r;
 	unsigned int d;
 	struct snd_mask old_mask;
 	struct snd_interval old_interval;
-	bool again;
+	unsigned int applied = 0, changes = 0;
 	int changed;
 
 	/*
-	 * Each application of rule has own sequence number.
+	 * Each member of 'depmasks' array represents the set of parameters
+	 * which the corresponding rule depends on.
 	 *
-	 * Each member of 'rstamps' array represents the sequence number of
-	 * recent application of corresponding rule.
-	 */
-	for (k = 0; k < constrs->rules_num; k++)
-		rstamps[k] = 0;
-
-	/*
-	 * Each member of 'vstamps' array represents the sequence number of
-	 * recent application of rule in which corresponding parameters were
-	 * changed.
+	 * Check condition bits of the rule. When the rule has some
+	 * condition bits, parameter without the bits is never processed.
+	 * SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP is an example of the
+	 * condition bits.  Such a rule gets no dependency, thus it's never
+	 * queued.
 	 *
-	 * In initial state, elements corresponding to parameters requested by
-	 * a caller is 1. For unrequested parameters, corresponding members
-	 * have 0 so that the parameters are never changed anymore.
+	 * The 'deps' array includes maximum three dependencies to
+	 * SNDRV_PCM_HW_PARAM_XXXs for this rule. The fourth member of this
+	 * array is a sentinel and should be negative value.
 	 */
-	for (k = 0; k <= SNDRV_PCM_HW_PARAM_LAST_INTERVAL; k++)
-		vstamps[k] = (params->rmask & (1 << k)) ? 1 : 0;
-
-	/* Due to the above design, actual sequence number starts at 2. */
-	stamp = 2;
-retry:
-	/* Apply all rules in order. */
-	again = false;
-	for (k = 0; k < constrs->rules_num; k++) {
+	for (k = 0; k < rules_num; k++) {
 		r = &constrs->rules[k];
-
-		/*
-		 * Check condition bits of this rule. When the rule has
-		 * some condition bits, parameter without the bits is
-		 * never processed. SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP
-		 * is an example of the condition bits.
-		 */
+		depmasks[k] = 0;
 		if (r->cond && !(r->cond & params->flags))
 			continue;
+		for (d = 0; r->deps[d] >= 0; d++)
+			depmasks[k] |= 1 << r->deps[d];
+	}
 
-		/*
-		 * The 'deps' array includes maximum three dependencies
-		 * to SNDRV_PCM_HW_PARAM_XXXs for this rule. The fourth
-		 * member of this array is a sentinel and should be
-		 * negative value.
-		 *
-		 * This rule should be processed in this time when dependent
-		 * parameters were changed at former applications of the other
-		 * rules.
-		 */
-		for (d = 0; r->deps[d] >= 0; d++) {
-			if (vstamps[r->deps[d]] > rstamps[k])
+	/*
+	 * The 'pending' bitmap is the work list of rules to be applied.
+	 * In initial state, the rules depending on any parameters requested
+	 * by a caller are queued.  Unrequested parameters are never changed
+	 * anymore, so the rules depending only on them are skipped.
+	 */
+	bitmap_zero(pending, rules_num);
+	for (k = 0; k < rules_num; k++) {
+		if (depmasks[k] & params->rmask)
+			__set_bit(k, pending);
+	}
+
+	/*
+	 * Apply the queued rules in the order of registration, and wrap
+	 * around until the work list gets empty.  A rule is queued again
+	 * only when a parameter it depends on is changed by another rule.
+	 */
+	k = 0;
+	for (;;) {
+		k = find_next_bit(pending, rules_num, k);
+		if (k >= rules_num) {
+			k = find_first_bit(pending, rules_num);
+			if (k >= rules_num)
 				break;
 		}
-		if (r->deps[d] < 0)
-			continue;
+		__clear_bit(k, pending);
+		r = &constrs->rules[k];
 
 		if (trace_hw_mask_param_enabled()) {
 			if (hw_is_mask(r->var))
@@ -400,13 +405,14 @@ static int constrain_params_by_rules(struct snd_pcm_substream *substream,
 		}
 
 		changed = r->func(params, r);
+		applied++;
 		if (changed < 0)
 			return changed;
 
 		/*
 		 * When the parameter is changed, notify it to the caller
-		 * by corresponding returned bit, then preparing for next
-		 * iteration.
+		 * by corresponding returned bit, then queue the other rules
+		 * depending on it.
 		 */
 		if (changed && r->var >= 0) {
 			if (hw_is_mask(r->var)) {
@@ -421,16 +427,17 @@ static int constrain_params_by_rules(struct snd_pcm_substream *substream,
 			}
 
 			params->cmask |= (1 << r->var);
-			vstamps[r->var] = stamp;
-			again = true;
+			changes++;
+			for (i = 0; i < rules_num; i++) {
+				if (i != k && (depmasks[i] & (1 << r->var)))
+					__set_bit(i, pending);
+			}
 		}
 
-		rstamps[k] = stamp++;
+		k++;
 	}
 
-	/* Iterate to evaluate all rules till no parameters are changed. */
-	if (again)
-		goto retry;
+	trace_hw_rules_eval(substream, applied, changes);
 
 	return 0;
 }
@@ -470,7 +477,8 @@ static int fixup_unreferenced_params(struct snd_pcm_substream *substream,
 	if (!params->info) {
 		params->info = substream->runtime->hw.info;
 		params->info &= ~(SNDRV_PCM_INFO_FIFO_IN_FRAMES |
-				  SNDRV_PCM_INFO_DRAIN_TRIGGER);
+				  SNDRV_PCM_INFO_DRAIN_TRIGGER |
+				  SNDRV_PCM_INFO_MONOTONIC_POINTER);
 		if (!hw_support_mmap(substream))
 			params->info &= ~(SNDRV_PCM_INFO_MMAP |
 					  SNDRV_PCM_INFO_MMAP_VALID);
@@ -479,6 +487,103 @@ static int fixup_unreferenced_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * HW_REFINE result cache
+ *
+ * Applications tend to issue the very same HW_REFINE request many times
+ * while configuring a stream, and the result is a function of the given
+ * parameters, the constraints of the runtime and, for some drivers, the
+ * state of the other streams or the controls of the card.  Keep the last
+ * few results per runtime, and drop them all when the constraints are
+ * changed, when any PCM stream changes its state or when a control of the
+ * card is notified.
+ */
+#define SND_PCM_REFINE_CACHE_SIZE	4
+
+struct snd_pcm_refine_cache_entry {
+	struct snd_pcm_hw_params in;
+	struct snd_pcm_hw_params out;
+	int err;
+};
+
+struct snd_pcm_refine_cache {
+	struct mutex lock;
+	unsigned int serial;		/* snd_pcm_state_serial at filling */
+	unsigned int ctl_serial;	/* card->ctl_serial at filling */
+	struct snd_pcm_hw_constraints constrs;	/* without rules */
+	unsigned int used;
+	unsigned int next;		/* the entry to be replaced next */
+	struct snd_pcm_refine_cache_entry entries[SND_PCM_REFINE_CACHE_SIZE];
+};
+
+static void snd_pcm_state_changed(void)
+{
+	atomic_inc(&snd_pcm_state_serial);
+}
+
+static bool refine_cache_valid(struct snd_pcm_refine_cache *cache,
+			       struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	const struct snd_pcm_hw_constraints *constrs = &runtime->hw_constraints;
+
+	return cache->serial == atomic_read(&snd_pcm_state_serial) &&
+		cache->ctl_serial == atomic_read(&substream->pcm->card->ctl_serial) &&
+		cache->constrs.rules_num == constrs->rules_num &&
+		!memcmp(cache->constrs.masks, constrs->masks,
+			sizeof(constrs->masks)) &&
+		!memcmp(cache->constrs.intervals, constrs->intervals,
+			sizeof(constrs->intervals));
+}
+
+static void refine_cache_reset(struct snd_pcm_refine_cache *cache,
+			       struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	const struct snd_pcm_hw_constraints *constrs = &runtime->hw_constraints;
+
+	cache->serial = atomic_read(&snd_pcm_state_serial);
+	cache->ctl_serial = atomic_read(&substream->pcm->card->ctl_serial);
+	memcpy(cache->constrs.masks, constrs->masks, sizeof(constrs->masks));
+	memcpy(cache->constrs.intervals, constrs->intervals,
+	       sizeof(constrs->intervals));
+	cache->constrs.rules_num = constrs->rules_num;
+	cache->used = 0;
+	cache->next = 0;
+}
+
+/* look up the cache; call with cache->lock held */
+static struct snd_pcm_refine_cache_entry *
+refine_cache_find(struct snd_pcm_refine_cache *cache,
+		  struct snd_pcm_substream *substream,
+		  const struct snd_pcm_hw_params *params)
+{
+	unsigned int i;
+
+	if (!refine_cache_valid(cache, substream)) {
+		refine_cache_reset(cache, substream);
+		return NULL;
+	}
+	for (i = 0; i < cache->used; i++) {
+		if (!memcmp(&cache->entries[i].in, params, sizeof(*params)))
+			return &cache->entries[i];
+	}
+	return NULL;
+}
+
+/* take the entry to be filled next; call with cache->lock held */
+static struct snd_pcm_refine_cache_entry *
+refine_cache_new_entry(struct snd_pcm_refine_cache *cache)
+{
+	struct snd_pcm_refine_cache_entry *entry;
+
+	entry = &cache->entries[cache->next];
+	cache->next = (cache->next + 1) % SND_PCM_REFINE_CACHE_SIZE;
+	if (cache->used < SND_PCM_REFINE_CACHE_SIZE)
+		cache->used++;
+	return entry;
+}
+
 int snd_pcm_hw_refine(struct snd_pcm_substream *substream,
 		      struct snd_pcm_hw_params *params)
 {
@@ -511,6 +616,39 @@ int snd_pcm_hw_refine(struct snd_pcm_substream *substream,
 }
 EXPORT_SYMBOL(snd_pcm_hw_refine);
 
+static int snd_pcm_hw_refine_cached(struct snd_pcm_substream *substream,
+				    struct snd_pcm_hw_params *params)
+{
+	struct snd_pcm_refine_cache *cache = substream->runtime->refine_cache;
+	struct snd_pcm_refine_cache_entry *entry = NULL;
+	int err;
+
+	if (cache) {
+		mutex_lock(&cache->lock);
+		entry = refine_cache_find(cache, substream, params);
+		if (entry) {
+			*params = entry->out;
+			err = entry->err;
+			goto unlock;
+		}
+		entry = refine_cache_new_entry(cache);
+		entry->in = *params;
+	}
+
+	err = snd_pcm_hw_refine(substream, params);
+	if (err >= 0)
+		err = fixup_unreferenced_params(substream, params);
+
+	if (entry) {
+		entry->out = *params;
+		entry->err = err;
+	}
+ unlock:
+	if (cache)
+		mutex_unlock(&cache->lock);
+	return err;
+}
+
 static int snd_pcm_hw_refine_user(struct snd_pcm_substream *substream,
 				  struct snd_pcm_hw_params __user * _params)
 {
@@ -521,11 +659,7 @@ static int snd_pcm_hw_refine_user(struct snd_pcm_substream *substream,
 	if (IS_ERR(params))
 		return PTR_ERR(params);
 
-	err = snd_pcm_hw_refine(substream, params);
-	if (err < 0)
-		goto end;
-
-	err = fixup_unreferenced_params(substream, params);
+	err = snd_pcm_hw_refine_cached(substream, params);
 	if (err < 0)
 		goto end;
 
@@ -556,7 +690,9 @@ static void snd_pcm_set_state(struct snd_pcm_substream *substream, int state)
 	snd_pcm_stream_lock_irq(substream);
 	if (substream->runtime->status->state != SNDRV_PCM_STATE_DISCONNECTED)
 		substream->runtime->status->state = state;
+	snd_pcm_compat_mmap_update(substream->runtime);
 	snd_pcm_stream_unlock_irq(substream);
+	snd_pcm_state_changed();
 }
 
 static inline void snd_pcm_timer_notify(struct snd_pcm_substream *substream,
@@ -633,13 +769,43 @@ static int snd_pcm_hw_params_choose(struct snd_pcm_substream *pcm,
 	return 0;
 }
 
+/* reset the sw params and enter the SETUP state after a hw_params change */
+static void snd_pcm_hw_params_done(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	int usecs;
+
+	/* Default sw params */
+	runtime->tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
+	runtime->period_step = 1;
+	runtime->control->avail_min = runtime->period_size;
+	runtime->start_threshold = 1;
+	runtime->stop_threshold = runtime->buffer_size;
+	runtime->silence_threshold = 0;
+	runtime->silence_size = 0;
+	runtime->wakeup_frames = 0;
+	runtime->boundary = runtime->buffer_size;
+	while (runtime->boundary * 2 <= LONG_MAX - runtime->buffer_size)
+		runtime->boundary *= 2;
+
+	snd_pcm_timer_resolution_change(substream);
+	snd_pcm_set_state(substream, SNDRV_PCM_STATE_SETUP);
+
+	if (pm_qos_request_active(&substream->latency_pm_qos_req))
+		pm_qos_remove_request(&substream->latency_pm_qos_req);
+	if ((usecs = period_to_usecs(runtime)) >= 0)
+		pm_qos_add_request(&substream->latency_pm_qos_req,
+				   PM_QOS_CPU_DMA_LATENCY, usecs);
+}
+
 static int snd_pcm_hw_params(struct snd_pcm_substream *substream,
 			     struct snd_pcm_hw_params *params)
 {
 	struct snd_pcm_runtime *runtime;
-	int err, usecs;
+	int err;
 	unsigned int bits;
 	snd_pcm_uframes_t frames;
+	bool deinterleave;
 
 	if (PCM_RUNTIME_CHECK(substream))
 		return -ENXIO;
@@ -674,12 +840,23 @@ static int snd_pcm_hw_params(struct snd_pcm_substream *substream,
 	if (err < 0)
 		goto _error;
 
+	/* the driver sees the access type it actually supports */
+	deinterleave = params_access(params) == SNDRV_PCM_ACCESS_RW_INTERLEAVED &&
+		!(runtime->hw.info & SNDRV_PCM_INFO_INTERLEAVED);
+	if (deinterleave)
+		snd_mask_leave(hw_param_mask(params, SNDRV_PCM_HW_PARAM_ACCESS),
+			       SNDRV_PCM_ACCESS_RW_NONINTERLEAVED);
+
 	if (substream->ops->hw_params != NULL) {
 		err = substream->ops->hw_params(substream, params);
 		if (err < 0)
 			goto _error;
 	}
 
+	if (deinterleave)
+		snd_mask_leave(hw_param_mask(params, SNDRV_PCM_HW_PARAM_ACCESS),
+			       SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+
 	runtime->access = params_access(params);
 	runtime->format = params_format(params);
 	runtime->subformat = params_subformat(params);
@@ -694,6 +871,9 @@ static int snd_pcm_hw_params(struct snd_pcm_substream *substream,
 	runtime->no_period_wakeup =
 			(params->info & SNDRV_PCM_INFO_NO_PERIOD_WAKEUP) &&
 			(params->flags & SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP);
+	runtime->live_status =
+			!!(params->flags & SNDRV_PCM_HW_PARAMS_LIVE_STATUS);
+	runtime->status->pad1 = 0;
 
 	bits = snd_pcm_format_physical_width(runtime->format);
 	runtime->sample_bits = bits;
@@ -707,26 +887,11 @@ static int snd_pcm_hw_params(struct snd_pcm_substream *substream,
 	runtime->byte_align = bits / 8;
 	runtime->min_align = frames;
 
-	/* Default sw params */
-	runtime->tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
-	runtime->period_step = 1;
-	runtime->control->avail_min = runtime->period_size;
-	runtime->start_threshold = 1;
-	runtime->stop_threshold = runtime->buffer_size;
-	runtime->silence_threshold = 0;
-	runtime->silence_size = 0;
-	runtime->boundary = runtime->buffer_size;
-	while (runtime->boundary * 2 <= LONG_MAX - runtime->buffer_size)
-		runtime->boundary *= 2;
-
-	snd_pcm_timer_resolution_change(substream);
-	snd_pcm_set_state(substream, SNDRV_PCM_STATE_SETUP);
+	err = snd_pcm_deinterleave_setup(substream, deinterleave);
+	if (err < 0)
+		goto _error;
 
-	if (pm_qos_request_active(&substream->latency_pm_qos_req))
-		pm_qos_remove_request(&substream->latency_pm_qos_req);
-	if ((usecs = period_to_usecs(runtime)) >= 0)
-		pm_qos_add_request(&substream->latency_pm_qos_req,
-				   PM_QOS_CPU_DMA_LATENCY, usecs);
+	snd_pcm_hw_params_done(substream);
 	return 0;
  _error:
 	/* hardware might be unusable from this time,
@@ -759,6 +924,137 @@ static int snd_pcm_hw_params_user(struct snd_pcm_substream *substream,
 	return err;
 }
 
+/*
+ * the size of the allocated buffer, which may be more than the dma_bytes
+ * of the current setup when the driver keeps a larger buffer
+ */
+static size_t snd_pcm_buffer_capacity(struct snd_pcm_runtime *runtime)
+{
+	if (runtime->dma_buffer_p &&
+	    runtime->dma_buffer_p->area == runtime->dma_area)
+		return max(runtime->dma_buffer_p->bytes, runtime->dma_bytes);
+	return runtime->dma_bytes;
+}
+
+/*
+ * Change the hw_params of a set-up stream.  When only the buffer and
+ * period sizes change and the driver has the hw_reconfig callback, the
+ * driver applies them in place, keeping its format setup and the buffer
+ * when it's large enough; this is also allowed while the buffer is
+ * mmapped, as long as the new buffer fits in it.  Anything else is done
+ * as a plain hw_params call.  The sw params are reset as with hw_params.
+ * A failed reconfig of a mmapped stream keeps its current setup.
+ */
+static int snd_pcm_hw_reconfig(struct snd_pcm_substream *substream,
+			       struct snd_pcm_hw_params *params)
+{
+	struct snd_pcm_runtime *runtime;
+	bool deinterleave;
+	int err;
+
+	if (PCM_RUNTIME_CHECK(substream))
+		return -ENXIO;
+	runtime = substream->runtime;
+	snd_pcm_stream_lock_irq(substream);
+	switch (runtime->status->state) {
+	case SNDRV_PCM_STATE_SETUP:
+	case SNDRV_PCM_STATE_PREPARED:
+		break;
+	case SNDRV_PCM_STATE_OPEN:
+		snd_pcm_stream_unlock_irq(substream);
+		return snd_pcm_hw_params(substream, params);
+	default:
+		snd_pcm_stream_unlock_irq(substream);
+		return -EBADFD;
+	}
+	snd_pcm_stream_unlock_irq(substream);
+	if (!substream->ops->hw_reconfig)
+		return snd_pcm_hw_params(substream, params);
+
+	params->rmask = ~0U;
+	err = snd_pcm_hw_refine(substream, params);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_choose(substream, params);
+	if (err < 0)
+		return err;
+	err = fixup_unreferenced_params(substream, params);
+	if (err < 0)
+		return err;
+
+	if (params_access(params) != runtime->access ||
+	    params_format(params) != runtime->format ||
+	    params_subformat(params) != runtime->subformat ||
+	    params_channels(params) != runtime->channels ||
+	    params_rate(params) != runtime->rate)
+		return snd_pcm_hw_params(substream, params);
+
+#if IS_ENABLED(CONFIG_SND_PCM_OSS)
+	if (!substream->oss.oss)
+#endif
+		if (atomic_read(&substream->mmap_count) &&
+		    params_buffer_bytes(params) > snd_pcm_buffer_capacity(runtime))
+			return -EBADFD;
+
+	deinterleave = params_access(params) == SNDRV_PCM_ACCESS_RW_INTERLEAVED &&
+		!(runtime->hw.info & SNDRV_PCM_INFO_INTERLEAVED);
+	if (deinterleave)
+		snd_mask_leave(hw_param_mask(params, SNDRV_PCM_HW_PARAM_ACCESS),
+			       SNDRV_PCM_ACCESS_RW_NONINTERLEAVED);
+	err = substream->ops->hw_reconfig(substream, params);
+	if (deinterleave)
+		snd_mask_leave(hw_param_mask(params, SNDRV_PCM_HW_PARAM_ACCESS),
+			       SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+	if (err < 0)
+		goto _error;
+
+	runtime->period_size = params_period_size(params);
+	runtime->periods = params_periods(params);
+	runtime->buffer_size = params_buffer_size(params);
+	runtime->info = params->info;
+	runtime->no_period_wakeup =
+			(params->info & SNDRV_PCM_INFO_NO_PERIOD_WAKEUP) &&
+			(params->flags & SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP);
+	runtime->live_status =
+			!!(params->flags & SNDRV_PCM_HW_PARAMS_LIVE_STATUS);
+
+	snd_pcm_hw_params_done(substream);
+	return 0;
+ _error:
+	/*
+	 * The buffer mapped by the application can't be released under it:
+	 * the driver left its setup unchanged, and so does the stream.
+	 */
+	if (atomic_read(&substream->mmap_count))
+		return err;
+	/* as with hw_params, the application has to set up again */
+	snd_pcm_set_state(substream, SNDRV_PCM_STATE_OPEN);
+	if (substream->ops->hw_free != NULL)
+		substream->ops->hw_free(substream);
+	return err;
+}
+
+static int snd_pcm_hw_reconfig_user(struct snd_pcm_substream *substream,
+				    struct snd_pcm_hw_params __user *_params)
+{
+	struct snd_pcm_hw_params *params;
+	int err;
+
+	params = memdup_user(_params, sizeof(*params));
+	if (IS_ERR(params))
+		return PTR_ERR(params);
+
+	err = snd_pcm_hw_reconfig(substream, params);
+	if (err < 0)
+		goto end;
+
+	if (copy_to_user(_params, params, sizeof(*params)))
+		err = -EFAULT;
+end:
+	kfree(params);
+	return err;
+}
+
 static int snd_pcm_hw_free(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime;
@@ -781,6 +1077,7 @@ static int snd_pcm_hw_free(struct snd_pcm_substream *substream)
 		return -EBADFD;
 	if (substream->ops->hw_free)
 		result = substream->ops->hw_free(substream);
+	snd_pcm_deinterleave_setup(substream, false);
 	snd_pcm_set_state(substream, SNDRV_PCM_STATE_OPEN);
 	pm_qos_remove_request(&substream->latency_pm_qos_req);
 	return result;
@@ -810,6 +1107,14 @@ static int snd_pcm_sw_params(struct snd_pcm_substream *substream,
 		return -EINVAL;
 	if (params->avail_min == 0)
 		return -EINVAL;
+	if (params->proto >= SNDRV_PROTOCOL_VERSION(2, 0, 16) &&
+	    params->wakeup_frames) {
+		/* the timer callback takes the stream lock in hardirq */
+		if (substream->pcm->nonatomic)
+			return -EINVAL;
+		if (params->wakeup_frames > runtime->buffer_size)
+			return -EINVAL;
+	}
 	if (params->silence_size >= runtime->boundary) {
 		if (params->silence_threshold != 0)
 			return -EINVAL;
@@ -830,13 +1135,20 @@ static int snd_pcm_sw_params(struct snd_pcm_substream *substream,
 	runtime->stop_threshold = params->stop_threshold;
 	runtime->silence_threshold = params->silence_threshold;
 	runtime->silence_size = params->silence_size;
+	if (params->proto >= SNDRV_PROTOCOL_VERSION(2, 0, 16))
+		runtime->wakeup_frames = params->wakeup_frames;
         params->boundary = runtime->boundary;
 	if (snd_pcm_running(substream)) {
+		if (runtime->wakeup_frames)
+			snd_pcm_wakeup_timer_start(substream);
+		else
+			snd_pcm_wakeup_timer_stop(substream);
 		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
 		    runtime->silence_size > 0)
 			snd_pcm_playback_silence(substream, ULONG_MAX);
 		err = snd_pcm_update_state(substream, runtime);
 	}
+	snd_pcm_compat_mmap_update(runtime);
 	snd_pcm_stream_unlock_irq(substream);
 	return err;
 }
@@ -1015,7 +1327,7 @@ struct action_ops {
 /*
  *  this functions is core for handling of linked stream
  *  Note: the stream state might be changed also on failure
- *  Note2: call with calling stream lock + link lock
+ *  Note2: call with calling stream lock + group lock (or link rwsem)
  */
 static int snd_pcm_action_group(const struct action_ops *ops,
 				struct snd_pcm_substream *substream,
@@ -1025,6 +1337,8 @@ static int snd_pcm_action_group(const struct action_ops *ops,
 	struct snd_pcm_substream *s1;
 	int res = 0, depth = 1;
 
+	snd_pcm_state_changed();
+
 	snd_pcm_group_for_each_entry(s, substream) {
 		if (do_lock && s != substream) {
 			if (s->pcm->nonatomic)
@@ -1053,6 +1367,7 @@ static int snd_pcm_action_group(const struct action_ops *ops,
 	}
 	snd_pcm_group_for_each_entry(s, substream) {
 		ops->post_action(s, state);
+		snd_pcm_compat_mmap_update(s->runtime);
 	}
  _unlock:
 	if (do_lock) {
@@ -1079,7 +1394,8 @@ static int snd_pcm_action_single(const struct action_ops *ops,
 				 int state)
 {
 	int res;
-	
+
+	snd_pcm_state_changed();
 	res = ops->pre_action(substream, state);
 	if (res < 0)
 		return res;
@@ -1088,9 +1404,63 @@ static int snd_pcm_action_single(const struct action_ops *ops,
 		ops->post_action(substream, state);
 	else if (ops->undo_action)
 		ops->undo_action(substream, state);
+	snd_pcm_compat_mmap_update(substream->runtime);
 	return res;
 }
 
+/* release the group taken by snd_pcm_stream_group_ref(), and unlock it */
+static void snd_pcm_group_unref(struct snd_pcm_group *group,
+				struct snd_pcm_substream *substream)
+{
+	bool do_free;
+
+	if (!group)
+		return;
+	do_free = refcount_dec_and_test(&group->refs);
+	snd_pcm_group_unlock(group, substream->pcm->nonatomic);
+	if (do_free)
+		kfree(group);
+}
+
+/*
+ * Lock the group of a linked stream; the caller holds the stream lock.
+ * Returns NULL if the stream isn't linked.  The group is looked up again
+ * after re-locking, since it may be unlinked while the stream lock is
+ * dropped; the reference keeps it from being freed meanwhile.
+ */
+static struct snd_pcm_group *
+snd_pcm_stream_group_ref(struct snd_pcm_substream *substream)
+{
+	bool nonatomic = substream->pcm->nonatomic;
+	struct snd_pcm_group *group;
+	bool trylock;
+
+	for (;;) {
+		if (!snd_pcm_stream_linked(substream))
+			return NULL;
+		group = substream->group;
+		/* block freeing the group object */
+		refcount_inc(&group->refs);
+
+		trylock = nonatomic ? mutex_trylock(&group->mutex) :
+			spin_trylock(&group->lock);
+		if (trylock)
+			break; /* OK */
+
+		/* re-lock for avoiding ABBA deadlock */
+		snd_pcm_stream_unlock(substream);
+		snd_pcm_group_lock(group, nonatomic);
+		snd_pcm_stream_lock(substream);
+
+		/* check the group again; the above opens a small race window */
+		if (substream->group == group)
+			break; /* OK */
+		/* group changed, try again */
+		snd_pcm_group_unref(group, substream);
+	}
+	return group;
+}
+
 /*
  *  Note: call with stream lock
  */
@@ -1098,28 +1468,15 @@ static int snd_pcm_action(const struct action_ops *ops,
 			  struct snd_pcm_substream *substream,
 			  int state)
 {
+	struct snd_pcm_group *group;
 	int res;
 
-	if (!snd_pcm_stream_linked(substream))
-		return snd_pcm_action_single(ops, substream, state);
-
-	if (substream->pcm->nonatomic) {
-		if (!mutex_trylock(&substream->group->mutex)) {
-			mutex_unlock(&substream->self_group.mutex);
-			mutex_lock(&substream->group->mutex);
-			mutex_lock(&substream->self_group.mutex);
-		}
+	group = snd_pcm_stream_group_ref(substream);
+	if (group)
 		res = snd_pcm_action_group(ops, substream, state, 1);
-		mutex_unlock(&substream->group->mutex);
-	} else {
-		if (!spin_trylock(&substream->group->lock)) {
-			spin_unlock(&substream->self_group.lock);
-			spin_lock(&substream->group->lock);
-			spin_lock(&substream->self_group.lock);
-		}
-		res = snd_pcm_action_group(ops, substream, state, 1);
-		spin_unlock(&substream->group->lock);
-	}
+	else
+		res = snd_pcm_action_single(ops, substream, state);
+	snd_pcm_group_unref(group, substream);
 	return res;
 }
 
@@ -1146,6 +1503,7 @@ static int snd_pcm_action_nonatomic(const struct action_ops *ops,
 {
 	int res;
 
+	/* Guarantee the group members won't change during non-atomic action */
 	down_read(&snd_pcm_link_rwsem);
 	if (snd_pcm_stream_linked(substream))
 		res = snd_pcm_action_group(ops, substream, state, 0);
@@ -1187,14 +1545,17 @@ static void snd_pcm_undo_start(struct snd_pcm_substream *substream, int state)
 static void snd_pcm_post_start(struct snd_pcm_substream *substream, int state)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
+	snd_pcm_stats_restart(substream);
 	snd_pcm_trigger_tstamp(substream);
 	runtime->hw_ptr_jiffies = jiffies;
 	runtime->hw_ptr_buffer_jiffies = (runtime->buffer_size * HZ) / 
 							    runtime->rate;
 	runtime->status->state = state;
+	snd_pcm_flight_state(substream);
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
 	    runtime->silence_size > 0)
 		snd_pcm_playback_silence(substream, ULONG_MAX);
+	snd_pcm_wakeup_timer_start(substream);
 	snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MSTART);
 }
 
@@ -1251,8 +1612,10 @@ static void snd_pcm_post_stop(struct snd_pcm_substream *substream, int state)
 	if (runtime->status->state != state) {
 		snd_pcm_trigger_tstamp(substream);
 		runtime->status->state = state;
+		snd_pcm_flight_state(substream);
 		snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MSTOP);
 	}
+	snd_pcm_wakeup_timer_stop(substream);
 	wake_up(&runtime->sleep);
 	wake_up(&runtime->tsleep);
 }
@@ -1364,11 +1727,16 @@ static void snd_pcm_post_pause(struct snd_pcm_substream *substream, int push)
 	snd_pcm_trigger_tstamp(substream);
 	if (push) {
 		runtime->status->state = SNDRV_PCM_STATE_PAUSED;
+		snd_pcm_flight_state(substream);
+		snd_pcm_wakeup_timer_stop(substream);
 		snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MPAUSE);
 		wake_up(&runtime->sleep);
 		wake_up(&runtime->tsleep);
 	} else {
 		runtime->status->state = SNDRV_PCM_STATE_RUNNING;
+		snd_pcm_flight_state(substream);
+		snd_pcm_stats_restart(substream);
+		snd_pcm_wakeup_timer_start(substream);
 		snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MCONTINUE);
 	}
 }
@@ -1417,6 +1785,8 @@ static void snd_pcm_post_suspend(struct snd_pcm_substream *substream, int state)
 	snd_pcm_trigger_tstamp(substream);
 	runtime->status->suspended_state = runtime->status->state;
 	runtime->status->state = SNDRV_PCM_STATE_SUSPENDED;
+	snd_pcm_flight_state(substream);
+	snd_pcm_wakeup_timer_stop(substream);
 	snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MSUSPEND);
 	wake_up(&runtime->sleep);
 	wake_up(&runtime->tsleep);
@@ -1468,6 +1838,10 @@ int snd_pcm_suspend_all(struct snd_pcm *pcm)
 	if (! pcm)
 		return 0;
 
+	err = snd_pcm_suspend_all(pcm->shared);
+	if (err < 0)
+		return err;
+
 	for (stream = 0; stream < 2; stream++) {
 		for (substream = pcm->streams[stream].substream;
 		     substream; substream = substream->next) {
@@ -1519,6 +1893,9 @@ static void snd_pcm_post_resume(struct snd_pcm_substream *substream, int state)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	snd_pcm_trigger_tstamp(substream);
 	runtime->status->state = runtime->status->suspended_state;
+	snd_pcm_flight_state(substream);
+	snd_pcm_stats_restart(substream);
+	snd_pcm_wakeup_timer_start(substream);
 	snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MRESUME);
 }
 
@@ -1899,6 +2276,16 @@ static int snd_pcm_drop(struct snd_pcm_substream *substream)
 }
 
 
+/* move the substream to the given group; call with the stream lock */
+static void snd_pcm_group_assign(struct snd_pcm_substream *substream,
+				 struct snd_pcm_group *new_group)
+{
+	substream->group->count--;
+	substream->group = new_group;
+	list_move(&substream->link_list, &new_group->substreams);
+	new_group->count++;
+}
+
 static bool is_pcm_file(struct file *file)
 {
 	struct inode *inode = file_inode(file);
@@ -1919,7 +2306,8 @@ static int snd_pcm_link(struct snd_pcm_substream *substream, int fd)
 	int res = 0;
 	struct snd_pcm_file *pcm_file;
 	struct snd_pcm_substream *substream1;
-	struct snd_pcm_group *group;
+	struct snd_pcm_group *group, *target_group;
+	bool nonatomic = substream->pcm->nonatomic;
 	struct fd f = fdget(fd);
 
 	if (!f.file)
@@ -1930,13 +2318,14 @@ static int snd_pcm_link(struct snd_pcm_substream *substream, int fd)
 	}
 	pcm_file = f.file->private_data;
 	substream1 = pcm_file->substream;
-	group = kmalloc(sizeof(*group), GFP_KERNEL);
+	group = kzalloc(sizeof(*group), GFP_KERNEL);
 	if (!group) {
 		res = -ENOMEM;
 		goto _nolock;
 	}
-	down_write_nonblock(&snd_pcm_link_rwsem);
-	write_lock_irq(&snd_pcm_link_rwlock);
+	snd_pcm_group_init(group);
+
+	down_write(&snd_pcm_link_rwsem);
 	if (substream->runtime->status->state == SNDRV_PCM_STATE_OPEN ||
 	    substream->runtime->status->state != substream1->runtime->status->state ||
 	    substream->pcm->nonatomic != substream1->pcm->nonatomic) {
@@ -1947,20 +2336,22 @@ static int snd_pcm_link(struct snd_pcm_substream *substream, int fd)
 		res = -EALREADY;
 		goto _end;
 	}
+
+	snd_pcm_stream_lock_irq(substream);
 	if (!snd_pcm_stream_linked(substream)) {
-		substream->group = group;
-		group = NULL;
-		spin_lock_init(&substream->group->lock);
-		mutex_init(&substream->group->mutex);
-		INIT_LIST_HEAD(&substream->group->substreams);
-		list_add_tail(&substream->link_list, &substream->group->substreams);
-		substream->group->count = 1;
-	}
-	list_add_tail(&substream1->link_list, &substream->group->substreams);
-	substream->group->count++;
-	substream1->group = substream->group;
+		snd_pcm_group_assign(substream, group);
+		group = NULL; /* assigned, don't free this one below */
+	}
+	target_group = substream->group;
+	snd_pcm_stream_unlock_irq(substream);
+
+	snd_pcm_group_lock_irq(target_group, nonatomic);
+	snd_pcm_stream_lock(substream1);
+	snd_pcm_group_assign(substream1, target_group);
+	refcount_inc(&target_group->refs);
+	snd_pcm_stream_unlock(substream1);
+	snd_pcm_group_unlock_irq(target_group, nonatomic);
  _end:
-	write_unlock_irq(&snd_pcm_link_rwlock);
 	up_write(&snd_pcm_link_rwsem);
  _nolock:
 	snd_card_unref(substream1->pcm->card);
@@ -1972,34 +2363,44 @@ static int snd_pcm_link(struct snd_pcm_substream *substream, int fd)
 
 static void relink_to_local(struct snd_pcm_substream *substream)
 {
-	substream->group = &substream->self_group;
-	INIT_LIST_HEAD(&substream->self_group.substreams);
-	list_add_tail(&substream->link_list, &substream->self_group.substreams);
+	snd_pcm_stream_lock(substream);
+	snd_pcm_group_assign(substream, &substream->self_group);
+	snd_pcm_stream_unlock(substream);
 }
 
 static int snd_pcm_unlink(struct snd_pcm_substream *substream)
 {
-	struct snd_pcm_substream *s;
+	struct snd_pcm_group *group;
+	bool nonatomic = substream->pcm->nonatomic;
+	bool do_free = false;
 	int res = 0;
 
-	down_write_nonblock(&snd_pcm_link_rwsem);
-	write_lock_irq(&snd_pcm_link_rwlock);
+	down_write(&snd_pcm_link_rwsem);
+
 	if (!snd_pcm_stream_linked(substream)) {
 		res = -EALREADY;
 		goto _end;
 	}
-	list_del(&substream->link_list);
-	substream->group->count--;
-	if (substream->group->count == 1) {	/* detach the last stream, too */
-		snd_pcm_group_for_each_entry(s, substream) {
-			relink_to_local(s);
-			break;
-		}
-		kfree(substream->group);
-	}
+
+	group = substream->group;
+	snd_pcm_group_lock_irq(group, nonatomic);
+
 	relink_to_local(substream);
+	refcount_dec(&group->refs);
+
+	/* detach the last stream, too */
+	if (list_is_singular(&group->substreams)) {
+		relink_to_local(list_first_entry(&group->substreams,
+						 struct snd_pcm_substream,
+						 link_list));
+		do_free = refcount_dec_and_test(&group->refs);
+	}
+
+	snd_pcm_group_unlock_irq(group, nonatomic);
+	if (do_free)
+		kfree(group);
+
        _end:
-	write_unlock_irq(&snd_pcm_link_rwlock);
 	up_write(&snd_pcm_link_rwsem);
 	return res;
 }
@@ -2121,7 +2522,7 @@ static int snd_pcm_hw_rule_buffer_bytes_max(struct snd_pcm_hw_params *params,
 	struct snd_interval t;
 	struct snd_pcm_substream *substream = rule->private;
 	t.min = 0;
-	t.max = substream->buffer_bytes_max;
+	t.max = snd_pcm_lib_buffer_bytes_max(substream);
 	t.openmin = 0;
 	t.openmax = 0;
 	t.integer = 1;
@@ -2134,6 +2535,12 @@ int snd_pcm_hw_constraints_init(struct snd_pcm_substream *substream)
 	struct snd_pcm_hw_constraints *constrs = &runtime->hw_constraints;
 	int k, err;
 
+	/* no cache is no error, HW_REFINE just goes through the rules */
+	runtime->refine_cache = kzalloc(sizeof(*runtime->refine_cache),
+					GFP_KERNEL);
+	if (runtime->refine_cache)
+		mutex_init(&runtime->refine_cache->lock);
+
 	for (k = SNDRV_PCM_HW_PARAM_FIRST_MASK; k <= SNDRV_PCM_HW_PARAM_LAST_MASK; k++) {
 		snd_mask_any(constrs_mask(constrs, k));
 	}
@@ -2263,6 +2670,9 @@ int snd_pcm_hw_constraints_complete(struct snd_pcm_substream *substream)
 		mask |= 1 << SNDRV_PCM_ACCESS_RW_INTERLEAVED;
         if (hw->info & SNDRV_PCM_INFO_NONINTERLEAVED)
 		mask |= 1 << SNDRV_PCM_ACCESS_RW_NONINTERLEAVED;
+	/* interleaved read/write is deinterleaved in the kernel copy */
+	if (snd_pcm_deinterleave_supported(substream))
+		mask |= 1 << SNDRV_PCM_ACCESS_RW_INTERLEAVED;
 	if (hw_support_mmap(substream)) {
 		if (hw->info & SNDRV_PCM_INFO_INTERLEAVED)
 			mask |= 1 << SNDRV_PCM_ACCESS_MMAP_INTERLEAVED;
@@ -2361,6 +2771,7 @@ void snd_pcm_release_substream(struct snd_pcm_substream *substream)
 		substream->pcm_release = NULL;
 	}
 	snd_pcm_detach_substream(substream);
+	snd_pcm_state_changed();
 }
 EXPORT_SYMBOL(snd_pcm_release_substream);
 
@@ -2396,6 +2807,7 @@ int snd_pcm_open_substream(struct snd_pcm *pcm, int stream,
 		goto error;
 	}
 
+	snd_pcm_state_changed();
 	*rsubstream = substream;
 	return 0;
 
@@ -2423,6 +2835,7 @@ static int snd_pcm_open_file(struct file *file,
 		return -ENOMEM;
 	}
 	pcm_file->substream = substream;
+	mutex_init(&pcm_file->splice_mutex);
 	if (substream->ref_count == 1) {
 		substream->file = pcm_file;
 		substream->pcm_release = pcm_release_private;
@@ -2529,7 +2942,15 @@ static int snd_pcm_release(struct inode *inode, struct file *file)
 		return -ENXIO;
 	pcm = substream->pcm;
 	mutex_lock(&pcm->open_mutex);
+	if (pcm_file->fanout) {
+		snd_pcm_stream_lock_irq(substream);
+		substream->runtime->fanout_readers--;
+		snd_pcm_stream_unlock_irq(substream);
+		snd_free_pages(pcm_file->fanout,
+			       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control)));
+	}
 	snd_pcm_release_substream(substream);
+	kfree(pcm_file->splice_frame);
 	kfree(pcm_file);
 	mutex_unlock(&pcm->open_mutex);
 	wake_up(&pcm->open_wait);
@@ -2702,7 +3123,79 @@ static snd_pcm_sframes_t snd_pcm_delay(struct snd_pcm_substream *substream)
 	snd_pcm_stream_unlock_irq(substream);
 	return err < 0 ? err : n;
 }
-		
+
+/*
+ * Break the stream latency down per stage.  The ring buffer part is
+ * known here; the driver splits its runtime->delay, and may add stages
+ * it doesn't count there, via the latency op.  Whatever part of
+ * runtime->delay it leaves unassigned is reported as the driver stage,
+ * so that the total never falls below what SNDRV_PCM_IOCTL_DELAY says.
+ */
+int snd_pcm_latency(struct snd_pcm_substream *substream,
+		    struct snd_pcm_latency *latency)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_latency_stage *stage = latency->stage;
+	snd_pcm_uframes_t assigned = 0;
+	int i, err;
+
+	memset(latency, 0, sizeof(*latency));
+	snd_pcm_stream_lock_irq(substream);
+	if (runtime->status->state == SNDRV_PCM_STATE_OPEN) {
+		err = -EBADFD;
+		goto unlock;
+	}
+	if (runtime->status->state == SNDRV_PCM_STATE_RUNNING)
+		snd_pcm_update_hw_ptr(substream);
+	latency->state = runtime->status->state;
+	latency->rate = runtime->rate;
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		stage[SNDRV_PCM_LATENCY_BUFFER].frames =
+			snd_pcm_playback_hw_avail(runtime);
+	else
+		stage[SNDRV_PCM_LATENCY_BUFFER].frames =
+			snd_pcm_capture_avail(runtime);
+	if (substream->ops->latency) {
+		err = substream->ops->latency(substream, latency);
+		if (err < 0)
+			goto unlock;
+		for (i = SNDRV_PCM_LATENCY_DRIVER + 1;
+		     i < SNDRV_PCM_LATENCY_STAGES; i++)
+			assigned += stage[i].frames;
+	}
+	if (runtime->delay > assigned)
+		stage[SNDRV_PCM_LATENCY_DRIVER].frames =
+			runtime->delay - assigned;
+	err = 0;
+ unlock:
+	snd_pcm_stream_unlock_irq(substream);
+	if (err < 0)
+		return err;
+
+	for (i = 0; i < SNDRV_PCM_LATENCY_STAGES; i++) {
+		if (latency->rate)
+			stage[i].ns = div_u64(stage[i].frames * NSEC_PER_SEC,
+					      latency->rate);
+		latency->total.frames += stage[i].frames;
+		latency->total.ns += stage[i].ns;
+	}
+	return 0;
+}
+
+static int snd_pcm_latency_user(struct snd_pcm_substream *substream,
+				struct snd_pcm_latency __user *_latency)
+{
+	struct snd_pcm_latency latency;
+	int err;
+
+	err = snd_pcm_latency(substream, &latency);
+	if (err < 0)
+		return err;
+	if (copy_to_user(_latency, &latency, sizeof(latency)))
+		return -EFAULT;
+	return 0;
+}
+
 static int snd_pcm_sync_ptr(struct snd_pcm_substream *substream,
 			    struct snd_pcm_sync_ptr __user *_sync_ptr)
 {
@@ -2749,6 +3242,292 @@ static int snd_pcm_sync_ptr(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * capture fan-out
+ *
+ * A capture substream already opened by its owner can be shared by
+ * opening it again with O_APPEND.  Such a handle normally shares
+ * everything with the owner; after SNDRV_PCM_IOCTL_FANOUT it keeps its own
+ * snd_pcm_mmap_control instead, so that it reads the shared DMA buffer at
+ * its own pace.  The owner alone drives the stream; a reader that is
+ * lapped by the hardware gets -EPIPE and is resynced to hw_ptr.
+ */
+static int snd_pcm_fanout_attach(struct file *file)
+{
+	struct snd_pcm_file *pcm_file = file->private_data;
+	struct snd_pcm_substream *substream = pcm_file->substream;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_mmap_control *ctl;
+	size_t size = PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control));
+
+	if (substream->stream != SNDRV_PCM_STREAM_CAPTURE ||
+	    !(file->f_flags & O_APPEND))
+		return -EINVAL;
+	ctl = snd_malloc_pages(size, GFP_KERNEL);
+	if (!ctl)
+		return -ENOMEM;
+	memset(ctl, 0, size);
+	snd_pcm_stream_lock_irq(substream);
+	ctl->appl_ptr = runtime->status->hw_ptr;
+	ctl->avail_min = max_t(snd_pcm_uframes_t, runtime->control->avail_min, 1);
+	pcm_file->fanout = ctl;
+	runtime->fanout_readers++;
+	snd_pcm_stream_unlock_irq(substream);
+	return 0;
+}
+
+static snd_pcm_uframes_t
+snd_pcm_fanout_avail(struct snd_pcm_runtime *runtime,
+		     struct snd_pcm_mmap_control *ctl)
+{
+	snd_pcm_sframes_t avail = runtime->status->hw_ptr - ctl->appl_ptr;
+
+	if (avail < 0)
+		avail += runtime->boundary;
+	return avail;
+}
+
+static snd_pcm_sframes_t snd_pcm_fanout_read(struct snd_pcm_file *pcm_file,
+					     void __user *buf,
+					     snd_pcm_uframes_t size,
+					     bool nonblock)
+{
+	struct snd_pcm_substream *substream = pcm_file->substream;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_mmap_control *ctl = pcm_file->fanout;
+	snd_pcm_uframes_t avail, frames, ofs, xfer = 0;
+	long tout;
+	int err = 0;
+
+	snd_pcm_stream_lock_irq(substream);
+	if (runtime->status->state == SNDRV_PCM_STATE_OPEN) {
+		err = -EBADFD;
+		goto out;
+	}
+	/* readers copy straight from the DMA buffer */
+	if (!runtime->dma_area || substream->ops->copy_user ||
+	    runtime->deinterleave_buf ||
+	    (runtime->access != SNDRV_PCM_ACCESS_RW_INTERLEAVED &&
+	     runtime->access != SNDRV_PCM_ACCESS_MMAP_INTERLEAVED)) {
+		err = -EINVAL;
+		goto out;
+	}
+	while (size > 0) {
+		switch (runtime->status->state) {
+		case SNDRV_PCM_STATE_RUNNING:
+		case SNDRV_PCM_STATE_DRAINING:
+		case SNDRV_PCM_STATE_PAUSED:
+			break;
+		case SNDRV_PCM_STATE_XRUN:
+			err = -EPIPE;
+			goto out;
+		case SNDRV_PCM_STATE_SUSPENDED:
+			err = -ESTRPIPE;
+			goto out;
+		default:
+			err = -EBADFD;
+			goto out;
+		}
+		avail = snd_pcm_fanout_avail(runtime, ctl);
+		if (avail > runtime->buffer_size) {
+			/* lapped by the hardware; restart from hw_ptr */
+			ctl->appl_ptr = runtime->status->hw_ptr;
+			err = -EPIPE;
+			goto out;
+		}
+		if (!avail) {
+			if (runtime->status->state != SNDRV_PCM_STATE_RUNNING) {
+				if (runtime->status->state ==
+				    SNDRV_PCM_STATE_PAUSED)
+					err = -EAGAIN;
+				goto out;
+			}
+			if (nonblock) {
+				err = -EAGAIN;
+				goto out;
+			}
+			snd_pcm_stream_unlock_irq(substream);
+			tout = wait_event_interruptible_timeout(runtime->sleep,
+				snd_pcm_fanout_avail(runtime, ctl) ||
+				runtime->status->state != SNDRV_PCM_STATE_RUNNING,
+				msecs_to_jiffies(10 * 1000));
+			snd_pcm_stream_lock_irq(substream);
+			if (tout < 0) {
+				err = -ERESTARTSYS;
+				goto out;
+			}
+			if (!tout) {
+				err = -EIO;
+				goto out;
+			}
+			continue;
+		}
+		ofs = ctl->appl_ptr % runtime->buffer_size;
+		frames = min(size, avail);
+		frames = min(frames, runtime->buffer_size - ofs);
+		snd_pcm_stream_unlock_irq(substream);
+		if (copy_to_user(buf,
+				 runtime->dma_area + frames_to_bytes(runtime, ofs),
+				 frames_to_bytes(runtime, frames)))
+			err = -EFAULT;
+		snd_pcm_stream_lock_irq(substream);
+		if (err < 0)
+			goto out;
+		/* overwritten while copying? then the next round fails */
+		if (snd_pcm_fanout_avail(runtime, ctl) > runtime->buffer_size)
+			continue;
+		ofs = ctl->appl_ptr + frames;
+		if (ofs >= runtime->boundary)
+			ofs -= runtime->boundary;
+		ctl->appl_ptr = ofs;
+		buf += frames_to_bytes(runtime, frames);
+		size -= frames;
+		xfer += frames;
+	}
+ out:
+	snd_pcm_stream_unlock_irq(substream);
+	return xfer > 0 ? (snd_pcm_sframes_t)xfer : err;
+}
+
+static int snd_pcm_fanout_sync_ptr(struct snd_pcm_file *pcm_file,
+				   struct snd_pcm_sync_ptr __user *_sync_ptr)
+{
+	struct snd_pcm_substream *substream = pcm_file->substream;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_mmap_control *ctl = pcm_file->fanout;
+	struct snd_pcm_sync_ptr sync_ptr;
+	int err;
+
+	memset(&sync_ptr, 0, sizeof(sync_ptr));
+	if (get_user(sync_ptr.flags, (unsigned __user *)&(_sync_ptr->flags)))
+		return -EFAULT;
+	if (copy_from_user(&sync_ptr.c.control, &(_sync_ptr->c.control), sizeof(struct snd_pcm_mmap_control)))
+		return -EFAULT;
+	if (sync_ptr.flags & SNDRV_PCM_SYNC_PTR_HWSYNC) {
+		err = snd_pcm_hwsync(substream);
+		if (err < 0)
+			return err;
+	}
+	snd_pcm_stream_lock_irq(substream);
+	if (!(sync_ptr.flags & SNDRV_PCM_SYNC_PTR_APPL)) {
+		if (sync_ptr.c.control.appl_ptr >= runtime->boundary) {
+			snd_pcm_stream_unlock_irq(substream);
+			return -EINVAL;
+		}
+		ctl->appl_ptr = sync_ptr.c.control.appl_ptr;
+	} else {
+		sync_ptr.c.control.appl_ptr = ctl->appl_ptr;
+	}
+	if (!(sync_ptr.flags & SNDRV_PCM_SYNC_PTR_AVAIL_MIN))
+		ctl->avail_min = sync_ptr.c.control.avail_min;
+	else
+		sync_ptr.c.control.avail_min = ctl->avail_min;
+	sync_ptr.s.status.state = runtime->status->state;
+	sync_ptr.s.status.hw_ptr = runtime->status->hw_ptr;
+	sync_ptr.s.status.tstamp = runtime->status->tstamp;
+	sync_ptr.s.status.suspended_state = runtime->status->suspended_state;
+	snd_pcm_stream_unlock_irq(substream);
+	if (copy_to_user(_sync_ptr, &sync_ptr, sizeof(sync_ptr)))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * Take over a stream whose file was passed from another process (e.g. via
+ * SCM_RIGHTS): report the setup needed to continue driving the stream and
+ * make the caller its owner.  The file, and so the substream, stays open
+ * while any process holds it, thus the DMA keeps running across the switch.
+ */
+static int snd_pcm_handoff(struct snd_pcm_substream *substream,
+			   struct snd_pcm_handoff __user *_handoff)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_handoff handoff;
+	struct pid *pid, *old_pid;
+
+	memset(&handoff, 0, sizeof(handoff));
+	pid = get_pid(task_pid(current));
+	snd_pcm_stream_lock_irq(substream);
+	if (runtime->status->state == SNDRV_PCM_STATE_OPEN) {
+		snd_pcm_stream_unlock_irq(substream);
+		put_pid(pid);
+		return -EBADFD;
+	}
+	if (runtime->status->state == SNDRV_PCM_STATE_RUNNING)
+		snd_pcm_update_hw_ptr(substream);
+	handoff.state = runtime->status->state;
+	handoff.access = runtime->access;
+	handoff.format = runtime->format;
+	handoff.subformat = runtime->subformat;
+	handoff.channels = runtime->channels;
+	handoff.rate = runtime->rate;
+	handoff.periods = runtime->periods;
+	if (runtime->no_period_wakeup)
+		handoff.flags |= SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP;
+	if (runtime->live_status)
+		handoff.flags |= SNDRV_PCM_HW_PARAMS_LIVE_STATUS;
+	handoff.tstamp_mode = runtime->tstamp_mode;
+	handoff.tstamp_type = runtime->tstamp_type;
+	handoff.period_step = runtime->period_step;
+	handoff.wakeup_frames = runtime->wakeup_frames;
+	handoff.period_size = runtime->period_size;
+	handoff.buffer_size = runtime->buffer_size;
+	handoff.avail_min = runtime->control->avail_min;
+	handoff.start_threshold = runtime->start_threshold;
+	handoff.stop_threshold = runtime->stop_threshold;
+	handoff.silence_threshold = runtime->silence_threshold;
+	handoff.silence_size = runtime->silence_size;
+	handoff.boundary = runtime->boundary;
+	handoff.appl_ptr = runtime->control->appl_ptr;
+	handoff.hw_ptr = runtime->status->hw_ptr;
+	old_pid = substream->pid;
+	substream->pid = pid;
+	snd_pcm_stream_unlock_irq(substream);
+	put_pid(old_pid);
+
+	if (copy_to_user(_handoff, &handoff, sizeof(handoff)))
+		return -EFAULT;
+	return 0;
+}
+
+/* returns -ENOIOCTLCMD for the ioctls shared with the owner */
+static int snd_pcm_fanout_ioctl(struct file *file, unsigned int cmd,
+				void __user *arg)
+{
+	struct snd_pcm_file *pcm_file = file->private_data;
+	struct snd_xferi __user *_xferi = arg;
+	struct snd_xferi xferi;
+	snd_pcm_sframes_t result;
+
+	switch (cmd) {
+	case SNDRV_PCM_IOCTL_PVERSION:
+	case SNDRV_PCM_IOCTL_INFO:
+	case SNDRV_PCM_IOCTL_TSTAMP:
+	case SNDRV_PCM_IOCTL_USER_PVERSION:
+	case SNDRV_PCM_IOCTL_HW_REFINE:
+	case SNDRV_PCM_IOCTL_STATUS:
+	case SNDRV_PCM_IOCTL_STATUS_EXT:
+	case SNDRV_PCM_IOCTL_CHANNEL_INFO:
+	case SNDRV_PCM_IOCTL_HWSYNC:
+		return -ENOIOCTLCMD;
+	case SNDRV_PCM_IOCTL_FANOUT:
+		return -EBUSY;
+	case SNDRV_PCM_IOCTL_SYNC_PTR:
+		return snd_pcm_fanout_sync_ptr(pcm_file, arg);
+	case SNDRV_PCM_IOCTL_READI_FRAMES:
+		if (put_user(0, &_xferi->result))
+			return -EFAULT;
+		if (copy_from_user(&xferi, _xferi, sizeof(xferi)))
+			return -EFAULT;
+		result = snd_pcm_fanout_read(pcm_file, xferi.buf, xferi.frames,
+					     file->f_flags & O_NONBLOCK);
+		__put_user(result, &_xferi->result);
+		return result < 0 ? result : 0;
+	}
+	/* everything else would act on the owner's stream */
+	return -EPERM;
+}
+
 static int snd_pcm_tstamp(struct snd_pcm_substream *substream, int __user *_arg)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -2812,6 +3591,92 @@ static int snd_pcm_xfern_frames_ioctl(struct snd_pcm_substream *substream,
 	return result < 0 ? result : 0;
 }
 
+/* transfer one entry of SNDRV_PCM_IOCTL_XFERI_LINKED;
+ * the caller holds a reference to the group, so that it can't be freed
+ * and reused while the entries are compared against it
+ */
+static int snd_pcm_xferi_link_entry(struct snd_pcm_group *group,
+				    struct snd_xferi_link __user *_xfer)
+{
+	struct snd_xferi_link xfer;
+	struct snd_pcm_file *pcm_file;
+	struct snd_pcm_substream *substream1;
+	snd_pcm_sframes_t result;
+	struct fd f;
+	int res = 0;
+
+	if (put_user(0, &_xfer->result))
+		return -EFAULT;
+	if (copy_from_user(&xfer, _xfer, sizeof(xfer)))
+		return -EFAULT;
+	f = fdget(xfer.fd);
+	if (!f.file)
+		return -EBADFD;
+	if (!is_pcm_file(f.file)) {
+		res = -EBADFD;
+		goto _badf;
+	}
+	pcm_file = f.file->private_data;
+	substream1 = pcm_file->substream;
+	if (READ_ONCE(substream1->group) != group ||
+	    PCM_RUNTIME_CHECK(substream1) ||
+	    substream1->runtime->status->state == SNDRV_PCM_STATE_OPEN) {
+		res = -EBADFD;
+		goto _end;
+	}
+	if (substream1->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		result = snd_pcm_lib_write(substream1, xfer.buf, xfer.frames);
+	else
+		result = snd_pcm_lib_read(substream1, xfer.buf, xfer.frames);
+	/* a failed member doesn't abort the rest of the group */
+	__put_user(result, &_xfer->result);
+ _end:
+	snd_card_unref(substream1->pcm->card);
+ _badf:
+	fdput(f);
+	return res;
+}
+
+/*
+ * Transfer interleaved data for several substreams of the same link group
+ * in a single call; each entry gets its own result like WRITEI/READI_FRAMES
+ */
+static int snd_pcm_xferi_linked_ioctl(struct snd_pcm_substream *substream,
+				      struct snd_xferi_linked __user *_linked)
+{
+	struct snd_xferi_linked linked;
+	struct snd_pcm_group *group;
+	unsigned int i;
+	int res = 0;
+
+	if (copy_from_user(&linked, _linked, sizeof(linked)))
+		return -EFAULT;
+
+	/*
+	 * Pin the group and drop the rwsem before the transfers, which may
+	 * sleep; linking and unlinking of other streams must not wait for
+	 * them.  An entry unlinked meanwhile fails with -EBADFD.
+	 */
+	down_read(&snd_pcm_link_rwsem);
+	group = substream->group;
+	if (!linked.count || linked.count > group->count) {
+		up_read(&snd_pcm_link_rwsem);
+		return -EINVAL;
+	}
+	refcount_inc(&group->refs);
+	up_read(&snd_pcm_link_rwsem);
+
+	for (i = 0; i < linked.count; i++) {
+		res = snd_pcm_xferi_link_entry(group, &linked.xfers[i]);
+		if (res < 0)
+			break;
+	}
+
+	if (refcount_dec_and_test(&group->refs))
+		kfree(group);
+	return res;
+}
+
 static int snd_pcm_rewind_ioctl(struct snd_pcm_substream *substream,
 				snd_pcm_uframes_t __user *_frames)
 {
@@ -2862,6 +3727,12 @@ static int snd_pcm_common_ioctl(struct file *file,
 	if (res < 0)
 		return res;
 
+	if (pcm_file->fanout) {
+		res = snd_pcm_fanout_ioctl(file, cmd, arg);
+		if (res != -ENOIOCTLCMD)
+			return res;
+	}
+
 	switch (cmd) {
 	case SNDRV_PCM_IOCTL_PVERSION:
 		return put_user(SNDRV_PCM_VERSION, (int __user *)arg) ? -EFAULT : 0;
@@ -2880,6 +3751,8 @@ static int snd_pcm_common_ioctl(struct file *file,
 		return snd_pcm_hw_refine_user(substream, arg);
 	case SNDRV_PCM_IOCTL_HW_PARAMS:
 		return snd_pcm_hw_params_user(substream, arg);
+	case SNDRV_PCM_IOCTL_HW_RECONFIG:
+		return snd_pcm_hw_reconfig_user(substream, arg);
 	case SNDRV_PCM_IOCTL_HW_FREE:
 		return snd_pcm_hw_free(substream);
 	case SNDRV_PCM_IOCTL_SW_PARAMS:
@@ -2939,10 +3812,18 @@ static int snd_pcm_common_ioctl(struct file *file,
 	case SNDRV_PCM_IOCTL_WRITEN_FRAMES:
 	case SNDRV_PCM_IOCTL_READN_FRAMES:
 		return snd_pcm_xfern_frames_ioctl(substream, arg);
+	case SNDRV_PCM_IOCTL_XFERI_LINKED:
+		return snd_pcm_xferi_linked_ioctl(substream, arg);
 	case SNDRV_PCM_IOCTL_REWIND:
 		return snd_pcm_rewind_ioctl(substream, arg);
 	case SNDRV_PCM_IOCTL_FORWARD:
 		return snd_pcm_forward_ioctl(substream, arg);
+	case SNDRV_PCM_IOCTL_FANOUT:
+		return snd_pcm_fanout_attach(file);
+	case SNDRV_PCM_IOCTL_HANDOFF:
+		return snd_pcm_handoff(substream, arg);
+	case SNDRV_PCM_IOCTL_LATENCY:
+		return snd_pcm_latency_user(substream, arg);
 	}
 	pcm_dbg(substream->pcm, "unknown ioctl = 0x%x\n", cmd);
 	return -ENOTTY;
@@ -3031,7 +3912,11 @@ static ssize_t snd_pcm_read(struct file *file, char __user *buf, size_t count,
 	if (!frame_aligned(runtime, count))
 		return -EINVAL;
 	count = bytes_to_frames(runtime, count);
-	result = snd_pcm_lib_read(substream, buf, count);
+	if (pcm_file->fanout)
+		result = snd_pcm_fanout_read(pcm_file, buf, count,
+					     file->f_flags & O_NONBLOCK);
+	else
+		result = snd_pcm_lib_read(substream, buf, count);
 	if (result > 0)
 		result = frames_to_bytes(runtime, result);
 	return result;
@@ -3078,7 +3963,7 @@ static ssize_t snd_pcm_readv(struct kiocb *iocb, struct iov_iter *to)
 	runtime = substream->runtime;
 	if (runtime->status->state == SNDRV_PCM_STATE_OPEN)
 		return -EBADFD;
-	if (!iter_is_iovec(to))
+	if (!iter_is_iovec(to) || pcm_file->fanout)
 		return -EINVAL;
 	if (to->nr_segs > 1024 || to->nr_segs != runtime->channels)
 		return -EINVAL;
@@ -3132,6 +4017,164 @@ static ssize_t snd_pcm_writev(struct kiocb *iocb, struct iov_iter *from)
 	return result;
 }
 
+/*
+ * splice support
+ *
+ * The data is copied exactly once between the PCM buffer and the pipe
+ * pages; handing the DMA pages themselves to the pipe is not an option
+ * since the hardware keeps overwriting the ring behind the reader.
+ * Only interleaved access is handled, same as read() / write().
+ */
+static ssize_t snd_pcm_splice_read(struct file *in, loff_t *ppos,
+				   struct pipe_inode_info *pipe, size_t len,
+				   unsigned int flags)
+{
+	struct snd_pcm_file *pcm_file;
+	struct snd_pcm_substream *substream;
+	struct snd_pcm_runtime *runtime;
+	struct iov_iter to;
+	struct page **pages;
+	unsigned int i, nr_pages;
+	size_t base, copied = 0;
+	snd_pcm_sframes_t result;
+	ssize_t res;
+	void *vaddr;
+
+	pcm_file = in->private_data;
+	substream = pcm_file->substream;
+	if (PCM_RUNTIME_CHECK(substream))
+		return -ENXIO;
+	runtime = substream->runtime;
+	if (runtime->status->state == SNDRV_PCM_STATE_OPEN)
+		return -EBADFD;
+	if (!frames_to_bytes(runtime, 1) || pcm_file->fanout)
+		return -EINVAL;
+	if (pipe->nrbufs == pipe->buffers)
+		return -EAGAIN;
+
+	iov_iter_pipe(&to, ITER_PIPE | READ, pipe, len);
+	res = iov_iter_get_pages_alloc(&to, &pages, len, &base);
+	if (res <= 0)
+		return res;
+	nr_pages = DIV_ROUND_UP(res + base, PAGE_SIZE);
+
+	/* frames may straddle the pipe pages, so map them contiguously */
+	vaddr = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!vaddr) {
+		res = -ENOMEM;
+		goto out;
+	}
+	result = snd_pcm_kernel_read(substream, vaddr + base,
+				     bytes_to_frames(runtime, res));
+	vunmap(vaddr);
+	if (result > 0) {
+		copied = frames_to_bytes(runtime, result);
+		res = copied;
+	} else {
+		res = result ? result : -EINVAL;
+	}
+ out:
+	for (i = 0; i < nr_pages; i++)
+		put_page(pages[i]);
+	kvfree(pages);
+	iov_iter_advance(&to, copied);	/* truncates and discards */
+	return res;
+}
+
+static int snd_pcm_pipe_to_pcm(struct pipe_inode_info *pipe,
+			       struct pipe_buffer *buf, struct splice_desc *sd)
+{
+	struct snd_pcm_file *pcm_file = sd->u.data; /* splice_mutex held */
+	struct snd_pcm_substream *substream = pcm_file->substream;
+	unsigned int frame_bytes = pcm_file->splice_frame_bytes;
+	unsigned int len = sd->len;
+	snd_pcm_sframes_t result;
+	void *data;
+	int ret;
+
+	data = kmap(buf->page) + buf->offset;
+	if (pcm_file->splice_fill || len < frame_bytes) {
+		/* assemble a frame split across pipe buffers */
+		ret = min(len, frame_bytes - pcm_file->splice_fill);
+		memcpy(pcm_file->splice_frame + pcm_file->splice_fill,
+		       data, ret);
+		if (pcm_file->splice_fill + ret < frame_bytes) {
+			pcm_file->splice_fill += ret;
+			goto out;
+		}
+		result = snd_pcm_kernel_write(substream,
+					      pcm_file->splice_frame, 1);
+		if (result < 1)
+			ret = result;	/* keep the buffer, retry later */
+		else
+			pcm_file->splice_fill = 0;
+		goto out;
+	}
+
+	result = snd_pcm_kernel_write(substream, data, len / frame_bytes);
+	if (result > 0)
+		ret = frames_to_bytes(substream->runtime, result);
+	else
+		ret = result;
+ out:
+	kunmap(buf->page);
+	return ret;
+}
+
+static ssize_t snd_pcm_splice_write(struct pipe_inode_info *pipe,
+				    struct file *out, loff_t *ppos,
+				    size_t len, unsigned int flags)
+{
+	struct snd_pcm_file *pcm_file;
+	struct snd_pcm_substream *substream;
+	struct snd_pcm_runtime *runtime;
+	unsigned int frame_bytes;
+	struct splice_desc sd = {
+		.total_len = len,
+		.flags = flags,
+		.pos = *ppos,
+	};
+	ssize_t ret;
+
+	pcm_file = out->private_data;
+	substream = pcm_file->substream;
+	if (PCM_RUNTIME_CHECK(substream))
+		return -ENXIO;
+	runtime = substream->runtime;
+	if (runtime->status->state == SNDRV_PCM_STATE_OPEN)
+		return -EBADFD;
+	frame_bytes = frames_to_bytes(runtime, 1);
+	if (!frame_bytes)
+		return -EINVAL;
+
+	/*
+	 * splices from several pipes into the same file are serialized, so
+	 * that the partial frame is assembled and written in order; the
+	 * stream lock can't be used since the writes below may sleep
+	 */
+	mutex_lock(&pcm_file->splice_mutex);
+	/* a frame cut by the previous call is only valid for the same setup */
+	if (pcm_file->splice_frame_bytes != frame_bytes) {
+		kfree(pcm_file->splice_frame);
+		pcm_file->splice_frame = kmalloc(frame_bytes, GFP_KERNEL);
+		if (!pcm_file->splice_frame) {
+			pcm_file->splice_frame_bytes = 0;
+			ret = -ENOMEM;
+			goto unlock;
+		}
+		pcm_file->splice_frame_bytes = frame_bytes;
+		pcm_file->splice_fill = 0;
+	}
+
+	sd.u.data = pcm_file;
+	pipe_lock(pipe);
+	ret = __splice_from_pipe(pipe, &sd, snd_pcm_pipe_to_pcm);
+	pipe_unlock(pipe);
+ unlock:
+	mutex_unlock(&pcm_file->splice_mutex);
+	return ret;
+}
+
 static unsigned int snd_pcm_playback_poll(struct file *file, poll_table * wait)
 {
 	struct snd_pcm_file *pcm_file;
@@ -3139,6 +4182,7 @@ static unsigned int snd_pcm_playback_poll(struct file *file, poll_table * wait)
 	struct snd_pcm_runtime *runtime;
         unsigned int mask;
 	snd_pcm_uframes_t avail;
+	u64 cost;
 
 	pcm_file = file->private_data;
 
@@ -3150,6 +4194,8 @@ static unsigned int snd_pcm_playback_poll(struct file *file, poll_table * wait)
 	poll_wait(file, &runtime->sleep, wait);
 
 	snd_pcm_stream_lock_irq(substream);
+	cost = snd_pcm_stats_cost_begin();
+	snd_pcm_compat_mmap_sync(runtime);
 	avail = snd_pcm_playback_avail(runtime);
 	switch (runtime->status->state) {
 	case SNDRV_PCM_STATE_RUNNING:
@@ -3167,6 +4213,7 @@ static unsigned int snd_pcm_playback_poll(struct file *file, poll_table * wait)
 		mask = POLLOUT | POLLWRNORM | POLLERR;
 		break;
 	}
+	snd_pcm_stats_cost_end(substream, SNDRV_PCM_STATS_COST_POLL, cost);
 	snd_pcm_stream_unlock_irq(substream);
 	return mask;
 }
@@ -3177,7 +4224,8 @@ static unsigned int snd_pcm_capture_poll(struct file *file, poll_table * wait)
 	struct snd_pcm_substream *substream;
 	struct snd_pcm_runtime *runtime;
         unsigned int mask;
-	snd_pcm_uframes_t avail;
+	snd_pcm_uframes_t avail, avail_min;
+	u64 cost;
 
 	pcm_file = file->private_data;
 
@@ -3189,12 +4237,24 @@ static unsigned int snd_pcm_capture_poll(struct file *file, poll_table * wait)
 	poll_wait(file, &runtime->sleep, wait);
 
 	snd_pcm_stream_lock_irq(substream);
-	avail = snd_pcm_capture_avail(runtime);
+	cost = snd_pcm_stats_cost_begin();
+	snd_pcm_compat_mmap_sync(runtime);
+	if (pcm_file->fanout) {
+		avail = snd_pcm_fanout_avail(runtime, pcm_file->fanout);
+		avail_min = pcm_file->fanout->avail_min;
+		if (avail > runtime->buffer_size) {
+			snd_pcm_stream_unlock_irq(substream);
+			return POLLIN | POLLRDNORM | POLLERR;
+		}
+	} else {
+		avail = snd_pcm_capture_avail(runtime);
+		avail_min = runtime->control->avail_min;
+	}
 	switch (runtime->status->state) {
 	case SNDRV_PCM_STATE_RUNNING:
 	case SNDRV_PCM_STATE_PREPARED:
 	case SNDRV_PCM_STATE_PAUSED:
-		if (avail >= runtime->control->avail_min) {
+		if (avail >= avail_min) {
 			mask = POLLIN | POLLRDNORM;
 			break;
 		}
@@ -3210,6 +4270,7 @@ static unsigned int snd_pcm_capture_poll(struct file *file, poll_table * wait)
 		mask = POLLIN | POLLRDNORM | POLLERR;
 		break;
 	}
+	snd_pcm_stats_cost_end(substream, SNDRV_PCM_STATS_COST_POLL, cost);
 	snd_pcm_stream_unlock_irq(substream);
 	return mask;
 }
@@ -3295,10 +4356,93 @@ static int snd_pcm_mmap_control(struct snd_pcm_substream *substream, struct file
 	return 0;
 }
 
+/*
+ * mmap the private control record of a fan-out reader
+ */
+static int snd_pcm_mmap_fanout_control_fault(struct vm_fault *vmf)
+{
+	struct snd_pcm_mmap_control *ctl = vmf->vma->vm_private_data;
+
+	vmf->page = virt_to_page(ctl);
+	get_page(vmf->page);
+	return 0;
+}
+
+static const struct vm_operations_struct snd_pcm_vm_ops_fanout_control =
+{
+	.fault =	snd_pcm_mmap_fanout_control_fault,
+};
+
+static int snd_pcm_mmap_fanout_control(struct snd_pcm_file *pcm_file,
+				       struct vm_area_struct *area)
+{
+	long size;
+	if (!(area->vm_flags & VM_READ))
+		return -EINVAL;
+	size = area->vm_end - area->vm_start;
+	if (size != PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control)))
+		return -EINVAL;
+	area->vm_ops = &snd_pcm_vm_ops_fanout_control;
+	area->vm_private_data = pcm_file->fanout;
+	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	return 0;
+}
+
+/*
+ * mmap the tstamp ring; allocated on the first mmap
+ */
+static int snd_pcm_mmap_tstamp_ring_fault(struct vm_fault *vmf)
+{
+	struct snd_pcm_substream *substream = vmf->vma->vm_private_data;
+	struct snd_pcm_runtime *runtime;
+
+	if (substream == NULL)
+		return VM_FAULT_SIGBUS;
+	runtime = substream->runtime;
+	vmf->page = virt_to_page(runtime->tstamp_ring);
+	get_page(vmf->page);
+	return 0;
+}
+
+static const struct vm_operations_struct snd_pcm_vm_ops_tstamp_ring =
+{
+	.fault =	snd_pcm_mmap_tstamp_ring_fault,
+};
+
+static int snd_pcm_mmap_tstamp_ring(struct snd_pcm_substream *substream,
+				    struct vm_area_struct *area)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_tstamp_ring *ring;
+
+	if (!(area->vm_flags & VM_READ) || (area->vm_flags & VM_WRITE))
+		return -EINVAL;
+	if (area->vm_end - area->vm_start != PAGE_SIZE)
+		return -EINVAL;
+	if (!runtime->tstamp_ring) {
+		ring = snd_malloc_pages(PAGE_SIZE, GFP_KERNEL);
+		if (!ring)
+			return -ENOMEM;
+		memset(ring, 0, PAGE_SIZE);
+		ring->entries = (PAGE_SIZE - sizeof(*ring)) /
+			sizeof(ring->samples[0]);
+		snd_pcm_stream_lock_irq(substream);
+		if (!runtime->tstamp_ring) {
+			runtime->tstamp_ring = ring;
+			ring = NULL;
+		}
+		snd_pcm_stream_unlock_irq(substream);
+		snd_free_pages(ring, PAGE_SIZE);
+	}
+	area->vm_ops = &snd_pcm_vm_ops_tstamp_ring;
+	area->vm_private_data = substream;
+	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	area->vm_flags &= ~VM_MAYWRITE;
+	return 0;
+}
+
 static bool pcm_status_mmap_allowed(struct snd_pcm_file *pcm_file)
 {
-	if (pcm_file->no_compat_mmap)
-		return false;
 	/* See pcm_control_mmap_allowed() below.
 	 * Since older alsa-lib requires both status and control mmaps to be
 	 * coupled, we have to disable the status mmap for old alsa-lib, too.
@@ -3311,8 +4455,6 @@ static bool pcm_status_mmap_allowed(struct snd_pcm_file *pcm_file)
 
 static bool pcm_control_mmap_allowed(struct snd_pcm_file *pcm_file)
 {
-	if (pcm_file->no_compat_mmap)
-		return false;
 	/* Disallow the control mmap when SYNC_APPLPTR flag is set;
 	 * it enforces the user-space to fall back to snd_pcm_sync_ptr(),
 	 * thus it effectively assures the manual update of appl_ptr.
@@ -3339,6 +4481,16 @@ static int snd_pcm_mmap_control(struct snd_pcm_substream *substream, struct file
 {
 	return -ENXIO;
 }
+static int snd_pcm_mmap_fanout_control(struct snd_pcm_file *pcm_file,
+				       struct vm_area_struct *area)
+{
+	return -ENXIO;
+}
+static int snd_pcm_mmap_tstamp_ring(struct snd_pcm_substream *substream,
+				    struct vm_area_struct *area)
+{
+	return -ENXIO;
+}
 #endif /* coherent mmap */
 
 static inline struct page *
@@ -3404,6 +4556,10 @@ int snd_pcm_lib_default_mmap(struct snd_pcm_substream *substream,
 			     struct vm_area_struct *area)
 {
 	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	if (substream->buffer_policy == SNDRV_PCM_BUFFER_POLICY_WC)
+		area->vm_page_prot = pgprot_writecombine(area->vm_page_prot);
+	else if (substream->buffer_policy == SNDRV_PCM_BUFFER_POLICY_UNCACHED)
+		area->vm_page_prot = pgprot_noncached(area->vm_page_prot);
 #ifdef CONFIG_GENERIC_ALLOCATOR
 	if (substream->dma_buffer.dev.type == SNDRV_DMA_TYPE_DEV_IRAM) {
 		area->vm_page_prot = pgprot_writecombine(area->vm_page_prot);
@@ -3413,6 +4569,13 @@ int snd_pcm_lib_default_mmap(struct snd_pcm_substream *substream,
 	}
 #endif /* CONFIG_GENERIC_ALLOCATOR */
 #ifndef CONFIG_X86 /* for avoiding warnings arch/x86/mm/pat.c */
+	if (IS_ENABLED(CONFIG_HAS_DMA) && !substream->ops->page &&
+	    substream->dma_buffer.dev.type == SNDRV_DMA_TYPE_DEV &&
+	    substream->buffer_policy == SNDRV_PCM_BUFFER_POLICY_WC)
+		return dma_mmap_wc(substream->dma_buffer.dev.dev, area,
+				   substream->runtime->dma_area,
+				   substream->runtime->dma_addr,
+				   area->vm_end - area->vm_start);
 	if (IS_ENABLED(CONFIG_HAS_DMA) && !substream->ops->page &&
 	    substream->dma_buffer.dev.type == SNDRV_DMA_TYPE_DEV)
 		return dma_mmap_coherent(substream->dma_buffer.dev.dev,
@@ -3514,12 +4677,32 @@ static int snd_pcm_mmap(struct file *file, struct vm_area_struct *area)
 	case SNDRV_PCM_MMAP_OFFSET_STATUS:
 		if (!pcm_status_mmap_allowed(pcm_file))
 			return -ENXIO;
+		if (pcm_file->compat_mmap)
+			return snd_pcm_mmap_compat(substream, area);
 		return snd_pcm_mmap_status(substream, file, area);
 	case SNDRV_PCM_MMAP_OFFSET_CONTROL:
 		if (!pcm_control_mmap_allowed(pcm_file))
 			return -ENXIO;
+		if (pcm_file->fanout) {
+			/* the private record has the native layout only */
+			if (pcm_file->compat_mmap)
+				return -ENXIO;
+			return snd_pcm_mmap_fanout_control(pcm_file, area);
+		}
+		if (pcm_file->compat_mmap)
+			return snd_pcm_mmap_compat(substream, area);
 		return snd_pcm_mmap_control(substream, file, area);
+	case SNDRV_PCM_MMAP_OFFSET_TSTAMP_RING:
+		if (!pcm_status_mmap_allowed(pcm_file) || pcm_file->compat_mmap)
+			return -ENXIO;
+		return snd_pcm_mmap_tstamp_ring(substream, area);
 	default:
+		/* fan-out readers share the buffer read-only */
+		if (pcm_file->fanout) {
+			if (area->vm_flags & VM_WRITE)
+				return -EPERM;
+			area->vm_flags &= ~VM_MAYWRITE;
+		}
 		return snd_pcm_mmap_data(substream, file, area);
 	}
 	return 0;
@@ -3696,6 +4879,7 @@ const struct file_operations snd_pcm_f_ops[2] = {
 		.owner =		THIS_MODULE,
 		.write =		snd_pcm_write,
 		.write_iter =		snd_pcm_writev,
+		.splice_write =		snd_pcm_splice_write,
 		.open =			snd_pcm_playback_open,
 		.release =		snd_pcm_release,
 		.llseek =		no_llseek,
@@ -3710,6 +4894,7 @@ const struct file_operations snd_pcm_f_ops[2] = {
 		.owner =		THIS_MODULE,
 		.read =			snd_pcm_read,
 		.read_iter =		snd_pcm_readv,
+		.splice_read =		snd_pcm_splice_read,
 		.open =			snd_pcm_capture_open,
 		.release =		snd_pcm_release,
 		.llseek =		no_llseek,
@@ -133,6 +133,38 @@ TRACE_EVENT(hw_interval_param,
 	)
 );
 
+TRACE_EVENT(hw_rules_eval,
+	TP_PROTO(struct snd_pcm_substream *substream, unsigned int applied, unsigned int changed),
+	TP_ARGS(substream, applied, changed),
+	TP_STRUCT__entry(
+		__field(int, card)
+		__field(int, device)
+		__field(int, subdevice)
+		__field(int, direction)
+		__field(unsigned int, applied)
+		__field(unsigned int, changed)
+		__field(int, total)
+	),
+	TP_fast_assign(
+		__entry->card = substream->pcm->card->number;
+		__entry->device = substream->pcm->device;
+		__entry->subdevice = substream->number;
+		__entry->direction = substream->stream;
+		__entry->applied = applied;
+		__entry->changed = changed;
+		__entry->total = substream->runtime->hw_constraints.rules_num;
+	),
+	TP_printk("pcmC%dD%d%s:%d applied %u changed %u rules %d",
+		  __entry->card,
+		  __entry->device,
+		  __entry->direction ? "c" : "p",
+		  __entry->subdevice,
+		  __entry->applied,
+		  __entry->changed,
+		  __entry->total
+	)
+);
+
 #endif /* _PCM_PARAMS_TRACE_H */
 
 /* This part must be outside protection */
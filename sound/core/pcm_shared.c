@@ -0,0 +1,662 @@
+/*
+ *  Digital Audio (PCM) abstract layer - shared playback device
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ */
+
+/*
+ * A driver whose PCM mixes several playback substreams in hardware can
+ * put a shared PCM device on top of it with snd_pcm_new_shared().  Each
+ * client of the shared device is placed on a lane, i.e. a playback
+ * substream of the hardware PCM that the core opens and runs by itself in
+ * S16_LE stereo at a fixed rate:
+ *
+ * - as long as the hardware PCM has a free substream, every client gets
+ *   a lane of its own and the mixing is done by the hardware;
+ * - after that, new clients join the lane with the fewest clients and
+ *   are summed in software.
+ *
+ * A lane runs free with its stop threshold at the boundary.  At each of
+ * its periods a work refills it up to one period before its hw_ptr from
+ * the clients' buffers, and silences that last period so that a late work
+ * lets the hardware play silence rather than the previous buffer cycle.
+ * The clients' hw_ptr advances with the lane, and the frames they did not
+ * write in time are played as silence.
+ */
+
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <sound/pcm_params.h>
+
+#define SHARED_CHANNELS		2
+
+struct snd_pcm_shared {
+	struct snd_pcm *hw;		/* the hardware PCM */
+	unsigned int rate;
+	struct mutex lock;		/* protects lanes */
+	struct list_head lanes;
+};
+
+struct shared_lane {
+	struct snd_pcm_shared *shared;
+	struct snd_pcm_substream *substream;	/* of the hardware PCM */
+	struct list_head list;
+	spinlock_t lock;		/* protects clients and their state */
+	struct list_head clients;
+	unsigned int nclients;
+	snd_pcm_uframes_t mix_ptr;	/* next frame to mix, as hw_ptr */
+	s32 *acc;			/* sums of one period */
+	bool restart;			/* start again after a suspend */
+	struct work_struct work;
+};
+
+struct shared_client {
+	struct snd_pcm_substream *substream;
+	struct shared_lane *lane;
+	struct list_head list;
+	snd_pcm_uframes_t pos;		/* hw_ptr of the client */
+	snd_pcm_uframes_t period_pos;	/* frames into the current period */
+	bool running;
+	bool elapsed;			/* a period to report */
+};
+
+/*
+ * add the queued frames of a client to the sums and advance its position
+ * by the whole chunk; called under lane->lock
+ */
+static void shared_client_mix(struct shared_client *client, s32 *acc,
+			      snd_pcm_uframes_t frames)
+{
+	struct snd_pcm_runtime *runtime = client->substream->runtime;
+	snd_pcm_uframes_t queued, ofs, n, done;
+	snd_pcm_sframes_t delta;
+	const s16 *src;
+	unsigned int i;
+
+	delta = READ_ONCE(runtime->control->appl_ptr) - client->pos;
+	if (delta < 0)
+		delta += runtime->boundary;
+	queued = delta;
+	if (queued > runtime->buffer_size)
+		queued = 0; /* behind, an xrun is coming */
+	if (queued > frames)
+		queued = frames;
+
+	for (done = 0; done < queued; done += n) {
+		ofs = (client->pos + done) % runtime->buffer_size;
+		n = min(queued - done, runtime->buffer_size - ofs);
+		src = (const s16 *)runtime->dma_area + ofs * SHARED_CHANNELS;
+		for (i = 0; i < n * SHARED_CHANNELS; i++)
+			acc[i] += src[i];
+		acc += n * SHARED_CHANNELS;
+	}
+
+	client->pos += frames;
+	if (client->pos >= runtime->boundary)
+		client->pos -= runtime->boundary;
+	client->period_pos += frames;
+	if (client->period_pos >= runtime->period_size) {
+		client->period_pos %= runtime->period_size;
+		client->elapsed = true;
+	}
+}
+
+static void shared_lane_mix_chunk(struct shared_lane *lane,
+				  snd_pcm_uframes_t ofs,
+				  snd_pcm_uframes_t frames)
+{
+	struct snd_pcm_runtime *runtime = lane->substream->runtime;
+	s16 *dst = (s16 *)runtime->dma_area + ofs * SHARED_CHANNELS;
+	unsigned int i, samples = frames * SHARED_CHANNELS;
+	struct shared_client *client;
+
+	memset(lane->acc, 0, samples * sizeof(*lane->acc));
+	spin_lock_irq(&lane->lock);
+	list_for_each_entry(client, &lane->clients, list) {
+		if (client->running)
+			shared_client_mix(client, lane->acc, frames);
+	}
+	spin_unlock_irq(&lane->lock);
+
+	for (i = 0; i < samples; i++)
+		dst[i] = clamp_t(s32, lane->acc[i], S16_MIN, S16_MAX);
+}
+
+/* fill the lane up to one period before its hw_ptr */
+static void shared_lane_mix(struct shared_lane *lane)
+{
+	struct snd_pcm_runtime *runtime = lane->substream->runtime;
+	snd_pcm_uframes_t fill = runtime->buffer_size - runtime->period_size;
+	snd_pcm_uframes_t hw_ptr, ahead, ofs, n;
+	snd_pcm_sframes_t delta;
+
+	hw_ptr = READ_ONCE(runtime->status->hw_ptr);
+	delta = lane->mix_ptr - hw_ptr;
+	if (delta < 0)
+		delta += runtime->boundary;
+	ahead = delta;
+	if (ahead > runtime->buffer_size) {
+		/* the hardware overtook us; restart right behind it */
+		lane->mix_ptr = hw_ptr;
+		ahead = 0;
+	}
+
+	while (ahead < fill) {
+		ofs = lane->mix_ptr % runtime->buffer_size;
+		n = min3(fill - ahead, runtime->period_size,
+			 runtime->buffer_size - ofs);
+		shared_lane_mix_chunk(lane, ofs, n);
+		lane->mix_ptr += n;
+		if (lane->mix_ptr >= runtime->boundary)
+			lane->mix_ptr -= runtime->boundary;
+		ahead += n;
+	}
+
+	/* the rest still holds the previous cycle; mixed over next time */
+	ofs = lane->mix_ptr % runtime->buffer_size;
+	while (ahead < runtime->buffer_size) {
+		n = min(runtime->buffer_size - ahead, runtime->buffer_size - ofs);
+		memset((s16 *)runtime->dma_area + ofs * SHARED_CHANNELS, 0,
+		       frames_to_bytes(runtime, n));
+		ahead += n;
+		ofs = 0;
+	}
+}
+
+static int shared_lane_start(struct shared_lane *lane)
+{
+	int err;
+
+	err = snd_pcm_kernel_ioctl(lane->substream, SNDRV_PCM_IOCTL_PREPARE,
+				   NULL);
+	if (err < 0)
+		return err;
+	lane->mix_ptr = 0;
+	shared_lane_mix(lane);
+	return snd_pcm_kernel_ioctl(lane->substream, SNDRV_PCM_IOCTL_START,
+				    NULL);
+}
+
+/*
+ * take the next client with a period to report, or NULL; the client may
+ * be unlinked once the lock is dropped, so the list is walked again from
+ * its head each time
+ */
+static struct snd_pcm_substream *shared_lane_next_elapsed(struct shared_lane *lane)
+{
+	struct snd_pcm_substream *substream = NULL;
+	struct shared_client *client;
+
+	spin_lock_irq(&lane->lock);
+	list_for_each_entry(client, &lane->clients, list) {
+		if (client->elapsed) {
+			client->elapsed = false;
+			substream = client->substream;
+			break;
+		}
+	}
+	spin_unlock_irq(&lane->lock);
+	return substream;
+}
+
+static void shared_lane_work(struct work_struct *work)
+{
+	struct shared_lane *lane = container_of(work, struct shared_lane, work);
+	struct snd_pcm_substream *substream;
+	bool restart;
+
+	switch (lane->substream->runtime->status->state) {
+	case SNDRV_PCM_STATE_RUNNING:
+		shared_lane_mix(lane);
+		break;
+	case SNDRV_PCM_STATE_SUSPENDED:
+		/*
+		 * only on the request of a client prepare after the resume,
+		 * not for a period queued before the suspend
+		 */
+		spin_lock_irq(&lane->lock);
+		restart = lane->restart;
+		lane->restart = false;
+		spin_unlock_irq(&lane->lock);
+		if (!restart || shared_lane_start(lane) < 0)
+			return;
+		break;
+	default:
+		return;
+	}
+
+	/* clients are only freed after flushing this work */
+	while ((substream = shared_lane_next_elapsed(lane)))
+		snd_pcm_period_elapsed(substream);
+}
+
+/* called under the stream lock of the hardware substream */
+static void shared_lane_period(struct snd_pcm_substream *substream)
+{
+	struct shared_lane *lane = substream->runtime->period_notify_data;
+
+	queue_work(system_highpri_wq, &lane->work);
+}
+
+static void shared_param_set(struct snd_pcm_hw_params *params,
+			     snd_pcm_hw_param_t var,
+			     unsigned int min, unsigned int max)
+{
+	struct snd_interval *i = hw_param_interval(params, var);
+
+	i->min = min;
+	i->max = max;
+	i->openmin = i->openmax = 0;
+}
+
+static int shared_lane_params(struct shared_lane *lane)
+{
+	struct snd_pcm_substream *substream = lane->substream;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	unsigned int rate = lane->shared->rate;
+	struct snd_pcm_hw_params *params;
+	struct snd_pcm_sw_params *sw_params;
+	struct snd_mask *mask;
+	int err;
+
+	/* the lane is written directly in its buffer */
+	if (substream->ops->copy_user || substream->ops->ack)
+		return -ENXIO;
+
+	params = kzalloc(sizeof(*params), GFP_KERNEL);
+	sw_params = kzalloc(sizeof(*sw_params), GFP_KERNEL);
+	if (!params || !sw_params) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	_snd_pcm_hw_params_any(params);
+	mask = hw_param_mask(params, SNDRV_PCM_HW_PARAM_ACCESS);
+	snd_mask_none(mask);
+	snd_mask_set(mask, (__force unsigned int)SNDRV_PCM_ACCESS_MMAP_INTERLEAVED);
+	snd_mask_set(mask, (__force unsigned int)SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+	mask = hw_param_mask(params, SNDRV_PCM_HW_PARAM_FORMAT);
+	snd_mask_none(mask);
+	snd_mask_set(mask, (__force unsigned int)SNDRV_PCM_FORMAT_S16_LE);
+	shared_param_set(params, SNDRV_PCM_HW_PARAM_CHANNELS,
+			 SHARED_CHANNELS, SHARED_CHANNELS);
+	shared_param_set(params, SNDRV_PCM_HW_PARAM_RATE, rate, rate);
+	/* periods of 5 to 20ms, 3 or 4 of them */
+	shared_param_set(params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE,
+			 rate / 200, rate / 50);
+	shared_param_set(params, SNDRV_PCM_HW_PARAM_PERIODS, 3, 4);
+	err = snd_pcm_kernel_ioctl(substream, SNDRV_PCM_IOCTL_HW_PARAMS,
+				   params);
+	if (err < 0)
+		goto out;
+	if (!runtime->dma_area) {
+		err = -ENXIO;
+		goto out;
+	}
+
+	sw_params->tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
+	sw_params->period_step = 1;
+	sw_params->avail_min = runtime->period_size;
+	sw_params->start_threshold = runtime->boundary;
+	sw_params->stop_threshold = runtime->boundary;
+	err = snd_pcm_kernel_ioctl(substream, SNDRV_PCM_IOCTL_SW_PARAMS,
+				   sw_params);
+ out:
+	kfree(sw_params);
+	kfree(params);
+	return err;
+}
+
+static void shared_lane_free(struct shared_lane *lane)
+{
+	struct snd_pcm *hw = lane->shared->hw;
+
+	if (lane->substream) {
+		/* no period_notify after this, and the work stays idle */
+		snd_pcm_kernel_ioctl(lane->substream, SNDRV_PCM_IOCTL_DROP,
+				     NULL);
+		cancel_work_sync(&lane->work);
+		mutex_lock_nested(&hw->open_mutex, SINGLE_DEPTH_NESTING);
+		snd_pcm_release_substream(lane->substream);
+		mutex_unlock(&hw->open_mutex);
+		wake_up(&hw->open_wait);
+	}
+	kvfree(lane->acc);
+	kfree(lane);
+}
+
+/* open a free substream of the hardware PCM as a new lane */
+static struct shared_lane *shared_lane_new(struct snd_pcm_shared *shared)
+{
+	struct snd_pcm *hw = shared->hw;
+	struct snd_pcm_runtime *runtime;
+	struct shared_lane *lane;
+	int err;
+
+	lane = kzalloc(sizeof(*lane), GFP_KERNEL);
+	if (!lane)
+		return ERR_PTR(-ENOMEM);
+	lane->shared = shared;
+	spin_lock_init(&lane->lock);
+	INIT_LIST_HEAD(&lane->clients);
+	INIT_WORK(&lane->work, shared_lane_work);
+
+	mutex_lock_nested(&hw->open_mutex, SINGLE_DEPTH_NESTING);
+	err = snd_pcm_open_substream(hw, SNDRV_PCM_STREAM_PLAYBACK, NULL,
+				     &lane->substream);
+	mutex_unlock(&hw->open_mutex);
+	if (err < 0) {
+		lane->substream = NULL;
+		goto error;
+	}
+
+	err = shared_lane_params(lane);
+	if (err < 0)
+		goto error;
+	runtime = lane->substream->runtime;
+	lane->acc = kvmalloc_array(runtime->period_size * SHARED_CHANNELS,
+				   sizeof(*lane->acc), GFP_KERNEL);
+	if (!lane->acc) {
+		err = -ENOMEM;
+		goto error;
+	}
+	runtime->period_notify_data = lane;
+	runtime->period_notify = shared_lane_period;
+	err = shared_lane_start(lane);
+	if (err < 0)
+		goto error;
+	return lane;
+
+ error:
+	shared_lane_free(lane);
+	return ERR_PTR(err);
+}
+
+/* pick a lane for a new client; called under shared->lock */
+static struct shared_lane *shared_lane_get(struct snd_pcm_shared *shared)
+{
+	struct shared_lane *lane, *best = NULL;
+
+	lane = shared_lane_new(shared);
+	if (!IS_ERR(lane)) {
+		list_add_tail(&lane->list, &shared->lanes);
+		return lane;
+	}
+	if (PTR_ERR(lane) != -EAGAIN)
+		return lane;
+
+	/* no hardware substream left, mix in software */
+	list_for_each_entry(lane, &shared->lanes, list) {
+		if (!best || lane->nclients < best->nclients)
+			best = lane;
+	}
+	return best ? best : ERR_PTR(-EBUSY);
+}
+
+/*
+ * unlink a lane left without clients; called under shared->lock, and the
+ * caller frees the lane after dropping it
+ */
+static bool shared_lane_put(struct snd_pcm_shared *shared,
+			    struct shared_lane *lane)
+{
+	if (lane->nclients)
+		return false;
+	list_del(&lane->list);
+	return true;
+}
+
+static const struct snd_pcm_hardware shared_pcm_hw = {
+	.info =			(SNDRV_PCM_INFO_MMAP |
+				 SNDRV_PCM_INFO_INTERLEAVED |
+				 SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				 SNDRV_PCM_INFO_MMAP_VALID |
+				 SNDRV_PCM_INFO_PAUSE),
+	.formats =		SNDRV_PCM_FMTBIT_S16_LE,
+	.channels_min =		SHARED_CHANNELS,
+	.channels_max =		SHARED_CHANNELS,
+	.buffer_bytes_max =	512 * 1024,
+	.period_bytes_min =	64,
+	.period_bytes_max =	256 * 1024,
+	.periods_min =		2,
+	.periods_max =		1024,
+};
+
+static int shared_pcm_open(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_shared *shared = snd_pcm_substream_chip(substream);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct shared_client *client;
+	struct shared_lane *lane;
+	int err;
+
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	if (!client)
+		return -ENOMEM;
+	client->substream = substream;
+
+	mutex_lock(&shared->lock);
+	lane = shared_lane_get(shared);
+	if (IS_ERR(lane)) {
+		err = PTR_ERR(lane);
+		goto error;
+	}
+
+	runtime->hw = shared_pcm_hw;
+	runtime->hw.rates = snd_pcm_rate_to_rate_bit(shared->rate);
+	runtime->hw.rate_min = shared->rate;
+	runtime->hw.rate_max = shared->rate;
+	/* client periods end on lane periods */
+	err = snd_pcm_hw_constraint_step(runtime, 0,
+					 SNDRV_PCM_HW_PARAM_PERIOD_SIZE,
+					 lane->substream->runtime->period_size);
+	if (err < 0) {
+		if (shared_lane_put(shared, lane)) {
+			mutex_unlock(&shared->lock);
+			shared_lane_free(lane);
+			kfree(client);
+			return err;
+		}
+		goto error;
+	}
+
+	client->lane = lane;
+	spin_lock_irq(&lane->lock);
+	list_add_tail(&client->list, &lane->clients);
+	lane->nclients++;
+	spin_unlock_irq(&lane->lock);
+	mutex_unlock(&shared->lock);
+	runtime->private_data = client;
+	return 0;
+
+ error:
+	mutex_unlock(&shared->lock);
+	kfree(client);
+	return err;
+}
+
+static int shared_pcm_close(struct snd_pcm_substream *substream)
+{
+	struct shared_client *client = substream->runtime->private_data;
+	struct shared_lane *lane = client->lane;
+	struct snd_pcm_shared *shared = lane->shared;
+	bool unused;
+
+	spin_lock_irq(&lane->lock);
+	list_del(&client->list);
+	spin_unlock_irq(&lane->lock);
+	/*
+	 * the work may still be reporting a period of this client; the lane
+	 * stays counted as used until then
+	 */
+	flush_work(&lane->work);
+
+	mutex_lock(&shared->lock);
+	spin_lock_irq(&lane->lock);
+	lane->nclients--;
+	spin_unlock_irq(&lane->lock);
+	unused = shared_lane_put(shared, lane);
+	mutex_unlock(&shared->lock);
+	if (unused)
+		shared_lane_free(lane);
+	kfree(client);
+	return 0;
+}
+
+static int shared_pcm_hw_params(struct snd_pcm_substream *substream,
+				struct snd_pcm_hw_params *hw_params)
+{
+	return snd_pcm_lib_alloc_vmalloc_buffer(substream,
+						params_buffer_bytes(hw_params));
+}
+
+static int shared_pcm_hw_free(struct snd_pcm_substream *substream)
+{
+	return snd_pcm_lib_free_vmalloc_buffer(substream);
+}
+
+static int shared_pcm_prepare(struct snd_pcm_substream *substream)
+{
+	struct shared_client *client = substream->runtime->private_data;
+	struct shared_lane *lane = client->lane;
+
+	spin_lock_irq(&lane->lock);
+	client->pos = 0;
+	client->period_pos = 0;
+	client->elapsed = false;
+	if (lane->substream->runtime->status->state == SNDRV_PCM_STATE_SUSPENDED) {
+		lane->restart = true;
+		queue_work(system_highpri_wq, &lane->work);
+	}
+	spin_unlock_irq(&lane->lock);
+	return 0;
+}
+
+static int shared_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+	struct shared_client *client = substream->runtime->private_data;
+	struct shared_lane *lane = client->lane;
+	int err = 0;
+
+	spin_lock(&lane->lock);
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		client->running = true;
+		break;
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+		client->running = false;
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+	spin_unlock(&lane->lock);
+	return err;
+}
+
+static snd_pcm_uframes_t shared_pcm_pointer(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct shared_client *client = runtime->private_data;
+	struct shared_lane *lane = client->lane;
+	struct snd_pcm_runtime *lane_runtime = lane->substream->runtime;
+	snd_pcm_sframes_t delay;
+	snd_pcm_uframes_t pos;
+
+	spin_lock(&lane->lock);
+	pos = client->pos % runtime->buffer_size;
+	spin_unlock(&lane->lock);
+
+	/* the frames mixed into the lane but not played yet */
+	delay = READ_ONCE(lane->mix_ptr) -
+		READ_ONCE(lane_runtime->status->hw_ptr);
+	if (delay < 0)
+		delay += lane_runtime->boundary;
+	runtime->delay = min_t(snd_pcm_sframes_t, delay,
+			       lane_runtime->buffer_size);
+	return pos;
+}
+
+static const struct snd_pcm_ops shared_pcm_ops = {
+	.open =		shared_pcm_open,
+	.close =	shared_pcm_close,
+	.ioctl =	snd_pcm_lib_ioctl,
+	.hw_params =	shared_pcm_hw_params,
+	.hw_free =	shared_pcm_hw_free,
+	.prepare =	shared_pcm_prepare,
+	.trigger =	shared_pcm_trigger,
+	.pointer =	shared_pcm_pointer,
+	.page =		snd_pcm_lib_get_vmalloc_page,
+};
+
+static void snd_pcm_shared_free(struct snd_pcm *pcm)
+{
+	struct snd_pcm_shared *shared = pcm->private_data;
+
+	shared->hw->shared = NULL;
+	kfree(shared);
+}
+
+/**
+ * snd_pcm_new_shared - create a shared playback device over a PCM
+ * @pcm: the PCM whose playback substreams are mixed by the hardware
+ * @device: the device index of the shared PCM
+ * @clients: the number of substreams of the shared PCM
+ * @rate: the rate the hardware substreams are run at
+ *
+ * Creates a PCM device with @clients playback substreams in S16_LE stereo
+ * at @rate.  Each one is played through a free playback substream of
+ * @pcm while there is one, and mixed in software with the other clients
+ * of the least loaded one afterwards.  @pcm must let the CPU write its
+ * buffer directly and accept this format; its suspend via
+ * snd_pcm_suspend_all() suspends the shared device as well.
+ *
+ * Return: Zero if successful, or a negative error code on failure.
+ */
+int snd_pcm_new_shared(struct snd_pcm *pcm, int device, int clients,
+		       unsigned int rate)
+{
+	struct snd_pcm_shared *shared;
+	struct snd_pcm *spcm;
+	int err;
+
+	if (snd_BUG_ON(!pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream_count ||
+		       pcm->shared))
+		return -EINVAL;
+
+	shared = kzalloc(sizeof(*shared), GFP_KERNEL);
+	if (!shared)
+		return -ENOMEM;
+	err = snd_pcm_new(pcm->card, pcm->id, device, clients, 0, &spcm);
+	if (err < 0) {
+		kfree(shared);
+		return err;
+	}
+
+	shared->hw = pcm;
+	shared->rate = rate;
+	mutex_init(&shared->lock);
+	INIT_LIST_HEAD(&shared->lanes);
+	spcm->private_data = shared;
+	spcm->private_free = snd_pcm_shared_free;
+	snprintf(spcm->name, sizeof(spcm->name), "%s Shared", pcm->name);
+	snd_pcm_set_ops(spcm, SNDRV_PCM_STREAM_PLAYBACK, &shared_pcm_ops);
+	pcm->shared = spcm;
+	return 0;
+}
+EXPORT_SYMBOL(snd_pcm_new_shared);
@@ -24,11 +24,16 @@
 #include <linux/init.h>
 #include <linux/sched/signal.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <linux/time.h>
 #include <linux/wait.h>
 #include <linux/mutex.h>
 #include <linux/module.h>
 #include <linux/delay.h>
+#include <linux/rcupdate.h>
+#include <linux/percpu.h>
+#include <linux/file.h>
 #include <sound/rawmidi.h>
 #include <sound/info.h>
 #include <sound/control.h>
@@ -63,6 +68,8 @@ static DEFINE_MUTEX(register_mutex);
 #define rmidi_dbg(rmidi, fmt, args...) \
 	dev_dbg(&(rmidi)->dev, fmt, ##args)
 
+#define RAWMIDI_FRAME_SIZE	sizeof(struct snd_rawmidi_framing_tstamp)
+
 static struct snd_rawmidi *snd_rawmidi_search(struct snd_card *card, int device)
 {
 	struct snd_rawmidi *rawmidi;
@@ -129,6 +136,9 @@ static int snd_rawmidi_runtime_create(struct snd_rawmidi_substream *substream)
 		return -ENOMEM;
 	}
 	runtime->appl_ptr = runtime->hw_ptr = 0;
+	if (substream->stream == SNDRV_RAWMIDI_STREAM_INPUT)
+		runtime->lockless = substream->rmidi->lockless_input;
+	runtime->rx_woken = ULONG_MAX;
 	substream->runtime = runtime;
 	return 0;
 }
@@ -137,7 +147,8 @@ static int snd_rawmidi_runtime_free(struct snd_rawmidi_substream *substream)
 {
 	struct snd_rawmidi_runtime *runtime = substream->runtime;
 
-	kfree(runtime->buffer);
+	kvfree(runtime->buffer);
+	vfree(runtime->mmap_control);
 	kfree(runtime);
 	substream->runtime = NULL;
 	return 0;
@@ -159,6 +170,127 @@ static void snd_rawmidi_input_trigger(struct snd_rawmidi_substream *substream, i
 		cancel_work_sync(&substream->runtime->event_work);
 }
 
+/*
+ * lockless input helpers for the reader side, called under runtime->lock.
+ *
+ * The reader picks up what snd_rawmidi_receive() stored since the last
+ * call into avail, and hands back the space of what it has consumed once
+ * no read copies from the buffer anymore.
+ */
+static void rawmidi_lockless_sync(struct snd_rawmidi_runtime *runtime)
+{
+	unsigned long in = smp_load_acquire(&runtime->rx_in);
+	unsigned long xruns = READ_ONCE(runtime->rx_xruns);
+
+	runtime->avail += in - runtime->rx_seen;
+	runtime->rx_seen = in;
+	runtime->xruns += xruns - runtime->rx_xruns_seen;
+	runtime->rx_xruns_seen = xruns;
+}
+
+static void rawmidi_lockless_release(struct snd_rawmidi_runtime *runtime)
+{
+	if (!runtime->rx_copying)
+		smp_store_release(&runtime->rx_out,
+				  runtime->rx_seen - runtime->avail);
+}
+
+/*
+ * mmap helpers, called under runtime->lock.
+ *
+ * The application moves mmap_control->appl_ptr on its own; the amount is
+ * applied to the ring as if it was read or written via read()/write().
+ * An application pointer beyond the valid range is ignored.
+ */
+static void rawmidi_mmap_sync_appl(struct snd_rawmidi_runtime *runtime)
+{
+	u64 appl = READ_ONCE(runtime->mmap_control->appl_ptr);
+	u64 delta = appl - runtime->mmap_appl;
+
+	if (!delta || delta > runtime->avail)
+		return;
+	/* read the data only after the pointer (output) */
+	smp_rmb();
+	runtime->appl_ptr += delta;
+	runtime->appl_ptr %= runtime->buffer_size;
+	runtime->avail -= delta;
+	runtime->mmap_appl = appl;
+}
+
+static void rawmidi_mmap_update_hw(struct snd_rawmidi_runtime *runtime,
+				   size_t count)
+{
+	struct snd_rawmidi_mmap_control *control = runtime->mmap_control;
+
+	/* publish the data before the pointer (input) */
+	smp_wmb();
+	WRITE_ONCE(control->hw_ptr, control->hw_ptr + count);
+	control->xruns = runtime->xruns;
+}
+
+/* move both pointers to the given position, dropping the data between */
+static void rawmidi_mmap_reset(struct snd_rawmidi_runtime *runtime, u64 pos)
+{
+	struct snd_rawmidi_mmap_control *control = runtime->mmap_control;
+	u64 tmp = pos;
+
+	WRITE_ONCE(control->hw_ptr, pos);
+	WRITE_ONCE(control->appl_ptr, pos);
+	runtime->mmap_appl = pos;
+	runtime->appl_ptr = runtime->hw_ptr = do_div(tmp, (u32)runtime->buffer_size);
+}
+
+/*
+ * take over the application pointer of a mapped stream and kick the
+ * device
+ */
+static void rawmidi_sync_ptr(struct snd_rawmidi_substream *substream)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	bool pending;
+
+	spin_lock_irq(&runtime->lock);
+	rawmidi_mmap_sync_appl(runtime);
+	pending = runtime->avail < runtime->buffer_size;
+	spin_unlock_irq(&runtime->lock);
+	if (substream->stream == SNDRV_RAWMIDI_STREAM_INPUT)
+		snd_rawmidi_input_trigger(substream, 1);
+	else if (pending)
+		snd_rawmidi_output_trigger(substream, 1);
+}
+
+/*
+ * update the traffic counters; the callers are serialized per substream,
+ * either by runtime->lock or by the lockless input contract
+ */
+static void rawmidi_account(struct snd_rawmidi_substream *substream,
+			    unsigned int events, size_t dropped, size_t queued)
+{
+	struct snd_rawmidi_stats *stats = get_cpu_ptr(substream->stats);
+
+	stats->events += events;
+	stats->dropped += dropped;
+	if (queued > stats->max_queued)
+		stats->max_queued = queued;
+	put_cpu_ptr(substream->stats);
+}
+
+static void rawmidi_stats_sum(struct snd_rawmidi_substream *substream,
+			      struct snd_rawmidi_stats *sum)
+{
+	struct snd_rawmidi_stats *stats;
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(substream->stats, cpu);
+		sum->events += READ_ONCE(stats->events);
+		sum->dropped += READ_ONCE(stats->dropped);
+		sum->max_queued = max(sum->max_queued,
+				      READ_ONCE(stats->max_queued));
+	}
+}
+
 int snd_rawmidi_drop_output(struct snd_rawmidi_substream *substream)
 {
 	unsigned long flags;
@@ -167,7 +299,14 @@ int snd_rawmidi_drop_output(struct snd_rawmidi_substream *substream)
 	snd_rawmidi_output_trigger(substream, 0);
 	runtime->drain = 0;
 	spin_lock_irqsave(&runtime->lock, flags);
-	runtime->appl_ptr = runtime->hw_ptr = 0;
+	if (runtime->avail < runtime->buffer_size)
+		rawmidi_account(substream, 0,
+				runtime->buffer_size - runtime->avail, 0);
+	if (runtime->mmap_control)
+		rawmidi_mmap_reset(runtime,
+				   READ_ONCE(runtime->mmap_control->appl_ptr));
+	else
+		runtime->appl_ptr = runtime->hw_ptr = 0;
 	runtime->avail = runtime->buffer_size;
 	spin_unlock_irqrestore(&runtime->lock, flags);
 	return 0;
@@ -214,13 +353,302 @@ int snd_rawmidi_drain_input(struct snd_rawmidi_substream *substream)
 	snd_rawmidi_input_trigger(substream, 0);
 	runtime->drain = 0;
 	spin_lock_irqsave(&runtime->lock, flags);
-	runtime->appl_ptr = runtime->hw_ptr = 0;
+	if (runtime->lockless) {
+		/* hw_ptr belongs to the receive side; skip to it instead */
+		rawmidi_lockless_sync(runtime);
+		runtime->appl_ptr += runtime->avail;
+		runtime->appl_ptr %= runtime->buffer_size;
+		runtime->avail = 0;
+		rawmidi_lockless_release(runtime);
+		spin_unlock_irqrestore(&runtime->lock, flags);
+		return 0;
+	}
+	if (runtime->mmap_control)
+		rawmidi_mmap_reset(runtime, runtime->mmap_control->hw_ptr);
+	else
+		runtime->appl_ptr = runtime->hw_ptr = 0;
 	runtime->avail = 0;
 	spin_unlock_irqrestore(&runtime->lock, flags);
 	return 0;
 }
 EXPORT_SYMBOL(snd_rawmidi_drain_input);
 
+/*
+ * in-kernel MIDI thru: the input is forwarded to an output opened in
+ * append mode right from snd_rawmidi_receive().  runtime->thru is read
+ * under RCU; bindings are added and removed under thru_mutex.
+ */
+struct snd_rawmidi_thru_link {
+	struct list_head list;		/* in thru_list */
+	struct snd_rawmidi_substream *input;
+	struct snd_rawmidi_file dest;
+	struct snd_rawmidi_thru params;
+	bool parse;			/* filter or channel mask is set */
+	spinlock_t lock;
+	/* parser state */
+	unsigned char status;		/* running status of voice messages */
+	unsigned char left;		/* data bytes left in the message */
+	unsigned char drop;		/* drop the current message */
+	unsigned char sysex;		/* inside system exclusive */
+	/* statistics */
+	unsigned long forwarded;
+	unsigned long dropped;		/* bytes the output had no room for */
+};
+
+#define RAWMIDI_THRU_FILTERS	(SNDRV_RAWMIDI_THRU_FILTER_SYSEX | \
+				 SNDRV_RAWMIDI_THRU_FILTER_COMMON | \
+				 SNDRV_RAWMIDI_THRU_FILTER_REALTIME | \
+				 SNDRV_RAWMIDI_THRU_FILTER_ACTIVE_SENSING)
+#define RAWMIDI_THRU_CHUNK	32
+
+static DEFINE_MUTEX(thru_mutex);
+static LIST_HEAD(thru_list);
+
+static const struct file_operations snd_rawmidi_f_ops;
+
+static int rawmidi_thru_data_length(unsigned char status)
+{
+	switch (status) {
+	case 0xc0 ... 0xdf:
+	case 0xf1:
+	case 0xf3:
+		return 1;
+	case 0xf0:
+	case 0xf4 ... 0xf7:
+		return 0;
+	default:
+		return 2;
+	}
+}
+
+/*
+ * parse one byte and store what is to be forwarded in out, at most two
+ * bytes; a voice message is always sent with its status byte, so that
+ * dropped messages don't break the running status of the output.
+ */
+static int rawmidi_thru_parse(struct snd_rawmidi_thru_link *thru,
+			      unsigned char c, unsigned char *out)
+{
+	unsigned int filter = thru->params.filter;
+	int n = 0;
+
+	if (c >= 0xf8) {
+		if (c == 0xfe ? (filter & SNDRV_RAWMIDI_THRU_FILTER_ACTIVE_SENSING) :
+				(filter & SNDRV_RAWMIDI_THRU_FILTER_REALTIME))
+			return 0;
+		out[0] = c;
+		return 1;
+	}
+	if (c & 0x80) {
+		if (c < 0xf0) {
+			/* sent along with the first data byte */
+			thru->status = c;
+			thru->left = 0;
+			thru->sysex = 0;
+			thru->drop = !(thru->params.channels & (1U << (c & 0x0f)));
+			return 0;
+		}
+		thru->status = 0;
+		thru->left = rawmidi_thru_data_length(c);
+		if (c == 0xf7) {
+			if (!thru->sysex)
+				return 0;
+			thru->sysex = 0;
+		} else if (c == 0xf0) {
+			thru->sysex = 1;
+			thru->drop = !!(filter & SNDRV_RAWMIDI_THRU_FILTER_SYSEX);
+		} else {
+			thru->sysex = 0;
+			thru->drop = !!(filter & SNDRV_RAWMIDI_THRU_FILTER_COMMON);
+		}
+		if (thru->drop)
+			return 0;
+		out[0] = c;
+		return 1;
+	}
+
+	/* data byte */
+	if (thru->sysex) {
+		if (thru->drop)
+			return 0;
+		out[0] = c;
+		return 1;
+	}
+	if (thru->status) {
+		if (!thru->left) {
+			thru->left = rawmidi_thru_data_length(thru->status);
+			if (!thru->drop)
+				out[n++] = thru->status;
+		}
+	} else if (!thru->left) {
+		return 0;	/* no status to apply it to */
+	}
+	thru->left--;
+	if (!thru->drop)
+		out[n++] = c;
+	return n;
+}
+
+/* called with thru->lock held */
+static void rawmidi_thru_write(struct snd_rawmidi_thru_link *thru,
+			       const unsigned char *buf, int count)
+{
+	long written;
+
+	if (!count)
+		return;
+	/* in append mode, this writes all or nothing */
+	written = snd_rawmidi_kernel_write(thru->dest.output, buf, count);
+	if (written < 0)
+		written = 0;
+	thru->forwarded += written;
+	thru->dropped += count - written;
+}
+
+static void rawmidi_thru_forward(struct snd_rawmidi_thru_link *thru,
+				 const unsigned char *buffer, int count)
+{
+	unsigned char out[RAWMIDI_THRU_CHUNK * 2];
+	unsigned long flags;
+	int i, len, n;
+
+	spin_lock_irqsave(&thru->lock, flags);
+	if (!thru->parse) {
+		rawmidi_thru_write(thru, buffer, count);
+		goto unlock;
+	}
+	while (count > 0) {
+		len = min(count, RAWMIDI_THRU_CHUNK);
+		for (i = n = 0; i < len; i++)
+			n += rawmidi_thru_parse(thru, buffer[i], out + n);
+		rawmidi_thru_write(thru, out, n);
+		buffer += len;
+		count -= len;
+	}
+ unlock:
+	spin_unlock_irqrestore(&thru->lock, flags);
+}
+
+static struct snd_rawmidi_thru_link *
+rawmidi_thru_new(struct snd_rawmidi_substream *input,
+		 const struct snd_rawmidi_thru *params)
+{
+	struct snd_rawmidi_thru_link *thru;
+	struct snd_rawmidi_file *rfile;
+	struct snd_rawmidi *rmidi;
+	struct fd f;
+	int err;
+
+	if (params->filter & ~RAWMIDI_THRU_FILTERS)
+		return ERR_PTR(-EINVAL);
+	/*
+	 * The caller proves its access to the output with an fd opened for
+	 * writing, the same check as opening the device.  The open file
+	 * also keeps the card around until the kernel open below has its
+	 * own reference; a disconnected file has other f_ops.
+	 */
+	f = fdget(params->fd);
+	if (!f.file)
+		return ERR_PTR(-EBADF);
+	if (f.file->f_op != &snd_rawmidi_f_ops ||
+	    !(f.file->f_mode & FMODE_WRITE)) {
+		err = -EBADF;
+		goto error;
+	}
+	rfile = f.file->private_data;
+	rmidi = rfile->rmidi;
+	if (rmidi->card->number != params->card ||
+	    rmidi->device != params->device) {
+		err = -EINVAL;
+		goto error;
+	}
+
+	thru = kzalloc(sizeof(*thru), GFP_KERNEL);
+	if (!thru) {
+		err = -ENOMEM;
+		goto error;
+	}
+	err = snd_rawmidi_kernel_open(rmidi->card, params->device,
+				      params->subdevice,
+				      SNDRV_RAWMIDI_LFLG_OUTPUT |
+				      SNDRV_RAWMIDI_LFLG_APPEND,
+				      &thru->dest);
+	if (err < 0) {
+		kfree(thru);
+		goto error;
+	}
+	fdput(f);
+	thru->input = input;
+	thru->params = *params;
+	thru->parse = params->filter || params->channels != 0xffff;
+	spin_lock_init(&thru->lock);
+	return thru;
+
+ error:
+	fdput(f);
+	return ERR_PTR(err);
+}
+
+static void rawmidi_thru_free(struct snd_rawmidi_thru_link *thru)
+{
+	if (!thru)
+		return;
+	/* wait for snd_rawmidi_receive() calls still forwarding */
+	synchronize_rcu();
+	snd_rawmidi_kernel_release(&thru->dest);
+	kfree(thru);
+}
+
+/* replace the binding of the input; thru may be NULL to unbind */
+static void rawmidi_thru_replace(struct snd_rawmidi_substream *input,
+				 struct snd_rawmidi_thru_link *thru)
+{
+	struct snd_rawmidi_thru_link *old;
+
+	mutex_lock(&thru_mutex);
+	old = rcu_dereference_protected(input->runtime->thru,
+					lockdep_is_held(&thru_mutex));
+	if (old)
+		list_del(&old->list);
+	if (thru)
+		list_add_tail(&thru->list, &thru_list);
+	rcu_assign_pointer(input->runtime->thru, thru);
+	mutex_unlock(&thru_mutex);
+	rawmidi_thru_free(old);
+}
+
+static int snd_rawmidi_thru_bind(struct snd_rawmidi_substream *input,
+				 const struct snd_rawmidi_thru *params)
+{
+	struct snd_rawmidi_thru_link *thru = NULL;
+
+	if (params->card >= 0) {
+		thru = rawmidi_thru_new(input, params);
+		if (IS_ERR(thru))
+			return PTR_ERR(thru);
+	}
+	rawmidi_thru_replace(input, thru);
+	return 0;
+}
+
+/* drop the bindings to the outputs of a device going away */
+static void rawmidi_thru_disconnect(struct snd_rawmidi *rmidi)
+{
+	struct snd_rawmidi_thru_link *thru, *next;
+	LIST_HEAD(gone);
+
+	mutex_lock(&thru_mutex);
+	list_for_each_entry_safe(thru, next, &thru_list, list) {
+		if (thru->dest.rmidi != rmidi)
+			continue;
+		RCU_INIT_POINTER(thru->input->runtime->thru, NULL);
+		list_move_tail(&thru->list, &gone);
+	}
+	mutex_unlock(&thru_mutex);
+	list_for_each_entry_safe(thru, next, &gone, list)
+		rawmidi_thru_free(thru);
+}
+
 /* look for an available substream for the given stream direction;
  * if a specific subdevice is given, try to assign it
  */
@@ -498,6 +926,9 @@ static void rawmidi_release_priv(struct snd_rawmidi_file *rfile)
 {
 	struct snd_rawmidi *rmidi;
 
+	/* the output of the binding may belong to this device */
+	if (rfile->input)
+		rawmidi_thru_replace(rfile->input, NULL);
 	rmidi = rfile->rmidi;
 	mutex_lock(&rmidi->open_mutex);
 	if (rfile->input) {
@@ -623,11 +1054,38 @@ static int snd_rawmidi_info_select_user(struct snd_card *card,
 	return 0;
 }
 
+/*
+ * replace the buffer; the contents are dropped, the caller resets the
+ * pointers.  Fails while a read or write copies without the lock.
+ */
+static int resize_runtime_buffer(struct snd_rawmidi_runtime *runtime,
+				 size_t size)
+{
+	char *newbuf, *oldbuf;
+
+	newbuf = kvmalloc(size, GFP_KERNEL);
+	if (!newbuf)
+		return -ENOMEM;
+	spin_lock_irq(&runtime->lock);
+	/* a mapped buffer can't be replaced */
+	if (runtime->buffer_ref || runtime->mmap_control) {
+		spin_unlock_irq(&runtime->lock);
+		kvfree(newbuf);
+		return -EBUSY;
+	}
+	oldbuf = runtime->buffer;
+	runtime->buffer = newbuf;
+	runtime->buffer_size = size;
+	spin_unlock_irq(&runtime->lock);
+	kvfree(oldbuf);
+	return 0;
+}
+
 int snd_rawmidi_output_params(struct snd_rawmidi_substream *substream,
 			      struct snd_rawmidi_params * params)
 {
-	char *newbuf;
 	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	int err;
 	
 	if (substream->append && substream->use_count > 1)
 		return -EBUSY;
@@ -639,12 +1097,9 @@ int snd_rawmidi_output_params(struct snd_rawmidi_substream *substream,
 		return -EINVAL;
 	}
 	if (params->buffer_size != runtime->buffer_size) {
-		newbuf = krealloc(runtime->buffer, params->buffer_size,
-				  GFP_KERNEL);
-		if (!newbuf)
-			return -ENOMEM;
-		runtime->buffer = newbuf;
-		runtime->buffer_size = params->buffer_size;
+		err = resize_runtime_buffer(runtime, params->buffer_size);
+		if (err < 0)
+			return err;
 		runtime->avail = runtime->buffer_size;
 	}
 	runtime->avail_min = params->avail_min;
@@ -656,8 +1111,31 @@ EXPORT_SYMBOL(snd_rawmidi_output_params);
 int snd_rawmidi_input_params(struct snd_rawmidi_substream *substream,
 			     struct snd_rawmidi_params * params)
 {
-	char *newbuf;
 	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	unsigned int framing, clock_type;
+	int err;
+
+	framing = params->mode & SNDRV_RAWMIDI_MODE_FRAMING_MASK;
+	clock_type = params->mode & SNDRV_RAWMIDI_MODE_CLOCK_MASK;
+	if (params->mode & ~(SNDRV_RAWMIDI_MODE_FRAMING_MASK |
+			     SNDRV_RAWMIDI_MODE_CLOCK_MASK))
+		return -EINVAL;
+	switch (framing) {
+	case SNDRV_RAWMIDI_MODE_FRAMING_NONE:
+		if (clock_type != SNDRV_RAWMIDI_MODE_CLOCK_NONE)
+			return -EINVAL;
+		break;
+	case SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP:
+		if (clock_type == SNDRV_RAWMIDI_MODE_CLOCK_NONE ||
+		    clock_type > SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW)
+			return -EINVAL;
+		/* frames must never wrap around the buffer end */
+		if (params->buffer_size % RAWMIDI_FRAME_SIZE)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
 
 	snd_rawmidi_drain_input(substream);
 	if (params->buffer_size < 32 || params->buffer_size > 1024L * 1024L) {
@@ -667,14 +1145,18 @@ int snd_rawmidi_input_params(struct snd_rawmidi_substream *substream,
 		return -EINVAL;
 	}
 	if (params->buffer_size != runtime->buffer_size) {
-		newbuf = krealloc(runtime->buffer, params->buffer_size,
-				  GFP_KERNEL);
-		if (!newbuf)
-			return -ENOMEM;
-		runtime->buffer = newbuf;
-		runtime->buffer_size = params->buffer_size;
+		err = resize_runtime_buffer(runtime, params->buffer_size);
+		if (err < 0)
+			return err;
+		runtime->appl_ptr = runtime->hw_ptr = 0;
 	}
 	runtime->avail_min = params->avail_min;
+	runtime->framing = framing;
+	runtime->clock_type = clock_type;
+	/* frames are still stored under the lock */
+	runtime->lockless = substream->rmidi->lockless_input &&
+		framing == SNDRV_RAWMIDI_MODE_FRAMING_NONE &&
+		!runtime->mmap_control;
 	return 0;
 }
 EXPORT_SYMBOL(snd_rawmidi_input_params);
@@ -700,6 +1182,8 @@ static int snd_rawmidi_input_status(struct snd_rawmidi_substream *substream,
 	memset(status, 0, sizeof(*status));
 	status->stream = SNDRV_RAWMIDI_STREAM_INPUT;
 	spin_lock_irq(&runtime->lock);
+	if (runtime->lockless)
+		rawmidi_lockless_sync(runtime);
 	status->avail = runtime->avail;
 	status->xruns = runtime->xruns;
 	runtime->xruns = 0;
@@ -809,6 +1293,38 @@ static long snd_rawmidi_ioctl(struct file *file, unsigned int cmd, unsigned long
 			return -EINVAL;
 		}
 	}
+	case SNDRV_RAWMIDI_IOCTL_SYNC_PTR:
+	{
+		struct snd_rawmidi_substream *substream;
+		int val;
+		if (get_user(val, (int __user *) argp))
+			return -EFAULT;
+		switch (val) {
+		case SNDRV_RAWMIDI_STREAM_OUTPUT:
+			substream = rfile->output;
+			break;
+		case SNDRV_RAWMIDI_STREAM_INPUT:
+			substream = rfile->input;
+			break;
+		default:
+			return -EINVAL;
+		}
+		if (substream == NULL)
+			return -EINVAL;
+		if (!substream->runtime->mmap_control)
+			return -EBADFD;
+		rawmidi_sync_ptr(substream);
+		return 0;
+	}
+	case SNDRV_RAWMIDI_IOCTL_THRU:
+	{
+		struct snd_rawmidi_thru thru;
+		if (copy_from_user(&thru, argp, sizeof(thru)))
+			return -EFAULT;
+		if (rfile->input == NULL)
+			return -EINVAL;
+		return snd_rawmidi_thru_bind(rfile->input, &thru);
+	}
 	default:
 		rmidi_dbg(rfile->rmidi,
 			  "rawmidi: unknown command = 0x%x\n", cmd);
@@ -861,13 +1377,114 @@ static int snd_rawmidi_control_ioctl(struct snd_card *card,
 	return -ENOIOCTLCMD;
 }
 
+static void rawmidi_get_tstamp(struct snd_rawmidi_runtime *runtime,
+			       struct timespec64 *tstamp)
+{
+	switch (runtime->clock_type) {
+	case SNDRV_RAWMIDI_MODE_CLOCK_REALTIME:
+		ktime_get_real_ts64(tstamp);
+		break;
+	case SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW:
+		getrawmonotonic64(tstamp);
+		break;
+	default:
+		ktime_get_ts64(tstamp);
+		break;
+	}
+}
+
+/*
+ * store the data as timestamped frames; as the buffer size is a multiple
+ * of the frame size, a frame is never split at the buffer end.
+ * called with runtime->lock held.
+ */
+static int receive_with_tstamp_framing(struct snd_rawmidi_substream *substream,
+				       const unsigned char *buffer, int count,
+				       const struct timespec64 *tstamp)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	struct snd_rawmidi_framing_tstamp *frame;
+	int result = 0, len;
+
+	BUILD_BUG_ON(RAWMIDI_FRAME_SIZE != 32);
+	while (count > 0) {
+		if (runtime->buffer_size - runtime->avail < RAWMIDI_FRAME_SIZE) {
+			runtime->xruns += count;
+			break;
+		}
+		len = min(count, SNDRV_RAWMIDI_FRAMING_DATA_LENGTH);
+		frame = (struct snd_rawmidi_framing_tstamp *)
+			(runtime->buffer + runtime->hw_ptr);
+		memset(frame, 0, sizeof(*frame));
+		frame->frame_type = SNDRV_RAWMIDI_FRAME_TYPE_DEFAULT;
+		frame->length = len;
+		frame->tv_sec = tstamp->tv_sec;
+		frame->tv_nsec = tstamp->tv_nsec;
+		memcpy(frame->data, buffer, len);
+		runtime->hw_ptr += RAWMIDI_FRAME_SIZE;
+		runtime->hw_ptr %= runtime->buffer_size;
+		runtime->avail += RAWMIDI_FRAME_SIZE;
+		buffer += len;
+		count -= len;
+		result += len;
+	}
+	return result;
+}
+
+/*
+ * store the data without taking runtime->lock; there is only one caller
+ * at a time, see snd_rawmidi.lockless_input.  The reader is woken only
+ * when it may be sleeping, and once until it has consumed something.
+ */
+static int receive_lockless(struct snd_rawmidi_substream *substream,
+			    const unsigned char *buffer, int count)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	unsigned long in = runtime->rx_in;
+	unsigned long out = smp_load_acquire(&runtime->rx_out);
+	size_t size = runtime->buffer_size;
+	size_t len, count1;
+
+	substream->bytes += count;
+	len = min_t(size_t, count, size - (in - out));
+	rawmidi_account(substream, 1, count - len, in + len - out);
+	if (len < count)
+		WRITE_ONCE(runtime->rx_xruns, runtime->rx_xruns + count - len);
+	if (!len)
+		return 0;
+	count1 = min(len, size - runtime->hw_ptr);
+	memcpy(runtime->buffer + runtime->hw_ptr, buffer, count1);
+	if (len > count1)
+		memcpy(runtime->buffer, buffer + count1, len - count1);
+	runtime->hw_ptr = (runtime->hw_ptr + len) % size;
+	/* pairs with smp_load_acquire() in rawmidi_lockless_sync() */
+	smp_store_release(&runtime->rx_in, in + len);
+
+	if (runtime->event) {
+		queue_work_on(snd_card_cpu(substream->rmidi->card), system_wq,
+			      &runtime->event_work);
+	} else if (wq_has_sleeper(&runtime->sleep)) {
+		/* the reader queues itself before rechecking rx_in */
+		smp_rmb();
+		out = READ_ONCE(runtime->rx_out);
+		if (in + len - out >= runtime->avail_min &&
+		    out != runtime->rx_woken) {
+			runtime->rx_woken = out;
+			wake_up(&runtime->sleep);
+		}
+	}
+	return len;
+}
+
 /**
  * snd_rawmidi_receive - receive the input data from the device
  * @substream: the rawmidi substream
  * @buffer: the buffer pointer
  * @count: the data size to read
  *
- * Reads the data from the internal buffer.
+ * Reads the data from the internal buffer.  In the timestamp framing
+ * mode, the data is stamped with the time of this call.  With a MIDI thru
+ * binding, the data is also forwarded to its output.
  *
  * Return: The size of read data, or a negative error code on failure.
  */
@@ -877,6 +1494,9 @@ int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 	unsigned long flags;
 	int result = 0, count1;
 	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	struct snd_rawmidi_thru_link *thru;
+	struct timespec64 tstamp;
+	size_t avail = 0, xruns;
 
 	if (!substream->opened)
 		return -EBADFD;
@@ -885,8 +1505,26 @@ int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 			  "snd_rawmidi_receive: input is not active!!!\n");
 		return -EINVAL;
 	}
+	rcu_read_lock();
+	thru = rcu_dereference(runtime->thru);
+	if (thru)
+		rawmidi_thru_forward(thru, buffer, count);
+	rcu_read_unlock();
+	if (runtime->lockless)
+		return receive_lockless(substream, buffer, count);
+	if (runtime->framing == SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP)
+		rawmidi_get_tstamp(runtime, &tstamp);
 	spin_lock_irqsave(&runtime->lock, flags);
-	if (count == 1) {	/* special case, faster code */
+	if (runtime->mmap_control) {
+		rawmidi_mmap_sync_appl(runtime);
+		avail = runtime->avail;
+	}
+	xruns = runtime->xruns;
+	if (runtime->framing == SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP) {
+		substream->bytes += count;
+		result = receive_with_tstamp_framing(substream, buffer, count,
+						     &tstamp);
+	} else if (count == 1) {	/* special case, faster code */
 		substream->bytes++;
 		if (runtime->avail < runtime->buffer_size) {
 			runtime->buffer[runtime->hw_ptr++] = buffer[0];
@@ -924,9 +1562,13 @@ int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 			}
 		}
 	}
+	rawmidi_account(substream, 1, runtime->xruns - xruns, runtime->avail);
+	if (runtime->mmap_control)
+		rawmidi_mmap_update_hw(runtime, runtime->avail - avail);
 	if (result > 0) {
 		if (runtime->event)
-			schedule_work(&runtime->event_work);
+			queue_work_on(snd_card_cpu(substream->rmidi->card),
+				      system_wq, &runtime->event_work);
 		else if (snd_rawmidi_ready(substream))
 			wake_up(&runtime->sleep);
 	}
@@ -945,6 +1587,8 @@ static long snd_rawmidi_kernel_read1(struct snd_rawmidi_substream *substream,
 	unsigned long appl_ptr;
 
 	spin_lock_irqsave(&runtime->lock, flags);
+	if (runtime->lockless)
+		rawmidi_lockless_sync(runtime);
 	while (count > 0 && runtime->avail) {
 		count1 = runtime->buffer_size - runtime->appl_ptr;
 		if (count1 > count)
@@ -961,16 +1605,27 @@ static long snd_rawmidi_kernel_read1(struct snd_rawmidi_substream *substream,
 		if (kernelbuf)
 			memcpy(kernelbuf + result, runtime->buffer + appl_ptr, count1);
 		if (userbuf) {
+			int err;
+
+			/* keeps lockless receive off the space being copied */
+			runtime->rx_copying++;
+			runtime->buffer_ref++;
 			spin_unlock_irqrestore(&runtime->lock, flags);
-			if (copy_to_user(userbuf + result,
-					 runtime->buffer + appl_ptr, count1)) {
-				return result > 0 ? result : -EFAULT;
-			}
+			err = copy_to_user(userbuf + result,
+					   runtime->buffer + appl_ptr, count1);
 			spin_lock_irqsave(&runtime->lock, flags);
+			runtime->buffer_ref--;
+			runtime->rx_copying--;
+			if (err) {
+				result = result > 0 ? result : -EFAULT;
+				break;
+			}
 		}
 		result += count1;
 		count -= count1;
 	}
+	if (runtime->lockless)
+		rawmidi_lockless_release(runtime);
 	spin_unlock_irqrestore(&runtime->lock, flags);
 	return result;
 }
@@ -997,10 +1652,20 @@ static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t coun
 	if (substream == NULL)
 		return -EIO;
 	runtime = substream->runtime;
+	if (runtime->mmap_control)
+		return -EBUSY;
+	/* frames are read only as a whole */
+	if (runtime->framing != SNDRV_RAWMIDI_MODE_FRAMING_NONE) {
+		count -= count % RAWMIDI_FRAME_SIZE;
+		if (!count)
+			return -EINVAL;
+	}
 	snd_rawmidi_input_trigger(substream, 1);
 	result = 0;
 	while (count > 0) {
 		spin_lock_irq(&runtime->lock);
+		if (runtime->lockless)
+			rawmidi_lockless_sync(runtime);
 		while (!snd_rawmidi_ready(substream)) {
 			wait_queue_entry_t wait;
 			if ((file->f_flags & O_NONBLOCK) != 0 || result > 0) {
@@ -1010,6 +1675,15 @@ static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t coun
 			init_waitqueue_entry(&wait, current);
 			add_wait_queue(&runtime->sleep, &wait);
 			set_current_state(TASK_INTERRUPTIBLE);
+			/* lockless receive checks for sleepers after storing */
+			if (runtime->lockless) {
+				rawmidi_lockless_sync(runtime);
+				if (snd_rawmidi_ready(substream)) {
+					__set_current_state(TASK_RUNNING);
+					remove_wait_queue(&runtime->sleep, &wait);
+					break;
+				}
+			}
 			spin_unlock_irq(&runtime->lock);
 			schedule();
 			remove_wait_queue(&runtime->sleep, &wait);
@@ -1017,9 +1691,13 @@ static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t coun
 				return -ENODEV;
 			if (signal_pending(current))
 				return result > 0 ? result : -ERESTARTSYS;
-			if (!runtime->avail)
-				return result > 0 ? result : -EIO;
 			spin_lock_irq(&runtime->lock);
+			if (runtime->lockless)
+				rawmidi_lockless_sync(runtime);
+			if (!runtime->avail) {
+				spin_unlock_irq(&runtime->lock);
+				return result > 0 ? result : -EIO;
+			}
 		}
 		spin_unlock_irq(&runtime->lock);
 		count1 = snd_rawmidi_kernel_read1(substream,
@@ -1156,6 +1834,10 @@ int __snd_rawmidi_transmit_ack(struct snd_rawmidi_substream *substream, int coun
 	runtime->hw_ptr %= runtime->buffer_size;
 	runtime->avail += count;
 	substream->bytes += count;
+	if (count > 0)
+		rawmidi_account(substream, 1, 0, 0);
+	if (runtime->mmap_control && count > 0)
+		rawmidi_mmap_update_hw(runtime, count);
 	if (count > 0) {
 		if (runtime->drain || snd_rawmidi_ready(substream))
 			wake_up(&runtime->sleep);
@@ -1260,20 +1942,27 @@ static long snd_rawmidi_kernel_write1(struct snd_rawmidi_substream *substream,
 			memcpy(runtime->buffer + appl_ptr,
 			       kernelbuf + result, count1);
 		else if (userbuf) {
+			int err;
+
+			runtime->buffer_ref++;
 			spin_unlock_irqrestore(&runtime->lock, flags);
-			if (copy_from_user(runtime->buffer + appl_ptr,
-					   userbuf + result, count1)) {
-				spin_lock_irqsave(&runtime->lock, flags);
+			err = copy_from_user(runtime->buffer + appl_ptr,
+					     userbuf + result, count1);
+			spin_lock_irqsave(&runtime->lock, flags);
+			runtime->buffer_ref--;
+			if (err) {
 				result = result > 0 ? result : -EFAULT;
 				goto __end;
 			}
-			spin_lock_irqsave(&runtime->lock, flags);
 		}
 		result += count1;
 		count -= count1;
 	}
       __end:
 	count1 = runtime->avail < runtime->buffer_size;
+	if (result > 0)
+		rawmidi_account(substream, 0, 0,
+				runtime->buffer_size - runtime->avail);
 	spin_unlock_irqrestore(&runtime->lock, flags);
 	if (count1)
 		snd_rawmidi_output_trigger(substream, 1);
@@ -1299,6 +1988,8 @@ static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
 	rfile = file->private_data;
 	substream = rfile->output;
 	runtime = substream->runtime;
+	if (runtime->mmap_control)
+		return -EBUSY;
 	/* we cannot put an atomic message to our buffer */
 	if (substream->append && count > runtime->buffer_size)
 		return -EIO;
@@ -1357,6 +2048,112 @@ static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
 	return result;
 }
 
+/*
+ * move the stream to a buffer that can be mapped, keeping its contents
+ * and pointers; the mmap pointers start so that they match them.
+ */
+static int rawmidi_mmap_prepare(struct snd_rawmidi_substream *substream)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	struct snd_rawmidi_mmap_control *control;
+	unsigned char *buffer, *old;
+	size_t size;
+
+	if (runtime->mmap_control)
+		return 0;
+	/* the buffer of an appended output is shared with kernel writers */
+	if (substream->append)
+		return -EBUSY;
+	size = READ_ONCE(runtime->buffer_size);
+	buffer = vmalloc_user(PAGE_ALIGN(size));
+	if (!buffer)
+		return -ENOMEM;
+	control = vmalloc_user(PAGE_SIZE);
+	if (!control) {
+		vfree(buffer);
+		return -ENOMEM;
+	}
+
+	/* the mmap pointers are updated under the lock */
+	if (runtime->lockless)
+		snd_rawmidi_input_trigger(substream, 0);
+	spin_lock_irq(&runtime->lock);
+	/* a read or write copying from or to the old buffer, or a resize */
+	if (runtime->buffer_ref || runtime->buffer_size != size) {
+		spin_unlock_irq(&runtime->lock);
+		vfree(control);
+		vfree(buffer);
+		return -EBUSY;
+	}
+	if (runtime->lockless) {
+		rawmidi_lockless_sync(runtime);
+		runtime->lockless = false;
+	}
+	memcpy(buffer, runtime->buffer, runtime->buffer_size);
+	old = runtime->buffer;
+	runtime->buffer = buffer;
+	control->buffer_size = runtime->buffer_size;
+	control->xruns = runtime->xruns;
+	if (substream->stream == SNDRV_RAWMIDI_STREAM_INPUT) {
+		control->appl_ptr = runtime->appl_ptr;
+		control->hw_ptr = control->appl_ptr + runtime->avail;
+	} else {
+		control->appl_ptr = runtime->appl_ptr + runtime->buffer_size;
+		control->hw_ptr = control->appl_ptr -
+			(runtime->buffer_size - runtime->avail);
+	}
+	runtime->mmap_appl = control->appl_ptr;
+	runtime->mmap_control = control;
+	spin_unlock_irq(&runtime->lock);
+	kvfree(old);
+	return 0;
+}
+
+static int snd_rawmidi_mmap(struct file *file, struct vm_area_struct *area)
+{
+	struct snd_rawmidi_file *rfile = file->private_data;
+	struct snd_rawmidi_substream *substream;
+	struct snd_rawmidi_runtime *runtime;
+	unsigned long offset, size;
+	bool control;
+	int err;
+
+	offset = area->vm_pgoff << PAGE_SHIFT;
+	switch (offset) {
+	case SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT:
+	case SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_CONTROL:
+		substream = rfile->output;
+		break;
+	case SNDRV_RAWMIDI_MMAP_OFFSET_INPUT:
+	case SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_CONTROL:
+		substream = rfile->input;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (substream == NULL)
+		return -ENXIO;
+	control = offset == SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_CONTROL ||
+		offset == SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_CONTROL;
+	runtime = substream->runtime;
+	size = area->vm_end - area->vm_start;
+
+	mutex_lock(&rfile->rmidi->open_mutex);
+	err = rawmidi_mmap_prepare(substream);
+	mutex_unlock(&rfile->rmidi->open_mutex);
+	if (err < 0)
+		return err;
+
+	if (control) {
+		if (size > PAGE_SIZE)
+			return -EINVAL;
+		return remap_vmalloc_range(area, runtime->mmap_control, 0);
+	}
+	if (size > PAGE_ALIGN(runtime->buffer_size))
+		return -EINVAL;
+	return remap_vmalloc_range(area, runtime->buffer, 0);
+}
+
 static unsigned int snd_rawmidi_poll(struct file *file, poll_table * wait)
 {
 	struct snd_rawmidi_file *rfile;
@@ -1373,6 +2170,16 @@ static unsigned int snd_rawmidi_poll(struct file *file, poll_table * wait)
 		runtime = rfile->output->runtime;
 		poll_wait(file, &runtime->sleep, wait);
 	}
+	if (rfile->input != NULL && rfile->input->runtime->lockless) {
+		runtime = rfile->input->runtime;
+		spin_lock_irq(&runtime->lock);
+		rawmidi_lockless_sync(runtime);
+		spin_unlock_irq(&runtime->lock);
+	}
+	if (rfile->input != NULL && rfile->input->runtime->mmap_control)
+		rawmidi_sync_ptr(rfile->input);
+	if (rfile->output != NULL && rfile->output->runtime->mmap_control)
+		rawmidi_sync_ptr(rfile->output);
 	mask = 0;
 	if (rfile->input != NULL) {
 		if (snd_rawmidi_ready(rfile->input))
@@ -1403,6 +2210,11 @@ static void snd_rawmidi_proc_info_read(struct snd_info_entry *entry,
 	struct snd_rawmidi *rmidi;
 	struct snd_rawmidi_substream *substream;
 	struct snd_rawmidi_runtime *runtime;
+	struct snd_rawmidi_thru_link *thru;
+	struct snd_rawmidi_thru params;
+	struct snd_rawmidi_stats stats;
+	unsigned long forwarded, dropped;
+	int dest_sub;
 
 	rmidi = entry->private_data;
 	snd_iprintf(buffer, "%s\n\n", rmidi->name);
@@ -1411,11 +2223,17 @@ static void snd_rawmidi_proc_info_read(struct snd_info_entry *entry,
 		list_for_each_entry(substream,
 				    &rmidi->streams[SNDRV_RAWMIDI_STREAM_OUTPUT].substreams,
 				    list) {
+			rawmidi_stats_sum(substream, &stats);
 			snd_iprintf(buffer,
 				    "Output %d\n"
-				    "  Tx bytes     : %lu\n",
+				    "  Tx bytes     : %lu\n"
+				    "  Tx acks      : %lu\n"
+				    "  Dropped      : %lu\n"
+				    "  Max queued   : %lu\n",
 				    substream->number,
-				    (unsigned long) substream->bytes);
+				    (unsigned long) substream->bytes,
+				    stats.events, stats.dropped,
+				    stats.max_queued);
 			if (substream->opened) {
 				snd_iprintf(buffer,
 				    "  Owner PID    : %d\n",
@@ -1435,11 +2253,17 @@ static void snd_rawmidi_proc_info_read(struct snd_info_entry *entry,
 		list_for_each_entry(substream,
 				    &rmidi->streams[SNDRV_RAWMIDI_STREAM_INPUT].substreams,
 				    list) {
+			rawmidi_stats_sum(substream, &stats);
 			snd_iprintf(buffer,
 				    "Input %d\n"
-				    "  Rx bytes     : %lu\n",
+				    "  Rx bytes     : %lu\n"
+				    "  Rx transfers : %lu\n"
+				    "  Dropped      : %lu\n"
+				    "  Max queued   : %lu\n",
 				    substream->number,
-				    (unsigned long) substream->bytes);
+				    (unsigned long) substream->bytes,
+				    stats.events, stats.dropped,
+				    stats.max_queued);
 			if (substream->opened) {
 				snd_iprintf(buffer,
 					    "  Owner PID    : %d\n",
@@ -1452,6 +2276,25 @@ static void snd_rawmidi_proc_info_read(struct snd_info_entry *entry,
 					    (unsigned long) runtime->buffer_size,
 					    (unsigned long) runtime->avail,
 					    (unsigned long) runtime->xruns);
+				rcu_read_lock();
+				thru = rcu_dereference(runtime->thru);
+				if (thru) {
+					params = thru->params;
+					dest_sub = thru->dest.output->number;
+					forwarded = thru->forwarded;
+					dropped = thru->dropped;
+				}
+				rcu_read_unlock();
+				if (thru)
+					snd_iprintf(buffer,
+						    "  Thru         : %d,%d,%d\n"
+						    "  Thru filter  : 0x%x/0x%04x\n"
+						    "  Thru bytes   : %lu\n"
+						    "  Thru dropped : %lu\n",
+						    params.card, params.device,
+						    dest_sub, params.filter,
+						    params.channels,
+						    forwarded, dropped);
 			}
 		}
 	}
@@ -1471,6 +2314,7 @@ static const struct file_operations snd_rawmidi_f_ops =
 	.release =	snd_rawmidi_release,
 	.llseek =	no_llseek,
 	.poll =		snd_rawmidi_poll,
+	.mmap =		snd_rawmidi_mmap,
 	.unlocked_ioctl =	snd_rawmidi_ioctl,
 	.compat_ioctl =	snd_rawmidi_ioctl_compat,
 };
@@ -1487,6 +2331,11 @@ static int snd_rawmidi_alloc_substreams(struct snd_rawmidi *rmidi,
 		substream = kzalloc(sizeof(*substream), GFP_KERNEL);
 		if (!substream)
 			return -ENOMEM;
+		substream->stats = alloc_percpu(struct snd_rawmidi_stats);
+		if (!substream->stats) {
+			kfree(substream);
+			return -ENOMEM;
+		}
 		substream->stream = direction;
 		substream->number = idx;
 		substream->rmidi = rmidi;
@@ -1580,6 +2429,7 @@ static void snd_rawmidi_free_substreams(struct snd_rawmidi_str *stream)
 	while (!list_empty(&stream->substreams)) {
 		substream = list_entry(stream->substreams.next, struct snd_rawmidi_substream, list);
 		list_del(&substream->list);
+		free_percpu(substream->stats);
 		kfree(substream);
 	}
 }
@@ -1709,6 +2559,7 @@ static int snd_rawmidi_dev_disconnect(struct snd_device *device)
 	struct snd_rawmidi *rmidi = device->device_data;
 	int dir;
 
+	rawmidi_thru_disconnect(rmidi);
 	mutex_lock(&register_mutex);
 	mutex_lock(&rmidi->open_mutex);
 	wake_up(&rmidi->open_wait);
@@ -40,6 +40,10 @@ static int maxqlen = SNDRV_SEQ_OSS_MAX_QLEN;
 module_param(maxqlen, int, 0444);
 MODULE_PARM_DESC(maxqlen, "maximum queue length");
 
+static int maxwqlen = SNDRV_SEQ_OSS_MAX_WQLEN;
+module_param(maxwqlen, int, 0444);
+MODULE_PARM_DESC(maxwqlen, "maximum write queue length (events, up to 2000)");
+
 static int system_client = -1; /* ALSA sequencer client number */
 static int system_port = -1;
 
@@ -251,7 +255,8 @@ snd_seq_oss_open(struct file *file, int level)
 
 	/* initialize write queue */
 	if (is_write_mode(dp->file_mode)) {
-		dp->writeq = snd_seq_oss_writeq_new(dp, maxqlen);
+		dp->writeq = snd_seq_oss_writeq_new(dp,
+				clamp(maxwqlen, 2, SNDRV_SEQ_MAX_EVENTS));
 		if (!dp->writeq) {
 			rc = -ENOMEM;
 			goto _error;
@@ -510,6 +515,9 @@ snd_seq_oss_system_info_read(struct snd_info_buffer *buf)
 			snd_iprintf(buf, "  timer tempo = %d, timebase = %d\n",
 				    dp->timer->oss_tempo, dp->timer->oss_timebase);
 		snd_iprintf(buf, "  max queue length %d\n", maxqlen);
+		if (is_write_mode(dp->file_mode) && dp->writeq)
+			snd_iprintf(buf, "  write queue length %d\n",
+				    dp->writeq->maxlen);
 		if (is_read_mode(dp->file_mode) && dp->readq)
 			snd_seq_oss_readq_info_read(dp->readq, buf);
 	}
@@ -30,10 +30,27 @@
 #include "../seq_clientmgr.h"
 
 
+/*
+ * events translated within one write() call are collected here and
+ * passed to the sequencer core at once; a run is ended by a timing
+ * record, so all events of a batch normally share the same time stamp
+ */
+#define OSS_WRITE_BATCH		16
+
+struct seq_oss_write_batch {
+	int count;
+	int size[OSS_WRITE_BATCH];	/* record size of each event */
+	struct snd_seq_event ev[OSS_WRITE_BATCH];
+};
+
 /*
  * protoypes
  */
-static int insert_queue(struct seq_oss_devinfo *dp, union evrec *rec, struct file *opt);
+static int insert_queue(struct seq_oss_devinfo *dp, union evrec *rec,
+			int size, struct file *opt,
+			struct seq_oss_write_batch *batch, int *unsent);
+static int flush_queue(struct seq_oss_devinfo *dp, struct file *opt,
+		       struct seq_oss_write_batch *batch, int *unsent);
 
 
 /*
@@ -96,12 +113,18 @@ int
 snd_seq_oss_write(struct seq_oss_devinfo *dp, const char __user *buf, int count, struct file *opt)
 {
 	int result = 0, err = 0;
-	int ev_size, fmt;
+	int ev_size, fmt, unsent;
 	union evrec rec;
+	struct seq_oss_write_batch *batch;
 
 	if (! is_write_mode(dp->file_mode) || dp->writeq == NULL)
 		return -ENXIO;
 
+	batch = kmalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return -ENOMEM;
+	batch->count = 0;
+
 	while (count >= SHORT_EVENT_SIZE) {
 		if (copy_from_user(&rec, buf, SHORT_EVENT_SIZE)) {
 			err = -EFAULT;
@@ -113,6 +136,7 @@ snd_seq_oss_write(struct seq_oss_devinfo *dp, const char __user *buf, int count,
 				err = -EINVAL;
 				break;
 			}
+			kfree(batch);
 			fmt = (*(unsigned short *)rec.c) & 0xffff;
 			/* FIXME the return value isn't correct */
 			return snd_seq_oss_synth_load_patch(dp, rec.s.dev,
@@ -145,50 +169,122 @@ snd_seq_oss_write(struct seq_oss_devinfo *dp, const char __user *buf, int count,
 		}
 
 		/* insert queue */
-		if ((err = insert_queue(dp, &rec, opt)) < 0)
+		result += ev_size;
+		err = insert_queue(dp, &rec, ev_size, opt, batch, &unsent);
+		if (err < 0) {
+			result -= unsent;
 			break;
+		}
 
-		result += ev_size;
 		buf += ev_size;
 		count -= ev_size;
 	}
+
+	/* the events still in the batch were already accounted */
+	if (flush_queue(dp, opt, batch, &unsent) < 0)
+		result -= unsent;
+	kfree(batch);
 	return result > 0 ? result : err;
 }
 
 
+/*
+ * pass the collected events to the sequencer core
+ * return: 0 = OK, negative = error; the record bytes of the events
+ * that could not be enqueued are stored in *unsent
+ */
+static int
+flush_queue(struct seq_oss_devinfo *dp, struct file *opt,
+	    struct seq_oss_write_batch *batch, int *unsent)
+{
+	int done = 0, rc = 0;
+
+	*unsent = 0;
+	while (done < batch->count) {
+		rc = snd_seq_kernel_client_enqueue_batch(dp->cseq,
+							 batch->ev + done,
+							 batch->count - done,
+							 opt,
+							 !is_nonblock_mode(dp->file_mode));
+		if (rc < 0)
+			break;
+		done += rc;
+	}
+	for (; done < batch->count; done++)
+		*unsent += batch->size[done];
+	batch->count = 0;
+	return rc < 0 ? rc : 0;
+}
+
+
 /*
  * insert event record to write queue
- * return: 0 = OK, non-zero = NG
+ * return: 0 = OK, non-zero = NG; on error, the record bytes that were
+ * not queued (including this record) are stored in *unsent
  */
 static int
-insert_queue(struct seq_oss_devinfo *dp, union evrec *rec, struct file *opt)
+insert_queue(struct seq_oss_devinfo *dp, union evrec *rec, int size,
+	     struct file *opt, struct seq_oss_write_batch *batch, int *unsent)
 {
 	int rc = 0;
-	struct snd_seq_event event;
+	struct snd_seq_event *event;
+
+	*unsent = 0;
+
+	/* a timing record ends the run of events with the same time */
+	if (rec->s.code == SEQ_WAIT || rec->t.code == EV_TIMING) {
+		rc = flush_queue(dp, opt, batch, unsent);
+		if (rc < 0) {
+			*unsent += size;
+			return rc;
+		}
+	}
 
 	/* if this is a timing event, process the current time */
 	if (snd_seq_oss_process_timer_event(dp->timer, rec))
 		return 0; /* no need to insert queue */
 
 	/* parse this event */
-	memset(&event, 0, sizeof(event));
+	event = &batch->ev[batch->count];
+	memset(event, 0, sizeof(*event));
 	/* set dummy -- to be sure */
-	event.type = SNDRV_SEQ_EVENT_NOTEOFF;
-	snd_seq_oss_fill_addr(dp, &event, dp->addr.port, dp->addr.client);
+	event->type = SNDRV_SEQ_EVENT_NOTEOFF;
+	snd_seq_oss_fill_addr(dp, event, dp->addr.port, dp->addr.client);
 
-	if (snd_seq_oss_process_event(dp, rec, &event))
+	if (snd_seq_oss_process_event(dp, rec, event))
 		return 0; /* invalid event - no need to insert queue */
 
-	event.time.tick = snd_seq_oss_timer_cur_tick(dp->timer);
-	if (dp->timer->realtime || !dp->timer->running) {
-		snd_seq_oss_dispatch(dp, &event, 0, 0);
-	} else {
+	event->time.tick = snd_seq_oss_timer_cur_tick(dp->timer);
+	if (dp->timer->realtime || !dp->timer->running ||
+	    snd_seq_ev_is_variable(event)) {
+		/* keep the order with the events collected so far; a
+		 * variable-length event points to the per-device sysex
+		 * buffer, so it has to leave before the next one is parsed
+		 */
+		struct snd_seq_event ev = *event;
+
+		rc = flush_queue(dp, opt, batch, unsent);
+		if (rc < 0) {
+			*unsent += size;
+			return rc;
+		}
+		if (dp->timer->realtime || !dp->timer->running) {
+			snd_seq_oss_dispatch(dp, &ev, 0, 0);
+			return 0;
+		}
 		if (is_nonblock_mode(dp->file_mode))
-			rc = snd_seq_kernel_client_enqueue(dp->cseq, &event, 0, 0);
+			rc = snd_seq_kernel_client_enqueue(dp->cseq, &ev, 0, 0);
 		else
-			rc = snd_seq_kernel_client_enqueue_blocking(dp->cseq, &event, opt, 0, 0);
+			rc = snd_seq_kernel_client_enqueue_blocking(dp->cseq, &ev, opt, 0, 0);
+		if (rc < 0)
+			*unsent = size;
+		return rc;
 	}
-	return rc;
+
+	batch->size[batch->count++] = size;
+	if (batch->count == OSS_WRITE_BATCH)
+		return flush_queue(dp, opt, batch, unsent);
+	return 0;
 }
 		
 
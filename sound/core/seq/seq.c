@@ -53,6 +53,10 @@ int seq_default_timer_device =
 	;
 int seq_default_timer_subdevice = 0;
 int seq_default_timer_resolution = 0;	/* Hz */
+bool seq_default_timer_tickless;
+bool seq_default_queue_kthread;
+int seq_default_queue_cpu = -1;
+int seq_default_queue_rt_prio = SNDRV_RT_PRIO;
 
 MODULE_AUTHOR("Frank van de Pol <fvdpol@coil.demon.nl>, Jaroslav Kysela <perex@perex.cz>");
 MODULE_DESCRIPTION("Advanced Linux Sound Architecture sequencer.");
@@ -72,6 +76,14 @@ module_param(seq_default_timer_subdevice, int, 0644);
 MODULE_PARM_DESC(seq_default_timer_subdevice, "The default timer subdevice number.");
 module_param(seq_default_timer_resolution, int, 0644);
 MODULE_PARM_DESC(seq_default_timer_resolution, "The default timer resolution in Hz.");
+module_param(seq_default_timer_tickless, bool, 0644);
+MODULE_PARM_DESC(seq_default_timer_tickless, "Wake up the queues only at the next event time.");
+module_param(seq_default_queue_kthread, bool, 0644);
+MODULE_PARM_DESC(seq_default_queue_kthread, "Dispatch the queue events in a kthread per queue.");
+module_param(seq_default_queue_cpu, int, 0644);
+MODULE_PARM_DESC(seq_default_queue_cpu, "The default CPU of the queue kthreads (-1 = any).");
+module_param(seq_default_queue_rt_prio, int, 0644);
+MODULE_PARM_DESC(seq_default_queue_rt_prio, "The default SCHED_FIFO priority of the queue kthreads.");
 
 MODULE_ALIAS_CHARDEV(CONFIG_SND_MAJOR, SNDRV_MINOR_SEQUENCER);
 MODULE_ALIAS("devname:snd/seq");
@@ -0,0 +1,662 @@
+/*
+ * ALSA sequencer latency and throughput benchmark
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/completion.h>
+#include <sound/core.h>
+#include <sound/info.h>
+#include "seq_clientmgr.h"
+#include <sound/initval.h>
+
+/*
+
+  Sequencer benchmark client
+
+  This client measures the scheduling latency and the throughput of the
+  sequencer core.  It owns one queue, one source port and a number of
+  sink ports.  The source port is routed through the ports of the
+  MIDI-through client (snd-seq-dummy, client 62), and every through port
+  is connected to every sink:
+
+	bench:0 -> 62:0 .. 62:(loops-1) -> bench:2 .. bench:(sinks+1)
+	bench:0 -> bench:1 (probe)
+
+  The source port is also connected directly to a probe port, which gets
+  each event when the queue timer takes it off the priority queue.  This
+  splits the latency into stages: the enqueue call, the wait in the
+  priority queue up to the timer dispatch, and the delivery through the
+  MIDI-through hop to the sinks.
+
+  A run schedules "events" USR0 events on the queue, "interval"
+  microseconds apart, either as real-time or as tick time-stamps.  Each
+  event is delivered loops * sinks times.  The sinks compare the arrival
+  time against the time the event was due, and the results are
+  collected in /proc/asound/seq/bench.  A run is started by writing
+  "run" to that file; the write returns once the run is finished.
+
+  The number of through ports is limited by the "ports" option of
+  snd-seq-dummy.  The sinks are kernel ports, so the latency covers the
+  queue timer, the priority queue and the delivery path, but not the
+  client FIFO of a user-space reader; there is no FIFO stage here.
+
+ */
+
+MODULE_DESCRIPTION("ALSA sequencer latency benchmark");
+MODULE_LICENSE("GPL");
+
+#define SEQ_BENCH_MAX_SINKS	16
+#define SEQ_BENCH_MAX_EVENTS	1000000
+#define SEQ_BENCH_LEAD_USEC	10000	/* delay before the first event */
+#define SEQ_BENCH_HIST_SLOTS	20	/* log2(usec) latency histogram */
+#define SEQ_BENCH_PPQ		96
+
+#define SEQ_BENCH_PROBE		((void *)1)	/* private_data of the probe */
+
+static int loops = 1;
+static int sinks = 1;
+static int events = 1000;
+static int interval = 1000;
+static bool tick;
+
+module_param(loops, int, 0444);
+MODULE_PARM_DESC(loops, "number of MIDI-through ports to route through");
+module_param(sinks, int, 0444);
+MODULE_PARM_DESC(sinks, "number of sink ports subscribed to each through port");
+module_param(events, int, 0644);
+MODULE_PARM_DESC(events, "number of events scheduled per run");
+module_param(interval, int, 0644);
+MODULE_PARM_DESC(interval, "interval between events in usec (0 = burst)");
+module_param(tick, bool, 0644);
+MODULE_PARM_DESC(tick, "schedule with tick instead of real-time time-stamps");
+
+struct seq_bench {
+	int client;
+	int queue;
+	int src_port;
+	int probe_port;
+	int sink_port[SEQ_BENCH_MAX_SINKS];
+	struct snd_info_entry *proc;
+
+	struct mutex run_mutex;		/* serializes runs and the proc read */
+	struct completion done;
+	atomic_t pending;		/* deliveries still expected */
+
+	spinlock_t lock;		/* protects the fields below */
+	unsigned int run_id;
+	ktime_t *due;			/* due time of each event */
+	ktime_t *probe_rx;		/* arrival of each event at the probe */
+	int nevents;
+	unsigned long received;
+	unsigned long dropped;		/* unknown or stale events */
+	u64 lat_min;
+	u64 lat_max;
+	u64 lat_sum;
+	ktime_t first_rx;
+	ktime_t last_rx;
+	unsigned long hist[SEQ_BENCH_HIST_SLOTS];
+
+	/* per-stage times: due -> probe, probe -> sink */
+	u64 prioq_sum;
+	u64 prioq_max;
+	unsigned long prioq_count;
+	u64 disp_sum;
+	u64 disp_max;
+	unsigned long disp_count;
+
+	/* enqueue statistics, only touched by the running thread */
+	u64 enq_sum;
+	u64 enq_max;
+	unsigned long enq_stalls;	/* pool full, had to block */
+	int result;
+	int last_events;
+	int last_interval;
+	bool last_tick;
+};
+
+static struct seq_bench *bench;
+
+static int bench_ctl(unsigned int cmd, void *arg)
+{
+	return snd_seq_kernel_client_ctl(bench->client, cmd, arg);
+}
+
+/*
+ * sink and probe callback: account the latency of a delivered event
+ */
+static int
+bench_input(struct snd_seq_event *ev, int direct, void *private_data,
+	    int atomic, int hop)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	unsigned int idx;
+	u64 lat, usec;
+	int slot;
+
+	if (ev->type != SNDRV_SEQ_EVENT_USR0)
+		return 0;
+
+	idx = ev->data.raw32.d[0];
+	spin_lock_irqsave(&bench->lock, flags);
+	if (!bench->due || ev->data.raw32.d[1] != bench->run_id ||
+	    idx >= bench->nevents) {
+		bench->dropped++;
+		spin_unlock_irqrestore(&bench->lock, flags);
+		return 0;
+	}
+	/* the due time is derived from the queue status and may be a bit
+	 * later than the real one; clamp such deliveries to zero
+	 */
+	if (ktime_before(now, bench->due[idx]))
+		lat = 0;
+	else
+		lat = ktime_to_ns(ktime_sub(now, bench->due[idx]));
+
+	if (private_data == SEQ_BENCH_PROBE) {
+		bench->probe_rx[idx] = now;
+		bench->prioq_sum += lat;
+		if (lat > bench->prioq_max)
+			bench->prioq_max = lat;
+		bench->prioq_count++;
+		goto unlock;
+	}
+	/* the probe is subscribed first, so it normally got the event */
+	if (bench->probe_rx[idx]) {
+		u64 disp = ktime_to_ns(ktime_sub(now, bench->probe_rx[idx]));
+
+		bench->disp_sum += disp;
+		if (disp > bench->disp_max)
+			bench->disp_max = disp;
+		bench->disp_count++;
+	}
+
+	if (!bench->received++) {
+		bench->first_rx = now;
+		bench->lat_min = lat;
+	}
+	bench->last_rx = now;
+	if (lat < bench->lat_min)
+		bench->lat_min = lat;
+	if (lat > bench->lat_max)
+		bench->lat_max = lat;
+	bench->lat_sum += lat;
+	usec = div_u64(lat, NSEC_PER_USEC);
+	slot = usec > U32_MAX ? SEQ_BENCH_HIST_SLOTS - 1 : fls((u32)usec);
+	if (slot >= SEQ_BENCH_HIST_SLOTS)
+		slot = SEQ_BENCH_HIST_SLOTS - 1;
+	bench->hist[slot]++;
+ unlock:
+	spin_unlock_irqrestore(&bench->lock, flags);
+
+	if (atomic_dec_and_test(&bench->pending))
+		complete(&bench->done);
+	return 0;
+}
+
+/*
+ * send a queue control event to the system timer port
+ */
+static int bench_queue_control(int type)
+{
+	struct snd_seq_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = type;
+	ev.source.client = bench->client;
+	ev.source.port = bench->src_port;
+	ev.dest.client = SNDRV_SEQ_CLIENT_SYSTEM;
+	ev.dest.port = SNDRV_SEQ_PORT_SYSTEM_TIMER;
+	ev.queue = bench->queue;
+	ev.data.queue.queue = bench->queue;
+	return snd_seq_kernel_client_dispatch(bench->client, &ev, 0, 0);
+}
+
+/*
+ * drop whatever is left on the queue after a run
+ */
+static void bench_flush_queue(void)
+{
+	struct snd_seq_remove_events info;
+
+	memset(&info, 0, sizeof(info));
+	info.remove_mode = SNDRV_SEQ_REMOVE_OUTPUT;
+	info.queue = bench->queue;
+	bench_ctl(SNDRV_SEQ_IOCTL_REMOVE_EVENTS, &info);
+}
+
+/*
+ * enqueue one event; time only the non-blocking attempt, so that pool
+ * stalls show up as a separate count instead of skewing the cost
+ */
+static int bench_enqueue(struct snd_seq_event *ev)
+{
+	ktime_t t0;
+	u64 cost;
+	int err;
+
+	t0 = ktime_get();
+	err = snd_seq_kernel_client_enqueue(bench->client, ev, 0, 0);
+	cost = ktime_to_ns(ktime_sub(ktime_get(), t0));
+	if (err == -EAGAIN || err == -ENOMEM) {
+		bench->enq_stalls++;
+		err = snd_seq_kernel_client_enqueue_blocking(bench->client, ev,
+							     NULL, 0, 0);
+	}
+	if (err < 0)
+		return err;
+	bench->enq_sum += cost;
+	if (cost > bench->enq_max)
+		bench->enq_max = cost;
+	return 0;
+}
+
+static int bench_run(void)
+{
+	struct snd_seq_queue_tempo tempo;
+	struct snd_seq_queue_status status;
+	struct snd_seq_event ev;
+	int nevents = events;
+	int period = interval;
+	bool use_tick = tick;
+	unsigned long deliveries, timeout;
+	unsigned int lead_ticks;
+	ktime_t *due, *probe_rx, k0;
+	long left;
+	u64 lead;
+	int i, nsec, err;
+
+	if (nevents < 1 || nevents > SEQ_BENCH_MAX_EVENTS ||
+	    period < 0 || period > USEC_PER_SEC)
+		return -EINVAL;
+	if (use_tick && !period)
+		return -EINVAL; /* one tick per interval */
+	nsec = period * NSEC_PER_USEC;
+
+	due = kvmalloc_array(nevents, sizeof(*due), GFP_KERNEL);
+	if (!due)
+		return -ENOMEM;
+	probe_rx = kvzalloc(nevents * sizeof(*probe_rx), GFP_KERNEL);
+	if (!probe_rx) {
+		kvfree(due);
+		return -ENOMEM;
+	}
+
+	/* in tick mode, let one tick last exactly one interval */
+	if (use_tick) {
+		memset(&tempo, 0, sizeof(tempo));
+		tempo.queue = bench->queue;
+		tempo.tempo = period * SEQ_BENCH_PPQ;
+		tempo.ppq = SEQ_BENCH_PPQ;
+		err = bench_ctl(SNDRV_SEQ_IOCTL_SET_QUEUE_TEMPO, &tempo);
+		if (err < 0)
+			goto out_free;
+	}
+
+	/* each event reaches the probe once and every sink via every loop */
+	deliveries = (unsigned long)nevents * (loops * sinks + 1);
+	spin_lock_irq(&bench->lock);
+	bench->run_id++;
+	bench->received = 0;
+	bench->dropped = 0;
+	bench->lat_min = 0;
+	bench->lat_max = 0;
+	bench->lat_sum = 0;
+	memset(bench->hist, 0, sizeof(bench->hist));
+	bench->prioq_sum = 0;
+	bench->prioq_max = 0;
+	bench->prioq_count = 0;
+	bench->disp_sum = 0;
+	bench->disp_max = 0;
+	bench->disp_count = 0;
+	spin_unlock_irq(&bench->lock);
+	bench->enq_sum = 0;
+	bench->enq_max = 0;
+	bench->enq_stalls = 0;
+	bench->last_events = nevents;
+	bench->last_interval = period;
+	bench->last_tick = use_tick;
+	atomic_set(&bench->pending, deliveries);
+	reinit_completion(&bench->done);
+
+	err = bench_queue_control(SNDRV_SEQ_EVENT_START);
+	if (err < 0)
+		goto out_free;
+	memset(&status, 0, sizeof(status));
+	status.queue = bench->queue;
+	err = bench_ctl(SNDRV_SEQ_IOCTL_GET_QUEUE_STATUS, &status);
+	k0 = ktime_get();
+	if (err < 0)
+		goto out_stop;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = SNDRV_SEQ_EVENT_USR0;
+	ev.flags = SNDRV_SEQ_EVENT_LENGTH_FIXED | SNDRV_SEQ_TIME_MODE_ABS;
+	ev.flags |= use_tick ? SNDRV_SEQ_TIME_STAMP_TICK :
+		SNDRV_SEQ_TIME_STAMP_REAL;
+	ev.queue = bench->queue;
+	ev.source.port = bench->src_port;
+	ev.dest.client = SNDRV_SEQ_ADDRESS_SUBSCRIBERS;
+	ev.data.raw32.d[1] = bench->run_id;
+
+	/* the due times are fixed before anything is queued, so that the
+	 * sinks may already look them up while the rest is enqueued
+	 */
+	lead_ticks = use_tick ? DIV_ROUND_UP(SEQ_BENCH_LEAD_USEC, period) : 0;
+	for (i = 0; i < nevents; i++) {
+		if (use_tick)
+			lead = (u64)(lead_ticks + i) * nsec;
+		else
+			lead = (u64)SEQ_BENCH_LEAD_USEC * NSEC_PER_USEC +
+				(u64)i * nsec;
+		due[i] = ktime_add_ns(k0, lead);
+	}
+
+	spin_lock_irq(&bench->lock);
+	bench->due = due;
+	bench->probe_rx = probe_rx;
+	bench->nevents = nevents;
+	spin_unlock_irq(&bench->lock);
+
+	for (i = 0; i < nevents; i++) {
+		ev.data.raw32.d[0] = i;
+		if (use_tick) {
+			ev.time.tick = status.tick + lead_ticks + i;
+		} else {
+			lead = ktime_to_ns(ktime_sub(due[i], k0)) +
+				status.time.tv_nsec;
+			ev.time.time.tv_sec = status.time.tv_sec +
+				div_u64_rem(lead, NSEC_PER_SEC,
+					    &ev.time.time.tv_nsec);
+		}
+		err = bench_enqueue(&ev);
+		if (err < 0)
+			goto out_stop;
+	}
+
+	timeout = msecs_to_jiffies(SEQ_BENCH_LEAD_USEC / USEC_PER_MSEC +
+				   div_u64((u64)nevents * period,
+					   USEC_PER_MSEC) + 5000);
+	left = wait_for_completion_interruptible_timeout(&bench->done, timeout);
+	if (!left)
+		err = -ETIMEDOUT;
+	else if (left < 0)
+		err = left;
+
+ out_stop:
+	bench_queue_control(SNDRV_SEQ_EVENT_STOP);
+	bench_flush_queue();
+	spin_lock_irq(&bench->lock);
+	bench->due = NULL;
+	bench->probe_rx = NULL;
+	bench->nevents = 0;
+	spin_unlock_irq(&bench->lock);
+ out_free:
+	kvfree(probe_rx);
+	kvfree(due);
+	bench->result = err;
+	return err;
+}
+
+/*
+ * proc interface
+ */
+static void bench_proc_read(struct snd_info_entry *entry,
+			    struct snd_info_buffer *buffer)
+{
+	unsigned long received, span;
+	u64 avg = 0, rate = 0;
+	int i;
+
+	mutex_lock(&bench->run_mutex);
+	snd_iprintf(buffer, "client %d, queue %d, %d loop(s), %d sink(s)\n",
+		    bench->client, bench->queue, loops, sinks);
+	if (!bench->last_events) {
+		snd_iprintf(buffer, "no run yet, write \"run\" to start\n");
+		goto unlock;
+	}
+
+	received = bench->received;
+	snd_iprintf(buffer, "last run: %d events, %d us interval, %s, result %d\n",
+		    bench->last_events, bench->last_interval,
+		    bench->last_tick ? "tick" : "real-time", bench->result);
+	snd_iprintf(buffer, "deliveries: %lu received, %lu dropped\n",
+		    received, bench->dropped);
+	if (received) {
+		avg = div_u64(bench->lat_sum, received);
+		span = ktime_to_ns(ktime_sub(bench->last_rx, bench->first_rx));
+		if (span)
+			rate = div_u64((u64)(received - 1) * NSEC_PER_SEC, span);
+	}
+	snd_iprintf(buffer, "latency (ns): min %llu, avg %llu, max %llu\n",
+		    bench->lat_min, avg, bench->lat_max);
+	snd_iprintf(buffer, "delivery rate: %llu events/s\n", rate);
+	snd_iprintf(buffer, "enqueue (ns): avg %llu, max %llu, %lu pool stalls\n",
+		    div_u64(bench->enq_sum, bench->last_events),
+		    bench->enq_max, bench->enq_stalls);
+	snd_iprintf(buffer, "prioq to dispatch (ns): avg %llu, max %llu\n",
+		    bench->prioq_count ?
+		    div_u64(bench->prioq_sum, bench->prioq_count) : 0,
+		    bench->prioq_max);
+	snd_iprintf(buffer, "dispatch to sink (ns): avg %llu, max %llu\n",
+		    bench->disp_count ?
+		    div_u64(bench->disp_sum, bench->disp_count) : 0,
+		    bench->disp_max);
+	snd_iprintf(buffer, "latency histogram:\n");
+	for (i = 0; i < SEQ_BENCH_HIST_SLOTS; i++) {
+		if (!bench->hist[i])
+			continue;
+		if (i == SEQ_BENCH_HIST_SLOTS - 1)
+			snd_iprintf(buffer, "  >= %8u us: %lu\n",
+				    1U << (i - 1), bench->hist[i]);
+		else
+			snd_iprintf(buffer, "   < %8u us: %lu\n",
+				    1U << i, bench->hist[i]);
+	}
+ unlock:
+	mutex_unlock(&bench->run_mutex);
+}
+
+static void bench_proc_write(struct snd_info_entry *entry,
+			     struct snd_info_buffer *buffer)
+{
+	char line[64];
+
+	while (!snd_info_get_line(buffer, line, sizeof(line))) {
+		if (strcmp(line, "run"))
+			continue;
+		mutex_lock(&bench->run_mutex);
+		bench_run();
+		mutex_unlock(&bench->run_mutex);
+	}
+}
+
+/*
+ * client setup
+ */
+static int __init bench_create_port(const char *name, unsigned int caps,
+				    bool sink, void *private_data)
+{
+	struct snd_seq_port_info pinfo;
+	struct snd_seq_port_callback pcb;
+	int err;
+
+	memset(&pinfo, 0, sizeof(pinfo));
+	pinfo.addr.client = bench->client;
+	strlcpy(pinfo.name, name, sizeof(pinfo.name));
+	pinfo.capability = caps;
+	pinfo.type = SNDRV_SEQ_PORT_TYPE_SOFTWARE | SNDRV_SEQ_PORT_TYPE_PORT;
+	if (sink) {
+		/* no owner; otherwise the module could never be removed */
+		memset(&pcb, 0, sizeof(pcb));
+		pcb.event_input = bench_input;
+		pcb.private_data = private_data;
+		pinfo.kernel = &pcb;
+	}
+	err = bench_ctl(SNDRV_SEQ_IOCTL_CREATE_PORT, &pinfo);
+	if (err < 0)
+		return err;
+	return pinfo.addr.port;
+}
+
+static int __init bench_subscribe(int sclient, int sport, int dclient,
+				  int dport)
+{
+	struct snd_seq_port_subscribe subs;
+
+	memset(&subs, 0, sizeof(subs));
+	subs.sender.client = sclient;
+	subs.sender.port = sport;
+	subs.dest.client = dclient;
+	subs.dest.port = dport;
+	return bench_ctl(SNDRV_SEQ_IOCTL_SUBSCRIBE_PORT, &subs);
+}
+
+static int __init bench_setup(void)
+{
+	struct snd_seq_client_pool pool;
+	struct snd_seq_queue_info qinfo;
+	char name[32];
+	int i, j, err;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.client = bench->client;
+	pool.output_pool = SNDRV_SEQ_MAX_EVENTS;
+	err = bench_ctl(SNDRV_SEQ_IOCTL_SET_CLIENT_POOL, &pool);
+	if (err < 0)
+		return err;
+
+	memset(&qinfo, 0, sizeof(qinfo));
+	qinfo.owner = bench->client;
+	qinfo.locked = 1;
+	strcpy(qinfo.name, "Sequencer Benchmark");
+	err = bench_ctl(SNDRV_SEQ_IOCTL_CREATE_QUEUE, &qinfo);
+	if (err < 0)
+		return err;
+	bench->queue = qinfo.queue;
+
+	err = bench_create_port("Bench Source", SNDRV_SEQ_PORT_CAP_READ |
+				SNDRV_SEQ_PORT_CAP_SUBS_READ, false, NULL);
+	if (err < 0)
+		return err;
+	bench->src_port = err;
+
+	err = bench_create_port("Bench Probe", SNDRV_SEQ_PORT_CAP_WRITE |
+				SNDRV_SEQ_PORT_CAP_SUBS_WRITE, true,
+				SEQ_BENCH_PROBE);
+	if (err < 0)
+		return err;
+	bench->probe_port = err;
+	/* first subscriber, so that it sees the events before the loops */
+	err = bench_subscribe(bench->client, bench->src_port, bench->client,
+			      bench->probe_port);
+	if (err < 0)
+		return err;
+
+	for (i = 0; i < sinks; i++) {
+		sprintf(name, "Bench Sink-%d", i);
+		err = bench_create_port(name, SNDRV_SEQ_PORT_CAP_WRITE |
+					SNDRV_SEQ_PORT_CAP_SUBS_WRITE, true, NULL);
+		if (err < 0)
+			return err;
+		bench->sink_port[i] = err;
+	}
+
+	for (i = 0; i < loops; i++) {
+		err = bench_subscribe(bench->client, bench->src_port,
+				      SNDRV_SEQ_CLIENT_DUMMY, i);
+		if (err < 0) {
+			pr_err("ALSA: seq_bench: cannot connect to %d:%d (%d)\n",
+			       SNDRV_SEQ_CLIENT_DUMMY, i, err);
+			return err;
+		}
+		for (j = 0; j < sinks; j++) {
+			err = bench_subscribe(SNDRV_SEQ_CLIENT_DUMMY, i,
+					      bench->client,
+					      bench->sink_port[j]);
+			if (err < 0)
+				return err;
+		}
+	}
+	return 0;
+}
+
+static int __init alsa_seq_bench_init(void)
+{
+	struct snd_info_entry *entry;
+	int err;
+
+	if (loops < 1 || sinks < 1 || sinks > SEQ_BENCH_MAX_SINKS) {
+		pr_err("ALSA: seq_bench: invalid loops %d or sinks %d\n",
+		       loops, sinks);
+		return -EINVAL;
+	}
+
+	bench = kzalloc(sizeof(*bench), GFP_KERNEL);
+	if (!bench)
+		return -ENOMEM;
+	mutex_init(&bench->run_mutex);
+	init_completion(&bench->done);
+	spin_lock_init(&bench->lock);
+
+	request_module("snd-seq-dummy");
+
+	bench->client = snd_seq_create_kernel_client(NULL, -1, "Benchmark");
+	if (bench->client < 0) {
+		err = bench->client;
+		goto error_free;
+	}
+	err = bench_setup();
+	if (err < 0)
+		goto error_client;
+
+	entry = snd_info_create_module_entry(THIS_MODULE, "bench",
+					     snd_seq_root);
+	if (!entry) {
+		err = -ENOMEM;
+		goto error_client;
+	}
+	entry->content = SNDRV_INFO_CONTENT_TEXT;
+	entry->c.text.read = bench_proc_read;
+	entry->c.text.write = bench_proc_write;
+	entry->mode |= S_IWUSR;
+	err = snd_info_register(entry);
+	if (err < 0) {
+		snd_info_free_entry(entry);
+		goto error_client;
+	}
+	bench->proc = entry;
+	return 0;
+
+ error_client:
+	snd_seq_delete_kernel_client(bench->client);
+ error_free:
+	kfree(bench);
+	return err;
+}
+
+static void __exit alsa_seq_bench_exit(void)
+{
+	snd_info_free_entry(bench->proc);
+	snd_seq_delete_kernel_client(bench->client);
+	kfree(bench);
+}
+
+module_init(alsa_seq_bench_init)
+module_exit(alsa_seq_bench_exit)
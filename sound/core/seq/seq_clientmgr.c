@@ -69,10 +69,10 @@ static DEFINE_SPINLOCK(clients_lock);
 static DEFINE_MUTEX(register_mutex);
 
 /*
- * client table
+ * client table; modified under clients_lock, looked up under RCU
  */
 static char clienttablock[SNDRV_SEQ_MAX_CLIENTS];
-static struct snd_seq_client *clienttab[SNDRV_SEQ_MAX_CLIENTS];
+static struct snd_seq_client __rcu *clienttab[SNDRV_SEQ_MAX_CLIENTS];
 static struct snd_seq_usage client_usage;
 
 /*
@@ -104,7 +104,9 @@ static inline int snd_seq_write_pool_allocated(struct snd_seq_client *client)
 	return snd_seq_total_cells(client->pool) > 0;
 }
 
-/* return pointer to client structure for specified id */
+/* return pointer to client structure for specified id;
+ * no reference is taken, so the caller must own the client
+ */
 static struct snd_seq_client *clientptr(int clientid)
 {
 	if (clientid < 0 || clientid >= SNDRV_SEQ_MAX_CLIENTS) {
@@ -112,12 +114,26 @@ static struct snd_seq_client *clientptr(int clientid)
 			   clientid);
 		return NULL;
 	}
-	return clienttab[clientid];
+	return rcu_dereference_raw(clienttab[clientid]);
+}
+
+/* look up the client and take the use lock, without the global lock;
+ * seq_free_client1() waits for a grace period before syncing the use lock
+ */
+static struct snd_seq_client *client_use_ptr_rcu(int clientid)
+{
+	struct snd_seq_client *client;
+
+	rcu_read_lock();
+	client = rcu_dereference(clienttab[clientid]);
+	if (client)
+		snd_use_lock_use(&client->use_lock);
+	rcu_read_unlock();
+	return client;
 }
 
 struct snd_seq_client *snd_seq_client_use_ptr(int clientid)
 {
-	unsigned long flags;
 	struct snd_seq_client *client;
 
 	if (clientid < 0 || clientid >= SNDRV_SEQ_MAX_CLIENTS) {
@@ -125,15 +141,11 @@ struct snd_seq_client *snd_seq_client_use_ptr(int clientid)
 			   clientid);
 		return NULL;
 	}
-	spin_lock_irqsave(&clients_lock, flags);
-	client = clientptr(clientid);
+	client = client_use_ptr_rcu(clientid);
 	if (client)
-		goto __lock;
-	if (clienttablock[clientid]) {
-		spin_unlock_irqrestore(&clients_lock, flags);
+		return client;
+	if (READ_ONCE(clienttablock[clientid]))
 		return NULL;
-	}
-	spin_unlock_irqrestore(&clients_lock, flags);
 #ifdef CONFIG_MODULES
 	if (!in_interrupt()) {
 		static char client_requested[SNDRV_SEQ_GLOBAL_CLIENTS];
@@ -164,19 +176,10 @@ struct snd_seq_client *snd_seq_client_use_ptr(int clientid)
 				snd_seq_device_load_drivers();
 			}
 		}
-		spin_lock_irqsave(&clients_lock, flags);
-		client = clientptr(clientid);
-		if (client)
-			goto __lock;
-		spin_unlock_irqrestore(&clients_lock, flags);
+		return client_use_ptr_rcu(clientid);
 	}
 #endif
 	return NULL;
-
-      __lock:
-	snd_use_lock_use(&client->use_lock);
-	spin_unlock_irqrestore(&clients_lock, flags);
-	return client;
 }
 
 static void usage_alloc(struct snd_seq_usage *res, int num)
@@ -221,6 +224,7 @@ static struct snd_seq_client *seq_create_client1(int client_index, int poolsize)
 	rwlock_init(&client->ports_lock);
 	mutex_init(&client->ports_mutex);
 	INIT_LIST_HEAD(&client->ports_list_head);
+	idr_init(&client->ports_idr);
 
 	/* find free slot in the client table */
 	spin_lock_irqsave(&clients_lock, flags);
@@ -228,15 +232,18 @@ static struct snd_seq_client *seq_create_client1(int client_index, int poolsize)
 		for (c = SNDRV_SEQ_DYNAMIC_CLIENTS_BEGIN;
 		     c < SNDRV_SEQ_MAX_CLIENTS;
 		     c++) {
-			if (clienttab[c] || clienttablock[c])
+			if (rcu_access_pointer(clienttab[c]) || clienttablock[c])
 				continue;
-			clienttab[client->number = c] = client;
+			client->number = c;
+			rcu_assign_pointer(clienttab[c], client);
 			spin_unlock_irqrestore(&clients_lock, flags);
 			return client;
 		}
 	} else {
-		if (clienttab[client_index] == NULL && !clienttablock[client_index]) {
-			clienttab[client->number = client_index] = client;
+		if (!rcu_access_pointer(clienttab[client_index]) &&
+		    !clienttablock[client_index]) {
+			client->number = client_index;
+			rcu_assign_pointer(clienttab[client_index], client);
 			spin_unlock_irqrestore(&clients_lock, flags);
 			return client;
 		}
@@ -258,8 +265,10 @@ static int seq_free_client1(struct snd_seq_client *client)
 	snd_seq_queue_client_leave(client->number);
 	spin_lock_irqsave(&clients_lock, flags);
 	clienttablock[client->number] = 1;
-	clienttab[client->number] = NULL;
+	RCU_INIT_POINTER(clienttab[client->number], NULL);
 	spin_unlock_irqrestore(&clients_lock, flags);
+	/* no new reference can be taken after the readers in flight */
+	synchronize_rcu();
 	snd_use_lock_sync(&client->use_lock);
 	snd_seq_queue_client_termination(client->number);
 	if (client->pool)
@@ -627,8 +636,13 @@ static int snd_seq_deliver_single_event(struct snd_seq_client *client,
 	}
 
   __skip:
-	if (dest_port)
+	if (dest_port) {
+		if (result < 0)
+			this_cpu_inc(dest_port->stats->rx_errors);
+		else
+			this_cpu_inc(dest_port->stats->rx);
 		snd_seq_port_unlock(dest_port);
+	}
 	if (dest)
 		snd_seq_client_unlock(dest);
 
@@ -648,9 +662,10 @@ static int deliver_to_subscribers(struct snd_seq_client *client,
 {
 	struct snd_seq_subscribers *subs;
 	int err, result = 0, num_ev = 0;
-	struct snd_seq_event event_saved;
+	struct snd_seq_event event_saved, event_orig;
 	struct snd_seq_client_port *src_port;
 	struct snd_seq_port_subs_info *grp;
+	bool shared = false;
 
 	src_port = snd_seq_port_use_ptr(client, event->source.port);
 	if (src_port == NULL)
@@ -658,6 +673,14 @@ static int deliver_to_subscribers(struct snd_seq_client *client,
 	/* save original event record */
 	event_saved = *event;
 	grp = &src_port->c_src;
+
+	/* copy the variable length data only once for all subscribers */
+	if (snd_seq_ev_is_variable(event) && grp->count > 1 &&
+	    !snd_seq_event_share(event, atomic)) {
+		shared = true;
+		event_orig = event_saved;
+		event_saved = *event;
+	}
 	
 	/* lock list */
 	if (atomic)
@@ -689,7 +712,12 @@ static int deliver_to_subscribers(struct snd_seq_client *client,
 		read_unlock(&grp->list_lock);
 	else
 		up_read(&grp->list_mutex);
+	if (shared) {
+		snd_seq_event_unshare(&event_saved);
+		event_saved = event_orig;
+	}
 	*event = event_saved; /* restore */
+	this_cpu_add(src_port->stats->tx, num_ev);
 	snd_seq_port_unlock(src_port);
 	return (result < 0) ? result : num_ev;
 }
@@ -901,11 +929,14 @@ int snd_seq_dispatch_event(struct snd_seq_event_cell *cell, int atomic, int hop)
 /* Allocate a cell from client pool and enqueue it to queue:
  * if pool is empty and blocking is TRUE, sleep until a new cell is
  * available.
+ * If pending is given, the dispatch of the queue is deferred and the
+ * queue is marked in the pending bitmap instead.
  */
 static int snd_seq_client_enqueue_event(struct snd_seq_client *client,
 					struct snd_seq_event *event,
 					struct file *file, int blocking,
-					int atomic, int hop)
+					int atomic, int hop,
+					unsigned long *pending)
 {
 	struct snd_seq_event_cell *cell;
 	int err;
@@ -933,6 +964,9 @@ static int snd_seq_client_enqueue_event(struct snd_seq_client *client,
 	if (snd_seq_ev_is_direct(event)) {
 		if (event->type == SNDRV_SEQ_EVENT_NOTE)
 			return -EINVAL; /* this event must be enqueued! */
+		/* keep the order against the events queued so far */
+		if (pending)
+			snd_seq_check_queues(pending, atomic, hop);
 		return snd_seq_deliver_event(client, event, atomic, hop);
 	}
 
@@ -948,7 +982,11 @@ static int snd_seq_client_enqueue_event(struct snd_seq_client *client,
 		return err;
 
 	/* we got a cell. enqueue it. */
-	if ((err = snd_seq_enqueue_event(cell, atomic, hop)) < 0) {
+	if (pending)
+		err = snd_seq_enqueue_event_deferred(cell, pending);
+	else
+		err = snd_seq_enqueue_event(cell, atomic, hop);
+	if (err < 0) {
 		snd_seq_cell_free(cell);
 		return err;
 	}
@@ -1064,7 +1102,7 @@ static ssize_t snd_seq_write(struct file *file, const char __user *buf,
 		/* ok, enqueue it */
 		err = snd_seq_client_enqueue_event(client, &event, file,
 						   !(file->f_flags & O_NONBLOCK),
-						   0, 0);
+						   0, 0, NULL);
 		if (err < 0)
 			break;
 
@@ -1079,6 +1117,146 @@ static ssize_t snd_seq_write(struct file *file, const char __user *buf,
 }
 
 
+/* number of events copied from/to user space at once in batch ioctls */
+#define SEQ_BATCH_CHUNK		64
+
+/* SNDRV_SEQ_IOCTL_WRITE_BATCH: like write() with fixed length events,
+ * but the queues are dispatched only once per batch
+ */
+static int snd_seq_ioctl_write_batch(struct file *file,
+				     struct snd_seq_event_batch __user *arg)
+{
+	struct snd_seq_client *client = file->private_data;
+	DECLARE_BITMAP(pending, SNDRV_SEQ_MAX_QUEUES);
+	struct snd_seq_event_batch batch;
+	struct snd_seq_event __user *ptr;
+	struct snd_seq_event *evbuf, *ev;
+	int i, n, err = 0;
+
+	if (!(snd_seq_file_flags(file) & SNDRV_SEQ_LFLG_OUTPUT))
+		return -ENXIO;
+	if (!client->accept_output || client->pool == NULL)
+		return -ENXIO;
+	if (copy_from_user(&batch, arg, sizeof(batch)))
+		return -EFAULT;
+	ptr = u64_to_user_ptr(batch.events);
+	batch.done = 0;
+
+	/* allocate the pool now if the pool is not allocated yet */
+	if (client->pool->size > 0 && !snd_seq_write_pool_allocated(client)) {
+		if (snd_seq_pool_init(client->pool) < 0)
+			return -ENOMEM;
+	}
+
+	evbuf = kmalloc_array(SEQ_BATCH_CHUNK, sizeof(*evbuf), GFP_KERNEL);
+	if (!evbuf)
+		return -ENOMEM;
+	bitmap_zero(pending, SNDRV_SEQ_MAX_QUEUES);
+
+	while (batch.done < batch.count) {
+		n = min_t(unsigned int, batch.count - batch.done,
+			  SEQ_BATCH_CHUNK);
+		if (copy_from_user(evbuf, ptr + batch.done,
+				   n * sizeof(*evbuf))) {
+			err = -EFAULT;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			ev = &evbuf[i];
+			ev->source.client = client->number;
+			if (snd_seq_ev_length_type(ev) != SNDRV_SEQ_EVENT_LENGTH_FIXED ||
+			    check_event_type_and_length(ev) ||
+			    snd_seq_ev_is_reserved(ev)) {
+				err = -EINVAL;
+				goto out;
+			}
+			if (ev->type != SNDRV_SEQ_EVENT_NONE) {
+				err = snd_seq_client_enqueue_event(client, ev, file,
+								   !(file->f_flags & O_NONBLOCK),
+								   0, 0, pending);
+				if (err < 0)
+					goto out;
+			}
+			batch.done++;
+		}
+	}
+
+ out:
+	snd_seq_check_queues(pending, 0, 0);
+	kfree(evbuf);
+	if (put_user(batch.done, &arg->done))
+		return -EFAULT;
+	return batch.done ? 0 : err;
+}
+
+/* SNDRV_SEQ_IOCTL_READ_BATCH: like read(), but dequeues the fixed length
+ * events in chunks; the batch ends before a variable length event, which
+ * has to be read via read()
+ */
+static int snd_seq_ioctl_read_batch(struct file *file,
+				    struct snd_seq_event_batch __user *arg)
+{
+	struct snd_seq_client *client = file->private_data;
+	struct snd_seq_event_cell *cells[SEQ_BATCH_CHUNK];
+	struct snd_seq_event_batch batch;
+	struct snd_seq_event __user *ptr;
+	struct snd_seq_event *evbuf;
+	struct snd_seq_fifo *fifo;
+	int i, n, nonblock, err = 0;
+
+	if (!(snd_seq_file_flags(file) & SNDRV_SEQ_LFLG_INPUT))
+		return -ENXIO;
+	if (!client->accept_input || (fifo = client->data.user.fifo) == NULL)
+		return -ENXIO;
+	if (copy_from_user(&batch, arg, sizeof(batch)))
+		return -EFAULT;
+	ptr = u64_to_user_ptr(batch.events);
+	batch.done = 0;
+
+	if (atomic_read(&fifo->overflow) > 0) {
+		/* buffer overflow is detected */
+		snd_seq_fifo_clear(fifo);
+		/* return error code */
+		return -ENOSPC;
+	}
+
+	evbuf = kmalloc_array(SEQ_BATCH_CHUNK, sizeof(*evbuf), GFP_KERNEL);
+	if (!evbuf)
+		return -ENOMEM;
+
+	snd_seq_fifo_lock(fifo);
+	while (batch.done < batch.count) {
+		nonblock = (file->f_flags & O_NONBLOCK) || batch.done > 0;
+		n = min_t(unsigned int, batch.count - batch.done,
+			  SEQ_BATCH_CHUNK);
+		n = snd_seq_fifo_cells_out(fifo, cells, n, nonblock);
+		if (n < 0) {
+			err = n;
+			break;
+		}
+		for (i = 0; i < n; i++)
+			evbuf[i] = cells[i]->event;
+		if (copy_to_user(ptr + batch.done, evbuf, n * sizeof(*evbuf))) {
+			while (n-- > 0)
+				snd_seq_fifo_cell_putback(fifo, cells[n]);
+			err = -EFAULT;
+			break;
+		}
+		for (i = 0; i < n; i++)
+			snd_seq_cell_free(cells[i]);
+		batch.done += n;
+	}
+	snd_seq_fifo_unlock(fifo);
+	kfree(evbuf);
+
+	if (put_user(batch.done, &arg->done))
+		return -EFAULT;
+	if (batch.done)
+		return 0;
+	return err;
+}
+
+
 /*
  * handle polling
  */
@@ -1266,8 +1444,8 @@ static int snd_seq_ioctl_create_port(struct snd_seq_client *client, void *arg)
 		return -EPERM;
 
 	port = snd_seq_create_port(client, (info->flags & SNDRV_SEQ_PORT_FLG_GIVEN_PORT) ? info->addr.port : -1);
-	if (port == NULL)
-		return -ENOMEM;
+	if (IS_ERR(port))
+		return PTR_ERR(port);
 
 	if (client->type == USER_CLIENT && info->kernel) {
 		port_idx = port->addr.port;
@@ -1680,6 +1858,20 @@ static int snd_seq_ioctl_set_queue_tempo(struct snd_seq_client *client,
 }
 
 
+/* GET_QUEUE_DISPATCH ioctl() */
+static int snd_seq_ioctl_get_queue_dispatch(struct snd_seq_client *client,
+					    void *arg)
+{
+	return snd_seq_queue_get_dispatch(arg);
+}
+
+/* SET_QUEUE_DISPATCH ioctl() */
+static int snd_seq_ioctl_set_queue_dispatch(struct snd_seq_client *client,
+					    void *arg)
+{
+	return snd_seq_queue_set_dispatch(client->number, arg);
+}
+
 /* GET_QUEUE_TIMER ioctl() */
 static int snd_seq_ioctl_get_queue_timer(struct snd_seq_client *client,
 					 void *arg)
@@ -2064,6 +2256,8 @@ static const struct ioctl_handler {
 	{ SNDRV_SEQ_IOCTL_GET_QUEUE_STATUS, snd_seq_ioctl_get_queue_status },
 	{ SNDRV_SEQ_IOCTL_GET_QUEUE_TEMPO, snd_seq_ioctl_get_queue_tempo },
 	{ SNDRV_SEQ_IOCTL_SET_QUEUE_TEMPO, snd_seq_ioctl_set_queue_tempo },
+	{ SNDRV_SEQ_IOCTL_GET_QUEUE_DISPATCH, snd_seq_ioctl_get_queue_dispatch },
+	{ SNDRV_SEQ_IOCTL_SET_QUEUE_DISPATCH, snd_seq_ioctl_set_queue_dispatch },
 	{ SNDRV_SEQ_IOCTL_GET_QUEUE_TIMER, snd_seq_ioctl_get_queue_timer },
 	{ SNDRV_SEQ_IOCTL_SET_QUEUE_TIMER, snd_seq_ioctl_set_queue_timer },
 	{ SNDRV_SEQ_IOCTL_GET_QUEUE_CLIENT, snd_seq_ioctl_get_queue_client },
@@ -2107,6 +2301,14 @@ static long snd_seq_ioctl(struct file *file, unsigned int cmd,
 	if (snd_BUG_ON(!client))
 		return -ENXIO;
 
+	/* batch commands need the file for the blocking mode */
+	switch (cmd) {
+	case SNDRV_SEQ_IOCTL_WRITE_BATCH:
+		return snd_seq_ioctl_write_batch(file, (void __user *)arg);
+	case SNDRV_SEQ_IOCTL_READ_BATCH:
+		return snd_seq_ioctl_read_batch(file, (void __user *)arg);
+	}
+
 	for (handler = ioctl_handlers; handler->cmd > 0; ++handler) {
 		if (handler->cmd == cmd)
 			break;
@@ -2249,7 +2451,8 @@ static int kernel_client_enqueue(int client, struct snd_seq_event *ev,
 	if (! cptr->accept_output)
 		result = -EPERM;
 	else /* send it */
-		result = snd_seq_client_enqueue_event(cptr, ev, file, blocking, atomic, hop);
+		result = snd_seq_client_enqueue_event(cptr, ev, file, blocking,
+						      atomic, hop, NULL);
 
 	snd_seq_client_unlock(cptr);
 	return result;
@@ -2280,6 +2483,58 @@ int snd_seq_kernel_client_enqueue_blocking(int client, struct snd_seq_event * ev
 }
 EXPORT_SYMBOL(snd_seq_kernel_client_enqueue_blocking);
 
+/*
+ * exported, called by kernel clients to enqueue an array of events.
+ * The queues are processed once after the whole array instead of after
+ * each event.
+ *
+ * RETURN VALUE: the number of events consumed from the array, or
+ * negative if the first event failed
+ */
+int snd_seq_kernel_client_enqueue_batch(int client, struct snd_seq_event *ev,
+					int count, struct file *file,
+					int blocking)
+{
+	DECLARE_BITMAP(pending, SNDRV_SEQ_MAX_QUEUES);
+	struct snd_seq_client *cptr;
+	int i, err = 0;
+
+	if (snd_BUG_ON(!ev || count < 0))
+		return -EINVAL;
+
+	cptr = snd_seq_client_use_ptr(client);
+	if (cptr == NULL)
+		return -EINVAL;
+	if (!cptr->accept_output) {
+		snd_seq_client_unlock(cptr);
+		return -EPERM;
+	}
+
+	bitmap_zero(pending, SNDRV_SEQ_MAX_QUEUES);
+	for (i = 0; i < count; i++, ev++) {
+		if (ev->type == SNDRV_SEQ_EVENT_NONE)
+			continue; /* ignore this */
+		if (ev->type == SNDRV_SEQ_EVENT_KERNEL_ERROR) {
+			err = -EINVAL; /* quoted events can't be enqueued */
+			break;
+		}
+		ev->source.client = client;
+		if (check_event_type_and_length(ev)) {
+			err = -EINVAL;
+			break;
+		}
+		err = snd_seq_client_enqueue_event(cptr, ev, file, blocking,
+						   0, 0, pending);
+		if (err < 0)
+			break;
+	}
+	snd_seq_check_queues(pending, 0, 0);
+
+	snd_seq_client_unlock(cptr);
+	return i > 0 ? i : err;
+}
+EXPORT_SYMBOL(snd_seq_kernel_client_enqueue_batch);
+
 /* 
  * exported, called by kernel clients to dispatch events directly to other
  * clients, bypassing the queues.  Event time-stamp will be updated.
@@ -2411,6 +2666,22 @@ static void snd_seq_info_dump_subscribers(struct snd_info_buffer *buffer,
 
 #define FLAG_PERM_DUPLEX(perm) ((perm) & SNDRV_SEQ_PORT_CAP_DUPLEX ? 'X' : '-')
 
+static void snd_seq_info_dump_port_stats(struct snd_info_buffer *buffer,
+					 struct snd_seq_client_port *p)
+{
+	struct snd_seq_port_stats *stats, sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(p->stats, cpu);
+		sum.rx += READ_ONCE(stats->rx);
+		sum.rx_errors += READ_ONCE(stats->rx_errors);
+		sum.tx += READ_ONCE(stats->tx);
+	}
+	snd_iprintf(buffer, "    Events: rx %lu, rx errors %lu, tx %lu\n",
+		    sum.rx, sum.rx_errors, sum.tx);
+}
+
 static void snd_seq_info_dump_ports(struct snd_info_buffer *buffer,
 				    struct snd_seq_client *client)
 {
@@ -2424,6 +2695,7 @@ static void snd_seq_info_dump_ports(struct snd_info_buffer *buffer,
 			    FLAG_PERM_WR(p->capability),
 			    FLAG_PERM_EX(p->capability),
 			    FLAG_PERM_DUPLEX(p->capability));
+		snd_seq_info_dump_port_stats(buffer, p);
 		snd_seq_info_dump_subscribers(buffer, &p->c_src, 1, "    Connecting To: ");
 		snd_seq_info_dump_subscribers(buffer, &p->c_dest, 0, "    Connected From: ");
 	}
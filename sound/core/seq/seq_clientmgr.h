@@ -59,6 +59,7 @@ struct snd_seq_client {
 	/* ports */
 	int num_ports;		/* number of ports */
 	struct list_head ports_list_head;
+	struct idr ports_idr;	/* port number -> port, RCU for readers */
 	rwlock_t ports_lock;
 	struct mutex ports_mutex;
 	int convert32;		/* convert 32->64bit */
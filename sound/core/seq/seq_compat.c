@@ -109,6 +109,8 @@ static long snd_seq_ioctl_compat(struct file *file, unsigned int cmd, unsigned l
 	case SNDRV_SEQ_IOCTL_GET_QUEUE_STATUS:
 	case SNDRV_SEQ_IOCTL_GET_QUEUE_TEMPO:
 	case SNDRV_SEQ_IOCTL_SET_QUEUE_TEMPO:
+	case SNDRV_SEQ_IOCTL_GET_QUEUE_DISPATCH:
+	case SNDRV_SEQ_IOCTL_SET_QUEUE_DISPATCH:
 	case SNDRV_SEQ_IOCTL_GET_QUEUE_TIMER:
 	case SNDRV_SEQ_IOCTL_SET_QUEUE_TIMER:
 	case SNDRV_SEQ_IOCTL_GET_QUEUE_CLIENT:
@@ -120,6 +122,8 @@ static long snd_seq_ioctl_compat(struct file *file, unsigned int cmd, unsigned l
 	case SNDRV_SEQ_IOCTL_GET_SUBSCRIPTION:
 	case SNDRV_SEQ_IOCTL_QUERY_NEXT_CLIENT:
 	case SNDRV_SEQ_IOCTL_RUNNING_MODE:
+	case SNDRV_SEQ_IOCTL_WRITE_BATCH:
+	case SNDRV_SEQ_IOCTL_READ_BATCH:
 		return snd_seq_ioctl(file, cmd, arg);
 	case SNDRV_SEQ_IOCTL_CREATE_PORT32:
 		return snd_seq_call_port_info_ioctl(client, SNDRV_SEQ_IOCTL_CREATE_PORT, argp);
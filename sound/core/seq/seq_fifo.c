@@ -210,6 +210,49 @@ int snd_seq_fifo_cell_out(struct snd_seq_fifo *f,
 	return 0;
 }
 
+/* dequeue up to count cells at once; only fixed length events are taken,
+ * the batch ends before a variable length event.
+ * returns the number of cells, or -EMSGSIZE if the first event has
+ * variable length.
+ */
+int snd_seq_fifo_cells_out(struct snd_seq_fifo *f,
+			   struct snd_seq_event_cell **cells, int count,
+			   int nonblock)
+{
+	unsigned long flags;
+	wait_queue_entry_t wait;
+	int n = 0;
+
+	if (snd_BUG_ON(!f))
+		return -EINVAL;
+
+	init_waitqueue_entry(&wait, current);
+	spin_lock_irqsave(&f->lock, flags);
+	while (f->head == NULL) {
+		if (nonblock) {
+			/* non-blocking - return immediately */
+			spin_unlock_irqrestore(&f->lock, flags);
+			return -EAGAIN;
+		}
+		set_current_state(TASK_INTERRUPTIBLE);
+		add_wait_queue(&f->input_sleep, &wait);
+		spin_unlock_irq(&f->lock);
+		schedule();
+		spin_lock_irq(&f->lock);
+		remove_wait_queue(&f->input_sleep, &wait);
+		if (signal_pending(current)) {
+			spin_unlock_irqrestore(&f->lock, flags);
+			return -ERESTARTSYS;
+		}
+	}
+	while (n < count && f->head &&
+	       !snd_seq_ev_is_variable(&f->head->event))
+		cells[n++] = fifo_cell_out(f);
+	spin_unlock_irqrestore(&f->lock, flags);
+
+	return n ? n : -EMSGSIZE;
+}
+
 
 void snd_seq_fifo_cell_putback(struct snd_seq_fifo *f,
 			       struct snd_seq_event_cell *cell)
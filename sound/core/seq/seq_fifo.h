@@ -56,6 +56,11 @@ int snd_seq_fifo_event_in(struct snd_seq_fifo *f, struct snd_seq_event *event);
 /* get a cell from fifo - fifo should be locked */
 int snd_seq_fifo_cell_out(struct snd_seq_fifo *f, struct snd_seq_event_cell **cellp, int nonblock);
 
+/* get fixed length cells from fifo - fifo should be locked */
+int snd_seq_fifo_cells_out(struct snd_seq_fifo *f,
+			   struct snd_seq_event_cell **cells, int count,
+			   int nonblock);
+
 /* free dequeued cell - fifo should be locked */
 void snd_seq_fifo_cell_putback(struct snd_seq_fifo *f, struct snd_seq_event_cell *cell);
 
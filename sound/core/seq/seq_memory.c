@@ -25,6 +25,8 @@
 #include <linux/slab.h>
 #include <linux/sched/signal.h>
 #include <linux/vmalloc.h>
+#include <linux/percpu.h>
+#include <linux/mm.h>
 #include <sound/core.h>
 
 #include <sound/seq_kernel.h>
@@ -33,6 +35,15 @@
 #include "seq_info.h"
 #include "seq_lock.h"
 
+/* number of cells moved between the pool and a per-CPU cache at once */
+#define SEQ_POOL_CACHE_BATCH	16
+/* variable length data from this size on is kept in a shared buffer */
+#define SEQ_SHARED_MIN_SIZE	256
+/* ... up to this size; the buffer may be freed from atomic context, so it
+ * can't be vmalloc'ed, and larger data goes to the chained cells
+ */
+#define SEQ_SHARED_MAX_SIZE	(64 * 1024)
+
 static inline int snd_seq_pool_available(struct snd_seq_pool *pool)
 {
 	return pool->total_elements - atomic_read(&pool->counter);
@@ -62,6 +73,14 @@ static inline int snd_seq_output_ok(struct snd_seq_pool *pool)
  *      ext.data.len = length | SNDRV_SEQ_EXT_CHAINED
  *      ext.data.ptr = the additiona cell head
  *         -> cell.next -> cell.next -> ..
+ * 4) shared
+ *    When the variable length event is delivered to several subscribers,
+ *    or when a large event is enqueued, the external data is copied once
+ *    to a reference counted buffer, which is referred by all cells of
+ *    the event.  The buffer is linear, so that the data can be passed
+ *    on in one piece.
+ *      ext.data.len = length | SNDRV_SEQ_EXT_SHARED
+ *      ext.data.ptr = struct snd_seq_ext_shared
  */
 
 /*
@@ -86,6 +105,11 @@ int snd_seq_dump_var_event(const struct snd_seq_event *event,
 	if ((len = get_var_len(event)) <= 0)
 		return len;
 
+	if (snd_seq_ev_is_shared(event)) {
+		struct snd_seq_ext_shared *shared = event->data.ext.ptr;
+
+		return func(private_data, shared->data, len);
+	}
 	if (event->data.ext.len & SNDRV_SEQ_EXT_USRPTR) {
 		char buf[32];
 		char __user *curptr = (char __force __user *)event->data.ext.ptr;
@@ -155,7 +179,8 @@ int snd_seq_expand_var_event(const struct snd_seq_event *event, int count, char
 	if (count < newlen)
 		return -EAGAIN;
 
-	if (event->data.ext.len & SNDRV_SEQ_EXT_USRPTR) {
+	if (!snd_seq_ev_is_shared(event) &&
+	    (event->data.ext.len & SNDRV_SEQ_EXT_USRPTR)) {
 		if (! in_kernel)
 			return -EINVAL;
 		if (copy_from_user(buf, (void __force __user *)event->data.ext.ptr, len))
@@ -174,17 +199,134 @@ EXPORT_SYMBOL(snd_seq_expand_var_event);
  * release this cell, free extended data if available
  */
 
-static inline void free_cell(struct snd_seq_pool *pool,
-			     struct snd_seq_event_cell *cell)
+/*
+ * Free cells are kept primarily in per-CPU caches, so that allocating and
+ * releasing a cell normally touches only the (uncontended) lock of the
+ * local cache.  The caches are refilled from and flushed to the pool free
+ * list in batches under pool->lock.  The lock order is cache -> pool.
+ *
+ * pool->counter keeps counting the cells in use, regardless where the
+ * free ones are parked.
+ */
+
+/* move a batch of cells from the pool free list to the cache */
+static void snd_seq_cache_refill(struct snd_seq_pool *pool,
+				 struct snd_seq_pool_cache *cache)
+{
+	struct snd_seq_event_cell *cell;
+	int n;
+
+	spin_lock(&pool->lock);
+	if (pool->closing) {
+		spin_unlock(&pool->lock);
+		return;
+	}
+	for (n = 0; n < SEQ_POOL_CACHE_BATCH && pool->free; n++) {
+		cell = pool->free;
+		pool->free = cell->next;
+		cell->next = cache->free;
+		cache->free = cell;
+		cache->count++;
+	}
+	spin_unlock(&pool->lock);
+}
+
+/* move a batch of cells from the cache back to the pool free list */
+static void snd_seq_cache_flush(struct snd_seq_pool *pool,
+				struct snd_seq_pool_cache *cache)
+{
+	struct snd_seq_event_cell *cell;
+	int n;
+
+	spin_lock(&pool->lock);
+	for (n = 0; n < SEQ_POOL_CACHE_BATCH && cache->free; n++) {
+		cell = cache->free;
+		cache->free = cell->next;
+		cache->count--;
+		cell->next = pool->free;
+		pool->free = cell;
+	}
+	spin_unlock(&pool->lock);
+}
+
+/* return the cells parked in all per-CPU caches back to the pool */
+static void snd_seq_cache_drain(struct snd_seq_pool *pool)
+{
+	struct snd_seq_pool_cache *cache;
+	struct snd_seq_event_cell *list, *last;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(pool->cache, cpu);
+		spin_lock_irqsave(&cache->lock, flags);
+		list = cache->free;
+		cache->free = NULL;
+		cache->count = 0;
+		spin_unlock_irqrestore(&cache->lock, flags);
+		if (!list)
+			continue;
+		for (last = list; last->next; last = last->next)
+			;
+		spin_lock_irqsave(&pool->lock, flags);
+		last->next = pool->free;
+		pool->free = list;
+		spin_unlock_irqrestore(&pool->lock, flags);
+	}
+}
+
+/* take a free cell from the local cache; return NULL if exhausted */
+static struct snd_seq_event_cell *snd_seq_pool_get_cell(struct snd_seq_pool *pool,
+							bool drained)
 {
-	cell->next = pool->free;
-	pool->free = cell;
+	struct snd_seq_pool_cache *cache;
+	struct snd_seq_event_cell *cell;
+	unsigned long flags;
+	int used = 0;
+
+	cache = raw_cpu_ptr(pool->cache);
+	spin_lock_irqsave(&cache->lock, flags);
+	if (!cache->free)
+		snd_seq_cache_refill(pool, cache);
+	cell = cache->free;
+	if (cell) {
+		cache->free = cell->next;
+		cache->count--;
+		cache->event_alloc_success++;
+		used = atomic_inc_return(&pool->counter);
+	} else if (drained) {
+		cache->event_alloc_failures++;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	if (cell) {
+		if (READ_ONCE(pool->max_used) < used)
+			WRITE_ONCE(pool->max_used, used);
+		/* clear cell pointers */
+		cell->next = NULL;
+	}
+	return cell;
+}
+
+/* put the cell to the local cache */
+static void snd_seq_pool_put_cell(struct snd_seq_pool *pool,
+				  struct snd_seq_event_cell *cell)
+{
+	struct snd_seq_pool_cache *cache;
+	unsigned long flags;
+
+	cache = raw_cpu_ptr(pool->cache);
+	spin_lock_irqsave(&cache->lock, flags);
+	cell->next = cache->free;
+	cache->free = cell;
+	if (++cache->count > 2 * SEQ_POOL_CACHE_BATCH)
+		snd_seq_cache_flush(pool, cache);
+	spin_unlock_irqrestore(&cache->lock, flags);
 	atomic_dec(&pool->counter);
 }
 
 void snd_seq_cell_free(struct snd_seq_event_cell * cell)
 {
-	unsigned long flags;
 	struct snd_seq_pool *pool;
 
 	if (snd_BUG_ON(!cell))
@@ -193,25 +335,27 @@ void snd_seq_cell_free(struct snd_seq_event_cell * cell)
 	if (snd_BUG_ON(!pool))
 		return;
 
-	spin_lock_irqsave(&pool->lock, flags);
-	free_cell(pool, cell);
-	if (snd_seq_ev_is_variable(&cell->event)) {
+	if (snd_seq_ev_is_shared(&cell->event)) {
+		snd_seq_event_unshare(&cell->event);
+	} else if (snd_seq_ev_is_variable(&cell->event)) {
 		if (cell->event.data.ext.len & SNDRV_SEQ_EXT_CHAINED) {
 			struct snd_seq_event_cell *curp, *nextptr;
 			curp = cell->event.data.ext.ptr;
 			for (; curp; curp = nextptr) {
 				nextptr = curp->next;
-				curp->next = pool->free;
-				free_cell(pool, curp);
+				snd_seq_pool_put_cell(pool, curp);
 			}
 		}
 	}
+	snd_seq_pool_put_cell(pool, cell);
+
+	/* pairs with prepare_to_wait() in snd_seq_cell_alloc() */
+	smp_mb__after_atomic();
 	if (waitqueue_active(&pool->output_sleep)) {
 		/* has enough space now? */
 		if (snd_seq_output_ok(pool))
 			wake_up(&pool->output_sleep);
 	}
-	spin_unlock_irqrestore(&pool->lock, flags);
 }
 
 
@@ -223,67 +367,75 @@ static int snd_seq_cell_alloc(struct snd_seq_pool *pool,
 			      int nonblock, struct file *file)
 {
 	struct snd_seq_event_cell *cell;
-	unsigned long flags;
-	int err = -EAGAIN;
-	wait_queue_entry_t wait;
+	DEFINE_WAIT(wait);
 
 	if (pool == NULL)
 		return -EINVAL;
 
 	*cellp = NULL;
 
-	init_waitqueue_entry(&wait, current);
-	spin_lock_irqsave(&pool->lock, flags);
-	if (pool->ptr == NULL) {	/* not initialized */
-		pr_debug("ALSA: seq: pool is not initialized\n");
-		err = -EINVAL;
-		goto __error;
-	}
-	while (pool->free == NULL && ! nonblock && ! pool->closing) {
-
-		set_current_state(TASK_INTERRUPTIBLE);
-		add_wait_queue(&pool->output_sleep, &wait);
-		spin_unlock_irq(&pool->lock);
-		schedule();
-		spin_lock_irq(&pool->lock);
-		remove_wait_queue(&pool->output_sleep, &wait);
-		/* interrupted? */
-		if (signal_pending(current)) {
-			err = -ERESTARTSYS;
-			goto __error;
+	for (;;) {
+		if (READ_ONCE(pool->closing)) /* closing.. */
+			return -ENOMEM;
+		if (READ_ONCE(pool->ptr) == NULL) {	/* not initialized */
+			pr_debug("ALSA: seq: pool is not initialized\n");
+			return -EINVAL;
 		}
-	}
-	if (pool->closing) { /* closing.. */
-		err = -ENOMEM;
-		goto __error;
+
+		cell = snd_seq_pool_get_cell(pool, false);
+		if (!cell && snd_seq_pool_available(pool) > 0) {
+			/* free cells are parked in other CPUs' caches */
+			snd_seq_cache_drain(pool);
+			cell = snd_seq_pool_get_cell(pool, true);
+		}
+		if (cell)
+			break;
+		if (nonblock)
+			return -EAGAIN;
+
+		prepare_to_wait(&pool->output_sleep, &wait, TASK_INTERRUPTIBLE);
+		if (snd_seq_pool_available(pool) <= 0 &&
+		    !READ_ONCE(pool->closing))
+			schedule();
+		finish_wait(&pool->output_sleep, &wait);
+		/* interrupted? */
+		if (signal_pending(current))
+			return -ERESTARTSYS;
 	}
 
-	cell = pool->free;
-	if (cell) {
-		int used;
-		pool->free = cell->next;
-		atomic_inc(&pool->counter);
-		used = atomic_read(&pool->counter);
-		if (pool->max_used < used)
-			pool->max_used = used;
-		pool->event_alloc_success++;
-		/* clear cell pointers */
-		cell->next = NULL;
-		err = 0;
-	} else
-		pool->event_alloc_failures++;
 	*cellp = cell;
-
-__error:
-	spin_unlock_irqrestore(&pool->lock, flags);
-	return err;
+	return 0;
 }
 
 
+/*
+ * allocate a shared buffer and copy the external data of the event to it
+ */
+static struct snd_seq_ext_shared *
+seq_ext_shared_new(const struct snd_seq_event *event, int len, gfp_t gfp)
+{
+	struct snd_seq_ext_shared *shared;
+	int err;
+
+	if (len > SEQ_SHARED_MAX_SIZE)
+		return ERR_PTR(-ENOMEM);
+	shared = kmalloc(sizeof(*shared) + len, gfp);
+	if (!shared)
+		return ERR_PTR(-ENOMEM);
+	err = snd_seq_expand_var_event(event, len, shared->data, 1, 0);
+	if (err < 0) {
+		kfree(shared);
+		return ERR_PTR(err);
+	}
+	refcount_set(&shared->refs, 1);
+	shared->len = len;
+	return shared;
+}
+
 /*
  * duplicate the event to a cell.
  * if the event has external data, the data is decomposed to additional
- * cells.
+ * cells, or copied to a shared buffer when it is large.
  */
 int snd_seq_event_dup(struct snd_seq_pool *pool, struct snd_seq_event *event,
 		      struct snd_seq_event_cell **cellp, int nonblock,
@@ -297,12 +449,22 @@ int snd_seq_event_dup(struct snd_seq_pool *pool, struct snd_seq_event *event,
 
 	ncells = 0;
 	extlen = 0;
+	if (snd_seq_ev_is_shared(event)) {
+		struct snd_seq_ext_shared *shared = event->data.ext.ptr;
+
+		/* just take another reference to the data */
+		err = snd_seq_cell_alloc(pool, &cell, nonblock, file);
+		if (err < 0)
+			return err;
+		refcount_inc(&shared->refs);
+		cell->event = *event;
+		*cellp = cell;
+		return 0;
+	}
 	if (snd_seq_ev_is_variable(event)) {
 		extlen = event->data.ext.len & ~SNDRV_SEQ_EXT_MASK;
 		ncells = (extlen + sizeof(struct snd_seq_event) - 1) / sizeof(struct snd_seq_event);
 	}
-	if (ncells >= pool->total_elements)
-		return -ENOMEM;
 
 	err = snd_seq_cell_alloc(pool, &cell, nonblock, file);
 	if (err < 0)
@@ -311,6 +473,35 @@ int snd_seq_event_dup(struct snd_seq_pool *pool, struct snd_seq_event *event,
 	/* copy the event */
 	cell->event = *event;
 
+	/* large data goes to a single buffer instead of a chain of cells.
+	 * user-space data is copied in process context, where the allocation
+	 * may sleep; elsewhere fall back to the chained cells when no memory
+	 * is at hand.
+	 */
+	if (extlen >= SEQ_SHARED_MIN_SIZE) {
+		struct snd_seq_ext_shared *shared;
+		gfp_t gfp;
+
+		if (event->data.ext.len & SNDRV_SEQ_EXT_USRPTR)
+			gfp = GFP_KERNEL;
+		else
+			gfp = GFP_NOWAIT | __GFP_NOWARN;
+		shared = seq_ext_shared_new(event, extlen, gfp);
+		if (!IS_ERR(shared)) {
+			cell->event.data.ext.len = extlen | SNDRV_SEQ_EXT_SHARED;
+			cell->event.data.ext.ptr = shared;
+			*cellp = cell;
+			return 0;
+		}
+		if (PTR_ERR(shared) != -ENOMEM) {
+			err = PTR_ERR(shared);
+			/* don't release the external data of the source */
+			cell->event.data.ext.len = extlen | SNDRV_SEQ_EXT_CHAINED;
+			cell->event.data.ext.ptr = NULL;
+			goto __error;
+		}
+	}
+
 	/* decompose */
 	if (snd_seq_ev_is_variable(event)) {
 		int len = extlen;
@@ -322,6 +513,12 @@ int snd_seq_event_dup(struct snd_seq_pool *pool, struct snd_seq_event *event,
 		cell->event.data.ext.len = extlen | SNDRV_SEQ_EXT_CHAINED;
 		cell->event.data.ext.ptr = NULL;
 
+		/* the chain can't be larger than the pool */
+		if (ncells >= pool->total_elements) {
+			err = -ENOMEM;
+			goto __error;
+		}
+
 		src = (struct snd_seq_event_cell *)event->data.ext.ptr;
 		buf = (char *)event->data.ext.ptr;
 		tail = NULL;
@@ -362,6 +559,43 @@ int snd_seq_event_dup(struct snd_seq_pool *pool, struct snd_seq_event *event,
 	snd_seq_cell_free(cell);
 	return err;
 }
+
+/*
+ * copy the external data of a variable length event to a shared buffer,
+ * so that the event can be duplicated to several cells without copying
+ * the data again.  The caller must drop the reference via
+ * snd_seq_event_unshare() after passing the event.
+ */
+int snd_seq_event_share(struct snd_seq_event *event, int atomic)
+{
+	struct snd_seq_ext_shared *shared;
+	int len;
+
+	if (snd_seq_ev_is_shared(event)) {
+		shared = event->data.ext.ptr;
+		refcount_inc(&shared->refs);
+		return 0;
+	}
+	len = get_var_len(event);
+	if (len < 0)
+		return len;
+	shared = seq_ext_shared_new(event, len,
+				    atomic ? GFP_ATOMIC : GFP_KERNEL);
+	if (IS_ERR(shared))
+		return PTR_ERR(shared);
+	event->data.ext.len = len | SNDRV_SEQ_EXT_SHARED;
+	event->data.ext.ptr = shared;
+	return 0;
+}
+
+/* drop the reference to the shared external data */
+void snd_seq_event_unshare(struct snd_seq_event *event)
+{
+	struct snd_seq_ext_shared *shared = event->data.ext.ptr;
+
+	if (refcount_dec_and_test(&shared->refs))
+		kfree(shared);
+}
   
 
 /* poll wait */
@@ -442,6 +676,7 @@ int snd_seq_pool_done(struct snd_seq_pool *pool)
 		schedule_timeout_uninterruptible(1);
 	
 	/* release all resources */
+	snd_seq_cache_drain(pool);
 	spin_lock_irqsave(&pool->lock, flags);
 	ptr = pool->ptr;
 	pool->ptr = NULL;
@@ -463,11 +698,19 @@ int snd_seq_pool_done(struct snd_seq_pool *pool)
 struct snd_seq_pool *snd_seq_pool_new(int poolsize)
 {
 	struct snd_seq_pool *pool;
+	int cpu;
 
 	/* create pool block */
 	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
 	if (!pool)
 		return NULL;
+	pool->cache = alloc_percpu(struct snd_seq_pool_cache);
+	if (!pool->cache) {
+		kfree(pool);
+		return NULL;
+	}
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->cache, cpu)->lock);
 	spin_lock_init(&pool->lock);
 	pool->ptr = NULL;
 	pool->free = NULL;
@@ -493,6 +736,7 @@ int snd_seq_pool_delete(struct snd_seq_pool **ppool)
 		return 0;
 	snd_seq_pool_mark_closing(pool);
 	snd_seq_pool_done(pool);
+	free_percpu(pool->cache);
 	kfree(pool);
 	return 0;
 }
@@ -513,11 +757,19 @@ void __exit snd_sequencer_memory_done(void)
 void snd_seq_info_pool(struct snd_info_buffer *buffer,
 		       struct snd_seq_pool *pool, char *space)
 {
+	struct snd_seq_pool_cache *cache;
+	int cpu, success = 0, failures = 0;
+
 	if (pool == NULL)
 		return;
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(pool->cache, cpu);
+		success += cache->event_alloc_success;
+		failures += cache->event_alloc_failures;
+	}
 	snd_iprintf(buffer, "%sPool size          : %d\n", space, pool->total_elements);
 	snd_iprintf(buffer, "%sCells in use       : %d\n", space, atomic_read(&pool->counter));
 	snd_iprintf(buffer, "%sPeak cells in use  : %d\n", space, pool->max_used);
-	snd_iprintf(buffer, "%sAlloc success      : %d\n", space, pool->event_alloc_success);
-	snd_iprintf(buffer, "%sAlloc failures     : %d\n", space, pool->event_alloc_failures);
+	snd_iprintf(buffer, "%sAlloc success      : %d\n", space, success);
+	snd_iprintf(buffer, "%sAlloc failures     : %d\n", space, failures);
 }
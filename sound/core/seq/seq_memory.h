@@ -23,6 +23,7 @@
 
 #include <sound/seq_kernel.h>
 #include <linux/poll.h>
+#include <linux/refcount.h>
 
 struct snd_info_buffer;
 
@@ -31,6 +32,35 @@ struct snd_seq_event_cell {
 	struct snd_seq_event event;
 	struct snd_seq_pool *pool;				/* used pool */
 	struct snd_seq_event_cell *next;	/* next cell */
+	struct snd_seq_event_cell *child;	/* prioq: first child in heap */
+	s64 order;				/* prioq: order among equal times */
+};
+
+/* variable length data shared by the cells delivered to several clients */
+struct snd_seq_ext_shared {
+	refcount_t refs;
+	unsigned int len;
+	char data[];
+};
+
+/* internal: ext.ptr points to a struct snd_seq_ext_shared */
+#define SNDRV_SEQ_EXT_SHARED	(SNDRV_SEQ_EXT_USRPTR | SNDRV_SEQ_EXT_CHAINED)
+
+static inline bool snd_seq_ev_is_shared(const struct snd_seq_event *ev)
+{
+	return snd_seq_ev_is_variable(ev) &&
+		(ev->data.ext.len & SNDRV_SEQ_EXT_MASK) == SNDRV_SEQ_EXT_SHARED;
+}
+
+/* per-CPU cache of free cells, refilled from and flushed to the pool */
+struct snd_seq_pool_cache {
+	spinlock_t lock;
+	struct snd_seq_event_cell *free;	/* head of the cached free list */
+	int count;		/* cells in the cache */
+
+	/* statistics */
+	int event_alloc_failures;
+	int event_alloc_success;
 };
 
 /* design note: the pool is a contiguous block of memory, if we dynamicly
@@ -52,15 +82,15 @@ struct snd_seq_pool {
 
 	/* statistics */
 	int max_used;
-	int event_alloc_nopool;
-	int event_alloc_failures;
-	int event_alloc_success;
 
 	/* Write locking */
 	wait_queue_head_t output_sleep;
 
 	/* Pool lock */
 	spinlock_t lock;
+
+	/* per-CPU free cell caches */
+	struct snd_seq_pool_cache __percpu *cache;
 };
 
 void snd_seq_cell_free(struct snd_seq_event_cell *cell);
@@ -68,6 +98,9 @@ void snd_seq_cell_free(struct snd_seq_event_cell *cell);
 int snd_seq_event_dup(struct snd_seq_pool *pool, struct snd_seq_event *event,
 		      struct snd_seq_event_cell **cellp, int nonblock, struct file *file);
 
+int snd_seq_event_share(struct snd_seq_event *event, int atomic);
+void snd_seq_event_unshare(struct snd_seq_event *event);
+
 /* return number of unused (free) cells */
 static inline int snd_seq_unused_cells(struct snd_seq_pool *pool)
 {
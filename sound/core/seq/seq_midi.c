@@ -129,6 +129,20 @@ static int dump_midi(struct snd_rawmidi_substream *substream, const char *buf, i
 	return 0;
 }
 
+/* write the SysEx data in one go; what does not fit is dropped */
+static int dump_midi_sysex(struct snd_rawmidi_substream *substream,
+			   const char *buf, int count)
+{
+	if (snd_BUG_ON(!substream || !buf))
+		return -EINVAL;
+	if (snd_rawmidi_kernel_write(substream, buf, count) < count) {
+		if (printk_ratelimit())
+			pr_err("ALSA: seq_midi: MIDI output buffer overrun\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
 static int event_process_midi(struct snd_seq_event *ev, int direct,
 			      void *private_data, int atomic, int hop)
 {
@@ -148,7 +162,8 @@ static int event_process_midi(struct snd_seq_event *ev, int direct,
 			pr_debug("ALSA: seq_midi: invalid sysex event flags = 0x%x\n", ev->flags);
 			return 0;
 		}
-		snd_seq_dump_var_event(ev, (snd_seq_dump_func_t)dump_midi, substream);
+		snd_seq_dump_var_event(ev, (snd_seq_dump_func_t)dump_midi_sysex,
+				       substream);
 		snd_midi_event_reset_decode(msynth->parser);
 	} else {
 		if (msynth->parser == NULL)
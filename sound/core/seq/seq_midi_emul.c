@@ -64,6 +64,34 @@ static void all_notes_off(struct snd_midi_op *ops, void *private,
 static void snd_midi_reset_controllers(struct snd_midi_channel *chan);
 static void reset_all_channels(struct snd_midi_channel_set *chset);
 
+/*
+ * Controller classes, looked up per controller number in do_control()
+ * instead of testing ranges and walking the switch for every message
+ */
+#define CTL_SWITCH	0x01	/* on/off controller, value is 0 or 127 */
+#define CTL_CORE	0x02	/* interpreted here, see do_control() */
+
+static const unsigned char ctl_class[128] = {
+	[MIDI_CTL_MSB_BANK] = CTL_CORE,
+	[MIDI_CTL_MSB_DATA_ENTRY] = CTL_CORE,
+	[MIDI_CTL_LSB_BANK] = CTL_CORE,
+	[MIDI_CTL_LSB_DATA_ENTRY] = CTL_CORE,
+	[MIDI_CTL_SUSTAIN] = CTL_SWITCH | CTL_CORE,
+	[MIDI_CTL_PORTAMENTO] = CTL_SWITCH | CTL_CORE,
+	[MIDI_CTL_SOSTENUTO] = CTL_SWITCH | CTL_CORE,
+	[MIDI_CTL_SOFT_PEDAL] = CTL_SWITCH,
+	[MIDI_CTL_LEGATO_FOOTSWITCH] = CTL_SWITCH,
+	[MIDI_CTL_HOLD2] = CTL_SWITCH,
+	[MIDI_CTL_GENERAL_PURPOSE5 ... MIDI_CTL_GENERAL_PURPOSE8] = CTL_SWITCH,
+	[MIDI_CTL_NONREG_PARM_NUM_LSB] = CTL_CORE,
+	[MIDI_CTL_NONREG_PARM_NUM_MSB] = CTL_CORE,
+	[MIDI_CTL_REGIST_PARM_NUM_LSB] = CTL_CORE,
+	[MIDI_CTL_REGIST_PARM_NUM_MSB] = CTL_CORE,
+	[MIDI_CTL_ALL_SOUNDS_OFF] = CTL_CORE,
+	[MIDI_CTL_RESET_CONTROLLERS] = CTL_CORE,
+	[MIDI_CTL_ALL_NOTES_OFF] = CTL_CORE,
+};
+
 
 /*
  * Process an event in a driver independent way.  This means dealing
@@ -153,11 +181,18 @@ snd_midi_process_event(struct snd_midi_op *ops,
 		break;
 	case SNDRV_SEQ_EVENT_PITCHBEND:
 		chan->midi_pitchbend = ev->data.control.value;
+		/* dense controller streams repeat values; skip the update */
+		if (chan->sent_pitchbend == chan->midi_pitchbend)
+			break;
+		chan->sent_pitchbend = chan->midi_pitchbend;
 		if (ops->control)
 			ops->control(drv, MIDI_CTL_PITCHBEND, chan);
 		break;
 	case SNDRV_SEQ_EVENT_CHANPRESS:
 		chan->midi_pressure = ev->data.control.value;
+		if (chan->sent_pressure == chan->midi_pressure)
+			break;
+		chan->sent_pressure = chan->midi_pressure;
 		if (ops->control)
 			ops->control(drv, MIDI_CTL_CHAN_PRESSURE, chan);
 		break;
@@ -273,13 +308,27 @@ do_control(struct snd_midi_op *ops, void *drv, struct snd_midi_channel_set *chse
 	if (control >= ARRAY_SIZE(chan->control))
 		return;
 
-	/* Switches */
-	if ((control >=64 && control <=69) || (control >= 80 && control <= 83)) {
-		/* These are all switches; either off or on so set to 0 or 127 */
+	/* These are all switches; either off or on so set to 0 or 127 */
+	if (ctl_class[control] & CTL_SWITCH)
 		value = (value >= 64)? 127: 0;
-	}
+
 	chan->control[control] = value;
 
+	/*
+	 * Controllers only passed to the driver take effect through the
+	 * stored value, so the value last passed needs no update.  That's
+	 * compared rather than the stored one, which resets change behind
+	 * the driver's back.
+	 */
+	if (!(ctl_class[control] & CTL_CORE)) {
+		if (chan->sent_control[control] == chan->control[control])
+			return;
+		chan->sent_control[control] = chan->control[control];
+		if (ops->control)
+			ops->control(drv, control, chan);
+		return;
+	}
+
 	switch (control) {
 	case MIDI_CTL_SUSTAIN:
 		if (value == 0) {
@@ -356,26 +405,6 @@ do_control(struct snd_midi_op *ops, void *drv, struct snd_midi_channel_set *chse
 	case MIDI_CTL_RESET_CONTROLLERS:
 		snd_midi_reset_controllers(chan);
 		break;
-
-	case MIDI_CTL_SOFT_PEDAL:
-	case MIDI_CTL_LEGATO_FOOTSWITCH:
-	case MIDI_CTL_HOLD2:
-	case MIDI_CTL_SC1_SOUND_VARIATION:
-	case MIDI_CTL_SC2_TIMBRE:
-	case MIDI_CTL_SC3_RELEASE_TIME:
-	case MIDI_CTL_SC4_ATTACK_TIME:
-	case MIDI_CTL_SC5_BRIGHTNESS:
-	case MIDI_CTL_E1_REVERB_DEPTH:
-	case MIDI_CTL_E2_TREMOLO_DEPTH:
-	case MIDI_CTL_E3_CHORUS_DEPTH:
-	case MIDI_CTL_E4_DETUNE_DEPTH:
-	case MIDI_CTL_E5_PHASER_DEPTH:
-		goto notyet;
-	notyet:
-	default:
-		if (ops->control)
-			ops->control(drv, control, chan);
-		break;
 	}
 }
 
@@ -639,6 +668,9 @@ static void snd_midi_channel_init(struct snd_midi_channel *p, int n)
 	memset(p, 0, sizeof(struct snd_midi_channel));
 	p->private = NULL;
 	p->number = n;
+	memset(p->sent_control, 0xff, sizeof(p->sent_control));
+	p->sent_pressure = -1;
+	p->sent_pitchbend = INT_MIN;
 
 	snd_midi_reset_controllers(p);
 	p->gm_rpn_pitch_bend_range = 256; /* 2 semitones */
@@ -23,6 +23,9 @@
 #include <sound/core.h>
 #include <linux/slab.h>
 #include <linux/module.h>
+#include <linux/idr.h>
+#include <linux/rcupdate.h>
+#include <linux/percpu.h>
 #include "seq_system.h"
 #include "seq_ports.h"
 #include "seq_clientmgr.h"
@@ -34,24 +37,13 @@
  */
 
 
-/* 
-
-NOTE: the current implementation of the port structure as a linked list is
-not optimal for clients that have many ports. For sending messages to all
-subscribers of a port we first need to find the address of the port
-structure, which means we have to traverse the list. A direct access table
-(array) would be better, but big preallocated arrays waste memory.
-
-Possible actions:
-
-1) leave it this way, a client does normaly does not have more than a few
-ports
+/*
 
-2) replace the linked list of ports by a array of pointers which is
-dynamicly kmalloced. When a port is added or deleted we can simply allocate
-a new array, copy the corresponding pointers, and delete the old one. We
-then only need a pointer to this array, and an integer that tells us how
-much elements are in array.
+NOTE: the ports of a client are kept in a list sorted by the port number,
+which is used for iterating over them, and in an IDR indexed by the port
+number for the lookups in the event delivery path.  Both are modified
+under ports_mutex and ports_lock; the IDR lookup is done under RCU only,
+so a removed port is freed only after a grace period.
 
 */
 
@@ -63,18 +55,16 @@ struct snd_seq_client_port *snd_seq_port_use_ptr(struct snd_seq_client *client,
 
 	if (client == NULL)
 		return NULL;
-	read_lock(&client->ports_lock);
-	list_for_each_entry(port, &client->ports_list_head, list) {
-		if (port->addr.port == num) {
-			if (port->closing)
-				break; /* deleting now */
+	rcu_read_lock();
+	port = idr_find(&client->ports_idr, num);
+	if (port) {
+		if (port->closing)
+			port = NULL; /* deleting now */
+		else
 			snd_use_lock_use(&port->use_lock);
-			read_unlock(&client->ports_lock);
-			return port;
-		}
 	}
-	read_unlock(&client->ports_lock);
-	return NULL;		/* not found */
+	rcu_read_unlock();
+	return port;
 }
 
 
@@ -83,28 +73,18 @@ struct snd_seq_client_port *snd_seq_port_query_nearest(struct snd_seq_client *cl
 						       struct snd_seq_port_info *pinfo)
 {
 	int num;
-	struct snd_seq_client_port *port, *found;
+	struct snd_seq_client_port *found;
 
 	num = pinfo->addr.port;
-	found = NULL;
-	read_lock(&client->ports_lock);
-	list_for_each_entry(port, &client->ports_list_head, list) {
-		if (port->addr.port < num)
-			continue;
-		if (port->addr.port == num) {
-			found = port;
-			break;
-		}
-		if (found == NULL || port->addr.port < found->addr.port)
-			found = port;
-	}
+	rcu_read_lock();
+	found = idr_get_next(&client->ports_idr, &num);
 	if (found) {
 		if (found->closing)
 			found = NULL;
 		else
 			snd_use_lock_use(&found->use_lock);
 	}
-	read_unlock(&client->ports_lock);
+	rcu_read_unlock();
 	return found;
 }
 
@@ -122,7 +102,8 @@ static void port_subs_info_init(struct snd_seq_port_subs_info *grp)
 }
 
 
-/* create a port, port number is returned (-1 on failure);
+/* create a port, the port or an error pointer is returned; -EBUSY if the
+ * given port number is already taken.
  * the caller needs to unref the port via snd_seq_port_unlock() appropriately
  */
 struct snd_seq_client_port *snd_seq_create_port(struct snd_seq_client *client,
@@ -134,17 +115,22 @@ struct snd_seq_client_port *snd_seq_create_port(struct snd_seq_client *client,
 	
 	/* sanity check */
 	if (snd_BUG_ON(!client))
-		return NULL;
+		return ERR_PTR(-EINVAL);
 
 	if (client->num_ports >= SNDRV_SEQ_MAX_PORTS) {
 		pr_warn("ALSA: seq: too many ports for client %d\n", client->number);
-		return NULL;
+		return ERR_PTR(-ENOMEM);
 	}
 
 	/* create a new port */
 	new_port = kzalloc(sizeof(*new_port), GFP_KERNEL);
 	if (!new_port)
-		return NULL;	/* failure, out of memory */
+		return ERR_PTR(-ENOMEM);	/* failure, out of memory */
+	new_port->stats = alloc_percpu(struct snd_seq_port_stats);
+	if (!new_port->stats) {
+		kfree(new_port);
+		return ERR_PTR(-ENOMEM);
+	}
 	/* init port data */
 	new_port->addr.client = client->number;
 	new_port->addr.port = -1;
@@ -155,14 +141,27 @@ struct snd_seq_client_port *snd_seq_create_port(struct snd_seq_client *client,
 	port_subs_info_init(&new_port->c_dest);
 	snd_use_lock_use(&new_port->use_lock);
 
-	num = port >= 0 ? port : 0;
 	mutex_lock(&client->ports_mutex);
+	idr_preload(GFP_KERNEL);
 	write_lock_irqsave(&client->ports_lock, flags);
+	/* the lowest free number in auto-probe mode */
+	if (port >= 0)
+		num = idr_alloc(&client->ports_idr, new_port, port, port + 1,
+				GFP_NOWAIT);
+	else
+		num = idr_alloc(&client->ports_idr, new_port, 0, 0, GFP_NOWAIT);
+	if (num < 0) {
+		write_unlock_irqrestore(&client->ports_lock, flags);
+		idr_preload_end();
+		mutex_unlock(&client->ports_mutex);
+		free_percpu(new_port->stats);
+		kfree(new_port);
+		/* -ENOSPC: the given number is already used */
+		return ERR_PTR(num == -ENOSPC && port >= 0 ? -EBUSY : -ENOMEM);
+	}
 	list_for_each_entry(p, &client->ports_list_head, list) {
 		if (p->addr.port > num)
 			break;
-		if (port < 0) /* auto-probe mode */
-			num = p->addr.port + 1;
 	}
 	/* insert the new port */
 	list_add_tail(&new_port->list, &p->list);
@@ -170,6 +169,7 @@ struct snd_seq_client_port *snd_seq_create_port(struct snd_seq_client *client,
 	new_port->addr.port = num;	/* store the port number in the port */
 	sprintf(new_port->name, "port-%d", num);
 	write_unlock_irqrestore(&client->ports_lock, flags);
+	idr_preload_end();
 	mutex_unlock(&client->ports_mutex);
 
 	return new_port;
@@ -275,6 +275,7 @@ static int port_delete(struct snd_seq_client *client,
 	snd_BUG_ON(port->c_src.count != 0);
 	snd_BUG_ON(port->c_dest.count != 0);
 
+	free_percpu(port->stats);
 	kfree(port);
 	return 0;
 }
@@ -284,24 +285,23 @@ static int port_delete(struct snd_seq_client *client,
 int snd_seq_delete_port(struct snd_seq_client *client, int port)
 {
 	unsigned long flags;
-	struct snd_seq_client_port *found = NULL, *p;
+	struct snd_seq_client_port *found;
 
 	mutex_lock(&client->ports_mutex);
 	write_lock_irqsave(&client->ports_lock, flags);
-	list_for_each_entry(p, &client->ports_list_head, list) {
-		if (p->addr.port == port) {
-			/* ok found.  delete from the list at first */
-			list_del(&p->list);
-			client->num_ports--;
-			found = p;
-			break;
-		}
+	found = idr_remove(&client->ports_idr, port);
+	if (found) {
+		/* ok found.  delete from the list at first */
+		list_del(&found->list);
+		client->num_ports--;
 	}
 	write_unlock_irqrestore(&client->ports_lock, flags);
 	mutex_unlock(&client->ports_mutex);
-	if (found)
+	if (found) {
+		/* wait for the lockless lookups in flight */
+		synchronize_rcu();
 		return port_delete(client, found);
-	else
+	} else
 		return -ENOENT;
 }
 
@@ -323,15 +323,22 @@ int snd_seq_delete_all_ports(struct snd_seq_client *client)
 	} else {
 		INIT_LIST_HEAD(&deleted_list);
 	}
+	list_for_each_entry(port, &deleted_list, list)
+		idr_remove(&client->ports_idr, port->addr.port);
 	client->num_ports = 0;
 	write_unlock_irqrestore(&client->ports_lock, flags);
 
+	/* wait for the lockless lookups in flight */
+	if (!list_empty(&deleted_list))
+		synchronize_rcu();
+
 	/* remove each port in deleted_list */
 	list_for_each_entry_safe(port, tmp, &deleted_list, list) {
 		list_del(&port->list);
 		snd_seq_system_client_ev_port_exit(port->addr.client, port->addr.port);
 		port_delete(client, port);
 	}
+	idr_destroy(&client->ports_idr);
 	mutex_unlock(&client->ports_mutex);
 	return 0;
 }
@@ -57,6 +57,13 @@ struct snd_seq_port_subs_info {
 	int (*close)(void *private_data, struct snd_seq_port_subscribe *info);
 };
 
+/* per-CPU event counters of a port */
+struct snd_seq_port_stats {
+	unsigned long rx;		/* events delivered to the port */
+	unsigned long rx_errors;	/* events the port failed to take */
+	unsigned long tx;		/* events sent to the subscribers */
+};
+
 struct snd_seq_client_port {
 
 	struct snd_seq_addr addr;	/* client/port number */
@@ -86,7 +93,8 @@ struct snd_seq_client_port {
 	int midi_channels;
 	int midi_voices;
 	int synth_voices;
-		
+
+	struct snd_seq_port_stats __percpu *stats;
 };
 
 struct snd_seq_client;
@@ -101,7 +109,7 @@ struct snd_seq_client_port *snd_seq_port_query_nearest(struct snd_seq_client *cl
 /* unlock the port */
 #define snd_seq_port_unlock(port) snd_use_lock_free(&(port)->use_lock)
 
-/* create a port, port number is returned (-1 on failure) */
+/* create a port, the port or an error pointer is returned */
 struct snd_seq_client_port *snd_seq_create_port(struct snd_seq_client *client, int port_index);
 
 /* delete a port */
@@ -26,27 +26,27 @@
 #include "seq_prioq.h"
 
 
-/* Implementation is a simple linked list for now...
+/* The priority queue is a pairing heap ordered on timestamp.  For events
+   with an equal timestamp the queue behaves as a FIFO, except that the
+   events with the high priority flag go before all others (the latest
+   one first).  This ordering is kept via the per-cell order key, which
+   counts up for the normal events and down for the prior ones.
 
-   This priority queue orders the events on timestamp. For events with an
-   equeal timestamp the queue behaves as a FIFO. 
+   Each cell links its first child via ->child and its next sibling via
+   ->next, so insertion is O(1) and removal of the head O(log n) amortized.
 
    *
+   *  Head --> +-------+
+   *           | first |
    *           +-------+
-   *  Head --> | first |
-   *           +-------+
-   *                 |next
-   *           +-----v-+
-   *           |       |
-   *           +-------+
-   *                 |
-   *           +-----v-+
+   *            |child
+   *           +v------+ next +-------+ next +-------+
+   *           |       |----->|       |----->|       |
+   *           +-------+      +-------+      +-------+
+   *            |child
+   *           +v------+
    *           |       |
    *           +-------+
-   *                 |
-   *           +-----v-+
-   *  Tail --> | last  |
-   *           +-------+
    *
 
  */
@@ -64,7 +64,7 @@ struct snd_seq_prioq *snd_seq_prioq_new(void)
 	
 	spin_lock_init(&f->lock);
 	f->head = NULL;
-	f->tail = NULL;
+	f->order = 0;
 	f->cells = 0;
 	
 	return f;
@@ -96,20 +96,6 @@ void snd_seq_prioq_delete(struct snd_seq_prioq **fifo)
 
 
 
-/* compare timestamp between events */
-/* return 1 if a >= b; 0 */
-static inline int compare_timestamp(struct snd_seq_event *a,
-				    struct snd_seq_event *b)
-{
-	if ((a->flags & SNDRV_SEQ_TIME_STAMP_MASK) == SNDRV_SEQ_TIME_STAMP_TICK) {
-		/* compare ticks */
-		return (snd_seq_compare_tick_time(&a->time.tick, &b->time.tick));
-	} else {
-		/* compare real time */
-		return (snd_seq_compare_real_time(&a->time.time, &b->time.time));
-	}
-}
-
 /* compare timestamp between events */
 /* return negative if a < b;
  *        zero     if a = b;
@@ -142,13 +128,71 @@ static inline int compare_timestamp_rel(struct snd_seq_event *a,
 	}
 }
 
+/* return true if cell a is to be dispatched before cell b */
+static inline bool prioq_before(struct snd_seq_event_cell *a,
+				struct snd_seq_event_cell *b)
+{
+	int rel = compare_timestamp_rel(&a->event, &b->event);
+
+	if (rel)
+		return rel < 0;
+	return a->order < b->order;
+}
+
+/* meld two heaps, return the new root */
+static struct snd_seq_event_cell *prioq_meld(struct snd_seq_event_cell *a,
+					     struct snd_seq_event_cell *b)
+{
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+	if (prioq_before(b, a))
+		swap(a, b);
+	b->next = a->child;
+	a->child = b;
+	return a;
+}
+
+/* meld the sibling list of a removed root in two passes */
+static struct snd_seq_event_cell *
+prioq_merge_pairs(struct snd_seq_event_cell *first)
+{
+	struct snd_seq_event_cell *list = NULL, *root = NULL;
+	struct snd_seq_event_cell *a, *b, *next;
+
+	/* meld pairs from left to right, collect them in reversed order */
+	while (first) {
+		a = first;
+		b = a->next;
+		if (!b) {
+			a->next = list;
+			list = a;
+			break;
+		}
+		next = b->next;
+		a->next = b->next = NULL;
+		a = prioq_meld(a, b);
+		a->next = list;
+		list = a;
+		first = next;
+	}
+
+	/* meld the pairs from right to left */
+	while (list) {
+		next = list->next;
+		list->next = NULL;
+		root = prioq_meld(root, list);
+		list = next;
+	}
+	return root;
+}
+
 /* enqueue cell to prioq */
 int snd_seq_prioq_cell_in(struct snd_seq_prioq * f,
 			  struct snd_seq_event_cell * cell)
 {
-	struct snd_seq_event_cell *cur, *prev;
 	unsigned long flags;
-	int count;
 	int prior;
 
 	if (snd_BUG_ON(!f || !cell))
@@ -158,57 +202,11 @@ int snd_seq_prioq_cell_in(struct snd_seq_prioq * f,
 	prior = (cell->event.flags & SNDRV_SEQ_PRIORITY_MASK);
 
 	spin_lock_irqsave(&f->lock, flags);
-
-	/* check if this element needs to inserted at the end (ie. ordered 
-	   data is inserted) This will be very likeley if a sequencer 
-	   application or midi file player is feeding us (sequential) data */
-	if (f->tail && !prior) {
-		if (compare_timestamp(&cell->event, &f->tail->event)) {
-			/* add new cell to tail of the fifo */
-			f->tail->next = cell;
-			f->tail = cell;
-			cell->next = NULL;
-			f->cells++;
-			spin_unlock_irqrestore(&f->lock, flags);
-			return 0;
-		}
-	}
-	/* traverse list of elements to find the place where the new cell is
-	   to be inserted... Note that this is a order n process ! */
-
-	prev = NULL;		/* previous cell */
-	cur = f->head;		/* cursor */
-
-	count = 10000; /* FIXME: enough big, isn't it? */
-	while (cur != NULL) {
-		/* compare timestamps */
-		int rel = compare_timestamp_rel(&cell->event, &cur->event);
-		if (rel < 0)
-			/* new cell has earlier schedule time, */
-			break;
-		else if (rel == 0 && prior)
-			/* equal schedule time and prior to others */
-			break;
-		/* new cell has equal or larger schedule time, */
-		/* move cursor to next cell */
-		prev = cur;
-		cur = cur->next;
-		if (! --count) {
-			spin_unlock_irqrestore(&f->lock, flags);
-			pr_err("ALSA: seq: cannot find a pointer.. infinite loop?\n");
-			return -EINVAL;
-		}
-	}
-
-	/* insert it before cursor */
-	if (prev != NULL)
-		prev->next = cell;
-	cell->next = cur;
-
-	if (f->head == cur) /* this is the first cell, set head to it */
-		f->head = cell;
-	if (cur == NULL) /* reached end of the list */
-		f->tail = cell;
+	f->order++;
+	cell->order = prior ? -f->order : f->order;
+	cell->next = NULL;
+	cell->child = NULL;
+	f->head = prioq_meld(f->head, cell);
 	f->cells++;
 	spin_unlock_irqrestore(&f->lock, flags);
 	return 0;
@@ -228,12 +226,8 @@ struct snd_seq_event_cell *snd_seq_prioq_cell_out(struct snd_seq_prioq *f)
 
 	cell = f->head;
 	if (cell) {
-		f->head = cell->next;
-
-		/* reset tail if this was the last element */
-		if (f->tail == cell)
-			f->tail = NULL;
-
+		f->head = prioq_merge_pairs(cell->child);
+		cell->child = NULL;
 		cell->next = NULL;
 		f->cells--;
 	}
@@ -286,50 +280,44 @@ static inline int prioq_match(struct snd_seq_event_cell *cell,
 	return 0;
 }
 
-/* remove cells for left client */
-void snd_seq_prioq_leave(struct snd_seq_prioq * f, int client, int timestamp)
+/*
+ * remove all cells matching the given criteria;
+ * the kept cells are melded into a new heap, which keeps their order
+ */
+static void prioq_remove_cells(struct snd_seq_prioq *f,
+			       bool (*match)(struct snd_seq_event_cell *cell,
+					     int client, void *data),
+			       int client, void *data)
 {
-	register struct snd_seq_event_cell *cell, *next;
+	struct snd_seq_event_cell *cell, *list, *last, *root = NULL;
+	struct snd_seq_event_cell *freefirst = NULL, *freenext;
 	unsigned long flags;
-	struct snd_seq_event_cell *prev = NULL;
-	struct snd_seq_event_cell *freefirst = NULL, *freeprev = NULL, *freenext;
 
 	/* collect all removed cells */
 	spin_lock_irqsave(&f->lock, flags);
-	cell = f->head;
-	while (cell) {
-		next = cell->next;
-		if (prioq_match(cell, client, timestamp)) {
-			/* remove cell from prioq */
-			if (cell == f->head) {
-				f->head = cell->next;
-			} else {
-				prev->next = cell->next;
-			}
-			if (cell == f->tail)
-				f->tail = cell->next;
-			f->cells--;
+	list = f->head;
+	while (list) {
+		cell = list;
+		list = cell->next;
+		/* visit the children, too */
+		if (cell->child) {
+			for (last = cell->child; last->next; last = last->next)
+				;
+			last->next = list;
+			list = cell->child;
+			cell->child = NULL;
+		}
+		cell->next = NULL;
+		if (match(cell, client, data)) {
 			/* add cell to free list */
-			cell->next = NULL;
-			if (freefirst == NULL) {
-				freefirst = cell;
-			} else {
-				freeprev->next = cell;
-			}
-			freeprev = cell;
+			cell->next = freefirst;
+			freefirst = cell;
+			f->cells--;
 		} else {
-#if 0
-			pr_debug("ALSA: seq: type = %i, source = %i, dest = %i, "
-			       "client = %i\n",
-				cell->event.type,
-				cell->event.source.client,
-				cell->event.dest.client,
-				client);
-#endif
-			prev = cell;
+			root = prioq_meld(root, cell);
 		}
-		cell = next;		
 	}
+	f->head = root;
 	spin_unlock_irqrestore(&f->lock, flags);	
 
 	/* remove selected cells */
@@ -340,6 +328,18 @@ void snd_seq_prioq_leave(struct snd_seq_prioq * f, int client, int timestamp)
 	}
 }
 
+static bool prioq_leave_match(struct snd_seq_event_cell *cell,
+			      int client, void *data)
+{
+	return prioq_match(cell, client, *(int *)data);
+}
+
+/* remove cells for left client */
+void snd_seq_prioq_leave(struct snd_seq_prioq * f, int client, int timestamp)
+{
+	prioq_remove_cells(f, prioq_leave_match, client, &timestamp);
+}
+
 static int prioq_remove_match(struct snd_seq_remove_events *info,
 			      struct snd_seq_event *ev)
 {
@@ -395,57 +395,16 @@ static int prioq_remove_match(struct snd_seq_remove_events *info,
 	return 1;
 }
 
+static bool prioq_remove_events_match(struct snd_seq_event_cell *cell,
+				      int client, void *data)
+{
+	return cell->event.source.client == client &&
+		prioq_remove_match(data, &cell->event);
+}
+
 /* remove cells matching remove criteria */
 void snd_seq_prioq_remove_events(struct snd_seq_prioq * f, int client,
 				 struct snd_seq_remove_events *info)
 {
-	struct snd_seq_event_cell *cell, *next;
-	unsigned long flags;
-	struct snd_seq_event_cell *prev = NULL;
-	struct snd_seq_event_cell *freefirst = NULL, *freeprev = NULL, *freenext;
-
-	/* collect all removed cells */
-	spin_lock_irqsave(&f->lock, flags);
-	cell = f->head;
-
-	while (cell) {
-		next = cell->next;
-		if (cell->event.source.client == client &&
-			prioq_remove_match(info, &cell->event)) {
-
-			/* remove cell from prioq */
-			if (cell == f->head) {
-				f->head = cell->next;
-			} else {
-				prev->next = cell->next;
-			}
-
-			if (cell == f->tail)
-				f->tail = cell->next;
-			f->cells--;
-
-			/* add cell to free list */
-			cell->next = NULL;
-			if (freefirst == NULL) {
-				freefirst = cell;
-			} else {
-				freeprev->next = cell;
-			}
-
-			freeprev = cell;
-		} else {
-			prev = cell;
-		}
-		cell = next;		
-	}
-	spin_unlock_irqrestore(&f->lock, flags);	
-
-	/* remove selected cells */
-	while (freefirst) {
-		freenext = freefirst->next;
-		snd_seq_cell_free(freefirst);
-		freefirst = freenext;
-	}
+	prioq_remove_cells(f, prioq_remove_events_match, client, info);
 }
-
-
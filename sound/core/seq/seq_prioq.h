@@ -27,8 +27,8 @@
 /* === PRIOQ === */
 
 struct snd_seq_prioq {
-	struct snd_seq_event_cell *head;      /* pointer to head of prioq */
-	struct snd_seq_event_cell *tail;      /* pointer to tail of prioq */
+	struct snd_seq_event_cell *head;      /* root of the pairing heap */
+	s64 order;			      /* insertion counter */
 	int cells;
 	spinlock_t lock;
 };
@@ -37,6 +37,8 @@
 
 #include <linux/init.h>
 #include <linux/slab.h>
+#include <linux/sched.h>
+#include <uapi/linux/sched/types.h>
 #include <sound/core.h>
 
 #include "seq_memory.h"
@@ -138,6 +140,58 @@ static struct snd_seq_queue *queue_new(int owner, int locked)
 	return q;
 }
 
+static void queue_kwork(struct kthread_work *work)
+{
+	struct snd_seq_queue *q = container_of(work, struct snd_seq_queue, kwork);
+
+	snd_seq_check_queue(q, 0, 0);
+}
+
+/* switch the dispatch context; q->timer_mutex must be held */
+static int queue_set_dispatch(struct snd_seq_queue *q, int mode,
+			      int cpu, int prio)
+{
+	struct sched_param param = { .sched_priority = prio };
+	struct kthread_worker *worker = NULL, *old;
+
+	switch (mode) {
+	case SNDRV_SEQ_QUEUE_DISPATCH_TIMER:
+		break;
+	case SNDRV_SEQ_QUEUE_DISPATCH_KTHREAD:
+		if (prio < 1 || prio >= MAX_USER_RT_PRIO)
+			return -EINVAL;
+		if (cpu >= 0 && (cpu >= nr_cpu_ids || !cpu_online(cpu)))
+			return -EINVAL;
+		worker = kthread_create_worker(0, "snd-seq-q%d", q->queue);
+		if (IS_ERR(worker))
+			return PTR_ERR(worker);
+		if (cpu >= 0)
+			set_cpus_allowed_ptr(worker->task, cpumask_of(cpu));
+		sched_setscheduler_nocheck(worker->task, SCHED_FIFO, &param);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* the timer dispatches directly until the new worker is set up */
+	spin_lock_irq(&q->check_lock);
+	old = q->kworker;
+	q->kworker = NULL;
+	spin_unlock_irq(&q->check_lock);
+	if (old)
+		kthread_destroy_worker(old);
+
+	if (worker) {
+		kthread_init_work(&q->kwork, queue_kwork);
+		q->dispatch_cpu = cpu;
+		q->dispatch_prio = prio;
+		spin_lock_irq(&q->check_lock);
+		q->kworker = worker;
+		spin_unlock_irq(&q->check_lock);
+	}
+	return 0;
+}
+
 /* delete queue (destructor) */
 static void queue_delete(struct snd_seq_queue *q)
 {
@@ -145,6 +199,7 @@ static void queue_delete(struct snd_seq_queue *q)
 	mutex_lock(&q->timer_mutex);
 	snd_seq_timer_stop(q->timer);
 	snd_seq_timer_close(q);
+	queue_set_dispatch(q, SNDRV_SEQ_QUEUE_DISPATCH_TIMER, 0, 0);
 	mutex_unlock(&q->timer_mutex);
 	/* wait until access free */
 	snd_use_lock_sync(&q->use_lock);
@@ -203,6 +258,15 @@ struct snd_seq_queue *snd_seq_queue_alloc(int client, int locked, unsigned int i
 		queue_delete(q);
 		return ERR_PTR(-ENOMEM);
 	}
+	if (seq_default_queue_kthread) {
+		mutex_lock(&q->timer_mutex);
+		if (queue_set_dispatch(q, SNDRV_SEQ_QUEUE_DISPATCH_KTHREAD,
+				       seq_default_queue_cpu,
+				       seq_default_queue_rt_prio) < 0)
+			pr_warn("ALSA: seq: cannot create kthread for queue %d\n",
+				q->queue);
+		mutex_unlock(&q->timer_mutex);
+	}
 	return q;
 }
 
@@ -257,6 +321,35 @@ struct snd_seq_queue *snd_seq_queue_find_name(char *name)
 
 /* -------------------------------------------------------- */
 
+/* tickless mode: arm the queue timer for the earliest queued event */
+static void queue_arm_timer(struct snd_seq_queue *q)
+{
+	struct snd_seq_event_cell *cell;
+	snd_seq_tick_time_t tick;
+	snd_seq_real_time_t time;
+	bool has_tick = false, has_time = false;
+	unsigned long flags;
+
+	spin_lock_irqsave(&q->tickq->lock, flags);
+	cell = snd_seq_prioq_cell_peek(q->tickq);
+	if (cell) {
+		tick = cell->event.time.tick;
+		has_tick = true;
+	}
+	spin_unlock_irqrestore(&q->tickq->lock, flags);
+
+	spin_lock_irqsave(&q->timeq->lock, flags);
+	cell = snd_seq_prioq_cell_peek(q->timeq);
+	if (cell) {
+		time = cell->event.time.time;
+		has_time = true;
+	}
+	spin_unlock_irqrestore(&q->timeq->lock, flags);
+
+	snd_seq_timer_set_next(q->timer, has_tick ? &tick : NULL,
+			       has_time ? &time : NULL);
+}
+
 void snd_seq_check_queue(struct snd_seq_queue *q, int atomic, int hop)
 {
 	unsigned long flags;
@@ -276,6 +369,8 @@ void snd_seq_check_queue(struct snd_seq_queue *q, int atomic, int hop)
 	spin_unlock_irqrestore(&q->check_lock, flags);
 
       __again:
+	snd_seq_timer_sync(q->timer);
+
 	/* Process tick queue... */
 	while ((cell = snd_seq_prioq_cell_peek(q->tickq)) != NULL) {
 		if (snd_seq_compare_tick_time(&q->timer->tick.cur_tick,
@@ -312,23 +407,38 @@ void snd_seq_check_queue(struct snd_seq_queue *q, int atomic, int hop)
 	}
 	q->check_blocked = 0;
 	spin_unlock_irqrestore(&q->check_lock, flags);
+
+	if (q->timer->tickless)
+		queue_arm_timer(q);
 }
 
 
+/* called from the queue timer */
+void snd_seq_queue_timer_check(struct snd_seq_queue *q)
+{
+	unsigned long flags;
+	bool queued = false;
+
+	spin_lock_irqsave(&q->check_lock, flags);
+	if (q->kworker) {
+		kthread_queue_work(q->kworker, &q->kwork);
+		queued = true;
+	}
+	spin_unlock_irqrestore(&q->check_lock, flags);
+
+	if (!queued)
+		snd_seq_check_queue(q, 1, 0);
+}
+
 /* enqueue a event to singe queue */
-int snd_seq_enqueue_event(struct snd_seq_event_cell *cell, int atomic, int hop)
+static int queue_cell_in(struct snd_seq_queue *q,
+			 struct snd_seq_event_cell *cell)
 {
-	int dest, err;
-	struct snd_seq_queue *q;
+	int err;
 
-	if (snd_BUG_ON(!cell))
-		return -EINVAL;
-	dest = cell->event.queue;	/* destination queue */
-	q = queueptr(dest);
-	if (q == NULL)
-		return -EINVAL;
 	/* handle relative time stamps, convert them into absolute */
 	if ((cell->event.flags & SNDRV_SEQ_TIME_MODE_MASK) == SNDRV_SEQ_TIME_MODE_REL) {
+		snd_seq_timer_sync(q->timer);
 		switch (cell->event.flags & SNDRV_SEQ_TIME_STAMP_MASK) {
 		case SNDRV_SEQ_TIME_STAMP_TICK:
 			cell->event.time.tick += q->timer->tick.cur_tick;
@@ -353,7 +463,22 @@ int snd_seq_enqueue_event(struct snd_seq_event_cell *cell, int atomic, int hop)
 		err = snd_seq_prioq_cell_in(q->timeq, cell);
 		break;
 	}
+	return err;
+}
+
+int snd_seq_enqueue_event(struct snd_seq_event_cell *cell, int atomic, int hop)
+{
+	int dest, err;
+	struct snd_seq_queue *q;
 
+	if (snd_BUG_ON(!cell))
+		return -EINVAL;
+	dest = cell->event.queue;	/* destination queue */
+	q = queueptr(dest);
+	if (q == NULL)
+		return -EINVAL;
+
+	err = queue_cell_in(q, cell);
 	if (err < 0) {
 		queuefree(q); /* unlock */
 		return err;
@@ -367,6 +492,45 @@ int snd_seq_enqueue_event(struct snd_seq_event_cell *cell, int atomic, int hop)
 	return 0;
 }
 
+/* enqueue a event without dispatching; the caller must call
+ * snd_seq_check_queues() for the queues marked in the pending bitmap
+ */
+int snd_seq_enqueue_event_deferred(struct snd_seq_event_cell *cell,
+				   unsigned long *pending)
+{
+	int dest, err;
+	struct snd_seq_queue *q;
+
+	if (snd_BUG_ON(!cell || !pending))
+		return -EINVAL;
+	dest = cell->event.queue;	/* destination queue */
+	q = queueptr(dest);
+	if (q == NULL)
+		return -EINVAL;
+
+	err = queue_cell_in(q, cell);
+	if (!err)
+		set_bit(dest, pending);
+	queuefree(q); /* unlock */
+	return err;
+}
+
+/* dispatch the queues marked in the pending bitmap, and clear it */
+void snd_seq_check_queues(unsigned long *pending, int atomic, int hop)
+{
+	struct snd_seq_queue *q;
+	int i;
+
+	for_each_set_bit(i, pending, SNDRV_SEQ_MAX_QUEUES) {
+		clear_bit(i, pending);
+		q = queueptr(i);
+		if (q == NULL)
+			continue;
+		snd_seq_check_queue(q, atomic, hop);
+		queuefree(q);
+	}
+}
+
 
 /*----------------------------------------------------------------*/
 
@@ -508,6 +672,54 @@ int snd_seq_queue_timer_set_tempo(int queueid, int client,
 	return result;
 }
 
+/* GET_QUEUE_DISPATCH */
+int snd_seq_queue_get_dispatch(struct snd_seq_queue_dispatch *info)
+{
+	struct snd_seq_queue *q = queueptr(info->queue);
+
+	if (q == NULL)
+		return -EINVAL;
+	mutex_lock(&q->timer_mutex);
+	if (q->kworker) {
+		info->mode = SNDRV_SEQ_QUEUE_DISPATCH_KTHREAD;
+		info->cpu = q->dispatch_cpu;
+		info->priority = q->dispatch_prio;
+	} else {
+		info->mode = SNDRV_SEQ_QUEUE_DISPATCH_TIMER;
+		info->cpu = -1;
+		info->priority = 0;
+	}
+	mutex_unlock(&q->timer_mutex);
+	queuefree(q);
+	return 0;
+}
+
+/* SET_QUEUE_DISPATCH */
+int snd_seq_queue_set_dispatch(int client, struct snd_seq_queue_dispatch *info)
+{
+	struct snd_seq_queue *q = queueptr(info->queue);
+	int result;
+
+	if (q == NULL)
+		return -EINVAL;
+	if (! queue_access_lock(q, client)) {
+		queuefree(q);
+		return -EPERM;
+	}
+	if (info->mode == SNDRV_SEQ_QUEUE_DISPATCH_KTHREAD &&
+	    !capable(CAP_SYS_NICE)) {
+		result = -EPERM;
+		goto unlock;
+	}
+	mutex_lock(&q->timer_mutex);
+	result = queue_set_dispatch(q, info->mode, info->cpu, info->priority);
+	mutex_unlock(&q->timer_mutex);
+ unlock:
+	queue_access_unlock(q);
+	queuefree(q);
+	return result;
+}
+
 /* use or unuse this queue */
 static void queue_use(struct snd_seq_queue *queue, int client, int use)
 {
@@ -791,6 +1003,11 @@ void snd_seq_info_queues_read(struct snd_info_entry *entry,
 		snd_iprintf(buffer, "queued time events : %d\n", snd_seq_prioq_avail(q->timeq));
 		snd_iprintf(buffer, "queued tick events : %d\n", snd_seq_prioq_avail(q->tickq));
 		snd_iprintf(buffer, "timer state        : %s\n", tmr->running ? "Running" : "Stopped");
+		if (q->kworker)
+			snd_iprintf(buffer, "dispatch           : kthread (cpu %d, prio %d)\n",
+				    q->dispatch_cpu, q->dispatch_prio);
+		else
+			snd_iprintf(buffer, "dispatch           : timer\n");
 		snd_iprintf(buffer, "timer PPQ          : %d\n", tmr->ppq);
 		snd_iprintf(buffer, "current tempo      : %d\n", tmr->tempo);
 		snd_iprintf(buffer, "current BPM        : %d\n", bpm);
@@ -27,9 +27,14 @@
 #include <linux/interrupt.h>
 #include <linux/list.h>
 #include <linux/bitops.h>
+#include <linux/kthread.h>
 
 #define SEQ_QUEUE_NO_OWNER (-1)
 
+extern bool seq_default_queue_kthread;
+extern int seq_default_queue_cpu;
+extern int seq_default_queue_rt_prio;
+
 struct snd_seq_queue {
 	int queue;		/* queue number */
 
@@ -56,6 +61,12 @@ struct snd_seq_queue {
 	unsigned int clients;	/* users of this queue */
 	struct mutex timer_mutex;
 
+	/* dispatch kthread (SNDRV_SEQ_QUEUE_DISPATCH_KTHREAD) */
+	struct kthread_worker *kworker;	/* protected by check_lock */
+	struct kthread_work kwork;
+	int dispatch_cpu;
+	int dispatch_prio;
+
 	snd_use_lock_t use_lock;
 };
 
@@ -84,6 +95,9 @@ void snd_seq_queue_client_leave(int client);
 
 /* enqueue a event received from one the clients */
 int snd_seq_enqueue_event(struct snd_seq_event_cell *cell, int atomic, int hop);
+int snd_seq_enqueue_event_deferred(struct snd_seq_event_cell *cell,
+				   unsigned long *pending);
+void snd_seq_check_queues(unsigned long *pending, int atomic, int hop);
 
 /* Remove events */
 void snd_seq_queue_client_leave_cells(int client);
@@ -100,6 +114,13 @@ struct snd_seq_queue *snd_seq_queue_find_name(char *name);
 /* check single queue and dispatch events */
 void snd_seq_check_queue(struct snd_seq_queue *q, int atomic, int hop);
 
+/* check the queue from the timer, or let the queue kthread do it */
+void snd_seq_queue_timer_check(struct snd_seq_queue *q);
+
+/* dispatch context */
+int snd_seq_queue_get_dispatch(struct snd_seq_queue_dispatch *info);
+int snd_seq_queue_set_dispatch(int client, struct snd_seq_queue_dispatch *info);
+
 /* access to queue's parameters */
 int snd_seq_queue_check_access(int queueid, int client);
 int snd_seq_queue_timer_set_tempo(int queueid, int client, struct snd_seq_queue_tempo *info);
@@ -33,6 +33,11 @@
 
 #define SKEW_BASE	0x10000	/* 16bit shift */
 
+/* max. sleep time of a tickless queue; it's re-evaluated after that */
+#define MAX_TICKLESS_NSEC	(3600ULL * NSEC_PER_SEC)
+
+static enum hrtimer_restart snd_seq_timer_hrtimer(struct hrtimer *hrt);
+
 static void snd_seq_timer_set_tick_resolution(struct snd_seq_timer *tmr)
 {
 	if (tmr->tempo < 1000000)
@@ -59,6 +64,8 @@ struct snd_seq_timer *snd_seq_timer_new(void)
 	if (!tmr)
 		return NULL;
 	spin_lock_init(&tmr->lock);
+	hrtimer_init(&tmr->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	tmr->hrtimer.function = snd_seq_timer_hrtimer;
 
 	/* reset setup to defaults */
 	snd_seq_timer_defaults(tmr);
@@ -83,6 +90,7 @@ void snd_seq_timer_delete(struct snd_seq_timer **tmr)
 
 	/* reset time */
 	snd_seq_timer_stop(t);
+	hrtimer_cancel(&t->hrtimer);
 	snd_seq_timer_reset(t);
 
 	kfree(t);
@@ -131,6 +139,23 @@ void snd_seq_timer_reset(struct snd_seq_timer *tmr)
 }
 
 
+/* advance the queue time by the given period; called with tmr->lock held */
+static void seq_timer_advance(struct snd_seq_timer *tmr,
+			      unsigned long resolution)
+{
+	if (tmr->skew != tmr->skew_base) {
+		/* FIXME: assuming skew_base = 0x10000 */
+		resolution = (resolution >> 16) * tmr->skew +
+			(((resolution & 0xffff) * tmr->skew) >> 16);
+	}
+
+	/* update timer */
+	snd_seq_inc_time_nsec(&tmr->cur_time, resolution);
+
+	/* calculate current tick */
+	snd_seq_timer_update_tick(&tmr->tick, resolution);
+}
+
 /* called by timer interrupt routine. the period time since previous invocation is passed */
 static void snd_seq_timer_interrupt(struct snd_timer_instance *timeri,
 				    unsigned long resolution,
@@ -146,23 +171,12 @@ static void snd_seq_timer_interrupt(struct snd_timer_instance *timeri,
 	if (tmr == NULL)
 		return;
 	spin_lock_irqsave(&tmr->lock, flags);
-	if (!tmr->running) {
+	if (!tmr->running || tmr->tickless) {
 		spin_unlock_irqrestore(&tmr->lock, flags);
 		return;
 	}
 
-	resolution *= ticks;
-	if (tmr->skew != tmr->skew_base) {
-		/* FIXME: assuming skew_base = 0x10000 */
-		resolution = (resolution >> 16) * tmr->skew +
-			(((resolution & 0xffff) * tmr->skew) >> 16);
-	}
-
-	/* update timer */
-	snd_seq_inc_time_nsec(&tmr->cur_time, resolution);
-
-	/* calculate current tick */
-	snd_seq_timer_update_tick(&tmr->tick, resolution);
+	seq_timer_advance(tmr, resolution * ticks);
 
 	/* register actual time of this timer update */
 	ktime_get_ts64(&tmr->last_update);
@@ -170,7 +184,113 @@ static void snd_seq_timer_interrupt(struct snd_timer_instance *timeri,
 	spin_unlock_irqrestore(&tmr->lock, flags);
 
 	/* check queues and dispatch events */
-	snd_seq_check_queue(q, 1, 0);
+	snd_seq_queue_timer_check(q);
+}
+
+/*
+ * tickless mode:
+ * the queue time is advanced from the monotonic clock whenever it's
+ * looked at, and a one-shot hrtimer is armed for the earliest event in
+ * the queue instead of ticking at the timer resolution.
+ */
+
+/* bring the queue time up to date; called with tmr->lock held */
+static void seq_timer_sync(struct snd_seq_timer *tmr)
+{
+	struct timespec64 now, delta;
+	u64 nsec;
+
+	if (!tmr->tickless || !tmr->running)
+		return;
+	ktime_get_ts64(&now);
+	delta = timespec64_sub(now, tmr->last_update);
+	tmr->last_update = now;
+	if (delta.tv_sec < 0)
+		return;
+	nsec = timespec64_to_ns(&delta);
+	/* advance in steps not overflowing unsigned long */
+	while (nsec > NSEC_PER_SEC) {
+		seq_timer_advance(tmr, NSEC_PER_SEC);
+		nsec -= NSEC_PER_SEC;
+	}
+	seq_timer_advance(tmr, nsec);
+}
+
+void snd_seq_timer_sync(struct snd_seq_timer *tmr)
+{
+	unsigned long flags;
+
+	if (!tmr->tickless)
+		return;
+	spin_lock_irqsave(&tmr->lock, flags);
+	seq_timer_sync(tmr);
+	spin_unlock_irqrestore(&tmr->lock, flags);
+}
+
+/* let the hrtimer fire now for re-evaluation; called with tmr->lock held */
+static void seq_timer_kick(struct snd_seq_timer *tmr)
+{
+	if (tmr->tickless && tmr->running)
+		hrtimer_start(&tmr->hrtimer, 0, HRTIMER_MODE_REL);
+}
+
+/* arm the hrtimer for the earliest of the given tick and real time;
+ * called after the queue has been checked
+ */
+void snd_seq_timer_set_next(struct snd_seq_timer *tmr,
+			    const snd_seq_tick_time_t *tick,
+			    const snd_seq_real_time_t *time)
+{
+	unsigned long flags;
+	u64 nsec = U64_MAX;
+	s64 delta;
+
+	spin_lock_irqsave(&tmr->lock, flags);
+	if (!tmr->tickless || !tmr->running)
+		goto unlock;
+
+	if (tick) {
+		if (*tick <= tmr->tick.cur_tick)
+			nsec = 0;
+		else
+			nsec = (u64)(*tick - tmr->tick.cur_tick) *
+				tmr->tick.resolution - tmr->tick.fraction;
+	}
+	if (time) {
+		delta = (s64)(time->tv_sec - tmr->cur_time.tv_sec) * NSEC_PER_SEC +
+			(s64)time->tv_nsec - tmr->cur_time.tv_nsec;
+		nsec = min_t(u64, nsec, max_t(s64, delta, 0));
+	}
+
+	if (nsec == U64_MAX) {
+		/* nothing queued; sleep until the next insertion */
+		hrtimer_try_to_cancel(&tmr->hrtimer);
+		goto unlock;
+	}
+	nsec = min_t(u64, nsec, MAX_TICKLESS_NSEC);
+	if (tmr->skew != tmr->skew_base && tmr->skew)
+		nsec = div_u64(nsec * tmr->skew_base, tmr->skew);
+	hrtimer_start(&tmr->hrtimer, ns_to_ktime(nsec), HRTIMER_MODE_REL);
+ unlock:
+	spin_unlock_irqrestore(&tmr->lock, flags);
+}
+
+static enum hrtimer_restart snd_seq_timer_hrtimer(struct hrtimer *hrt)
+{
+	struct snd_seq_timer *tmr = container_of(hrt, struct snd_seq_timer,
+						 hrtimer);
+	struct snd_seq_queue *q = tmr->queue;
+	unsigned long flags;
+	bool running;
+
+	spin_lock_irqsave(&tmr->lock, flags);
+	running = tmr->running && q;
+	spin_unlock_irqrestore(&tmr->lock, flags);
+
+	/* check queues and dispatch events; this re-arms the timer */
+	if (running)
+		snd_seq_queue_timer_check(q);
+	return HRTIMER_NORESTART;
 }
 
 /* set current tempo */
@@ -184,8 +304,10 @@ int snd_seq_timer_set_tempo(struct snd_seq_timer * tmr, int tempo)
 		return -EINVAL;
 	spin_lock_irqsave(&tmr->lock, flags);
 	if ((unsigned int)tempo != tmr->tempo) {
+		seq_timer_sync(tmr);
 		tmr->tempo = tempo;
 		snd_seq_timer_set_tick_resolution(tmr);
+		seq_timer_kick(tmr);
 	}
 	spin_unlock_irqrestore(&tmr->lock, flags);
 	return 0;
@@ -225,8 +347,10 @@ int snd_seq_timer_set_position_tick(struct snd_seq_timer *tmr,
 		return -EINVAL;
 
 	spin_lock_irqsave(&tmr->lock, flags);
+	seq_timer_sync(tmr);
 	tmr->tick.cur_tick = position;
 	tmr->tick.fraction = 0;
+	seq_timer_kick(tmr);
 	spin_unlock_irqrestore(&tmr->lock, flags);
 	return 0;
 }
@@ -242,7 +366,9 @@ int snd_seq_timer_set_position_time(struct snd_seq_timer *tmr,
 
 	snd_seq_sanity_real_time(&position);
 	spin_lock_irqsave(&tmr->lock, flags);
+	seq_timer_sync(tmr);
 	tmr->cur_time = position;
+	seq_timer_kick(tmr);
 	spin_unlock_irqrestore(&tmr->lock, flags);
 	return 0;
 }
@@ -262,7 +388,9 @@ int snd_seq_timer_set_skew(struct snd_seq_timer *tmr, unsigned int skew,
 		return -EINVAL;
 	}
 	spin_lock_irqsave(&tmr->lock, flags);
+	seq_timer_sync(tmr);
 	tmr->skew = skew;
+	seq_timer_kick(tmr);
 	spin_unlock_irqrestore(&tmr->lock, flags);
 	return 0;
 }
@@ -306,6 +434,7 @@ int snd_seq_timer_open(struct snd_seq_queue *q)
 	t->flags |= SNDRV_TIMER_IFLG_AUTO;
 	spin_lock_irq(&tmr->lock);
 	tmr->timeri = t;
+	tmr->queue = q;
 	spin_unlock_irq(&tmr->lock);
 	return 0;
 }
@@ -322,6 +451,7 @@ int snd_seq_timer_close(struct snd_seq_queue *q)
 	t = tmr->timeri;
 	tmr->timeri = NULL;
 	spin_unlock_irq(&tmr->lock);
+	hrtimer_cancel(&tmr->hrtimer);
 	if (t)
 		snd_timer_close(t);
 	return 0;
@@ -333,8 +463,12 @@ static int seq_timer_stop(struct snd_seq_timer *tmr)
 		return -EINVAL;
 	if (!tmr->running)
 		return 0;
+	seq_timer_sync(tmr);
 	tmr->running = 0;
-	snd_timer_pause(tmr->timeri);
+	if (tmr->tickless)
+		hrtimer_try_to_cancel(&tmr->hrtimer);
+	else
+		snd_timer_pause(tmr->timeri);
 	return 0;
 }
 
@@ -366,6 +500,10 @@ static int initialize_timer(struct snd_seq_timer *tmr)
 	else if (freq > MAX_FREQUENCY)
 		freq = MAX_FREQUENCY;
 
+	/* a slave timer follows its master, so it can't be tickless */
+	tmr->tickless = seq_default_timer_tickless &&
+		!(t->hw.flags & SNDRV_TIMER_HW_SLAVE);
+
 	tmr->ticks = 1;
 	if (!(t->hw.flags & SNDRV_TIMER_HW_SLAVE)) {
 		unsigned long r = t->hw.resolution;
@@ -390,9 +528,11 @@ static int seq_timer_start(struct snd_seq_timer *tmr)
 	seq_timer_reset(tmr);
 	if (initialize_timer(tmr) < 0)
 		return -EINVAL;
-	snd_timer_start(tmr->timeri, tmr->ticks);
+	if (!tmr->tickless)
+		snd_timer_start(tmr->timeri, tmr->ticks);
 	tmr->running = 1;
 	ktime_get_ts64(&tmr->last_update);
+	seq_timer_kick(tmr);
 	return 0;
 }
 
@@ -418,9 +558,11 @@ static int seq_timer_continue(struct snd_seq_timer *tmr)
 		if (initialize_timer(tmr) < 0)
 			return -EINVAL;
 	}
-	snd_timer_start(tmr->timeri, tmr->ticks);
+	if (!tmr->tickless)
+		snd_timer_start(tmr->timeri, tmr->ticks);
 	tmr->running = 1;
 	ktime_get_ts64(&tmr->last_update);
+	seq_timer_kick(tmr);
 	return 0;
 }
 
@@ -460,6 +602,7 @@ snd_seq_real_time_t snd_seq_timer_get_cur_time(struct snd_seq_timer *tmr)
  high PPQ values) */
 snd_seq_tick_time_t snd_seq_timer_get_cur_tick(struct snd_seq_timer *tmr)
 {
+	snd_seq_timer_sync(tmr);
 	return tmr->tick.cur_tick;
 }
 
@@ -485,8 +628,12 @@ void snd_seq_info_timer_read(struct snd_info_entry *entry,
 			continue;
 		}
 		snd_iprintf(buffer, "Timer for queue %i : %s\n", q->queue, ti->timer->name);
-		resolution = snd_timer_resolution(ti) * tmr->ticks;
-		snd_iprintf(buffer, "  Period time : %lu.%09lu\n", resolution / 1000000000, resolution % 1000000000);
+		if (tmr->tickless) {
+			snd_iprintf(buffer, "  Period time : tickless\n");
+		} else {
+			resolution = snd_timer_resolution(ti) * tmr->ticks;
+			snd_iprintf(buffer, "  Period time : %lu.%09lu\n", resolution / 1000000000, resolution % 1000000000);
+		}
 		snd_iprintf(buffer, "  Skew : %u / %u\n", tmr->skew, tmr->skew_base);
 		queuefree(q);
  	}
@@ -21,6 +21,7 @@
 #ifndef __SND_SEQ_TIMER_H
 #define __SND_SEQ_TIMER_H
 
+#include <linux/hrtimer.h>
 #include <sound/timer.h>
 #include <sound/seq_kernel.h>
 
@@ -34,7 +35,8 @@ struct snd_seq_timer {
 	/* ... tempo / offset / running state */
 
 	unsigned int		running:1,	/* running state of queue */	
-				initialized:1;	/* timer is initialized */
+				initialized:1,	/* timer is initialized */
+				tickless:1;	/* woken up only for the next event */
 
 	unsigned int		tempo;		/* current tempo, us/tick */
 	int			ppq;		/* time resolution, ticks/quarter */
@@ -54,6 +56,9 @@ struct snd_seq_timer {
 
 	struct timespec64	last_update;	 /* time of last clock update, used for interpolation */
 
+	struct hrtimer		hrtimer;	/* one-shot timer in tickless mode */
+	struct snd_seq_queue	*queue;		/* owner queue */
+
 	spinlock_t lock;
 };
 
@@ -137,6 +142,10 @@ int snd_seq_timer_set_position_time(struct snd_seq_timer *tmr, snd_seq_real_time
 int snd_seq_timer_set_skew(struct snd_seq_timer *tmr, unsigned int skew, unsigned int base);
 snd_seq_real_time_t snd_seq_timer_get_cur_time(struct snd_seq_timer *tmr);
 snd_seq_tick_time_t snd_seq_timer_get_cur_tick(struct snd_seq_timer *tmr);
+void snd_seq_timer_sync(struct snd_seq_timer *tmr);
+void snd_seq_timer_set_next(struct snd_seq_timer *tmr,
+			    const snd_seq_tick_time_t *tick,
+			    const snd_seq_real_time_t *time);
 
 extern int seq_default_timer_class;
 extern int seq_default_timer_sclass;
@@ -144,5 +153,6 @@ extern int seq_default_timer_card;
 extern int seq_default_timer_device;
 extern int seq_default_timer_subdevice;
 extern int seq_default_timer_resolution;
+extern bool seq_default_timer_tickless;
 
 #endif
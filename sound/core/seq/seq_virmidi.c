@@ -39,6 +39,7 @@
 #include <linux/wait.h>
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
 #include <sound/core.h>
 #include <sound/rawmidi.h>
 #include <sound/info.h>
@@ -52,6 +53,12 @@ MODULE_AUTHOR("Takashi Iwai <tiwai@suse.de>");
 MODULE_DESCRIPTION("Virtual Raw MIDI client on Sequencer");
 MODULE_LICENSE("GPL");
 
+/* SysEx up to this size is sent as a single event; 0 = chunks of 256 bytes */
+#define VIRMIDI_BULK_SYSEX_MAX	(1024 * 1024)
+static int bulk_sysex;
+module_param(bulk_sysex, int, 0644);
+MODULE_PARM_DESC(bulk_sysex, "Max. size of a SysEx message sent as one event (0 = off).");
+
 /*
  * initialize an event record
  */
@@ -82,7 +89,14 @@ static int snd_virmidi_dev_receive_event(struct snd_virmidi_dev *rdev,
 {
 	struct snd_virmidi *vmidi;
 	unsigned char msg[4];
-	int len;
+	unsigned char sysex[MAX_MIDI_EVENT_BUF];
+	int len, sysex_len = 0;
+
+	/* expand a small chained SysEx once, and pass it on in one go */
+	if (ev->type == SNDRV_SEQ_EVENT_SYSEX && snd_seq_ev_is_variable(ev) &&
+	    (ev->data.ext.len & SNDRV_SEQ_EXT_MASK) == SNDRV_SEQ_EXT_CHAINED)
+		sysex_len = snd_seq_expand_var_event(ev, sizeof(sysex), sysex,
+						     1, 0);
 
 	if (atomic)
 		read_lock(&rdev->filelist_lock);
@@ -94,7 +108,11 @@ static int snd_virmidi_dev_receive_event(struct snd_virmidi_dev *rdev,
 		if (ev->type == SNDRV_SEQ_EVENT_SYSEX) {
 			if ((ev->flags & SNDRV_SEQ_EVENT_LENGTH_MASK) != SNDRV_SEQ_EVENT_LENGTH_VARIABLE)
 				continue;
-			snd_seq_dump_var_event(ev, (snd_seq_dump_func_t)snd_rawmidi_receive, vmidi->substream);
+			if (sysex_len > 0)
+				snd_rawmidi_receive(vmidi->substream, sysex,
+						    sysex_len);
+			else
+				snd_seq_dump_var_event(ev, (snd_seq_dump_func_t)snd_rawmidi_receive, vmidi->substream);
 		} else {
 			len = snd_midi_event_decode(vmidi->parser, msg, sizeof(msg), ev);
 			if (len > 0)
@@ -154,6 +172,95 @@ static void snd_virmidi_input_trigger(struct snd_rawmidi_substream *substream, i
 	}
 }
 
+static void snd_virmidi_output_trigger(struct snd_rawmidi_substream *substream, int up);
+
+/*
+ * hand the collected SysEx data over to the work; called with
+ * runtime->lock held.  The output processing stops until the work has
+ * dispatched it, so that the events keep their order.
+ */
+static void snd_virmidi_output_sysex_flush(struct snd_virmidi *vmidi)
+{
+	swap(vmidi->sysex_buf, vmidi->sysex_flush_buf);
+	vmidi->sysex_flush_len = vmidi->sysex_len;
+	vmidi->sysex_len = 0;
+	schedule_work(&vmidi->sysex_work);
+}
+
+/*
+ * send the swapped out SysEx data as one event, which may take a while
+ * for a large message, so it's done without runtime->lock and in process
+ * context; on failure, the data is dropped, as some subscribers may have
+ * got it already.  Then resume the output processing.
+ */
+static void snd_virmidi_output_sysex_work(struct work_struct *work)
+{
+	struct snd_virmidi *vmidi =
+		container_of(work, struct snd_virmidi, sysex_work);
+	struct snd_rawmidi_substream *substream = vmidi->substream;
+	struct snd_seq_event ev;
+
+	snd_virmidi_init_event(vmidi, &ev);
+	ev.type = SNDRV_SEQ_EVENT_SYSEX;
+	ev.flags = SNDRV_SEQ_EVENT_LENGTH_VARIABLE;
+	ev.data.ext.len = vmidi->sysex_flush_len;
+	ev.data.ext.ptr = vmidi->sysex_flush_buf;
+	snd_seq_kernel_client_dispatch(vmidi->client, &ev, 0, 0);
+
+	spin_lock_irq(&substream->runtime->lock);
+	vmidi->sysex_flush_len = 0;
+	spin_unlock_irq(&substream->runtime->lock);
+	if (vmidi->trigger)
+		snd_virmidi_output_trigger(substream, 1);
+}
+
+/*
+ * collect SysEx data in the bulk buffer, straight from the rawmidi
+ * buffer, until its end or any other status byte; realtime messages in
+ * between are sent on their own.  Called with runtime->lock held.
+ * Returns true when the buffer is to be flushed.
+ */
+static bool snd_virmidi_output_sysex(struct snd_virmidi *vmidi,
+				     struct snd_rawmidi_substream *substream)
+{
+	unsigned char *p = vmidi->sysex_buf + vmidi->sysex_len;
+	struct snd_seq_event ev;
+	int i = 0, count, rt = 0;
+
+	count = __snd_rawmidi_transmit_peek(substream, p, vmidi->sysex_size -
+					    vmidi->sysex_len);
+	if (count <= 0)
+		return false;
+	if (!vmidi->in_sysex) {
+		/* starts with 0xf0, which cancels any partial message */
+		snd_midi_event_reset_encode(vmidi->parser);
+		vmidi->in_sysex = true;
+		i = 1;
+	}
+	for (; i < count; i++) {
+		if (!(p[i] & 0x80))
+			continue;
+		if (p[i] >= 0xf8) {
+			rt = p[i];
+			break;
+		}
+		if (p[i] == 0xf7)
+			i++;
+		vmidi->in_sysex = false;
+		break;
+	}
+	vmidi->sysex_len += i;
+	__snd_rawmidi_transmit_ack(substream, i + !!rt);
+	if (rt) {
+		snd_virmidi_init_event(vmidi, &ev);
+		if (snd_midi_event_encode_byte(vmidi->parser, rt, &ev) > 0)
+			snd_seq_kernel_client_dispatch(vmidi->client, &ev,
+						       in_atomic(), 0);
+	}
+	return vmidi->sysex_len &&
+		(!vmidi->in_sysex || vmidi->sysex_len == vmidi->sysex_size);
+}
+
 /*
  * trigger rawmidi stream for output
  */
@@ -174,18 +281,28 @@ static void snd_virmidi_output_trigger(struct snd_rawmidi_substream *substream,
 			}
 			return;
 		}
+		/* the SysEx work resumes the processing */
+		if (READ_ONCE(vmidi->sysex_flush_len))
+			return;
 		if (vmidi->event.type != SNDRV_SEQ_EVENT_NONE) {
 			if (snd_seq_kernel_client_dispatch(vmidi->client, &vmidi->event, in_atomic(), 0) < 0)
 				return;
 			vmidi->event.type = SNDRV_SEQ_EVENT_NONE;
 		}
 		spin_lock_irqsave(&substream->runtime->lock, flags);
-		while (1) {
+		while (!vmidi->sysex_flush_len) {
 			count = __snd_rawmidi_transmit_peek(substream, buf, sizeof(buf));
 			if (count <= 0)
 				break;
+			if (vmidi->sysex_buf && (vmidi->in_sysex || buf[0] == 0xf0)) {
+				if (snd_virmidi_output_sysex(vmidi, substream))
+					snd_virmidi_output_sysex_flush(vmidi);
+				continue;
+			}
 			pbuf = buf;
 			while (count > 0) {
+				if (vmidi->sysex_buf && *pbuf == 0xf0)
+					break;
 				res = snd_midi_event_encode(vmidi->parser, pbuf, count, &vmidi->event);
 				if (res < 0) {
 					snd_midi_event_reset_encode(vmidi->parser);
@@ -258,6 +375,22 @@ static int snd_virmidi_output_open(struct snd_rawmidi_substream *substream)
 	vmidi->seq_mode = rdev->seq_mode;
 	vmidi->client = rdev->client;
 	vmidi->port = rdev->port;
+	vmidi->sysex_size = clamp(READ_ONCE(bulk_sysex), 0, VIRMIDI_BULK_SYSEX_MAX);
+	if (vmidi->sysex_size) {
+		vmidi->sysex_size = max_t(unsigned int, vmidi->sysex_size,
+					  MAX_MIDI_EVENT_BUF);
+		vmidi->sysex_buf = kvmalloc(vmidi->sysex_size, GFP_KERNEL);
+		vmidi->sysex_flush_buf = kvmalloc(vmidi->sysex_size,
+						  GFP_KERNEL);
+		if (!vmidi->sysex_buf || !vmidi->sysex_flush_buf) {
+			kvfree(vmidi->sysex_buf);
+			kvfree(vmidi->sysex_flush_buf);
+			snd_midi_event_free(vmidi->parser);
+			kfree(vmidi);
+			return -ENOMEM;
+		}
+	}
+	INIT_WORK(&vmidi->sysex_work, snd_virmidi_output_sysex_work);
 	snd_virmidi_init_event(vmidi, &vmidi->event);
 	vmidi->rdev = rdev;
 	runtime->private_data = vmidi;
@@ -289,7 +422,11 @@ static int snd_virmidi_input_close(struct snd_rawmidi_substream *substream)
 static int snd_virmidi_output_close(struct snd_rawmidi_substream *substream)
 {
 	struct snd_virmidi *vmidi = substream->runtime->private_data;
+
+	cancel_work_sync(&vmidi->sysex_work);
 	snd_midi_event_free(vmidi->parser);
+	kvfree(vmidi->sysex_buf);
+	kvfree(vmidi->sysex_flush_buf);
 	substream->runtime->private_data = NULL;
 	kfree(vmidi);
 	return 0;
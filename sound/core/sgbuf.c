@@ -23,6 +23,9 @@
 #include <linux/mm.h>
 #include <linux/vmalloc.h>
 #include <linux/export.h>
+#include <linux/scatterlist.h>
+#include <linux/dma-mapping.h>
+#include <linux/iommu.h>
 #include <sound/memalloc.h>
 
 
@@ -42,6 +45,16 @@ int snd_free_sgbuf_pages(struct snd_dma_buffer *dmab)
 	vunmap(dmab->area);
 	dmab->area = NULL;
 
+	if (sgbuf->sgt) {
+		dma_unmap_sg(sgbuf->dev, sgbuf->sgt->sgl, sgbuf->sgt->orig_nents,
+			     DMA_BIDIRECTIONAL);
+		sg_free_table(sgbuf->sgt);
+		kfree(sgbuf->sgt);
+		for (i = 0; i < sgbuf->pages; i++)
+			__free_page(sgbuf->page_table[i]);
+		goto free_table;
+	}
+
 	tmpb.dev.type = SNDRV_DMA_TYPE_DEV;
 	tmpb.dev.dev = sgbuf->dev;
 	for (i = 0; i < sgbuf->pages; i++) {
@@ -53,8 +66,10 @@ int snd_free_sgbuf_pages(struct snd_dma_buffer *dmab)
 		snd_dma_free_pages(&tmpb);
 	}
 
+ free_table:
 	kfree(sgbuf->table);
 	kfree(sgbuf->page_table);
+	kfree(sgbuf->contig);
 	kfree(sgbuf);
 	dmab->private_data = NULL;
 	
@@ -63,6 +78,102 @@ int snd_free_sgbuf_pages(struct snd_dma_buffer *dmab)
 
 #define MAX_ALLOC_PAGES		32
 
+/*
+ * With an IOMMU in front of the device, map single pages to one continuous
+ * DMA address range, so that the whole buffer is a single chunk for the
+ * device.  The pages come from the page allocator, hence this is done only
+ * where the streaming mapping is cache-coherent without explicit syncs,
+ * and only for a translating IOMMU domain: with pass-through or swiotlb,
+ * the device would see the physical pages or bounce buffers instead.
+ * Returns false if the mapping isn't available or isn't continuous; the
+ * caller falls back to the coherent chunk allocation.
+ */
+static bool sgbuf_alloc_iommu(struct snd_sg_buf *sgbuf, unsigned int pages)
+{
+	struct device *dev = sgbuf->dev;
+	struct iommu_domain *domain;
+	struct scatterlist *sg;
+	struct sg_table *sgt;
+	gfp_t gfp = GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN;
+	dma_addr_t addr;
+	size_t ofs;
+	int i, nents;
+
+	if (!IS_ENABLED(CONFIG_X86) || !dev || !dev->iommu_group)
+		return false;
+	domain = iommu_get_domain_for_dev(dev);
+	if (!domain || domain->type != IOMMU_DOMAIN_DMA)
+		return false;
+
+	/* keep the pages reachable even if the translation is turned off */
+	if (dma_get_mask(dev) <= DMA_BIT_MASK(32))
+		gfp |= __GFP_DMA32;
+	for (i = 0; i < pages; i++) {
+		sgbuf->page_table[i] = alloc_page(gfp);
+		if (!sgbuf->page_table[i])
+			goto free_pages;
+	}
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		goto free_pages;
+	if (sg_alloc_table_from_pages(sgt, sgbuf->page_table, pages, 0,
+				      (size_t)pages << PAGE_SHIFT, GFP_KERNEL))
+		goto free_sgt;
+	nents = dma_map_sg(dev, sgt->sgl, sgt->orig_nents, DMA_BIDIRECTIONAL);
+	if (!nents)
+		goto free_table;
+
+	/* no IOMMU translation (e.g. pass-through) gives scattered addresses */
+	addr = sg_dma_address(sgt->sgl);
+	ofs = 0;
+	for_each_sg(sgt->sgl, sg, nents, i) {
+		if (sg_dma_address(sg) != addr + ofs)
+			goto unmap;
+		ofs += sg_dma_len(sg);
+	}
+	if (ofs != (size_t)pages << PAGE_SHIFT ||
+	    addr + ofs - 1 > dma_get_mask(dev))
+		goto unmap;
+
+	for (i = 0; i < pages; i++) {
+		sgbuf->table[i].buf = page_address(sgbuf->page_table[i]);
+		sgbuf->table[i].addr = addr + ((dma_addr_t)i << PAGE_SHIFT);
+	}
+	sgbuf->sgt = sgt;
+	sgbuf->pages = pages;
+	return true;
+
+ unmap:
+	dma_unmap_sg(dev, sgt->sgl, sgt->orig_nents, DMA_BIDIRECTIONAL);
+ free_table:
+	sg_free_table(sgt);
+ free_sgt:
+	kfree(sgt);
+ free_pages:
+	for (i = 0; i < pages && sgbuf->page_table[i]; i++) {
+		__free_page(sgbuf->page_table[i]);
+		sgbuf->page_table[i] = NULL;
+	}
+	return false;
+}
+
+/* record the length of the physically continuous run from each page */
+static void sgbuf_merge_chunks(struct snd_sg_buf *sgbuf)
+{
+	struct snd_sg_page *table = sgbuf->table;
+	int i;
+
+	sgbuf->contig[sgbuf->pages - 1] = 1;
+	for (i = sgbuf->pages - 2; i >= 0; i--) {
+		if ((table[i + 1].addr >> PAGE_SHIFT) ==
+		    (table[i].addr >> PAGE_SHIFT) + 1)
+			sgbuf->contig[i] = sgbuf->contig[i + 1] + 1;
+		else
+			sgbuf->contig[i] = 1;
+	}
+}
+
 void *snd_malloc_sgbuf_pages(struct device *device,
 			     size_t size, struct snd_dma_buffer *dmab,
 			     size_t *res_size)
@@ -89,6 +200,13 @@ void *snd_malloc_sgbuf_pages(struct device *device,
 	if (!pgtable)
 		goto _failed;
 	sgbuf->page_table = pgtable;
+	sgbuf->contig = kcalloc(sgbuf->tblsize, sizeof(*sgbuf->contig),
+				GFP_KERNEL);
+	if (!sgbuf->contig)
+		goto _failed;
+
+	if (sgbuf_alloc_iommu(sgbuf, pages))
+		pages = 0;
 
 	/* allocate pages */
 	maxpages = MAX_ALLOC_PAGES;
@@ -125,6 +243,7 @@ void *snd_malloc_sgbuf_pages(struct device *device,
 	}
 
 	sgbuf->size = size;
+	sgbuf_merge_chunks(sgbuf);
 	dmab->area = vmap(sgbuf->page_table, sgbuf->pages, VM_MAP, PAGE_KERNEL);
 	if (! dmab->area)
 		goto _failed;
@@ -144,21 +263,9 @@ unsigned int snd_sgbuf_get_chunk_size(struct snd_dma_buffer *dmab,
 				      unsigned int ofs, unsigned int size)
 {
 	struct snd_sg_buf *sg = dmab->private_data;
-	unsigned int start, end, pg;
-
-	start = ofs >> PAGE_SHIFT;
-	end = (ofs + size - 1) >> PAGE_SHIFT;
-	/* check page continuity */
-	pg = sg->table[start].addr >> PAGE_SHIFT;
-	for (;;) {
-		start++;
-		if (start > end)
-			break;
-		pg++;
-		if ((sg->table[start].addr >> PAGE_SHIFT) != pg)
-			return (start << PAGE_SHIFT) - ofs;
-	}
-	/* ok, all on continuous pages */
-	return size;
+	unsigned int run;
+
+	run = (sg->contig[ofs >> PAGE_SHIFT] << PAGE_SHIFT) - ofs % PAGE_SIZE;
+	return min(run, size);
 }
 EXPORT_SYMBOL(snd_sgbuf_get_chunk_size);
@@ -28,6 +28,12 @@
 #include <linux/module.h>
 #include <linux/string.h>
 #include <linux/sched/signal.h>
+#include <linux/workqueue.h>
+#include <linux/percpu.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/hashtable.h>
+#include <uapi/linux/sched/types.h>
 #include <sound/core.h>
 #include <sound/timer.h>
 #include <sound/control.h>
@@ -47,6 +53,8 @@
 
 static int timer_limit = DEFAULT_TIMER_LIMIT;
 static int timer_tstamp_monotonic = 1;
+static int timer_dispatch = SNDRV_TIMER_DISPATCH_TASKLET;
+static int timer_rt_prio = SNDRV_RT_PRIO;
 MODULE_AUTHOR("Jaroslav Kysela <perex@perex.cz>, Takashi Iwai <tiwai@suse.de>");
 MODULE_DESCRIPTION("ALSA timer interface");
 MODULE_LICENSE("GPL");
@@ -54,6 +62,10 @@ module_param(timer_limit, int, 0444);
 MODULE_PARM_DESC(timer_limit, "Maximum global timers in system.");
 module_param(timer_tstamp_monotonic, int, 0444);
 MODULE_PARM_DESC(timer_tstamp_monotonic, "Use posix monotonic clock source for timestamps (default).");
+module_param(timer_dispatch, int, 0444);
+MODULE_PARM_DESC(timer_dispatch, "Default slow callback delivery (0 = tasklet, 1 = per-CPU work, 2 = RT kthread).");
+module_param(timer_rt_prio, int, 0444);
+MODULE_PARM_DESC(timer_rt_prio, "SCHED_FIFO priority of the timer kthreads (1-99).");
 
 MODULE_ALIAS_CHARDEV(CONFIG_SND_MAJOR, SNDRV_MINOR_TIMER);
 MODULE_ALIAS("devname:snd/timer");
@@ -70,6 +82,9 @@ struct snd_timer_user {
 	bool disconnected;
 	struct snd_timer_read *queue;
 	struct snd_timer_tread *tqueue;
+	struct snd_timer_mmap_ring *ring;	/* mmapped event ring */
+	unsigned int ring_size;
+	u32 ring_tail;				/* kernel copy of ring->tail */
 	spinlock_t qlock;
 	unsigned long last_resolution;
 	unsigned int filter;
@@ -85,6 +100,38 @@ static LIST_HEAD(snd_timer_list);
 /* list of slave instances */
 static LIST_HEAD(snd_timer_slave_list);
 
+/*
+ * lookup indices, protected by register_mutex:
+ * the registered timers by their id, and the master instances plus the
+ * pending (unattached) slave instances by slave class/id
+ */
+#define SNDRV_TIMER_HASH_BITS	6
+static DEFINE_HASHTABLE(snd_timer_hash, SNDRV_TIMER_HASH_BITS);
+static DEFINE_HASHTABLE(snd_timer_master_hash, SNDRV_TIMER_HASH_BITS);
+static DEFINE_HASHTABLE(snd_timer_slave_hash, SNDRV_TIMER_HASH_BITS);
+
+static u32 snd_timer_id_key(int dev_class, int card, int device, int subdevice)
+{
+	/* the card number counts only for card and PCM timers */
+	if (dev_class != SNDRV_TIMER_CLASS_CARD &&
+	    dev_class != SNDRV_TIMER_CLASS_PCM)
+		card = -1;
+	return ((u32)dev_class << 24) ^ ((u32)card << 16) ^
+		((u32)device << 8) ^ (u32)subdevice;
+}
+
+static u32 snd_timer_dev_key(struct snd_timer *timer)
+{
+	return snd_timer_id_key(timer->tmr_class,
+				timer->card ? timer->card->number : -1,
+				timer->tmr_device, timer->tmr_subdevice);
+}
+
+static u32 snd_timer_slave_key(struct snd_timer_instance *timeri)
+{
+	return ((u32)timeri->slave_class << 28) ^ timeri->slave_id;
+}
+
 /* lock for slave active lists */
 static DEFINE_SPINLOCK(slave_active_lock);
 
@@ -114,6 +161,7 @@ static struct snd_timer_instance *snd_timer_instance_new(char *owner,
 		return NULL;
 	}
 	INIT_LIST_HEAD(&timeri->open_list);
+	INIT_HLIST_NODE(&timeri->slave_hash);
 	INIT_LIST_HEAD(&timeri->active_list);
 	INIT_LIST_HEAD(&timeri->ack_list);
 	INIT_LIST_HEAD(&timeri->slave_list_head);
@@ -136,7 +184,9 @@ static struct snd_timer *snd_timer_find(struct snd_timer_id *tid)
 {
 	struct snd_timer *timer = NULL;
 
-	list_for_each_entry(timer, &snd_timer_list, device_list) {
+	hash_for_each_possible(snd_timer_hash, timer, hash_node,
+			       snd_timer_id_key(tid->dev_class, tid->card,
+						tid->device, tid->subdevice)) {
 		if (timer->tmr_class != tid->dev_class)
 			continue;
 		if ((timer->tmr_class == SNDRV_TIMER_CLASS_CARD ||
@@ -182,27 +232,27 @@ static void snd_timer_request(struct snd_timer_id *tid)
  */
 static int snd_timer_check_slave(struct snd_timer_instance *slave)
 {
-	struct snd_timer *timer;
 	struct snd_timer_instance *master;
 
-	/* FIXME: it's really dumb to look up all entries.. */
-	list_for_each_entry(timer, &snd_timer_list, device_list) {
-		list_for_each_entry(master, &timer->open_list_head, open_list) {
-			if (slave->slave_class == master->slave_class &&
-			    slave->slave_id == master->slave_id) {
-				if (master->timer->num_instances >=
-				    master->timer->max_instances)
-					return -EBUSY;
-				list_move_tail(&slave->open_list,
-					       &master->slave_list_head);
-				master->timer->num_instances++;
-				spin_lock_irq(&slave_active_lock);
-				slave->master = master;
-				slave->timer = master->timer;
-				spin_unlock_irq(&slave_active_lock);
-				return 0;
-			}
-		}
+	hash_for_each_possible(snd_timer_master_hash, master, slave_hash,
+			       snd_timer_slave_key(slave)) {
+		if (slave->slave_class != master->slave_class ||
+		    slave->slave_id != master->slave_id)
+			continue;
+		/* skip the masters of freed or disconnected timers */
+		if (!master->timer || list_empty(&master->timer->device_list))
+			continue;
+		if (master->timer->num_instances >=
+		    master->timer->max_instances)
+			return -EBUSY;
+		hash_del(&slave->slave_hash);
+		list_move_tail(&slave->open_list, &master->slave_list_head);
+		master->timer->num_instances++;
+		spin_lock_irq(&slave_active_lock);
+		slave->master = master;
+		slave->timer = master->timer;
+		spin_unlock_irq(&slave_active_lock);
+		return 0;
 	}
 	return 0;
 }
@@ -215,15 +265,18 @@ static int snd_timer_check_slave(struct snd_timer_instance *slave)
  */
 static int snd_timer_check_master(struct snd_timer_instance *master)
 {
-	struct snd_timer_instance *slave, *tmp;
+	struct snd_timer_instance *slave;
+	struct hlist_node *tmp;
 
-	/* check all pending slaves */
-	list_for_each_entry_safe(slave, tmp, &snd_timer_slave_list, open_list) {
+	/* check all pending slaves with the same slave id */
+	hash_for_each_possible_safe(snd_timer_slave_hash, slave, tmp, slave_hash,
+				    snd_timer_slave_key(master)) {
 		if (slave->slave_class == master->slave_class &&
 		    slave->slave_id == master->slave_id) {
 			if (master->timer->num_instances >=
 			    master->timer->max_instances)
 				return -EBUSY;
+			hash_del(&slave->slave_hash);
 			list_move_tail(&slave->open_list, &master->slave_list_head);
 			master->timer->num_instances++;
 			spin_lock_irq(&slave_active_lock);
@@ -272,6 +325,8 @@ int snd_timer_open(struct snd_timer_instance **ti,
 		timeri->slave_id = tid->device;
 		timeri->flags |= SNDRV_TIMER_IFLG_SLAVE;
 		list_add_tail(&timeri->open_list, &snd_timer_slave_list);
+		hash_add(snd_timer_slave_hash, &timeri->slave_hash,
+			 snd_timer_slave_key(timeri));
 		err = snd_timer_check_slave(timeri);
 		if (err < 0) {
 			snd_timer_close_locked(timeri);
@@ -335,6 +390,8 @@ int snd_timer_open(struct snd_timer_instance **ti,
 	}
 
 	list_add_tail(&timeri->open_list, &timer->open_list_head);
+	hash_add(snd_timer_master_hash, &timeri->slave_hash,
+		 snd_timer_slave_key(timeri));
 	timer->num_instances++;
 	err = snd_timer_check_master(timeri);
 	if (err < 0) {
@@ -357,6 +414,7 @@ static int snd_timer_close_locked(struct snd_timer_instance *timeri)
 	struct snd_timer_instance *slave, *tmp;
 
 	list_del(&timeri->open_list);
+	hash_del(&timeri->slave_hash);
 
 	/* force to stop the timer */
 	snd_timer_stop(timeri);
@@ -379,6 +437,8 @@ static int snd_timer_close_locked(struct snd_timer_instance *timeri)
 		list_for_each_entry_safe(slave, tmp, &timeri->slave_list_head,
 					 open_list) {
 			list_move_tail(&slave->open_list, &snd_timer_slave_list);
+			hash_add(snd_timer_slave_hash, &slave->slave_hash,
+				 snd_timer_slave_key(slave));
 			timer->num_instances--;
 			slave->master = NULL;
 			slave->timer = NULL;
@@ -628,6 +688,7 @@ int snd_timer_start(struct snd_timer_instance *timeri, unsigned int ticks)
 {
 	if (timeri == NULL || ticks < 1)
 		return -EINVAL;
+	timeri->cpu = raw_smp_processor_id();
 	if (timeri->flags & SNDRV_TIMER_IFLG_SLAVE)
 		return snd_timer_start_slave(timeri, true);
 	else
@@ -658,6 +719,7 @@ int snd_timer_continue(struct snd_timer_instance *timeri)
 	if (!(timeri->flags & SNDRV_TIMER_IFLG_PAUSED))
 		return -EINVAL;
 
+	timeri->cpu = raw_smp_processor_id();
 	if (timeri->flags & SNDRV_TIMER_IFLG_SLAVE)
 		return snd_timer_start_slave(timeri, false);
 	else
@@ -710,13 +772,17 @@ static void snd_timer_reschedule(struct snd_timer * timer, unsigned long ticks_l
 	timer->sticks = ticks;
 }
 
-/*
- * timer tasklet
- *
- */
-static void snd_timer_tasklet(unsigned long arg)
+/* per-CPU slow callback queue of a timer */
+struct snd_timer_work {
+	struct snd_timer *timer;
+	struct list_head sack_list_head;
+	struct work_struct work;
+};
+
+/* process the queued slow callbacks */
+static void snd_timer_process_slow(struct snd_timer *timer,
+				   struct list_head *sack_list_head)
 {
-	struct snd_timer *timer = (struct snd_timer *) arg;
 	struct snd_timer_instance *ti;
 	struct list_head *p;
 	unsigned long resolution, ticks;
@@ -727,8 +793,8 @@ static void snd_timer_tasklet(unsigned long arg)
 
 	spin_lock_irqsave(&timer->lock, flags);
 	/* now process all callbacks */
-	while (!list_empty(&timer->sack_list_head)) {
-		p = timer->sack_list_head.next;		/* get first item */
+	while (!list_empty(sack_list_head)) {
+		p = sack_list_head->next;		/* get first item */
 		ti = list_entry(p, struct snd_timer_instance, ack_list);
 
 		/* remove from ack_list and make empty */
@@ -748,6 +814,73 @@ static void snd_timer_tasklet(unsigned long arg)
 	spin_unlock_irqrestore(&timer->lock, flags);
 }
 
+/*
+ * timer tasklet
+ *
+ */
+static void snd_timer_tasklet(unsigned long arg)
+{
+	struct snd_timer *timer = (struct snd_timer *) arg;
+
+	snd_timer_process_slow(timer, &timer->sack_list_head);
+}
+
+/*
+ * The callbacks expect the tasklet context, hence BH is disabled while
+ * running them from the work and the kthread, too.
+ */
+static void snd_timer_work(struct work_struct *work)
+{
+	struct snd_timer_work *w = container_of(work, struct snd_timer_work,
+						work);
+
+	local_bh_disable();
+	snd_timer_process_slow(w->timer, &w->sack_list_head);
+	local_bh_enable();
+}
+
+static void snd_timer_kwork(struct kthread_work *work)
+{
+	struct snd_timer *timer = container_of(work, struct snd_timer, kwork);
+
+	local_bh_disable();
+	snd_timer_process_slow(timer, &timer->sack_list_head);
+	local_bh_enable();
+}
+
+/* the slow callback queue for the instance; call with timer->lock */
+static struct list_head *snd_timer_sack_list(struct snd_timer *timer,
+					     struct snd_timer_instance *ti)
+{
+	if (timer->dispatch != SNDRV_TIMER_DISPATCH_WORK)
+		return &timer->sack_list_head;
+	cpumask_set_cpu(ti->cpu, timer->sack_cpus);
+	return &per_cpu_ptr(timer->cpu_works, ti->cpu)->sack_list_head;
+}
+
+/* kick the slow callback delivery; call with timer->lock
+ * returns true if the tasklet needs to be scheduled
+ */
+static bool snd_timer_kick_slow(struct snd_timer *timer)
+{
+	int cpu;
+
+	switch (timer->dispatch) {
+	case SNDRV_TIMER_DISPATCH_WORK:
+		for_each_cpu(cpu, timer->sack_cpus)
+			queue_work_on(cpu, system_highpri_wq,
+				      &per_cpu_ptr(timer->cpu_works, cpu)->work);
+		cpumask_clear(timer->sack_cpus);
+		return false;
+	case SNDRV_TIMER_DISPATCH_KTHREAD:
+		if (!list_empty(&timer->sack_list_head))
+			kthread_queue_work(timer->kworker, &timer->kwork);
+		return false;
+	default:
+		return !list_empty(&timer->sack_list_head);
+	}
+}
+
 /*
  * timer interrupt
  *
@@ -758,9 +891,9 @@ void snd_timer_interrupt(struct snd_timer * timer, unsigned long ticks_left)
 {
 	struct snd_timer_instance *ti, *ts, *tmp;
 	unsigned long resolution, ticks;
-	struct list_head *p, *ack_list_head;
+	struct list_head *p;
 	unsigned long flags;
-	int use_tasklet = 0;
+	bool fast, use_tasklet;
 
 	if (timer == NULL)
 		return;
@@ -800,18 +933,19 @@ void snd_timer_interrupt(struct snd_timer * timer, unsigned long ticks_left)
 			--timer->running;
 			list_del_init(&ti->active_list);
 		}
-		if ((timer->hw.flags & SNDRV_TIMER_HW_TASKLET) ||
-		    (ti->flags & SNDRV_TIMER_IFLG_FAST))
-			ack_list_head = &timer->ack_list_head;
-		else
-			ack_list_head = &timer->sack_list_head;
+		fast = (timer->hw.flags & SNDRV_TIMER_HW_TASKLET) ||
+			(ti->flags & SNDRV_TIMER_IFLG_FAST);
 		if (list_empty(&ti->ack_list))
-			list_add_tail(&ti->ack_list, ack_list_head);
+			list_add_tail(&ti->ack_list,
+				      fast ? &timer->ack_list_head :
+				      snd_timer_sack_list(timer, ti));
 		list_for_each_entry(ts, &ti->slave_active_head, active_list) {
 			ts->pticks = ti->pticks;
 			ts->resolution = resolution;
 			if (list_empty(&ts->ack_list))
-				list_add_tail(&ts->ack_list, ack_list_head);
+				list_add_tail(&ts->ack_list,
+					      fast ? &timer->ack_list_head :
+					      snd_timer_sack_list(timer, ts));
 		}
 	}
 	if (timer->flags & SNDRV_TIMER_FLG_RESCHED)
@@ -851,7 +985,7 @@ void snd_timer_interrupt(struct snd_timer * timer, unsigned long ticks_left)
 	}
 
 	/* do we have any slow callbacks? */
-	use_tasklet = !list_empty(&timer->sack_list_head);
+	use_tasklet = snd_timer_kick_slow(timer);
 	spin_unlock_irqrestore(&timer->lock, flags);
 
 	if (use_tasklet)
@@ -889,6 +1023,7 @@ int snd_timer_new(struct snd_card *card, char *id, struct snd_timer_id *tid,
 		strlcpy(timer->id, id, sizeof(timer->id));
 	timer->sticks = 1;
 	INIT_LIST_HEAD(&timer->device_list);
+	INIT_HLIST_NODE(&timer->hash_node);
 	INIT_LIST_HEAD(&timer->open_list_head);
 	INIT_LIST_HEAD(&timer->active_list_head);
 	INIT_LIST_HEAD(&timer->ack_list_head);
@@ -896,6 +1031,8 @@ int snd_timer_new(struct snd_card *card, char *id, struct snd_timer_id *tid,
 	spin_lock_init(&timer->lock);
 	tasklet_init(&timer->task_queue, snd_timer_tasklet,
 		     (unsigned long)timer);
+	if (timer_dispatch != SNDRV_TIMER_DISPATCH_TASKLET)
+		snd_timer_set_dispatch(timer, timer_dispatch);
 	timer->max_instances = 1000; /* default limit per timer */
 	if (card != NULL) {
 		timer->module = card->module;
@@ -911,6 +1048,94 @@ int snd_timer_new(struct snd_card *card, char *id, struct snd_timer_id *tid,
 }
 EXPORT_SYMBOL(snd_timer_new);
 
+static void snd_timer_free_dispatch(struct snd_timer *timer)
+{
+	int cpu;
+
+	if (timer->cpu_works) {
+		for_each_possible_cpu(cpu)
+			cancel_work_sync(&per_cpu_ptr(timer->cpu_works, cpu)->work);
+		free_percpu(timer->cpu_works);
+		timer->cpu_works = NULL;
+		free_cpumask_var(timer->sack_cpus);
+	}
+	if (timer->kworker) {
+		kthread_destroy_worker(timer->kworker);
+		timer->kworker = NULL;
+	}
+}
+
+/*
+ * select the delivery of the slow callbacks;
+ * the timer must not be in use
+ */
+int snd_timer_set_dispatch(struct snd_timer *timer, int dispatch)
+{
+	struct sched_param param = {
+		.sched_priority = clamp(timer_rt_prio, 1, MAX_RT_PRIO - 1),
+	};
+	struct snd_timer_work *w;
+	int cpu, err = 0;
+
+	if (dispatch < SNDRV_TIMER_DISPATCH_TASKLET ||
+	    dispatch > SNDRV_TIMER_DISPATCH_KTHREAD)
+		return -EINVAL;
+	mutex_lock(&register_mutex);
+	if (dispatch == timer->dispatch)
+		goto unlock;
+	if (!list_empty(&timer->open_list_head)) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	/* fall back to the tasklet until the new resources are ready */
+	spin_lock_irq(&timer->lock);
+	timer->dispatch = SNDRV_TIMER_DISPATCH_TASKLET;
+	spin_unlock_irq(&timer->lock);
+	snd_timer_free_dispatch(timer);
+
+	switch (dispatch) {
+	case SNDRV_TIMER_DISPATCH_WORK:
+		if (!zalloc_cpumask_var(&timer->sack_cpus, GFP_KERNEL)) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+		timer->cpu_works = alloc_percpu(struct snd_timer_work);
+		if (!timer->cpu_works) {
+			free_cpumask_var(timer->sack_cpus);
+			err = -ENOMEM;
+			goto unlock;
+		}
+		for_each_possible_cpu(cpu) {
+			w = per_cpu_ptr(timer->cpu_works, cpu);
+			w->timer = timer;
+			INIT_LIST_HEAD(&w->sack_list_head);
+			INIT_WORK(&w->work, snd_timer_work);
+		}
+		break;
+	case SNDRV_TIMER_DISPATCH_KTHREAD:
+		timer->kworker = kthread_create_worker(0, "snd-timer/%s",
+						       timer->id);
+		if (IS_ERR(timer->kworker)) {
+			err = PTR_ERR(timer->kworker);
+			timer->kworker = NULL;
+			goto unlock;
+		}
+		sched_setscheduler_nocheck(timer->kworker->task, SCHED_FIFO,
+					   &param);
+		kthread_init_work(&timer->kwork, snd_timer_kwork);
+		break;
+	}
+
+	spin_lock_irq(&timer->lock);
+	timer->dispatch = dispatch;
+	spin_unlock_irq(&timer->lock);
+ unlock:
+	mutex_unlock(&register_mutex);
+	return err;
+}
+EXPORT_SYMBOL(snd_timer_set_dispatch);
+
 static int snd_timer_free(struct snd_timer *timer)
 {
 	if (!timer)
@@ -928,10 +1153,12 @@ static int snd_timer_free(struct snd_timer *timer)
 		}
 	}
 	list_del(&timer->device_list);
+	hash_del(&timer->hash_node);
 	mutex_unlock(&register_mutex);
 
 	if (timer->private_free)
 		timer->private_free(timer);
+	snd_timer_free_dispatch(timer);
 	kfree(timer);
 	return 0;
 }
@@ -978,6 +1205,7 @@ static int snd_timer_dev_register(struct snd_device *dev)
 		return -EBUSY;
 	}
 	list_add_tail(&timer->device_list, &timer1->device_list);
+	hash_add(snd_timer_hash, &timer->hash_node, snd_timer_dev_key(timer));
 	mutex_unlock(&register_mutex);
 	return 0;
 }
@@ -989,6 +1217,7 @@ static int snd_timer_dev_disconnect(struct snd_device *device)
 
 	mutex_lock(&register_mutex);
 	list_del_init(&timer->device_list);
+	hash_del(&timer->hash_node);
 	/* wake up pending sleepers */
 	list_for_each_entry(ti, &timer->open_list_head, open_list) {
 		if (ti->disconnect)
@@ -1182,7 +1411,12 @@ static void snd_timer_proc_read(struct snd_info_entry *entry,
 			continue;
 		switch (timer->tmr_class) {
 		case SNDRV_TIMER_CLASS_GLOBAL:
-			snd_iprintf(buffer, "G%i: ", timer->tmr_device);
+			if (timer->tmr_subdevice)
+				snd_iprintf(buffer, "G%i-%i: ",
+					    timer->tmr_device,
+					    timer->tmr_subdevice);
+			else
+				snd_iprintf(buffer, "G%i: ", timer->tmr_device);
 			break;
 		case SNDRV_TIMER_CLASS_CARD:
 			snd_iprintf(buffer, "C%i-%i: ",
@@ -1278,9 +1512,42 @@ static void snd_timer_user_interrupt(struct snd_timer_instance *timeri,
 	wake_up(&tu->qchange_sleep);
 }
 
+/* number of events pending in the mmapped ring; call with qlock */
+static unsigned int snd_timer_user_ring_used(struct snd_timer_user *tu)
+{
+	/* head comes from user-space, don't trust it */
+	return min_t(u32, tu->ring_tail - READ_ONCE(tu->ring->head),
+		     tu->ring_size);
+}
+
+static void snd_timer_user_append_to_ring(struct snd_timer_user *tu,
+					  struct snd_timer_tread *tread)
+{
+	struct snd_timer_mmap_ring *ring = tu->ring;
+	struct snd_timer_ring_event *ev;
+
+	if (tu->ring_tail - READ_ONCE(ring->head) >= tu->ring_size) {
+		tu->overrun++;
+		WRITE_ONCE(ring->overrun, ring->overrun + 1);
+		return;
+	}
+	ev = &ring->events[tu->ring_tail % tu->ring_size];
+	ev->event = tread->event;
+	ev->val = tread->val;
+	ev->tstamp_sec = tread->tstamp.tv_sec;
+	ev->tstamp_nsec = tread->tstamp.tv_nsec;
+	/* publish the event before the new tail */
+	smp_wmb();
+	WRITE_ONCE(ring->tail, ++tu->ring_tail);
+}
+
 static void snd_timer_user_append_to_tqueue(struct snd_timer_user *tu,
 					    struct snd_timer_tread *tread)
 {
+	if (tu->ring) {
+		snd_timer_user_append_to_ring(tu, tread);
+		return;
+	}
 	if (tu->qused >= tu->queue_size) {
 		tu->overrun++;
 	} else {
@@ -1387,6 +1654,9 @@ static int realloc_user_queue(struct snd_timer_user *tu, int size)
 	struct snd_timer_read *queue = NULL;
 	struct snd_timer_tread *tqueue = NULL;
 
+	/* the mapped ring is sized at mmap time */
+	if (tu->ring)
+		return -EBUSY;
 	if (tu->tread) {
 		tqueue = kcalloc(size, sizeof(*tqueue), GFP_KERNEL);
 		if (!tqueue)
@@ -1446,6 +1716,7 @@ static int snd_timer_user_release(struct inode *inode, struct file *file)
 		mutex_unlock(&tu->ioctl_lock);
 		kfree(tu->queue);
 		kfree(tu->tqueue);
+		vfree(tu->ring);
 		kfree(tu);
 	}
 	return 0;
@@ -1489,14 +1760,27 @@ static int snd_timer_user_next_device(struct snd_timer_id __user *_tid)
 	} else {
 		switch (id.dev_class) {
 		case SNDRV_TIMER_CLASS_GLOBAL:
-			id.device = id.device < 0 ? 0 : id.device + 1;
+			/* global timers may have subdevices, e.g. the
+			 * per-CPU hrtimers; a negative subdevice skips them
+			 */
+			if (id.device < 0) {
+				id.device = 0;
+				id.subdevice = 0;
+			} else if (id.subdevice < 0) {
+				id.device++;
+				id.subdevice = 0;
+			} else {
+				id.subdevice++;
+			}
 			list_for_each(p, &snd_timer_list) {
 				timer = list_entry(p, struct snd_timer, device_list);
 				if (timer->tmr_class > SNDRV_TIMER_CLASS_GLOBAL) {
 					snd_timer_user_copy_id(&id, timer);
 					break;
 				}
-				if (timer->tmr_device >= id.device) {
+				if (timer->tmr_device > id.device ||
+				    (timer->tmr_device == id.device &&
+				     timer->tmr_subdevice >= id.subdevice)) {
 					snd_timer_user_copy_id(&id, timer);
 					break;
 				}
@@ -1854,7 +2138,7 @@ static int snd_timer_user_status(struct file *file,
 	status.lost = tu->timeri->lost;
 	status.overrun = tu->overrun;
 	spin_lock_irq(&tu->qlock);
-	status.queue = tu->qused;
+	status.queue = tu->ring ? snd_timer_user_ring_used(tu) : tu->qused;
 	spin_unlock_irq(&tu->qlock);
 	if (copy_to_user(_status, &status, sizeof(status)))
 		return -EFAULT;
@@ -1934,7 +2218,7 @@ static long __snd_timer_user_ioctl(struct file *file, unsigned int cmd,
 		return snd_timer_user_next_device(argp);
 	case SNDRV_TIMER_IOCTL_TREAD:
 	{
-		int xarg, old_tread;
+		int xarg, old_tread, err;
 
 		if (tu->timeri)	/* too late */
 			return -EBUSY;
@@ -1942,10 +2226,12 @@ static long __snd_timer_user_ioctl(struct file *file, unsigned int cmd,
 			return -EFAULT;
 		old_tread = tu->tread;
 		tu->tread = xarg ? 1 : 0;
-		if (tu->tread != old_tread &&
-		    realloc_user_queue(tu, tu->queue_size) < 0) {
-			tu->tread = old_tread;
-			return -ENOMEM;
+		if (tu->tread != old_tread) {
+			err = realloc_user_queue(tu, tu->queue_size);
+			if (err < 0) {
+				tu->tread = old_tread;
+				return err;
+			}
 		}
 		return 0;
 	}
@@ -2008,6 +2294,9 @@ static ssize_t snd_timer_user_read(struct file *file, char __user *buffer,
 	int err = 0;
 
 	tu = file->private_data;
+	/* the events go to the mmapped ring instead */
+	if (tu->ring)
+		return -EBADFD;
 	unit = tu->tread ? sizeof(struct snd_timer_tread) : sizeof(struct snd_timer_read);
 	mutex_lock(&tu->ioctl_lock);
 	spin_lock_irq(&tu->qlock);
@@ -2080,7 +2369,7 @@ static unsigned int snd_timer_user_poll(struct file *file, poll_table * wait)
 
 	mask = 0;
 	spin_lock_irq(&tu->qlock);
-	if (tu->qused)
+	if (tu->ring ? snd_timer_user_ring_used(tu) : tu->qused)
 		mask |= POLLIN | POLLRDNORM;
 	if (tu->disconnected)
 		mask |= POLLERR;
@@ -2089,6 +2378,49 @@ static unsigned int snd_timer_user_poll(struct file *file, poll_table * wait)
 	return mask;
 }
 
+/*
+ * map the event ring; the ring replaces the read queue from now on
+ */
+static int snd_timer_user_mmap(struct file *file, struct vm_area_struct *area)
+{
+	struct snd_timer_user *tu = file->private_data;
+	struct snd_timer_mmap_ring *ring;
+	unsigned long size;
+	int err = 0;
+
+	if (area->vm_pgoff)
+		return -EINVAL;
+	mutex_lock(&tu->ioctl_lock);
+	if (!tu->tread) {
+		err = -EBADFD;
+		goto unlock;
+	}
+	size = PAGE_ALIGN(sizeof(*ring) +
+			  tu->queue_size * sizeof(struct snd_timer_ring_event));
+	if (area->vm_end - area->vm_start > size) {
+		err = -EINVAL;
+		goto unlock;
+	}
+	if (!tu->ring) {
+		ring = vmalloc_user(size);
+		if (!ring) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+		ring->size = tu->queue_size;
+		spin_lock_irq(&tu->qlock);
+		tu->ring = ring;
+		tu->ring_size = tu->queue_size;
+		tu->ring_tail = 0;
+		tu->qhead = tu->qtail = tu->qused = 0;
+		spin_unlock_irq(&tu->qlock);
+	}
+	err = remap_vmalloc_range(area, tu->ring, 0);
+ unlock:
+	mutex_unlock(&tu->ioctl_lock);
+	return err;
+}
+
 #ifdef CONFIG_COMPAT
 #include "timer_compat.c"
 #else
@@ -2103,6 +2435,7 @@ static const struct file_operations snd_timer_f_ops =
 	.release =	snd_timer_user_release,
 	.llseek =	no_llseek,
 	.poll =		snd_timer_user_poll,
+	.mmap =		snd_timer_user_mmap,
 	.unlocked_ioctl =	snd_timer_user_ioctl,
 	.compat_ioctl =	snd_timer_user_ioctl_compat,
 	.fasync = 	snd_timer_user_fasync,
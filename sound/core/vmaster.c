@@ -39,6 +39,8 @@ struct link_master {
 	unsigned int tlv[4];
 	void (*hook)(void *private_data, int);
 	void *hook_private_data;
+	void (*batch)(void *private_data, bool begin);
+	void *batch_private_data;
 };
 
 /*
@@ -53,6 +55,9 @@ struct link_slave {
 	struct link_master *master;
 	struct link_ctl_info info;
 	int vals[2];		/* current values */
+	int hw_vals[2];		/* values last passed to the slave put */
+	bool hw_valid;		/* hw_vals hold what the slave got */
+	bool pending;		/* to be written in the current sync */
 	unsigned int flags;
 	struct snd_kcontrol *kctl; /* original kcontrol pointer */
 	struct snd_kcontrol slave; /* the copy of original control entry */
@@ -148,35 +153,75 @@ static int slave_get_val(struct link_slave *slave,
 	return 0;
 }
 
-static int slave_put_val(struct link_slave *slave,
-			 struct snd_ctl_elem_value *ucontrol)
+/*
+ * compute the values to pass to the slave put from the slave values and
+ * the master attenuation; returns true if they differ from the ones the
+ * slave got last time
+ */
+static bool slave_calc_vals(struct link_slave *slave, int *vals)
 {
-	int err, ch, vol;
-
-	err = master_init(slave->master);
-	if (err < 0)
-		return err;
+	bool changed = !slave->hw_valid;
+	int ch, vol;
 
-	switch (slave->info.type) {
-	case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
-		for (ch = 0; ch < slave->info.count; ch++)
-			ucontrol->value.integer.value[ch] &=
-				!!slave->master->val;
-		break;
-	case SNDRV_CTL_ELEM_TYPE_INTEGER:
-		for (ch = 0; ch < slave->info.count; ch++) {
+	for (ch = 0; ch < slave->info.count; ch++) {
+		vol = slave->vals[ch];
+		switch (slave->info.type) {
+		case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
+			vol &= !!slave->master->val;
+			break;
+		case SNDRV_CTL_ELEM_TYPE_INTEGER:
 			/* max master volume is supposed to be 0 dB */
-			vol = ucontrol->value.integer.value[ch];
 			vol += slave->master->val - slave->master->info.max_val;
 			if (vol < slave->info.min_val)
 				vol = slave->info.min_val;
 			else if (vol > slave->info.max_val)
 				vol = slave->info.max_val;
-			ucontrol->value.integer.value[ch] = vol;
+			break;
 		}
-		break;
+		if (vol != slave->hw_vals[ch])
+			changed = true;
+		vals[ch] = vol;
+	}
+	/* the hardware value of an uncached slave may change behind us */
+	if (slave->flags & SND_CTL_SLAVE_NEED_UPDATE)
+		changed = true;
+	return changed;
+}
+
+/* pass the values computed by slave_calc_vals() to the slave put */
+static int slave_write_vals(struct link_slave *slave,
+			    struct snd_ctl_elem_value *ucontrol,
+			    const int *vals)
+{
+	int err, ch;
+
+	ucontrol->id = slave->slave.id;
+	for (ch = 0; ch < slave->info.count; ch++)
+		ucontrol->value.integer.value[ch] = vals[ch];
+	err = slave->slave.put(&slave->slave, ucontrol);
+	if (err < 0) {
+		slave->hw_valid = false;
+		return err;
 	}
-	return slave->slave.put(&slave->slave, ucontrol);
+	memcpy(slave->hw_vals, vals, sizeof(slave->hw_vals));
+	slave->hw_valid = true;
+	return err;
+}
+
+/* apply the master to the current slave values; no-op if the result
+ * is what the slave has already got
+ */
+static int slave_put_val(struct link_slave *slave,
+			 struct snd_ctl_elem_value *ucontrol)
+{
+	int err, vals[2];
+
+	err = master_init(slave->master);
+	if (err < 0)
+		return err;
+	if (!slave_calc_vals(slave, vals))
+		return 0;
+	return slave_write_vals(slave, ucontrol, vals);
 }
 
 /*
@@ -310,21 +355,50 @@ static int master_get(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
-static int sync_slaves(struct link_master *master, int old_val, int new_val)
+/*
+ * Apply the master value to all slaves.  The new slave values are
+ * computed first, and only the slaves whose value actually changes are
+ * written, inside a single batch of the driver (if it set up one).
+ * With @force, all slaves are written.
+ */
+static int sync_slaves(struct link_master *master, int new_val, bool force)
 {
 	struct link_slave *slave;
 	struct snd_ctl_elem_value *uval;
+	int vals[2];
+	bool pending = false;
+
+	master->val = new_val;
+	list_for_each_entry(slave, &master->slaves, list) {
+		slave->pending = false;
+		if (slave_init(slave) < 0)
+			continue;
+		if (force)
+			slave->hw_valid = false;
+		slave->pending = slave_calc_vals(slave, vals);
+		pending |= slave->pending;
+	}
+	if (!pending)
+		return 0;
 
 	uval = kmalloc(sizeof(*uval), GFP_KERNEL);
-	if (!uval)
+	if (!uval) {
+		/* let the next sync write them */
+		list_for_each_entry(slave, &master->slaves, list)
+			if (slave->pending)
+				slave->hw_valid = false;
 		return -ENOMEM;
+	}
+	if (master->batch)
+		master->batch(master->batch_private_data, true);
 	list_for_each_entry(slave, &master->slaves, list) {
-		master->val = old_val;
-		uval->id = slave->slave.id;
-		slave_get_val(slave, uval);
-		master->val = new_val;
-		slave_put_val(slave, uval);
+		if (!slave->pending)
+			continue;
+		slave_calc_vals(slave, vals);
+		slave_write_vals(slave, uval, vals);
 	}
+	if (master->batch)
+		master->batch(master->batch_private_data, false);
 	kfree(uval);
 	return 0;
 }
@@ -345,7 +419,7 @@ static int master_put(struct snd_kcontrol *kcontrol,
 	if (new_val == old_val)
 		return 0;
 
-	err = sync_slaves(master, old_val, new_val);
+	err = sync_slaves(master, new_val, false);
 	if (err < 0)
 		return err;
 	if (master->hook && !first_init)
@@ -453,6 +527,31 @@ int snd_ctl_add_vmaster_hook(struct snd_kcontrol *kcontrol,
 }
 EXPORT_SYMBOL_GPL(snd_ctl_add_vmaster_hook);
 
+/**
+ * snd_ctl_add_vmaster_batch - Add a batch callback to a vmaster control
+ * @kcontrol: vmaster kctl element
+ * @batch: the batch function
+ * @private_data: the private_data pointer to be saved
+ *
+ * When a change of the vmaster value is applied to the slaves, @batch is
+ * called with true before the first slave put and with false after the
+ * last one, so that the driver can queue the hardware writes of the slave
+ * puts and submit them together.  It's not called when no slave value
+ * changes.
+ *
+ * Return: Zero.
+ */
+int snd_ctl_add_vmaster_batch(struct snd_kcontrol *kcontrol,
+			      void (*batch)(void *private_data, bool begin),
+			      void *private_data)
+{
+	struct link_master *master = snd_kcontrol_chip(kcontrol);
+	master->batch = batch;
+	master->batch_private_data = private_data;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_ctl_add_vmaster_batch);
+
 /**
  * snd_ctl_sync_vmaster - Sync the vmaster slaves and hook
  * @kcontrol: vmaster kctl element
@@ -475,7 +574,7 @@ void snd_ctl_sync_vmaster(struct snd_kcontrol *kcontrol, bool hook_only)
 		if (err < 0)
 			return;
 		first_init = err;
-		err = sync_slaves(master, master->val, master->val);
+		err = sync_slaves(master, master->val, true);
 		if (err < 0)
 			return;
 	}
@@ -31,8 +31,11 @@
 
 #include <linux/init.h>
 #include <linux/jiffies.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/vmalloc.h>
 #include <linux/wait.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
@@ -41,6 +44,7 @@
 #include <sound/pcm.h>
 #include <sound/info.h>
 #include <sound/initval.h>
+#include <sound/timer.h>
 
 MODULE_AUTHOR("Jaroslav Kysela <perex@perex.cz>");
 MODULE_DESCRIPTION("A loopback soundcard");
@@ -48,12 +52,17 @@ MODULE_LICENSE("GPL");
 MODULE_SUPPORTED_DEVICE("{{ALSA,Loopback soundcard}}");
 
 #define MAX_PCM_SUBSTREAMS	8
+#define MAX_CABLE_READERS	4
 
 static int index[SNDRV_CARDS] = SNDRV_DEFAULT_IDX;	/* Index 0-MAX */
 static char *id[SNDRV_CARDS] = SNDRV_DEFAULT_STR;	/* ID for this card */
 static bool enable[SNDRV_CARDS] = {1, [1 ... (SNDRV_CARDS - 1)] = 0};
 static int pcm_substreams[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 8};
 static int pcm_notify[SNDRV_CARDS];
+static bool zero_copy[SNDRV_CARDS];
+static int pcm_readers[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 1};
+static char *timer_source[SNDRV_CARDS];
+static bool hrtimer;
 
 module_param_array(index, int, NULL, 0444);
 MODULE_PARM_DESC(index, "Index value for loopback soundcard.");
@@ -65,19 +74,37 @@ module_param_array(pcm_substreams, int, NULL, 0444);
 MODULE_PARM_DESC(pcm_substreams, "PCM substreams # (1-8) for loopback driver.");
 module_param_array(pcm_notify, int, NULL, 0444);
 MODULE_PARM_DESC(pcm_notify, "Break capture when PCM format/rate/channels changes.");
+module_param_array(zero_copy, bool, NULL, 0444);
+MODULE_PARM_DESC(zero_copy, "Share the buffer between the playback and capture of a cable.");
+module_param_array(pcm_readers, int, NULL, 0444);
+MODULE_PARM_DESC(pcm_readers, "Capture substreams reading each cable (1-4).");
+module_param_array(timer_source, charp, NULL, 0444);
+MODULE_PARM_DESC(timer_source, "PCM timer clocking the cables, as card-device-subdevice of /proc/asound/timers.");
+module_param(hrtimer, bool, 0644);
+MODULE_PARM_DESC(hrtimer, "Use hrtimer as the timer source.");
 
 #define NO_PITCH 100000
 
 struct loopback_pcm;
 
+/*
+ * A cable connects a playback substream to one or more capture
+ * substreams; streams[0] is the playback, the rest are the readers.
+ * The valid, running and pause masks have one bit per slot.
+ */
 struct loopback_cable {
 	spinlock_t lock;
-	struct loopback_pcm *streams[2];
+	struct loopback_pcm *streams[1 + MAX_CABLE_READERS];
 	struct snd_pcm_hardware hw;
 	/* flags */
 	unsigned int valid;
 	unsigned int running;
 	unsigned int pause;
+	unsigned int use_hrtimer;	/* same time base for both streams */
+	/* buffer shared by the streams in zero-copy mode */
+	void *buffer;
+	size_t buffer_bytes;
+	unsigned int buffer_users;
 };
 
 struct loopback_setup {
@@ -94,6 +121,9 @@ struct loopback_setup {
 
 struct loopback {
 	struct snd_card *card;
+	bool zero_copy;
+	bool timer_source;		/* clocked by timer_id */
+	struct snd_timer_id timer_id;
 	struct mutex cable_lock;
 	struct loopback_cable *cables[MAX_PCM_SUBSTREAMS][2];
 	struct snd_pcm *pcm[2];
@@ -104,8 +134,11 @@ struct loopback_pcm {
 	struct loopback *loopback;
 	struct snd_pcm_substream *substream;
 	struct loopback_cable *cable;
+	unsigned int number;	/* cable number */
+	unsigned int slot;	/* index in cable->streams */
 	unsigned int pcm_buffer_size;
 	unsigned int buf_pos;	/* position in buffer */
+	unsigned int play_pos;	/* capture: next byte to read in playback */
 	unsigned int silent_size;
 	/* PCM parameters */
 	unsigned int pcm_period_size;
@@ -114,36 +147,53 @@ struct loopback_pcm {
 	unsigned int pcm_rate_shift;	/* rate shift value */
 	/* flags */
 	unsigned int period_update_pending :1;
-	/* timer stuff */
-	unsigned int irq_pos;		/* fractional IRQ position */
-	unsigned int period_size_frac;
-	unsigned int last_drift;
-	unsigned long last_jiffies;
+	unsigned int use_hrtimer :1;
+	unsigned int shared :1;		/* uses cable->buffer */
+	unsigned int play_sync :1;	/* play_pos follows the playback */
+	unsigned int timer_running :1;
+	/* timer stuff, in jiffies or in ns with the hrtimer or timer source */
+	u64 irq_pos;			/* fractional IRQ position */
+	u64 period_size_frac;
+	u64 last_time;
 	struct timer_list timer;
+	struct hrtimer hrtimer;
+	struct snd_timer_instance *timeri;
+	u64 timer_time;			/* ns counted by the timer source */
 };
 
 static struct platform_device *devices[SNDRV_CARDS];
 
-static inline unsigned int byte_pos(struct loopback_pcm *dpcm, unsigned int x)
+/* timer ticks per second */
+static inline unsigned int loopback_ticks(struct loopback_pcm *dpcm)
 {
-	if (dpcm->pcm_rate_shift == NO_PITCH) {
-		x /= HZ;
-	} else {
-		x = div_u64(NO_PITCH * (unsigned long long)x,
-			    HZ * (unsigned long long)dpcm->pcm_rate_shift);
-	}
-	return x - (x % dpcm->pcm_salign);
+	return dpcm->use_hrtimer || dpcm->timeri ? NSEC_PER_SEC : HZ;
 }
 
-static inline unsigned int frac_pos(struct loopback_pcm *dpcm, unsigned int x)
+static inline u64 loopback_now(struct loopback_pcm *dpcm)
 {
-	if (dpcm->pcm_rate_shift == NO_PITCH) {	/* no pitch */
-		return x * HZ;
-	} else {
-		x = div_u64(dpcm->pcm_rate_shift * (unsigned long long)x * HZ,
-			    NO_PITCH);
-	}
-	return x;
+	if (dpcm->timeri)
+		return dpcm->timer_time;
+	return dpcm->use_hrtimer ? ktime_get_ns() : get_jiffies_64();
+}
+
+static inline unsigned int byte_pos(struct loopback_pcm *dpcm, u64 x)
+{
+	unsigned int pos;
+
+	x = div_u64(x, loopback_ticks(dpcm));
+	if (dpcm->pcm_rate_shift != NO_PITCH)
+		x = div_u64(NO_PITCH * x, dpcm->pcm_rate_shift);
+	pos = x;
+	return pos - (pos % dpcm->pcm_salign);
+}
+
+static inline u64 frac_pos(struct loopback_pcm *dpcm, unsigned int x)
+{
+	u64 frac = x;
+
+	if (dpcm->pcm_rate_shift != NO_PITCH)
+		frac = div_u64(dpcm->pcm_rate_shift * frac, NO_PITCH);
+	return frac * loopback_ticks(dpcm);
 }
 
 static inline struct loopback_setup *get_setup(struct loopback_pcm *dpcm)
@@ -152,7 +202,7 @@ static inline struct loopback_setup *get_setup(struct loopback_pcm *dpcm)
 	
 	if (dpcm->substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
 		device ^= 1;
-	return &dpcm->loopback->setup[dpcm->substream->number][device];
+	return &dpcm->loopback->setup[dpcm->number][device];
 }
 
 static inline unsigned int get_notify(struct loopback_pcm *dpcm)
@@ -168,7 +218,7 @@ static inline unsigned int get_rate_shift(struct loopback_pcm *dpcm)
 /* call in cable->lock */
 static void loopback_timer_start(struct loopback_pcm *dpcm)
 {
-	unsigned long tick;
+	u64 tick;
 	unsigned int rate_shift = get_rate_shift(dpcm);
 
 	if (rate_shift != dpcm->pcm_rate_shift) {
@@ -176,71 +226,116 @@ static void loopback_timer_start(struct loopback_pcm *dpcm)
 		dpcm->period_size_frac = frac_pos(dpcm, dpcm->pcm_period_size);
 	}
 	if (dpcm->period_size_frac <= dpcm->irq_pos) {
-		dpcm->irq_pos %= dpcm->period_size_frac;
+		div64_u64_rem(dpcm->irq_pos, dpcm->period_size_frac,
+			      &dpcm->irq_pos);
 		dpcm->period_update_pending = 1;
 	}
+	if (dpcm->timeri) {
+		/* the timer source keeps ticking until stopped */
+		if (!dpcm->timer_running)
+			snd_timer_start(dpcm->timeri, 1);
+		dpcm->timer_running = 1;
+		return;
+	}
 	tick = dpcm->period_size_frac - dpcm->irq_pos;
-	tick = (tick + dpcm->pcm_bps - 1) / dpcm->pcm_bps;
-	mod_timer(&dpcm->timer, jiffies + tick);
+	tick = div_u64(tick + dpcm->pcm_bps - 1, dpcm->pcm_bps);
+	if (dpcm->use_hrtimer)
+		hrtimer_start(&dpcm->hrtimer, ns_to_ktime(tick),
+			      HRTIMER_MODE_REL);
+	else
+		mod_timer(&dpcm->timer, jiffies + tick);
 }
 
 /* call in cable->lock */
 static inline void loopback_timer_stop(struct loopback_pcm *dpcm)
 {
+	if (dpcm->timeri) {
+		if (dpcm->timer_running)
+			snd_timer_stop(dpcm->timeri);
+		dpcm->timer_running = 0;
+		return;
+	}
+	if (dpcm->use_hrtimer) {
+		/* the callback may be waiting for cable->lock */
+		hrtimer_try_to_cancel(&dpcm->hrtimer);
+		return;
+	}
 	del_timer(&dpcm->timer);
 	dpcm->timer.expires = 0;
 }
 
+static inline void loopback_timer_stop_sync(struct loopback_pcm *dpcm)
+{
+	if (dpcm->timeri) {
+		snd_timer_close(dpcm->timeri);
+		dpcm->timeri = NULL;
+	} else if (dpcm->use_hrtimer)
+		hrtimer_cancel(&dpcm->hrtimer);
+	else
+		del_timer_sync(&dpcm->timer);
+}
+
 #define CABLE_VALID_PLAYBACK	(1 << SNDRV_PCM_STREAM_PLAYBACK)
-#define CABLE_VALID_CAPTURE	(1 << SNDRV_PCM_STREAM_CAPTURE)
-#define CABLE_VALID_BOTH	(CABLE_VALID_PLAYBACK|CABLE_VALID_CAPTURE)
+#define CABLE_VALID_CAPTURE	(~CABLE_VALID_PLAYBACK)
+
+static bool loopback_format_differs(struct loopback_pcm *play,
+				    struct loopback_pcm *capt)
+{
+	struct snd_pcm_runtime *runtime = play->substream->runtime;
+	struct snd_pcm_runtime *cruntime = capt->substream->runtime;
 
-static int loopback_check_format(struct loopback_cable *cable, int stream)
+	return runtime->format != cruntime->format ||
+		runtime->rate != cruntime->rate ||
+		runtime->channels != cruntime->channels;
+}
+
+static int loopback_check_format(struct loopback_pcm *dpcm)
 {
-	struct snd_pcm_runtime *runtime, *cruntime;
+	struct loopback_cable *cable = dpcm->cable;
+	struct loopback_pcm *play = cable->streams[SNDRV_PCM_STREAM_PLAYBACK];
+	struct snd_pcm_runtime *runtime;
 	struct loopback_setup *setup;
 	struct snd_card *card;
-	int check;
+	bool mismatch = false;
+	int slot;
 
-	if (cable->valid != CABLE_VALID_BOTH) {
-		if (stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (!(cable->valid & CABLE_VALID_PLAYBACK) ||
+	    !(cable->valid & CABLE_VALID_CAPTURE)) {
+		if (dpcm == play)
 			goto __notify;
 		return 0;
 	}
-	runtime = cable->streams[SNDRV_PCM_STREAM_PLAYBACK]->
-							substream->runtime;
-	cruntime = cable->streams[SNDRV_PCM_STREAM_CAPTURE]->
-							substream->runtime;
-	check = runtime->format != cruntime->format ||
-		runtime->rate != cruntime->rate ||
-		runtime->channels != cruntime->channels;
-	if (!check)
+	if (dpcm != play)
+		return loopback_format_differs(play, dpcm) ? -EIO : 0;
+
+	for (slot = 1; slot < ARRAY_SIZE(cable->streams); slot++) {
+		if (!(cable->valid & (1 << slot)) ||
+		    !loopback_format_differs(play, cable->streams[slot]))
+			continue;
+		snd_pcm_stop(cable->streams[slot]->substream,
+			     SNDRV_PCM_STATE_DRAINING);
+		mismatch = true;
+	}
+	if (!mismatch)
 		return 0;
-	if (stream == SNDRV_PCM_STREAM_CAPTURE) {
-		return -EIO;
-	} else {
-		snd_pcm_stop(cable->streams[SNDRV_PCM_STREAM_CAPTURE]->
-					substream, SNDRV_PCM_STATE_DRAINING);
-	      __notify:
-		runtime = cable->streams[SNDRV_PCM_STREAM_PLAYBACK]->
-							substream->runtime;
-		setup = get_setup(cable->streams[SNDRV_PCM_STREAM_PLAYBACK]);
-		card = cable->streams[SNDRV_PCM_STREAM_PLAYBACK]->loopback->card;
-		if (setup->format != runtime->format) {
-			snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
-							&setup->format_id);
-			setup->format = runtime->format;
-		}
-		if (setup->rate != runtime->rate) {
-			snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
-							&setup->rate_id);
-			setup->rate = runtime->rate;
-		}
-		if (setup->channels != runtime->channels) {
-			snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
-							&setup->channels_id);
-			setup->channels = runtime->channels;
-		}
+ __notify:
+	runtime = play->substream->runtime;
+	setup = get_setup(play);
+	card = play->loopback->card;
+	if (setup->format != runtime->format) {
+		snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
+						&setup->format_id);
+		setup->format = runtime->format;
+	}
+	if (setup->rate != runtime->rate) {
+		snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
+						&setup->rate_id);
+		setup->rate = runtime->rate;
+	}
+	if (setup->channels != runtime->channels) {
+		snd_ctl_notify(card, SNDRV_CTL_EVENT_MASK_VALUE,
+						&setup->channels_id);
+		setup->channels = runtime->channels;
 	}
 	return 0;
 }
@@ -257,16 +352,16 @@ static int loopback_trigger(struct snd_pcm_substream *substream, int cmd)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct loopback_pcm *dpcm = runtime->private_data;
 	struct loopback_cable *cable = dpcm->cable;
-	int err, stream = 1 << substream->stream;
+	int err, stream = 1 << dpcm->slot;
 
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
-		err = loopback_check_format(cable, substream->stream);
+		err = loopback_check_format(dpcm);
 		if (err < 0)
 			return err;
-		dpcm->last_jiffies = jiffies;
+		dpcm->last_time = loopback_now(dpcm);
 		dpcm->pcm_rate_shift = 0;
-		dpcm->last_drift = 0;
+		dpcm->play_sync = 0;
 		spin_lock(&cable->lock);	
 		cable->running |= stream;
 		cable->pause &= ~stream;
@@ -294,7 +389,7 @@ static int loopback_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 	case SNDRV_PCM_TRIGGER_RESUME:
 		spin_lock(&cable->lock);
-		dpcm->last_jiffies = jiffies;
+		dpcm->last_time = loopback_now(dpcm);
 		cable->pause &= ~stream;
 		loopback_timer_start(dpcm);
 		spin_unlock(&cable->lock);
@@ -323,16 +418,15 @@ static void params_change(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct loopback_pcm *dpcm = runtime->private_data;
 	struct loopback_cable *cable = dpcm->cable;
+	int slot;
 
 	cable->hw.formats = pcm_format_to_bits(runtime->format);
 	cable->hw.rate_min = runtime->rate;
 	cable->hw.rate_max = runtime->rate;
 	cable->hw.channels_min = runtime->channels;
 	cable->hw.channels_max = runtime->channels;
-	params_change_substream(cable->streams[SNDRV_PCM_STREAM_PLAYBACK],
-				runtime);
-	params_change_substream(cable->streams[SNDRV_PCM_STREAM_CAPTURE],
-				runtime);
+	for (slot = 0; slot < ARRAY_SIZE(cable->streams); slot++)
+		params_change_substream(cable->streams[slot], runtime);
 }
 
 static int loopback_prepare(struct snd_pcm_substream *substream)
@@ -350,7 +444,7 @@ static int loopback_prepare(struct snd_pcm_substream *substream)
 
 	dpcm->buf_pos = 0;
 	dpcm->pcm_buffer_size = frames_to_bytes(runtime, runtime->buffer_size);
-	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE) {
+	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE && !dpcm->shared) {
 		/* clear capture buffer */
 		dpcm->silent_size = dpcm->pcm_buffer_size;
 		snd_pcm_format_set_silence(runtime->format, runtime->dma_area,
@@ -364,16 +458,39 @@ static int loopback_prepare(struct snd_pcm_substream *substream)
 	dpcm->pcm_period_size = frames_to_bytes(runtime, runtime->period_size);
 
 	mutex_lock(&dpcm->loopback->cable_lock);
-	if (!(cable->valid & ~(1 << substream->stream)) ||
+	if (!(cable->valid & ~(1 << dpcm->slot)) ||
             (get_setup(dpcm)->notify &&
 	     substream->stream == SNDRV_PCM_STREAM_PLAYBACK))
 		params_change(substream);
-	cable->valid |= 1 << substream->stream;
+	cable->valid |= 1 << dpcm->slot;
 	mutex_unlock(&dpcm->loopback->cable_lock);
 
 	return 0;
 }
 
+/*
+ * In zero-copy mode the capture must not silence the buffer while the
+ * playback may have data queued in it.
+ */
+static bool capture_may_clear(struct loopback_pcm *capt)
+{
+	struct loopback_pcm *play;
+
+	if (!capt->shared)
+		return true;
+	play = capt->cable->streams[SNDRV_PCM_STREAM_PLAYBACK];
+	if (!play || !play->shared)
+		return true;
+	switch (play->substream->runtime->status->state) {
+	case SNDRV_PCM_STATE_OPEN:
+	case SNDRV_PCM_STATE_SETUP:
+	case SNDRV_PCM_STATE_XRUN:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static void clear_capture_buf(struct loopback_pcm *dpcm, unsigned int bytes)
 {
 	struct snd_pcm_runtime *runtime = dpcm->substream->runtime;
@@ -382,6 +499,8 @@ static void clear_capture_buf(struct loopback_pcm *dpcm, unsigned int bytes)
 
 	if (dpcm->silent_size >= dpcm->pcm_buffer_size)
 		return;
+	if (!capture_may_clear(dpcm))
+		return;
 	if (dpcm->silent_size + bytes > dpcm->pcm_buffer_size)
 		bytes = dpcm->pcm_buffer_size - dpcm->silent_size;
 
@@ -400,6 +519,28 @@ static void clear_capture_buf(struct loopback_pcm *dpcm, unsigned int bytes)
 	}
 }
 
+/*
+ * Each capture reads the played data from its own cursor, which trails
+ * the playback position by about the size of an update; it is put back
+ * there when the capture (re)starts or has drifted off by a period.
+ */
+static unsigned int capture_play_pos(struct loopback_pcm *play,
+				     struct loopback_pcm *capt,
+				     unsigned int bytes)
+{
+	unsigned int size = play->pcm_buffer_size;
+	unsigned int lag;
+
+	bytes %= size;
+	lag = (play->buf_pos + size - capt->play_pos) % size;
+	if (!capt->play_sync || lag < bytes ||
+	    lag > bytes + play->pcm_period_size) {
+		capt->play_pos = (play->buf_pos + size - bytes) % size;
+		capt->play_sync = 1;
+	}
+	return capt->play_pos;
+}
+
 static void copy_play_buf(struct loopback_pcm *play,
 			  struct loopback_pcm *capt,
 			  unsigned int bytes)
@@ -407,7 +548,7 @@ static void copy_play_buf(struct loopback_pcm *play,
 	struct snd_pcm_runtime *runtime = play->substream->runtime;
 	char *src = runtime->dma_area;
 	char *dst = capt->substream->runtime->dma_area;
-	unsigned int src_off = play->buf_pos;
+	unsigned int src_off = capture_play_pos(play, capt, bytes);
 	unsigned int dst_off = capt->buf_pos;
 	unsigned int clear_bytes = 0;
 
@@ -418,7 +559,7 @@ static void copy_play_buf(struct loopback_pcm *play,
 	    	snd_pcm_uframes_t appl_ptr, appl_ptr1, diff;
 		appl_ptr = appl_ptr1 = runtime->control->appl_ptr;
 		appl_ptr1 -= appl_ptr1 % runtime->buffer_size;
-		appl_ptr1 += play->buf_pos / play->pcm_salign;
+		appl_ptr1 += src_off / play->pcm_salign;
 		if (appl_ptr < appl_ptr1)
 			appl_ptr1 -= runtime->buffer_size;
 		diff = (appl_ptr - appl_ptr1) * play->pcm_salign;
@@ -437,11 +578,12 @@ static void copy_play_buf(struct loopback_pcm *play,
 		memcpy(dst + dst_off, src + src_off, size);
 		capt->silent_size = 0;
 		bytes -= size;
+		src_off = (src_off + size) % play->pcm_buffer_size;
 		if (!bytes)
 			break;
-		src_off = (src_off + size) % play->pcm_buffer_size;
 		dst_off = (dst_off + size) % capt->pcm_buffer_size;
 	}
+	capt->play_pos = src_off;
 
 	if (clear_bytes > 0) {
 		clear_capture_buf(capt, clear_bytes);
@@ -450,19 +592,17 @@ static void copy_play_buf(struct loopback_pcm *play,
 }
 
 static inline unsigned int bytepos_delta(struct loopback_pcm *dpcm,
-					 unsigned int jiffies_delta)
+					 u64 time_delta)
 {
 	unsigned long last_pos;
 	unsigned int delta;
 
 	last_pos = byte_pos(dpcm, dpcm->irq_pos);
-	dpcm->irq_pos += jiffies_delta * dpcm->pcm_bps;
+	dpcm->irq_pos += time_delta * dpcm->pcm_bps;
 	delta = byte_pos(dpcm, dpcm->irq_pos) - last_pos;
-	if (delta >= dpcm->last_drift)
-		delta -= dpcm->last_drift;
-	dpcm->last_drift = 0;
 	if (dpcm->irq_pos >= dpcm->period_size_frac) {
-		dpcm->irq_pos %= dpcm->period_size_frac;
+		div64_u64_rem(dpcm->irq_pos, dpcm->period_size_frac,
+			      &dpcm->irq_pos);
 		dpcm->period_update_pending = 1;
 	}
 	return delta;
@@ -480,62 +620,56 @@ static unsigned int loopback_pos_update(struct loopback_cable *cable)
 {
 	struct loopback_pcm *dpcm_play =
 			cable->streams[SNDRV_PCM_STREAM_PLAYBACK];
-	struct loopback_pcm *dpcm_capt =
-			cable->streams[SNDRV_PCM_STREAM_CAPTURE];
-	unsigned long delta_play = 0, delta_capt = 0;
-	unsigned int running, count1, count2;
+	struct loopback_pcm *dpcm_capt;
+	u64 delta_play = 0, delta_capt;
+	unsigned int running, count;
+	int slot;
 
 	running = cable->running ^ cable->pause;
-	if (running & (1 << SNDRV_PCM_STREAM_PLAYBACK)) {
-		delta_play = jiffies - dpcm_play->last_jiffies;
-		dpcm_play->last_jiffies += delta_play;
+	if (running & CABLE_VALID_PLAYBACK) {
+		delta_play = loopback_now(dpcm_play) - dpcm_play->last_time;
+		dpcm_play->last_time += delta_play;
 	}
-
-	if (running & (1 << SNDRV_PCM_STREAM_CAPTURE)) {
-		delta_capt = jiffies - dpcm_capt->last_jiffies;
-		dpcm_capt->last_jiffies += delta_capt;
+	if (delta_play) {
+		count = bytepos_delta(dpcm_play, delta_play);
+		bytepos_finish(dpcm_play, count);
 	}
 
-	if (delta_play == 0 && delta_capt == 0)
-		goto unlock;
-		
-	if (delta_play > delta_capt) {
-		count1 = bytepos_delta(dpcm_play, delta_play - delta_capt);
-		bytepos_finish(dpcm_play, count1);
-		delta_play = delta_capt;
-	} else if (delta_play < delta_capt) {
-		count1 = bytepos_delta(dpcm_capt, delta_capt - delta_play);
-		clear_capture_buf(dpcm_capt, count1);
-		bytepos_finish(dpcm_capt, count1);
-		delta_capt = delta_play;
-	}
-
-	if (delta_play == 0 && delta_capt == 0)
-		goto unlock;
-
-	/* note delta_capt == delta_play at this moment */
-	count1 = bytepos_delta(dpcm_play, delta_play);
-	count2 = bytepos_delta(dpcm_capt, delta_capt);
-	if (count1 < count2) {
-		dpcm_capt->last_drift = count2 - count1;
-		count1 = count2;
-	} else if (count1 > count2) {
-		dpcm_play->last_drift = count1 - count2;
+	for (slot = 1; slot < ARRAY_SIZE(cable->streams); slot++) {
+		if (!(running & (1 << slot)))
+			continue;
+		dpcm_capt = cable->streams[slot];
+		delta_capt = loopback_now(dpcm_capt) - dpcm_capt->last_time;
+		dpcm_capt->last_time += delta_capt;
+		if (delta_capt > delta_play) {
+			/* nothing was played during this part */
+			count = bytepos_delta(dpcm_capt, delta_capt - delta_play);
+			clear_capture_buf(dpcm_capt, count);
+			bytepos_finish(dpcm_capt, count);
+			dpcm_capt->play_sync = 0;
+			delta_capt = delta_play;
+		}
+		if (!delta_capt)
+			continue;
+		count = bytepos_delta(dpcm_capt, delta_capt);
+		if (dpcm_play->shared && dpcm_capt->shared) {
+			/* the capture reads the playback data in place */
+			dpcm_capt->buf_pos = dpcm_play->buf_pos;
+			dpcm_capt->silent_size = 0;
+			continue;
+		}
+		copy_play_buf(dpcm_play, dpcm_capt, count);
+		bytepos_finish(dpcm_capt, count);
 	}
-	copy_play_buf(dpcm_play, dpcm_capt, count1);
-	bytepos_finish(dpcm_play, count1);
-	bytepos_finish(dpcm_capt, count1);
- unlock:
 	return running;
 }
 
-static void loopback_timer_function(unsigned long data)
+static void loopback_elapsed(struct loopback_pcm *dpcm)
 {
-	struct loopback_pcm *dpcm = (struct loopback_pcm *)data;
 	unsigned long flags;
 
 	spin_lock_irqsave(&dpcm->cable->lock, flags);
-	if (loopback_pos_update(dpcm->cable) & (1 << dpcm->substream->stream)) {
+	if (loopback_pos_update(dpcm->cable) & (1 << dpcm->slot)) {
 		loopback_timer_start(dpcm);
 		if (dpcm->period_update_pending) {
 			dpcm->period_update_pending = 0;
@@ -548,6 +682,60 @@ static void loopback_timer_function(unsigned long data)
 	spin_unlock_irqrestore(&dpcm->cable->lock, flags);
 }
 
+static void loopback_timer_function(unsigned long data)
+{
+	loopback_elapsed((struct loopback_pcm *)data);
+}
+
+static void loopback_snd_timer_function(struct snd_timer_instance *timeri,
+					unsigned long resolution,
+					unsigned long ticks)
+{
+	struct loopback_pcm *dpcm = timeri->callback_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpcm->cable->lock, flags);
+	dpcm->timer_time += (u64)resolution * ticks;
+	spin_unlock_irqrestore(&dpcm->cable->lock, flags);
+	loopback_elapsed(dpcm);
+}
+
+/* loopback_timer_start() rearms the timer from the callback */
+static enum hrtimer_restart loopback_hrtimer_function(struct hrtimer *timer)
+{
+	loopback_elapsed(container_of(timer, struct loopback_pcm, hrtimer));
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * call in cable->lock: in zero-copy mode, the playback position is held
+ * back by what the slowest reader hasn't read yet, so that the playback
+ * can't write over it
+ */
+static unsigned int loopback_play_pos(struct loopback_pcm *play)
+{
+	struct loopback_cable *cable = play->cable;
+	unsigned int running = cable->running ^ cable->pause;
+	unsigned int lag = 0, unread;
+	int slot;
+
+	for (slot = 1; slot < ARRAY_SIZE(cable->streams); slot++) {
+		struct loopback_pcm *capt = cable->streams[slot];
+		struct snd_pcm_runtime *runtime;
+
+		if (!capt || !capt->shared || !(running & (1 << slot)))
+			continue;
+		runtime = capt->substream->runtime;
+		unread = frames_to_bytes(runtime, runtime->control->appl_ptr %
+					 runtime->buffer_size);
+		unread = (capt->buf_pos + capt->pcm_buffer_size - unread) %
+			capt->pcm_buffer_size;
+		lag = max(lag, unread);
+	}
+	return (play->buf_pos + play->pcm_buffer_size - lag) %
+		play->pcm_buffer_size;
+}
+
 static snd_pcm_uframes_t loopback_pointer(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -556,7 +744,10 @@ static snd_pcm_uframes_t loopback_pointer(struct snd_pcm_substream *substream)
 
 	spin_lock(&dpcm->cable->lock);
 	loopback_pos_update(dpcm->cable);
-	pos = dpcm->buf_pos;
+	if (dpcm->shared && substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		pos = loopback_play_pos(dpcm);
+	else
+		pos = dpcm->buf_pos;
 	spin_unlock(&dpcm->cable->lock);
 	return bytes_to_frames(runtime, pos);
 }
@@ -590,9 +781,85 @@ static void loopback_runtime_free(struct snd_pcm_runtime *runtime)
 	kfree(dpcm);
 }
 
+/* call in loopback->cable_lock */
+static void loopback_unshare_buffer(struct loopback_pcm *dpcm)
+{
+	struct snd_pcm_runtime *runtime = dpcm->substream->runtime;
+	struct loopback_cable *cable = dpcm->cable;
+
+	if (!dpcm->shared)
+		return;
+	spin_lock_irq(&cable->lock);
+	dpcm->shared = 0;
+	spin_unlock_irq(&cable->lock);
+	runtime->dma_area = NULL;
+	runtime->dma_bytes = 0;
+	if (!--cable->buffer_users) {
+		vfree(cable->buffer);
+		cable->buffer = NULL;
+	}
+}
+
+/*
+ * Use the buffer of the cable in zero-copy mode; the first stream sets
+ * its size, a stream with another buffer size gets its own buffer and
+ * the data is copied as usual.  So does a capture with mmap access, which
+ * could write to the playback data otherwise.  Returns 1 if the buffer is
+ * shared.
+ */
+static int loopback_share_buffer(struct snd_pcm_substream *substream,
+				 struct snd_pcm_hw_params *params)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct loopback_pcm *dpcm = runtime->private_data;
+	struct loopback_cable *cable = dpcm->cable;
+	snd_pcm_format_t format = params_format(params);
+	size_t size = params_buffer_bytes(params);
+	int err = 0;
+
+	mutex_lock(&dpcm->loopback->cable_lock);
+	loopback_unshare_buffer(dpcm);
+	if (cable->buffer && cable->buffer_bytes != size)
+		goto unlock;
+	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE &&
+	    params_access(params) != SNDRV_PCM_ACCESS_RW_INTERLEAVED &&
+	    params_access(params) != SNDRV_PCM_ACCESS_RW_NONINTERLEAVED)
+		goto unlock;
+	if (!cable->buffer) {
+		cable->buffer = vmalloc(size);
+		if (!cable->buffer) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+		cable->buffer_bytes = size;
+		snd_pcm_format_set_silence(format, cable->buffer, size * 8 /
+					   snd_pcm_format_physical_width(format));
+	}
+	cable->buffer_users++;
+	/* drop a buffer of our own from a previous setup */
+	snd_pcm_lib_free_vmalloc_buffer(substream);
+	runtime->dma_area = cable->buffer;
+	runtime->dma_bytes = size;
+	spin_lock_irq(&cable->lock);
+	dpcm->shared = 1;
+	spin_unlock_irq(&cable->lock);
+	err = 1;
+ unlock:
+	mutex_unlock(&dpcm->loopback->cable_lock);
+	return err;
+}
+
 static int loopback_hw_params(struct snd_pcm_substream *substream,
 			      struct snd_pcm_hw_params *params)
 {
+	struct loopback_pcm *dpcm = substream->runtime->private_data;
+	int err;
+
+	if (dpcm->loopback->zero_copy) {
+		err = loopback_share_buffer(substream, params);
+		if (err)
+			return err < 0 ? err : 0;
+	}
 	return snd_pcm_lib_alloc_vmalloc_buffer(substream,
 						params_buffer_bytes(params));
 }
@@ -602,10 +869,15 @@ static int loopback_hw_free(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct loopback_pcm *dpcm = runtime->private_data;
 	struct loopback_cable *cable = dpcm->cable;
+	bool shared;
 
 	mutex_lock(&dpcm->loopback->cable_lock);
-	cable->valid &= ~(1 << substream->stream);
+	cable->valid &= ~(1 << dpcm->slot);
+	shared = dpcm->shared;
+	loopback_unshare_buffer(dpcm);
 	mutex_unlock(&dpcm->loopback->cable_lock);
+	if (shared)
+		return 0;
 	return snd_pcm_lib_free_vmalloc_buffer(substream);
 }
 
@@ -658,6 +930,46 @@ static int rule_channels(struct snd_pcm_hw_params *params,
 	return snd_interval_refine(hw_param_interval(params, rule->var), &t);
 }
 
+/* capture substreams beyond the cable count are additional readers */
+static unsigned int get_cable_number(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm *pcm = substream->pcm;
+
+	return substream->number %
+		pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream_count;
+}
+
+static unsigned int get_cable_slot(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm *pcm = substream->pcm;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		return 0;
+	return 1 + substream->number /
+		pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream_count;
+}
+
+static int loopback_snd_timer_open(struct loopback_pcm *dpcm)
+{
+	struct snd_timer_instance *timeri;
+	int err;
+
+	err = snd_timer_open(&timeri, "snd-aloop",
+			     &dpcm->loopback->timer_id, 0);
+	if (err < 0)
+		return err;
+	/* keep ticking until stopped, and not as FAST: that would call back
+	 * from the snd_pcm_period_elapsed() of a PCM timer source with its
+	 * stream lock held, and loopback_elapsed() takes another one; the
+	 * timer tasklet calls back without it instead
+	 */
+	timeri->flags |= SNDRV_TIMER_IFLG_AUTO;
+	timeri->callback = loopback_snd_timer_function;
+	timeri->callback_data = dpcm;
+	dpcm->timeri = timeri;
+	return 0;
+}
+
 static int loopback_open(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -675,23 +987,38 @@ static int loopback_open(struct snd_pcm_substream *substream)
 	}
 	dpcm->loopback = loopback;
 	dpcm->substream = substream;
+	dpcm->number = get_cable_number(substream);
+	dpcm->slot = get_cable_slot(substream);
 	setup_timer(&dpcm->timer, loopback_timer_function,
 		    (unsigned long)dpcm);
+	hrtimer_init(&dpcm->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dpcm->hrtimer.function = loopback_hrtimer_function;
+	if (loopback->timer_source) {
+		err = loopback_snd_timer_open(dpcm);
+		if (err < 0) {
+			kfree(dpcm);
+			goto unlock;
+		}
+	}
 
-	cable = loopback->cables[substream->number][dev];
+	cable = loopback->cables[dpcm->number][dev];
 	if (!cable) {
 		cable = kzalloc(sizeof(*cable), GFP_KERNEL);
 		if (!cable) {
+			if (dpcm->timeri)
+				snd_timer_close(dpcm->timeri);
 			kfree(dpcm);
 			err = -ENOMEM;
 			goto unlock;
 		}
 		spin_lock_init(&cable->lock);
 		cable->hw = loopback_pcm_hardware;
-		loopback->cables[substream->number][dev] = cable;
+		cable->use_hrtimer = hrtimer;
+		loopback->cables[dpcm->number][dev] = cable;
 	}
 	dpcm->cable = cable;
-	cable->streams[substream->stream] = dpcm;
+	dpcm->use_hrtimer = cable->use_hrtimer;
+	cable->streams[dpcm->slot] = dpcm;
 
 	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
 
@@ -734,18 +1061,21 @@ static int loopback_close(struct snd_pcm_substream *substream)
 	struct loopback_pcm *dpcm = substream->runtime->private_data;
 	struct loopback_cable *cable;
 	int dev = get_cable_index(substream);
+	int slot;
 
-	loopback_timer_stop(dpcm);
+	loopback_timer_stop_sync(dpcm);
 	mutex_lock(&loopback->cable_lock);
-	cable = loopback->cables[substream->number][dev];
-	if (cable->streams[!substream->stream]) {
+	cable = loopback->cables[dpcm->number][dev];
+	cable->streams[dpcm->slot] = NULL;
+	for (slot = 0; slot < ARRAY_SIZE(cable->streams); slot++) {
 		/* other stream is still alive */
-		cable->streams[substream->stream] = NULL;
-	} else {
-		/* free the cable */
-		loopback->cables[substream->number][dev] = NULL;
-		kfree(cable);
+		if (cable->streams[slot])
+			goto unlock;
 	}
+	/* free the cable */
+	loopback->cables[dpcm->number][dev] = NULL;
+	kfree(cable);
+ unlock:
 	mutex_unlock(&loopback->cable_lock);
 	return 0;
 }
@@ -777,13 +1107,13 @@ static const struct snd_pcm_ops loopback_capture_ops = {
 };
 
 static int loopback_pcm_new(struct loopback *loopback,
-			    int device, int substreams)
+			    int device, int substreams, int readers)
 {
 	struct snd_pcm *pcm;
 	int err;
 
 	err = snd_pcm_new(loopback->card, "Loopback PCM", device,
-			  substreams, substreams, &pcm);
+			  substreams, substreams * readers, &pcm);
 	if (err < 0)
 		return err;
 	snd_pcm_set_ops(pcm, SNDRV_PCM_STREAM_PLAYBACK, &loopback_playback_ops);
@@ -1012,7 +1342,7 @@ static int loopback_mixer_new(struct loopback *loopback, int notify)
 	for (dev = 0; dev < 2; dev++) {
 		pcm = loopback->pcm[dev];
 		substr_count =
-		    pcm->streams[SNDRV_PCM_STREAM_CAPTURE].substream_count;
+		    pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream_count;
 		for (substr = 0; substr < substr_count; substr++) {
 			setup = &loopback->setup[substr][dev];
 			setup->notify = notify;
@@ -1071,11 +1401,16 @@ static void print_dpcm_info(struct snd_info_buffer *buffer,
 	snd_iprintf(buffer, "    rate_shift:\t\t%u\n", dpcm->pcm_rate_shift);
 	snd_iprintf(buffer, "    update_pending:\t%u\n",
 						dpcm->period_update_pending);
-	snd_iprintf(buffer, "    irq_pos:\t\t%u\n", dpcm->irq_pos);
-	snd_iprintf(buffer, "    period_frac:\t%u\n", dpcm->period_size_frac);
-	snd_iprintf(buffer, "    last_jiffies:\t%lu (%lu)\n",
-					dpcm->last_jiffies, jiffies);
-	snd_iprintf(buffer, "    timer_expires:\t%lu\n", dpcm->timer.expires);
+	snd_iprintf(buffer, "    irq_pos:\t\t%llu\n", dpcm->irq_pos);
+	snd_iprintf(buffer, "    period_frac:\t%llu\n", dpcm->period_size_frac);
+	snd_iprintf(buffer, "    last_time:\t\t%llu (%llu)\n",
+					dpcm->last_time, loopback_now(dpcm));
+	if (dpcm->use_hrtimer)
+		snd_iprintf(buffer, "    timer_expires:\t%lld\n",
+			    ktime_to_ns(hrtimer_get_expires(&dpcm->hrtimer)));
+	else
+		snd_iprintf(buffer, "    timer_expires:\t%lu\n",
+			    dpcm->timer.expires);
 }
 
 static void print_substream_info(struct snd_info_buffer *buffer,
@@ -1084,6 +1419,7 @@ static void print_substream_info(struct snd_info_buffer *buffer,
 				 int num)
 {
 	struct loopback_cable *cable = loopback->cables[sub][num];
+	int slot;
 
 	snd_iprintf(buffer, "Cable %i substream %i:\n", num, sub);
 	if (cable == NULL) {
@@ -1094,7 +1430,10 @@ static void print_substream_info(struct snd_info_buffer *buffer,
 	snd_iprintf(buffer, "  running: %u\n", cable->running);
 	snd_iprintf(buffer, "  pause: %u\n", cable->pause);
 	print_dpcm_info(buffer, cable->streams[0], "Playback");
-	print_dpcm_info(buffer, cable->streams[1], "Capture");
+	for (slot = 1; slot < ARRAY_SIZE(cable->streams); slot++) {
+		if (slot == 1 || cable->streams[slot])
+			print_dpcm_info(buffer, cable->streams[slot], "Capture");
+	}
 }
 
 static void print_cable_info(struct snd_info_entry *entry,
@@ -1126,6 +1465,34 @@ static int loopback_proc_new(struct loopback *loopback, int cidx)
 	return 0;
 }
 
+/*
+ * The timer source is a PCM timer given as listed in /proc/asound/timers,
+ * e.g. "P0-0-0" or "0-0-0" for the playback of hw:0,0; the cables then
+ * advance by the periods of that PCM while it runs.
+ */
+static int loopback_parse_timer_source(struct loopback *loopback,
+				       const char *str)
+{
+	struct snd_timer_id *tid = &loopback->timer_id;
+	int card, device, subdevice;
+
+	if (!str || !*str)
+		return 0;
+	if (*str == 'P')
+		str++;
+	if (sscanf(str, "%d-%d-%d", &card, &device, &subdevice) != 3) {
+		dev_err(loopback->card->dev, "invalid timer_source %s\n", str);
+		return -EINVAL;
+	}
+	tid->dev_class = SNDRV_TIMER_CLASS_PCM;
+	tid->dev_sclass = SNDRV_TIMER_SCLASS_NONE;
+	tid->card = card;
+	tid->device = device;
+	tid->subdevice = subdevice;
+	loopback->timer_source = true;
+	return 0;
+}
+
 static int loopback_probe(struct platform_device *devptr)
 {
 	struct snd_card *card;
@@ -1143,14 +1510,21 @@ static int loopback_probe(struct platform_device *devptr)
 		pcm_substreams[dev] = 1;
 	if (pcm_substreams[dev] > MAX_PCM_SUBSTREAMS)
 		pcm_substreams[dev] = MAX_PCM_SUBSTREAMS;
+	pcm_readers[dev] = clamp(pcm_readers[dev], 1, MAX_CABLE_READERS);
 	
 	loopback->card = card;
+	loopback->zero_copy = zero_copy[dev];
 	mutex_init(&loopback->cable_lock);
+	err = loopback_parse_timer_source(loopback, timer_source[dev]);
+	if (err < 0)
+		goto __nodev;
 
-	err = loopback_pcm_new(loopback, 0, pcm_substreams[dev]);
+	err = loopback_pcm_new(loopback, 0, pcm_substreams[dev],
+			       pcm_readers[dev]);
 	if (err < 0)
 		goto __nodev;
-	err = loopback_pcm_new(loopback, 1, pcm_substreams[dev]);
+	err = loopback_pcm_new(loopback, 1, pcm_substreams[dev],
+			       pcm_readers[dev]);
 	if (err < 0)
 		goto __nodev;
 	err = loopback_mixer_new(loopback, pcm_notify[dev] ? 1 : 0);
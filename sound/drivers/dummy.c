@@ -27,6 +27,7 @@
 #include <linux/wait.h>
 #include <linux/hrtimer.h>
 #include <linux/math64.h>
+#include <linux/random.h>
 #include <linux/module.h>
 #include <sound/core.h>
 #include <sound/control.h>
@@ -69,6 +70,10 @@ static int pcm_substreams[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 8};
 static bool hrtimer = 1;
 #endif
 static bool fake_buffer = 1;
+static unsigned int pointer_jitter;
+static unsigned int dma_burst;
+static unsigned int irq_latency;
+static unsigned int irq_miss;
 
 module_param_array(index, int, NULL, 0444);
 MODULE_PARM_DESC(index, "Index value for dummy soundcard.");
@@ -90,6 +95,14 @@ MODULE_PARM_DESC(fake_buffer, "Fake buffer allocations.");
 module_param(hrtimer, bool, 0644);
 MODULE_PARM_DESC(hrtimer, "Use hrtimer as the timer source.");
 #endif
+module_param(pointer_jitter, uint, 0644);
+MODULE_PARM_DESC(pointer_jitter, "Max frames the reported position lags behind.");
+module_param(dma_burst, uint, 0644);
+MODULE_PARM_DESC(dma_burst, "Frames moved per simulated DMA transfer.");
+module_param(irq_latency, uint, 0644);
+MODULE_PARM_DESC(irq_latency, "Max random delay of period interrupts in us.");
+module_param(irq_miss, uint, 0644);
+MODULE_PARM_DESC(irq_miss, "Period interrupts dropped per mille.");
 
 static struct platform_device *devices[SNDRV_CARDS];
 
@@ -228,6 +241,50 @@ static struct dummy_model *dummy_models[] = {
 	NULL
 };
 
+/*
+ * simulated hardware imperfections, tunable at runtime through the
+ * pointer_jitter, dma_burst, irq_latency and irq_miss parameters
+ */
+
+static unsigned int dummy_irq_delay_us(void)
+{
+	unsigned int max = READ_ONCE(irq_latency);
+
+	return max ? prandom_u32_max(max + 1) : 0;
+}
+
+static bool dummy_irq_missed(void)
+{
+	unsigned int miss = READ_ONCE(irq_miss);
+
+	return miss && prandom_u32_max(1000) < miss;
+}
+
+/*
+ * Make the position move in DMA bursts and lag behind by a random
+ * amount, but never behind what was reported last time.
+ */
+static snd_pcm_uframes_t dummy_pointer_model(struct snd_pcm_substream *substream,
+					     snd_pcm_uframes_t pos)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	snd_pcm_uframes_t last, advance, lag = 0;
+	unsigned int burst = READ_ONCE(dma_burst);
+	unsigned int jitter = READ_ONCE(pointer_jitter);
+
+	if (!burst && !jitter)
+		return pos;
+	last = runtime->status->hw_ptr % runtime->buffer_size;
+	advance = (pos + runtime->buffer_size - last) % runtime->buffer_size;
+	if (burst)
+		lag = pos % burst;
+	if (jitter)
+		lag += prandom_u32_max(jitter + 1);
+	if (lag > advance)
+		lag = advance;
+	return (pos + runtime->buffer_size - lag) % runtime->buffer_size;
+}
+
 /*
  * system timer interface
  */
@@ -250,7 +307,8 @@ struct dummy_systimer_pcm {
 static void dummy_systimer_rearm(struct dummy_systimer_pcm *dpcm)
 {
 	mod_timer(&dpcm->timer, jiffies +
-		(dpcm->frac_period_rest + dpcm->rate - 1) / dpcm->rate);
+		(dpcm->frac_period_rest + dpcm->rate - 1) / dpcm->rate +
+		usecs_to_jiffies(dummy_irq_delay_us()));
 }
 
 static void dummy_systimer_update(struct dummy_systimer_pcm *dpcm)
@@ -318,7 +376,7 @@ static void dummy_systimer_callback(unsigned long data)
 	elapsed = dpcm->elapsed;
 	dpcm->elapsed = 0;
 	spin_unlock_irqrestore(&dpcm->lock, flags);
-	if (elapsed)
+	if (elapsed && !dummy_irq_missed())
 		snd_pcm_period_elapsed(dpcm->substream);
 }
 
@@ -374,6 +432,7 @@ struct dummy_hrtimer_pcm {
 	const struct dummy_timer_ops *timer_ops;
 	ktime_t base_time;
 	ktime_t period_time;
+	ktime_t next_period;	/* nominal expiry, before irq_latency */
 	atomic_t running;
 	struct hrtimer timer;
 	struct tasklet_struct tasklet;
@@ -390,12 +449,20 @@ static void dummy_hrtimer_pcm_elapsed(unsigned long priv)
 static enum hrtimer_restart dummy_hrtimer_callback(struct hrtimer *timer)
 {
 	struct dummy_hrtimer_pcm *dpcm;
+	ktime_t now;
 
 	dpcm = container_of(timer, struct dummy_hrtimer_pcm, timer);
 	if (!atomic_read(&dpcm->running))
 		return HRTIMER_NORESTART;
-	tasklet_schedule(&dpcm->tasklet);
-	hrtimer_forward_now(timer, dpcm->period_time);
+	if (!dummy_irq_missed())
+		tasklet_schedule(&dpcm->tasklet);
+	now = hrtimer_cb_get_time(timer);
+	do {
+		dpcm->next_period = ktime_add(dpcm->next_period,
+					      dpcm->period_time);
+	} while (!ktime_after(dpcm->next_period, now));
+	hrtimer_set_expires(timer, ktime_add_us(dpcm->next_period,
+						dummy_irq_delay_us()));
 	return HRTIMER_RESTART;
 }
 
@@ -404,6 +471,7 @@ static int dummy_hrtimer_start(struct snd_pcm_substream *substream)
 	struct dummy_hrtimer_pcm *dpcm = substream->runtime->private_data;
 
 	dpcm->base_time = hrtimer_cb_get_time(&dpcm->timer);
+	dpcm->next_period = ktime_add(dpcm->base_time, dpcm->period_time);
 	hrtimer_start(&dpcm->timer, dpcm->period_time, HRTIMER_MODE_REL);
 	atomic_set(&dpcm->running, 1);
 	return 0;
@@ -517,7 +585,8 @@ static int dummy_pcm_prepare(struct snd_pcm_substream *substream)
 
 static snd_pcm_uframes_t dummy_pcm_pointer(struct snd_pcm_substream *substream)
 {
-	return get_dummy_ops(substream)->pointer(substream);
+	return dummy_pointer_model(substream,
+				   get_dummy_ops(substream)->pointer(substream));
 }
 
 static const struct snd_pcm_hardware dummy_pcm_hardware = {
@@ -585,6 +654,9 @@ static int dummy_pcm_open(struct snd_pcm_substream *substream)
 	if (substream->pcm->device & 2)
 		runtime->hw.info &= ~(SNDRV_PCM_INFO_MMAP |
 				      SNDRV_PCM_INFO_MMAP_VALID);
+	/* the timers give the exact position unless it's modelled */
+	if (!READ_ONCE(dma_burst) && !READ_ONCE(pointer_jitter))
+		runtime->hw.info |= SNDRV_PCM_INFO_MONOTONIC_POINTER;
 
 	if (model == NULL)
 		return 0;
@@ -605,6 +605,8 @@ int snd_mpu401_uart_new(struct snd_card *card, int device,
 		snd_rawmidi_set_ops(rmidi, SNDRV_RAWMIDI_STREAM_INPUT,
 				    &snd_mpu401_uart_input);
 		rmidi->info_flags |= SNDRV_RAWMIDI_INFO_INPUT;
+		/* input is read only under mpu->input_lock */
+		rmidi->lockless_input = true;
 		if (out_enable)
 			rmidi->info_flags |= SNDRV_RAWMIDI_INFO_DUPLEX;
 	}
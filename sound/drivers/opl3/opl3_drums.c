@@ -89,27 +89,27 @@ static void snd_opl3_drum_voice_set(struct snd_opl3 *opl3,
 	
 	/* Set OPL3 AM_VIB register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_AM_VIB + op_offset);
-	opl3->command(opl3, opl3_reg, data->am_vib);
+	snd_opl3_reg_write(opl3, opl3_reg, data->am_vib);
 
 	/* Set OPL3 KSL_LEVEL register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_KSL_LEVEL + op_offset);
-	opl3->command(opl3, opl3_reg, data->ksl_level);
+	snd_opl3_reg_write(opl3, opl3_reg, data->ksl_level);
 
 	/* Set OPL3 ATTACK_DECAY register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_ATTACK_DECAY + op_offset);
-	opl3->command(opl3, opl3_reg, data->attack_decay);
+	snd_opl3_reg_write(opl3, opl3_reg, data->attack_decay);
 
 	/* Set OPL3 SUSTAIN_RELEASE register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_SUSTAIN_RELEASE + op_offset);
-	opl3->command(opl3, opl3_reg, data->sustain_release);
+	snd_opl3_reg_write(opl3, opl3_reg, data->sustain_release);
 
 	/* Set OPL3 FEEDBACK_CONNECTION register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_FEEDBACK_CONNECTION + voice_offset);
-	opl3->command(opl3, opl3_reg, data->feedback_connection);
+	snd_opl3_reg_write(opl3, opl3_reg, data->feedback_connection);
 
 	/* Select waveform */
 	opl3_reg = OPL3_LEFT | (OPL3_REG_WAVE_SELECT + op_offset);
-	opl3->command(opl3, opl3_reg, data->wave_select);
+	snd_opl3_reg_write(opl3, opl3_reg, data->wave_select);
 }
 
 /*
@@ -123,11 +123,11 @@ static void snd_opl3_drum_note_set(struct snd_opl3 *opl3,
 
 	/* Set OPL3 FNUM_LOW register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_FNUM_LOW + voice_offset);
-	opl3->command(opl3, opl3_reg, data->fnum);
+	snd_opl3_reg_write(opl3, opl3_reg, data->fnum);
 
 	/* Set OPL3 KEYON_BLOCK register */ 
 	opl3_reg = OPL3_LEFT | (OPL3_REG_KEYON_BLOCK + voice_offset);
-	opl3->command(opl3, opl3_reg, data->octave_f);
+	snd_opl3_reg_write(opl3, opl3_reg, data->octave_f);
 }
 
 /*
@@ -146,7 +146,7 @@ static void snd_opl3_drum_vol_set(struct snd_opl3 *opl3,
 	reg_val = data->ksl_level;
 	snd_opl3_calc_volume(&reg_val, vel, chan);
 	opl3_reg = OPL3_LEFT | (OPL3_REG_KSL_LEVEL + op_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	/* Set OPL3 FEEDBACK_CONNECTION register */ 
 	/* Set output voice connection */
@@ -156,7 +156,7 @@ static void snd_opl3_drum_vol_set(struct snd_opl3 *opl3,
 	if (chan->gm_pan > 85)
 		reg_val &= ~OPL3_VOICE_TO_LEFT;
 	opl3_reg = OPL3_LEFT | (OPL3_REG_FEEDBACK_CONNECTION + voice_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 }
 
 /*
@@ -221,6 +221,6 @@ void snd_opl3_drum_switch(struct snd_opl3 *opl3, int note, int vel, int on_off,
 	} else {
 		opl3->drum_reg &= ~drum_mask;
 	}
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION,
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION,
 			 opl3->drum_reg);
 }
@@ -361,7 +361,9 @@ int snd_opl3_new(struct snd_card *card,
 	opl3->card = card;
 	opl3->hardware = hardware;
 	spin_lock_init(&opl3->reg_lock);
+	spin_lock_init(&opl3->shadow_lock);
 	spin_lock_init(&opl3->timer_lock);
+	snd_opl3_reg_invalidate(opl3);
 
 	if ((err = snd_device_new(card, SNDRV_DEV_CODEC, opl3, &ops)) < 0) {
 		snd_opl3_free(opl3);
@@ -381,9 +383,11 @@ int snd_opl3_init(struct snd_opl3 *opl3)
 		return -EINVAL;
 	}
 
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_TEST, OPL3_ENABLE_WAVE_SELECT);
+	snd_opl3_reg_invalidate(opl3);
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_TEST,
+			   OPL3_ENABLE_WAVE_SELECT);
 	/* Melodic mode */
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, 0x00);
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, 0x00);
 
 	switch (opl3->hardware & OPL3_HW_MASK) {
 	case OPL3_HW_OPL2:
@@ -393,13 +397,68 @@ int snd_opl3_init(struct snd_opl3 *opl3)
 	case OPL3_HW_OPL4:
 		opl3->max_voices = MAX_OPL3_VOICES;
 		/* Enter OPL3 mode */
-		opl3->command(opl3, OPL3_RIGHT | OPL3_REG_MODE, OPL3_OPL3_ENABLE);
+		snd_opl3_reg_write(opl3, OPL3_RIGHT | OPL3_REG_MODE,
+				   OPL3_OPL3_ENABLE);
 	}
 	return 0;
 }
 
 EXPORT_SYMBOL(snd_opl3_init);
 
+/*
+ * The synth register writes go through a shadow of the chip registers:
+ * a write of the value a register already holds costs no port access,
+ * which with the delays around each write is what dominates a note-on.
+ * The test and timer registers of the left bank are strobes and always
+ * written.  The shadow is forgotten when the chip is (re)initialized.
+ */
+static bool snd_opl3_reg_volatile(unsigned short cmd)
+{
+	return !(cmd & OPL3_RIGHT) &&
+		(cmd & 0xff) <= OPL3_REG_TIMER_CONTROL;
+}
+
+void snd_opl3_reg_write_burst(struct snd_opl3 *opl3,
+			      const struct snd_opl3_reg *regs, int count)
+{
+	unsigned long flags;
+	unsigned int idx;
+
+	spin_lock_irqsave(&opl3->shadow_lock, flags);
+	for (; count > 0; regs++, count--) {
+		idx = regs->cmd & 0x1ff;
+		if (opl3->reg_shadow[idx] == regs->val &&
+		    !snd_opl3_reg_volatile(regs->cmd))
+			continue;
+		opl3->command(opl3, regs->cmd, regs->val);
+		opl3->reg_shadow[idx] = regs->val;
+	}
+	spin_unlock_irqrestore(&opl3->shadow_lock, flags);
+}
+
+EXPORT_SYMBOL(snd_opl3_reg_write_burst);
+
+void snd_opl3_reg_write(struct snd_opl3 *opl3, unsigned short cmd,
+			unsigned char val)
+{
+	struct snd_opl3_reg reg = { .cmd = cmd, .val = val };
+
+	snd_opl3_reg_write_burst(opl3, &reg, 1);
+}
+
+EXPORT_SYMBOL(snd_opl3_reg_write);
+
+void snd_opl3_reg_invalidate(struct snd_opl3 *opl3)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&opl3->shadow_lock, flags);
+	memset(opl3->reg_shadow, 0xff, sizeof(opl3->reg_shadow));
+	spin_unlock_irqrestore(&opl3->shadow_lock, flags);
+}
+
+EXPORT_SYMBOL(snd_opl3_reg_invalidate);
+
 int snd_opl3_create(struct snd_card *card,
 		    unsigned long l_port,
 		    unsigned long r_port,
@@ -315,6 +315,10 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 	unsigned char fnum, blocknum;
 	int i;
 
+	/* 4 operators of 5 registers, 2 connections, fnum and key-on */
+	struct snd_opl3_reg regs[24];
+	int nregs;
+
 	struct fm_patch *patch;
 	struct fm_instrument *fm;
 	unsigned long flags;
@@ -356,6 +360,7 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 	}
 
  __extra_prg:
+	nregs = 0;
 	patch = snd_opl3_find_patch(opl3, prg, bank, 0);
 	if (!patch) {
 		spin_unlock_irqrestore(&opl3->voice_lock, flags);
@@ -411,7 +416,7 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 	if (vp->state > 0) {
 		opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
 		reg_val = vp->keyon_reg & ~OPL3_KEYON_BIT;
-		opl3->command(opl3, opl3_reg, reg_val);
+		snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 	}
 	if (instr_4op) {
 		vp2 = &opl3->voices[voice + 3];
@@ -419,7 +424,7 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 			opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK +
 					       voice_offset + 3);
 			reg_val = vp->keyon_reg & ~OPL3_KEYON_BIT;
-			opl3->command(opl3, opl3_reg, reg_val);
+			snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 		}
 	}
 
@@ -429,14 +434,14 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 			opl3->connection_reg |= connect_mask;
 			/* set connection bit */
 			opl3_reg = OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT;
-			opl3->command(opl3, opl3_reg, opl3->connection_reg);
+			snd_opl3_reg_write(opl3, opl3_reg, opl3->connection_reg);
 		}
 	} else {
 		if ((opl3->connection_reg ^ ~connect_mask) & connect_mask) {
 			opl3->connection_reg &= ~connect_mask;
 			/* clear connection bit */
 			opl3_reg = OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT;
-			opl3->command(opl3, opl3_reg, opl3->connection_reg);
+			snd_opl3_reg_write(opl3, opl3_reg, opl3->connection_reg);
 		}
 	}
 
@@ -481,29 +486,24 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 		op_offset = snd_opl3_regmap[voice_offset][i];
 
 		/* Set OPL3 AM_VIB register of requested voice/operator */ 
-		reg_val = fm->op[i].am_vib;
-		opl3_reg = reg_side | (OPL3_REG_AM_VIB + op_offset);
-		opl3->command(opl3, opl3_reg, reg_val);
+		regs[nregs].cmd = reg_side | (OPL3_REG_AM_VIB + op_offset);
+		regs[nregs++].val = fm->op[i].am_vib;
 
 		/* Set OPL3 KSL_LEVEL register of requested voice/operator */ 
-		reg_val = vol_op[i];
-		opl3_reg = reg_side | (OPL3_REG_KSL_LEVEL + op_offset);
-		opl3->command(opl3, opl3_reg, reg_val);
+		regs[nregs].cmd = reg_side | (OPL3_REG_KSL_LEVEL + op_offset);
+		regs[nregs++].val = vol_op[i];
 
 		/* Set OPL3 ATTACK_DECAY register of requested voice/operator */ 
-		reg_val = fm->op[i].attack_decay;
-		opl3_reg = reg_side | (OPL3_REG_ATTACK_DECAY + op_offset);
-		opl3->command(opl3, opl3_reg, reg_val);
+		regs[nregs].cmd = reg_side | (OPL3_REG_ATTACK_DECAY + op_offset);
+		regs[nregs++].val = fm->op[i].attack_decay;
 
 		/* Set OPL3 SUSTAIN_RELEASE register of requested voice/operator */ 
-		reg_val = fm->op[i].sustain_release;
-		opl3_reg = reg_side | (OPL3_REG_SUSTAIN_RELEASE + op_offset);
-		opl3->command(opl3, opl3_reg, reg_val);
+		regs[nregs].cmd = reg_side | (OPL3_REG_SUSTAIN_RELEASE + op_offset);
+		regs[nregs++].val = fm->op[i].sustain_release;
 
 		/* Select waveform */
-		reg_val = fm->op[i].wave_select;
-		opl3_reg = reg_side | (OPL3_REG_WAVE_SELECT + op_offset);
-		opl3->command(opl3, opl3_reg, reg_val);
+		regs[nregs].cmd = reg_side | (OPL3_REG_WAVE_SELECT + op_offset);
+		regs[nregs++].val = fm->op[i].wave_select;
 	}
 
 	/* Set operator feedback and 2op inter-operator connection */
@@ -514,8 +514,9 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 		reg_val &= ~OPL3_VOICE_TO_RIGHT;
 	if (chan->gm_pan > 85)
 		reg_val &= ~OPL3_VOICE_TO_LEFT;
-	opl3_reg = reg_side | (OPL3_REG_FEEDBACK_CONNECTION + voice_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	regs[nregs].cmd = reg_side | (OPL3_REG_FEEDBACK_CONNECTION +
+				      voice_offset);
+	regs[nregs++].val = reg_val;
 
 	if (instr_4op) {
 		/* Set 4op inter-operator connection */
@@ -526,9 +527,9 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 			reg_val &= ~OPL3_VOICE_TO_RIGHT;
 		if (chan->gm_pan > 85)
 			reg_val &= ~OPL3_VOICE_TO_LEFT;
-		opl3_reg = reg_side | (OPL3_REG_FEEDBACK_CONNECTION +
-				       voice_offset + 3);
-		opl3->command(opl3, opl3_reg, reg_val);
+		regs[nregs].cmd = reg_side | (OPL3_REG_FEEDBACK_CONNECTION +
+					      voice_offset + 3);
+		regs[nregs++].val = reg_val;
 	}
 
 	/*
@@ -547,8 +548,8 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 	snd_opl3_calc_pitch(&fnum, &blocknum, note, chan);
 
 	/* Set OPL3 FNUM_LOW register of requested voice */
-	opl3_reg = reg_side | (OPL3_REG_FNUM_LOW + voice_offset);
-	opl3->command(opl3, opl3_reg, fnum);
+	regs[nregs].cmd = reg_side | (OPL3_REG_FNUM_LOW + voice_offset);
+	regs[nregs++].val = fnum;
 
 	opl3->voices[voice].keyon_reg = blocknum;
 
@@ -559,8 +560,11 @@ void snd_opl3_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 	snd_printk(KERN_DEBUG "  --> trigger voice %i\n", voice);
 #endif
 	/* Set OPL3 KEYON_BLOCK register of requested voice */ 
-	opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
-	opl3->command(opl3, opl3_reg, blocknum);
+	regs[nregs].cmd = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
+	regs[nregs++].val = blocknum;
+
+	/* program the whole voice and key it on in one burst */
+	snd_opl3_reg_write_burst(opl3, regs, nregs);
 
 	/* kill note after fixed duration (in centiseconds) */
 	if (fm->fix_dur) {
@@ -647,7 +651,7 @@ static void snd_opl3_kill_voice(struct snd_opl3 *opl3, int voice)
 #endif
 	opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
 	/* clear Key ON bit */
-	opl3->command(opl3, opl3_reg, vp->keyon_reg);
+	snd_opl3_reg_write(opl3, opl3_reg, vp->keyon_reg);
 
 	/* do the bookkeeping */
 	vp->time = opl3->use_time++;
@@ -775,7 +779,7 @@ static void snd_opl3_update_pitch(struct snd_opl3 *opl3, int voice)
 
 	/* Set OPL3 FNUM_LOW register of requested voice */
 	opl3_reg = reg_side | (OPL3_REG_FNUM_LOW + voice_offset);
-	opl3->command(opl3, opl3_reg, fnum);
+	snd_opl3_reg_write(opl3, opl3_reg, fnum);
 
 	vp->keyon_reg = blocknum;
 
@@ -784,7 +788,7 @@ static void snd_opl3_update_pitch(struct snd_opl3 *opl3, int voice)
 
 	/* Set OPL3 KEYON_BLOCK register of requested voice */ 
 	opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
-	opl3->command(opl3, opl3_reg, blocknum);
+	snd_opl3_reg_write(opl3, opl3_reg, blocknum);
 
 	vp->time = opl3->use_time++;
 }
@@ -838,7 +842,7 @@ void snd_opl3_control(void *p, int type, struct snd_midi_channel *chan)
 			opl3->drum_reg |= OPL3_VIBRATO_DEPTH;
 		else 
 			opl3->drum_reg &= ~OPL3_VIBRATO_DEPTH;
-		opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION,
+		snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION,
 				 opl3->drum_reg);
 		break;
 	case MIDI_CTL_E2_TREMOLO_DEPTH:
@@ -846,7 +850,7 @@ void snd_opl3_control(void *p, int type, struct snd_midi_channel *chan)
 			opl3->drum_reg |= OPL3_TREMOLO_DEPTH;
 		else 
 			opl3->drum_reg &= ~OPL3_TREMOLO_DEPTH;
-		opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION,
+		snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION,
 				 opl3->drum_reg);
 		break;
 	case MIDI_CTL_PITCHBEND:
@@ -73,7 +73,7 @@ int snd_opl3_synth_setup(struct snd_opl3 * opl3)
 	opl3->connection_reg = 0x00;
 	if (opl3->hardware >= OPL3_HW_OPL3) {
 		/* Clear 4-op connections */
-		opl3->command(opl3, OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT,
+		snd_opl3_reg_write(opl3, OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT,
 				 opl3->connection_reg);
 		opl3->max_voices = MAX_OPL3_VOICES;
 	}
@@ -115,7 +115,7 @@ static int snd_opl3_synth_use(void *private_data, struct snd_seq_port_subscribe
 			opl3->voices[8].state = SNDRV_OPL3_ST_NOT_AVAIL;
 		snd_opl3_load_drums(opl3);
 		opl3->drum_reg = OPL3_PERCUSSION_ENABLE;
-		opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, opl3->drum_reg);
+		snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, opl3->drum_reg);
 	} else {
 		opl3->drum_reg = 0x00;
 	}
@@ -277,11 +277,35 @@ static int snd_opl3_seq_remove(struct device *_dev)
 	return 0;
 }
 
+#ifdef CONFIG_PM_SLEEP
+/*
+ * The chip loses its registers over a system suspend.  The card driver
+ * has restored the chip by now, since this device is its child; make the
+ * next synth writes go out instead of matching the stale shadow.
+ */
+static int snd_opl3_seq_resume(struct device *_dev)
+{
+	struct snd_seq_device *dev = to_seq_dev(_dev);
+	struct snd_opl3 *opl3;
+
+	opl3 = *(struct snd_opl3 **)SNDRV_SEQ_DEVICE_ARGPTR(dev);
+	if (opl3)
+		snd_opl3_reg_invalidate(opl3);
+	return 0;
+}
+
+static SIMPLE_DEV_PM_OPS(snd_opl3_seq_pm, NULL, snd_opl3_seq_resume);
+#define SND_OPL3_SEQ_PM_OPS	&snd_opl3_seq_pm
+#else
+#define SND_OPL3_SEQ_PM_OPS	NULL
+#endif
+
 static struct snd_seq_driver opl3_seq_driver = {
 	.driver = {
 		.name = KBUILD_MODNAME,
 		.probe = snd_opl3_seq_probe,
 		.remove = snd_opl3_seq_remove,
+		.pm = SND_OPL3_SEQ_PM_OPS,
 	},
 	.id = SNDRV_SEQ_DEV_ID_OPL3,
 	.argsize = sizeof(struct snd_opl3 *),
@@ -367,6 +367,8 @@ void snd_opl3_reset(struct snd_opl3 * opl3)
 	max_voices = (opl3->hardware < OPL3_HW_OPL3) ?
 		MAX_OPL2_VOICES : MAX_OPL3_VOICES;
 
+	/* write everything out, whatever the chip went through */
+	snd_opl3_reg_invalidate(opl3);
 	for (i = 0; i < max_voices; i++) {
 		/* Get register array side and offset of voice */
 		if (i < MAX_OPL2_VOICES) {
@@ -379,19 +381,19 @@ void snd_opl3_reset(struct snd_opl3 * opl3)
 			voice_offset = i - MAX_OPL2_VOICES;
 		}
 		opl3_reg = reg_side | (OPL3_REG_KSL_LEVEL + snd_opl3_regmap[voice_offset][0]);
-		opl3->command(opl3, opl3_reg, OPL3_TOTAL_LEVEL_MASK); /* Operator 1 volume */
+		snd_opl3_reg_write(opl3, opl3_reg, OPL3_TOTAL_LEVEL_MASK); /* Operator 1 volume */
 		opl3_reg = reg_side | (OPL3_REG_KSL_LEVEL + snd_opl3_regmap[voice_offset][1]);
-		opl3->command(opl3, opl3_reg, OPL3_TOTAL_LEVEL_MASK); /* Operator 2 volume */
+		snd_opl3_reg_write(opl3, opl3_reg, OPL3_TOTAL_LEVEL_MASK); /* Operator 2 volume */
 
 		opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
-		opl3->command(opl3, opl3_reg, 0x00);	/* Note off */
+		snd_opl3_reg_write(opl3, opl3_reg, 0x00);	/* Note off */
 	}
 
 	opl3->max_voices = MAX_OPL2_VOICES;
 	opl3->fm_mode = SNDRV_DM_FM_MODE_OPL2;
 
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_TEST, OPL3_ENABLE_WAVE_SELECT);
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, 0x00);	/* Melodic mode */
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_TEST, OPL3_ENABLE_WAVE_SELECT);
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, 0x00);	/* Melodic mode */
 	opl3->rhythm = 0;
 }
 
@@ -425,7 +427,7 @@ static int snd_opl3_play_note(struct snd_opl3 * opl3, struct snd_dm_fm_note * no
 	/* Set lower 8 bits of note frequency */
 	reg_val = (unsigned char) note->fnum;
 	opl3_reg = reg_side | (OPL3_REG_FNUM_LOW + voice_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 	
 	reg_val = 0x00;
 	/* Set output sound flag */
@@ -438,7 +440,7 @@ static int snd_opl3_play_note(struct snd_opl3 * opl3, struct snd_dm_fm_note * no
 
 	/* Set OPL3 KEYON_BLOCK register of requested voice */ 
 	opl3_reg = reg_side | (OPL3_REG_KEYON_BLOCK + voice_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	return 0;
 }
@@ -493,7 +495,7 @@ static int snd_opl3_set_voice(struct snd_opl3 * opl3, struct snd_dm_fm_voice * v
 
 	/* Set OPL3 AM_VIB register of requested voice/operator */ 
 	opl3_reg = reg_side | (OPL3_REG_AM_VIB + op_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	/* Set decreasing volume of higher notes */
 	reg_val = (voice->scale_level << 6) & OPL3_KSL_MASK;
@@ -502,7 +504,7 @@ static int snd_opl3_set_voice(struct snd_opl3 * opl3, struct snd_dm_fm_voice * v
 
 	/* Set OPL3 KSL_LEVEL register of requested voice/operator */ 
 	opl3_reg = reg_side | (OPL3_REG_KSL_LEVEL + op_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	/* Set attack phase level */
 	reg_val = (voice->attack << 4) & OPL3_ATTACK_MASK;
@@ -511,7 +513,7 @@ static int snd_opl3_set_voice(struct snd_opl3 * opl3, struct snd_dm_fm_voice * v
 
 	/* Set OPL3 ATTACK_DECAY register of requested voice/operator */ 
 	opl3_reg = reg_side | (OPL3_REG_ATTACK_DECAY + op_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	/* Set sustain phase level */
 	reg_val = (voice->sustain << 4) & OPL3_SUSTAIN_MASK;
@@ -520,7 +522,7 @@ static int snd_opl3_set_voice(struct snd_opl3 * opl3, struct snd_dm_fm_voice * v
 
 	/* Set OPL3 SUSTAIN_RELEASE register of requested voice/operator */ 
 	opl3_reg = reg_side | (OPL3_REG_SUSTAIN_RELEASE + op_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	/* Set inter-operator feedback */
 	reg_val = (voice->feedback << 1) & OPL3_FEEDBACK_MASK;
@@ -536,12 +538,12 @@ static int snd_opl3_set_voice(struct snd_opl3 * opl3, struct snd_dm_fm_voice * v
 	}
 	/* Feedback/connection bits are applicable to voice */
 	opl3_reg = reg_side | (OPL3_REG_FEEDBACK_CONNECTION + voice_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	/* Select waveform */
 	reg_val = voice->waveform & OPL3_WAVE_SELECT_MASK;
 	opl3_reg = reg_side | (OPL3_REG_WAVE_SELECT + op_offset);
-	opl3->command(opl3, opl3_reg, reg_val);
+	snd_opl3_reg_write(opl3, opl3_reg, reg_val);
 
 	return 0;
 }
@@ -554,7 +556,7 @@ static int snd_opl3_set_params(struct snd_opl3 * opl3, struct snd_dm_fm_params *
 	/* Set keyboard split method */
 	if (params->kbd_split)
 		reg_val |= OPL3_KEYBOARD_SPLIT;
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_KBD_SPLIT, reg_val);
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_KBD_SPLIT, reg_val);
 
 	reg_val = 0x00;
 	/* Set amplitude modulation (tremolo) depth */
@@ -582,7 +584,7 @@ static int snd_opl3_set_params(struct snd_opl3 * opl3, struct snd_dm_fm_params *
 	if (params->hihat)
 		reg_val |= OPL3_HIHAT_ON;
 
-	opl3->command(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, reg_val);
+	snd_opl3_reg_write(opl3, OPL3_LEFT | OPL3_REG_PERCUSSION, reg_val);
 	return 0;
 }
 
@@ -593,7 +595,7 @@ static int snd_opl3_set_mode(struct snd_opl3 * opl3, int mode)
 
 	opl3->fm_mode = mode;
 	if (opl3->hardware >= OPL3_HW_OPL3)
-		opl3->command(opl3, OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT, 0x00);	/* Clear 4-op connections */
+		snd_opl3_reg_write(opl3, OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT, 0x00);	/* Clear 4-op connections */
 
 	return 0;
 }
@@ -609,7 +611,7 @@ static int snd_opl3_set_connection(struct snd_opl3 * opl3, int connection)
 	reg_val = connection & (OPL3_RIGHT_4OP_0 | OPL3_RIGHT_4OP_1 | OPL3_RIGHT_4OP_2 |
 				OPL3_LEFT_4OP_0 | OPL3_LEFT_4OP_1 | OPL3_LEFT_4OP_2);
 	/* Set 4-op connections */
-	opl3->command(opl3, OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT, reg_val);
+	snd_opl3_reg_write(opl3, OPL3_RIGHT | OPL3_REG_CONNECTION_SELECT, reg_val);
 
 	return 0;
 }
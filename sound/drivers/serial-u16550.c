@@ -890,6 +890,8 @@ static int snd_uart16550_rmidi(struct snd_uart16550 *uart, int device,
 	rrawmidi->info_flags = SNDRV_RAWMIDI_INFO_OUTPUT |
 			       SNDRV_RAWMIDI_INFO_INPUT |
 			       SNDRV_RAWMIDI_INFO_DUPLEX;
+	/* input is received only under uart->open_lock */
+	rrawmidi->lockless_input = true;
 	rrawmidi->private_data = uart;
 	if (rmidi)
 		*rmidi = rrawmidi;
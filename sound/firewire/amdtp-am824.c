@@ -36,6 +36,7 @@ struct amdtp_am824 {
 	unsigned int midi_ports;
 
 	u8 pcm_positions[AM824_MAX_CHANNELS_FOR_PCM];
+	bool pcm_in_order;	/* pcm_positions[i] == i for all channels */
 	u8 midi_position;
 
 	unsigned int frame_multiplier;
@@ -101,6 +102,7 @@ int amdtp_am824_set_parameters(struct amdtp_stream *s, unsigned int rate,
 	/* init the position map for PCM and MIDI channels */
 	for (i = 0; i < pcm_channels; i++)
 		p->pcm_positions[i] = i;
+	p->pcm_in_order = true;
 	p->midi_position = p->pcm_channels;
 
 	/*
@@ -126,9 +128,18 @@ void amdtp_am824_set_pcm_position(struct amdtp_stream *s, unsigned int index,
 				 unsigned int position)
 {
 	struct amdtp_am824 *p = s->protocol;
+	unsigned int i;
 
 	if (index < p->pcm_channels)
 		p->pcm_positions[index] = position;
+
+	p->pcm_in_order = true;
+	for (i = 0; i < p->pcm_channels; i++) {
+		if (p->pcm_positions[i] != i) {
+			p->pcm_in_order = false;
+			break;
+		}
+	}
 }
 EXPORT_SYMBOL_GPL(amdtp_am824_set_pcm_position);
 
@@ -147,6 +158,56 @@ void amdtp_am824_set_midi_position(struct amdtp_stream *s,
 }
 EXPORT_SYMBOL_GPL(amdtp_am824_set_midi_position);
 
+/*
+ * The PCM channels usually come first and in order in each data block.  Then
+ * the samples are converted in runs up to the end of the PCM buffer, without
+ * the position lookup, and in a single flat loop when the data blocks carry
+ * nothing else.
+ */
+static void write_pcm_s32_in_order(struct amdtp_stream *s,
+				   const u32 *src, __be32 *buffer,
+				   unsigned int frames)
+{
+	struct amdtp_am824 *p = s->protocol;
+	unsigned int channels = p->pcm_channels;
+	unsigned int i, c;
+
+	if (s->data_block_quadlets == channels) {
+		for (i = 0; i < frames * channels; ++i)
+			buffer[i] = cpu_to_be32((src[i] >> 8) | 0x40000000);
+		return;
+	}
+
+	for (i = 0; i < frames; ++i) {
+		for (c = 0; c < channels; ++c)
+			buffer[c] = cpu_to_be32((src[c] >> 8) | 0x40000000);
+		src += channels;
+		buffer += s->data_block_quadlets;
+	}
+}
+
+static void read_pcm_s32_in_order(struct amdtp_stream *s,
+				  u32 *dst, const __be32 *buffer,
+				  unsigned int frames)
+{
+	struct amdtp_am824 *p = s->protocol;
+	unsigned int channels = p->pcm_channels;
+	unsigned int i, c;
+
+	if (s->data_block_quadlets == channels) {
+		for (i = 0; i < frames * channels; ++i)
+			dst[i] = be32_to_cpu(buffer[i]) << 8;
+		return;
+	}
+
+	for (i = 0; i < frames; ++i) {
+		for (c = 0; c < channels; ++c)
+			dst[c] = be32_to_cpu(buffer[c]) << 8;
+		dst += channels;
+		buffer += s->data_block_quadlets;
+	}
+}
+
 static void write_pcm_s32(struct amdtp_stream *s,
 			  struct snd_pcm_substream *pcm,
 			  __be32 *buffer, unsigned int frames)
@@ -161,6 +222,18 @@ static void write_pcm_s32(struct amdtp_stream *s,
 			frames_to_bytes(runtime, s->pcm_buffer_pointer);
 	remaining_frames = runtime->buffer_size - s->pcm_buffer_pointer;
 
+	if (p->pcm_in_order) {
+		while (frames > 0) {
+			i = min(frames, remaining_frames);
+			write_pcm_s32_in_order(s, src, buffer, i);
+			buffer += i * s->data_block_quadlets;
+			frames -= i;
+			src = (void *)runtime->dma_area;
+			remaining_frames = runtime->buffer_size;
+		}
+		return;
+	}
+
 	for (i = 0; i < frames; ++i) {
 		for (c = 0; c < channels; ++c) {
 			buffer[p->pcm_positions[c]] =
@@ -187,6 +260,18 @@ static void read_pcm_s32(struct amdtp_stream *s,
 			frames_to_bytes(runtime, s->pcm_buffer_pointer);
 	remaining_frames = runtime->buffer_size - s->pcm_buffer_pointer;
 
+	if (p->pcm_in_order) {
+		while (frames > 0) {
+			i = min(frames, remaining_frames);
+			read_pcm_s32_in_order(s, dst, buffer, i);
+			buffer += i * s->data_block_quadlets;
+			frames -= i;
+			dst = (void *)runtime->dma_area;
+			remaining_frames = runtime->buffer_size;
+		}
+		return;
+	}
+
 	for (i = 0; i < frames; ++i) {
 		for (c = 0; c < channels; ++c) {
 			*dst = be32_to_cpu(buffer[p->pcm_positions[c]]) << 8;
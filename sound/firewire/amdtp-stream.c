@@ -9,8 +9,12 @@
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/firewire.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
+#include <linux/prefetch.h>
 #include <linux/slab.h>
+#include <uapi/linux/sched/types.h>
+#include <sound/info.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
 #include "amdtp-stream.h"
@@ -52,14 +56,30 @@
 #define CIP_FMT_AM		0x10
 #define AMDTP_FDF_NO_DATA	0xff
 
-/* TODO: make these configurable */
+/* in packets, i.e. isochronous cycles */
 #define INTERRUPT_INTERVAL	16
 #define QUEUE_LENGTH		48
+#define MIN_QUEUE_LENGTH	8
+#define MAX_QUEUE_LENGTH	256
+
+static unsigned int queue_length = QUEUE_LENGTH;
+module_param(queue_length, uint, 0644);
+MODULE_PARM_DESC(queue_length, "Packets queued per stream, applied at stream start (" __stringify(MIN_QUEUE_LENGTH) "-" __stringify(MAX_QUEUE_LENGTH) ", default: " __stringify(QUEUE_LENGTH) ").");
+static unsigned int interrupt_interval;
+module_param(interrupt_interval, uint, 0644);
+MODULE_PARM_DESC(interrupt_interval, "Packets per interrupt, applied at PCM start (default: 0 = two per PCM period, up to a third of the queue).");
+static unsigned int period_wakeup = AMDTP_PERIOD_TASKLET;
+module_param(period_wakeup, uint, 0644);
+MODULE_PARM_DESC(period_wakeup, "How to report PCM periods, applied at stream start (0 = tasklet (default), 1 = from the isochronous callback, 2 = from an RT thread).");
+static bool pointer_flush = true;
+module_param(pointer_flush, bool, 0644);
+MODULE_PARM_DESC(pointer_flush, "Process the completed packets when the PCM position is read (default: yes, always off for period_wakeup=1).");
 
 #define IN_PACKET_HEADER_SIZE	4
 #define OUT_PACKET_HEADER_SIZE	0
 
 static void pcm_period_tasklet(unsigned long data);
+static void pcm_period_work(struct kthread_work *work);
 
 /**
  * amdtp_stream_init - initialize an AMDTP stream structure
@@ -90,6 +110,7 @@ int amdtp_stream_init(struct amdtp_stream *s, struct fw_unit *unit,
 	s->context = ERR_PTR(-1);
 	mutex_init(&s->mutex);
 	tasklet_init(&s->period_tasklet, pcm_period_tasklet, (unsigned long)s);
+	kthread_init_work(&s->period_work, pcm_period_work);
 	s->packet_index = 0;
 
 	init_waitqueue_head(&s->callback_wait);
@@ -113,11 +134,110 @@ void amdtp_stream_destroy(struct amdtp_stream *s)
 		return;
 
 	WARN_ON(amdtp_stream_running(s));
+	if (s->domain) {
+		spin_lock_bh(&s->domain->lock);
+		list_del(&s->domain_list);
+		spin_unlock_bh(&s->domain->lock);
+		s->domain = NULL;
+	}
 	kfree(s->protocol);
 	mutex_destroy(&s->mutex);
 }
 EXPORT_SYMBOL(amdtp_stream_destroy);
 
+/**
+ * amdtp_domain_init - initialize a group of streams sharing interrupts
+ * @d: the AMDTP domain to initialize
+ *
+ * A unit with several isochronous streams can have them share one interrupt
+ * schedule.  The first stream started in the domain raises the interrupts as
+ * usual; its callback then handles the completed packets of all the other
+ * running streams, in the order they were added.  The other streams only
+ * raise an interrupt every half queue, as a safety net for the case the
+ * interrupting stream stops.
+ */
+void amdtp_domain_init(struct amdtp_domain *d)
+{
+	INIT_LIST_HEAD(&d->streams);
+	spin_lock_init(&d->lock);
+	d->irq_target = NULL;
+}
+EXPORT_SYMBOL(amdtp_domain_init);
+
+/**
+ * amdtp_domain_add_stream - register a stream to an AMDTP domain
+ * @d: the AMDTP domain
+ * @s: the AMDTP stream, initialized and not running
+ *
+ * The stream leaves the domain when it is destroyed.
+ */
+void amdtp_domain_add_stream(struct amdtp_domain *d, struct amdtp_stream *s)
+{
+	if (WARN_ON(amdtp_stream_running(s) || s->domain))
+		return;
+
+	s->domain = d;
+	s->domain_running = false;
+	spin_lock_bh(&d->lock);
+	list_add_tail(&s->domain_list, &d->streams);
+	spin_unlock_bh(&d->lock);
+}
+EXPORT_SYMBOL(amdtp_domain_add_stream);
+
+static void domain_join(struct amdtp_stream *s)
+{
+	struct amdtp_domain *d = s->domain;
+
+	if (!d)
+		return;
+
+	spin_lock_bh(&d->lock);
+	s->domain_running = true;
+	if (!d->irq_target)
+		d->irq_target = s;
+	spin_unlock_bh(&d->lock);
+}
+
+/* called before the context is stopped */
+static void domain_leave(struct amdtp_stream *s)
+{
+	struct amdtp_domain *d = s->domain;
+	struct amdtp_stream *t;
+
+	if (!d)
+		return;
+
+	spin_lock_bh(&d->lock);
+	s->domain_running = false;
+	if (d->irq_target == s) {
+		d->irq_target = NULL;
+		list_for_each_entry(t, &d->streams, domain_list) {
+			if (t->domain_running) {
+				d->irq_target = t;
+				break;
+			}
+		}
+	}
+	spin_unlock_bh(&d->lock);
+}
+
+/* in the callback of the interrupting stream, handle the others */
+static void domain_process(struct amdtp_stream *s)
+{
+	struct amdtp_domain *d = s->domain;
+	struct amdtp_stream *t;
+
+	if (!d || READ_ONCE(d->irq_target) != s)
+		return;
+
+	spin_lock_bh(&d->lock);
+	list_for_each_entry(t, &d->streams, domain_list) {
+		if (t != s && t->domain_running)
+			fw_iso_context_flush_completions(t->context);
+	}
+	spin_unlock_bh(&d->lock);
+}
+
 const unsigned int amdtp_syt_intervals[CIP_SFC_COUNT] = {
 	[CIP_SFC_32000]  =  8,
 	[CIP_SFC_44100]  =  8,
@@ -275,6 +395,8 @@ EXPORT_SYMBOL(amdtp_stream_get_max_payload);
 void amdtp_stream_pcm_prepare(struct amdtp_stream *s)
 {
 	tasklet_kill(&s->period_tasklet);
+	if (s->period_worker)
+		kthread_flush_work(&s->period_work);
 	s->pcm_buffer_pointer = 0;
 	s->pcm_period_pointer = 0;
 }
@@ -367,6 +489,10 @@ static unsigned int calculate_syt(struct amdtp_stream *s,
 	}
 }
 
+/*
+ * The buffer pointer advances with each packet, as the next packet continues
+ * from it. Periods are accounted once per callback, see update_pcm_period().
+ */
 static void update_pcm_pointers(struct amdtp_stream *s,
 				struct snd_pcm_substream *pcm,
 				unsigned int frames)
@@ -377,11 +503,39 @@ static void update_pcm_pointers(struct amdtp_stream *s,
 	if (ptr >= pcm->runtime->buffer_size)
 		ptr -= pcm->runtime->buffer_size;
 	ACCESS_ONCE(s->pcm_buffer_pointer) = ptr;
+}
+
+static void update_pcm_period(struct amdtp_stream *s, unsigned int frames)
+{
+	struct snd_pcm_substream *pcm = ACCESS_ONCE(s->pcm);
+
+	if (!pcm || frames == 0)
+		return;
 
 	s->pcm_period_pointer += frames;
-	if (s->pcm_period_pointer >= pcm->runtime->period_size) {
-		s->pcm_period_pointer -= pcm->runtime->period_size;
+	if (s->pcm_period_pointer < pcm->runtime->period_size)
+		return;
+	s->pcm_period_pointer %= pcm->runtime->period_size;
+
+	switch (s->period_wakeup) {
+	case AMDTP_PERIOD_DIRECT:
+		/*
+		 * The PCM position is then read without flushing the
+		 * completions, so nothing can hold the PCM stream lock while
+		 * waiting for this callback.  A flush from process context
+		 * still falls back to the tasklet.
+		 */
+		if (in_interrupt()) {
+			snd_pcm_period_elapsed(pcm);
+			break;
+		}
+		/* fall through */
+	case AMDTP_PERIOD_TASKLET:
 		tasklet_hi_schedule(&s->period_tasklet);
+		break;
+	case AMDTP_PERIOD_THREAD:
+		kthread_queue_work(s->period_worker, &s->period_work);
+		break;
 	}
 }
 
@@ -394,16 +548,112 @@ static void pcm_period_tasklet(unsigned long data)
 		snd_pcm_period_elapsed(pcm);
 }
 
+static void pcm_period_work(struct kthread_work *work)
+{
+	struct amdtp_stream *s =
+		container_of(work, struct amdtp_stream, period_work);
+	struct snd_pcm_substream *pcm = ACCESS_ONCE(s->pcm);
+
+	if (pcm)
+		snd_pcm_period_elapsed(pcm);
+}
+
+/* per-stream RT thread for period_wakeup=2, or tasklet on failure */
+static void create_period_worker(struct amdtp_stream *s)
+{
+	struct sched_param param = { .sched_priority = SNDRV_RT_PRIO };
+	struct kthread_worker *worker;
+
+	worker = kthread_create_worker(0, "amdtp-%s-%s",
+				       dev_name(&s->unit->device),
+				       s->direction == AMDTP_IN_STREAM ?
+				       "in" : "out");
+	if (IS_ERR(worker)) {
+		dev_warn(&s->unit->device,
+			 "cannot create the period thread: %ld\n",
+			 PTR_ERR(worker));
+		s->period_wakeup = AMDTP_PERIOD_TASKLET;
+		return;
+	}
+	sched_setscheduler(worker->task, SCHED_FIFO, &param);
+	s->period_worker = worker;
+}
+
+static inline u32 increment_cycle_count(u32 cycle, unsigned int addend)
+{
+	cycle += addend;
+	if (cycle >= 8 * CYCLES_PER_SECOND)
+		cycle -= 8 * CYCLES_PER_SECOND;
+	return cycle;
+}
+
+static void record_packet(struct amdtp_stream *s, unsigned int cycle,
+			  unsigned int syt, unsigned int data_blocks)
+{
+	struct amdtp_stream_stats *st = &s->stats;
+	unsigned int offset, expected;
+
+	if (st->packets++) {
+		expected = increment_cycle_count(st->last_cycle, 1);
+		if (cycle != expected)
+			st->skipped_cycles += (cycle + 8 * CYCLES_PER_SECOND -
+					       expected) %
+					      (8 * CYCLES_PER_SECOND);
+	}
+	st->last_cycle = cycle;
+
+	st->data_blocks[min(data_blocks, AMDTP_DATA_BLOCK_BUCKETS - 1u)]++;
+
+	if (syt == CIP_SYT_NO_INFO) {
+		st->no_syt++;
+		return;
+	}
+	offset = (((syt >> 12) - cycle) & 0xf) * TICKS_PER_CYCLE +
+		 (syt & 0xfff);
+	if (st->packets - st->no_syt == 1) {
+		st->syt_offset_min = offset;
+		st->syt_offset_max = offset;
+	} else {
+		st->syt_offset_min = min(st->syt_offset_min, offset);
+		st->syt_offset_max = max(st->syt_offset_max, offset);
+	}
+	st->syt_offsets[min(offset / (TICKS_PER_CYCLE / 2),
+			    AMDTP_SYT_OFFSET_BUCKETS - 1u)]++;
+}
+
+static void record_callback(struct amdtp_stream *s, unsigned int packets)
+{
+	struct amdtp_stream_stats *st = &s->stats;
+	ktime_t now = ktime_get();
+	unsigned int gap;
+
+	if (st->callbacks++) {
+		gap = ktime_us_delta(now, st->last_callback);
+		/* a cycle is 125 us */
+		if (gap > packets * 250)
+			st->late_callbacks++;
+		st->callback_gap_max = max(st->callback_gap_max, gap);
+	}
+	st->last_callback = now;
+}
+
 static int queue_packet(struct amdtp_stream *s, unsigned int header_length,
 			unsigned int payload_length)
 {
 	struct fw_iso_packet p = {0};
+	unsigned int interval;
 	int err = 0;
 
 	if (IS_ERR(s->context))
 		goto end;
 
-	p.interrupt = IS_ALIGNED(s->packet_index + 1, INTERRUPT_INTERVAL);
+	interval = s->interrupt_interval;
+	if (s->domain && READ_ONCE(s->domain->irq_target) != s)
+		interval = s->queue_length / 2;
+	if (++s->packets_since_interrupt >= interval) {
+		p.interrupt = true;
+		s->packets_since_interrupt = 0;
+	}
 	p.tag = s->tag;
 	p.header_length = header_length;
 	if (payload_length > 0)
@@ -417,7 +667,7 @@ static int queue_packet(struct amdtp_stream *s, unsigned int header_length,
 		goto end;
 	}
 
-	if (++s->packet_index >= QUEUE_LENGTH)
+	if (++s->packet_index >= s->queue_length)
 		s->packet_index = 0;
 end:
 	return err;
@@ -468,6 +718,7 @@ static int handle_out_packet(struct amdtp_stream *s,
 	payload_length = 8 + data_blocks * 4 * s->data_block_quadlets;
 
 	trace_out_packet(s, cycle, buffer, payload_length, index);
+	record_packet(s, cycle, syt, data_blocks);
 
 	if (queue_out_packet(s, payload_length) < 0)
 		return -EIO;
@@ -476,8 +727,7 @@ static int handle_out_packet(struct amdtp_stream *s,
 	if (pcm && pcm_frames > 0)
 		update_pcm_pointers(s, pcm, pcm_frames);
 
-	/* No need to return the number of handled data blocks. */
-	return 0;
+	return pcm_frames;
 }
 
 static int handle_out_packet_without_header(struct amdtp_stream *s,
@@ -500,6 +750,7 @@ static int handle_out_packet_without_header(struct amdtp_stream *s,
 
 	trace_out_packet_without_header(s, cycle, payload_length, data_blocks,
 					index);
+	record_packet(s, cycle, syt, data_blocks);
 
 	if (queue_out_packet(s, payload_length) < 0)
 		return -EIO;
@@ -508,8 +759,7 @@ static int handle_out_packet_without_header(struct amdtp_stream *s,
 	if (pcm && pcm_frames > 0)
 		update_pcm_pointers(s, pcm, pcm_frames);
 
-	/* No need to return the number of handled data blocks. */
-	return 0;
+	return pcm_frames;
 }
 
 static int handle_in_packet(struct amdtp_stream *s,
@@ -610,6 +860,7 @@ static int handle_in_packet(struct amdtp_stream *s,
 	}
 
 	syt = be32_to_cpu(buffer[1]) & CIP_SYT_MASK;
+	record_packet(s, cycle, syt, data_blocks);
 	pcm_frames = s->process_data_blocks(s, buffer + 2, data_blocks, &syt);
 
 	if (s->flags & CIP_DBC_IS_END_EVENT)
@@ -625,7 +876,7 @@ static int handle_in_packet(struct amdtp_stream *s,
 	if (pcm && pcm_frames > 0)
 		update_pcm_pointers(s, pcm, pcm_frames);
 
-	return 0;
+	return pcm_frames;
 }
 
 static int handle_in_packet_without_header(struct amdtp_stream *s,
@@ -642,6 +893,7 @@ static int handle_in_packet_without_header(struct amdtp_stream *s,
 
 	trace_in_packet_without_header(s, cycle, payload_quadlets, data_blocks,
 				       index);
+	record_packet(s, cycle, CIP_SYT_NO_INFO, data_blocks);
 
 	pcm_frames = s->process_data_blocks(s, buffer, data_blocks, NULL);
 	s->data_block_counter = (s->data_block_counter + data_blocks) & 0xff;
@@ -653,7 +905,7 @@ static int handle_in_packet_without_header(struct amdtp_stream *s,
 	if (pcm && pcm_frames > 0)
 		update_pcm_pointers(s, pcm, pcm_frames);
 
-	return 0;
+	return pcm_frames;
 }
 
 /*
@@ -666,14 +918,6 @@ static inline u32 compute_cycle_count(u32 tstamp)
 	return (((tstamp >> 13) & 0x07) * 8000) + (tstamp & 0x1fff);
 }
 
-static inline u32 increment_cycle_count(u32 cycle, unsigned int addend)
-{
-	cycle += addend;
-	if (cycle >= 8 * CYCLES_PER_SECOND)
-		cycle -= 8 * CYCLES_PER_SECOND;
-	return cycle;
-}
-
 static inline u32 decrement_cycle_count(u32 cycle, unsigned int subtrahend)
 {
 	if (cycle < subtrahend)
@@ -687,7 +931,9 @@ static void out_stream_callback(struct fw_iso_context *context, u32 tstamp,
 {
 	struct amdtp_stream *s = private_data;
 	unsigned int i, packets = header_length / 4;
+	unsigned int pcm_frames = 0;
 	u32 cycle;
+	int frames;
 
 	if (s->packet_index < 0)
 		return;
@@ -695,20 +941,39 @@ static void out_stream_callback(struct fw_iso_context *context, u32 tstamp,
 	cycle = compute_cycle_count(tstamp);
 
 	/* Align to actual cycle count for the last packet. */
-	cycle = increment_cycle_count(cycle, QUEUE_LENGTH - packets);
+	cycle = increment_cycle_count(cycle, s->queue_length - packets);
+
+	record_callback(s, packets);
 
 	for (i = 0; i < packets; ++i) {
 		cycle = increment_cycle_count(cycle, 1);
-		if (s->handle_packet(s, 0, cycle, i) < 0) {
+		frames = s->handle_packet(s, 0, cycle, i);
+		if (frames < 0) {
 			s->packet_index = -1;
 			if (in_interrupt())
 				amdtp_stream_pcm_abort(s);
 			WRITE_ONCE(s->pcm_buffer_pointer, SNDRV_PCM_POS_XRUN);
 			return;
 		}
+		pcm_frames += frames;
 	}
 
+	update_pcm_period(s, pcm_frames);
 	fw_iso_context_queue_flush(s->context);
+
+	domain_process(s);
+}
+
+static void prefetch_next_in_packet(struct amdtp_stream *s, __be32 header)
+{
+	unsigned int index = s->packet_index + 1;
+	unsigned int length;
+
+	if (index >= s->queue_length)
+		index = 0;
+	length = min(be32_to_cpu(header) >> ISO_DATA_LENGTH_SHIFT,
+		     s->max_payload_length);
+	prefetch_range(s->buffer.packets[index].buffer, length);
 }
 
 static void in_stream_callback(struct fw_iso_context *context, u32 tstamp,
@@ -718,8 +983,10 @@ static void in_stream_callback(struct fw_iso_context *context, u32 tstamp,
 	struct amdtp_stream *s = private_data;
 	unsigned int i, packets;
 	unsigned int payload_length, max_payload_length;
+	unsigned int pcm_frames = 0;
 	__be32 *headers = header;
 	u32 cycle;
+	int frames;
 
 	if (s->packet_index < 0)
 		return;
@@ -732,6 +999,8 @@ static void in_stream_callback(struct fw_iso_context *context, u32 tstamp,
 	/* Align to actual cycle count for the last packet. */
 	cycle = decrement_cycle_count(cycle, packets);
 
+	record_callback(s, packets);
+
 	/* For buffer-over-run prevention. */
 	max_payload_length = s->max_payload_length;
 
@@ -748,8 +1017,14 @@ static void in_stream_callback(struct fw_iso_context *context, u32 tstamp,
 			break;
 		}
 
-		if (s->handle_packet(s, payload_length, cycle, i) < 0)
+		/* the next packet is unpacked right after this one */
+		if (i + 1 < packets)
+			prefetch_next_in_packet(s, headers[i + 1]);
+
+		frames = s->handle_packet(s, payload_length, cycle, i);
+		if (frames < 0)
 			break;
+		pcm_frames += frames;
 	}
 
 	/* Queueing error or detecting invalid payload. */
@@ -761,7 +1036,10 @@ static void in_stream_callback(struct fw_iso_context *context, u32 tstamp,
 		return;
 	}
 
+	update_pcm_period(s, pcm_frames);
 	fw_iso_context_queue_flush(s->context);
+
+	domain_process(s);
 }
 
 /* this is executed one time */
@@ -794,7 +1072,7 @@ static void amdtp_stream_first_callback(struct fw_iso_context *context,
 			s->handle_packet = handle_in_packet;
 	} else {
 		packets = header_length / 4;
-		cycle = increment_cycle_count(cycle, QUEUE_LENGTH - packets);
+		cycle = increment_cycle_count(cycle, s->queue_length - packets);
 		context->callback.sc = out_stream_callback;
 		if (s->flags & CIP_NO_HEADER)
 			s->handle_packet = handle_out_packet_without_header;
@@ -807,6 +1085,14 @@ static void amdtp_stream_first_callback(struct fw_iso_context *context,
 	context->callback.sc(context, tstamp, header_length, header, s);
 }
 
+static void destroy_period_worker(struct amdtp_stream *s)
+{
+	if (s->period_worker) {
+		kthread_destroy_worker(s->period_worker);
+		s->period_worker = NULL;
+	}
+}
+
 /**
  * amdtp_stream_start - start transferring packets
  * @s: the AMDTP stream to start
@@ -851,6 +1137,21 @@ int amdtp_stream_start(struct amdtp_stream *s, int channel, int speed)
 	s->syt_offset_state = initial_state[s->sfc].syt_offset;
 	s->last_syt_offset = TICKS_PER_CYCLE;
 
+	s->queue_length = clamp_t(unsigned int, READ_ONCE(queue_length),
+				  MIN_QUEUE_LENGTH, MAX_QUEUE_LENGTH);
+	s->interrupt_interval = min_t(unsigned int, INTERRUPT_INTERVAL,
+				      s->queue_length / 3);
+	s->packets_since_interrupt = 0;
+	memset(&s->stats, 0, sizeof(s->stats));
+
+	s->period_wakeup = READ_ONCE(period_wakeup);
+	if (s->period_wakeup > AMDTP_PERIOD_THREAD)
+		s->period_wakeup = AMDTP_PERIOD_TASKLET;
+	s->pointer_flush = READ_ONCE(pointer_flush) &&
+			   s->period_wakeup != AMDTP_PERIOD_DIRECT;
+	if (s->period_wakeup == AMDTP_PERIOD_THREAD)
+		create_period_worker(s);
+
 	/* initialize packet buffer */
 	if (s->direction == AMDTP_IN_STREAM) {
 		dir = DMA_FROM_DEVICE;
@@ -861,10 +1162,12 @@ int amdtp_stream_start(struct amdtp_stream *s, int channel, int speed)
 		type = FW_ISO_CONTEXT_TRANSMIT;
 		header_size = OUT_PACKET_HEADER_SIZE;
 	}
-	err = iso_packets_buffer_init(&s->buffer, s->unit, QUEUE_LENGTH,
+	err = iso_packets_buffer_init(&s->buffer, s->unit, s->queue_length,
 				      amdtp_stream_get_max_payload(s), dir);
-	if (err < 0)
+	if (err < 0) {
+		destroy_period_worker(s);
 		goto err_unlock;
+	}
 
 	s->context = fw_iso_context_create(fw_parent_device(s->unit)->card,
 					   type, channel, speed, header_size,
@@ -904,6 +1207,8 @@ int amdtp_stream_start(struct amdtp_stream *s, int channel, int speed)
 	if (err < 0)
 		goto err_context;
 
+	domain_join(s);
+
 	mutex_unlock(&s->mutex);
 
 	return 0;
@@ -913,6 +1218,7 @@ int amdtp_stream_start(struct amdtp_stream *s, int channel, int speed)
 	s->context = ERR_PTR(-1);
 err_buffer:
 	iso_packets_buffer_destroy(&s->buffer, s->unit);
+	destroy_period_worker(s);
 err_unlock:
 	mutex_unlock(&s->mutex);
 
@@ -920,6 +1226,39 @@ int amdtp_stream_start(struct amdtp_stream *s, int channel, int speed)
 }
 EXPORT_SYMBOL(amdtp_stream_start);
 
+/**
+ * amdtp_stream_pcm_trigger - start/stop playback from a PCM device
+ * @s: the AMDTP stream
+ * @pcm: the PCM device to be started, or %NULL to stop the current device
+ *
+ * Call this function on a running isochronous stream to enable the actual
+ * transmission of PCM data.  This function should be called from the PCM
+ * device's .trigger callback.
+ *
+ * Starting a PCM device also adapts the interrupt interval of the stream to
+ * the period size, so that each period is noticed within half a period.
+ */
+void amdtp_stream_pcm_trigger(struct amdtp_stream *s,
+			      struct snd_pcm_substream *pcm)
+{
+	struct snd_pcm_runtime *runtime;
+	unsigned int interval;
+
+	if (pcm) {
+		runtime = pcm->runtime;
+		interval = READ_ONCE(interrupt_interval);
+		if (interval == 0 && runtime->rate > 0)
+			interval = div_u64((u64)runtime->period_size *
+					   CYCLES_PER_SECOND,
+					   runtime->rate * 2);
+		s->interrupt_interval = clamp(interval, 1u,
+					      s->queue_length / 3);
+	}
+
+	ACCESS_ONCE(s->pcm) = pcm;
+}
+EXPORT_SYMBOL(amdtp_stream_pcm_trigger);
+
 /**
  * amdtp_stream_pcm_pointer - get the PCM buffer position
  * @s: the AMDTP stream that transports the PCM data
@@ -943,8 +1282,11 @@ unsigned long amdtp_stream_pcm_pointer(struct amdtp_stream *s)
 	 * Later, the process context will sometimes schedules software IRQ
 	 * context of the period_tasklet. Then, no need to flush the queue by
 	 * the same reason as described for IR/IT contexts.
+	 *
+	 * The flush can be disabled with the pointer_flush parameter, and is
+	 * always skipped when periods are reported from the IR/IT contexts.
 	 */
-	if (!in_interrupt() && amdtp_stream_running(s))
+	if (s->pointer_flush && !in_interrupt() && amdtp_stream_running(s))
 		fw_iso_context_flush_completions(s->context);
 
 	return ACCESS_ONCE(s->pcm_buffer_pointer);
@@ -963,7 +1305,7 @@ int amdtp_stream_pcm_ack(struct amdtp_stream *s)
 	 * Process isochronous packets for recent isochronous cycle to handle
 	 * queued PCM frames.
 	 */
-	if (amdtp_stream_running(s))
+	if (s->pointer_flush && amdtp_stream_running(s))
 		fw_iso_context_flush_completions(s->context);
 
 	return 0;
@@ -999,11 +1341,13 @@ void amdtp_stream_stop(struct amdtp_stream *s)
 		return;
 	}
 
+	domain_leave(s);
 	tasklet_kill(&s->period_tasklet);
 	fw_iso_context_stop(s->context);
 	fw_iso_context_destroy(s->context);
 	s->context = ERR_PTR(-1);
 	iso_packets_buffer_destroy(&s->buffer, s->unit);
+	destroy_period_worker(s);
 
 	s->callbacked = false;
 
@@ -1027,3 +1371,55 @@ void amdtp_stream_pcm_abort(struct amdtp_stream *s)
 		snd_pcm_stop_xrun(pcm);
 }
 EXPORT_SYMBOL(amdtp_stream_pcm_abort);
+
+/**
+ * amdtp_stream_dump_stats - print the timing statistics of a stream
+ * @s: the AMDTP stream
+ * @buffer: the proc buffer to print to
+ *
+ * The statistics cover the packets since the stream was last started: cycles
+ * skipped between packets, callbacks more than twice as late as the packets
+ * they handle, and the distributions of the data block counts and of the SYT
+ * offsets from the start of the packet's cycle.
+ */
+void amdtp_stream_dump_stats(struct amdtp_stream *s,
+			     struct snd_info_buffer *buffer)
+{
+	struct amdtp_stream_stats *st = &s->stats;
+	unsigned int i;
+
+	snd_iprintf(buffer, "  running: %s\n",
+		    amdtp_stream_running(s) ? "yes" : "no");
+	if (st->packets == 0)
+		return;
+
+	snd_iprintf(buffer, "  packets: %u\n", st->packets);
+	snd_iprintf(buffer, "  skipped cycles: %u\n", st->skipped_cycles);
+	snd_iprintf(buffer, "  callbacks: %u (late: %u, max gap: %u us)\n",
+		    st->callbacks, st->late_callbacks, st->callback_gap_max);
+	snd_iprintf(buffer, "  interrupt interval: %u packets of %u\n",
+		    s->interrupt_interval, s->queue_length);
+
+	snd_iprintf(buffer, "  data blocks:");
+	for (i = 0; i < AMDTP_DATA_BLOCK_BUCKETS; i++) {
+		if (st->data_blocks[i])
+			snd_iprintf(buffer, " %u%s:%u", i,
+				    i == AMDTP_DATA_BLOCK_BUCKETS - 1 ?
+				    "+" : "", st->data_blocks[i]);
+	}
+	snd_iprintf(buffer, "\n");
+
+	if (st->packets == st->no_syt)
+		return;
+	snd_iprintf(buffer, "  syt offset: %u - %u ticks (no syt: %u)\n",
+		    st->syt_offset_min, st->syt_offset_max, st->no_syt);
+	snd_iprintf(buffer, "  syt offset (half cycles):");
+	for (i = 0; i < AMDTP_SYT_OFFSET_BUCKETS; i++) {
+		if (st->syt_offsets[i])
+			snd_iprintf(buffer, " %u%s:%u", i,
+				    i == AMDTP_SYT_OFFSET_BUCKETS - 1 ?
+				    "+" : "", st->syt_offsets[i]);
+	}
+	snd_iprintf(buffer, "\n");
+}
+EXPORT_SYMBOL(amdtp_stream_dump_stats);
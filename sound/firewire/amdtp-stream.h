@@ -4,6 +4,7 @@
 
 #include <linux/err.h>
 #include <linux/interrupt.h>
+#include <linux/kthread.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <sound/asound.h>
@@ -91,7 +92,35 @@ enum amdtp_stream_direction {
 	AMDTP_IN_STREAM
 };
 
+/* where snd_pcm_period_elapsed() is called, see 'period_wakeup' */
+enum amdtp_period_wakeup {
+	AMDTP_PERIOD_TASKLET = 0,
+	AMDTP_PERIOD_DIRECT,
+	AMDTP_PERIOD_THREAD,
+};
+
 struct amdtp_stream;
+struct amdtp_domain;
+struct snd_info_buffer;
+
+#define AMDTP_SYT_OFFSET_BUCKETS	16	/* half cycles each */
+#define AMDTP_DATA_BLOCK_BUCKETS	33
+
+/* timing statistics since the stream start, see amdtp_stream_dump_stats() */
+struct amdtp_stream_stats {
+	unsigned int packets;
+	unsigned int skipped_cycles;
+	unsigned int no_syt;		/* packets without SYT */
+	unsigned int syt_offset_min;	/* ticks from the cycle start */
+	unsigned int syt_offset_max;
+	unsigned int syt_offsets[AMDTP_SYT_OFFSET_BUCKETS];
+	unsigned int data_blocks[AMDTP_DATA_BLOCK_BUCKETS];
+	unsigned int callbacks;
+	unsigned int late_callbacks;	/* twice later than their packets */
+	unsigned int callback_gap_max;	/* us */
+	u32 last_cycle;
+	ktime_t last_callback;
+};
 typedef unsigned int (*amdtp_stream_process_data_blocks_t)(
 						struct amdtp_stream *s,
 						__be32 *buffer,
@@ -107,7 +136,11 @@ struct amdtp_stream {
 	struct fw_iso_context *context;
 	struct iso_packets_buffer buffer;
 	int packet_index;
+	unsigned int queue_length;	/* packets, see the module parameters */
+	unsigned int interrupt_interval;
+	unsigned int packets_since_interrupt;
 	int tag;
+	/* returns the number of PCM frames handled, or a negative error */
 	int (*handle_packet)(struct amdtp_stream *s,
 			unsigned int payload_quadlets, unsigned int cycle,
 			unsigned int index);
@@ -136,6 +169,10 @@ struct amdtp_stream {
 	/* For a PCM substream processing. */
 	struct snd_pcm_substream *pcm;
 	struct tasklet_struct period_tasklet;
+	unsigned int period_wakeup;	/* enum amdtp_period_wakeup */
+	struct kthread_worker *period_worker;
+	struct kthread_work period_work;
+	bool pointer_flush;
 	snd_pcm_uframes_t pcm_buffer_pointer;
 	unsigned int pcm_period_pointer;
 
@@ -147,8 +184,28 @@ struct amdtp_stream {
 	/* For backends to process data blocks. */
 	void *protocol;
 	amdtp_stream_process_data_blocks_t process_data_blocks;
+
+	struct amdtp_stream_stats stats;
+
+	/* For sharing the interrupts of the other streams on the unit. */
+	struct amdtp_domain *domain;
+	struct list_head domain_list;
+	bool domain_running;
+};
+
+/*
+ * The streams of one unit, of which only one raises interrupts while running.
+ * Its callback processes the packets of the others, see amdtp_domain_init().
+ */
+struct amdtp_domain {
+	struct list_head streams;
+	spinlock_t lock;
+	struct amdtp_stream *irq_target;
 };
 
+void amdtp_domain_init(struct amdtp_domain *d);
+void amdtp_domain_add_stream(struct amdtp_domain *d, struct amdtp_stream *s);
+
 int amdtp_stream_init(struct amdtp_stream *s, struct fw_unit *unit,
 		      enum amdtp_stream_direction dir, enum cip_flags flags,
 		      unsigned int fmt,
@@ -168,9 +225,13 @@ int amdtp_stream_add_pcm_hw_constraints(struct amdtp_stream *s,
 					struct snd_pcm_runtime *runtime);
 
 void amdtp_stream_pcm_prepare(struct amdtp_stream *s);
+void amdtp_stream_pcm_trigger(struct amdtp_stream *s,
+			      struct snd_pcm_substream *pcm);
 unsigned long amdtp_stream_pcm_pointer(struct amdtp_stream *s);
 int amdtp_stream_pcm_ack(struct amdtp_stream *s);
 void amdtp_stream_pcm_abort(struct amdtp_stream *s);
+void amdtp_stream_dump_stats(struct amdtp_stream *s,
+			     struct snd_info_buffer *buffer);
 
 extern const unsigned int amdtp_syt_intervals[CIP_SFC_COUNT];
 extern const unsigned int amdtp_rate_table[CIP_SFC_COUNT];
@@ -209,21 +270,6 @@ static inline bool amdtp_stream_pcm_running(struct amdtp_stream *s)
 	return !!s->pcm;
 }
 
-/**
- * amdtp_stream_pcm_trigger - start/stop playback from a PCM device
- * @s: the AMDTP stream
- * @pcm: the PCM device to be started, or %NULL to stop the current device
- *
- * Call this function on a running isochronous stream to enable the actual
- * transmission of PCM data.  This function should be called from the PCM
- * device's .trigger callback.
- */
-static inline void amdtp_stream_pcm_trigger(struct amdtp_stream *s,
-					    struct snd_pcm_substream *pcm)
-{
-	ACCESS_ONCE(s->pcm) = pcm;
-}
-
 static inline bool cip_sfc_is_base_44100(enum cip_sfc sfc)
 {
 	return sfc & 1;
@@ -97,6 +97,7 @@ struct snd_bebob {
 
 	struct amdtp_stream tx_stream;
 	struct amdtp_stream rx_stream;
+	struct amdtp_domain domain;
 	struct cmp_connection out_conn;
 	struct cmp_connection in_conn;
 	unsigned int substreams_counter;
@@ -518,6 +518,8 @@ int snd_bebob_stream_init_duplex(struct snd_bebob *bebob)
 	if (err < 0)
 		goto end;
 
+	amdtp_domain_init(&bebob->domain);
+
 	err = amdtp_am824_init(&bebob->tx_stream, bebob->unit,
 			       AMDTP_IN_STREAM, CIP_BLOCKING);
 	if (err < 0) {
@@ -550,7 +552,11 @@ int snd_bebob_stream_init_duplex(struct snd_bebob *bebob)
 		amdtp_stream_destroy(&bebob->tx_stream);
 		amdtp_stream_destroy(&bebob->rx_stream);
 		destroy_both_connections(bebob);
+		goto end;
 	}
+
+	amdtp_domain_add_stream(&bebob->domain, &bebob->tx_stream);
+	amdtp_domain_add_stream(&bebob->domain, &bebob->rx_stream);
 end:
 	return err;
 }
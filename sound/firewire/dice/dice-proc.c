@@ -243,10 +243,28 @@ static void dice_proc_read(struct snd_info_entry *entry,
 	}
 }
 
+static void dice_proc_read_streams(struct snd_info_entry *entry,
+				   struct snd_info_buffer *buffer)
+{
+	struct snd_dice *dice = entry->private_data;
+	unsigned int i;
+
+	for (i = 0; i < MAX_STREAMS; i++) {
+		snd_iprintf(buffer, "tx %u:\n", i);
+		amdtp_stream_dump_stats(&dice->tx_stream[i], buffer);
+	}
+	for (i = 0; i < MAX_STREAMS; i++) {
+		snd_iprintf(buffer, "rx %u:\n", i);
+		amdtp_stream_dump_stats(&dice->rx_stream[i], buffer);
+	}
+}
+
 void snd_dice_create_proc(struct snd_dice *dice)
 {
 	struct snd_info_entry *entry;
 
 	if (!snd_card_proc_new(dice->card, "dice", &entry))
 		snd_info_set_text_ops(entry, dice, dice_proc_read);
+	if (!snd_card_proc_new(dice->card, "dice_streams", &entry))
+		snd_info_set_text_ops(entry, dice, dice_proc_read_streams);
 }
@@ -399,6 +399,8 @@ static int init_stream(struct snd_dice *dice, enum amdtp_stream_direction dir,
 	if (err < 0) {
 		amdtp_stream_destroy(stream);
 		fw_iso_resources_destroy(resources);
+	} else {
+		amdtp_domain_add_stream(&dice->domain, stream);
 	}
 end:
 	return err;
@@ -431,6 +433,8 @@ int snd_dice_stream_init_duplex(struct snd_dice *dice)
 {
 	int i, err;
 
+	amdtp_domain_init(&dice->domain);
+
 	for (i = 0; i < MAX_STREAMS; i++) {
 		err = init_stream(dice, AMDTP_IN_STREAM, i);
 		if (err < 0) {
@@ -95,6 +95,7 @@ struct snd_dice {
 	struct fw_iso_resources rx_resources[MAX_STREAMS];
 	struct amdtp_stream tx_stream[MAX_STREAMS];
 	struct amdtp_stream rx_stream[MAX_STREAMS];
+	struct amdtp_domain domain;
 	bool global_enabled;
 	struct completion clock_accepted;
 	unsigned int substreams_counter;
@@ -87,6 +87,7 @@ struct snd_efw {
 
 	struct amdtp_stream tx_stream;
 	struct amdtp_stream rx_stream;
+	struct amdtp_domain domain;
 	struct cmp_connection out_conn;
 	struct cmp_connection in_conn;
 	unsigned int capture_substreams;
@@ -35,6 +35,8 @@ init_stream(struct snd_efw *efw, struct amdtp_stream *stream)
 	if (err < 0) {
 		amdtp_stream_destroy(stream);
 		cmp_connection_destroy(conn);
+	} else {
+		amdtp_domain_add_stream(&efw->domain, stream);
 	}
 end:
 	return err;
@@ -148,6 +150,8 @@ int snd_efw_stream_init_duplex(struct snd_efw *efw)
 {
 	int err;
 
+	amdtp_domain_init(&efw->domain);
+
 	err = init_stream(efw, &efw->tx_stream);
 	if (err < 0)
 		goto end;
@@ -123,7 +123,7 @@ static void read_pcm_s32(struct amdtp_stream *s,
 			 __be32 *buffer, unsigned int data_blocks)
 {
 	struct amdtp_motu *p = s->protocol;
-	unsigned int channels, remaining_frames, i, c;
+	unsigned int channels, remaining_frames, frames, i, c;
 	u8 *byte;
 	u32 *dst;
 
@@ -132,17 +132,25 @@ static void read_pcm_s32(struct amdtp_stream *s,
 			frames_to_bytes(runtime, s->pcm_buffer_pointer);
 	remaining_frames = runtime->buffer_size - s->pcm_buffer_pointer;
 
-	for (i = 0; i < data_blocks; ++i) {
-		byte = (u8 *)buffer + p->pcm_byte_offset;
+	/* in runs up to the end of the PCM buffer, no wrap check inside */
+	while (data_blocks > 0) {
+		frames = min(data_blocks, remaining_frames);
 
-		for (c = 0; c < channels; ++c) {
-			*dst = (byte[0] << 24) | (byte[1] << 16) | byte[2];
-			byte += 3;
-			dst++;
+		for (i = 0; i < frames; ++i) {
+			byte = (u8 *)buffer + p->pcm_byte_offset;
+
+			for (c = 0; c < channels; ++c) {
+				*dst = (byte[0] << 24) | (byte[1] << 16) |
+				       byte[2];
+				byte += 3;
+				dst++;
+			}
+			buffer += s->data_block_quadlets;
 		}
-		buffer += s->data_block_quadlets;
-		if (--remaining_frames == 0)
-			dst = (void *)runtime->dma_area;
+
+		data_blocks -= frames;
+		dst = (void *)runtime->dma_area;
+		remaining_frames = runtime->buffer_size;
 	}
 }
 
@@ -79,6 +79,17 @@ static void proc_read_format(struct snd_info_entry *entry,
 	}
 }
 
+static void proc_read_streams(struct snd_info_entry *entry,
+			      struct snd_info_buffer *buffer)
+{
+	struct snd_motu *motu = entry->private_data;
+
+	snd_iprintf(buffer, "tx:\n");
+	amdtp_stream_dump_stats(&motu->tx_stream, buffer);
+	snd_iprintf(buffer, "rx:\n");
+	amdtp_stream_dump_stats(&motu->rx_stream, buffer);
+}
+
 static void add_node(struct snd_motu *motu, struct snd_info_entry *root,
 		     const char *name,
 		     void (*op)(struct snd_info_entry *e,
@@ -115,4 +126,5 @@ void snd_motu_proc_init(struct snd_motu *motu)
 
 	add_node(motu, root, "clock", proc_read_clock);
 	add_node(motu, root, "format", proc_read_format);
+	add_node(motu, root, "streams", proc_read_streams);
 }
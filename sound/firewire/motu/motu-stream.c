@@ -325,9 +325,11 @@ static int init_stream(struct snd_motu *motu, enum amdtp_stream_direction dir)
 	if (err < 0) {
 		amdtp_stream_destroy(stream);
 		fw_iso_resources_destroy(resources);
+		return err;
 	}
+	amdtp_domain_add_stream(&motu->domain, stream);
 
-	return err;
+	return 0;
 }
 
 static void destroy_stream(struct snd_motu *motu,
@@ -352,6 +354,8 @@ int snd_motu_stream_init_duplex(struct snd_motu *motu)
 {
 	int err;
 
+	amdtp_domain_init(&motu->domain);
+
 	err = init_stream(motu, AMDTP_IN_STREAM);
 	if (err < 0)
 		return err;
@@ -58,6 +58,7 @@ struct snd_motu {
 	struct snd_motu_packet_format rx_packet_formats;
 	struct amdtp_stream tx_stream;
 	struct amdtp_stream rx_stream;
+	struct amdtp_domain domain;
 	struct fw_iso_resources tx_resources;
 	struct fw_iso_resources rx_resources;
 	unsigned int capture_substreams;
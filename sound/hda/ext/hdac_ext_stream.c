@@ -22,6 +22,7 @@
 #include <sound/pcm.h>
 #include <sound/hda_register.h>
 #include <sound/hdaudio_ext.h>
+#include "trace.h"
 
 /**
  * snd_hdac_ext_stream_init - initialize each stream (aka device)
@@ -65,6 +66,12 @@ void snd_hdac_ext_stream_init(struct hdac_ext_bus *ebus,
 
 	stream->decoupled = false;
 	snd_hdac_stream_init(bus, &stream->hstream, idx, direction, tag);
+
+	if (idx < HDAC_EXT_MAX_STREAMS) {
+		ebus->stream_tbl[idx] = stream;
+		set_bit(idx, &ebus->host_free[direction]);
+		set_bit(idx, &ebus->link_free[direction]);
+	}
 }
 EXPORT_SYMBOL_GPL(snd_hdac_ext_stream_init);
 
@@ -114,6 +121,10 @@ void snd_hdac_stream_free_all(struct hdac_ext_bus *ebus)
 		list_del(&s->list);
 		kfree(stream);
 	}
+
+	memset(ebus->host_free, 0, sizeof(ebus->host_free));
+	memset(ebus->link_free, 0, sizeof(ebus->link_free));
+	memset(ebus->stream_tbl, 0, sizeof(ebus->stream_tbl));
 }
 EXPORT_SYMBOL_GPL(snd_hdac_stream_free_all);
 
@@ -250,11 +261,42 @@ void snd_hdac_ext_link_clear_stream_id(struct hdac_ext_link *link,
 }
 EXPORT_SYMBOL_GPL(snd_hdac_ext_link_clear_stream_id);
 
+/* mark the stream as free (or not) in the given bitmap */
+static void hdac_ext_stream_set_free(unsigned long *map,
+				     struct hdac_ext_stream *stream, bool free)
+{
+	int idx = stream->hstream.index;
+
+	if (idx >= HDAC_EXT_MAX_STREAMS)
+		return;
+	if (free)
+		set_bit(idx, &map[stream->hstream.direction]);
+	else
+		clear_bit(idx, &map[stream->hstream.direction]);
+}
+
+/*
+ * Pick the first stream marked in the free bitmap; the caller validates
+ * the stream state.  Since the bitmap follows the stream index, this picks
+ * the same stream as the list walk would.
+ */
+static struct hdac_ext_stream *
+hdac_ext_stream_first_free(struct hdac_ext_bus *ebus, unsigned long *map)
+{
+	int idx = find_first_bit(map, HDAC_EXT_MAX_STREAMS);
+
+	if (idx >= HDAC_EXT_MAX_STREAMS)
+		return NULL;
+	clear_bit(idx, map);
+	return ebus->stream_tbl[idx];
+}
+
 static struct hdac_ext_stream *
 hdac_ext_link_stream_assign(struct hdac_ext_bus *ebus,
 				struct snd_pcm_substream *substream)
 {
 	struct hdac_ext_stream *res = NULL;
+	struct hdac_ext_stream *hstream;
 	struct hdac_stream *stream = NULL;
 	struct hdac_bus *hbus = &ebus->bus;
 
@@ -263,31 +305,40 @@ hdac_ext_link_stream_assign(struct hdac_ext_bus *ebus,
 		return NULL;
 	}
 
-	list_for_each_entry(stream, &hbus->stream_list, list) {
-		struct hdac_ext_stream *hstream = container_of(stream,
-						struct hdac_ext_stream,
-						hstream);
-		if (stream->direction != substream->stream)
-			continue;
-
-		/* check if decoupled stream and not in use is available */
-		if (hstream->decoupled && !hstream->link_locked) {
+	spin_lock_irq(&hbus->reg_lock);
+	while ((hstream = hdac_ext_stream_first_free(ebus,
+				&ebus->link_free[substream->stream]))) {
+		if (!hstream->link_locked) {
 			res = hstream;
 			break;
 		}
+	}
 
-		if (!hstream->link_locked) {
-			snd_hdac_ext_stream_decouple(ebus, hstream, true);
-			res = hstream;
-			break;
+	/* slow path for streams beyond the bitmap */
+	if (!res) {
+		list_for_each_entry(stream, &hbus->stream_list, list) {
+			hstream = stream_to_hdac_ext_stream(stream);
+			if (stream->direction == substream->stream &&
+			    !hstream->link_locked) {
+				res = hstream;
+				break;
+			}
 		}
 	}
+
 	if (res) {
-		spin_lock_irq(&hbus->reg_lock);
 		res->link_locked = 1;
 		res->link_substream = substream;
-		spin_unlock_irq(&hbus->reg_lock);
 	}
+	spin_unlock_irq(&hbus->reg_lock);
+
+	if (!res) {
+		trace_hdac_ext_stream_assign_fail(ebus, substream->stream,
+						  HDAC_EXT_STREAM_TYPE_LINK);
+		return NULL;
+	}
+	if (!res->decoupled)
+		snd_hdac_ext_stream_decouple(ebus, res, true);
 	return res;
 }
 
@@ -296,6 +347,7 @@ hdac_ext_host_stream_assign(struct hdac_ext_bus *ebus,
 				struct snd_pcm_substream *substream)
 {
 	struct hdac_ext_stream *res = NULL;
+	struct hdac_ext_stream *hstream;
 	struct hdac_stream *stream = NULL;
 	struct hdac_bus *hbus = &ebus->bus;
 
@@ -304,28 +356,45 @@ hdac_ext_host_stream_assign(struct hdac_ext_bus *ebus,
 		return NULL;
 	}
 
-	list_for_each_entry(stream, &hbus->stream_list, list) {
-		struct hdac_ext_stream *hstream = container_of(stream,
-						struct hdac_ext_stream,
-						hstream);
-		if (stream->direction != substream->stream)
-			continue;
-
-		if (!stream->opened) {
-			if (!hstream->decoupled)
-				snd_hdac_ext_stream_decouple(ebus, hstream, true);
+	spin_lock_irq(&hbus->reg_lock);
+	/* a stale entry was taken by a coupled assignment; skip it */
+	while ((hstream = hdac_ext_stream_first_free(ebus,
+				&ebus->host_free[substream->stream]))) {
+		if (!hstream->hstream.opened) {
 			res = hstream;
 			break;
 		}
 	}
+
+	/* slow path for streams beyond the bitmap or released directly
+	 * via snd_hdac_stream_release()
+	 */
+	if (!res) {
+		list_for_each_entry(stream, &hbus->stream_list, list) {
+			if (stream->direction == substream->stream &&
+			    !stream->opened) {
+				res = stream_to_hdac_ext_stream(stream);
+				break;
+			}
+		}
+		if (res)
+			hdac_ext_stream_set_free(ebus->host_free, res, false);
+	}
+
 	if (res) {
-		spin_lock_irq(&hbus->reg_lock);
 		res->hstream.opened = 1;
 		res->hstream.running = 0;
 		res->hstream.substream = substream;
-		spin_unlock_irq(&hbus->reg_lock);
 	}
+	spin_unlock_irq(&hbus->reg_lock);
 
+	if (!res) {
+		trace_hdac_ext_stream_assign_fail(ebus, substream->stream,
+						  HDAC_EXT_STREAM_TYPE_HOST);
+		return NULL;
+	}
+	if (!res->decoupled)
+		snd_hdac_ext_stream_decouple(ebus, res, true);
 	return res;
 }
 
@@ -357,9 +426,16 @@ struct hdac_ext_stream *snd_hdac_ext_stream_assign(struct hdac_ext_bus *ebus,
 	switch (type) {
 	case HDAC_EXT_STREAM_TYPE_COUPLED:
 		stream = snd_hdac_stream_assign(hbus, substream);
-		if (stream)
-			hstream = container_of(stream,
-					struct hdac_ext_stream, hstream);
+		if (!stream) {
+			trace_hdac_ext_stream_assign_fail(ebus,
+					substream->stream, type);
+			return NULL;
+		}
+		hstream = container_of(stream,
+				struct hdac_ext_stream, hstream);
+		spin_lock_irq(&hbus->reg_lock);
+		hdac_ext_stream_set_free(ebus->host_free, hstream, false);
+		spin_unlock_irq(&hbus->reg_lock);
 		return hstream;
 
 	case HDAC_EXT_STREAM_TYPE_HOST:
@@ -389,12 +465,18 @@ void snd_hdac_ext_stream_release(struct hdac_ext_stream *stream, int type)
 	switch (type) {
 	case HDAC_EXT_STREAM_TYPE_COUPLED:
 		snd_hdac_stream_release(&stream->hstream);
+		spin_lock_irq(&bus->reg_lock);
+		hdac_ext_stream_set_free(ebus->host_free, stream, true);
+		spin_unlock_irq(&bus->reg_lock);
 		break;
 
 	case HDAC_EXT_STREAM_TYPE_HOST:
 		if (stream->decoupled && !stream->link_locked)
 			snd_hdac_ext_stream_decouple(ebus, stream, false);
 		snd_hdac_stream_release(&stream->hstream);
+		spin_lock_irq(&bus->reg_lock);
+		hdac_ext_stream_set_free(ebus->host_free, stream, true);
+		spin_unlock_irq(&bus->reg_lock);
 		break;
 
 	case HDAC_EXT_STREAM_TYPE_LINK:
@@ -403,6 +485,7 @@ void snd_hdac_ext_stream_release(struct hdac_ext_stream *stream, int type)
 		spin_lock_irq(&bus->reg_lock);
 		stream->link_locked = 0;
 		stream->link_substream = NULL;
+		hdac_ext_stream_set_free(ebus->link_free, stream, true);
 		spin_unlock_irq(&bus->reg_lock);
 		break;
 
@@ -0,0 +1,6 @@
+/*
+ * tracepoint definitions for HD-audio extended core drivers
+ */
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
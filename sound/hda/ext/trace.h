@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM hda_ext
+
+#if !defined(__HDAC_EXT_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define __HDAC_EXT_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/device.h>
+#include <sound/hdaudio_ext.h>
+
+TRACE_EVENT(hdac_ext_stream_assign_fail,
+	TP_PROTO(struct hdac_ext_bus *ebus, int direction, int type),
+	TP_ARGS(ebus, direction, type),
+	TP_STRUCT__entry(
+		__string(name, dev_name(ebus->bus.dev))
+		__field(int, direction)
+		__field(int, type)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(ebus->bus.dev));
+		__entry->direction = direction;
+		__entry->type = type;
+	),
+	TP_printk("[%s] no free %s stream for %s", __get_str(name),
+		  __print_symbolic(__entry->type,
+				   { HDAC_EXT_STREAM_TYPE_COUPLED, "coupled" },
+				   { HDAC_EXT_STREAM_TYPE_HOST, "host" },
+				   { HDAC_EXT_STREAM_TYPE_LINK, "link" }),
+		  __entry->direction ? "capture" : "playback")
+);
+
+#endif /* __HDAC_EXT_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace
+
+#include <trace/define_trace.h>
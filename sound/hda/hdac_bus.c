@@ -40,6 +40,7 @@ int snd_hdac_bus_init(struct hdac_bus *bus, struct device *dev,
 	INIT_WORK(&bus->unsol_work, process_unsol_events);
 	spin_lock_init(&bus->reg_lock);
 	mutex_init(&bus->cmd_mutex);
+	init_waitqueue_head(&bus->rirb_wq);
 	bus->irq = -1;
 	return 0;
 }
@@ -116,6 +117,79 @@ int snd_hdac_bus_exec_verb_unlocked(struct hdac_bus *bus, unsigned int addr,
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_exec_verb_unlocked);
 
+/**
+ * snd_hdac_bus_exec_verbs - execute multiple verbs on the given codec
+ * @bus: bus object
+ * @addr: codec address
+ * @cmds: array of HD-audio encoded verbs, all addressed to @addr
+ * @res: array to store the responses, NULL if performing asynchronously
+ * @count: number of verbs
+ *
+ * When the controller supports it, the verbs are queued in one go and
+ * the responses are collected at once instead of a round trip per verb.
+ *
+ * Returns 0 if successful, or a negative error code.
+ */
+int snd_hdac_bus_exec_verbs(struct hdac_bus *bus, unsigned int addr,
+			    const unsigned int *cmds, unsigned int *res,
+			    unsigned int count)
+{
+	int err;
+
+	mutex_lock(&bus->cmd_mutex);
+	err = snd_hdac_bus_exec_verbs_unlocked(bus, addr, cmds, res, count);
+	mutex_unlock(&bus->cmd_mutex);
+	return err;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_bus_exec_verbs);
+
+/**
+ * snd_hdac_bus_exec_verbs_unlocked - unlocked version
+ * @bus: bus object
+ * @addr: codec address
+ * @cmds: array of HD-audio encoded verbs, all addressed to @addr
+ * @res: array to store the responses, NULL if performing asynchronously
+ * @count: number of verbs
+ *
+ * Returns 0 if successful, or a negative error code.
+ */
+int snd_hdac_bus_exec_verbs_unlocked(struct hdac_bus *bus, unsigned int addr,
+				     const unsigned int *cmds,
+				     unsigned int *res, unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		if (cmds[i] == ~0)
+			return -EINVAL;
+		if (res)
+			res[i] = -1;
+	}
+
+	if (bus->ops->command_batch) {
+		for (i = 0; i < count; i++)
+			trace_hda_send_cmd(bus, cmds[i]);
+		err = bus->ops->command_batch(bus, addr, cmds, res, count);
+		if (err != -EOPNOTSUPP) {
+			if (!err && res)
+				for (i = 0; i < count; i++)
+					trace_hda_get_response(bus, addr,
+							       res[i]);
+			return err;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		err = snd_hdac_bus_exec_verb_unlocked(bus, addr, cmds[i],
+						      res ? &res[i] : NULL);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_bus_exec_verbs_unlocked);
+
 /**
  * snd_hdac_bus_queue_event - add an unsolicited event to queue
  * @bus: the BUS
@@ -183,16 +257,26 @@ static void process_unsol_events(struct work_struct *work)
  */
 int snd_hdac_bus_add_device(struct hdac_bus *bus, struct hdac_device *codec)
 {
+	struct hdac_device *pos;
+
+	spin_lock_irq(&bus->reg_lock);
 	if (bus->caddr_tbl[codec->addr]) {
+		spin_unlock_irq(&bus->reg_lock);
 		dev_err(bus->dev, "address 0x%x is already occupied\n",
 			codec->addr);
 		return -EBUSY;
 	}
 
-	list_add_tail(&codec->list, &bus->codec_list);
+	/* keep the address order even when the codecs are probed in parallel */
+	list_for_each_entry(pos, &bus->codec_list, list) {
+		if (pos->addr > codec->addr)
+			break;
+	}
+	list_add_tail(&codec->list, &pos->list);
 	bus->caddr_tbl[codec->addr] = codec;
 	set_bit(codec->addr, &bus->codec_powered);
 	bus->num_codecs++;
+	spin_unlock_irq(&bus->reg_lock);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_add_device);
@@ -206,12 +290,17 @@ void snd_hdac_bus_remove_device(struct hdac_bus *bus,
 				struct hdac_device *codec)
 {
 	WARN_ON(bus != codec->bus);
-	if (list_empty(&codec->list))
+	/* codecs may be configured in parallel, see azx_codec_configure() */
+	spin_lock_irq(&bus->reg_lock);
+	if (list_empty(&codec->list)) {
+		spin_unlock_irq(&bus->reg_lock);
 		return;
+	}
 	list_del_init(&codec->list);
 	bus->caddr_tbl[codec->addr] = NULL;
 	clear_bit(codec->addr, &bus->codec_powered);
 	bus->num_codecs--;
+	spin_unlock_irq(&bus->reg_lock);
 	flush_work(&bus->unsol_work);
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_remove_device);
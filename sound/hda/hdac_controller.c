@@ -169,6 +169,53 @@ int snd_hdac_bus_send_cmd(struct hdac_bus *bus, unsigned int val)
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_send_cmd);
 
+/**
+ * snd_hdac_bus_send_cmds - queue multiple command verbs via CORB
+ * @bus: HD-audio core bus
+ * @vals: encoded verb values to send
+ * @count: number of verbs
+ *
+ * Puts as many verbs as the CORB can take and updates the write pointer
+ * only once for all of them.
+ *
+ * Returns the number of queued verbs, which may be zero when the CORB is
+ * full, or a negative error code.
+ */
+int snd_hdac_bus_send_cmds(struct hdac_bus *bus, const unsigned int *vals,
+			   unsigned int count)
+{
+	unsigned int addr, wp, rp, next;
+	unsigned int i;
+
+	spin_lock_irq(&bus->reg_lock);
+
+	wp = snd_hdac_chip_readw(bus, CORBWP);
+	if (wp == 0xffff) {
+		/* something wrong, controller likely turned to D3 */
+		spin_unlock_irq(&bus->reg_lock);
+		return -EIO;
+	}
+	rp = snd_hdac_chip_readw(bus, CORBRP);
+
+	for (i = 0; i < count; i++) {
+		next = (wp + 1) % AZX_MAX_CORB_ENTRIES;
+		if (next == rp)
+			break; /* full */
+		wp = next;
+		addr = azx_command_addr(vals[i]);
+		bus->last_cmd[addr] = vals[i];
+		bus->rirb.cmds[addr]++;
+		bus->corb.buf[wp] = cpu_to_le32(vals[i]);
+	}
+	if (i)
+		snd_hdac_chip_writew(bus, CORBWP, wp);
+
+	spin_unlock_irq(&bus->reg_lock);
+
+	return i;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_bus_send_cmds);
+
 #define AZX_RIRB_EX_UNSOL_EV	(1<<4)
 
 /**
@@ -182,6 +229,7 @@ void snd_hdac_bus_update_rirb(struct hdac_bus *bus)
 	unsigned int rp, wp;
 	unsigned int addr;
 	u32 res, res_ex;
+	bool received = false;
 
 	wp = snd_hdac_chip_readw(bus, RIRBWP);
 	if (wp == 0xffff) {
@@ -211,12 +259,19 @@ void snd_hdac_bus_update_rirb(struct hdac_bus *bus)
 		else if (bus->rirb.cmds[addr]) {
 			bus->rirb.res[addr] = res;
 			bus->rirb.cmds[addr]--;
+			if (bus->rirb.batch_res[addr] &&
+			    bus->rirb.batch_pos[addr] < bus->rirb.batch_len[addr])
+				bus->rirb.batch_res[addr][bus->rirb.batch_pos[addr]++] = res;
+			received = true;
 		} else {
 			dev_err_ratelimited(bus->dev,
 				"spurious response %#x:%#x, last cmd=%#08x\n",
 				res, res_ex, bus->last_cmd[addr]);
 		}
 	}
+
+	if (received)
+		wake_up(&bus->rirb_wq);
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_update_rirb);
 
@@ -231,31 +286,18 @@ EXPORT_SYMBOL_GPL(snd_hdac_bus_update_rirb);
 int snd_hdac_bus_get_response(struct hdac_bus *bus, unsigned int addr,
 			      unsigned int *res)
 {
-	unsigned long timeout;
-	unsigned long loopcounter;
-
-	timeout = jiffies + msecs_to_jiffies(1000);
+	/* the responses are picked up by the interrupt handler */
+	if (!wait_event_timeout(bus->rirb_wq,
+				!READ_ONCE(bus->rirb.cmds[addr]),
+				msecs_to_jiffies(1000)))
+		return -EIO;
 
-	for (loopcounter = 0;; loopcounter++) {
+	if (res) {
 		spin_lock_irq(&bus->reg_lock);
-		if (!bus->rirb.cmds[addr]) {
-			if (res)
-				*res = bus->rirb.res[addr]; /* the last value */
-			spin_unlock_irq(&bus->reg_lock);
-			return 0;
-		}
+		*res = bus->rirb.res[addr]; /* the last value */
 		spin_unlock_irq(&bus->reg_lock);
-		if (time_after(jiffies, timeout))
-			break;
-		if (loopcounter > 3000)
-			msleep(2); /* temporary workaround */
-		else {
-			udelay(10);
-			cond_resched();
-		}
 	}
-
-	return -EIO;
+	return 0;
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_get_response);
 
@@ -356,6 +398,7 @@ void snd_hdac_bus_enter_link_reset(struct hdac_bus *bus)
 
 	/* reset controller */
 	snd_hdac_chip_updatel(bus, GCTL, AZX_GCTL_RESET, 0);
+	bus->reset_seq++;
 
 	timeout = jiffies + msecs_to_jiffies(100);
 	while ((snd_hdac_chip_readb(bus, GCTL) & AZX_GCTL_RESET) &&
@@ -610,5 +653,9 @@ void snd_hdac_bus_free_stream_pages(struct hdac_bus *bus)
 		bus->io_ops->dma_free_pages(bus, &bus->rb);
 	if (bus->posbuf.area)
 		bus->io_ops->dma_free_pages(bus, &bus->posbuf);
+#ifdef CONFIG_SND_HDA_DSP_LOADER
+	if (bus->dsp_buf.area)
+		bus->io_ops->dma_free_pages(bus, &bus->dsp_buf);
+#endif
 }
 EXPORT_SYMBOL_GPL(snd_hdac_bus_free_stream_pages);
@@ -253,6 +253,39 @@ int snd_hdac_exec_verb(struct hdac_device *codec, unsigned int cmd,
 }
 EXPORT_SYMBOL_GPL(snd_hdac_exec_verb);
 
+/**
+ * snd_hdac_exec_verbs - execute multiple encoded verbs
+ * @codec: the codec object
+ * @cmds: encoded verbs to execute
+ * @res: the array to store the results, NULL if running async
+ * @count: number of verbs
+ *
+ * Returns zero if successful, or a negative error code.
+ *
+ * This calls the exec_verbs op when set in hdac_codec.  When only the
+ * exec_verb op is overridden, the verbs are passed one by one to it.
+ * Otherwise call the default snd_hdac_bus_exec_verbs().
+ */
+int snd_hdac_exec_verbs(struct hdac_device *codec, const unsigned int *cmds,
+			unsigned int *res, unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	if (codec->exec_verbs)
+		return codec->exec_verbs(codec, cmds, res, count);
+	if (!codec->exec_verb)
+		return snd_hdac_bus_exec_verbs(codec->bus, codec->addr,
+					       cmds, res, count);
+	for (i = 0; i < count; i++) {
+		err = codec->exec_verb(codec, cmds[i], 0, res ? &res[i] : NULL);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_exec_verbs);
+
 
 /**
  * snd_hdac_read - execute a verb
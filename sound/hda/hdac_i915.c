@@ -90,8 +90,11 @@ int snd_hdac_display_power(struct hdac_bus *bus, bool enable)
 		}
 	} else {
 		WARN_ON(!bus->i915_power_refcount);
-		if (!--bus->i915_power_refcount)
+		if (!--bus->i915_power_refcount) {
 			acomp->ops->put_power(acomp->dev);
+			/* the codecs in the power well lose their state */
+			bus->reset_seq++;
+		}
 	}
 
 	return 0;
@@ -33,6 +33,56 @@ static void codec_pm_unlock(struct hdac_device *codec, int lock)
 }
 
 #define get_verb(reg)	(((reg) >> 8) & 0xfff)
+#define get_nid(reg)	(((reg) >> 20) & 0xff)
+
+/* submit the writes queued during the cache sync */
+static int hda_reg_sync_flush(struct hdac_device *codec)
+{
+	int err;
+
+	if (!codec->sync_num)
+		return 0;
+	err = snd_hdac_exec_verbs(codec, codec->sync_cmds, NULL,
+				  codec->sync_num);
+	codec->sync_num = 0;
+	return err;
+}
+
+/* send a write verb; while syncing the cache, queue it for a batch */
+static int hda_reg_write_verb(struct hdac_device *codec, unsigned int cmd)
+{
+	int err;
+
+	if (READ_ONCE(codec->sync_task) != current)
+		return snd_hdac_exec_verb(codec, cmd, 0, NULL);
+	if (codec->sync_num >= ARRAY_SIZE(codec->sync_cmds)) {
+		err = hda_reg_sync_flush(codec);
+		if (err < 0)
+			return err;
+	}
+	codec->sync_cmds[codec->sync_num++] = cmd;
+	return 0;
+}
+
+/* write a mono amp verb; while syncing the cache, merge it into the
+ * queued verb of the other channel of the same amp when both channels
+ * get the same value
+ */
+static int hda_reg_write_amp_verb(struct hdac_device *codec, unsigned int cmd)
+{
+	unsigned int other = cmd ^ (AC_AMP_SET_LEFT | AC_AMP_SET_RIGHT);
+	unsigned int i;
+
+	if (READ_ONCE(codec->sync_task) == current) {
+		for (i = 0; i < codec->sync_num; i++) {
+			if (codec->sync_cmds[i] == other) {
+				codec->sync_cmds[i] |= cmd;
+				return 0;
+			}
+		}
+	}
+	return hda_reg_write_verb(codec, cmd);
+}
 
 static bool hda_volatile_reg(struct device *dev, unsigned int reg)
 {
@@ -187,13 +237,13 @@ static int hda_reg_write_stereo_amp(struct hdac_device *codec,
 	right = (val >> 8) & 0xff;
 	if (left == right) {
 		reg |= AC_AMP_SET_LEFT | AC_AMP_SET_RIGHT;
-		return snd_hdac_exec_verb(codec, reg | left, 0, NULL);
+		return hda_reg_write_verb(codec, reg | left);
 	}
 
-	err = snd_hdac_exec_verb(codec, reg | AC_AMP_SET_LEFT | left, 0, NULL);
+	err = hda_reg_write_verb(codec, reg | AC_AMP_SET_LEFT | left);
 	if (err < 0)
 		return err;
-	err = snd_hdac_exec_verb(codec, reg | AC_AMP_SET_RIGHT | right, 0, NULL);
+	err = hda_reg_write_verb(codec, reg | AC_AMP_SET_RIGHT | right);
 	if (err < 0)
 		return err;
 	return 0;
@@ -228,12 +278,12 @@ static int hda_reg_write_coef(struct hdac_device *codec, unsigned int reg,
 		return -EINVAL;
 	/* LSB 8bit = coef index */
 	verb = (reg & ~0xfff00) | (AC_VERB_SET_COEF_INDEX << 8);
-	err = snd_hdac_exec_verb(codec, verb, 0, NULL);
+	err = hda_reg_write_verb(codec, verb);
 	if (err < 0)
 		return err;
 	verb = (reg & ~0xfffff) | (AC_VERB_GET_COEF_INDEX << 8) |
 		(val & 0xffff);
-	return snd_hdac_exec_verb(codec, verb, 0, NULL);
+	return hda_reg_write_verb(codec, verb);
 }
 
 static int hda_reg_read(void *context, unsigned int reg, unsigned int *val)
@@ -291,8 +341,13 @@ static int hda_reg_write(void *context, unsigned int reg, unsigned int val)
 
 	if (verb != AC_VERB_SET_POWER_STATE) {
 		pm_lock = codec_pm_lock(codec);
-		if (pm_lock < 0)
-			return codec->lazy_cache ? 0 : -EAGAIN;
+		if (pm_lock < 0) {
+			if (!codec->lazy_cache)
+				return -EAGAIN;
+			/* written back at the next cache sync */
+			set_bit(get_nid(reg), codec->sync_nids);
+			return 0;
+		}
 	}
 
 	if (is_stereo_amp_verb(reg)) {
@@ -335,10 +390,17 @@ static int hda_reg_write(void *context, unsigned int reg, unsigned int val)
 		break;
 	}
 
+	if ((verb & 0xf00) == AC_VERB_SET_AMP_GAIN_MUTE) {
+		reg &= ~0xfffff;
+		reg |= verb << 8 | (val & 0xff);
+		err = hda_reg_write_amp_verb(codec, reg);
+		goto out;
+	}
+
 	for (i = 0; i < bytes; i++) {
 		reg &= ~0xfffff;
 		reg |= (verb + i) << 8 | ((val >> (8 * i)) & 0xff);
-		err = snd_hdac_exec_verb(codec, reg, 0, NULL);
+		err = hda_reg_write_verb(codec, reg);
 		if (err < 0)
 			goto out;
 	}
@@ -348,6 +410,36 @@ static int hda_reg_write(void *context, unsigned int reg, unsigned int val)
 	return err;
 }
 
+/* regmap lock; the verbs queued by a cache sync are submitted before
+ * the lock is released, so that no other write reaches the hardware
+ * ahead of them after the cache is marked clean
+ */
+static void hda_regmap_lock(void *data)
+{
+	struct hdac_device *codec = data;
+
+	mutex_lock(&codec->regmap_lock);
+}
+
+static void hda_regmap_unlock(void *data)
+{
+	struct hdac_device *codec = data;
+	int pm_lock, err;
+
+	if (READ_ONCE(codec->sync_task) == current && !codec->sync_batch &&
+	    codec->sync_num) {
+		pm_lock = codec_pm_lock(codec);
+		if (pm_lock >= 0) {
+			err = hda_reg_sync_flush(codec);
+			if (err < 0 && !codec->sync_err)
+				codec->sync_err = err;
+			codec_pm_unlock(codec, pm_lock);
+		}
+		codec->sync_num = 0;
+	}
+	mutex_unlock(&codec->regmap_lock);
+}
+
 static const struct regmap_config hda_regmap_cfg = {
 	.name = "hdaudio",
 	.reg_bits = 32,
@@ -360,6 +452,8 @@ static const struct regmap_config hda_regmap_cfg = {
 	.reg_read = hda_reg_read,
 	.reg_write = hda_reg_write,
 	.use_single_rw = true,
+	.lock = hda_regmap_lock,
+	.unlock = hda_regmap_unlock,
 };
 
 /**
@@ -370,9 +464,12 @@ static const struct regmap_config hda_regmap_cfg = {
  */
 int snd_hdac_regmap_init(struct hdac_device *codec)
 {
+	struct regmap_config cfg = hda_regmap_cfg;
 	struct regmap *regmap;
 
-	regmap = regmap_init(&codec->dev, NULL, codec, &hda_regmap_cfg);
+	mutex_init(&codec->regmap_lock);
+	cfg.lock_arg = codec;
+	regmap = regmap_init(&codec->dev, NULL, codec, &cfg);
 	if (IS_ERR(regmap))
 		return PTR_ERR(regmap);
 	codec->regmap = regmap;
@@ -395,6 +492,112 @@ void snd_hdac_regmap_exit(struct hdac_device *codec)
 }
 EXPORT_SYMBOL_GPL(snd_hdac_regmap_exit);
 
+/* sync only the registers of the widgets written while powered down */
+static int hda_reg_sync_nids(struct hdac_device *codec)
+{
+	unsigned int nid;
+	int err;
+
+	for_each_set_bit(nid, codec->sync_nids, 256) {
+		err = regcache_sync_region(codec->regmap, nid << 20,
+					   (nid << 20) | 0xfffff);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+/**
+ * snd_hdac_regmap_sync - sync the regmap cache to the hardware
+ * @codec: the codec object
+ *
+ * Like regcache_sync(), but the verbs are submitted in batches, and the
+ * left and right channels of an amp having the same value are merged
+ * into a single stereo verb.
+ *
+ * When the caller has set codec->sync_partial because the codec kept its
+ * state over the power-down, only the registers of the widgets that were
+ * written to the cache meanwhile are synced.  Otherwise the whole cache
+ * is written back.
+ *
+ * Returns zero for success or a negative error code.
+ */
+int snd_hdac_regmap_sync(struct hdac_device *codec)
+{
+	int err;
+
+	if (!codec->regmap)
+		return 0;
+
+	codec->sync_num = 0;
+	codec->sync_err = 0;
+	WRITE_ONCE(codec->sync_task, current);
+	if (codec->sync_partial)
+		err = hda_reg_sync_nids(codec);
+	else
+		err = regcache_sync(codec->regmap);
+	WRITE_ONCE(codec->sync_task, NULL);
+	if (!err)
+		err = codec->sync_err;
+	/* the queued verbs didn't reach the hardware; sync again next time */
+	if (codec->sync_err)
+		regcache_mark_dirty(codec->regmap);
+	else
+		bitmap_zero(codec->sync_nids, 256);
+	codec->sync_partial = false;
+	return err;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_regmap_sync);
+
+/**
+ * snd_hdac_regmap_batch_begin - start batching the writes of this task
+ * @codec: the codec object
+ *
+ * The verbs written by the current task until snd_hdac_regmap_batch_end()
+ * are queued and submitted together, with the stereo amp verbs merged as
+ * in snd_hdac_regmap_sync().  The codec is kept powered up meanwhile.
+ * Nothing is batched when the codec is powered down (the writes go only
+ * to the cache then) or another batch or cache sync is running.
+ */
+void snd_hdac_regmap_batch_begin(struct hdac_device *codec)
+{
+	int pm_lock;
+
+	if (!codec->regmap)
+		return;
+	pm_lock = codec_pm_lock(codec);
+	if (pm_lock < 0)
+		return;
+	if (cmpxchg(&codec->sync_task, NULL, current)) {
+		codec_pm_unlock(codec, pm_lock);
+		return;
+	}
+	codec->sync_num = 0;
+	codec->sync_batch_pm_lock = pm_lock;
+	codec->sync_batch = true;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_regmap_batch_begin);
+
+/**
+ * snd_hdac_regmap_batch_end - submit the writes batched by this task
+ * @codec: the codec object
+ *
+ * Returns zero for success or a negative error code.
+ */
+int snd_hdac_regmap_batch_end(struct hdac_device *codec)
+{
+	int err;
+
+	if (!codec->sync_batch || READ_ONCE(codec->sync_task) != current)
+		return 0;
+	err = hda_reg_sync_flush(codec);
+	codec->sync_batch = false;
+	WRITE_ONCE(codec->sync_task, NULL);
+	codec_pm_unlock(codec, codec->sync_batch_pm_lock);
+	return err;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_regmap_batch_end);
+
 /**
  * snd_hdac_regmap_add_vendor_verb - add a vendor-specific verb to regmap
  * @codec: the codec object
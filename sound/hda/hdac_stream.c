@@ -165,6 +165,7 @@ int snd_hdac_stream_setup(struct hdac_stream *azx_dev)
 
 	/* program the stream LVI (last valid index) of the BDL */
 	snd_hdac_stream_writew(azx_dev, SD_LVI, azx_dev->frags - 1);
+	azx_dev->subperiod_last = 0;
 
 	/* program the BDL address */
 	/* lower BDL address */
@@ -352,14 +353,85 @@ static int setup_bdle(struct hdac_bus *bus,
 	return ofs;
 }
 
+/*
+ * set up the BDL entries of a period, split into sub-periods of
+ * the given size with IOC at each sub-period boundary
+ */
+static int setup_period_bdles(struct hdac_bus *bus,
+			      struct snd_dma_buffer *dmab,
+			      struct hdac_stream *azx_dev, __le32 **bdlp,
+			      int ofs, int size, int with_ioc)
+{
+	int sub = azx_dev->subperiods ? azx_dev->subperiod_bytes : 0;
+
+	while (sub && size > sub) {
+		ofs = setup_bdle(bus, dmab, azx_dev, bdlp, ofs, sub,
+				 !azx_dev->no_period_wakeup);
+		if (ofs < 0)
+			return ofs;
+		size -= sub;
+	}
+	return setup_bdle(bus, dmab, azx_dev, bdlp, ofs, size, with_ioc);
+}
+
+/* the number of sub-periods to use, 0 if not applicable */
+static unsigned int get_subperiods(struct hdac_stream *azx_dev, int periods)
+{
+	int num = azx_dev->bus->bdl_subperiods;
+
+	if (num < 2 || azx_dev->no_period_wakeup)
+		return 0;
+	/* leave room for bdl_pos_adj, page splits may still overflow */
+	num = min(num, (AZX_MAX_BDL_ENTRIES - 1) / periods);
+	if (num < 2)
+		return 0;
+	/* BDLE addresses must be 128 bytes aligned */
+	azx_dev->subperiod_bytes = rounddown(azx_dev->period_bytes / num, 128);
+	if (!azx_dev->subperiod_bytes)
+		return 0;
+	return num;
+}
+
+static int __snd_hdac_stream_setup_periods(struct hdac_stream *azx_dev);
+
 /**
  * snd_hdac_stream_setup_periods - set up BDL entries
  * @azx_dev: HD-audio core stream to set up
  *
  * Set up the buffer descriptor table of the given stream based on the
  * period and buffer sizes of the assigned PCM substream.
+ *
+ * When bdl_subperiods of the bus is set, each period is split into that
+ * many BDL entries, each raising an interrupt, so that the position gets
+ * updated more often than the periods; see snd_hdac_stream_period_irq().
+ * It falls back to the plain layout if the BDL gets too large.
  */
 int snd_hdac_stream_setup_periods(struct hdac_stream *azx_dev)
+{
+	int periods = azx_dev->bufsize / azx_dev->period_bytes;
+	int err;
+
+	azx_dev->subperiods = get_subperiods(azx_dev, periods);
+	if (azx_dev->subperiods) {
+		err = __snd_hdac_stream_setup_periods(azx_dev);
+		if (!err)
+			return 0;
+		dev_dbg(azx_dev->bus->dev,
+			"Cannot split periods into %d BDL entries\n",
+			azx_dev->bus->bdl_subperiods);
+		azx_dev->subperiods = 0;
+	}
+
+	err = __snd_hdac_stream_setup_periods(azx_dev);
+	if (err < 0)
+		dev_err(azx_dev->bus->dev,
+			"Too many BDL entries: buffer=%d, period=%d\n",
+			azx_dev->bufsize, azx_dev->period_bytes);
+	return err;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_stream_setup_periods);
+
+static int __snd_hdac_stream_setup_periods(struct hdac_stream *azx_dev)
 {
 	struct hdac_bus *bus = azx_dev->bus;
 	struct snd_pcm_substream *substream = azx_dev->substream;
@@ -404,27 +476,55 @@ int snd_hdac_stream_setup_periods(struct hdac_stream *azx_dev)
 	} else
 		pos_adj = 0;
 
+	azx_dev->subperiod_adj = pos_adj;
+
 	for (i = 0; i < periods; i++) {
 		if (i == periods - 1 && pos_adj)
-			ofs = setup_bdle(bus, snd_pcm_get_dma_buf(substream),
-					 azx_dev, &bdl, ofs,
-					 period_bytes - pos_adj, 0);
+			ofs = setup_period_bdles(bus,
+						 snd_pcm_get_dma_buf(substream),
+						 azx_dev, &bdl, ofs,
+						 period_bytes - pos_adj, 0);
 		else
-			ofs = setup_bdle(bus, snd_pcm_get_dma_buf(substream),
-					 azx_dev, &bdl, ofs,
-					 period_bytes,
-					 !azx_dev->no_period_wakeup);
+			ofs = setup_period_bdles(bus,
+						 snd_pcm_get_dma_buf(substream),
+						 azx_dev, &bdl, ofs,
+						 period_bytes,
+						 !azx_dev->no_period_wakeup);
 		if (ofs < 0)
 			goto error;
 	}
 	return 0;
 
  error:
-	dev_err(bus->dev, "Too many BDL entries: buffer=%d, period=%d\n",
-		azx_dev->bufsize, period_bytes);
 	return -EINVAL;
 }
-EXPORT_SYMBOL_GPL(snd_hdac_stream_setup_periods);
+
+/**
+ * snd_hdac_stream_period_irq - check whether an IOC is for a period
+ * @azx_dev: HD-audio core stream
+ * @pos: the current DMA position in bytes
+ *
+ * With sub-periods, an IOC is raised at each sub-period boundary, too.
+ * Returns true if the period index got changed since the last call, i.e.
+ * the interrupt is to be handled as a period, or false for the sub-period
+ * ones.  Always true when no sub-periods are used.
+ */
+bool snd_hdac_stream_period_irq(struct hdac_stream *azx_dev, unsigned int pos)
+{
+	unsigned int idx;
+
+	if (!azx_dev->subperiods)
+		return true;
+	/* round to the nearest boundary for early or late interrupts */
+	pos = (pos + azx_dev->bufsize - azx_dev->subperiod_adj +
+	       azx_dev->subperiod_bytes / 2) % azx_dev->bufsize;
+	idx = pos / azx_dev->period_bytes;
+	if (idx == azx_dev->subperiod_last)
+		return false;
+	azx_dev->subperiod_last = idx;
+	return true;
+}
+EXPORT_SYMBOL_GPL(snd_hdac_stream_period_irq);
 
 /**
  * snd_hdac_stream_set_params - set stream parameters
@@ -607,6 +707,31 @@ void snd_hdac_stream_sync(struct hdac_stream *azx_dev, bool start,
 EXPORT_SYMBOL_GPL(snd_hdac_stream_sync);
 
 #ifdef CONFIG_SND_HDA_DSP_LOADER
+/* get a DSP loading buffer; the buffer of the previous loading is kept
+ * mapped in the bus and reused if it's large enough
+ */
+static int dsp_get_buffer(struct hdac_bus *bus, unsigned int byte_size,
+			  struct snd_dma_buffer *bufp)
+{
+	int err;
+
+	if (bus->dsp_buf.area && bus->dsp_buf.bytes < byte_size) {
+		bus->io_ops->dma_free_pages(bus, &bus->dsp_buf);
+		bus->dsp_buf.area = NULL;
+	}
+	if (!bus->dsp_buf.area) {
+		err = bus->io_ops->dma_alloc_pages(bus, SNDRV_DMA_TYPE_DEV_SG,
+						   byte_size, &bus->dsp_buf);
+		if (err < 0) {
+			bus->dsp_buf.area = NULL;
+			return err;
+		}
+	}
+	*bufp = bus->dsp_buf;
+	bufp->bytes = byte_size;
+	return 0;
+}
+
 /**
  * snd_hdac_dsp_prepare - prepare for DSP loading
  * @azx_dev: HD-audio core stream used for DSP loading
@@ -634,8 +759,7 @@ int snd_hdac_dsp_prepare(struct hdac_stream *azx_dev, unsigned int format,
 	azx_dev->locked = true;
 	spin_unlock_irq(&bus->reg_lock);
 
-	err = bus->io_ops->dma_alloc_pages(bus, SNDRV_DMA_TYPE_DEV_SG,
-					   byte_size, bufp);
+	err = dsp_get_buffer(bus, byte_size, bufp);
 	if (err < 0)
 		goto err_alloc;
 
@@ -661,7 +785,7 @@ int snd_hdac_dsp_prepare(struct hdac_stream *azx_dev, unsigned int format,
 	return azx_dev->stream_tag;
 
  error:
-	bus->io_ops->dma_free_pages(bus, bufp);
+	bufp->area = NULL;
  err_alloc:
 	spin_lock_irq(&bus->reg_lock);
 	azx_dev->locked = false;
@@ -708,7 +832,9 @@ void snd_hdac_dsp_cleanup(struct hdac_stream *azx_dev,
 	azx_dev->period_bytes = 0;
 	azx_dev->format_val = 0;
 
-	bus->io_ops->dma_free_pages(bus, dmab);
+	/* the pages are kept in bus->dsp_buf for the next loading */
+	if (dmab->area != bus->dsp_buf.area)
+		bus->io_ops->dma_free_pages(bus, dmab);
 	dmab->area = NULL;
 
 	spin_lock_irq(&bus->reg_lock);
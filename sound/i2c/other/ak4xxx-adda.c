@@ -50,36 +50,61 @@ void snd_akm4xxx_write(struct snd_akm4xxx *ak, int chip, unsigned char reg,
 
 EXPORT_SYMBOL(snd_akm4xxx_write);
 
+/*
+ * write consecutive registers of one chip and save them to the cache;
+ * the chip access is locked only once for the whole block
+ */
+void snd_akm4xxx_write_regs(struct snd_akm4xxx *ak, int chip,
+			    unsigned char reg, const unsigned char *vals,
+			    int count)
+{
+	int i;
+
+	ak->ops.lock(ak, chip);
+	for (i = 0; i < count; i++) {
+		unsigned char val = vals[i];
+
+		ak->ops.write(ak, chip, reg + i, val);
+		snd_akm4xxx_set(ak, chip, reg + i, val);
+	}
+	ak->ops.unlock(ak, chip);
+}
+
+EXPORT_SYMBOL(snd_akm4xxx_write_regs);
+
+/* write back the cached registers from reg up to the last one */
+static void ak4xxx_restore_regs(struct snd_akm4xxx *ak, int chip,
+				unsigned char reg)
+{
+	if (reg < ak->total_regs)
+		snd_akm4xxx_write_regs(ak, chip, reg,
+				       &snd_akm4xxx_get(ak, chip, reg),
+				       ak->total_regs - reg);
+}
+
 /* reset procedure for AK4524 and AK4528 */
 static void ak4524_reset(struct snd_akm4xxx *ak, int state)
 {
 	unsigned int chip;
-	unsigned char reg;
 
 	for (chip = 0; chip < ak->num_dacs/2; chip++) {
 		snd_akm4xxx_write(ak, chip, 0x01, state ? 0x00 : 0x03);
 		if (state)
 			continue;
 		/* DAC volumes */
-		for (reg = 0x04; reg < ak->total_regs; reg++)
-			snd_akm4xxx_write(ak, chip, reg,
-					  snd_akm4xxx_get(ak, chip, reg));
+		ak4xxx_restore_regs(ak, chip, 0x04);
 	}
 }
 
 /* reset procedure for AK4355 and AK4358 */
 static void ak435X_reset(struct snd_akm4xxx *ak, int state)
 {
-	unsigned char reg;
-
 	if (state) {
 		snd_akm4xxx_write(ak, 0, 0x01, 0x02); /* reset and soft-mute */
 		return;
 	}
-	for (reg = 0x00; reg < ak->total_regs; reg++)
-		if (reg != 0x01)
-			snd_akm4xxx_write(ak, 0, reg,
-					  snd_akm4xxx_get(ak, 0, reg));
+	snd_akm4xxx_write(ak, 0, 0x00, snd_akm4xxx_get(ak, 0, 0x00));
+	ak4xxx_restore_regs(ak, 0, 0x02);
 	snd_akm4xxx_write(ak, 0, 0x01, 0x01); /* un-reset, unmute */
 }
 
@@ -87,14 +112,11 @@ static void ak435X_reset(struct snd_akm4xxx *ak, int state)
 static void ak4381_reset(struct snd_akm4xxx *ak, int state)
 {
 	unsigned int chip;
-	unsigned char reg;
 	for (chip = 0; chip < ak->num_dacs/2; chip++) {
 		snd_akm4xxx_write(ak, chip, 0x00, state ? 0x0c : 0x0f);
 		if (state)
 			continue;
-		for (reg = 0x01; reg < ak->total_regs; reg++)
-			snd_akm4xxx_write(ak, chip, reg,
-					  snd_akm4xxx_get(ak, chip, reg));
+		ak4xxx_restore_regs(ak, chip, 0x01);
 	}
 }
 
@@ -386,16 +408,14 @@ static int snd_akm4xxx_volume_get(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
-static int put_ak_reg(struct snd_kcontrol *kcontrol, int addr,
-		      unsigned char nval)
+/* store the volume and return the register value for it */
+static unsigned char set_ak_vol(struct snd_kcontrol *kcontrol, int addr,
+				unsigned char nval)
 {
 	struct snd_akm4xxx *ak = snd_kcontrol_chip(kcontrol);
 	unsigned int mask = AK_GET_MASK(kcontrol->private_value);
 	int chip = AK_GET_CHIP(kcontrol->private_value);
 
-	if (snd_akm4xxx_get_vol(ak, chip, addr) == nval)
-		return 0;
-
 	snd_akm4xxx_set_vol(ak, chip, addr, nval);
 	if (AK_GET_VOL_CVT(kcontrol->private_value) && nval < 128)
 		nval = vol_cvt_datt[nval];
@@ -405,6 +425,19 @@ static int put_ak_reg(struct snd_kcontrol *kcontrol, int addr,
 		nval = mask - nval;
 	if (AK_GET_NEEDSMSB(kcontrol->private_value))
 		nval |= 0x80;
+	return nval;
+}
+
+static int put_ak_reg(struct snd_kcontrol *kcontrol, int addr,
+		      unsigned char nval)
+{
+	struct snd_akm4xxx *ak = snd_kcontrol_chip(kcontrol);
+	int chip = AK_GET_CHIP(kcontrol->private_value);
+
+	if (snd_akm4xxx_get_vol(ak, chip, addr) == nval)
+		return 0;
+
+	nval = set_ak_vol(kcontrol, addr, nval);
 	/* printk(KERN_DEBUG "DEBUG - AK writing reg: chip %x addr %x,
 	   nval %x\n", chip, addr, nval); */
 	snd_akm4xxx_write(ak, chip, addr, nval);
@@ -448,18 +481,29 @@ static int snd_akm4xxx_stereo_volume_get(struct snd_kcontrol *kcontrol,
 static int snd_akm4xxx_stereo_volume_put(struct snd_kcontrol *kcontrol,
 					 struct snd_ctl_elem_value *ucontrol)
 {
+	struct snd_akm4xxx *ak = snd_kcontrol_chip(kcontrol);
+	int chip = AK_GET_CHIP(kcontrol->private_value);
 	int addr = AK_GET_ADDR(kcontrol->private_value);
 	unsigned int mask = AK_GET_MASK(kcontrol->private_value);
 	unsigned int val[2];
+	unsigned char regs[2];
 	int change;
 
 	val[0] = ucontrol->value.integer.value[0];
 	val[1] = ucontrol->value.integer.value[1];
 	if (val[0] > mask || val[1] > mask)
 		return -EINVAL;
-	change = put_ak_reg(kcontrol, addr, val[0]);
-	change |= put_ak_reg(kcontrol, addr + 1, val[1]);
-	return change;
+	if (snd_akm4xxx_get_vol(ak, chip, addr) == val[0] ||
+	    snd_akm4xxx_get_vol(ak, chip, addr + 1) == val[1]) {
+		change = put_ak_reg(kcontrol, addr, val[0]);
+		change |= put_ak_reg(kcontrol, addr + 1, val[1]);
+		return change;
+	}
+	/* both channels changed: write them in one go */
+	regs[0] = set_ak_vol(kcontrol, addr, val[0]);
+	regs[1] = set_ak_vol(kcontrol, addr + 1, val[1]);
+	snd_akm4xxx_write_regs(ak, chip, addr, regs, 2);
+	return 1;
 }
 
 static int snd_akm4xxx_deemphasis_info(struct snd_kcontrol *kcontrol,
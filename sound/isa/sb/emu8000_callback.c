@@ -144,6 +144,24 @@ update_voice(struct snd_emux_voice *vp, int update)
 }
 
 
+/*
+ * check whether a released or playing voice has gone silent, i.e. its
+ * volume dropped to zero or its single-shot sample reached the end
+ */
+static int
+voice_finished(struct snd_emux_voice *vp)
+{
+	struct snd_emu8000 *hw = vp->hw;
+
+	if (vp->state != SNDRV_EMUX_ST_ON &&
+	    !((EMU8000_CVCF_READ(hw, vp->ch) >> 16) & 0xffff))
+		return 1;
+	if ((vp->reg.sample_mode & SNDRV_SFNT_SAMPLE_SINGLESHOT) &&
+	    (EMU8000_CCCA_READ(hw, vp->ch) & 0xffffff) >= vp->reg.loopstart)
+		return 1;
+	return 0;
+}
+
 /*
  * Find a channel (voice) within the EMU that is not in use or at least
  * less in use than other channels.  Always returns a valid pointer
@@ -156,76 +174,15 @@ update_voice(struct snd_emux_voice *vp, int update)
 static struct snd_emux_voice *
 get_voice(struct snd_emux *emu, struct snd_emux_port *port)
 {
-	int  i;
 	struct snd_emux_voice *vp;
-	struct snd_emu8000 *hw;
-
-	/* what we are looking for, in order of preference */
-	enum {
-		OFF=0, RELEASED, PLAYING, END
-	};
 
-	/* Keeps track of what we are finding */
-	struct best {
-		unsigned int  time;
-		int voice;
-	} best[END];
-	struct best *bp;
-
-	hw = emu->hw;
-
-	for (i = 0; i < END; i++) {
-		best[i].time = (unsigned int)(-1); /* XXX MAX_?INT really */
-		best[i].voice = -1;
-	}
-
-	/*
-	 * Go through them all and get a best one to use.
-	 */
-	for (i = 0; i < emu->max_voices; i++) {
-		int state, val;
-
-		vp = &emu->voices[i];
-		state = vp->state;
-
-		if (state == SNDRV_EMUX_ST_OFF)
-			bp = best + OFF;
-		else if (state == SNDRV_EMUX_ST_RELEASED ||
-			 state == SNDRV_EMUX_ST_PENDING) {
-			bp = best + RELEASED;
-			val = (EMU8000_CVCF_READ(hw, vp->ch) >> 16) & 0xffff;
-			if (! val)
-				bp = best + OFF;
-		}
-		else if (state & SNDRV_EMUX_ST_ON)
-			bp = best + PLAYING;
-		else
-			continue;
-
-		/* check if sample is finished playing (non-looping only) */
-		if (state != SNDRV_EMUX_ST_OFF &&
-		    (vp->reg.sample_mode & SNDRV_SFNT_SAMPLE_SINGLESHOT)) {
-			val = EMU8000_CCCA_READ(hw, vp->ch) & 0xffffff;
-			if (val >= vp->reg.loopstart)
-				bp = best + OFF;
-		}
-
-		if (vp->time < bp->time) {
-			bp->time = vp->time;
-			bp->voice = i;
-		}
-	}
-
-	for (i = 0; i < END; i++) {
-		if (best[i].voice >= 0) {
-			vp = &emu->voices[best[i].voice];
-			vp->ch = best[i].voice;
-			return vp;
-		}
+	vp = snd_emux_find_voice(emu, 0, voice_finished);
+	if (vp && vp->ch < 0) {
+		vp->ch = vp - emu->voices;
+		/* off now, with its channel */
+		snd_emux_voice_set_state(vp, vp->state);
 	}
-
-	/* not found */
-	return NULL;
+	return vp;
 }
 
 /*
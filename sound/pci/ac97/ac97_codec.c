@@ -282,7 +282,8 @@ static int snd_ac97_valid_reg(struct snd_ac97 *ac97, unsigned short reg)
  * callback directly after the register check.
  * This function doesn't change the register cache unlike
  * #snd_ca97_write_cache(), so use this only when you don't want to
- * reflect the change to the suspend/resume state.
+ * reflect the change to the suspend/resume state.  A value cached only
+ * from a read of the register is dropped.
  */
 void snd_ac97_write(struct snd_ac97 *ac97, unsigned short reg, unsigned short value)
 {
@@ -294,6 +295,9 @@ void snd_ac97_write(struct snd_ac97 *ac97, unsigned short reg, unsigned short va
 			ac97->bus->ops->write(ac97, AC97_RESET, 0);	/* reset audio codec */
 	}
 	ac97->bus->ops->write(ac97, reg, value);
+	/* a value cached from a read is stale now */
+	if (test_and_clear_bit(reg, ac97->reg_read_cached))
+		clear_bit(reg, ac97->reg_accessed);
 }
 
 EXPORT_SYMBOL(snd_ac97_write);
@@ -316,12 +320,27 @@ unsigned short snd_ac97_read(struct snd_ac97 *ac97, unsigned short reg)
 	return ac97->bus->ops->read(ac97, reg);
 }
 
+/*
+ * The mixer registers keep the value written by the driver, thus their
+ * first read can be cached.  The others may be changed by the codec
+ * itself (status, power-down and paging bits, jack sense and other
+ * vendor registers), so they are read again until they are written.
+ */
+static bool snd_ac97_cacheable_reg(unsigned short reg)
+{
+	return (reg >= AC97_MASTER && reg <= AC97_3D_CONTROL) ||
+		reg == AC97_CENTER_LFE_MASTER || reg == AC97_SURROUND_MASTER;
+}
+
 /* read a register - return the cached value if already read */
 static inline unsigned short snd_ac97_read_cache(struct snd_ac97 *ac97, unsigned short reg)
 {
 	if (! test_bit(reg, ac97->reg_accessed)) {
 		ac97->regs[reg] = ac97->bus->ops->read(ac97, reg);
-		// set_bit(reg, ac97->reg_accessed);
+		if (snd_ac97_cacheable_reg(reg)) {
+			set_bit(reg, ac97->reg_read_cached);
+			set_bit(reg, ac97->reg_accessed);
+		}
 	}
 	return ac97->regs[reg];
 }
@@ -346,11 +365,61 @@ void snd_ac97_write_cache(struct snd_ac97 *ac97, unsigned short reg, unsigned sh
 	ac97->regs[reg] = value;
 	ac97->bus->ops->write(ac97, reg, value);
 	set_bit(reg, ac97->reg_accessed);
+	clear_bit(reg, ac97->reg_read_cached);
 	mutex_unlock(&ac97->reg_mutex);
 }
 
 EXPORT_SYMBOL(snd_ac97_write_cache);
 
+static void snd_ac97_write_seq(struct snd_ac97 *ac97,
+			       const struct snd_ac97_reg_seq *seq,
+			       unsigned int count)
+{
+	unsigned int i;
+
+	if (!count)
+		return;
+	if (ac97->bus->ops->write_seq) {
+		ac97->bus->ops->write_seq(ac97, seq, count);
+		return;
+	}
+	for (i = 0; i < count; i++)
+		ac97->bus->ops->write(ac97, seq[i].reg, seq[i].val);
+}
+
+/**
+ * snd_ac97_write_cache_seq - write a sequence of registers and update the cache
+ * @ac97: the ac97 instance
+ * @seq: the registers and values to write, in order
+ * @count: the number of entries in @seq
+ *
+ * Like snd_ac97_write_cache() for each entry, but the bus driver may
+ * write the whole sequence at once, which saves a codec ready-wait per
+ * register.  The registers filtered out for the codec are skipped.
+ */
+void snd_ac97_write_cache_seq(struct snd_ac97 *ac97,
+			      const struct snd_ac97_reg_seq *seq,
+			      unsigned int count)
+{
+	unsigned int i, start = 0;
+
+	mutex_lock(&ac97->reg_mutex);
+	for (i = 0; i < count; i++) {
+		if (snd_ac97_valid_reg(ac97, seq[i].reg)) {
+			ac97->regs[seq[i].reg] = seq[i].val;
+			set_bit(seq[i].reg, ac97->reg_accessed);
+			clear_bit(seq[i].reg, ac97->reg_read_cached);
+			continue;
+		}
+		snd_ac97_write_seq(ac97, seq + start, i - start);
+		start = i + 1;
+	}
+	snd_ac97_write_seq(ac97, seq + start, count - start);
+	mutex_unlock(&ac97->reg_mutex);
+}
+
+EXPORT_SYMBOL(snd_ac97_write_cache_seq);
+
 /**
  * snd_ac97_update - update the value on the given register
  * @ac97: the ac97 instance
@@ -376,6 +445,7 @@ int snd_ac97_update(struct snd_ac97 *ac97, unsigned short reg, unsigned short va
 		ac97->bus->ops->write(ac97, reg, value);
 	}
 	set_bit(reg, ac97->reg_accessed);
+	clear_bit(reg, ac97->reg_read_cached);
 	mutex_unlock(&ac97->reg_mutex);
 	return change;
 }
@@ -424,6 +494,7 @@ int snd_ac97_update_bits_nolock(struct snd_ac97 *ac97, unsigned short reg,
 		ac97->bus->ops->write(ac97, reg, new);
 	}
 	set_bit(reg, ac97->reg_accessed);
+	clear_bit(reg, ac97->reg_read_cached);
 	return change;
 }
 
@@ -1327,6 +1398,11 @@ static int snd_ac97_cmix_new_stereo(struct snd_card *card, const char *pfx,
 
 static unsigned int snd_ac97_determine_spdif_rates(struct snd_ac97 *ac97);
 
+static const struct snd_ac97_reg_seq capture_init[] = {
+	{ AC97_REC_SEL, 0x0000 },
+	{ AC97_REC_GAIN, 0x0000 },
+};
+
 static int snd_ac97_mixer_build(struct snd_ac97 * ac97)
 {
 	struct snd_card *card = ac97->bus->card;
@@ -1546,8 +1622,8 @@ static int snd_ac97_mixer_build(struct snd_ac97 * ac97)
 		if ((err = snd_ctl_add(card, kctl = snd_ac97_cnew(&snd_ac97_control_capture_vol, ac97))) < 0)
 			return err;
 		set_tlv_db_scale(kctl, db_scale_rec_gain);
-		snd_ac97_write_cache(ac97, AC97_REC_SEL, 0x0000);
-		snd_ac97_write_cache(ac97, AC97_REC_GAIN, 0x0000);
+		snd_ac97_write_cache_seq(ac97, capture_init,
+					 ARRAY_SIZE(capture_init));
 	}
 	/* build MIC Capture controls */
 	if (snd_ac97_try_volume_mix(ac97, AC97_REC_GAIN_MIC)) {
@@ -2498,8 +2574,29 @@ EXPORT_SYMBOL(snd_ac97_suspend);
  */
 static void snd_ac97_restore_status(struct snd_ac97 *ac97)
 {
+	struct snd_ac97_reg_seq seq[0x3d];
+	unsigned int count = 0;
 	int i;
 
+	/* the bus driver completes the writes itself, no read-back needed;
+	 * ALC100 needs the reset of snd_ac97_write() before MASTER
+	 */
+	if (ac97->bus->ops->write_seq &&
+	    (ac97->id & 0xffffff00) != AC97_ID_ALC100) {
+		for (i = 2; i < 0x7c ; i += 2) {
+			if (i == AC97_POWERDOWN || i == AC97_EXTENDED_ID)
+				continue;
+			if (test_bit(i, ac97->reg_accessed) &&
+			    snd_ac97_valid_reg(ac97, i)) {
+				seq[count].reg = i;
+				seq[count].val = ac97->regs[i];
+				count++;
+			}
+		}
+		snd_ac97_write_seq(ac97, seq, count);
+		return;
+	}
+
 	for (i = 2; i < 0x7c ; i += 2) {
 		if (i == AC97_POWERDOWN || i == AC97_EXTENDED_ID)
 			continue;
@@ -2638,8 +2735,11 @@ static int snd_ac97_rename_ctl(struct snd_ac97 *ac97, const char *src,
 			       const char *dst, const char *suffix)
 {
 	struct snd_kcontrol *kctl = ctl_find(ac97, src, suffix);
+	char name[SNDRV_CTL_ELEM_ID_NAME_MAXLEN];
+
 	if (kctl) {
-		set_ctl_name(kctl->id.name, dst, suffix);
+		set_ctl_name(name, dst, suffix);
+		snd_ctl_rename(ac97->bus->card, kctl, name);
 		return 0;
 	}
 	return -ENOENT;
@@ -124,12 +124,15 @@ struct snd_card_asihpi {
 	struct pci_dev *pci;
 	struct hpi_adapter *hpi;
 
-	/* In low latency mode there is only one stream, a pointer to its
-	 * private data is stored here on trigger and cleared on stop.
-	 * The interrupt handler uses it as a parameter when calling
-	 * snd_card_asihpi_timer_function().
+	/* The master streams of the running groups, set on trigger and
+	 * cleared on stop.  They are all serviced from one poll timer or,
+	 * in low latency mode, from the interrupt tasklet; poll_lock is
+	 * held while a stream is serviced.
 	 */
-	struct snd_card_asihpi_pcm *llmode_streampriv;
+	struct snd_card_asihpi_pcm *running[2][HPI_MAX_STREAMS];
+	atomic_t n_running;
+	spinlock_t poll_lock;
+	struct timer_list poll_timer;
 	struct tasklet_struct t;
 	void (*pcm_start)(struct snd_pcm_substream *substream);
 	void (*pcm_stop)(struct snd_pcm_substream *substream);
@@ -149,9 +152,9 @@ struct snd_card_asihpi {
 
 /* Per stream data */
 struct snd_card_asihpi_pcm {
-	struct timer_list timer;
-	unsigned int respawn_timer;
 	unsigned int hpi_buffer_attached;
+	/* state shared with the DSP, when a bus master buffer is attached */
+	struct hpi_hostbuffer_status *hpi_status;
 	unsigned int buffer_bytes;
 	unsigned int period_bytes;
 	unsigned int bytes_per_sec;
@@ -253,6 +256,46 @@ static inline u16 hpi_stream_get_info_ex(
 	return e;
 }
 
+/* Read the stream state straight from the bus master interface when
+ * possible, without sending a message to the DSP.
+ */
+static u16 snd_card_asihpi_stream_info(struct snd_card_asihpi_pcm *dpcm,
+				       u16 *pw_state, u32 *pdata_in_buffer,
+				       u32 *pauxiliary_data)
+{
+	struct hpi_hostbuffer_status *status = dpcm->hpi_status;
+	u32 host_index, dsp_index;
+
+	if (!status)
+		return hpi_stream_get_info_ex(dpcm->h_stream, pw_state, NULL,
+					      pdata_in_buffer, NULL,
+					      pauxiliary_data);
+
+	host_index = READ_ONCE(status->host_index);
+	dsp_index = READ_ONCE(status->dsp_index);
+	*pw_state = (u16)READ_ONCE(status->stream_state);
+	*pauxiliary_data = READ_ONCE(status->auxiliary_data_available);
+	if (hpi_handle_object(dpcm->h_stream) == HPI_OBJ_OSTREAM)
+		*pdata_in_buffer = host_index - dsp_index;
+	else
+		*pdata_in_buffer = dsp_index - host_index;
+	return 0;
+}
+
+static struct hpi_hostbuffer_status *
+snd_card_asihpi_stream_status(struct snd_card_asihpi *card, u32 h_stream)
+{
+	struct hpi_adapter_obj *pao = card->hpi->adapter;
+	u16 adapter, index;
+
+	hpi_handle_to_indexes(h_stream, &adapter, &index);
+	if (hpi_handle_object(h_stream) == HPI_OBJ_OSTREAM)
+		return pao->outstream_host_buffer_status ?
+			&pao->outstream_host_buffer_status[index] : NULL;
+	return pao->instream_host_buffer_status ?
+		&pao->instream_host_buffer_status[index] : NULL;
+}
+
 static inline u16 hpi_stream_group_add(
 					u32 h_master,
 					u32 h_stream)
@@ -498,6 +541,8 @@ static int snd_card_asihpi_pcm_hw_params(struct snd_pcm_substream *substream,
 		err = hpi_stream_get_info_ex(dpcm->h_stream, NULL,
 				&dpcm->hpi_buffer_attached, NULL, NULL, NULL);
 	}
+	dpcm->hpi_status = dpcm->hpi_buffer_attached ?
+		snd_card_asihpi_stream_status(card, dpcm->h_stream) : NULL;
 	bytes_per_sec = params_rate(params) * params_channels(params);
 	width = snd_pcm_format_width(params_format(params));
 	bytes_per_sec *= width;
@@ -517,6 +562,8 @@ snd_card_asihpi_hw_free(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct snd_card_asihpi_pcm *dpcm = runtime->private_data;
+
+	dpcm->hpi_status = NULL;
 	if (dpcm->hpi_buffer_attached)
 		hpi_stream_host_buffer_detach(dpcm->h_stream);
 
@@ -530,27 +577,47 @@ static void snd_card_asihpi_runtime_free(struct snd_pcm_runtime *runtime)
 	kfree(dpcm);
 }
 
+/* Mark a stream as running; returns true if it was not already */
+static bool snd_card_asihpi_set_running(struct snd_pcm_substream *substream,
+					struct snd_card_asihpi_pcm *dpcm)
+{
+	struct snd_card_asihpi *card = snd_pcm_substream_chip(substream);
+
+	return !xchg(&card->running[substream->stream][substream->number],
+		     dpcm);
+}
+
+static bool snd_card_asihpi_clear_running(struct snd_pcm_substream *substream)
+{
+	struct snd_card_asihpi *card = snd_pcm_substream_chip(substream);
+
+	return xchg(&card->running[substream->stream][substream->number],
+		    NULL) != NULL;
+}
+
 static void snd_card_asihpi_pcm_timer_start(struct snd_pcm_substream *
 					    substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct snd_card_asihpi_pcm *dpcm = runtime->private_data;
+	struct snd_card_asihpi *card = snd_pcm_substream_chip(substream);
+	unsigned long expires;
 	int expiry;
 
 	expiry = HZ / 200;
 
 	expiry = max(expiry, 1); /* don't let it be zero! */
-	mod_timer(&dpcm->timer, jiffies + expiry);
-	dpcm->respawn_timer = 1;
+	expires = jiffies + expiry;
+	snd_card_asihpi_set_running(substream, dpcm);
+	if (!timer_pending(&card->poll_timer) ||
+	    time_before(expires, card->poll_timer.expires))
+		mod_timer(&card->poll_timer, expires);
 }
 
 static void snd_card_asihpi_pcm_timer_stop(struct snd_pcm_substream *substream)
 {
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	struct snd_card_asihpi_pcm *dpcm = runtime->private_data;
-
-	dpcm->respawn_timer = 0;
-	del_timer(&dpcm->timer);
+	/* the poll timer stops by itself when no stream is running */
+	snd_card_asihpi_clear_running(substream);
 }
 
 static void snd_card_asihpi_pcm_int_start(struct snd_pcm_substream *substream)
@@ -561,34 +628,23 @@ static void snd_card_asihpi_pcm_int_start(struct snd_pcm_substream *substream)
 	dpcm = (struct snd_card_asihpi_pcm *)substream->runtime->private_data;
 	card = snd_pcm_substream_chip(substream);
 
-	WARN_ON(in_interrupt());
-	tasklet_disable(&card->t);
-	card->llmode_streampriv = dpcm;
-	tasklet_enable(&card->t);
-
-	hpi_handle_error(hpi_adapter_set_property(card->hpi->adapter->index,
-		HPI_ADAPTER_PROPERTY_IRQ_RATE,
-		card->update_interval_frames, 0));
+	if (snd_card_asihpi_set_running(substream, dpcm) &&
+	    atomic_inc_return(&card->n_running) == 1)
+		hpi_handle_error(hpi_adapter_set_property(
+			card->hpi->adapter->index,
+			HPI_ADAPTER_PROPERTY_IRQ_RATE,
+			card->update_interval_frames, 0));
 }
 
 static void snd_card_asihpi_pcm_int_stop(struct snd_pcm_substream *substream)
 {
-	struct snd_card_asihpi_pcm *dpcm;
-	struct snd_card_asihpi *card;
-
-	dpcm = (struct snd_card_asihpi_pcm *)substream->runtime->private_data;
-	card = snd_pcm_substream_chip(substream);
-
-	hpi_handle_error(hpi_adapter_set_property(card->hpi->adapter->index,
-		HPI_ADAPTER_PROPERTY_IRQ_RATE, 0, 0));
+	struct snd_card_asihpi *card = snd_pcm_substream_chip(substream);
 
-	if (in_interrupt())
-		card->llmode_streampriv = NULL;
-	else {
-		tasklet_disable(&card->t);
-		card->llmode_streampriv = NULL;
-		tasklet_enable(&card->t);
-	}
+	if (snd_card_asihpi_clear_running(substream) &&
+	    atomic_dec_and_test(&card->n_running))
+		hpi_handle_error(hpi_adapter_set_property(
+			card->hpi->adapter->index,
+			HPI_ADAPTER_PROPERTY_IRQ_RATE, 0, 0));
 }
 
 static int snd_card_asihpi_trigger(struct snd_pcm_substream *substream,
@@ -747,11 +803,11 @@ static inline unsigned int modulo_min(unsigned int a, unsigned int b,
 	return result;
 }
 
-/** Timer function, equivalent to interrupt service routine for cards
+/** Service a running stream group, equivalent to interrupt service routine
+* for cards.  Returns the number of jiffies until it needs service again.
 */
-static void snd_card_asihpi_timer_function(unsigned long data)
+static unsigned int snd_card_asihpi_service(struct snd_card_asihpi_pcm *dpcm)
 {
-	struct snd_card_asihpi_pcm *dpcm = (struct snd_card_asihpi_pcm *)data;
 	struct snd_pcm_substream *substream = dpcm->substream;
 	struct snd_card_asihpi *card = snd_pcm_substream_chip(substream);
 	struct snd_pcm_runtime *runtime;
@@ -762,7 +818,7 @@ static void snd_card_asihpi_timer_function(unsigned long data)
 	int first = 1;
 	int loops = 0;
 	u16 state;
-	u32 buffer_size, bytes_avail, samples_played, on_card_bytes;
+	u32 bytes_avail, on_card_bytes;
 	char name[16];
 
 
@@ -780,10 +836,9 @@ static void snd_card_asihpi_timer_function(unsigned long data)
 		if (substream->stream != s->stream)
 			continue;
 
-		hpi_handle_error(hpi_stream_get_info_ex(
-					ds->h_stream, &state,
-					&buffer_size, &bytes_avail,
-					&samples_played, &on_card_bytes));
+		hpi_handle_error(snd_card_asihpi_stream_info(
+					ds, &state, &bytes_avail,
+					&on_card_bytes));
 
 		/* number of bytes in on-card buffer */
 		runtime->delay = on_card_bytes;
@@ -835,7 +890,7 @@ static void snd_card_asihpi_timer_function(unsigned long data)
 			(int)bytes_avail,
 
 			(int)on_card_bytes,
-			buffer_size-bytes_avail,
+			ds->buffer_bytes - bytes_avail,
 			(unsigned long)frames_to_bytes(runtime,
 						runtime->status->hw_ptr),
 			(unsigned long)frames_to_bytes(runtime,
@@ -857,7 +912,6 @@ static void snd_card_asihpi_timer_function(unsigned long data)
 		next_jiffies = ((dpcm->period_bytes - remdata) * HZ / dpcm->bytes_per_sec);
 
 	next_jiffies = max(next_jiffies, 1U);
-	dpcm->timer.expires = jiffies + next_jiffies;
 	snd_printddd("timer2, jif=%d, buf_pos=%d, newdata=%d, xfer=%d\n",
 			next_jiffies, pcm_buf_dma_ofs, newdata, xfercount);
 
@@ -935,8 +989,52 @@ static void snd_card_asihpi_timer_function(unsigned long data)
 		}
 	}
 
-	if (!card->hpi->interrupt_mode && dpcm->respawn_timer)
-		add_timer(&dpcm->timer);
+	return next_jiffies;
+}
+
+/* Service all running streams; returns the jiffies until the next
+ * service is due, or 0 if nothing runs.
+ */
+static unsigned int snd_card_asihpi_poll(struct snd_card_asihpi *asihpi)
+{
+	struct snd_card_asihpi_pcm *dpcm;
+	unsigned int next = 0, n;
+	int dir, i;
+
+	for (dir = 0; dir < 2; dir++) {
+		for (i = 0; i < HPI_MAX_STREAMS; i++) {
+			if (!READ_ONCE(asihpi->running[dir][i]))
+				continue;
+			spin_lock(&asihpi->poll_lock);
+			dpcm = READ_ONCE(asihpi->running[dir][i]);
+			if (dpcm) {
+				n = snd_card_asihpi_service(dpcm);
+				if (!next || n < next)
+					next = n;
+			}
+			spin_unlock(&asihpi->poll_lock);
+		}
+	}
+	return next;
+}
+
+static void snd_card_asihpi_timer_function(unsigned long data)
+{
+	struct snd_card_asihpi *asihpi = (struct snd_card_asihpi *)data;
+	unsigned int next;
+
+	next = snd_card_asihpi_poll(asihpi);
+	if (next)
+		mod_timer(&asihpi->poll_timer, jiffies + next);
+}
+
+/* wait until a stream that stopped running is no longer serviced */
+static void snd_card_asihpi_sync_stream(struct snd_pcm_substream *substream)
+{
+	struct snd_card_asihpi *card = snd_pcm_substream_chip(substream);
+
+	spin_lock_bh(&card->poll_lock);
+	spin_unlock_bh(&card->poll_lock);
 }
 
 static void snd_card_asihpi_int_task(unsigned long data)
@@ -946,9 +1044,7 @@ static void snd_card_asihpi_int_task(unsigned long data)
 
 	WARN_ON(!a || !a->snd_card || !a->snd_card->private_data);
 	asihpi = (struct snd_card_asihpi *)a->snd_card->private_data;
-	if (asihpi->llmode_streampriv)
-		snd_card_asihpi_timer_function(
-			(unsigned long)asihpi->llmode_streampriv);
+	snd_card_asihpi_poll(asihpi);
 }
 
 static void snd_card_asihpi_isr(struct hpi_adapter *a)
@@ -1059,8 +1155,6 @@ static int snd_card_asihpi_playback_open(struct snd_pcm_substream *substream)
 	    If internal and other stream playing, can't switch
 	*/
 
-	setup_timer(&dpcm->timer, snd_card_asihpi_timer_function,
-		    (unsigned long) dpcm);
 	dpcm->substream = substream;
 	runtime->private_data = dpcm;
 	runtime->private_free = snd_card_asihpi_runtime_free;
@@ -1128,6 +1222,8 @@ static int snd_card_asihpi_playback_close(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct snd_card_asihpi_pcm *dpcm = runtime->private_data;
 
+	snd_card_asihpi_clear_running(substream);
+	snd_card_asihpi_sync_stream(substream);
 	hpi_handle_error(hpi_outstream_close(dpcm->h_stream));
 	snd_printdd("playback close\n");
 
@@ -1240,8 +1336,6 @@ static int snd_card_asihpi_capture_open(struct snd_pcm_substream *substream)
 	if (err)
 		return -EIO;
 
-	setup_timer(&dpcm->timer, snd_card_asihpi_timer_function,
-		    (unsigned long) dpcm);
 	dpcm->substream = substream;
 	runtime->private_data = dpcm;
 	runtime->private_free = snd_card_asihpi_runtime_free;
@@ -1297,6 +1391,8 @@ static int snd_card_asihpi_capture_close(struct snd_pcm_substream *substream)
 {
 	struct snd_card_asihpi_pcm *dpcm = substream->runtime->private_data;
 
+	snd_card_asihpi_clear_running(substream);
+	snd_card_asihpi_sync_stream(substream);
 	hpi_handle_error(hpi_instream_close(dpcm->h_stream));
 	return 0;
 }
@@ -2845,6 +2941,13 @@ static int snd_asihpi_hpi_new(struct snd_card_asihpi *asihpi, int device)
 /*------------------------------------------------------------
    CARD
  ------------------------------------------------------------*/
+static void snd_card_asihpi_private_free(struct snd_card *card)
+{
+	struct snd_card_asihpi *asihpi = card->private_data;
+
+	del_timer_sync(&asihpi->poll_timer);
+}
+
 static int snd_asihpi_probe(struct pci_dev *pci_dev,
 			    const struct pci_device_id *pci_id)
 {
@@ -2893,6 +2996,10 @@ static int snd_asihpi_probe(struct pci_dev *pci_dev,
 	asihpi->pci = pci_dev;
 	asihpi->hpi = hpi;
 	hpi->snd_card = card;
+	spin_lock_init(&asihpi->poll_lock);
+	setup_timer(&asihpi->poll_timer, snd_card_asihpi_timer_function,
+		    (unsigned long)asihpi);
+	card->private_free = snd_card_asihpi_private_free;
 
 	err = hpi_adapter_get_property(adapter_index,
 		HPI_ADAPTER_PROPERTY_CAPS1,
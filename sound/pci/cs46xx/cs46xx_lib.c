@@ -876,35 +876,46 @@ static void snd_cs46xx_set_capture_sample_rate(struct snd_cs46xx *chip, unsigned
  */
 
 static void snd_cs46xx_pb_trans_copy(struct snd_pcm_substream *substream,
-				     struct snd_pcm_indirect *rec, size_t bytes)
+				     struct snd_pcm_indirect *rec,
+				     const struct snd_pcm_indirect_vec *vec,
+				     unsigned int count)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct snd_cs46xx_pcm * cpcm = runtime->private_data;
-	memcpy(cpcm->hw_buf.area + rec->hw_data, runtime->dma_area + rec->sw_data, bytes);
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		memcpy(cpcm->hw_buf.area + vec[i].hw_data,
+		       runtime->dma_area + vec[i].sw_data, vec[i].bytes);
 }
 
 static int snd_cs46xx_playback_transfer(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct snd_cs46xx_pcm * cpcm = runtime->private_data;
-	return snd_pcm_indirect_playback_transfer(substream, &cpcm->pcm_rec,
-						  snd_cs46xx_pb_trans_copy);
+	return snd_pcm_indirect_playback_transfer_vec(substream, &cpcm->pcm_rec,
+						      snd_cs46xx_pb_trans_copy);
 }
 
 static void snd_cs46xx_cp_trans_copy(struct snd_pcm_substream *substream,
-				     struct snd_pcm_indirect *rec, size_t bytes)
+				     struct snd_pcm_indirect *rec,
+				     const struct snd_pcm_indirect_vec *vec,
+				     unsigned int count)
 {
 	struct snd_cs46xx *chip = snd_pcm_substream_chip(substream);
 	struct snd_pcm_runtime *runtime = substream->runtime;
-	memcpy(runtime->dma_area + rec->sw_data,
-	       chip->capt.hw_buf.area + rec->hw_data, bytes);
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		memcpy(runtime->dma_area + vec[i].sw_data,
+		       chip->capt.hw_buf.area + vec[i].hw_data, vec[i].bytes);
 }
 
 static int snd_cs46xx_capture_transfer(struct snd_pcm_substream *substream)
 {
 	struct snd_cs46xx *chip = snd_pcm_substream_chip(substream);
-	return snd_pcm_indirect_capture_transfer(substream, &chip->capt.pcm_rec,
-						 snd_cs46xx_cp_trans_copy);
+	return snd_pcm_indirect_capture_transfer_vec(substream, &chip->capt.pcm_rec,
+						     snd_cs46xx_cp_trans_copy);
 }
 
 static snd_pcm_uframes_t snd_cs46xx_playback_direct_pointer(struct snd_pcm_substream *substream)
@@ -240,6 +240,18 @@ static int select_rom(unsigned int pitch)
 	}
 }
 
+/*
+ * The resources set up by an earlier prepare can be reused: the stream
+ * parameters only change through hw_params, which releases them.
+ */
+static bool atc_pcm_reuse_resources(struct ct_atc *atc, struct ct_atc_pcm *apcm)
+{
+	if (!apcm->src || !apcm->vm_block || apcm->hw_gen != atc->hw_gen)
+		return false;
+	ct_timer_prepare(apcm->timer);
+	return true;
+}
+
 static int atc_pcm_playback_prepare(struct ct_atc *atc, struct ct_atc_pcm *apcm)
 {
 	struct src_mgr *src_mgr = atc->rsc_mgrs[SRC];
@@ -253,6 +265,9 @@ static int atc_pcm_playback_prepare(struct ct_atc *atc, struct ct_atc_pcm *apcm)
 	int device = apcm->substream->pcm->device;
 	unsigned int pitch;
 
+	if (atc_pcm_reuse_resources(atc, apcm))
+		return 0;
+
 	/* first release old resources */
 	atc_pcm_release_resources(atc, apcm);
 
@@ -309,6 +324,7 @@ static int atc_pcm_playback_prepare(struct ct_atc *atc, struct ct_atc_pcm *apcm)
 	}
 
 	ct_timer_prepare(apcm->timer);
+	apcm->hw_gen = atc->hw_gen;
 
 	return 0;
 
@@ -656,6 +672,9 @@ static int atc_pcm_capture_prepare(struct ct_atc *atc, struct ct_atc_pcm *apcm)
 	unsigned int pitch;
 	int mix_base = 0, imp_base = 0;
 
+	if (atc_pcm_reuse_resources(atc, apcm))
+		return 0;
+
 	atc_pcm_release_resources(atc, apcm);
 
 	/* Get needed resources. */
@@ -718,6 +737,7 @@ static int atc_pcm_capture_prepare(struct ct_atc *atc, struct ct_atc_pcm *apcm)
 	}
 
 	ct_timer_prepare(apcm->timer);
+	apcm->hw_gen = atc->hw_gen;
 
 	return 0;
 }
@@ -1561,6 +1581,8 @@ static int atc_suspend(struct ct_atc *atc)
 	}
 
 	atc_release_resources(atc);
+	/* the PCM resources have to be set up again on prepare */
+	atc->hw_gen++;
 
 	hw->suspend(hw);
 
@@ -71,6 +71,7 @@ struct ct_atc_pcm {
 	unsigned char n_srcc;	/* Number of converting SRCs */
 	unsigned char n_srcimp;	/* Number of SRC Input Mappers */
 	unsigned char n_amixer;	/* Number of AMIXERs */
+	unsigned int hw_gen;	/* hw_gen of atc when set up */
 };
 
 /* Chip resource management object */
@@ -80,6 +81,7 @@ struct ct_atc {
 	unsigned int rsr; /* reference sample rate in Hz */
 	unsigned int msr; /* master sample rate in rsr */
 	unsigned int pll_rate; /* current rate of Phase Lock Loop */
+	unsigned int hw_gen; /* bumped whenever the chip loses its state */
 
 	int chip_type;
 	int model;
@@ -24,10 +24,6 @@
 
 #define DAIO_OUT_MAX		SPDIFOO
 
-struct daio_usage {
-	unsigned short data;
-};
-
 struct daio_rsc_idx {
 	unsigned short left;
 	unsigned short right;
@@ -508,17 +504,17 @@ static int dai_rsc_uninit(struct dai *dai)
 
 static int daio_mgr_get_rsc(struct rsc_mgr *mgr, enum DAIOTYP type)
 {
-	if (((struct daio_usage *)mgr->rscs)->data & (0x1 << type))
+	if (test_bit(type, mgr->rscs))
 		return -ENOENT;
 
-	((struct daio_usage *)mgr->rscs)->data |= (0x1 << type);
+	__set_bit(type, mgr->rscs);
 
 	return 0;
 }
 
 static int daio_mgr_put_rsc(struct rsc_mgr *mgr, enum DAIOTYP type)
 {
-	((struct daio_usage *)mgr->rscs)->data &= ~(0x1 << type);
+	__clear_bit(type, mgr->rscs);
 
 	return 0;
 }
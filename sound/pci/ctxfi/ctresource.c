@@ -19,57 +19,37 @@
 #include "cthardware.h"
 #include <linux/err.h>
 #include <linux/slab.h>
+#include <linux/bitmap.h>
 
 #define AUDIO_SLOT_BLOCK_NUM 	256
 
 /* Resource allocation based on bit-map management mechanism */
 static int
-get_resource(u8 *rscs, unsigned int amount,
+get_resource(unsigned long *rscs, unsigned int amount,
 	     unsigned int multi, unsigned int *ridx)
 {
-	int i, j, k, n;
-
-	/* Check whether there are sufficient resources to meet request. */
-	for (i = 0, n = multi; i < amount; i++) {
-		j = i / 8;
-		k = i % 8;
-		if (rscs[j] & ((u8)1 << k)) {
-			n = multi;
-			continue;
-		}
-		if (!(--n))
-			break; /* found sufficient contiguous resources */
-	}
+	unsigned long i;
 
+	/* Find the first free area of sufficient contiguous resources,
+	 * scanning the bit-map a word at a time. */
+	i = bitmap_find_next_zero_area(rscs, amount, 0, multi, 0);
 	if (i >= amount) {
 		/* Can not find sufficient contiguous resources */
 		return -ENOENT;
 	}
 
 	/* Mark the contiguous bits in resource bit-map as used */
-	for (n = multi; n > 0; n--) {
-		j = i / 8;
-		k = i % 8;
-		rscs[j] |= ((u8)1 << k);
-		i--;
-	}
-
-	*ridx = i + 1;
+	bitmap_set(rscs, i, multi);
+	*ridx = i;
 
 	return 0;
 }
 
-static int put_resource(u8 *rscs, unsigned int multi, unsigned int idx)
+static int put_resource(unsigned long *rscs, unsigned int multi,
+			unsigned int idx)
 {
-	unsigned int i, j, k, n;
-
-	/* Mark the contiguous bits in resource bit-map as used */
-	for (n = multi, i = idx; n > 0; n--) {
-		j = i / 8;
-		k = i % 8;
-		rscs[j] &= ~((u8)1 << k);
-		i++;
-	}
+	/* Mark the contiguous bits in resource bit-map as unused */
+	bitmap_clear(rscs, idx, multi);
 
 	return 0;
 }
@@ -213,7 +193,8 @@ int rsc_mgr_init(struct rsc_mgr *mgr, enum RSCTYP type,
 
 	mgr->type = NUM_RSCTYP;
 
-	mgr->rscs = kzalloc(((amount + 8 - 1) / 8), GFP_KERNEL);
+	mgr->rscs = kcalloc(BITS_TO_LONGS(amount), sizeof(unsigned long),
+			    GFP_KERNEL);
 	if (!mgr->rscs)
 		return -ENOMEM;
 
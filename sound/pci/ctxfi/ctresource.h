@@ -58,7 +58,7 @@ struct rsc_mgr {
 	enum RSCTYP type; /* The type (RSCTYP) of resource to manage */
 	unsigned int amount; /* The total amount of a kind of resource */
 	unsigned int avail; /* The amount of currently available resources */
-	unsigned char *rscs; /* The bit-map for resource allocation */
+	unsigned long *rscs; /* The bit-map for resource allocation */
 	void *ctrl_blk; /* Chip specific control info block */
 	struct hw *hw; /* Chip specific object for hardware access */
 };
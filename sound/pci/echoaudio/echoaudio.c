@@ -1313,7 +1313,7 @@ static int snd_echo_mixer_put(struct snd_kcontrol *kcontrol,
 	if (chip->monitor_gain[out][in] != gain) {
 		spin_lock_irq(&chip->lock);
 		set_monitor_gain(chip, out, in, gain);
-		update_output_line_level(chip);
+		queue_level_update(chip, ECHO_LEVEL_OUTPUT);
 		spin_unlock_irq(&chip->lock);
 		changed = 1;
 	}
@@ -1381,7 +1381,7 @@ static int snd_echo_vmixer_put(struct snd_kcontrol *kcontrol,
 	if (chip->vmixer_gain[out][vch] != ucontrol->value.integer.value[0]) {
 		spin_lock_irq(&chip->lock);
 		set_vmixer_gain(chip, out, vch, ucontrol->value.integer.value[0]);
-		update_vmixer_level(chip);
+		queue_level_update(chip, ECHO_LEVEL_VMIXER);
 		spin_unlock_irq(&chip->lock);
 		changed = 1;
 	}
@@ -1867,6 +1867,8 @@ static irqreturn_t snd_echo_interrupt(int irq, void *dev_id)
 
 static int snd_echo_free(struct echoaudio *chip)
 {
+	cancel_work_sync(&chip->level_work);
+
 	if (chip->comm_page)
 		rest_in_peace(chip);
 
@@ -1931,6 +1933,7 @@ static int snd_echo_create(struct snd_card *card,
 		chip->irq = -1;
 		atomic_set(&chip->opencount, 0);
 		mutex_init(&chip->mode_mutex);
+		INIT_WORK(&chip->level_work, level_update_work);
 		chip->can_set_rate = 1;
 	} else {
 		/* If this was called from the resume function, chip is
@@ -2172,6 +2175,13 @@ static int snd_echo_suspend(struct device *dev)
 	if (chip->midi_out)
 		snd_echo_midi_output_trigger(chip->midi_out, 0);
 #endif
+	/* the levels are all restored on resume */
+	spin_lock_irq(&chip->lock);
+	chip->levels_held = 1;
+	chip->pending_levels = 0;
+	spin_unlock_irq(&chip->lock);
+	cancel_work_sync(&chip->level_work);
+
 	spin_lock_irq(&chip->lock);
 	if (wait_handshake(chip)) {
 		spin_unlock_irq(&chip->lock);
@@ -2226,6 +2236,13 @@ static int snd_echo_resume(struct device *dev)
 		return err;
 	}
 
+	/* send the levels changed since they were restored */
+	spin_lock_irq(&chip->lock);
+	chip->levels_held = 0;
+	if (chip->pending_levels)
+		schedule_work(&chip->level_work);
+	spin_unlock_irq(&chip->lock);
+
 	memcpy(&commpage->audio_format, &commpage_bak->audio_format,
 		sizeof(commpage->audio_format));
 	memcpy(&commpage->sglist_addr, &commpage_bak->sglist_addr,
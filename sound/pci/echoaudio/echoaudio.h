@@ -351,6 +351,9 @@ struct echoaudio {
 	struct snd_rawmidi_substream *midi_in, *midi_out;
 #endif
 	struct timer_list timer;
+	struct work_struct level_work;		/* Deferred level updates */
+	u32 pending_levels;			/* ECHO_LEVEL_* to send */
+	char levels_held;			/* Suspended, don't send them */
 	char tinuse;				/* Timer in use */
 	char midi_full;				/* MIDI output buffer is full */
 	char can_set_rate;
@@ -450,6 +453,10 @@ static int snd_echo_midi_create(struct snd_card *card,
 #endif
 
 
+/* Level updates queued by the mixer controls */
+#define ECHO_LEVEL_OUTPUT	0x01	/* DSP_VC_UPDATE_OUTVOL */
+#define ECHO_LEVEL_VMIXER	0x02	/* DSP_VC_UPDATE_VMIXER */
+
 static inline void clear_handshake(struct echoaudio *chip)
 {
 	chip->comm_page->handshake = 0;
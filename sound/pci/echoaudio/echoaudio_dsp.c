@@ -566,7 +566,9 @@ static int set_output_gain(struct echoaudio *chip, u16 channel, s8 gain)
 
 
 #ifdef ECHOCARD_HAS_MONITOR
-/* Set the monitor level from an input bus to an output bus. */
+/* Set the monitor level from an input bus to an output bus.  The DSP only
+reads it with the next DSP_VC_UPDATE_OUTVOL, so there's no handshake to wait
+for here; the update vector waits for it. */
 static int set_monitor_gain(struct echoaudio *chip, u16 output, u16 input,
 			    s8 gain)
 {
@@ -574,9 +576,6 @@ static int set_monitor_gain(struct echoaudio *chip, u16 output, u16 input,
 		    input >= num_busses_in(chip)))
 		return -EINVAL;
 
-	if (wait_handshake(chip))
-		return -EIO;
-
 	chip->monitor_gain[output][input] = gain;
 	chip->comm_page->monitors[monitor_index(chip, output, input)] = gain;
 	return 0;
@@ -606,6 +605,55 @@ static int update_input_line_level(struct echoaudio *chip)
 
 
 
+/* Queue an update of the levels written to the comm page.  All the gains
+changed before the work runs are sent with a single update vector, and the
+work sleeps instead of spinning while the DSP is still busy with the previous
+command; neither the gain setters nor this function wait for the DSP.
+Nothing is sent while suspended, the resume restores all the levels.
+Must be called with chip->lock held. */
+static void queue_level_update(struct echoaudio *chip, u32 levels)
+{
+	chip->pending_levels |= levels;
+	if (!chip->levels_held)
+		schedule_work(&chip->level_work);
+}
+
+
+
+static void level_update_work(struct work_struct *work)
+{
+	struct echoaudio *chip = container_of(work, struct echoaudio,
+					      level_work);
+	int i;
+
+	for (;;) {
+		/* Sleep until the DSP has taken the previous command */
+		for (i = 0; i < HANDSHAKE_TIMEOUT; i += 20) {
+			if (READ_ONCE(chip->comm_page->handshake))
+				break;
+			usleep_range(20, 40);
+		}
+
+		spin_lock_irq(&chip->lock);
+		if (chip->pending_levels & ECHO_LEVEL_OUTPUT) {
+			chip->pending_levels &= ~ECHO_LEVEL_OUTPUT;
+			update_output_line_level(chip);
+#ifdef ECHOCARD_HAS_VMIXER
+		} else if (chip->pending_levels & ECHO_LEVEL_VMIXER) {
+			chip->pending_levels &= ~ECHO_LEVEL_VMIXER;
+			update_vmixer_level(chip);
+#endif
+		} else {
+			chip->pending_levels = 0;
+			spin_unlock_irq(&chip->lock);
+			return;
+		}
+		spin_unlock_irq(&chip->lock);
+	}
+}
+
+
+
 /* set_meters_on turns the meters on or off.  If meters are turned on, the DSP
 will write the meter and clock detect values to the comm page at about 30Hz */
 static void set_meters_on(struct echoaudio *chip, char on)
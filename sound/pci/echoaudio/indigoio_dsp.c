@@ -110,9 +110,6 @@ static int set_vmixer_gain(struct echoaudio *chip, u16 output, u16 pipe,
 		       output >= num_busses_out(chip)))
 		return -EINVAL;
 
-	if (wait_handshake(chip))
-		return -EIO;
-
 	chip->vmixer_gain[output][pipe] = gain;
 	index = output * num_pipes_out(chip) + pipe;
 	chip->comm_page->vmixer[index] = gain;
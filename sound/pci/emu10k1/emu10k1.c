@@ -53,6 +53,7 @@ static int max_buffer_size[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 128};
 static bool enable_ir[SNDRV_CARDS];
 static uint subsystem[SNDRV_CARDS]; /* Force card subsystem model */
 static uint delay_pcm_irq[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 2};
+static int shared_clients[SNDRV_CARDS];
 
 module_param_array(index, int, NULL, 0444);
 MODULE_PARM_DESC(index, "Index value for the EMU10K1 soundcard.");
@@ -76,6 +77,8 @@ module_param_array(subsystem, uint, NULL, 0444);
 MODULE_PARM_DESC(subsystem, "Force card subsystem model.");
 module_param_array(delay_pcm_irq, uint, NULL, 0444);
 MODULE_PARM_DESC(delay_pcm_irq, "Delay PCM interrupt by specified number of samples (default 0).");
+module_param_array(shared_clients, int, NULL, 0444);
+MODULE_PARM_DESC(shared_clients, "Clients of the shared playback device (0 = none).");
 /*
  * Class 0401: 1102:0008 (rev 00) Subsystem: 1102:1001 -> Audigy2 Value  Model:SB0400
  */
@@ -157,6 +160,12 @@ static int snd_card_emu10k1_probe(struct pci_dev *pci,
 		if ((err = snd_p16v_pcm(emu, 4)) < 0)
 			goto error;
 	}
+	if (shared_clients[dev] > 0) {
+		err = snd_pcm_new_shared(emu->pcm, 5, shared_clients[dev],
+					 48000);
+		if (err < 0)
+			goto error;
+	}
 	if (emu->audigy) {
 		if ((err = snd_emu10k1_audigy_midi(emu)) < 0)
 			goto error;
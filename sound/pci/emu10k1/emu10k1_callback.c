@@ -22,22 +22,10 @@
 #include "emu10k1_synth_local.h"
 #include <sound/asoundef.h>
 
-/* voice status */
-enum {
-	V_FREE=0, V_OFF, V_RELEASED, V_PLAYING, V_END
-};
-
-/* Keeps track of what we are finding */
-struct best_voice {
-	unsigned int time;
-	int voice;
-};
-
 /*
  * prototypes
  */
-static void lookup_voices(struct snd_emux *emux, struct snd_emu10k1 *hw,
-			  struct best_voice *best, int active_only);
+static int voice_finished(struct snd_emux_voice *vp);
 static struct snd_emux_voice *get_voice(struct snd_emux *emux,
 					struct snd_emux_port *port);
 static int start_voice(struct snd_emux_voice *vp);
@@ -93,32 +81,18 @@ snd_emu10k1_synth_get_voice(struct snd_emu10k1 *hw)
 {
 	struct snd_emux *emu;
 	struct snd_emux_voice *vp;
-	struct best_voice best[V_END];
-	int i;
+	int ch;
 
 	emu = hw->synth;
 
-	lookup_voices(emu, hw, best, 1); /* no OFF voices */
-	for (i = 0; i < V_END; i++) {
-		if (best[i].voice >= 0) {
-			int ch;
-			vp = &emu->voices[best[i].voice];
-			if ((ch = vp->ch) < 0) {
-				/*
-				dev_warn(emu->card->dev,
-				       "synth_get_voice: ch < 0 (%d) ??", i);
-				*/
-				continue;
-			}
-			vp->emu->num_voices--;
-			vp->ch = -1;
-			vp->state = SNDRV_EMUX_ST_OFF;
-			return ch;
-		}
-	}
-
-	/* not found */
-	return -ENOMEM;
+	vp = snd_emux_find_voice(emu, 1, voice_finished); /* no free voices */
+	if (!vp)
+		return -ENOMEM;
+	ch = vp->ch;
+	vp->emu->num_voices--;
+	vp->ch = -1;
+	snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_OFF);
+	return ch;
 }
 
 
@@ -181,6 +155,8 @@ free_voice(struct snd_emux_voice *vp)
 		snd_emu10k1_voice_free(hw, &hw->voices[vp->ch]);
 		vp->emu->num_voices--;
 		vp->ch = -1;
+		/* back to the free list */
+		snd_emux_voice_set_state(vp, vp->state);
 	}
 }
 
@@ -214,68 +190,25 @@ update_voice(struct snd_emux_voice *vp, int update)
 
 
 /*
- * look up voice table - get the best voice in order of preference
+ * check whether a released or playing voice has gone silent, i.e. its
+ * volume dropped to zero or its single-shot sample reached the end
  */
 /* spinlock held! */
-static void
-lookup_voices(struct snd_emux *emu, struct snd_emu10k1 *hw,
-	      struct best_voice *best, int active_only)
+static int
+voice_finished(struct snd_emux_voice *vp)
 {
-	struct snd_emux_voice *vp;
-	struct best_voice *bp;
-	int  i;
-
-	for (i = 0; i < V_END; i++) {
-		best[i].time = (unsigned int)-1; /* XXX MAX_?INT really */
-		best[i].voice = -1;
-	}
-
-	/*
-	 * Go through them all and get a best one to use.
-	 * NOTE: could also look at volume and pick the quietest one.
-	 */
-	for (i = 0; i < emu->max_voices; i++) {
-		int state, val;
-
-		vp = &emu->voices[i];
-		state = vp->state;
-		if (state == SNDRV_EMUX_ST_OFF) {
-			if (vp->ch < 0) {
-				if (active_only)
-					continue;
-				bp = best + V_FREE;
-			} else
-				bp = best + V_OFF;
-		}
-		else if (state == SNDRV_EMUX_ST_RELEASED ||
-			 state == SNDRV_EMUX_ST_PENDING) {
-			bp = best + V_RELEASED;
-#if 1
-			val = snd_emu10k1_ptr_read(hw, CVCF_CURRENTVOL, vp->ch);
-			if (! val)
-				bp = best + V_OFF;
-#endif
-		}
-		else if (state == SNDRV_EMUX_ST_STANDBY)
-			continue;
-		else if (state & SNDRV_EMUX_ST_ON)
-			bp = best + V_PLAYING;
-		else
-			continue;
-
-		/* check if sample is finished playing (non-looping only) */
-		if (bp != best + V_OFF && bp != best + V_FREE &&
-		    (vp->reg.sample_mode & SNDRV_SFNT_SAMPLE_SINGLESHOT)) {
-			val = snd_emu10k1_ptr_read(hw, CCCA_CURRADDR, vp->ch);
-			if (val >= vp->reg.loopstart)
-				bp = best + V_OFF;
-		}
-
-		if (vp->time < bp->time) {
-			bp->time = vp->time;
-			bp->voice = i;
-		}
-	}
+	struct snd_emu10k1 *hw = vp->hw;
+
+	if (vp->ch < 0)
+		return 0;
+	if (vp->state != SNDRV_EMUX_ST_ON &&
+	    !snd_emu10k1_ptr_read(hw, CVCF_CURRENTVOL, vp->ch))
+		return 1;
+	if ((vp->reg.sample_mode & SNDRV_SFNT_SAMPLE_SINGLESHOT) &&
+	    snd_emu10k1_ptr_read(hw, CCCA_CURRADDR, vp->ch) >=
+	    vp->reg.loopstart)
+		return 1;
+	return 0;
 }
 
 /*
@@ -288,29 +221,20 @@ get_voice(struct snd_emux *emu, struct snd_emux_port *port)
 {
 	struct snd_emu10k1 *hw;
 	struct snd_emux_voice *vp;
-	struct best_voice best[V_END];
-	int i;
+	struct snd_emu10k1_voice *hwvoice;
 
 	hw = emu->hw;
 
-	lookup_voices(emu, hw, best, 0);
-	for (i = 0; i < V_END; i++) {
-		if (best[i].voice >= 0) {
-			vp = &emu->voices[best[i].voice];
-			if (vp->ch < 0) {
-				/* allocate a voice */
-				struct snd_emu10k1_voice *hwvoice;
-				if (snd_emu10k1_voice_alloc(hw, EMU10K1_SYNTH, 1, &hwvoice) < 0 || hwvoice == NULL)
-					continue;
-				vp->ch = hwvoice->number;
-				emu->num_voices++;
-			}
-			return vp;
-		}
+	vp = snd_emux_find_voice(emu, 0, voice_finished);
+	if (vp && vp->ch < 0) {
+		/* allocate a voice */
+		if (snd_emu10k1_voice_alloc(hw, EMU10K1_SYNTH, 1, &hwvoice) < 0 || hwvoice == NULL)
+			/* no channel left, take one the synth holds */
+			return snd_emux_find_voice(emu, 1, voice_finished);
+		vp->ch = hwvoice->number;
+		emu->num_voices++;
 	}
-
-	/* not found */
-	return NULL;
+	return vp;
 }
 
 /*
@@ -510,10 +510,12 @@ static void snd_emu10k1_audigy_write_op(struct snd_emu10k1_fx8010_code *icode,
 #define A_OP(icode, ptr, op, r, a, x, y) \
 	snd_emu10k1_audigy_write_op(icode, ptr, op, r, a, x, y)
 
-static void snd_emu10k1_efx_write(struct snd_emu10k1 *emu, unsigned int pc, unsigned int data)
+static void snd_emu10k1_efx_write_block(struct snd_emu10k1 *emu,
+					unsigned int pc, unsigned int count)
 {
-	pc += emu->audigy ? A_MICROCODEBASE : MICROCODEBASE;
-	snd_emu10k1_ptr_write(emu, pc, 0, data);
+	snd_emu10k1_ptr_write_block(emu, pc +
+		(emu->audigy ? A_MICROCODEBASE : MICROCODEBASE),
+		emu->fx8010.code + pc, count);
 }
 
 unsigned int snd_emu10k1_efx_read(struct snd_emu10k1 *emu, unsigned int pc)
@@ -526,18 +528,29 @@ static int snd_emu10k1_gpr_poke(struct snd_emu10k1 *emu,
 				struct snd_emu10k1_fx8010_code *icode,
 				bool in_kernel)
 {
-	int gpr;
-	u32 val;
+	int gpr, start = 0, count = 0;
+	u32 val[32];
 
+	/* the DSP modifies its GPRs, so they are always written */
 	for (gpr = 0; gpr < (emu->audigy ? 0x200 : 0x100); gpr++) {
 		if (!test_bit(gpr, icode->gpr_valid))
 			continue;
+		if (count && (start + count != gpr || count == ARRAY_SIZE(val))) {
+			snd_emu10k1_ptr_write_block(emu, emu->gpr_base + start,
+						    val, count);
+			count = 0;
+		}
+		if (!count)
+			start = gpr;
 		if (in_kernel)
-			val = *(u32 *)&icode->gpr_map[gpr];
-		else if (get_user(val, &icode->gpr_map[gpr]))
+			val[count] = *(u32 *)&icode->gpr_map[gpr];
+		else if (get_user(val[count], &icode->gpr_map[gpr]))
 			return -EFAULT;
-		snd_emu10k1_ptr_write(emu, emu->gpr_base + gpr, 0, val);
+		count++;
 	}
+	if (count)
+		snd_emu10k1_ptr_write_block(emu, emu->gpr_base + start,
+					    val, count);
 	return 0;
 }
 
@@ -612,23 +625,42 @@ static int snd_emu10k1_code_poke(struct snd_emu10k1 *emu,
 				 struct snd_emu10k1_fx8010_code *icode,
 				 bool in_kernel)
 {
-	u32 pc, lo, hi;
+	u32 *code = emu->fx8010.code;
+	u32 pc, lo, hi, len = emu->audigy ? 2*1024 : 2*512;
+	int dirty = -1;		/* start of the changed instructions */
+	int err = 0;
 
-	for (pc = 0; pc < (emu->audigy ? 2*1024 : 2*512); pc += 2) {
+	/* only the instructions differing from the copy are written */
+	for (pc = 0; pc < len; pc += 2) {
 		if (!test_bit(pc / 2, icode->code_valid))
-			continue;
+			goto unchanged;
 		if (in_kernel) {
 			lo = *(u32 *)&icode->code[pc + 0];
 			hi = *(u32 *)&icode->code[pc + 1];
 		} else {
 			if (get_user(lo, &icode->code[pc + 0]) ||
-			    get_user(hi, &icode->code[pc + 1]))
-				return -EFAULT;
+			    get_user(hi, &icode->code[pc + 1])) {
+				err = -EFAULT;
+				break;
+			}
+		}
+		if (code[pc + 0] == lo && code[pc + 1] == hi)
+			goto unchanged;
+		code[pc + 0] = lo;
+		code[pc + 1] = hi;
+		if (dirty < 0)
+			dirty = pc;
+		continue;
+	unchanged:
+		if (dirty >= 0) {
+			snd_emu10k1_efx_write_block(emu, dirty, pc - dirty);
+			dirty = -1;
 		}
-		snd_emu10k1_efx_write(emu, pc + 0, lo);
-		snd_emu10k1_efx_write(emu, pc + 1, hi);
 	}
-	return 0;
+	/* keep the copy in sync with the hardware also on errors */
+	if (dirty >= 0)
+		snd_emu10k1_efx_write_block(emu, dirty, pc - dirty);
+	return err;
 }
 
 static int snd_emu10k1_code_peek(struct snd_emu10k1 *emu,
@@ -2417,8 +2449,15 @@ static int _snd_emu10k1_init_efx(struct snd_emu10k1 *emu)
 
 int snd_emu10k1_init_efx(struct snd_emu10k1 *emu)
 {
+	int pc, len = emu->audigy ? 2 * 1024 : 2 * 512;
+
 	spin_lock_init(&emu->fx8010.irq_lock);
 	INIT_LIST_HEAD(&emu->fx8010.gpr_ctl);
+	emu->fx8010.code = kmalloc_array(len, sizeof(u32), GFP_KERNEL);
+	if (!emu->fx8010.code)
+		return -ENOMEM;
+	for (pc = 0; pc < len; pc++)
+		emu->fx8010.code[pc] = snd_emu10k1_efx_read(emu, pc);
 	if (emu->audigy)
 		return _snd_emu10k1_audigy_init_efx(emu);
 	else
@@ -2432,6 +2471,8 @@ void snd_emu10k1_free_efx(struct snd_emu10k1 *emu)
 		snd_emu10k1_ptr_write(emu, A_DBG, 0, emu->fx8010.dbg = A_DBG_SINGLE_STEP);
 	else
 		snd_emu10k1_ptr_write(emu, DBG, 0, emu->fx8010.dbg = EMU10K1_DBG_SINGLE_STEP);
+	kfree(emu->fx8010.code);
+	emu->fx8010.code = NULL;
 }
 
 #if 0 /* FIXME: who use them? */
@@ -2698,10 +2739,6 @@ int snd_emu10k1_efx_alloc_pm_buffer(struct snd_emu10k1 *emu)
 	emu->tram_addr_saved = kmalloc(len * 4, GFP_KERNEL);
 	if (! emu->tram_val_saved || ! emu->tram_addr_saved)
 		return -ENOMEM;
-	len = emu->audigy ? 2 * 1024 : 2 * 512;
-	emu->saved_icode = vmalloc(len * 4);
-	if (! emu->saved_icode)
-		return -ENOMEM;
 	return 0;
 }
 
@@ -2710,11 +2747,10 @@ void snd_emu10k1_efx_free_pm_buffer(struct snd_emu10k1 *emu)
 	kfree(emu->saved_gpr);
 	kfree(emu->tram_val_saved);
 	kfree(emu->tram_addr_saved);
-	vfree(emu->saved_icode);
 }
 
 /*
- * save/restore GPR, TRAM and codes
+ * save/restore GPR and TRAM; the code is restored from fx8010.code
  */
 void snd_emu10k1_efx_suspend(struct snd_emu10k1 *emu)
 {
@@ -2734,10 +2770,6 @@ void snd_emu10k1_efx_suspend(struct snd_emu10k1 *emu)
 				snd_emu10k1_ptr_read(emu, A_TANKMEMCTLREGBASE + i, 0) << 20;
 		}
 	}
-
-	len = emu->audigy ? 2 * 1024 : 2 * 512;
-	for (i = 0; i < len; i++)
-		emu->saved_icode[i] = snd_emu10k1_efx_read(emu, i);
 }
 
 void snd_emu10k1_efx_resume(struct snd_emu10k1 *emu)
@@ -2765,8 +2797,7 @@ void snd_emu10k1_efx_resume(struct snd_emu10k1 *emu)
 		snd_emu10k1_ptr_write(emu, DBG, 0, emu->fx8010.dbg | EMU10K1_DBG_SINGLE_STEP);
 
 	len = emu->audigy ? 0x200 : 0x100;
-	for (i = 0; i < len; i++)
-		snd_emu10k1_ptr_write(emu, emu->gpr_base + i, 0, emu->saved_gpr[i]);
+	snd_emu10k1_ptr_write_block(emu, emu->gpr_base, emu->saved_gpr, len);
 
 	len = emu->audigy ? 0x100 : 0xa0;
 	for (i = 0; i < len; i++) {
@@ -2783,9 +2814,7 @@ void snd_emu10k1_efx_resume(struct snd_emu10k1 *emu)
 		}
 	}
 
-	len = emu->audigy ? 2 * 1024 : 2 * 512;
-	for (i = 0; i < len; i++)
-		snd_emu10k1_efx_write(emu, i, emu->saved_icode[i]);
+	snd_emu10k1_efx_write_block(emu, 0, emu->audigy ? 2 * 1024 : 2 * 512);
 
 	/* start FX processor when the DSP code is updated */
 	if (emu->audigy)
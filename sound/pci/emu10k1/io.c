@@ -99,6 +99,32 @@ void snd_emu10k1_ptr_write(struct snd_emu10k1 *emu, unsigned int reg, unsigned i
 
 EXPORT_SYMBOL(snd_emu10k1_ptr_write);
 
+/*
+ * Write count consecutive registers of channel 0 from reg on.  Plain
+ * registers only; the lock is taken once for a few writes at a time to
+ * keep the time with interrupts disabled short.
+ */
+void snd_emu10k1_ptr_write_block(struct snd_emu10k1 *emu, unsigned int reg,
+				 const unsigned int *data, unsigned int count)
+{
+	unsigned long flags;
+	unsigned int mask, i, n;
+
+	mask = emu->audigy ? A_PTR_ADDRESS_MASK : PTR_ADDRESS_MASK;
+	while (count) {
+		n = min(count, 32U);
+		spin_lock_irqsave(&emu->emu_lock, flags);
+		for (i = 0; i < n; i++) {
+			outl(((reg + i) << 16) & mask, emu->port + PTR);
+			outl(data[i], emu->port + DATA);
+		}
+		spin_unlock_irqrestore(&emu->emu_lock, flags);
+		reg += n;
+		data += n;
+		count -= n;
+	}
+}
+
 unsigned int snd_emu10k1_ptr20_read(struct snd_emu10k1 * emu, 
 					  unsigned int reg, 
 					  unsigned int chn)
@@ -23,10 +23,18 @@
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 #include <linux/export.h>
+#include <linux/module.h>
 #include <sound/core.h>
 #include "hda_beep.h"
 #include "hda_local.h"
 
+/* keep the tone on for this long after the last request, so that a
+ * train of bells is merged into a single on/off verb pair
+ */
+static unsigned int beep_hold_ms;
+module_param(beep_hold_ms, uint, 0644);
+MODULE_PARM_DESC(beep_hold_ms, "Merge beep requests within the given ms (0 = off).");
+
 enum {
 	DIGBEEP_HZ_STEP = 46875,	/* 46.875 Hz */
 	DIGBEEP_HZ_MIN = 93750,		/* 93.750 Hz */
@@ -44,8 +52,12 @@ static void generate_tone(struct hda_beep *beep, int tone)
 			beep->power_hook(beep, true);
 		beep->playing = 1;
 	}
-	snd_hda_codec_write(codec, beep->nid, 0,
-			    AC_VERB_SET_BEEP_CONTROL, tone);
+	/* avoid the verb traffic for a tone that is already set */
+	if (tone != beep->cur_tone) {
+		snd_hda_codec_write(codec, beep->nid, 0,
+				    AC_VERB_SET_BEEP_CONTROL, tone);
+		beep->cur_tone = tone;
+	}
 	if (!tone && beep->playing) {
 		beep->playing = 0;
 		if (beep->power_hook)
@@ -57,10 +69,22 @@ static void generate_tone(struct hda_beep *beep, int tone)
 static void snd_hda_generate_beep(struct work_struct *work)
 {
 	struct hda_beep *beep =
-		container_of(work, struct hda_beep, beep_work);
-
-	if (beep->enabled)
-		generate_tone(beep, beep->tone);
+		container_of(work, struct hda_beep, beep_work.work);
+	unsigned long off;
+	int tone;
+
+	if (!beep->enabled)
+		return;
+	tone = READ_ONCE(beep->tone);
+	if (!tone && beep->playing && beep_hold_ms) {
+		/* postpone the stop until no more requests come in */
+		off = READ_ONCE(beep->on_stamp) + msecs_to_jiffies(beep_hold_ms);
+		if (time_before(jiffies, off)) {
+			schedule_delayed_work(&beep->beep_work, off - jiffies);
+			return;
+		}
+	}
+	generate_tone(beep, tone);
 }
 
 /* (non-standard) Linear beep tone calculation for IDT/STAC codecs 
@@ -126,14 +150,17 @@ static int snd_hda_beep_event(struct input_dev *dev, unsigned int type,
 		return -1;
 	}
 
+	if (beep->tone)
+		beep->on_stamp = jiffies;
+
 	/* schedule beep event */
-	schedule_work(&beep->beep_work);
+	mod_delayed_work(system_wq, &beep->beep_work, 0);
 	return 0;
 }
 
 static void turn_off_beep(struct hda_beep *beep)
 {
-	cancel_work_sync(&beep->beep_work);
+	cancel_delayed_work_sync(&beep->beep_work);
 	if (beep->playing) {
 		/* turn off beep */
 		generate_tone(beep, 0);
@@ -236,7 +263,7 @@ int snd_hda_attach_beep_device(struct hda_codec *codec, int nid)
 	beep->codec = codec;
 	codec->beep = beep;
 
-	INIT_WORK(&beep->beep_work, &snd_hda_generate_beep);
+	INIT_DELAYED_WORK(&beep->beep_work, &snd_hda_generate_beep);
 	mutex_init(&beep->mutex);
 
 	err = snd_hda_do_attach(beep);
@@ -33,12 +33,14 @@ struct hda_beep {
 	struct hda_codec *codec;
 	char phys[32];
 	int tone;
+	int cur_tone;		/* tone last sent to the codec */
+	unsigned long on_stamp;	/* jiffies of the last tone request */
 	hda_nid_t nid;
 	unsigned int registered:1;
 	unsigned int enabled:1;
 	unsigned int linear_tone:1;	/* linear tone for IDT/STAC codec */
 	unsigned int playing:1;
-	struct work_struct beep_work; /* scheduled task for beep event */
+	struct delayed_work beep_work; /* scheduled task for beep event */
 	struct mutex mutex;
 	void (*power_hook)(struct hda_beep *beep, bool on);
 };
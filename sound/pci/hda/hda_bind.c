@@ -74,6 +74,28 @@ int snd_hda_codec_set_name(struct hda_codec *codec, const char *name)
 }
 EXPORT_SYMBOL_GPL(snd_hda_codec_set_name);
 
+/* create the card devices of a bound codec */
+static int codec_build_devices(struct hda_codec *codec)
+{
+	int err;
+
+	err = snd_hda_codec_build_pcms(codec);
+	if (err < 0)
+		return err;
+	err = snd_hda_codec_build_controls(codec);
+	if (err < 0)
+		return err;
+	if (codec->card->registered) {
+		err = snd_card_register(codec->card);
+		if (err < 0)
+			return err;
+		snd_hda_codec_register(codec);
+	}
+
+	codec->core.lazy_cache = true;
+	return 0;
+}
+
 static int hda_codec_driver_probe(struct device *dev)
 {
 	struct hda_codec *codec = dev_to_hda_codec(dev);
@@ -103,20 +125,16 @@ static int hda_codec_driver_probe(struct device *dev)
 			goto error_module_put;
 	}
 
-	err = snd_hda_codec_build_pcms(codec);
-	if (err < 0)
-		goto error_module;
-	err = snd_hda_codec_build_controls(codec);
+	/* when configured in parallel, the PCMs and controls are built by
+	 * snd_hda_codec_configure() in the codec order; the probe itself may
+	 * run from modprobe, which mustn't wait for the other codecs
+	 */
+	if (codec->async_work)
+		return 0;
+
+	err = codec_build_devices(codec);
 	if (err < 0)
 		goto error_module;
-	if (codec->card->registered) {
-		err = snd_card_register(codec->card);
-		if (err < 0)
-			goto error_module;
-		snd_hda_codec_register(codec);
-	}
-
-	codec->core.lazy_cache = true;
 	return 0;
 
  error_module:
@@ -298,6 +316,17 @@ int snd_hda_codec_configure(struct hda_codec *codec)
 		}
 	}
 
+	/* card devices are created in the codec order */
+	if (codec->async_work) {
+		snd_card_async_wait_turn(codec->async_work);
+		err = codec_build_devices(codec);
+		if (err < 0) {
+			codec_err(codec, "Unable to build the codec devices\n");
+			device_release_driver(hda_codec_dev(codec));
+			goto error;
+		}
+	}
+
 	return 0;
 
  error:
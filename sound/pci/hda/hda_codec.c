@@ -88,6 +88,37 @@ static int codec_exec_verb(struct hdac_device *dev, unsigned int cmd,
 	return err;
 }
 
+/*
+ * Send multiple verbs at once - passed to exec_verbs override
+ */
+static int codec_exec_verbs(struct hdac_device *dev, const unsigned int *cmds,
+			    unsigned int *res, unsigned int count)
+{
+	struct hda_codec *codec = container_of(dev, struct hda_codec, core);
+	struct hda_bus *bus = codec->bus;
+	int err;
+
+ again:
+	snd_hda_power_up_pm(codec);
+	mutex_lock(&bus->core.cmd_mutex);
+	err = snd_hdac_bus_exec_verbs_unlocked(&bus->core, codec->core.addr,
+					       cmds, res, count);
+	mutex_unlock(&bus->core.cmd_mutex);
+	snd_hda_power_down_pm(codec);
+	if (!codec_in_pm(codec) && res && err == -EAGAIN) {
+		if (bus->response_reset) {
+			codec_dbg(codec,
+				  "resetting BUS due to fatal communication error\n");
+			snd_hda_bus_reset(bus);
+		}
+		goto again;
+	}
+	/* clear reset-flag when the communication gets recovered */
+	if (!err || codec_in_pm(codec))
+		bus->response_reset = 0;
+	return err;
+}
+
 /**
  * snd_hda_sequence_write - sequence writes
  * @codec: the HDA codec
@@ -98,8 +129,18 @@ static int codec_exec_verb(struct hdac_device *dev, unsigned int cmd,
  */
 void snd_hda_sequence_write(struct hda_codec *codec, const struct hda_verb *seq)
 {
-	for (; seq->nid; seq++)
-		snd_hda_codec_write(codec, seq->nid, 0, seq->verb, seq->param);
+	unsigned int cmds[32];
+	unsigned int cmd, n;
+
+	while (seq->nid) {
+		for (n = 0; n < ARRAY_SIZE(cmds) && seq->nid; seq++) {
+			cmd = snd_hdac_make_cmd(&codec->core, seq->nid,
+						seq->verb, seq->param);
+			if (cmd != ~0)
+				cmds[n++] = cmd;
+		}
+		snd_hdac_exec_verbs(&codec->core, cmds, NULL, n);
+	}
 }
 EXPORT_SYMBOL_GPL(snd_hda_sequence_write);
 
@@ -111,11 +152,14 @@ struct hda_conn_list {
 	hda_nid_t conns[0];
 };
 
-/* look up the cached results */
+/* look up the cached results; widget NIDs are found directly in the table */
 static struct hda_conn_list *
 lookup_conn_list(struct hda_codec *codec, hda_nid_t nid)
 {
 	struct hda_conn_list *p;
+
+	if (nid < codec->conn_table_size)
+		return codec->conn_table[nid];
 	list_for_each_entry(p, &codec->conn_list, list) {
 		if (p->nid == nid)
 			return p;
@@ -135,17 +179,58 @@ static int add_conn_list(struct hda_codec *codec, hda_nid_t nid, int len,
 	p->nid = nid;
 	memcpy(p->conns, list, len * sizeof(hda_nid_t));
 	list_add(&p->list, &codec->conn_list);
+	if (nid < codec->conn_table_size)
+		codec->conn_table[nid] = p;
 	return 0;
 }
 
+static void del_conn_list(struct hda_codec *codec, struct hda_conn_list *p)
+{
+	if (p->nid < codec->conn_table_size)
+		codec->conn_table[p->nid] = NULL;
+	list_del(&p->list);
+	kfree(p);
+}
+
 static void remove_conn_list(struct hda_codec *codec)
 {
 	while (!list_empty(&codec->conn_list)) {
 		struct hda_conn_list *p;
 		p = list_first_entry(&codec->conn_list, typeof(*p), list);
-		list_del(&p->list);
-		kfree(p);
+		del_conn_list(codec, p);
+	}
+}
+
+/* (re-)allocate the NID-indexed table covering all widgets of the codec */
+static int alloc_conn_table(struct hda_codec *codec)
+{
+	unsigned int size = codec->core.start_nid + codec->core.num_nodes;
+	struct hda_conn_list **table, *p;
+
+	table = kcalloc(size, sizeof(*table), GFP_KERNEL);
+	if (!table)
+		return -ENOMEM;
+	kfree(codec->conn_table);
+	codec->conn_table = table;
+	codec->conn_table_size = size;
+	/* there is at most one entry per NID in the list */
+	list_for_each_entry(p, &codec->conn_list, list) {
+		if (p->nid < size)
+			table[p->nid] = p;
 	}
+	return 0;
+}
+
+static int set_conn_list(struct hda_codec *codec, hda_nid_t nid, int len,
+			 const hda_nid_t *list)
+{
+	struct hda_conn_list *p;
+
+	p = lookup_conn_list(codec, nid);
+	if (p)
+		del_conn_list(codec, p);
+
+	return add_conn_list(codec, nid, len, list);
 }
 
 /* read the connection and add to the cache */
@@ -164,7 +249,7 @@ static int read_and_add_raw_conns(struct hda_codec *codec, hda_nid_t nid)
 		len = snd_hda_get_raw_connections(codec, nid, result, len);
 	}
 	if (len >= 0)
-		len = snd_hda_override_conn_list(codec, nid, len, result);
+		len = set_conn_list(codec, nid, len, result);
 	if (result != list)
 		kfree(result);
 	return len;
@@ -258,15 +343,9 @@ EXPORT_SYMBOL_GPL(snd_hda_get_connections);
 int snd_hda_override_conn_list(struct hda_codec *codec, hda_nid_t nid, int len,
 			       const hda_nid_t *list)
 {
-	struct hda_conn_list *p;
-
-	p = lookup_conn_list(codec, nid);
-	if (p) {
-		list_del(&p->list);
-		kfree(p);
-	}
-
-	return add_conn_list(codec, nid, len, list);
+	/* let the path search caches know that the topology changed */
+	codec->conn_serial++;
+	return set_conn_list(codec, nid, len, list);
 }
 EXPORT_SYMBOL_GPL(snd_hda_override_conn_list);
 
@@ -445,7 +524,8 @@ static int read_widget_caps(struct hda_codec *codec, hda_nid_t fg_node)
 	for (i = 0; i < codec->core.num_nodes; i++, nid++)
 		codec->wcaps[i] = snd_hdac_read_parm_uncached(&codec->core,
 					nid, AC_PAR_AUDIO_WIDGET_CAP);
-	return 0;
+	codec->conn_serial++;
+	return alloc_conn_table(codec);
 }
 
 /* read all pin default configurations and save codec->init_pins */
@@ -657,15 +737,22 @@ static void hda_jackpoll_work(struct work_struct *work)
 {
 	struct hda_codec *codec =
 		container_of(work, struct hda_codec, jackpoll_work.work);
+	bool changed;
 
 	snd_hda_jack_set_dirty_all(codec);
-	snd_hda_jack_poll_all(codec);
+	changed = snd_hda_jack_poll_all(codec);
 
 	if (!codec->jackpoll_interval)
 		return;
 
-	schedule_delayed_work(&codec->jackpoll_work,
-			      codec->jackpoll_interval);
+	/* poll less often while nothing happens, fast again after a change */
+	if (changed || !codec->jackpoll_cur ||
+	    codec->jackpoll_max <= codec->jackpoll_interval)
+		codec->jackpoll_cur = codec->jackpoll_interval;
+	else
+		codec->jackpoll_cur = min(codec->jackpoll_cur * 2,
+					  codec->jackpoll_max);
+	schedule_delayed_work(&codec->jackpoll_work, codec->jackpoll_cur);
 }
 
 /* release all pincfg lists */
@@ -853,23 +940,19 @@ static void snd_hda_codec_dev_release(struct device *dev)
 	snd_hda_sysfs_clear(codec);
 	kfree(codec->modelname);
 	kfree(codec->wcaps);
+	kfree(codec->conn_table);
 	kfree(codec);
 }
 
-/**
- * snd_hda_codec_new - create a HDA codec
- * @bus: the bus to assign
- * @codec_addr: the codec address
- * @codecp: the pointer to store the generated codec
- *
- * Returns 0 if successful, or a negative error code.
- */
-int snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
-		      unsigned int codec_addr, struct hda_codec **codecp)
+static int __snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
+			       unsigned int codec_addr,
+			       struct snd_card_work *cwork,
+			       struct hda_codec **codecp)
 {
 	struct hda_codec *codec;
 	char component[31];
 	hda_nid_t fg;
+	ktime_t start = ktime_get();
 	int err;
 	static struct snd_device_ops dev_ops = {
 		.dev_register = snd_hda_codec_dev_register,
@@ -897,6 +980,7 @@ int snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
 	codec->core.dev.release = snd_hda_codec_dev_release;
 	codec->core.type = HDA_DEV_LEGACY;
 	codec->core.exec_verb = codec_exec_verb;
+	codec->core.exec_verbs = codec_exec_verbs;
 
 	codec->bus = bus;
 	codec->card = card;
@@ -943,6 +1027,12 @@ int snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
 	/* power-up all before initialization */
 	hda_set_power_state(codec, AC_PWRST_D0);
 
+	codec->probe_time_us = ktime_us_delta(ktime_get(), start);
+
+	/* the rest touches the card, so do it in the probe order */
+	if (cwork)
+		snd_card_async_wait_turn(cwork);
+
 	snd_hda_codec_proc_new(codec);
 
 	snd_hda_create_hwdep(codec);
@@ -963,8 +1053,44 @@ int snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
 	put_device(hda_codec_dev(codec));
 	return err;
 }
+
+/**
+ * snd_hda_codec_new - create a HDA codec
+ * @bus: the bus to assign
+ * @codec_addr: the codec address
+ * @codecp: the pointer to store the generated codec
+ *
+ * Returns 0 if successful, or a negative error code.
+ */
+int snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
+		      unsigned int codec_addr, struct hda_codec **codecp)
+{
+	return __snd_hda_codec_new(bus, card, codec_addr, NULL, codecp);
+}
 EXPORT_SYMBOL_GPL(snd_hda_codec_new);
 
+/**
+ * snd_hda_codec_new_async - create a HDA codec from a card async work
+ * @bus: the bus to assign
+ * @codec_addr: the codec address
+ * @cwork: the card work calling this, see snd_card_async_schedule()
+ * @codecp: the pointer to store the generated codec
+ *
+ * Like snd_hda_codec_new(), but the codec is probed concurrently with
+ * the other works on the card; only the creation of the card devices
+ * waits for the preceding works.
+ *
+ * Returns 0 if successful, or a negative error code.
+ */
+int snd_hda_codec_new_async(struct hda_bus *bus, struct snd_card *card,
+			    unsigned int codec_addr,
+			    struct snd_card_work *cwork,
+			    struct hda_codec **codecp)
+{
+	return __snd_hda_codec_new(bus, card, codec_addr, cwork, codecp);
+}
+EXPORT_SYMBOL_GPL(snd_hda_codec_new_async);
+
 /**
  * snd_hda_codec_update_widgets - Refresh widget caps and pin defaults
  * @codec: the HDA codec
@@ -1879,6 +2005,17 @@ static int add_slave(struct hda_codec *codec,
 	return snd_ctl_add_slave(data, slave);
 }
 
+/* send the amp verbs of all slaves updated by a vmaster change at once */
+static void vmaster_batch(void *private_data, bool begin)
+{
+	struct hda_codec *codec = private_data;
+
+	if (begin)
+		snd_hdac_regmap_batch_begin(&codec->core);
+	else
+		snd_hdac_regmap_batch_end(&codec->core);
+}
+
 /**
  * __snd_hda_add_vmaster - create a virtual master control and add slaves
  * @codec: HD-audio codec
@@ -1924,6 +2061,7 @@ int __snd_hda_add_vmaster(struct hda_codec *codec, char *name,
 	err = map_slaves(codec, slaves, suffix, add_slave, kctl);
 	if (err < 0)
 		return err;
+	snd_ctl_add_vmaster_batch(kctl, vmaster_batch, codec);
 
 	/* init with master mute & zero volume */
 	put_kctl_with_value(kctl, 0);
@@ -2863,15 +3001,30 @@ static unsigned int hda_call_codec_suspend(struct hda_codec *codec)
 	hda_cleanup_all_streams(codec);
 	state = hda_set_power_state(codec, AC_PWRST_D3);
 	update_power_acct(codec, true);
+	codec->core.sync_reset_seq = codec->bus->core.reset_seq;
 	atomic_dec(&codec->core.in_pm);
 	return state;
 }
 
+/*
+ * Check whether the codec kept its widget settings over the power-down.
+ * Only trust EPSS codecs, which report a lost state via PS-SettingsReset,
+ * and only when neither a link reset nor a power well gating happened.
+ */
+static bool hda_codec_state_kept(struct hda_codec *codec, unsigned int state)
+{
+	return codec_has_epss(codec) && !(state & AC_PWRST_SETTING_RESET) &&
+		codec->core.sync_reset_seq == codec->bus->core.reset_seq;
+}
+
 /*
  * kick up codec; used both from PM and power-save
  */
 static void hda_call_codec_resume(struct hda_codec *codec)
 {
+	ktime_t start = ktime_get();
+	unsigned int state;
+
 	atomic_inc(&codec->core.in_pm);
 
 	if (codec->core.regmap)
@@ -2879,7 +3032,12 @@ static void hda_call_codec_resume(struct hda_codec *codec)
 
 	codec->power_jiffies = jiffies;
 
-	hda_set_power_state(codec, AC_PWRST_D0);
+	state = hda_set_power_state(codec, AC_PWRST_D0);
+	/* the cache sync below needs to write back only the lazy writes */
+	codec->core.sync_partial = hda_codec_state_kept(codec, state);
+	/* the beep generator may have been reset, send the next tone again */
+	if (codec->beep)
+		WRITE_ONCE(codec->beep->cur_tone, 0);
 	restore_shutup_pins(codec);
 	hda_exec_init_verbs(codec);
 	snd_hda_jack_set_dirty_all(codec);
@@ -2889,14 +3047,17 @@ static void hda_call_codec_resume(struct hda_codec *codec)
 		if (codec->patch_ops.init)
 			codec->patch_ops.init(codec);
 		if (codec->core.regmap)
-			regcache_sync(codec->core.regmap);
+			snd_hdac_regmap_sync(&codec->core);
 	}
+	codec->core.sync_partial = false;
 
+	codec->jackpoll_cur = 0;
 	if (codec->jackpoll_interval)
 		hda_jackpoll_work(&codec->jackpoll_work.work);
 	else
 		snd_hda_jack_report_sync(codec);
 	atomic_dec(&codec->core.in_pm);
+	codec->resume_time_us = ktime_us_delta(ktime_get(), start);
 }
 
 static int hda_codec_runtime_suspend(struct device *dev)
@@ -3301,6 +3462,8 @@ static void codec_set_power_save(struct hda_codec *codec, int delay)
 	if (delay == 0 && codec->auto_runtime_pm)
 		delay = 3000;
 
+	codec->power_save_delay = max(delay, 0);
+	codec->pm_delay = codec->power_save_delay;
 	if (delay > 0) {
 		pm_runtime_set_autosuspend_delay(dev, delay);
 		pm_runtime_use_autosuspend(dev);
@@ -3329,6 +3492,81 @@ void snd_hda_set_power_save(struct hda_bus *bus, int delay)
 }
 EXPORT_SYMBOL_GPL(snd_hda_set_power_save);
 
+/*
+ * Adaptive autosuspend
+ *
+ * Applications playing short sounds in bursts put the codec and the
+ * controller through a full power cycle for each sound once the gap
+ * between them exceeds the power_save delay.  Track the interval from
+ * the last stream close to the next open, and while streams keep coming
+ * back within bus->power_save_adaptive, stretch the autosuspend delay so
+ * that it covers the averaged interval.
+ */
+#define HDA_PM_REOPEN_WEIGHT	4	/* weight of the history */
+#define HDA_PM_REOPEN_MAX	(3600 * 1000)
+
+/**
+ * snd_hda_codec_pm_stream_open - account a PCM stream open for autosuspend
+ * @codec: the HDA codec
+ *
+ * Call this before powering up the codec for a PCM stream.
+ */
+void snd_hda_codec_pm_stream_open(struct hda_codec *codec)
+{
+	unsigned int gap;
+
+	if (codec->pm_streams++ || !codec->pm_closes)
+		return;
+
+	gap = jiffies_to_msecs(jiffies - codec->pm_close_stamp);
+	gap = min_t(unsigned int, gap, HDA_PM_REOPEN_MAX);
+	if (codec->pm_closes == 1)
+		codec->pm_reopen_ms = gap;
+	else
+		codec->pm_reopen_ms = (codec->pm_reopen_ms *
+				       (HDA_PM_REOPEN_WEIGHT - 1) + gap) /
+			HDA_PM_REOPEN_WEIGHT;
+
+	if (pm_runtime_suspended(hda_codec_dev(codec)))
+		codec->pm_cold_opens++;
+	else
+		codec->pm_warm_opens++;
+}
+EXPORT_SYMBOL_GPL(snd_hda_codec_pm_stream_open);
+
+/**
+ * snd_hda_codec_pm_stream_close - account a PCM stream close for autosuspend
+ * @codec: the HDA codec
+ *
+ * Call this before powering down the codec for a PCM stream.  When the
+ * last stream is closed, the autosuspend delay is reprogrammed from the
+ * reopen history.
+ */
+void snd_hda_codec_pm_stream_close(struct hda_codec *codec)
+{
+	unsigned int max_delay = codec->bus->power_save_adaptive;
+	unsigned int delay = codec->power_save_delay;
+	unsigned int reopen = codec->pm_reopen_ms;
+
+	if (snd_BUG_ON(!codec->pm_streams) || --codec->pm_streams)
+		return;
+
+	codec->pm_close_stamp = jiffies;
+	codec->pm_closes++;
+	if (!delay)
+		return; /* autosuspend disabled */
+
+	/* leave some margin over the average for the jitter */
+	if (max_delay > delay && codec->pm_closes > 1 && reopen <= max_delay)
+		delay = clamp(reopen + reopen / 2, delay, max_delay);
+
+	if (delay != codec->pm_delay) {
+		pm_runtime_set_autosuspend_delay(hda_codec_dev(codec), delay);
+		codec->pm_delay = delay;
+	}
+}
+EXPORT_SYMBOL_GPL(snd_hda_codec_pm_stream_close);
+
 /**
  * snd_hda_check_amp_list_power - Check the amp list and update the power
  * @codec: HD-audio codec
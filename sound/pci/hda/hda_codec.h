@@ -71,6 +71,7 @@ struct hda_bus {
 
 	int primary_dig_out_type;	/* primary digital out PCM type */
 	unsigned int mixer_assigned;	/* codec addr for mixer name */
+	unsigned int power_save_adaptive; /* max. adaptive autosuspend (ms) */
 };
 
 /* from hdac_bus to hda_bus */
@@ -186,6 +187,8 @@ struct hda_codec {
 	struct snd_card *card;
 	unsigned int addr;	/* codec addr*/
 	u32 probe_id; /* overridden id for probing */
+	/* set while configured in parallel, see azx_codec_configure() */
+	struct snd_card_work *async_work;
 
 	/* detected preset */
 	const struct hda_device_id *preset;
@@ -211,6 +214,9 @@ struct hda_codec {
 	struct snd_array nids;		/* list of mapped mixer elements */
 
 	struct list_head conn_list;	/* linked-list of connection-list */
+	struct hda_conn_list **conn_table; /* conn_list entries indexed by NID */
+	unsigned int conn_table_size;
+	unsigned int conn_serial;	/* bumped at each topology change */
 
 	struct mutex spdif_mutex;
 	struct mutex control_mutex;
@@ -262,7 +268,19 @@ struct hda_codec {
 	unsigned long power_on_acct;
 	unsigned long power_off_acct;
 	unsigned long power_jiffies;
+
+	/* adaptive autosuspend, see snd_hda_codec_pm_stream_open() */
+	unsigned int power_save_delay;	/* base autosuspend delay (ms) */
+	unsigned int pm_delay;		/* currently programmed delay (ms) */
+	unsigned int pm_streams;	/* number of open PCM streams */
+	unsigned int pm_closes;		/* number of last-stream closes */
+	unsigned long pm_close_stamp;	/* jiffies at the last close */
+	unsigned int pm_reopen_ms;	/* averaged close-to-reopen interval */
+	unsigned int pm_warm_opens;	/* reopened while still powered */
+	unsigned int pm_cold_opens;	/* reopened from runtime suspend */
 #endif
+	unsigned int probe_time_us;	/* time spent for the codec probe */
+	unsigned int resume_time_us;	/* time spent for the last resume */
 
 	/* filter the requested power state per nid */
 	unsigned int (*power_filter)(struct hda_codec *codec, hda_nid_t nid,
@@ -275,6 +293,8 @@ struct hda_codec {
 	/* jack detection */
 	struct snd_array jacktbl;
 	unsigned long jackpoll_interval; /* In jiffies. Zero means no poll, rely on unsol events */
+	unsigned long jackpoll_max; /* In jiffies. Back off up to this while no jack changes */
+	unsigned long jackpoll_cur; /* current poll interval */
 	struct delayed_work jackpoll_work;
 
 	/* jack detection */
@@ -307,6 +327,10 @@ struct hda_codec {
  */
 int snd_hda_codec_new(struct hda_bus *bus, struct snd_card *card,
 		      unsigned int codec_addr, struct hda_codec **codecp);
+int snd_hda_codec_new_async(struct hda_bus *bus, struct snd_card *card,
+			    unsigned int codec_addr,
+			    struct snd_card_work *cwork,
+			    struct hda_codec **codecp);
 int snd_hda_codec_configure(struct hda_codec *codec);
 int snd_hda_codec_update_widgets(struct hda_codec *codec);
 
@@ -497,15 +521,23 @@ int hda_call_check_power_status(struct hda_codec *codec, hda_nid_t nid)
 #ifdef CONFIG_PM
 void snd_hda_set_power_save(struct hda_bus *bus, int delay);
 void snd_hda_update_power_acct(struct hda_codec *codec);
+void snd_hda_codec_pm_stream_open(struct hda_codec *codec);
+void snd_hda_codec_pm_stream_close(struct hda_codec *codec);
 #else
 static inline void snd_hda_set_power_save(struct hda_bus *bus, int delay) {}
+static inline void snd_hda_codec_pm_stream_open(struct hda_codec *codec) {}
+static inline void snd_hda_codec_pm_stream_close(struct hda_codec *codec) {}
 #endif
 
 #ifdef CONFIG_SND_HDA_PATCH_LOADER
 /*
  * patch firmware
  */
+struct hda_patch;
 int snd_hda_load_patch(struct hda_bus *bus, size_t size, const void *buf);
+struct hda_patch *snd_hda_patch_compile(size_t size, const void *buf);
+void snd_hda_patch_apply(struct hda_bus *bus, const struct hda_patch *patch);
+void snd_hda_patch_free(struct hda_patch *patch);
 #endif
 
 #ifdef CONFIG_SND_HDA_DSP_LOADER
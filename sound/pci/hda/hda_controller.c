@@ -35,6 +35,7 @@
 
 #include <sound/core.h>
 #include <sound/initval.h>
+#include <sound/info.h>
 #include "hda_controller.h"
 
 #define CREATE_TRACE_POINTS
@@ -102,10 +103,14 @@ static int azx_pcm_close(struct snd_pcm_substream *substream)
 	struct azx_dev *azx_dev = get_azx_dev(substream);
 
 	trace_azx_pcm_close(chip, azx_dev);
+#ifdef CONFIG_SMP
+	irq_work_sync(&azx_dev->period_work);
+#endif
 	mutex_lock(&chip->open_mutex);
 	azx_release_device(azx_dev);
 	if (hinfo->ops.close)
 		hinfo->ops.close(hinfo, apcm->codec, substream);
+	snd_hda_codec_pm_stream_close(apcm->codec);
 	snd_hda_power_down(apcm->codec);
 	mutex_unlock(&chip->open_mutex);
 	snd_hda_codec_pcm_put(apcm->info);
@@ -301,6 +306,58 @@ unsigned int azx_get_pos_posbuf(struct azx *chip, struct azx_dev *azx_dev)
 }
 EXPORT_SYMBOL_GPL(azx_get_pos_posbuf);
 
+/* number of consistent reads until the position buffer is trusted */
+#define AZX_POSBUF_TRUST_COUNT	256
+
+/**
+ * azx_posbuf_check - validate the position buffer against a register read
+ * @chip: the controller
+ * @azx_dev: the stream
+ * @pos: the position obtained via the get_position callback
+ *
+ * Once the position buffer has matched the register reads long enough,
+ * azx_get_position() uses it for the stream direction and skips the MMIO
+ * reads.  A mismatch, e.g. checked from the period interrupt, revokes it.
+ */
+void azx_posbuf_check(struct azx *chip, struct azx_dev *azx_dev,
+		      unsigned int pos)
+{
+	int stream = azx_dev->core.substream->stream;
+	unsigned int bufsize = azx_dev->core.bufsize;
+	unsigned int posbuf, diff;
+
+	if (!chip->posbuf_learn[stream] || !azx_bus(chip)->use_posbuf)
+		return;
+
+	posbuf = azx_get_pos_posbuf(chip, azx_dev);
+	diff = posbuf > pos ? posbuf - pos : pos - posbuf;
+	if (diff > bufsize / 2 && posbuf < bufsize)
+		diff = bufsize - diff; /* wrap around */
+
+	if (posbuf >= bufsize ||
+	    diff > max_t(unsigned int, azx_dev->core.fifo_size, 64)) {
+		azx_dev->posbuf_checks = 0;
+		if (chip->posbuf_trusted[stream]) {
+			dev_info(chip->card->dev,
+				 "Position buffer mismatch (%u vs %u), using register reads again\n",
+				 posbuf, pos);
+			chip->posbuf_trusted[stream] = false;
+			chip->posbuf_learn[stream] = false;
+		}
+		return;
+	}
+
+	if (!chip->posbuf_trusted[stream] &&
+	    ++azx_dev->posbuf_checks >= AZX_POSBUF_TRUST_COUNT) {
+		dev_dbg(chip->card->dev,
+			"Position buffer validated for %s\n",
+			stream == SNDRV_PCM_STREAM_PLAYBACK ?
+			"playback" : "capture");
+		chip->posbuf_trusted[stream] = true;
+	}
+}
+EXPORT_SYMBOL_GPL(azx_posbuf_check);
+
 unsigned int azx_get_position(struct azx *chip,
 			      struct azx_dev *azx_dev)
 {
@@ -309,9 +366,10 @@ unsigned int azx_get_position(struct azx *chip,
 	int stream = substream->stream;
 	int delay = 0;
 
-	if (chip->get_position[stream])
+	if (chip->get_position[stream] && !chip->posbuf_trusted[stream]) {
 		pos = chip->get_position[stream](chip, azx_dev);
-	else /* use the position buffer as default */
+		azx_posbuf_check(chip, azx_dev, pos);
+	} else /* use the position buffer as default */
 		pos = azx_get_pos_posbuf(chip, azx_dev);
 
 	if (pos >= azx_dev->core.bufsize)
@@ -339,10 +397,33 @@ static snd_pcm_uframes_t azx_pcm_pointer(struct snd_pcm_substream *substream)
 	struct azx_pcm *apcm = snd_pcm_substream_chip(substream);
 	struct azx *chip = apcm->chip;
 	struct azx_dev *azx_dev = get_azx_dev(substream);
+
+#ifdef CONFIG_SMP
+	/* remember where the stream user runs, see stream_update() */
+	if (chip->period_steering && !in_interrupt())
+		WRITE_ONCE(azx_dev->period_cpu, raw_smp_processor_id());
+#endif
 	return bytes_to_frames(substream->runtime,
 			       azx_get_position(chip, azx_dev));
 }
 
+/* split the delay of azx_get_position() into codec and controller parts */
+static int azx_pcm_latency(struct snd_pcm_substream *substream,
+			   struct snd_pcm_latency *latency)
+{
+	struct azx_pcm *apcm = snd_pcm_substream_chip(substream);
+	struct hda_pcm_stream *hinfo = to_hda_pcm_stream(substream);
+	snd_pcm_uframes_t delay = substream->runtime->delay;
+	snd_pcm_uframes_t codec = 0;
+
+	if (hinfo->ops.get_delay)
+		codec = hinfo->ops.get_delay(hinfo, apcm->codec, substream);
+	latency->stage[SNDRV_PCM_LATENCY_CODEC].frames = codec;
+	latency->stage[SNDRV_PCM_LATENCY_FIFO].frames =
+		delay > codec ? delay - codec : 0;
+	return 0;
+}
+
 /*
  * azx_scale64: Scale base by mult/div while not overflowing sanely
  *
@@ -645,6 +726,7 @@ static int azx_pcm_open(struct snd_pcm_substream *substream)
 				   buff_step);
 	snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
 				   buff_step);
+	snd_hda_codec_pm_stream_open(apcm->codec);
 	snd_hda_power_up(apcm->codec);
 	if (hinfo->ops.open)
 		err = hinfo->ops.open(hinfo, apcm->codec, substream);
@@ -679,6 +761,7 @@ static int azx_pcm_open(struct snd_pcm_substream *substream)
 	return 0;
 
  powerdown:
+	snd_hda_codec_pm_stream_close(apcm->codec);
 	snd_hda_power_down(apcm->codec);
  unlock:
 	mutex_unlock(&chip->open_mutex);
@@ -706,6 +789,7 @@ static const struct snd_pcm_ops azx_pcm_ops = {
 	.trigger = azx_pcm_trigger,
 	.pointer = azx_pcm_pointer,
 	.get_time_info =  azx_get_time_info,
+	.latency = azx_pcm_latency,
 	.mmap = azx_pcm_mmap,
 	.page = snd_pcm_sgbuf_ops_page,
 };
@@ -756,6 +840,8 @@ int snd_hda_attach_pcm_stream(struct hda_bus *_bus, struct hda_codec *codec,
 	apcm->info = cpcm;
 	pcm->private_data = apcm;
 	pcm->private_free = azx_pcm_free;
+	/* the buffers come from snd_pcm_lib_malloc_pages() */
+	pcm->prealloc_resize = true;
 	if (cpcm->pcm_type == HDA_PCM_TYPE_MODEM)
 		pcm->dev_class = SNDRV_PCM_CLASS_MODEM;
 	list_add_tail(&apcm->list, &chip->pcm_list);
@@ -786,6 +872,22 @@ static unsigned int azx_command_addr(u32 cmd)
 	return addr;
 }
 
+/* account a completed verb; called with reg_lock held */
+static void azx_account_verb(struct azx *chip, unsigned int addr,
+			     unsigned long waits)
+{
+	struct hdac_bus *bus = azx_bus(chip);
+	u64 rtt = ktime_to_ns(ktime_sub(ktime_get(), chip->verb_stamp[addr]));
+
+	chip->verbs++;
+	chip->verb_waits += waits;
+	chip->verb_rtt_sum += rtt;
+	if (rtt > chip->verb_rtt_max)
+		chip->verb_rtt_max = rtt;
+	trace_azx_get_response(chip, addr, bus->last_cmd[addr],
+			       bus->rirb.res[addr], rtt, waits);
+}
+
 /* receive a response */
 static int azx_rirb_get_response(struct hdac_bus *bus, unsigned int addr,
 				 unsigned int *res)
@@ -808,12 +910,23 @@ static int azx_rirb_get_response(struct hdac_bus *bus, unsigned int addr,
 				chip->poll_count = 0;
 			if (res)
 				*res = bus->rirb.res[addr]; /* the last value */
+			azx_account_verb(chip, addr, loopcounter);
 			spin_unlock_irq(&bus->reg_lock);
 			return 0;
 		}
 		spin_unlock_irq(&bus->reg_lock);
 		if (time_after(jiffies, timeout))
 			break;
+		if (!chip->polling_mode && !do_poll) {
+			long left = (long)(timeout - jiffies);
+
+			/* sleep until azx_interrupt() receives the response */
+			if (left > 0)
+				wait_event_timeout(bus->rirb_wq,
+						   !READ_ONCE(bus->rirb.cmds[addr]),
+						   left);
+			continue;
+		}
 		if (hbus->needs_damn_long_delay || loopcounter > 3000)
 			msleep(2); /* temporary workaround */
 		else {
@@ -961,9 +1074,12 @@ static int azx_single_get_response(struct hdac_bus *bus, unsigned int addr,
 static int azx_send_cmd(struct hdac_bus *bus, unsigned int val)
 {
 	struct azx *chip = bus_to_azx(bus);
+	unsigned int addr = val >> 28;
 
 	if (chip->disabled)
 		return 0;
+	if (addr < HDA_MAX_CODECS)
+		chip->verb_stamp[addr] = ktime_get();
 	if (chip->single_cmd)
 		return azx_single_send_cmd(bus, val);
 	else
@@ -984,19 +1100,79 @@ static int azx_get_response(struct hdac_bus *bus, unsigned int addr,
 		return azx_rirb_get_response(bus, addr, res);
 }
 
+/* send multiple commands at once and collect the responses */
+static int azx_send_cmds(struct hdac_bus *bus, unsigned int addr,
+			 const unsigned int *cmds, unsigned int *res,
+			 unsigned int count)
+{
+	struct azx *chip = bus_to_azx(bus);
+	int n, err = 0;
+
+	if (chip->disabled)
+		return 0;
+	if (chip->single_cmd)
+		return -EOPNOTSUPP;
+
+	if (res) {
+		/* flush the pending verbs so that only ours are captured */
+		err = azx_rirb_get_response(bus, addr, NULL);
+		if (err)
+			return err;
+		spin_lock_irq(&bus->reg_lock);
+		bus->rirb.batch_res[addr] = res;
+		bus->rirb.batch_pos[addr] = 0;
+		bus->rirb.batch_len[addr] = count;
+		spin_unlock_irq(&bus->reg_lock);
+	}
+
+	chip->verb_stamp[addr] = ktime_get();
+	while (count) {
+		n = snd_hdac_bus_send_cmds(bus, cmds, count);
+		if (n < 0) {
+			err = n;
+			break;
+		}
+		cmds += n;
+		count -= n;
+		/* async writes are left pending just like the single verbs */
+		if (!count && !res && !bus->sync_write)
+			break;
+		/* otherwise wait until the CORB gets drained */
+		err = azx_rirb_get_response(bus, addr, NULL);
+		if (err)
+			break;
+	}
+
+	if (res) {
+		spin_lock_irq(&bus->reg_lock);
+		bus->rirb.batch_res[addr] = NULL;
+		spin_unlock_irq(&bus->reg_lock);
+	}
+	return err;
+}
+
 static int azx_link_power(struct hdac_bus *bus, bool enable)
 {
 	struct azx *chip = bus_to_azx(bus);
+	int err;
 
-	if (chip->ops->link_power)
-		return chip->ops->link_power(chip, enable);
-	else
+	if (!chip->ops->link_power)
 		return -EINVAL;
+	err = chip->ops->link_power(chip, enable);
+	if (!err) {
+		if (enable)
+			chip->link_power_on++;
+		else
+			chip->link_power_off++;
+	}
+	trace_azx_link_power(chip, enable, err);
+	return err;
 }
 
 static const struct hdac_bus_ops bus_core_ops = {
 	.command = azx_send_cmd,
 	.get_response = azx_get_response,
+	.command_batch = azx_send_cmds,
 	.link_power = azx_link_power,
 };
 
@@ -1116,16 +1292,81 @@ EXPORT_SYMBOL_GPL(azx_stop_chip);
 /*
  * interrupt handler
  */
+
+/* report a period to ALSA and account the latency from its stream IRQ */
+void azx_period_elapsed(struct azx *chip, struct azx_dev *azx_dev)
+{
+	u64 latency = ktime_to_ns(ktime_sub(ktime_get(), azx_dev->irq_stamp));
+
+	azx_dev->periods++;
+	azx_dev->irq_latency_sum += latency;
+	if (latency > azx_dev->irq_latency_max)
+		azx_dev->irq_latency_max = latency;
+	trace_azx_period_elapsed(chip, azx_dev, latency);
+	snd_pcm_period_elapsed(azx_stream(azx_dev)->substream);
+}
+EXPORT_SYMBOL_GPL(azx_period_elapsed);
+
+#ifdef CONFIG_SMP
+static void azx_period_work(struct irq_work *work)
+{
+	struct azx_dev *azx_dev = container_of(work, struct azx_dev,
+					       period_work);
+
+	azx_period_elapsed(bus_to_azx(azx_dev->core.bus), azx_dev);
+}
+
+/* hand the period over to the CPU the stream user was seen on, so that
+ * the streams of different users don't serialize behind the single IRQ
+ */
+static bool azx_steer_period(struct azx *chip, struct azx_dev *azx_dev)
+{
+	int cpu = READ_ONCE(azx_dev->period_cpu);
+
+	if (!chip->period_steering || cpu < 0 ||
+	    cpu == smp_processor_id() || !cpu_online(cpu))
+		return false;
+	/* a pending work covers this period, too */
+	irq_work_queue_on(&azx_dev->period_work, cpu);
+	return true;
+}
+#else
+#define azx_steer_period(chip, azx_dev)	false
+#endif
+
+/* the current DMA position without the delay calculation */
+static unsigned int azx_get_pos_irq(struct azx *chip, struct azx_dev *azx_dev)
+{
+	int stream = azx_dev->core.substream->stream;
+
+	if (chip->get_position[stream] && !chip->posbuf_trusted[stream])
+		return chip->get_position[stream](chip, azx_dev);
+	return azx_get_pos_posbuf(chip, azx_dev);
+}
+
 static void stream_update(struct hdac_bus *bus, struct hdac_stream *s)
 {
 	struct azx *chip = bus_to_azx(bus);
 	struct azx_dev *azx_dev = stream_to_azx_dev(s);
 
+	azx_dev->irq_stamp = ktime_get();
+
+	/* an IOC within a period just updates the position */
+	if (s->subperiods &&
+	    !snd_hdac_stream_period_irq(s, azx_get_pos_irq(chip, azx_dev))) {
+		spin_unlock(&bus->reg_lock);
+		snd_pcm_position_update(s->substream);
+		spin_lock(&bus->reg_lock);
+		return;
+	}
+
 	/* check whether this IRQ is really acceptable */
 	if (!chip->ops->position_check ||
 	    chip->ops->position_check(chip, azx_dev)) {
+		if (azx_steer_period(chip, azx_dev))
+			return;
 		spin_unlock(&bus->reg_lock);
-		snd_pcm_period_elapsed(azx_stream(azx_dev)->substream);
+		azx_period_elapsed(chip, azx_dev);
 		spin_lock(&bus->reg_lock);
 	}
 }
@@ -1218,15 +1459,15 @@ void snd_hda_bus_reset(struct hda_bus *bus)
 	bus->in_reset = 0;
 }
 
-static int get_jackpoll_interval(struct azx *chip)
+static int get_jackpoll_interval(struct azx *chip, const int *jackpoll_ms)
 {
 	int i;
 	unsigned int j;
 
-	if (!chip->jackpoll_ms)
+	if (!jackpoll_ms)
 		return 0;
 
-	i = chip->jackpoll_ms[chip->dev_index];
+	i = jackpoll_ms[chip->dev_index];
 	if (i == 0)
 		return 0;
 	if (i < 50 || i > 60000)
@@ -1261,6 +1502,7 @@ int azx_bus_init(struct azx *chip, const char *model,
 	    chip->get_position[1] != azx_get_pos_lpib)
 		bus->core.use_posbuf = true;
 	bus->core.bdl_pos_adj = chip->bdl_pos_adj;
+	bus->core.bdl_subperiods = chip->bdl_subperiods;
 	if (chip->driver_caps & AZX_DCAPS_CORBRP_SELF_CLEAR)
 		bus->core.corbrp_self_clear = true;
 
@@ -1282,12 +1524,43 @@ int azx_bus_init(struct azx *chip, const char *model,
 EXPORT_SYMBOL_GPL(azx_bus_init);
 
 /* Probe codecs */
+struct azx_codec_new_work {
+	struct snd_card_work cwork;
+	struct azx *chip;
+	int addr;
+};
+
+static void azx_codec_new(struct azx *chip, int addr,
+			  struct snd_card_work *cwork)
+{
+	struct hda_codec *codec;
+	int err;
+
+	err = snd_hda_codec_new_async(&chip->bus, chip->card, addr, cwork,
+				      &codec);
+	if (err < 0)
+		return;
+	codec->jackpoll_interval =
+		get_jackpoll_interval(chip, chip->jackpoll_ms);
+	codec->jackpoll_max =
+		get_jackpoll_interval(chip, chip->jackpoll_max_ms);
+	codec->beep_mode = chip->beep_mode;
+}
+
+static void azx_codec_new_work(struct snd_card_work *cwork)
+{
+	struct azx_codec_new_work *w =
+		container_of(cwork, struct azx_codec_new_work, cwork);
+
+	azx_codec_new(w->chip, w->addr, cwork);
+}
+
 int azx_probe_codecs(struct azx *chip, unsigned int max_slots)
 {
 	struct hdac_bus *bus = azx_bus(chip);
-	int c, codecs, err;
+	struct azx_codec_new_work *works;
+	int c;
 
-	codecs = 0;
 	if (!max_slots)
 		max_slots = AZX_DEFAULT_CODECS;
 
@@ -1314,19 +1587,27 @@ int azx_probe_codecs(struct azx *chip, unsigned int max_slots)
 		}
 	}
 
-	/* Then create codec instances */
+	/* Then create codec instances, concurrently if possible */
+	works = kcalloc(max_slots, sizeof(*works), GFP_KERNEL);
 	for (c = 0; c < max_slots; c++) {
 		if ((bus->codec_mask & (1 << c)) & chip->codec_probe_mask) {
-			struct hda_codec *codec;
-			err = snd_hda_codec_new(&chip->bus, chip->card, c, &codec);
-			if (err < 0)
+			if (!works) {
+				azx_codec_new(chip, c, NULL);
 				continue;
-			codec->jackpoll_interval = get_jackpoll_interval(chip);
-			codec->beep_mode = chip->beep_mode;
-			codecs++;
+			}
+			works[c].chip = chip;
+			works[c].addr = c;
+			snd_card_async_schedule(chip->card, &works[c].cwork,
+						azx_codec_new_work);
 		}
 	}
-	if (!codecs) {
+	if (works) {
+		snd_card_async_synchronize(chip->card);
+		kfree(works);
+	}
+
+	/* the failed codecs have been removed from the bus */
+	if (!bus->num_codecs) {
 		dev_err(chip->card->dev, "no codecs initialized\n");
 		return -ENXIO;
 	}
@@ -1334,18 +1615,61 @@ int azx_probe_codecs(struct azx *chip, unsigned int max_slots)
 }
 EXPORT_SYMBOL_GPL(azx_probe_codecs);
 
-/* configure each codec instance */
+struct azx_codec_work {
+	struct snd_card_work cwork;
+	struct hda_codec *codec;
+};
+
+static void azx_codec_configure_work(struct snd_card_work *cwork)
+{
+	struct azx_codec_work *w =
+		container_of(cwork, struct azx_codec_work, cwork);
+
+	snd_hda_codec_configure(w->codec);
+}
+
+/* configure each codec instance
+ *
+ * The codecs are probed in parallel; module loading, the codec parsing and
+ * the patch setup don't depend on each other.  PCMs and controls are still
+ * built in the codec list order as snd_hda_codec_configure() waits for its
+ * turn after binding the driver, so the device numbering doesn't change.
+ */
 int azx_codec_configure(struct azx *chip)
 {
 	struct hda_codec *codec, *next;
+	struct azx_codec_work *works;
+	int i, num = 0;
+
+	works = kcalloc(HDA_MAX_CODECS, sizeof(*works), GFP_KERNEL);
+	if (!works) {
+		/* use _safe version here since snd_hda_codec_configure()
+		 * deregisters the device upon error and deletes itself from
+		 * the bus list.
+		 */
+		list_for_each_codec_safe(codec, next, &chip->bus)
+			snd_hda_codec_configure(codec);
+		goto out;
+	}
 
-	/* use _safe version here since snd_hda_codec_configure() deregisters
-	 * the device upon error and deletes itself from the bus list.
-	 */
-	list_for_each_codec_safe(codec, next, &chip->bus) {
-		snd_hda_codec_configure(codec);
+	/* snapshot the list, the failed codecs delete themselves from it */
+	list_for_each_codec(codec, &chip->bus) {
+		if (num >= HDA_MAX_CODECS)
+			break;
+		works[num++].codec = codec;
 	}
 
+	for (i = 0; i < num; i++) {
+		works[i].codec->async_work = &works[i].cwork;
+		snd_card_async_schedule(chip->card, &works[i].cwork,
+					azx_codec_configure_work);
+	}
+	snd_card_async_synchronize(chip->card);
+	for (i = 0; i < num; i++)
+		works[i].codec->async_work = NULL;
+	kfree(works);
+
+ out:
 	if (!azx_bus(chip)->num_codecs)
 		return -ENODEV;
 	return 0;
@@ -1360,9 +1684,38 @@ static int stream_direction(struct azx *chip, unsigned char index)
 	return SNDRV_PCM_STREAM_PLAYBACK;
 }
 
+static void azx_proc_stats_read(struct snd_info_entry *entry,
+				struct snd_info_buffer *buffer)
+{
+	struct azx *chip = entry->private_data;
+	struct hdac_bus *bus = azx_bus(chip);
+	struct hdac_stream *s;
+
+	snd_iprintf(buffer, "verbs: %lu\n", chip->verbs);
+	snd_iprintf(buffer, "verb_waits: %lu\n", chip->verb_waits);
+	snd_iprintf(buffer, "verb_rtt_avg: %llu ns\n",
+		    chip->verbs ? div_u64(chip->verb_rtt_sum, chip->verbs) : 0);
+	snd_iprintf(buffer, "verb_rtt_max: %llu ns\n", chip->verb_rtt_max);
+	snd_iprintf(buffer, "link_power: on %lu, off %lu\n",
+		    chip->link_power_on, chip->link_power_off);
+
+	list_for_each_entry(s, &bus->stream_list, list) {
+		struct azx_dev *azx_dev = stream_to_azx_dev(s);
+
+		snd_iprintf(buffer,
+			    "stream %d: periods %lu, early %lu, delayed %lu, latency avg %llu ns, max %llu ns\n",
+			    s->index, azx_dev->periods, azx_dev->early_irqs,
+			    azx_dev->delayed_periods,
+			    azx_dev->periods ?
+			    div_u64(azx_dev->irq_latency_sum, azx_dev->periods) : 0,
+			    azx_dev->irq_latency_max);
+	}
+}
+
 /* initialize SD streams */
 int azx_init_streams(struct azx *chip)
 {
+	struct snd_info_entry *entry;
 	int i;
 	int stream_tags[2] = { 0, 0 };
 
@@ -1390,8 +1743,15 @@ int azx_init_streams(struct azx *chip)
 			tag = i + 1;
 		snd_hdac_stream_init(azx_bus(chip), azx_stream(azx_dev),
 				     i, dir, tag);
+#ifdef CONFIG_SMP
+		init_irq_work(&azx_dev->period_work, azx_period_work);
+		azx_dev->period_cpu = -1;
+#endif
 	}
 
+	if (!snd_card_proc_new(chip->card, "hda_stats", &entry))
+		snd_info_set_text_ops(entry, chip, azx_proc_stats_read);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(azx_init_streams);
@@ -17,6 +17,7 @@
 
 #include <linux/timecounter.h>
 #include <linux/interrupt.h>
+#include <linux/irq_work.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/initval.h>
@@ -76,7 +77,23 @@ struct azx_dev {
 	 *  when link position is not greater than FIFO size
 	 */
 	unsigned int insufficient:1;
-	unsigned int wc_marked:1;
+
+	/* consecutive position reads matching the position buffer */
+	unsigned int posbuf_checks;
+
+	/* per-stream counters, shown in the hda_stats proc file */
+	ktime_t irq_stamp;		/* last stream IRQ */
+	unsigned long periods;		/* periods reported to ALSA */
+	unsigned long early_irqs;	/* IRQs dropped as too early */
+	unsigned long delayed_periods;	/* periods left to irq_pending_work */
+	u64 irq_latency_sum;		/* IRQ to period_elapsed, in ns */
+	u64 irq_latency_max;
+
+#ifdef CONFIG_SMP
+	/* period processing steered to the CPU of the stream user */
+	struct irq_work period_work;
+	int period_cpu;
+#endif
 };
 
 #define azx_stream(dev)		(&(dev)->core)
@@ -128,6 +145,7 @@ struct azx {
 	int capture_index_offset;
 	int num_streams;
 	const int *jackpoll_ms; /* per-card jack poll interval */
+	const int *jackpoll_max_ms; /* per-card max. adaptive poll interval */
 
 	/* Register interaction. */
 	const struct hda_controller_ops *ops;
@@ -135,6 +153,9 @@ struct azx {
 	/* position adjustment callbacks */
 	azx_get_pos_callback_t get_position[2];
 	azx_get_delay_callback_t get_delay[2];
+	/* the position buffer may replace get_position once validated */
+	bool posbuf_learn[2];
+	bool posbuf_trusted[2];
 
 	/* locks */
 	struct mutex open_mutex; /* Prevents concurrent open/close operations */
@@ -147,11 +168,12 @@ struct azx {
 	unsigned int beep_mode;
 
 #ifdef CONFIG_SND_HDA_PATCH_LOADER
-	const struct firmware *fw;
+	struct hda_patch *patch;	/* compiled patch firmware */
 #endif
 
 	/* flags */
 	int bdl_pos_adj;
+	int bdl_subperiods;
 	int poll_count;
 	unsigned int running:1;
 	unsigned int fallback_to_single_cmd:1;
@@ -167,6 +189,18 @@ struct azx {
 	/* GTS present */
 	unsigned int gts_present:1;
 
+	/* process the periods on the CPU of the stream user */
+	unsigned int period_steering:1;
+
+	/* verb and link counters, shown in the hda_stats proc file */
+	ktime_t verb_stamp[HDA_MAX_CODECS];	/* last verb sent */
+	unsigned long verbs;
+	unsigned long verb_waits;	/* RIRB wait iterations */
+	u64 verb_rtt_sum;		/* in ns */
+	u64 verb_rtt_max;
+	unsigned long link_power_on;
+	unsigned long link_power_off;
+
 #ifdef CONFIG_SND_HDA_DSP_LOADER
 	struct azx_dev saved_azx_dev;
 #endif
@@ -209,6 +243,8 @@ static inline struct azx_dev *get_azx_dev(struct snd_pcm_substream *substream)
 unsigned int azx_get_position(struct azx *chip, struct azx_dev *azx_dev);
 unsigned int azx_get_pos_lpib(struct azx *chip, struct azx_dev *azx_dev);
 unsigned int azx_get_pos_posbuf(struct azx *chip, struct azx_dev *azx_dev);
+void azx_posbuf_check(struct azx *chip, struct azx_dev *azx_dev,
+		      unsigned int pos);
 
 /* Stream control. */
 void azx_stop_all_streams(struct azx *chip);
@@ -232,6 +268,7 @@ int azx_bus_init(struct azx *chip, const char *model,
 int azx_probe_codecs(struct azx *chip, unsigned int max_slots);
 int azx_codec_configure(struct azx *chip);
 int azx_init_streams(struct azx *chip);
+void azx_period_elapsed(struct azx *chip, struct azx_dev *azx_dev);
 void azx_free_streams(struct azx *chip);
 
 #endif /* __SOUND_HDA_CONTROLLER_H */
@@ -91,6 +91,80 @@ DEFINE_EVENT(azx_pcm, azx_pcm_prepare,
 	TP_ARGS(chip, azx_dev)
 );
 
+TRACE_EVENT(azx_get_response,
+
+	TP_PROTO(struct azx *chip, unsigned int addr, unsigned int cmd,
+		 unsigned int res, u64 rtt, unsigned long waits),
+
+	TP_ARGS(chip, addr, cmd, res, rtt, waits),
+
+	TP_STRUCT__entry(
+		__field( int, card )
+		__field( unsigned int, addr )
+		__field( unsigned int, cmd )
+		__field( unsigned int, res )
+		__field( u64, rtt )
+		__field( unsigned long, waits )
+	),
+
+	TP_fast_assign(
+		__entry->card = (chip)->card->number;
+		__entry->addr = addr;
+		__entry->cmd = cmd;
+		__entry->res = res;
+		__entry->rtt = rtt;
+		__entry->waits = waits;
+	),
+
+	TP_printk("[%d:%u] cmd=0x%08x res=0x%08x rtt=%lluns waits=%lu",
+		  __entry->card, __entry->addr, __entry->cmd, __entry->res,
+		  (unsigned long long)__entry->rtt, __entry->waits)
+);
+
+TRACE_EVENT(azx_period_elapsed,
+
+	TP_PROTO(struct azx *chip, struct azx_dev *dev, u64 latency),
+
+	TP_ARGS(chip, dev, latency),
+
+	TP_STRUCT__entry(
+		__field( int, card )
+		__field( int, idx )
+		__field( u64, latency )
+	),
+
+	TP_fast_assign(
+		__entry->card = (chip)->card->number;
+		__entry->idx = (dev)->core.index;
+		__entry->latency = latency;
+	),
+
+	TP_printk("[%d:%d] irq latency=%lluns", __entry->card, __entry->idx,
+		  (unsigned long long)__entry->latency)
+);
+
+TRACE_EVENT(azx_link_power,
+
+	TP_PROTO(struct azx *chip, bool enable, int err),
+
+	TP_ARGS(chip, enable, err),
+
+	TP_STRUCT__entry(
+		__field( int, card )
+		__field( bool, enable )
+		__field( int, err )
+	),
+
+	TP_fast_assign(
+		__entry->card = (chip)->card->number;
+		__entry->enable = enable;
+		__entry->err = err;
+	),
+
+	TP_printk("[%d] link power %s, err=%d", __entry->card,
+		  __entry->enable ? "on" : "off", __entry->err)
+);
+
 #endif /* _TRACE_HDA_CONTROLLER_H */
 
 /* This part must be outside protection */
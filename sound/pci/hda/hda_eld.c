@@ -132,17 +132,28 @@ static int cea_sampling_frequencies[8] = {
 	SNDRV_PCM_RATE_192000,	/* 7: 192000Hz */
 };
 
-static unsigned int hdmi_get_eld_data(struct hda_codec *codec, hda_nid_t nid,
-					int byte_index)
-{
-	unsigned int val;
+#define ELD_READ_BATCH	32
 
-	val = snd_hda_codec_read(codec, nid, 0,
-					AC_VERB_GET_HDMI_ELDD, byte_index);
+/* read @count ELD data bytes from @byte_index on in a single batch */
+static int hdmi_get_eld_data(struct hda_codec *codec, hda_nid_t nid,
+			     int byte_index, int count, unsigned int *res)
+{
+	unsigned int cmds[ELD_READ_BATCH];
+	int i, err;
+
+	for (i = 0; i < count; i++)
+		cmds[i] = snd_hdac_make_cmd(&codec->core, nid,
+					    AC_VERB_GET_HDMI_ELDD,
+					    byte_index + i);
+	err = snd_hdac_exec_verbs(&codec->core, cmds, res, count);
+	if (err < 0)
+		return err;
 #ifdef BE_PARANOID
-	codec_info(codec, "HDMI: ELD data byte %d: 0x%x\n", byte_index, val);
+	for (i = 0; i < count; i++)
+		codec_info(codec, "HDMI: ELD data byte %d: 0x%x\n",
+			   byte_index + i, res[i]);
 #endif
-	return val;
+	return 0;
 }
 
 #define GRAB_BITS(buf, byte, lowbit, bits) 		\
@@ -307,6 +318,7 @@ int snd_hdmi_get_eld_size(struct hda_codec *codec, hda_nid_t nid)
 int snd_hdmi_get_eld(struct hda_codec *codec, hda_nid_t nid,
 		     unsigned char *buf, int *eld_size)
 {
+	unsigned int res[ELD_READ_BATCH];
 	int i;
 	int ret = 0;
 	int size;
@@ -329,7 +341,16 @@ int snd_hdmi_get_eld(struct hda_codec *codec, hda_nid_t nid,
 
 	/* set ELD buffer */
 	for (i = 0; i < size; i++) {
-		unsigned int val = hdmi_get_eld_data(codec, nid, i);
+		unsigned int val;
+
+		if (!(i % ELD_READ_BATCH)) {
+			ret = hdmi_get_eld_data(codec, nid, i,
+						min(size - i, ELD_READ_BATCH),
+						res);
+			if (ret < 0)
+				goto error;
+		}
+		val = res[i % ELD_READ_BATCH];
 		/*
 		 * Graphics driver might be writing to ELD buffer right now.
 		 * Just abort. The caller will repoll after a while.
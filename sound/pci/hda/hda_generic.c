@@ -50,6 +50,7 @@ int snd_hda_gen_spec_init(struct hda_gen_spec *spec)
 {
 	snd_array_init(&spec->kctls, sizeof(struct snd_kcontrol_new), 32);
 	snd_array_init(&spec->paths, sizeof(struct nid_path), 8);
+	snd_array_init(&spec->path_memo, sizeof(struct nid_path_memo), 16);
 	snd_array_init(&spec->loopback_list, sizeof(struct hda_amp_list), 8);
 	mutex_init(&spec->pcm_mutex);
 	return 0;
@@ -102,6 +103,7 @@ static void snd_hda_gen_spec_free(struct hda_gen_spec *spec)
 		return;
 	free_kctls(spec);
 	snd_array_free(&spec->paths);
+	snd_array_free(&spec->path_memo);
 	snd_array_free(&spec->loopback_list);
 }
 
@@ -469,6 +471,54 @@ static bool snd_hda_parse_nid_path(struct hda_codec *codec, hda_nid_t from_nid,
 	return false;
 }
 
+/*
+ * The result of a path search depends only on the codec topology unless
+ * @from_nid is zero (which looks for an unused DAC), and the auto-parser
+ * repeats the same searches for each output configuration it evaluates.
+ * Remember the results, including the failed ones (depth = 0), until the
+ * connection lists or the widget caps get changed.
+ */
+static bool parse_nid_path_cached(struct hda_codec *codec, hda_nid_t from_nid,
+				  hda_nid_t to_nid, int anchor_nid,
+				  struct nid_path *path)
+{
+	struct hda_gen_spec *spec = codec->spec;
+	struct nid_path_memo *memo;
+	bool found;
+	int i;
+
+	if (!from_nid)
+		return snd_hda_parse_nid_path(codec, from_nid, to_nid,
+					      anchor_nid, path);
+
+	if (spec->path_memo_serial != codec->conn_serial) {
+		spec->path_memo.used = 0;
+		spec->path_memo_serial = codec->conn_serial;
+	}
+
+	for (i = 0; i < spec->path_memo.used; i++) {
+		memo = snd_array_elem(&spec->path_memo, i);
+		if (memo->from_nid == from_nid && memo->to_nid == to_nid &&
+		    memo->anchor_nid == anchor_nid) {
+			*path = memo->path;
+			return path->depth > 0;
+		}
+	}
+
+	found = snd_hda_parse_nid_path(codec, from_nid, to_nid, anchor_nid,
+				       path);
+	memo = snd_array_new(&spec->path_memo);
+	if (memo) {
+		memo->from_nid = from_nid;
+		memo->to_nid = to_nid;
+		memo->anchor_nid = anchor_nid;
+		memo->path = *path;
+		if (!found)
+			memo->path.depth = 0;
+	}
+	return found;
+}
+
 /**
  * snd_hda_add_new_path - parse the path between the given NIDs and
  * add to the path list
@@ -498,7 +548,7 @@ snd_hda_add_new_path(struct hda_codec *codec, hda_nid_t from_nid,
 	if (!path)
 		return NULL;
 	memset(path, 0, sizeof(*path));
-	if (snd_hda_parse_nid_path(codec, from_nid, to_nid, anchor_nid, path))
+	if (parse_nid_path_cached(codec, from_nid, to_nid, anchor_nid, path))
 		return path;
 	/* push back */
 	spec->paths.used--;
@@ -5871,7 +5921,7 @@ int snd_hda_gen_init(struct hda_codec *codec)
 	/* call init functions of standard auto-mute helpers */
 	update_automute_all(codec);
 
-	regcache_sync(codec->core.regmap);
+	snd_hdac_regmap_sync(&codec->core);
 
 	if (spec->vmaster_mute.sw_kctl && spec->vmaster_mute.hook)
 		snd_hda_sync_vmaster_hook(&spec->vmaster_mute);
@@ -52,6 +52,14 @@ struct nid_path {
 	bool stream_enabled:1;	/* stream is active */
 };
 
+/* path search result for the given endpoints */
+struct nid_path_memo {
+	hda_nid_t from_nid;
+	hda_nid_t to_nid;
+	int anchor_nid;
+	struct nid_path path;
+};
+
 /* mic/line-in auto switching entry */
 
 #define MAX_AUTO_MIC_PINS	3
@@ -169,6 +177,10 @@ struct hda_gen_spec {
 	/* path list */
 	struct snd_array paths;
 
+	/* memoized path search results, see parse_nid_path_cached() */
+	struct snd_array path_memo;
+	unsigned int path_memo_serial;
+
 	/* path indices */
 	int out_paths[AUTO_CFG_MAX_OUTS];
 	int hp_paths[AUTO_CFG_MAX_OUTS];
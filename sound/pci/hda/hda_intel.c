@@ -126,11 +126,15 @@ static bool enable[SNDRV_CARDS] = SNDRV_DEFAULT_ENABLE_PNP;
 static char *model[SNDRV_CARDS];
 static int position_fix[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS-1)] = -1};
 static int bdl_pos_adj[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS-1)] = -1};
+static int bdl_subperiods[SNDRV_CARDS];
 static int probe_mask[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS-1)] = -1};
 static int probe_only[SNDRV_CARDS];
 static int jackpoll_ms[SNDRV_CARDS];
+static int jackpoll_max_ms[SNDRV_CARDS];
 static int single_cmd = -1;
 static int enable_msi = -1;
+static bool period_steering;
+static bool position_fix_calibrate = true;
 #ifdef CONFIG_SND_HDA_PATCH_LOADER
 static char *patch[SNDRV_CARDS];
 #endif
@@ -152,17 +156,25 @@ MODULE_PARM_DESC(position_fix, "DMA pointer read method."
 		 "(-1 = system default, 0 = auto, 1 = LPIB, 2 = POSBUF, 3 = VIACOMBO, 4 = COMBO, 5 = SKL+).");
 module_param_array(bdl_pos_adj, int, NULL, 0644);
 MODULE_PARM_DESC(bdl_pos_adj, "BDL position adjustment offset.");
+module_param_array(bdl_subperiods, int, NULL, 0444);
+MODULE_PARM_DESC(bdl_subperiods, "Split each period into the given number of position updates (0/1 = off).");
 module_param_array(probe_mask, int, NULL, 0444);
 MODULE_PARM_DESC(probe_mask, "Bitmask to probe codecs (default = -1).");
 module_param_array(probe_only, int, NULL, 0444);
 MODULE_PARM_DESC(probe_only, "Only probing and no codec initialization.");
 module_param_array(jackpoll_ms, int, NULL, 0444);
 MODULE_PARM_DESC(jackpoll_ms, "Ms between polling for jack events (default = 0, using unsol events only)");
+module_param_array(jackpoll_max_ms, int, NULL, 0444);
+MODULE_PARM_DESC(jackpoll_max_ms, "Max ms the jack polling backs off to while no jack changes (default = 0, fixed interval)");
 module_param(single_cmd, bint, 0444);
 MODULE_PARM_DESC(single_cmd, "Use single command to communicate with codecs "
 		 "(for debugging only).");
 module_param(enable_msi, bint, 0444);
 MODULE_PARM_DESC(enable_msi, "Enable Message Signaled Interrupt (MSI)");
+module_param(period_steering, bool, 0444);
+MODULE_PARM_DESC(period_steering, "Process PCM periods on the CPU of the stream user.");
+module_param(position_fix_calibrate, bool, 0444);
+MODULE_PARM_DESC(position_fix_calibrate, "Measure the DMA pointer read methods on the first streams when position_fix is not given.");
 #ifdef CONFIG_SND_HDA_PATCH_LOADER
 module_param_array(patch, charp, NULL, 0444);
 MODULE_PARM_DESC(patch, "Patch file for Intel HD audio interface.");
@@ -193,8 +205,17 @@ MODULE_PARM_DESC(power_save, "Automatic power-saving timeout "
 static bool power_save_controller = 1;
 module_param(power_save_controller, bool, 0644);
 MODULE_PARM_DESC(power_save_controller, "Reset controller in power save mode.");
+
+/* max. timeout the power-saving may be stretched to when the streams are
+ * reopened regularly
+ */
+static unsigned int power_save_adaptive;
+module_param(power_save_adaptive, uint, 0444);
+MODULE_PARM_DESC(power_save_adaptive, "Max. power-saving timeout adapted to "
+		 "the stream reopen history (in second, 0 = disable).");
 #else
 #define power_save	0
+#define power_save_adaptive	0
 #endif /* CONFIG_PM */
 
 static int align_buffer_size = -1;
@@ -427,24 +448,12 @@ static inline void mark_pages_wc(struct azx *chip, struct snd_dma_buffer *buf,
 {
 	__mark_pages_wc(chip, buf, on);
 }
-static inline void mark_runtime_wc(struct azx *chip, struct azx_dev *azx_dev,
-				   struct snd_pcm_substream *substream, bool on)
-{
-	if (azx_dev->wc_marked != on) {
-		__mark_pages_wc(chip, snd_pcm_get_dma_buf(substream), on);
-		azx_dev->wc_marked = on;
-	}
-}
 #else
 /* NOP for other archs */
 static inline void mark_pages_wc(struct azx *chip, struct snd_dma_buffer *buf,
 				 bool on)
 {
 }
-static inline void mark_runtime_wc(struct azx *chip, struct azx_dev *azx_dev,
-				   struct snd_pcm_substream *substream, bool on)
-{
-}
 #endif
 
 static int azx_acquire_irq(struct azx *chip, int do_disconnect);
@@ -695,6 +704,7 @@ static int azx_get_delay_from_lpib(struct azx *chip, struct azx_dev *azx_dev,
 }
 
 static int azx_position_ok(struct azx *chip, struct azx_dev *azx_dev);
+static void azx_posfix_sample(struct azx *chip, struct azx_dev *azx_dev);
 
 /* called from IRQ */
 static int azx_position_check(struct azx *chip, struct azx_dev *azx_dev)
@@ -709,7 +719,12 @@ static int azx_position_check(struct azx *chip, struct azx_dev *azx_dev)
 	} else if (ok == 0) {
 		/* bogus IRQ, process it later */
 		azx_dev->irq_pending = 1;
+		azx_dev->delayed_periods++;
+		trace_azx_irq_deferred(chip, azx_dev, 0);
 		schedule_work(&hda->irq_pending_work);
+	} else {
+		azx_dev->early_irqs++;
+		trace_azx_irq_early(chip, azx_dev, 0);
 	}
 	return 0;
 }
@@ -742,9 +757,12 @@ static int azx_position_ok(struct azx *chip, struct azx_dev *azx_dev)
 	if (wallclk < (azx_dev->core.period_wallclk * 2) / 3)
 		return -1;	/* bogus (too early) interrupt */
 
-	if (chip->get_position[stream])
+	if (chip->get_position[stream]) {
 		pos = chip->get_position[stream](chip, azx_dev);
-	else { /* use the position buffer as default */
+		/* keep validating the position buffer if it's used */
+		if (chip->posbuf_trusted[stream])
+			azx_posbuf_check(chip, azx_dev, pos);
+	} else { /* use the position buffer as default */
 		pos = azx_get_pos_posbuf(chip, azx_dev);
 		if (!pos || pos == (u32)-1) {
 			dev_info(chip->card->dev,
@@ -773,6 +791,7 @@ static int azx_position_ok(struct azx *chip, struct azx_dev *azx_dev)
 		/* NG - it's below the first next period boundary */
 		return chip->bdl_pos_adj ? 0 : -1;
 	azx_dev->core.start_wallclk += wallclk;
+	azx_posfix_sample(chip, azx_dev);
 	return 1; /* OK, it's fine */
 }
 
@@ -785,6 +804,7 @@ static void azx_irq_pending_work(struct work_struct *work)
 	struct azx *chip = &hda->chip;
 	struct hdac_bus *bus = azx_bus(chip);
 	struct hdac_stream *s;
+	unsigned int retries = 0;
 	int pending, ok;
 
 	if (!hda->irq_pending_warned) {
@@ -806,8 +826,9 @@ static void azx_irq_pending_work(struct work_struct *work)
 			ok = azx_position_ok(chip, azx_dev);
 			if (ok > 0) {
 				azx_dev->irq_pending = 0;
+				trace_azx_irq_delayed(chip, azx_dev, retries);
 				spin_unlock(&bus->reg_lock);
-				snd_pcm_period_elapsed(s->substream);
+				azx_period_elapsed(chip, azx_dev);
 				spin_lock(&bus->reg_lock);
 			} else if (ok < 0) {
 				pending = 0;	/* too early */
@@ -817,6 +838,7 @@ static void azx_irq_pending_work(struct work_struct *work)
 		spin_unlock_irq(&bus->reg_lock);
 		if (!pending)
 			return;
+		retries++;
 		msleep(1);
 	}
 }
@@ -850,6 +872,7 @@ static int azx_acquire_irq(struct azx *chip, int do_disconnect)
 		return -1;
 	}
 	bus->irq = chip->pci->irq;
+	snd_card_set_irq(chip->card, bus->irq);
 	pci_intx(chip->pci, !chip->msi);
 	return 0;
 }
@@ -936,6 +959,144 @@ static unsigned int azx_get_pos_skl(struct azx *chip, struct azx_dev *azx_dev)
 	return azx_get_pos_posbuf(chip, azx_dev);
 }
 
+/*
+ * position_fix auto-calibration
+ *
+ * At an accepted period interrupt the DMA has just crossed a period
+ * boundary, so a good position read lands close to it.  Without an
+ * explicit position_fix, measure how far LPIB, the position buffer and
+ * DPIB (SKL+ playback) are off during the first periods, switch to the
+ * best one, and remember it per PCI SSID.  The result is exposed via the
+ * card's position_fix sysfs file; writing it back (or passing it as the
+ * position_fix option) restores it on the next boot.
+ */
+#define AZX_POSFIX_SAMPLES	64
+
+/* in the order of preference when the errors are equal */
+enum {
+	POSFIX_METHOD_POSBUF,
+	POSFIX_METHOD_DPIB,
+	POSFIX_METHOD_LPIB,
+	POSFIX_METHOD_NUM,
+};
+
+static const int posfix_method_fix[POSFIX_METHOD_NUM] = {
+	[POSFIX_METHOD_POSBUF] = POS_FIX_POSBUF,
+	[POSFIX_METHOD_DPIB] = POS_FIX_SKL,
+	[POSFIX_METHOD_LPIB] = POS_FIX_LPIB,
+};
+
+/* calibrated or user-given methods, kept over the card re-probes */
+static struct {
+	bool used;
+	u32 ssid;
+	int fix;
+} posfix_cache[SNDRV_CARDS];
+static DEFINE_SPINLOCK(posfix_cache_lock);
+
+static u32 azx_ssid(struct azx *chip)
+{
+	return (chip->pci->subsystem_vendor << 16) | chip->pci->subsystem_device;
+}
+
+static int posfix_cache_lookup(u32 ssid)
+{
+	unsigned long flags;
+	int i, fix = -1;
+
+	spin_lock_irqsave(&posfix_cache_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(posfix_cache); i++) {
+		if (posfix_cache[i].used && posfix_cache[i].ssid == ssid) {
+			fix = posfix_cache[i].fix;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&posfix_cache_lock, flags);
+	return fix;
+}
+
+static void posfix_cache_store(u32 ssid, int fix)
+{
+	unsigned long flags;
+	int i, slot = -1;
+
+	spin_lock_irqsave(&posfix_cache_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(posfix_cache); i++) {
+		if (posfix_cache[i].used && posfix_cache[i].ssid == ssid) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 && !posfix_cache[i].used)
+			slot = i;
+	}
+	if (slot < 0)
+		slot = 0; /* full; overwrite the first entry */
+	posfix_cache[slot].used = true;
+	posfix_cache[slot].ssid = ssid;
+	posfix_cache[slot].fix = fix;
+	spin_unlock_irqrestore(&posfix_cache_lock, flags);
+}
+
+/* distance of the read position from the nearest period boundary */
+static unsigned int posfix_error(struct azx_dev *azx_dev, unsigned int pos)
+{
+	unsigned int period = azx_dev->core.period_bytes;
+
+	if (pos >= azx_dev->core.bufsize)
+		return period / 2; /* bogus */
+	pos %= period;
+	return min(pos, period - pos);
+}
+
+static void assign_position_fix(struct azx *chip, int fix);
+
+/* called from azx_position_ok() with reg_lock held */
+static void azx_posfix_sample(struct azx *chip, struct azx_dev *azx_dev)
+{
+	struct hda_intel *hda = container_of(chip, struct hda_intel, chip);
+	unsigned int period = azx_dev->core.period_bytes;
+	unsigned int lpib, pos;
+	int i, best;
+
+	if (!hda->posfix_calibrate ||
+	    azx_dev->core.substream->stream != SNDRV_PCM_STREAM_PLAYBACK)
+		return;
+
+	lpib = azx_get_pos_lpib(chip, azx_dev);
+	hda->posfix_err[POSFIX_METHOD_LPIB] += posfix_error(azx_dev, lpib);
+
+	pos = azx_get_pos_posbuf(chip, azx_dev);
+	/* a dead position buffer keeps reading zero */
+	if (!azx_bus(chip)->use_posbuf || (!pos && lpib >= period))
+		pos = (u32)-1;
+	hda->posfix_err[POSFIX_METHOD_POSBUF] += posfix_error(azx_dev, pos);
+
+	if (chip->driver_type == AZX_DRIVER_SKL)
+		pos = azx_skl_get_dpib_pos(chip, azx_dev);
+	else
+		pos = (u32)-1;
+	hda->posfix_err[POSFIX_METHOD_DPIB] += posfix_error(azx_dev, pos);
+
+	if (++hda->posfix_samples < AZX_POSFIX_SAMPLES)
+		return;
+
+	hda->posfix_calibrate = 0;
+	best = 0;
+	for (i = 1; i < POSFIX_METHOD_NUM; i++)
+		if (hda->posfix_err[i] < hda->posfix_err[best])
+			best = i;
+
+	dev_info(chip->card->dev,
+		 "position_fix calibrated to %d (errors: posbuf %llu, dpib %llu, lpib %llu)\n",
+		 posfix_method_fix[best],
+		 div_u64(hda->posfix_err[POSFIX_METHOD_POSBUF], AZX_POSFIX_SAMPLES),
+		 div_u64(hda->posfix_err[POSFIX_METHOD_DPIB], AZX_POSFIX_SAMPLES),
+		 div_u64(hda->posfix_err[POSFIX_METHOD_LPIB], AZX_POSFIX_SAMPLES));
+
+	posfix_cache_store(azx_ssid(chip), posfix_method_fix[best]);
+	assign_position_fix(chip, posfix_method_fix[best]);
+}
+
 #ifdef CONFIG_PM
 static DEFINE_MUTEX(card_list_lock);
 static LIST_HEAD(card_list);
@@ -1007,6 +1168,7 @@ static int azx_suspend(struct device *dev)
 	azx_stop_chip(chip);
 	azx_enter_link_reset(chip);
 	if (bus->irq >= 0) {
+		snd_card_set_irq(chip->card, -1);
 		free_irq(bus->irq, chip);
 		bus->irq = -1;
 	}
@@ -1363,8 +1525,10 @@ static int azx_free(struct azx *chip)
 		azx_stop_chip(chip);
 	}
 
-	if (bus->irq >= 0)
+	if (bus->irq >= 0) {
+		snd_card_set_irq(chip->card, -1);
 		free_irq(bus->irq, (void*)chip);
+	}
 	if (chip->msi)
 		pci_disable_msi(chip->pci);
 	iounmap(bus->remap_addr);
@@ -1378,7 +1542,7 @@ static int azx_free(struct azx *chip)
 
 	pci_disable_device(chip->pci);
 #ifdef CONFIG_SND_HDA_PATCH_LOADER
-	release_firmware(chip->fw);
+	snd_hda_patch_free(chip->patch);
 #endif
 
 	if (chip->driver_caps & AZX_DCAPS_I915_POWERWELL) {
@@ -1489,6 +1653,13 @@ static int check_position_fix(struct azx *chip, int fix)
 		return q->value;
 	}
 
+	fix = posfix_cache_lookup(azx_ssid(chip));
+	if (fix >= 0) {
+		dev_dbg(chip->card->dev, "Using calibrated position fix %d\n",
+			fix);
+		return fix;
+	}
+
 	/* Check VIA/ATI HD Audio Controller exist */
 	if (chip->driver_type == AZX_DRIVER_VIA) {
 		dev_dbg(chip->card->dev, "Using VIACOMBO position fix\n");
@@ -1498,6 +1669,9 @@ static int check_position_fix(struct azx *chip, int fix)
 		dev_dbg(chip->card->dev, "Using LPIB position fix\n");
 		return POS_FIX_LPIB;
 	}
+	/* only the generic defaults are refined at runtime */
+	container_of(chip, struct hda_intel, chip)->posfix_calibrate =
+		position_fix_calibrate;
 	if (chip->driver_type == AZX_DRIVER_SKL) {
 		dev_dbg(chip->card->dev, "Using SKL position fix\n");
 		return POS_FIX_SKL;
@@ -1507,6 +1681,8 @@ static int check_position_fix(struct azx *chip, int fix)
 
 static void assign_position_fix(struct azx *chip, int fix)
 {
+	struct hda_intel *hda = container_of(chip, struct hda_intel, chip);
+	struct hdac_stream *s;
 	static azx_get_pos_callback_t callbacks[] = {
 		[POS_FIX_AUTO] = NULL,
 		[POS_FIX_LPIB] = azx_get_pos_lpib,
@@ -1516,12 +1692,25 @@ static void assign_position_fix(struct azx *chip, int fix)
 		[POS_FIX_SKL] = azx_get_pos_skl,
 	};
 
+	hda->position_fix = fix;
 	chip->get_position[0] = chip->get_position[1] = callbacks[fix];
+	chip->get_delay[0] = chip->get_delay[1] = NULL;
 
 	/* combo mode uses LPIB only for playback */
 	if (fix == POS_FIX_COMBO)
 		chip->get_position[1] = NULL;
 
+	/* the register reads may be replaced by the position buffer once
+	 * it proves to be consistent, except for the explicit fixes;
+	 * SKL capture reads the position buffer already
+	 */
+	chip->posbuf_learn[0] = fix == POS_FIX_AUTO || fix == POS_FIX_SKL;
+	chip->posbuf_learn[1] = fix == POS_FIX_AUTO;
+	/* ... which has to be proven again with the new method */
+	chip->posbuf_trusted[0] = chip->posbuf_trusted[1] = false;
+	list_for_each_entry(s, &azx_bus(chip)->stream_list, list)
+		stream_to_azx_dev(s)->posbuf_checks = 0;
+
 	if ((fix == POS_FIX_POSBUF || fix == POS_FIX_SKL) &&
 	    (chip->driver_caps & AZX_DCAPS_COUNT_LPIB_DELAY)) {
 		chip->get_delay[0] = chip->get_delay[1] =
@@ -1530,6 +1719,53 @@ static void assign_position_fix(struct azx *chip, int fix)
 
 }
 
+/* position_fix sysfs file of the card: "<fix> <ssid>" */
+static ssize_t position_fix_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct snd_card *card = container_of(dev, struct snd_card, card_dev);
+	struct azx *chip = card->private_data;
+	struct hda_intel *hda = container_of(chip, struct hda_intel, chip);
+
+	return sprintf(buf, "%d %08x%s\n", hda->position_fix, azx_ssid(chip),
+		       hda->posfix_calibrate ? " calibrating" : "");
+}
+
+static ssize_t position_fix_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct snd_card *card = container_of(dev, struct snd_card, card_dev);
+	struct azx *chip = card->private_data;
+	struct hda_intel *hda = container_of(chip, struct hda_intel, chip);
+	struct hdac_bus *bus = azx_bus(chip);
+	int fix, err;
+
+	err = kstrtoint(buf, 0, &fix);
+	if (err < 0)
+		return err;
+	if (fix < POS_FIX_AUTO || fix > POS_FIX_SKL)
+		return -EINVAL;
+
+	posfix_cache_store(azx_ssid(chip), fix);
+	spin_lock_irq(&bus->reg_lock);
+	hda->posfix_calibrate = 0;
+	assign_position_fix(chip, fix);
+	spin_unlock_irq(&bus->reg_lock);
+	return count;
+}
+
+static DEVICE_ATTR_RW(position_fix);
+
+static struct attribute *azx_card_attrs[] = {
+	&dev_attr_position_fix.attr,
+	NULL
+};
+
+static const struct attribute_group azx_card_attr_group = {
+	.attrs = azx_card_attrs,
+};
+
 /*
  * black-lists for probe_mask
  */
@@ -1718,6 +1954,8 @@ static int azx_create(struct snd_card *card, struct pci_dev *pci,
 	check_msi(chip);
 	chip->dev_index = dev;
 	chip->jackpoll_ms = jackpoll_ms;
+	chip->jackpoll_max_ms = jackpoll_max_ms;
+	chip->period_steering = period_steering;
 	INIT_LIST_HEAD(&chip->pcm_list);
 	INIT_WORK(&hda->irq_pending_work, azx_irq_pending_work);
 	INIT_LIST_HEAD(&hda->list);
@@ -1725,6 +1963,7 @@ static int azx_create(struct snd_card *card, struct pci_dev *pci,
 	init_completion(&hda->probe_wait);
 
 	assign_position_fix(chip, check_position_fix(chip, position_fix[dev]));
+	snd_card_add_dev_attr(card, &azx_card_attr_group);
 
 	check_probe_mask(chip, dev);
 
@@ -1739,6 +1978,7 @@ static int azx_create(struct snd_card *card, struct pci_dev *pci,
 		chip->bdl_pos_adj = default_bdl_pos_adj(chip);
 	else
 		chip->bdl_pos_adj = bdl_pos_adj[dev];
+	chip->bdl_subperiods = bdl_subperiods[dev];
 
 	err = azx_bus_init(chip, model[dev], &pci_hda_io_ops);
 	if (err < 0) {
@@ -1964,7 +2204,16 @@ static void azx_firmware_cb(const struct firmware *fw, void *context)
 		goto error;
 	}
 
-	chip->fw = fw;
+	/* compile the patch here, off the probe path; the file itself isn't
+	 * needed any longer
+	 */
+	chip->patch = snd_hda_patch_compile(fw->size, fw->data);
+	release_firmware(fw);
+	if (IS_ERR(chip->patch)) {
+		dev_err(card->dev, "Cannot parse firmware, aborting\n");
+		chip->patch = NULL;
+		goto error;
+	}
 	if (!chip->disabled) {
 		/* continue probing */
 		if (azx_probe_continue(chip))
@@ -2018,6 +2267,7 @@ static int disable_msi_reset_irq(struct azx *chip)
 	struct hdac_bus *bus = azx_bus(chip);
 	int err;
 
+	snd_card_set_irq(chip->card, -1);
 	free_irq(bus->irq, chip);
 	bus->irq = -1;
 	pci_disable_msi(chip->pci);
@@ -2059,36 +2309,30 @@ static int substream_alloc_pages(struct azx *chip,
 				 struct snd_pcm_substream *substream,
 				 size_t size)
 {
-	struct azx_dev *azx_dev = get_azx_dev(substream);
 	int ret;
 
-	mark_runtime_wc(chip, azx_dev, substream, false);
+	/* C-Media doesn't need the non-snooped PCM buffers; the non-x86
+	 * platforms handle the snoop-less DMA in the DMA API
+	 */
+	if (IS_ENABLED(CONFIG_X86) && !azx_snoop(chip) &&
+	    chip->driver_type != AZX_DRIVER_CMEDIA)
+		snd_pcm_set_buffer_policy(substream,
+					  SNDRV_PCM_BUFFER_POLICY_WC);
+	else
+		snd_pcm_set_buffer_policy(substream,
+					  SNDRV_PCM_BUFFER_POLICY_CACHED);
 	ret = snd_pcm_lib_malloc_pages(substream, size);
 	if (ret < 0)
 		return ret;
-	mark_runtime_wc(chip, azx_dev, substream, true);
 	return 0;
 }
 
 static int substream_free_pages(struct azx *chip,
 				struct snd_pcm_substream *substream)
 {
-	struct azx_dev *azx_dev = get_azx_dev(substream);
-	mark_runtime_wc(chip, azx_dev, substream, false);
 	return snd_pcm_lib_free_pages(substream);
 }
 
-static void pcm_mmap_prepare(struct snd_pcm_substream *substream,
-			     struct vm_area_struct *area)
-{
-#ifdef CONFIG_X86
-	struct azx_pcm *apcm = snd_pcm_substream_chip(substream);
-	struct azx *chip = apcm->chip;
-	if (!azx_snoop(chip) && chip->driver_type != AZX_DRIVER_CMEDIA)
-		area->vm_page_prot = pgprot_writecombine(area->vm_page_prot);
-#endif
-}
-
 static const struct hdac_io_ops pci_hda_io_ops = {
 	.reg_writel = pci_azx_writel,
 	.reg_readl = pci_azx_readl,
@@ -2104,7 +2348,6 @@ static const struct hda_controller_ops pci_hda_ops = {
 	.disable_msi_reset_irq = disable_msi_reset_irq,
 	.substream_alloc_pages = substream_alloc_pages,
 	.substream_free_pages = substream_free_pages,
-	.pcm_mmap_prepare = pcm_mmap_prepare,
 	.position_check = azx_position_check,
 	.link_power = azx_intel_link_power,
 };
@@ -2255,14 +2498,11 @@ static int azx_probe_continue(struct azx *chip)
 		goto out_free;
 
 #ifdef CONFIG_SND_HDA_PATCH_LOADER
-	if (chip->fw) {
-		err = snd_hda_load_patch(&chip->bus, chip->fw->size,
-					 chip->fw->data);
-		if (err < 0)
-			goto out_free;
+	if (chip->patch) {
+		snd_hda_patch_apply(&chip->bus, chip->patch);
 #ifndef CONFIG_PM
-		release_firmware(chip->fw); /* no longer needed */
-		chip->fw = NULL;
+		snd_hda_patch_free(chip->patch); /* no longer needed */
+		chip->patch = NULL;
 #endif
 	}
 #endif
@@ -2278,6 +2518,7 @@ static int azx_probe_continue(struct azx *chip)
 
 	chip->running = 1;
 	azx_add_card_list(chip);
+	chip->bus.power_save_adaptive = power_save_adaptive * 1000;
 	snd_hda_set_power_save(&chip->bus, power_save * 1000);
 	if (azx_has_pm_runtime(chip) || hda->use_vga_switcheroo)
 		pm_runtime_put_autosuspend(&pci->dev);
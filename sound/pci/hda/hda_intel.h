@@ -35,6 +35,12 @@ struct hda_intel {
 	unsigned int irq_pending_warned:1;
 	unsigned int probe_continued:1;
 
+	/* position_fix auto-calibration */
+	int position_fix;		/* POS_FIX_* in use */
+	unsigned int posfix_calibrate:1;
+	unsigned int posfix_samples;
+	u64 posfix_err[3];		/* accumulated error per method */
+
 	/* vga_switcheroo setup */
 	unsigned int use_vga_switcheroo:1;
 	unsigned int vga_switcheroo_registered:1;
@@ -46,6 +46,47 @@ DEFINE_EVENT(hda_pm, azx_runtime_resume,
 );
 #endif
 
+DECLARE_EVENT_CLASS(azx_position_fixup,
+	TP_PROTO(struct azx *chip, struct azx_dev *azx_dev, unsigned int retries),
+
+	TP_ARGS(chip, azx_dev, retries),
+
+	TP_STRUCT__entry(
+		__field(int, card)
+		__field(int, idx)
+		__field(unsigned int, pos)
+		__field(unsigned int, retries)
+	),
+
+	TP_fast_assign(
+		__entry->card = (chip)->card->number;
+		__entry->idx = (azx_dev)->core.index;
+		__entry->pos = snd_hdac_stream_get_pos_lpib(&(azx_dev)->core);
+		__entry->retries = retries;
+	),
+
+	TP_printk("[%d:%d] lpib=%u retries=%u", __entry->card, __entry->idx,
+		  __entry->pos, __entry->retries)
+);
+
+/* IRQ ignored as it came before the period boundary */
+DEFINE_EVENT(azx_position_fixup, azx_irq_early,
+	TP_PROTO(struct azx *chip, struct azx_dev *azx_dev, unsigned int retries),
+	TP_ARGS(chip, azx_dev, retries)
+);
+
+/* period deferred to the irq_pending work for bdl_pos_adj */
+DEFINE_EVENT(azx_position_fixup, azx_irq_deferred,
+	TP_PROTO(struct azx *chip, struct azx_dev *azx_dev, unsigned int retries),
+	TP_ARGS(chip, azx_dev, retries)
+);
+
+/* deferred period finally reported by the irq_pending work */
+DEFINE_EVENT(azx_position_fixup, azx_irq_delayed,
+	TP_PROTO(struct azx *chip, struct azx_dev *azx_dev, unsigned int retries),
+	TP_ARGS(chip, azx_dev, retries)
+);
+
 #endif /* _TRACE_HDA_INTEL_H */
 
 /* This part must be outside protection */
@@ -551,8 +551,9 @@ EXPORT_SYMBOL_GPL(snd_hda_jack_unsol_event);
  *
  * Poll all detectable jacks with dirty flag, update the status, call
  * callbacks and call snd_hda_jack_report_sync() if any changes are found.
+ * Returns true if any jack was changed.
  */
-void snd_hda_jack_poll_all(struct hda_codec *codec)
+bool snd_hda_jack_poll_all(struct hda_codec *codec)
 {
 	struct hda_jack_tbl *jack = codec->jacktbl.list;
 	int i, changes = 0;
@@ -570,6 +571,7 @@ void snd_hda_jack_poll_all(struct hda_codec *codec)
 	}
 	if (changes)
 		snd_hda_jack_report_sync(codec);
+	return changes;
 }
 EXPORT_SYMBOL_GPL(snd_hda_jack_poll_all);
 
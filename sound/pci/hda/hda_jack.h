@@ -90,6 +90,6 @@ void snd_hda_jack_report_sync(struct hda_codec *codec);
 
 void snd_hda_jack_unsol_event(struct hda_codec *codec, unsigned int res);
 
-void snd_hda_jack_poll_all(struct hda_codec *codec);
+bool snd_hda_jack_poll_all(struct hda_codec *codec);
 
 #endif /* __SOUND_HDA_JACK_H */
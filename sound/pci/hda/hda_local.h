@@ -489,8 +489,10 @@ static inline void snd_hda_override_wcaps(struct hda_codec *codec,
 					  hda_nid_t nid, u32 val)
 {
 	if (nid >= codec->core.start_nid &&
-	    nid < codec->core.start_nid + codec->core.num_nodes)
+	    nid < codec->core.start_nid + codec->core.num_nodes) {
 		codec->wcaps[nid - codec->core.start_nid] = val;
+		codec->conn_serial++;
+	}
 }
 
 u32 query_amp_caps(struct hda_codec *codec, hda_nid_t nid, int direction);
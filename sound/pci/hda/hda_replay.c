@@ -0,0 +1,623 @@
+/*
+ * HD-audio verb trace replay bus
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/dma-mapping.h>
+#include <linux/firmware.h>
+#include <linux/pm_runtime.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/delay.h>
+#include <sound/core.h>
+#include <sound/info.h>
+#include <sound/initval.h>
+#include "hda_codec.h"
+#include "hda_controller.h"
+
+/*
+
+  Verb trace replay
+
+  This driver creates a card with an HD-audio bus that has no controller
+  behind it.  The codec responses are taken from a trace recorded on a
+  real machine, so the codec drivers, the generic parser and the regmap
+  sync run as on the hardware and can be timed and profiled anywhere.
+
+  The trace is a text file loaded as firmware, one verb per line with
+  the command and its response in hex:
+
+	0x000f0000 0x10ec0269
+
+  Lines with "cmd=... res=..." are accepted as well, so the output of
+  the hda_controller:azx_get_response tracepoint can be fed in as is.
+  Empty lines and lines starting with '#' are skipped.
+
+  When a verb was recorded several times, its responses are returned in
+  the recorded order, and the last one is repeated afterwards.  Verbs
+  missing in the trace read as zero and are counted as misses.  Only
+  verbs whose response was read show up in a trace; the others are
+  simply swallowed here.
+
+  The timings of the codec probe and configuration are shown in
+  /proc/asound/cardN/replay.  Writing to that file runs the following:
+
+	resume	suspend and resume each codec, timing both
+	rewind	restart the responses from the beginning of the trace
+	reset	clear the statistics
+
+  The PCM devices are created, but there are no streams to open.
+
+ */
+
+MODULE_DESCRIPTION("HD-audio verb trace replay");
+MODULE_LICENSE("GPL");
+
+#define HDA_REPLAY_DRIVER	"snd_hda_replay"
+
+static int index = SNDRV_DEFAULT_IDX1;
+static char *id = SNDRV_DEFAULT_STR1;
+static char *trace = "hda-replay.trace";
+static char *model;
+static unsigned int delay_ns;
+
+module_param(index, int, 0444);
+MODULE_PARM_DESC(index, "Index value for the replay soundcard.");
+module_param(id, charp, 0444);
+MODULE_PARM_DESC(id, "ID string for the replay soundcard.");
+module_param(trace, charp, 0444);
+MODULE_PARM_DESC(trace, "Firmware file containing the verb trace.");
+module_param(model, charp, 0444);
+MODULE_PARM_DESC(model, "Use the given board model.");
+module_param(delay_ns, uint, 0644);
+MODULE_PARM_DESC(delay_ns, "Emulated link turnaround per verb in ns.");
+
+struct replay_verb {
+	u32 cmd;
+	unsigned int first;	/* index of the first response */
+	unsigned int count;	/* number of recorded responses */
+	unsigned int pos;	/* next response to return */
+};
+
+struct replay_stats {
+	unsigned long cmds;	/* verbs sent */
+	unsigned long reads;	/* responses read */
+	unsigned long misses;	/* responses not in the trace */
+};
+
+struct hda_replay {
+	struct azx chip;	/* the codec layer expects an azx bus */
+
+	struct replay_verb *verbs;	/* sorted by cmd */
+	unsigned int num_verbs;
+	u32 *responses;
+	unsigned int num_responses;
+
+	u32 last_cmd[HDA_MAX_CODECS];
+	struct replay_stats stats;
+
+	/* timings */
+	u64 probe_ns;
+	u64 configure_ns;
+	struct replay_stats probe_stats;
+	struct replay_stats configure_stats;
+	u64 suspend_ns;
+	u64 resume_ns;
+	struct replay_stats resume_stats;
+	unsigned int resume_runs;
+
+	struct mutex mutex;	/* for the proc commands */
+};
+
+#define bus_to_replay(_bus) \
+	container_of(bus_to_azx(_bus), struct hda_replay, chip)
+
+static struct platform_device *replay_device;
+
+/*
+ * trace parser
+ */
+struct replay_pair {
+	u32 cmd;
+	u32 res;
+	unsigned int seq;
+};
+
+static int replay_pair_cmp(const void *a, const void *b)
+{
+	const struct replay_pair *pa = a, *pb = b;
+
+	if (pa->cmd != pb->cmd)
+		return pa->cmd < pb->cmd ? -1 : 1;
+	return pa->seq < pb->seq ? -1 : pa->seq > pb->seq;
+}
+
+/* parse a line into cmd and res; returns false for the lines to skip */
+static bool replay_parse_line(const char *line, u32 *cmd, u32 *res)
+{
+	const char *p;
+
+	line = skip_spaces(line);
+	if (!*line || *line == '#')
+		return false;
+	p = strstr(line, "cmd=");
+	if (p)
+		return sscanf(p, "cmd=%x res=%x", cmd, res) == 2;
+	return sscanf(line, "%x %x", cmd, res) == 2;
+}
+
+/* returns the number of verbs parsed, or fills @pairs if non-NULL */
+static unsigned int replay_parse(const struct firmware *fw,
+				 struct replay_pair *pairs)
+{
+	const char *p = fw->data, *end = p + fw->size;
+	unsigned int num = 0;
+	char line[128];
+	size_t len;
+	u32 cmd, res;
+
+	while (p < end) {
+		for (len = 0; p + len < end && p[len] != '\n'; len++)
+			;
+		memcpy(line, p, min(len, sizeof(line) - 1));
+		line[min(len, sizeof(line) - 1)] = 0;
+		p += len + 1;
+		if (!replay_parse_line(line, &cmd, &res))
+			continue;
+		if (pairs) {
+			pairs[num].cmd = cmd;
+			pairs[num].res = res;
+			pairs[num].seq = num;
+		}
+		num++;
+	}
+	return num;
+}
+
+static int replay_load_trace(struct hda_replay *replay, struct device *dev)
+{
+	const struct firmware *fw;
+	struct replay_pair *pairs;
+	struct replay_verb *verb = NULL;
+	unsigned int i, num;
+	int err;
+
+	err = request_firmware(&fw, trace, dev);
+	if (err < 0) {
+		dev_err(dev, "cannot load the trace '%s'\n", trace);
+		return err;
+	}
+
+	num = replay_parse(fw, NULL);
+	if (!num) {
+		dev_err(dev, "no verbs in the trace '%s'\n", trace);
+		err = -EINVAL;
+		goto out;
+	}
+	pairs = vmalloc(num * sizeof(*pairs));
+	replay->responses = vmalloc(num * sizeof(u32));
+	replay->verbs = vzalloc(num * sizeof(*replay->verbs));
+	if (!pairs || !replay->responses || !replay->verbs) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+	replay_parse(fw, pairs);
+	sort(pairs, num, sizeof(*pairs), replay_pair_cmp, NULL);
+
+	for (i = 0; i < num; i++) {
+		if (!verb || verb->cmd != pairs[i].cmd) {
+			verb = &replay->verbs[replay->num_verbs++];
+			verb->cmd = pairs[i].cmd;
+			verb->first = i;
+		}
+		verb->count++;
+		replay->responses[i] = pairs[i].res;
+	}
+	replay->num_responses = num;
+	dev_info(dev, "%u responses for %u verbs loaded from '%s'\n",
+		 num, replay->num_verbs, trace);
+
+ out_free:
+	vfree(pairs);
+ out:
+	release_firmware(fw);
+	return err;
+}
+
+static int replay_verb_cmp(const void *key, const void *elt)
+{
+	u32 cmd = *(const u32 *)key;
+	const struct replay_verb *verb = elt;
+
+	if (cmd == verb->cmd)
+		return 0;
+	return cmd < verb->cmd ? -1 : 1;
+}
+
+static struct replay_verb *replay_find(struct hda_replay *replay, u32 cmd)
+{
+	return bsearch(&cmd, replay->verbs, replay->num_verbs,
+		       sizeof(*replay->verbs), replay_verb_cmp);
+}
+
+static void replay_rewind(struct hda_replay *replay)
+{
+	unsigned int i;
+
+	for (i = 0; i < replay->num_verbs; i++)
+		replay->verbs[i].pos = 0;
+}
+
+/*
+ * bus ops; called with cmd_mutex held
+ */
+static int replay_send_cmd(struct hdac_bus *bus, unsigned int val)
+{
+	struct hda_replay *replay = bus_to_replay(bus);
+	unsigned int addr = val >> 28;
+
+	if (addr >= HDA_MAX_CODECS)
+		return -EINVAL;
+	replay->last_cmd[addr] = val;
+	bus->last_cmd[addr] = val;
+	replay->stats.cmds++;
+	if (delay_ns)
+		ndelay(delay_ns);
+	return 0;
+}
+
+static int replay_get_response(struct hdac_bus *bus, unsigned int addr,
+			       unsigned int *res)
+{
+	struct hda_replay *replay = bus_to_replay(bus);
+	struct replay_verb *verb;
+	u32 val = 0;
+
+	if (addr >= HDA_MAX_CODECS)
+		return -EINVAL;
+	replay->stats.reads++;
+	verb = replay_find(replay, replay->last_cmd[addr]);
+	if (verb) {
+		val = replay->responses[verb->first + verb->pos];
+		if (verb->pos + 1 < verb->count)
+			verb->pos++;
+	} else {
+		if (!replay->stats.misses)
+			dev_dbg(bus->dev, "verb 0x%08x not in the trace\n",
+				replay->last_cmd[addr]);
+		replay->stats.misses++;
+	}
+	if (res)
+		*res = val;
+	return 0;
+}
+
+static const struct hdac_bus_ops replay_bus_ops = {
+	.command = replay_send_cmd,
+	.get_response = replay_get_response,
+};
+
+static const struct hda_controller_ops replay_controller_ops = {
+};
+
+/* the codecs answering the vendor id read in the trace */
+static unsigned int replay_codec_mask(struct hda_replay *replay)
+{
+	struct replay_verb *verb;
+	unsigned int addr, mask = 0;
+	u32 cmd;
+
+	for (addr = 0; addr < HDA_MAX_CODECS; addr++) {
+		cmd = (addr << 28) | (AC_NODE_ROOT << 20) |
+			(AC_VERB_PARAMETERS << 8) | AC_PAR_VENDOR_ID;
+		verb = replay_find(replay, cmd);
+		if (verb && replay->responses[verb->first] != -1)
+			mask |= 1 << addr;
+	}
+	return mask;
+}
+
+/*
+ * timing helpers
+ */
+static void replay_stats_sub(struct replay_stats *d,
+			     const struct replay_stats *a,
+			     const struct replay_stats *b)
+{
+	d->cmds = a->cmds - b->cmds;
+	d->reads = a->reads - b->reads;
+	d->misses = a->misses - b->misses;
+}
+
+#ifdef CONFIG_PM
+static int replay_resume_codecs(struct hda_replay *replay)
+{
+	struct hda_codec *codec;
+	struct replay_stats start, delta;
+	const struct dev_pm_ops *pm;
+	struct device *dev;
+	ktime_t t0, t1, t2;
+	int err = 0;
+
+	start = replay->stats;
+	list_for_each_codec(codec, &replay->chip.bus) {
+		dev = hda_codec_dev(codec);
+		pm = dev->driver ? dev->driver->pm : NULL;
+		if (!pm || !pm->runtime_suspend || !pm->runtime_resume)
+			continue;
+		/* keep the PM core away while calling the callbacks */
+		pm_runtime_get_sync(dev);
+		t0 = ktime_get();
+		err = pm->runtime_suspend(dev);
+		t1 = ktime_get();
+		if (!err)
+			err = pm->runtime_resume(dev);
+		t2 = ktime_get();
+		pm_runtime_put(dev);
+		if (err < 0)
+			return err;
+		replay->suspend_ns += ktime_to_ns(ktime_sub(t1, t0));
+		replay->resume_ns += ktime_to_ns(ktime_sub(t2, t1));
+	}
+	replay_stats_sub(&delta, &replay->stats, &start);
+	replay->resume_stats.cmds += delta.cmds;
+	replay->resume_stats.reads += delta.reads;
+	replay->resume_stats.misses += delta.misses;
+	replay->resume_runs++;
+	return 0;
+}
+#else
+static int replay_resume_codecs(struct hda_replay *replay)
+{
+	return -ENOSYS;
+}
+#endif
+
+/*
+ * proc interface
+ */
+static void replay_show_phase(struct snd_info_buffer *buffer,
+			      const char *name, u64 ns,
+			      const struct replay_stats *stats)
+{
+	snd_iprintf(buffer, "%s: %llu us, %lu verbs, %lu reads, %lu misses\n",
+		    name, div_u64(ns, NSEC_PER_USEC), stats->cmds,
+		    stats->reads, stats->misses);
+}
+
+static void replay_proc_read(struct snd_info_entry *entry,
+			     struct snd_info_buffer *buffer)
+{
+	struct hda_replay *replay = entry->private_data;
+	unsigned int runs;
+
+	mutex_lock(&replay->mutex);
+	snd_iprintf(buffer, "trace: %s, %u responses, %u verbs\n",
+		    trace, replay->num_responses, replay->num_verbs);
+	replay_show_phase(buffer, "probe", replay->probe_ns,
+			  &replay->probe_stats);
+	replay_show_phase(buffer, "configure", replay->configure_ns,
+			  &replay->configure_stats);
+	runs = replay->resume_runs;
+	if (runs) {
+		snd_iprintf(buffer, "suspend: %llu us avg over %u runs\n",
+			    div_u64(replay->suspend_ns, runs * NSEC_PER_USEC),
+			    runs);
+		replay_show_phase(buffer, "resume",
+				  div_u64(replay->resume_ns, runs),
+				  &replay->resume_stats);
+	}
+	snd_iprintf(buffer, "total: %lu verbs, %lu reads, %lu misses\n",
+		    replay->stats.cmds, replay->stats.reads,
+		    replay->stats.misses);
+	mutex_unlock(&replay->mutex);
+}
+
+static void replay_proc_write(struct snd_info_entry *entry,
+			      struct snd_info_buffer *buffer)
+{
+	struct hda_replay *replay = entry->private_data;
+	struct hdac_bus *bus = azx_bus(&replay->chip);
+	char line[64];
+	int err;
+
+	while (!snd_info_get_line(buffer, line, sizeof(line))) {
+		mutex_lock(&replay->mutex);
+		if (!strcmp(line, "resume")) {
+			err = replay_resume_codecs(replay);
+			if (err < 0)
+				dev_err(bus->dev, "resume run failed: %d\n",
+					err);
+		} else if (!strcmp(line, "rewind")) {
+			mutex_lock(&bus->cmd_mutex);
+			replay_rewind(replay);
+			mutex_unlock(&bus->cmd_mutex);
+		} else if (!strcmp(line, "reset")) {
+			memset(&replay->stats, 0, sizeof(replay->stats));
+			memset(&replay->resume_stats, 0,
+			       sizeof(replay->resume_stats));
+			replay->suspend_ns = replay->resume_ns = 0;
+			replay->resume_runs = 0;
+		}
+		mutex_unlock(&replay->mutex);
+	}
+}
+
+/*
+ * card setup
+ */
+static int replay_bus_init(struct hda_replay *replay, struct snd_card *card)
+{
+	struct azx *chip = &replay->chip;
+	struct hda_bus *bus = &chip->bus;
+	int err;
+
+	mutex_init(&chip->open_mutex);
+	INIT_LIST_HEAD(&chip->pcm_list);
+	chip->card = card;
+	chip->ops = &replay_controller_ops;
+	chip->codec_probe_mask = -1;
+
+	err = snd_hdac_bus_init(&bus->core, card->dev, &replay_bus_ops, NULL);
+	if (err < 0)
+		return err;
+	bus->card = card;
+	mutex_init(&bus->prepare_mutex);
+	bus->modelname = model;
+	bus->mixer_assigned = -1;
+	bus->no_response_fallback = 1;
+	bus->core.codec_mask = replay_codec_mask(replay);
+	return 0;
+}
+
+static int replay_create_codecs(struct hda_replay *replay)
+{
+	struct hda_bus *bus = &replay->chip.bus;
+	struct hda_codec *codec, *next;
+	struct replay_stats start;
+	ktime_t t0;
+	int addr, err;
+
+	start = replay->stats;
+	t0 = ktime_get();
+	for (addr = 0; addr < HDA_MAX_CODECS; addr++) {
+		if (!(bus->core.codec_mask & (1 << addr)))
+			continue;
+		err = snd_hda_codec_new(bus, replay->chip.card, addr, &codec);
+		if (err < 0)
+			dev_warn(bus->core.dev, "codec #%d probe error %d\n",
+				 addr, err);
+	}
+	replay->probe_ns = ktime_to_ns(ktime_sub(ktime_get(), t0));
+	replay_stats_sub(&replay->probe_stats, &replay->stats, &start);
+
+	start = replay->stats;
+	t0 = ktime_get();
+	list_for_each_codec_safe(codec, next, bus)
+		snd_hda_codec_configure(codec);
+	replay->configure_ns = ktime_to_ns(ktime_sub(ktime_get(), t0));
+	replay_stats_sub(&replay->configure_stats, &replay->stats, &start);
+
+	if (list_empty(&bus->core.codec_list))
+		return -ENODEV;
+	return 0;
+}
+
+static void replay_card_free(struct snd_card *card)
+{
+	struct hda_replay *replay = card->private_data;
+
+	if (replay->chip.bus.core.dev)
+		snd_hdac_bus_exit(azx_bus(&replay->chip));
+	vfree(replay->verbs);
+	vfree(replay->responses);
+}
+
+static int replay_probe(struct platform_device *pdev)
+{
+	struct snd_card *card;
+	struct hda_replay *replay;
+	struct snd_info_entry *entry;
+	int err;
+
+	err = snd_card_new(&pdev->dev, index, id, THIS_MODULE,
+			   sizeof(*replay), &card);
+	if (err < 0)
+		return err;
+	replay = card->private_data;
+	mutex_init(&replay->mutex);
+	card->private_free = replay_card_free;
+	dma_coerce_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(32));
+
+	strcpy(card->driver, "HDA-Replay");
+	strcpy(card->shortname, "HDA Replay");
+	snprintf(card->longname, sizeof(card->longname),
+		 "HDA Replay of %s", trace);
+
+	err = replay_load_trace(replay, &pdev->dev);
+	if (err < 0)
+		goto error;
+	err = replay_bus_init(replay, card);
+	if (err < 0)
+		goto error;
+	err = replay_create_codecs(replay);
+	if (err < 0)
+		goto error;
+
+	if (!snd_card_proc_new(card, "replay", &entry)) {
+		snd_info_set_text_ops(entry, replay, replay_proc_read);
+		entry->c.text.write = replay_proc_write;
+		entry->mode |= S_IWUSR;
+	}
+
+	err = snd_card_register(card);
+	if (err < 0)
+		goto error;
+	platform_set_drvdata(pdev, card);
+	return 0;
+
+ error:
+	snd_card_free(card);
+	return err;
+}
+
+static int replay_remove(struct platform_device *pdev)
+{
+	snd_card_free(platform_get_drvdata(pdev));
+	return 0;
+}
+
+static struct platform_driver replay_driver = {
+	.probe		= replay_probe,
+	.remove		= replay_remove,
+	.driver		= {
+		.name	= HDA_REPLAY_DRIVER,
+	},
+};
+
+static int __init alsa_card_replay_init(void)
+{
+	int err;
+
+	err = platform_driver_register(&replay_driver);
+	if (err < 0)
+		return err;
+
+	replay_device = platform_device_register_simple(HDA_REPLAY_DRIVER,
+							-1, NULL, 0);
+	if (IS_ERR(replay_device)) {
+		platform_driver_unregister(&replay_driver);
+		return PTR_ERR(replay_device);
+	}
+	if (!platform_get_drvdata(replay_device)) {
+		platform_device_unregister(replay_device);
+		platform_driver_unregister(&replay_driver);
+		return -ENODEV;
+	}
+	return 0;
+}
+
+static void __exit alsa_card_replay_exit(void)
+{
+	platform_device_unregister(replay_device);
+	platform_driver_unregister(&replay_driver);
+}
+
+module_init(alsa_card_replay_init)
+module_exit(alsa_card_replay_exit)
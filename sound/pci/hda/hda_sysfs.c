@@ -13,6 +13,8 @@
 #include <linux/ctype.h>
 #include <linux/string.h>
 #include <linux/export.h>
+#include <linux/jhash.h>
+#include <linux/kref.h>
 #include <sound/core.h>
 #include "hda_codec.h"
 #include "hda_local.h"
@@ -46,8 +48,42 @@ static ssize_t power_off_acct_show(struct device *dev,
 
 static DEVICE_ATTR_RO(power_on_acct);
 static DEVICE_ATTR_RO(power_off_acct);
+
+static ssize_t resume_time_show(struct device *dev,
+				struct device_attribute *attr,
+				char *buf)
+{
+	struct hda_codec *codec = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", codec->resume_time_us);
+}
+
+static DEVICE_ATTR_RO(resume_time);
+
+#define CODEC_PM_SHOW(name, field)				\
+static ssize_t name##_show(struct device *dev,			\
+			   struct device_attribute *attr,	\
+			   char *buf)				\
+{								\
+	struct hda_codec *codec = dev_get_drvdata(dev);		\
+	return sprintf(buf, "%u\n", codec->field);		\
+}								\
+static DEVICE_ATTR_RO(name)
+
+CODEC_PM_SHOW(reopen_interval, pm_reopen_ms);
+CODEC_PM_SHOW(warm_opens, pm_warm_opens);
+CODEC_PM_SHOW(cold_opens, pm_cold_opens);
 #endif /* CONFIG_PM */
 
+static ssize_t probe_time_show(struct device *dev,
+			       struct device_attribute *attr,
+			       char *buf)
+{
+	struct hda_codec *codec = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", codec->probe_time_us);
+}
+
+static DEVICE_ATTR_RO(probe_time);
+
 #define CODEC_INFO_SHOW(type, field)				\
 static ssize_t type##_show(struct device *dev,			\
 			   struct device_attribute *attr,	\
@@ -229,15 +265,11 @@ static ssize_t init_verbs_show(struct device *dev,
 	return len;
 }
 
-static int parse_init_verbs(struct hda_codec *codec, const char *buf)
+static int add_init_verb(struct hda_codec *codec, int nid, int verb,
+			 int param)
 {
 	struct hda_verb *v;
-	int nid, verb, param;
 
-	if (sscanf(buf, "%i %i %i", &nid, &verb, &param) != 3)
-		return -EINVAL;
-	if (!nid || !verb)
-		return -EINVAL;
 	mutex_lock(&codec->user_mutex);
 	v = snd_array_new(&codec->init_verbs);
 	if (!v) {
@@ -251,6 +283,17 @@ static int parse_init_verbs(struct hda_codec *codec, const char *buf)
 	return 0;
 }
 
+static int parse_init_verbs(struct hda_codec *codec, const char *buf)
+{
+	int nid, verb, param;
+
+	if (sscanf(buf, "%i %i %i", &nid, &verb, &param) != 3)
+		return -EINVAL;
+	if (!nid || !verb)
+		return -EINVAL;
+	return add_init_verb(codec, nid, verb, param);
+}
+
 static ssize_t init_verbs_store(struct device *dev,
 				struct device_attribute *attr,
 				const char *buf, size_t count)
@@ -377,18 +420,25 @@ static ssize_t user_pin_configs_show(struct device *dev,
 
 #define MAX_PIN_CONFIGS		32
 
+static int add_user_pin_config(struct hda_codec *codec, int nid, int cfg)
+{
+	int err;
+
+	mutex_lock(&codec->user_mutex);
+	err = snd_hda_add_pincfg(codec, &codec->user_pins, nid, cfg);
+	mutex_unlock(&codec->user_mutex);
+	return err;
+}
+
 static int parse_user_pin_configs(struct hda_codec *codec, const char *buf)
 {
-	int nid, cfg, err;
+	int nid, cfg;
 
 	if (sscanf(buf, "%i %i", &nid, &cfg) != 2)
 		return -EINVAL;
 	if (!nid)
 		return -EINVAL;
-	mutex_lock(&codec->user_mutex);
-	err = snd_hda_add_pincfg(codec, &codec->user_pins, nid, cfg);
-	mutex_unlock(&codec->user_mutex);
-	return err;
+	return add_user_pin_config(codec, nid, cfg);
 }
 
 static ssize_t user_pin_configs_store(struct device *dev,
@@ -533,127 +583,50 @@ static inline int strmatch(const char *a, const char *b)
 	return strncasecmp(a, b, strlen(b)) == 0;
 }
 
-/* parse the contents after the line "[codec]"
- * accept only the line with three numbers, and assign the current codec
- */
-static void parse_codec_mode(char *buf, struct hda_bus *bus,
-			     struct hda_codec **codecp)
-{
-	int vendorid, subid, caddr;
-	struct hda_codec *codec;
-
-	*codecp = NULL;
-	if (sscanf(buf, "%i %i %i", &vendorid, &subid, &caddr) == 3) {
-		list_for_each_codec(codec, bus) {
-			if ((vendorid <= 0 || codec->core.vendor_id == vendorid) &&
-			    (subid <= 0 || codec->core.subsystem_id == subid) &&
-			    codec->core.addr == caddr) {
-				*codecp = codec;
-				break;
-			}
-		}
-	}
-}
-
-/* parse the contents after the other command tags, [pincfg], [verb],
- * [vendor_id], [subsystem_id], [revision_id], [chip_name], [hint] and [model]
- * just pass to the sysfs helper (only when any codec was specified)
- */
-static void parse_pincfg_mode(char *buf, struct hda_bus *bus,
-			      struct hda_codec **codecp)
-{
-	parse_user_pin_configs(*codecp, buf);
-}
-
-static void parse_verb_mode(char *buf, struct hda_bus *bus,
-			    struct hda_codec **codecp)
-{
-	parse_init_verbs(*codecp, buf);
-}
-
-static void parse_hint_mode(char *buf, struct hda_bus *bus,
-			    struct hda_codec **codecp)
-{
-	parse_hints(*codecp, buf);
-}
-
-static void parse_model_mode(char *buf, struct hda_bus *bus,
-			     struct hda_codec **codecp)
-{
-	kfree((*codecp)->modelname);
-	(*codecp)->modelname = kstrdup(buf, GFP_KERNEL);
-}
-
-static void parse_chip_name_mode(char *buf, struct hda_bus *bus,
-				 struct hda_codec **codecp)
-{
-	snd_hda_codec_set_name(*codecp, buf);
-}
-
-#define DEFINE_PARSE_ID_MODE(name) \
-static void parse_##name##_mode(char *buf, struct hda_bus *bus, \
-				 struct hda_codec **codecp) \
-{ \
-	unsigned long val; \
-	if (!kstrtoul(buf, 0, &val)) \
-		(*codecp)->core.name = val; \
-}
-
-DEFINE_PARSE_ID_MODE(vendor_id);
-DEFINE_PARSE_ID_MODE(subsystem_id);
-DEFINE_PARSE_ID_MODE(revision_id);
-
-
 struct hda_patch_item {
 	const char *tag;
 	const char *alias;
-	void (*parser)(char *buf, struct hda_bus *bus, struct hda_codec **retc);
 };
 
-static struct hda_patch_item patch_items[NUM_LINE_MODES] = {
-	[LINE_MODE_CODEC] = {
-		.tag = "[codec]",
-		.parser = parse_codec_mode,
-	},
-	[LINE_MODE_MODEL] = {
-		.tag = "[model]",
-		.parser = parse_model_mode,
-	},
-	[LINE_MODE_VERB] = {
-		.tag = "[verb]",
-		.alias = "[init_verbs]",
-		.parser = parse_verb_mode,
-	},
-	[LINE_MODE_PINCFG] = {
-		.tag = "[pincfg]",
-		.alias = "[user_pin_configs]",
-		.parser = parse_pincfg_mode,
-	},
-	[LINE_MODE_HINT] = {
-		.tag = "[hint]",
-		.alias = "[hints]",
-		.parser = parse_hint_mode
-	},
-	[LINE_MODE_VENDOR_ID] = {
-		.tag = "[vendor_id]",
-		.parser = parse_vendor_id_mode,
-	},
-	[LINE_MODE_SUBSYSTEM_ID] = {
-		.tag = "[subsystem_id]",
-		.parser = parse_subsystem_id_mode,
-	},
-	[LINE_MODE_REVISION_ID] = {
-		.tag = "[revision_id]",
-		.parser = parse_revision_id_mode,
-	},
-	[LINE_MODE_CHIP_NAME] = {
-		.tag = "[chip_name]",
-		.parser = parse_chip_name_mode,
-	},
+static const struct hda_patch_item patch_items[NUM_LINE_MODES] = {
+	[LINE_MODE_CODEC] = { .tag = "[codec]" },
+	[LINE_MODE_MODEL] = { .tag = "[model]" },
+	[LINE_MODE_VERB] = { .tag = "[verb]", .alias = "[init_verbs]" },
+	[LINE_MODE_PINCFG] = { .tag = "[pincfg]", .alias = "[user_pin_configs]" },
+	[LINE_MODE_HINT] = { .tag = "[hint]", .alias = "[hints]" },
+	[LINE_MODE_VENDOR_ID] = { .tag = "[vendor_id]" },
+	[LINE_MODE_SUBSYSTEM_ID] = { .tag = "[subsystem_id]" },
+	[LINE_MODE_REVISION_ID] = { .tag = "[revision_id]" },
+	[LINE_MODE_CHIP_NAME] = { .tag = "[chip_name]" },
 };
 
+/*
+ * The patch text is compiled once into a list of ops with the numbers
+ * already parsed, and the compiled patch is shared by all buses loading
+ * the same file contents.  Applying it to a bus is then only a walk over
+ * the ops.
+ */
+struct hda_patch_op {
+	unsigned char mode;		/* LINE_MODE_XXX */
+	unsigned char nvals;		/* number of valid vals[] */
+	int vals[3];
+	char *str;			/* for [model], [hint] and [chip_name] */
+};
+
+struct hda_patch {
+	struct list_head list;
+	struct kref kref;
+	u32 hash[2];
+	size_t size;
+	unsigned int num_ops;
+	struct hda_patch_op ops[];
+};
+
+static LIST_HEAD(patch_cache);
+static DEFINE_MUTEX(patch_cache_mutex);
+
 /* check the line starting with '[' -- change the parser mode accodingly */
-static int parse_line_mode(char *buf, struct hda_bus *bus)
+static int parse_line_mode(char *buf)
 {
 	int i;
 	for (i = 0; i < ARRAY_SIZE(patch_items); i++) {
@@ -705,29 +678,247 @@ static int get_line_from_fw(char *buf, int size, size_t *fw_size_p,
 	return 1;
 }
 
-/**
- * snd_hda_load_patch - load a "patch" firmware file and parse it
- * @bus: HD-audio bus
- * @fw_size: the firmware byte size
- * @fw_buf: the firmware data
+/* parse the arguments of a line after a command tag;
+ * returns -EINVAL for the lines to be ignored
  */
-int snd_hda_load_patch(struct hda_bus *bus, size_t fw_size, const void *fw_buf)
+static int compile_patch_line(struct hda_patch_op *op, int mode, char *buf)
+{
+	unsigned long val;
+	int n;
+
+	op->mode = mode;
+	switch (mode) {
+	case LINE_MODE_CODEC:
+		/* vendor id, subsystem id and address; a malformed line
+		 * deselects the codec
+		 */
+		if (sscanf(buf, "%i %i %i", &op->vals[0], &op->vals[1],
+			   &op->vals[2]) == 3)
+			op->nvals = 3;
+		return 0;
+	case LINE_MODE_PINCFG:
+		n = sscanf(buf, "%i %i", &op->vals[0], &op->vals[1]);
+		if (n != 2 || !op->vals[0])
+			return -EINVAL;
+		op->nvals = 2;
+		return 0;
+	case LINE_MODE_VERB:
+		n = sscanf(buf, "%i %i %i", &op->vals[0], &op->vals[1],
+			   &op->vals[2]);
+		if (n != 3 || !op->vals[0] || !op->vals[1])
+			return -EINVAL;
+		op->nvals = 3;
+		return 0;
+	case LINE_MODE_VENDOR_ID:
+	case LINE_MODE_SUBSYSTEM_ID:
+	case LINE_MODE_REVISION_ID:
+		if (kstrtoul(buf, 0, &val))
+			return -EINVAL;
+		op->vals[0] = val;
+		op->nvals = 1;
+		return 0;
+	case LINE_MODE_MODEL:
+	case LINE_MODE_HINT:
+	case LINE_MODE_CHIP_NAME:
+		op->str = kstrdup(buf, GFP_KERNEL);
+		return op->str ? 0 : -ENOMEM;
+	}
+	return -EINVAL;
+}
+
+/* returns the number of ops, or a negative error code */
+static int compile_patch(struct hda_patch *patch, size_t fw_size,
+			 const void *fw_buf)
 {
+	struct hda_patch_op *op = patch ? patch->ops : NULL;
 	char buf[128];
-	struct hda_codec *codec;
-	int line_mode;
+	int line_mode, err, num_ops = 0;
 
 	line_mode = LINE_MODE_NONE;
-	codec = NULL;
 	while (get_line_from_fw(buf, sizeof(buf) - 1, &fw_size, &fw_buf)) {
 		if (!*buf || *buf == '#' || *buf == '\n')
 			continue;
-		if (*buf == '[')
-			line_mode = parse_line_mode(buf, bus);
-		else if (patch_items[line_mode].parser &&
-			 (codec || line_mode <= LINE_MODE_CODEC))
-			patch_items[line_mode].parser(buf, bus, &codec);
+		if (*buf == '[') {
+			line_mode = parse_line_mode(buf);
+			continue;
+		}
+		if (line_mode == LINE_MODE_NONE)
+			continue;
+		if (!op) {
+			num_ops++; /* counting pass */
+			continue;
+		}
+		err = compile_patch_line(op, line_mode, buf);
+		if (err == -ENOMEM)
+			return err;
+		if (err < 0)
+			continue;
+		op++;
+		num_ops++;
+	}
+	return num_ops;
+}
+
+static void release_patch(struct kref *kref)
+{
+	struct hda_patch *patch = container_of(kref, struct hda_patch, kref);
+	unsigned int i;
+
+	list_del(&patch->list);
+	for (i = 0; i < patch->num_ops; i++)
+		kfree(patch->ops[i].str);
+	kfree(patch);
+}
+
+/**
+ * snd_hda_patch_compile - compile a "patch" firmware file
+ * @fw_size: the firmware byte size
+ * @fw_buf: the firmware data
+ *
+ * Returns the compiled patch, which is shared with the other users of
+ * the same file contents, or an ERR_PTR.  Release it via
+ * snd_hda_patch_free().
+ */
+struct hda_patch *snd_hda_patch_compile(size_t fw_size, const void *fw_buf)
+{
+	struct hda_patch *patch;
+	u32 hash[2];
+	int num_ops;
+
+	hash[0] = jhash(fw_buf, fw_size, 0);
+	hash[1] = jhash(fw_buf, fw_size, hash[0]);
+
+	mutex_lock(&patch_cache_mutex);
+	list_for_each_entry(patch, &patch_cache, list) {
+		if (patch->size == fw_size && patch->hash[0] == hash[0] &&
+		    patch->hash[1] == hash[1]) {
+			kref_get(&patch->kref);
+			goto unlock;
+		}
+	}
+
+	num_ops = compile_patch(NULL, fw_size, fw_buf);
+	patch = kzalloc(sizeof(*patch) + num_ops * sizeof(patch->ops[0]),
+			GFP_KERNEL);
+	if (!patch) {
+		patch = ERR_PTR(-ENOMEM);
+		goto unlock;
+	}
+	INIT_LIST_HEAD(&patch->list);
+	kref_init(&patch->kref);
+	/* all counted ops, so that an error frees the strings compiled so far */
+	patch->num_ops = num_ops;
+	num_ops = compile_patch(patch, fw_size, fw_buf);
+	if (num_ops < 0) {
+		release_patch(&patch->kref);
+		patch = ERR_PTR(num_ops);
+		goto unlock;
+	}
+	patch->num_ops = num_ops;
+	patch->size = fw_size;
+	memcpy(patch->hash, hash, sizeof(hash));
+	list_add(&patch->list, &patch_cache);
+ unlock:
+	mutex_unlock(&patch_cache_mutex);
+	return patch;
+}
+EXPORT_SYMBOL_GPL(snd_hda_patch_compile);
+
+/**
+ * snd_hda_patch_free - release a compiled patch
+ * @patch: the patch returned from snd_hda_patch_compile()
+ */
+void snd_hda_patch_free(struct hda_patch *patch)
+{
+	if (IS_ERR_OR_NULL(patch))
+		return;
+	if (kref_put_mutex(&patch->kref, release_patch, &patch_cache_mutex))
+		mutex_unlock(&patch_cache_mutex);
+}
+EXPORT_SYMBOL_GPL(snd_hda_patch_free);
+
+static struct hda_codec *find_patch_codec(struct hda_bus *bus,
+					  const struct hda_patch_op *op)
+{
+	struct hda_codec *codec;
+
+	if (op->nvals != 3)
+		return NULL;
+	list_for_each_codec(codec, bus) {
+		if ((op->vals[0] <= 0 || codec->core.vendor_id == op->vals[0]) &&
+		    (op->vals[1] <= 0 ||
+		     codec->core.subsystem_id == op->vals[1]) &&
+		    codec->core.addr == op->vals[2])
+			return codec;
+	}
+	return NULL;
+}
+
+/**
+ * snd_hda_patch_apply - apply a compiled patch to the codecs on the bus
+ * @bus: HD-audio bus
+ * @patch: the patch returned from snd_hda_patch_compile()
+ */
+void snd_hda_patch_apply(struct hda_bus *bus, const struct hda_patch *patch)
+{
+	const struct hda_patch_op *op = patch->ops;
+	struct hda_codec *codec = NULL;
+	unsigned int i;
+
+	for (i = 0; i < patch->num_ops; i++, op++) {
+		if (op->mode == LINE_MODE_CODEC) {
+			codec = find_patch_codec(bus, op);
+			continue;
+		}
+		if (!codec)
+			continue;
+		switch (op->mode) {
+		case LINE_MODE_PINCFG:
+			add_user_pin_config(codec, op->vals[0], op->vals[1]);
+			break;
+		case LINE_MODE_VERB:
+			add_init_verb(codec, op->vals[0], op->vals[1],
+				      op->vals[2]);
+			break;
+		case LINE_MODE_HINT:
+			parse_hints(codec, op->str);
+			break;
+		case LINE_MODE_MODEL:
+			kfree(codec->modelname);
+			codec->modelname = kstrdup(op->str, GFP_KERNEL);
+			break;
+		case LINE_MODE_CHIP_NAME:
+			snd_hda_codec_set_name(codec, op->str);
+			break;
+		case LINE_MODE_VENDOR_ID:
+			codec->core.vendor_id = op->vals[0];
+			break;
+		case LINE_MODE_SUBSYSTEM_ID:
+			codec->core.subsystem_id = op->vals[0];
+			break;
+		case LINE_MODE_REVISION_ID:
+			codec->core.revision_id = op->vals[0];
+			break;
+		}
 	}
+}
+EXPORT_SYMBOL_GPL(snd_hda_patch_apply);
+
+/**
+ * snd_hda_load_patch - load a "patch" firmware file and parse it
+ * @bus: HD-audio bus
+ * @fw_size: the firmware byte size
+ * @fw_buf: the firmware data
+ */
+int snd_hda_load_patch(struct hda_bus *bus, size_t fw_size, const void *fw_buf)
+{
+	struct hda_patch *patch;
+
+	patch = snd_hda_patch_compile(fw_size, fw_buf);
+	if (IS_ERR(patch))
+		return PTR_ERR(patch);
+	snd_hda_patch_apply(bus, patch);
+	snd_hda_patch_free(patch);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(snd_hda_load_patch);
@@ -747,9 +938,14 @@ static struct attribute *hda_dev_attrs[] = {
 	&dev_attr_modelname.attr,
 	&dev_attr_init_pin_configs.attr,
 	&dev_attr_driver_pin_configs.attr,
+	&dev_attr_probe_time.attr,
 #ifdef CONFIG_PM
 	&dev_attr_power_on_acct.attr,
 	&dev_attr_power_off_acct.attr,
+	&dev_attr_resume_time.attr,
+	&dev_attr_reopen_interval.attr,
+	&dev_attr_warm_opens.attr,
+	&dev_attr_cold_opens.attr,
 #endif
 #ifdef CONFIG_SND_HDA_RECONFIG
 	&dev_attr_init_verbs.attr,
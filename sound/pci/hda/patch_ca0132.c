@@ -27,6 +27,7 @@
 #include <linux/mutex.h>
 #include <linux/module.h>
 #include <linux/firmware.h>
+#include <linux/pm_runtime.h>
 #include <sound/core.h>
 #include "hda_codec.h"
 #include "hda_local.h"
@@ -748,6 +749,8 @@ struct ca0132_spec {
 
 	struct hda_codec *codec;
 	struct delayed_work unsol_hp_work;
+	struct work_struct resume_work;
+	const struct firmware *fw_entry;	/* kept for resume */
 	int quirk;
 
 #ifdef ENABLE_TUNING_CONTROLS
@@ -4371,25 +4374,23 @@ static void ca0132_set_dsp_msr(struct hda_codec *codec, bool is96k)
 
 static bool ca0132_download_dsp_images(struct hda_codec *codec)
 {
-	bool dsp_loaded = false;
+	struct ca0132_spec *spec = codec->spec;
 	const struct dsp_image_seg *dsp_os_image;
-	const struct firmware *fw_entry;
 
-	if (request_firmware(&fw_entry, EFX_FILE, codec->card->dev) != 0)
+	/* keep the image, it's loaded again at each resume */
+	if (!spec->fw_entry &&
+	    request_firmware(&spec->fw_entry, EFX_FILE, codec->card->dev) != 0) {
+		spec->fw_entry = NULL;
 		return false;
+	}
 
-	dsp_os_image = (struct dsp_image_seg *)(fw_entry->data);
+	dsp_os_image = (struct dsp_image_seg *)(spec->fw_entry->data);
 	if (dspload_image(codec, dsp_os_image, 0, 0, true, 0)) {
 		codec_err(codec, "ca0132 DSP load image failed\n");
-		goto exit_download;
+		return false;
 	}
 
-	dsp_loaded = dspload_wait_loaded(codec);
-
-exit_download:
-	release_firmware(fw_entry);
-
-	return dsp_loaded;
+	return dspload_wait_loaded(codec);
 }
 
 static void ca0132_download_dsp(struct hda_codec *codec)
@@ -4605,16 +4606,64 @@ static int ca0132_init(struct hda_codec *codec)
 	return 0;
 }
 
+#ifdef CONFIG_PM
+static void ca0132_resume_work(struct work_struct *work)
+{
+	struct ca0132_spec *spec =
+		container_of(work, struct ca0132_spec, resume_work);
+	struct hda_codec *codec = spec->codec;
+
+	ca0132_init(codec);
+	snd_hdac_regmap_sync(&codec->core);
+	snd_hda_power_down(codec);
+}
+
+/* the DSP download takes long, so let it run after the resume returns;
+ * the PCM and DSP accesses check the DSP state in the meantime.
+ * The work holds a power reference taken here, so that a runtime
+ * suspend can't start and wait for a work stuck in powering up.
+ */
+static int ca0132_resume(struct hda_codec *codec)
+{
+	struct ca0132_spec *spec = codec->spec;
+
+	if (spec->dsp_state != DSP_DOWNLOADED) {
+		ca0132_init(codec);
+		snd_hdac_regmap_sync(&codec->core);
+		return 0;
+	}
+
+	spec->dsp_state = DSP_DOWNLOADING;
+	pm_runtime_get_noresume(hda_codec_dev(codec));
+	if (!schedule_work(&spec->resume_work))
+		snd_hda_power_down(codec);
+	return 0;
+}
+
+static int ca0132_suspend(struct hda_codec *codec)
+{
+	struct ca0132_spec *spec = codec->spec;
+
+	flush_work(&spec->resume_work);
+	return 0;
+}
+#endif
+
 static void ca0132_free(struct hda_codec *codec)
 {
 	struct ca0132_spec *spec = codec->spec;
 
+#ifdef CONFIG_PM
+	if (cancel_work_sync(&spec->resume_work))
+		snd_hda_power_down(codec);
+#endif
 	cancel_delayed_work_sync(&spec->unsol_hp_work);
 	snd_hda_power_up(codec);
 	snd_hda_sequence_write(codec, spec->base_exit_verbs);
 	ca0132_exit_chip(codec);
 	snd_hda_power_down(codec);
 	kfree(spec->spec_init_verbs);
+	release_firmware(spec->fw_entry);
 	kfree(codec->spec);
 }
 
@@ -4624,6 +4673,10 @@ static const struct hda_codec_ops ca0132_patch_ops = {
 	.init = ca0132_init,
 	.free = ca0132_free,
 	.unsol_event = snd_hda_jack_unsol_event,
+#ifdef CONFIG_PM
+	.suspend = ca0132_suspend,
+	.resume = ca0132_resume,
+#endif
 };
 
 static void ca0132_config(struct hda_codec *codec)
@@ -4767,6 +4820,9 @@ static int patch_ca0132(struct hda_codec *codec)
 	spec->base_exit_verbs = ca0132_base_exit_verbs;
 
 	INIT_DELAYED_WORK(&spec->unsol_hp_work, ca0132_unsol_hp_delayed);
+#ifdef CONFIG_PM
+	INIT_WORK(&spec->resume_work, ca0132_resume_work);
+#endif
 
 	ca0132_init_chip(codec);
 
@@ -33,6 +33,7 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/module.h>
+#include <linux/jhash.h>
 #include <sound/core.h>
 #include <sound/jack.h>
 #include <sound/asoundef.h>
@@ -88,6 +89,11 @@ struct hdmi_spec_per_pin {
 
 	struct hda_codec *codec;
 	struct hdmi_eld sink_eld;
+	/* the last successfully parsed ELD, for skipping the reparse */
+	u32 eld_hash;
+	int eld_cache_size;	/* 0 = nothing cached */
+	unsigned char eld_cache[ELD_MAX_SIZE];
+	struct parsed_hdmi_eld eld_cache_info;
 	struct mutex lock;
 	struct delayed_work work;
 	struct hdmi_pcm *pcm; /* pointer to spec->pcm_rec[n] dynamically*/
@@ -1453,9 +1459,6 @@ static void update_eld(struct hda_codec *codec,
 	if (pcm_idx == -1)
 		pcm_idx = per_pin->pcm_idx;
 
-	if (eld->eld_valid)
-		snd_hdmi_show_eld(codec, &eld->info);
-
 	eld_changed = (pin_eld->eld_valid != eld->eld_valid);
 	if (eld->eld_valid && pin_eld->eld_valid)
 		if (pin_eld->eld_size != eld->eld_size ||
@@ -1488,6 +1491,35 @@ static void update_eld(struct hda_codec *codec,
 			       &get_hdmi_pcm(spec, pcm_idx)->eld_ctl->id);
 }
 
+/* parse the ELD into eld->info unless it's the one parsed last on the pin;
+ * HPD bounces usually bring back the very same ELD
+ */
+static int hdmi_parse_eld(struct hda_codec *codec,
+			  struct hdmi_spec_per_pin *per_pin,
+			  struct hdmi_eld *eld, int size)
+{
+	u32 hash = jhash(eld->eld_buffer, size, 0);
+	int err;
+
+	if (per_pin->eld_cache_size == size && per_pin->eld_hash == hash &&
+	    !memcmp(per_pin->eld_cache, eld->eld_buffer, size)) {
+		eld->info = per_pin->eld_cache_info;
+		return 0;
+	}
+
+	per_pin->eld_cache_size = 0;
+	err = snd_hdmi_parse_eld(codec, &eld->info, eld->eld_buffer, size);
+	if (err < 0)
+		return err;
+	snd_hdmi_show_eld(codec, &eld->info);
+
+	per_pin->eld_hash = hash;
+	per_pin->eld_cache_size = size;
+	memcpy(per_pin->eld_cache, eld->eld_buffer, size);
+	per_pin->eld_cache_info = eld->info;
+	return 0;
+}
+
 /* update ELD and jack state via HD-audio verbs */
 static bool hdmi_present_sense_via_verbs(struct hdmi_spec_per_pin *per_pin,
 					 int repoll)
@@ -1527,8 +1559,8 @@ static bool hdmi_present_sense_via_verbs(struct hdmi_spec_per_pin *per_pin,
 						     &eld->eld_size) < 0)
 			eld->eld_valid = false;
 		else {
-			if (snd_hdmi_parse_eld(codec, &eld->info, eld->eld_buffer,
-						    eld->eld_size) < 0)
+			if (hdmi_parse_eld(codec, per_pin, eld,
+					   eld->eld_size) < 0)
 				eld->eld_valid = false;
 		}
 		if (!eld->eld_valid && repoll)
@@ -1594,8 +1626,7 @@ static void sync_eld_via_acomp(struct hda_codec *codec,
 				      eld->eld_buffer, ELD_MAX_SIZE);
 	if (size > 0) {
 		size = min(size, ELD_MAX_SIZE);
-		if (snd_hdmi_parse_eld(codec, &eld->info,
-				       eld->eld_buffer, size) < 0)
+		if (hdmi_parse_eld(codec, per_pin, eld, size) < 0)
 			size = -EINVAL;
 	}
 
@@ -2299,7 +2330,7 @@ static int generic_hdmi_resume(struct hda_codec *codec)
 	int pin_idx;
 
 	codec->patch_ops.init(codec);
-	regcache_sync(codec->core.regmap);
+	snd_hdac_regmap_sync(&codec->core);
 
 	for (pin_idx = 0; pin_idx < spec->num_pins; pin_idx++) {
 		struct hdmi_spec_per_pin *per_pin = get_pin(spec, pin_idx);
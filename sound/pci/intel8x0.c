@@ -222,6 +222,7 @@ DEFINE_REGSET(SP, 0x60);	/* SPDIF out */
 #define   ICH_LDI_MASK		0x00000003	/* last codec read data input */
 
 #define ICH_MAX_FRAGS		32		/* max hw frags */
+#define ICH_NO_WAKEUP_IOC	16		/* irq every n frags w/o wakeups */
 
 
 /*
@@ -674,6 +675,21 @@ static void snd_intel8x0_ali_codec_write(struct snd_ac97 *ac97, unsigned short r
 /*
  * DMA I/O
  */
+
+/*
+ * Interrupt on completion flag of a buffer descriptor.  Without period
+ * wakeups only every ICH_NO_WAKEUP_IOC-th descriptor interrupts, which
+ * is still often enough to keep the ring of descriptors refilled.
+ */
+static u32 snd_intel8x0_bd_ioc(struct ichdev *ichdev, int idx)
+{
+	if (ichdev->substream && ichdev->substream->runtime &&
+	    ichdev->substream->runtime->no_period_wakeup &&
+	    (idx + 1) % ICH_NO_WAKEUP_IOC)
+		return 0;
+	return 0x80000000;
+}
+
 static void snd_intel8x0_setup_periods(struct intel8x0 *chip, struct ichdev *ichdev) 
 {
 	int idx;
@@ -686,10 +702,10 @@ static void snd_intel8x0_setup_periods(struct intel8x0 *chip, struct ichdev *ich
 		ichdev->fragsize1 = ichdev->fragsize >> 1;
 		for (idx = 0; idx < (ICH_REG_LVI_MASK + 1) * 2; idx += 4) {
 			bdbar[idx + 0] = cpu_to_le32(ichdev->physbuf);
-			bdbar[idx + 1] = cpu_to_le32(0x80000000 | /* interrupt on completion */
+			bdbar[idx + 1] = cpu_to_le32(snd_intel8x0_bd_ioc(ichdev, idx >> 1) |
 						     ichdev->fragsize1 >> ichdev->pos_shift);
 			bdbar[idx + 2] = cpu_to_le32(ichdev->physbuf + (ichdev->size >> 1));
-			bdbar[idx + 3] = cpu_to_le32(0x80000000 | /* interrupt on completion */
+			bdbar[idx + 3] = cpu_to_le32(snd_intel8x0_bd_ioc(ichdev, (idx >> 1) + 1) |
 						     ichdev->fragsize1 >> ichdev->pos_shift);
 		}
 		ichdev->frags = 2;
@@ -700,7 +716,7 @@ static void snd_intel8x0_setup_periods(struct intel8x0 *chip, struct ichdev *ich
 			bdbar[idx + 0] = cpu_to_le32(ichdev->physbuf +
 						     (((idx >> 1) * ichdev->fragsize) %
 						      ichdev->size));
-			bdbar[idx + 1] = cpu_to_le32(0x80000000 | /* interrupt on completion */
+			bdbar[idx + 1] = cpu_to_le32(snd_intel8x0_bd_ioc(ichdev, idx >> 1) |
 						     ichdev->fragsize >> ichdev->pos_shift);
 #if 0
 			dev_dbg(chip->card->dev, "bdbar[%i] = 0x%x [0x%x]\n",
@@ -780,14 +796,17 @@ static inline void snd_intel8x0_update(struct intel8x0 *chip, struct ichdev *ich
 	ichdev->lvi &= ICH_REG_LVI_MASK;
 	iputbyte(chip, port + ICH_REG_OFF_LVI, ichdev->lvi);
 	for (i = 0; i < step; i++) {
+		/* refill each descriptor consumed since the last interrupt */
+		int idx = (ichdev->lvi - step + 1 + i) & ICH_REG_LVI_MASK;
+
 		ichdev->lvi_frag++;
 		ichdev->lvi_frag %= ichdev->frags;
-		ichdev->bdbar[ichdev->lvi * 2] = cpu_to_le32(ichdev->physbuf + ichdev->lvi_frag * ichdev->fragsize1);
+		ichdev->bdbar[idx * 2] = cpu_to_le32(ichdev->physbuf + ichdev->lvi_frag * ichdev->fragsize1);
 #if 0
 	dev_dbg(chip->card->dev,
 		"new: bdbar[%i] = 0x%x [0x%x], prefetch = %i, all = 0x%x, 0x%x\n",
-	       ichdev->lvi * 2, ichdev->bdbar[ichdev->lvi * 2],
-	       ichdev->bdbar[ichdev->lvi * 2 + 1], inb(ICH_REG_OFF_PIV + port),
+	       idx * 2, ichdev->bdbar[idx * 2],
+	       ichdev->bdbar[idx * 2 + 1], inb(ICH_REG_OFF_PIV + port),
 	       inl(port + 4), inb(port + ICH_REG_OFF_CR));
 #endif
 		if (--ichdev->ack == 0) {
@@ -1092,6 +1111,12 @@ static snd_pcm_uframes_t snd_intel8x0_pcm_pointer(struct snd_pcm_substream *subs
 		if (ptr1 == igetword(chip, ichdev->reg_offset + ichdev->roff_picb))
 			break;
 	} while (timeout--);
+	if (substream->runtime->no_period_wakeup) {
+		/* add the fragments completed since the last interrupt */
+		int step = (civ - ichdev->civ) & ICH_REG_LVI_MASK;
+
+		position = (position + step * ichdev->fragsize1) % ichdev->size;
+	}
 	ptr = ichdev->last_pos;
 	if (ptr1 != 0) {
 		ptr1 <<= ichdev->pos_shift;
@@ -1121,7 +1146,8 @@ static const struct snd_pcm_hardware snd_intel8x0_stream =
 				 SNDRV_PCM_INFO_BLOCK_TRANSFER |
 				 SNDRV_PCM_INFO_MMAP_VALID |
 				 SNDRV_PCM_INFO_PAUSE |
-				 SNDRV_PCM_INFO_RESUME),
+				 SNDRV_PCM_INFO_RESUME |
+				 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP),
 	.formats =		SNDRV_PCM_FMTBIT_S16_LE,
 	.rates =		SNDRV_PCM_RATE_48000,
 	.rate_min =		48000,
@@ -301,6 +301,10 @@ struct lola_stream {
 	unsigned int period_bytes;
 	unsigned int frags;
 
+	/* position latched at the last period interrupt */
+	unsigned int irq_lpib;
+	unsigned int irq_lrc;
+
 	/* format + channel setup */
 	unsigned int format_verb;
 
@@ -309,6 +313,7 @@ struct lola_stream {
 	unsigned int prepared:1;
 	unsigned int paused:1;
 	unsigned int running:1;
+	unsigned int irq_pos_valid:1;
 };
 
 #define PLAY	SNDRV_PCM_STREAM_PLAYBACK
@@ -555,18 +555,44 @@ static int lola_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 			lola_stream_stop(chip, str, tstamp);
 		str->running = start;
 		str->paused = !start;
+		str->irq_pos_valid = 0;
 		snd_pcm_trigger_done(s, substream);
 	}
 	spin_unlock(&chip->reg_lock);
 	return 0;
 }
 
+/*
+ * LPIB only moves in steps of the granularity.  Between two period
+ * interrupts the position is interpolated from the one latched at the
+ * last interrupt and the sample counter LRC, which is a single global
+ * register and keeps the pointer exact to the frame.
+ */
 static snd_pcm_uframes_t lola_pcm_pointer(struct snd_pcm_substream *substream)
 {
 	struct lola *chip = snd_pcm_substream_chip(substream);
 	struct lola_stream *str = lola_get_stream(substream);
-	unsigned int pos = lola_dsd_read(chip, str->dsd, LPIB);
+	unsigned int pos, frames;
+
+	/*
+	 * Capture data is only in memory up to LPIB, so the position
+	 * counted from the sample clock is for playback only.
+	 */
+	if (str->irq_pos_valid &&
+	    substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
+		frames = ((lola_get_lrc(chip) >> 8) - (str->irq_lrc >> 8)) &
+			0xffffff;
+		pos = frames_to_bytes(substream->runtime, frames);
+		/* never run past the next period interrupt */
+		if (pos < str->period_bytes) {
+			pos += str->irq_lpib;
+			if (pos >= str->bufsize)
+				pos -= str->bufsize;
+			return bytes_to_frames(substream->runtime, pos);
+		}
+	}
 
+	pos = lola_dsd_read(chip, str->dsd, LPIB);
 	if (pos >= str->bufsize)
 		pos = 0;
 	return bytes_to_frames(substream->runtime, pos);
@@ -574,13 +600,20 @@ static snd_pcm_uframes_t lola_pcm_pointer(struct snd_pcm_substream *substream)
 
 void lola_pcm_update(struct lola *chip, struct lola_pcm *pcm, unsigned int bits)
 {
+	unsigned int lrc = bits ? lola_get_lrc(chip) : 0;
 	int i;
 
 	for (i = 0; bits && i < pcm->num_streams; i++) {
 		if (bits & (1 << i)) {
 			struct lola_stream *str = &pcm->streams[i];
-			if (str->substream && str->running)
+			if (str->substream && str->running) {
+				str->irq_lpib = lola_dsd_read(chip, str->dsd,
+							      LPIB);
+				str->irq_lrc = lrc;
+				str->irq_pos_valid =
+					str->irq_lpib < str->bufsize;
 				snd_pcm_period_elapsed(str->substream);
+			}
 			bits &= ~(1 << i);
 		}
 	}
@@ -286,9 +286,10 @@ static snd_pcm_uframes_t lx_pcm_stream_pointer(struct snd_pcm_substream
 
 	dev_dbg(chip->card->dev, "->lx_pcm_stream_pointer\n");
 
-	mutex_lock(&chip->lock);
-	pos = lx_stream->frame_pos * substream->runtime->period_size;
-	mutex_unlock(&chip->lock);
+	/* frame_pos is only advanced by the interrupt thread, reading it
+	 * does not need to wait for the dsp commands issued under chip->lock
+	 */
+	pos = READ_ONCE(lx_stream->frame_pos) * substream->runtime->period_size;
 
 	dev_dbg(chip->card->dev, "stream_pointer at %ld\n", pos);
 	return pos;
@@ -467,7 +468,7 @@ static void lx_trigger_start(struct lx6464es *chip, struct lx_stream *lx_stream)
 	else
 		lx_stream->status = LX_STREAM_STATUS_RUNNING;
 
-	lx_stream->frame_pos = 0;
+	WRITE_ONCE(lx_stream->frame_pos, 0);
 }
 
 static void lx_trigger_stop(struct lx6464es *chip, struct lx_stream *lx_stream)
@@ -1058,6 +1058,11 @@ static int lx_interrupt_request_new_buffer(struct lx6464es *chip,
 
 	dev_dbg(chip->card->dev, "->lx_interrupt_request_new_buffer\n");
 
+	/* the end of buffer event completed the period at pos: publish the
+	 * new position before the dsp round trips refilling it
+	 */
+	WRITE_ONCE(lx_stream->frame_pos, next_pos);
+
 	mutex_lock(&chip->lock);
 
 	err = lx_buffer_ask(chip, 0, is_capture, &needed, &freed, size_array);
@@ -1071,7 +1076,6 @@ static int lx_interrupt_request_new_buffer(struct lx6464es *chip,
 		"interrupt: gave buffer index %x on 0x%lx (%d bytes)\n",
 		    buffer_index, (unsigned long)buf, period_bytes);
 
-	lx_stream->frame_pos = next_pos;
 	mutex_unlock(&chip->lock);
 
 	return err;
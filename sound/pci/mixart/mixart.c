@@ -390,38 +390,89 @@ int snd_mixart_kill_ref_pipe(struct mixart_mgr *mgr,
 	return err;
 }
 
-static int mixart_set_stream_state(struct mixart_stream *stream, int start)
+/* the stream state request carries an array of stream_count flow infos */
+struct mixart_streams_state_req {
+	struct mixart_stream_state_req req;
+	struct mixart_flow_info more_info[MIXART_PLAYBACK_STREAMS - 1];
+} __attribute__((packed));
+
+/*
+ * start or stop streams of the same direction with a single message,
+ * so that a linked group starts on the same sample
+ */
+static int mixart_set_streams_state(struct mixart_stream **streams, int count,
+				    int start)
 {
 	struct snd_mixart *chip;
-	struct mixart_stream_state_req stream_state_req;
+	struct mixart_streams_state_req stream_state_req;
+	struct mixart_flow_info *info;
 	struct mixart_msg request;
+	int i;
 
-	if(!stream->substream)
+	if (snd_BUG_ON(count < 1 || count > MIXART_PLAYBACK_STREAMS))
 		return -EINVAL;
 
 	memset(&stream_state_req, 0, sizeof(stream_state_req));
-	stream_state_req.stream_count = 1;
-	stream_state_req.stream_info.stream_desc.uid_pipe = stream->pipe->group_uid;
-	stream_state_req.stream_info.stream_desc.stream_idx = stream->substream->number;
+	stream_state_req.req.stream_count = count;
+	for (i = 0; i < count; i++) {
+		struct mixart_stream *stream = streams[i];
+
+		if (!stream->substream)
+			return -EINVAL;
+		info = i ? &stream_state_req.more_info[i - 1] :
+			&stream_state_req.req.stream_info;
+		info->stream_desc.uid_pipe = stream->pipe->group_uid;
+		info->stream_desc.stream_idx = stream->substream->number;
+
+		stream->abs_period_elapsed = 0;            /* reset stream pos      */
+		stream->buf_periods = 0;
+		stream->buf_period_frag = 0;
+	}
 
-	if (stream->substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (streams[0]->substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
 		request.message_id = start ? MSG_STREAM_START_INPUT_STAGE_PACKET : MSG_STREAM_STOP_INPUT_STAGE_PACKET;
 	else
 		request.message_id = start ? MSG_STREAM_START_OUTPUT_STAGE_PACKET : MSG_STREAM_STOP_OUTPUT_STAGE_PACKET;
 
 	request.uid = (struct mixart_uid){0,0};
 	request.data = &stream_state_req;
-	request.size = sizeof(stream_state_req);
+	request.size = sizeof(stream_state_req.req) +
+		(count - 1) * sizeof(struct mixart_flow_info);
 
-	stream->abs_period_elapsed = 0;            /* reset stream pos      */
-	stream->buf_periods = 0;
-	stream->buf_period_frag = 0;
-
-	chip = snd_pcm_substream_chip(stream->substream);
+	chip = snd_pcm_substream_chip(streams[0]->substream);
 
 	return snd_mixart_send_msg_nonblock(chip->mgr, &request);
 }
 
+/*
+ * Collect the streams of the linked group that share the message of subs:
+ * same manager and same direction.  Returns the number of streams.
+ */
+static int mixart_group_streams(struct snd_pcm_substream *subs,
+				struct mixart_stream **streams)
+{
+	struct snd_mixart *chip = snd_pcm_substream_chip(subs);
+	struct snd_pcm_substream *s;
+	int count = 0;
+
+	streams[count++] = subs->runtime->private_data;
+	if (!snd_pcm_stream_linked(subs))
+		return count;
+
+	snd_pcm_group_for_each_entry(s, subs) {
+		struct snd_mixart *c = snd_pcm_substream_chip(s);
+
+		/* same ops: a mixart stream of the same direction */
+		if (s == subs || s->ops != subs->ops || c->mgr != chip->mgr)
+			continue;
+		if (count >= MIXART_PLAYBACK_STREAMS)
+			break;
+		streams[count++] = s->runtime->private_data;
+		snd_pcm_trigger_done(s, subs);
+	}
+	return count;
+}
+
 /*
  *  Trigger callback
  */
@@ -429,26 +480,32 @@ static int mixart_set_stream_state(struct mixart_stream *stream, int start)
 static int snd_mixart_trigger(struct snd_pcm_substream *subs, int cmd)
 {
 	struct mixart_stream *stream = subs->runtime->private_data;
+	struct mixart_stream *streams[MIXART_PLAYBACK_STREAMS];
+	int i, count;
 
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
 
 		dev_dbg(subs->pcm->card->dev, "SNDRV_PCM_TRIGGER_START\n");
 
-		/* START_STREAM */
-		if( mixart_set_stream_state(stream, 1) )
+		/* START_STREAM, for the whole linked group at once */
+		count = mixart_group_streams(subs, streams);
+		if( mixart_set_streams_state(streams, count, 1) )
 			return -EINVAL;
 
-		stream->status = MIXART_STREAM_STATUS_RUNNING;
+		for (i = 0; i < count; i++)
+			streams[i]->status = MIXART_STREAM_STATUS_RUNNING;
 
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 
 		/* STOP_STREAM */
-		if( mixart_set_stream_state(stream, 0) )
+		count = mixart_group_streams(subs, streams);
+		if( mixart_set_streams_state(streams, count, 0) )
 			return -EINVAL;
 
-		stream->status = MIXART_STREAM_STATUS_OPEN;
+		for (i = 0; i < count; i++)
+			streams[i]->status = MIXART_STREAM_STATUS_OPEN;
 
 		dev_dbg(subs->pcm->card->dev, "SNDRV_PCM_TRIGGER_STOP\n");
 
@@ -130,6 +130,8 @@ struct oxygen {
 	u8 dac_mute;
 	u8 pcm_active;
 	u8 pcm_running;
+	u8 irq_followers[PCM_COUNT];
+	unsigned int follower_period[PCM_COUNT];
 	u8 dac_routing;
 	u8 spdif_playback_enable;
 	u8 has_ac97_0;
@@ -176,6 +178,8 @@ void oxygen_update_spdif_source(struct oxygen *chip);
 /* oxygen_pcm.c */
 
 int oxygen_pcm_init(struct oxygen *chip);
+unsigned int oxygen_irq_followers_elapsed(struct oxygen *chip,
+					  unsigned int leader);
 
 /* oxygen_io.c */
 
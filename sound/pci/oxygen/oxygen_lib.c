@@ -65,7 +65,7 @@ static void oxygen_read_uart(struct oxygen *chip)
 static irqreturn_t oxygen_interrupt(int dummy, void *dev_id)
 {
 	struct oxygen *chip = dev_id;
-	unsigned int status, clear, elapsed_streams, i;
+	unsigned int status, clear, elapsed_streams, followers, i;
 
 	status = oxygen_read16(chip, OXYGEN_INTERRUPT_STATUS);
 	if (!status)
@@ -92,6 +92,11 @@ static irqreturn_t oxygen_interrupt(int dummy, void *dev_id)
 	}
 
 	elapsed_streams = status & chip->pcm_running;
+	followers = 0;
+	for (i = 0; i < PCM_COUNT; ++i)
+		if ((elapsed_streams & (1 << i)) && chip->irq_followers[i])
+			followers |= oxygen_irq_followers_elapsed(chip, i);
+	elapsed_streams |= followers;
 
 	spin_unlock(&chip->reg_lock);
 
@@ -17,6 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
  */
 
+#include <linux/moduleparam.h>
 #include <linux/pci.h>
 #include <sound/control.h>
 #include <sound/core.h>
@@ -37,6 +38,11 @@
 #define DEFAULT_BUFFER_BYTES		(BUFFER_BYTES_MAX / 2)
 #define DEFAULT_BUFFER_BYTES_MULTICH	(1024 * 1024)
 
+static bool coalesce_irqs = true;
+module_param(coalesce_irqs, bool, 0644);
+MODULE_PARM_DESC(coalesce_irqs,
+		 "serve linked streams with equal periods from one interrupt");
+
 static const struct snd_pcm_hardware oxygen_stereo_hardware = {
 	.info = SNDRV_PCM_INFO_MMAP |
 		SNDRV_PCM_INFO_MMAP_VALID |
@@ -574,11 +580,109 @@ static int oxygen_prepare(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+/*
+ * Linked streams of the same direction that are started together with the
+ * same rate and period size interrupt at the same time, so the interrupt
+ * of the first one can report the periods of all of them.  Returns the
+ * channels whose own interrupts are not needed.
+ */
+static unsigned int oxygen_irq_followers(struct oxygen *chip,
+					 struct snd_pcm_substream *substream,
+					 unsigned int *leader)
+{
+	struct snd_pcm_substream *s, *first = NULL;
+	unsigned int channel, followers = 0;
+
+	if (!coalesce_irqs)
+		return 0;
+	snd_pcm_group_for_each_entry(s, substream) {
+		if (snd_pcm_substream_chip(s) != chip)
+			continue;
+		if (s->runtime->no_period_wakeup)
+			return 0;
+		channel = oxygen_substream_channel(s);
+		if (!first) {
+			first = s;
+			*leader = channel;
+		} else if (s->stream == first->stream &&
+			   s->runtime->rate == first->runtime->rate &&
+			   s->runtime->period_size ==
+			   first->runtime->period_size) {
+			followers |= 1 << channel;
+		} else {
+			return 0;
+		}
+	}
+	return followers;
+}
+
+/*
+ * Called from the interrupt of a leader, under reg_lock: returns its
+ * followers that are in a new period.  A follower that lags behind the
+ * leader would only be reported one period late; it gets its own
+ * interrupt back instead.
+ */
+unsigned int oxygen_irq_followers_elapsed(struct oxygen *chip,
+					  unsigned int leader)
+{
+	struct snd_pcm_runtime *runtime;
+	unsigned int i, period, elapsed = 0, late = 0;
+	u32 pos;
+
+	for (i = 0; i < PCM_COUNT; ++i) {
+		if (!(chip->irq_followers[leader] & (1 << i)) ||
+		    !(chip->pcm_running & (1 << i)) || !chip->streams[i])
+			continue;
+		runtime = chip->streams[i]->runtime;
+		pos = oxygen_read32(chip, channel_base_registers[i]) -
+			(u32)runtime->dma_addr;
+		period = pos / frames_to_bytes(runtime, runtime->period_size);
+		if (period != chip->follower_period[i]) {
+			chip->follower_period[i] = period;
+			elapsed |= 1 << i;
+		} else {
+			late |= 1 << i;
+		}
+	}
+	if (late) {
+		chip->irq_followers[leader] &= ~late;
+		chip->interrupt_mask |= late;
+		oxygen_write16(chip, OXYGEN_INTERRUPT_MASK,
+			       chip->interrupt_mask);
+	}
+	return elapsed;
+}
+
+/*
+ * give the followers of the stopping or pausing channels their interrupts
+ * back, and the stopping followers theirs for their next start
+ */
+static void oxygen_release_irq_followers(struct oxygen *chip,
+					 unsigned int mask)
+{
+	unsigned int i, followers = 0;
+
+	for (i = 0; i < PCM_COUNT; ++i) {
+		if (mask & (1 << i)) {
+			followers |= chip->irq_followers[i];
+			chip->irq_followers[i] = 0;
+		} else {
+			followers |= chip->irq_followers[i] & mask;
+			chip->irq_followers[i] &= ~mask;
+		}
+	}
+	if (followers) {
+		chip->interrupt_mask |= followers;
+		oxygen_write16(chip, OXYGEN_INTERRUPT_MASK,
+			       chip->interrupt_mask);
+	}
+}
+
 static int oxygen_trigger(struct snd_pcm_substream *substream, int cmd)
 {
 	struct oxygen *chip = snd_pcm_substream_chip(substream);
 	struct snd_pcm_substream *s;
-	unsigned int mask = 0;
+	unsigned int mask = 0, followers = 0, leader = 0, i;
 	int pausing;
 
 	switch (cmd) {
@@ -602,18 +706,36 @@ static int oxygen_trigger(struct snd_pcm_substream *substream, int cmd)
 		}
 	}
 
+	if (cmd == SNDRV_PCM_TRIGGER_START)
+		followers = oxygen_irq_followers(chip, substream, &leader);
+
 	spin_lock(&chip->reg_lock);
 	if (!pausing) {
-		if (cmd == SNDRV_PCM_TRIGGER_START)
+		if (cmd == SNDRV_PCM_TRIGGER_START) {
+			if (followers) {
+				/* the DMA starts at the buffer start */
+				for (i = 0; i < PCM_COUNT; ++i)
+					if (followers & (1 << i))
+						chip->follower_period[i] = 0;
+				chip->irq_followers[leader] = followers;
+				chip->interrupt_mask &= ~followers;
+				oxygen_write16(chip, OXYGEN_INTERRUPT_MASK,
+					       chip->interrupt_mask);
+			}
 			chip->pcm_running |= mask;
-		else
+		} else {
+			oxygen_release_irq_followers(chip, mask);
 			chip->pcm_running &= ~mask;
+		}
 		oxygen_write8(chip, OXYGEN_DMA_STATUS, chip->pcm_running);
 	} else {
-		if (cmd == SNDRV_PCM_TRIGGER_PAUSE_PUSH)
+		if (cmd == SNDRV_PCM_TRIGGER_PAUSE_PUSH) {
+			/* a paused leader would starve its followers */
+			oxygen_release_irq_followers(chip, mask);
 			oxygen_set_bits8(chip, OXYGEN_DMA_PAUSE, mask);
-		else
+		} else {
 			oxygen_clear_bits8(chip, OXYGEN_DMA_PAUSE, mask);
+		}
 	}
 	spin_unlock(&chip->reg_lock);
 	return 0;
@@ -702,6 +702,50 @@ static inline int pcxhr_stream_scheduled_get_pipe(struct pcxhr_stream *stream,
 	return 0;
 }
 
+/*
+ * start the scheduled streams of one pipe with a single message,
+ * so that they start on the same sample
+ */
+static int pcxhr_start_pipe_streams(struct snd_pcxhr *chip,
+				    struct pcxhr_stream *streams, int count)
+{
+	struct pcxhr_stream *stream;
+	struct pcxhr_pipe *pipe = NULL;
+	struct pcxhr_rmh rmh;
+	int i, err, stream_mask = 0;
+
+	for (i = 0; i < count; i++) {
+		stream = &streams[i];
+		if (!stream->substream ||
+		    !pcxhr_stream_scheduled_get_pipe(stream, &pipe))
+			continue;
+		stream->timer_abs_periods = 0;
+		stream->timer_period_frag = 0;	/* reset theoretical stream pos */
+		stream->timer_buf_periods = 0;
+		stream->timer_is_synced = 0;
+		stream_mask |=
+		  pipe->is_capture ? 1 : 1<<stream->substream->number;
+	}
+	if (!stream_mask)
+		return 0;
+
+	pcxhr_init_rmh(&rmh, CMD_START_STREAM);
+	pcxhr_set_pipe_cmd_params(&rmh, pipe->is_capture,
+				  pipe->first_audio, 0, stream_mask);
+	err = pcxhr_send_msg(chip->mgr, &rmh);
+	if (err)
+		dev_err(chip->card->dev,
+			"ERROR pcxhr_start_pipe_streams err=%x;\n", err);
+
+	for (i = 0; i < count; i++) {
+		stream = &streams[i];
+		if (stream->substream &&
+		    stream->status == PCXHR_STREAM_STATUS_SCHEDULE_RUN)
+			stream->status = PCXHR_STREAM_STATUS_STARTED;
+	}
+	return err;
+}
+
 static void pcxhr_start_linked_stream(struct pcxhr_mgr *mgr)
 {
 	int i, j, err;
@@ -772,20 +816,15 @@ static void pcxhr_start_linked_stream(struct pcxhr_mgr *mgr)
 			}
 		}
 	}
-	/* start all the streams */
+	/* start all the streams, one message per pipe */
 	for (i = 0; i < mgr->num_cards; i++) {
-		struct pcxhr_stream *stream;
 		chip = mgr->chip[i];
-		for (j = 0; j < chip->nb_streams_capt; j++) {
-			stream = &chip->capture_stream[j];
-			if (pcxhr_stream_scheduled_get_pipe(stream, &pipe))
-				err = pcxhr_set_stream_state(chip, stream);
-		}
-		for (j = 0; j < chip->nb_streams_play; j++) {
-			stream = &chip->playback_stream[j];
-			if (pcxhr_stream_scheduled_get_pipe(stream, &pipe))
-				err = pcxhr_set_stream_state(chip, stream);
-		}
+		for (j = 0; j < chip->nb_streams_capt; j++)
+			err = pcxhr_start_pipe_streams(chip,
+						&chip->capture_stream[j], 1);
+		/* all the playback streams of one chip use the same pipe */
+		err = pcxhr_start_pipe_streams(chip, chip->playback_stream,
+					       chip->nb_streams_play);
 	}
 
 	/* synchronous start of all the pipes concerned */
@@ -1157,9 +1157,77 @@ static u_int64_t pcxhr_stream_read_position(struct pcxhr_mgr *mgr,
 	return hw_sample_count;
 }
 
+/* does the stream position have to be read back from the dsp this tick ? */
+static int pcxhr_stream_need_read(struct pcxhr_mgr *mgr,
+				  struct pcxhr_stream *stream,
+				  int samples_to_add)
+{
+	if (!stream->substream ||
+	    stream->status != PCXHR_STREAM_STATUS_RUNNING)
+		return 0;
+	if (samples_to_add < 0)
+		samples_to_add = mgr->granularity;
+	else if (stream->timer_is_synced)
+		return 0;
+	return stream->timer_abs_periods != 0 ||
+		stream->timer_period_frag + samples_to_add >=
+			stream->substream->runtime->period_size;
+}
+
+/*
+ * read the sample counts of all the streams of a playback pipe that need
+ * it with a single message; returns the mask of the streams read
+ */
+static int pcxhr_pipe_read_positions(struct pcxhr_mgr *mgr,
+				     struct pcxhr_stream *streams, int count,
+				     int samples_to_add,
+				     u_int64_t *hw_sample_count)
+{
+	struct pcxhr_pipe *pipe = NULL;
+	struct pcxhr_rmh rmh;
+	int i, n, err, stream_mask = 0, read_mask = 0;
+
+	for (i = 0; i < count; i++) {
+		if (!pcxhr_stream_need_read(mgr, &streams[i], samples_to_add))
+			continue;
+		pipe = streams[i].pipe;
+		stream_mask |= 1 << streams[i].substream->number;
+		read_mask |= 1 << i;
+	}
+	/* one stream alone is read by pcxhr_update_timer_pos() */
+	if (hweight32(read_mask) < 2)
+		return 0;
+
+	pcxhr_init_rmh(&rmh, CMD_STREAM_SAMPLE_COUNT);
+	pcxhr_set_pipe_cmd_params(&rmh, 0, pipe->first_audio, 0, stream_mask);
+	rmh.stat_len = 2 * hweight32(stream_mask); /* 2 resp data per stream */
+
+	err = pcxhr_send_msg(mgr, &rmh);
+	if (err)
+		return 0;
+
+	/* the counts come in the order of the stream numbers */
+	for (n = 0, i = 0; i < PCXHR_PLAYBACK_STREAMS; i++) {
+		int j;
+
+		if (!(stream_mask & (1 << i)))
+			continue;
+		for (j = 0; j < count; j++) {
+			if ((read_mask & (1 << j)) &&
+			    streams[j].substream->number == i)
+				hw_sample_count[j] =
+					(((u_int64_t)rmh.stat[n]) << 24) +
+					(u_int64_t)rmh.stat[n + 1];
+		}
+		n += 2;
+	}
+	return read_mask;
+}
+
 static void pcxhr_update_timer_pos(struct pcxhr_mgr *mgr,
 				   struct pcxhr_stream *stream,
-				   int samples_to_add)
+				   int samples_to_add,
+				   const u_int64_t *hw_sample_count)
 {
 	if (stream->substream &&
 	    (stream->status == PCXHR_STREAM_STATUS_RUNNING)) {
@@ -1178,8 +1246,12 @@ static void pcxhr_update_timer_pos(struct pcxhr_mgr *mgr,
 			if ((stream->timer_abs_periods != 0) ||
 			    ((stream->timer_period_frag + samples_to_add) >=
 			    runtime->period_size)) {
-				new_sample_count =
-				  pcxhr_stream_read_position(mgr, stream);
+				if (hw_sample_count)
+					new_sample_count = *hw_sample_count;
+				else
+					new_sample_count =
+					  pcxhr_stream_read_position(mgr,
+								     stream);
 				hardware_read = 1;
 				if (new_sample_count >= mgr->granularity) {
 					/* sub security offset because of
@@ -1329,14 +1401,25 @@ irqreturn_t pcxhr_threaded_irq(int irq, void *dev_id)
 			for (j = 0; j < chip->nb_streams_capt; j++)
 				pcxhr_update_timer_pos(mgr,
 						&chip->capture_stream[j],
-						dsp_time_diff);
+						dsp_time_diff, NULL);
 		}
 		for (i = 0; i < mgr->num_cards; i++) {
+			u_int64_t hw_sample_count[PCXHR_PLAYBACK_STREAMS];
+			int read_mask;
+
 			chip = mgr->chip[i];
+			/* all the playback streams of a chip share one pipe */
+			read_mask = pcxhr_pipe_read_positions(mgr,
+						chip->playback_stream,
+						chip->nb_streams_play,
+						dsp_time_diff,
+						hw_sample_count);
 			for (j = 0; j < chip->nb_streams_play; j++)
 				pcxhr_update_timer_pos(mgr,
 						&chip->playback_stream[j],
-						dsp_time_diff);
+						dsp_time_diff,
+						(read_mask & (1 << j)) ?
+						&hw_sample_count[j] : NULL);
 		}
 	}
 
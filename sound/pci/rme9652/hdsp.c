@@ -66,7 +66,6 @@ MODULE_FIRMWARE("multiface_firmware_rev11.bin");
 MODULE_FIRMWARE("digiface_firmware.bin");
 MODULE_FIRMWARE("digiface_firmware_rev11.bin");
 
-#define HDSP_MAX_CHANNELS        26
 #define HDSP_MAX_DS_CHANNELS     14
 #define HDSP_MAX_QS_CHANNELS     8
 #define DIGIFACE_SS_CHANNELS     26
@@ -463,6 +462,7 @@ struct hdsp {
 	struct tasklet_struct midi_tasklet;
 	int		      use_midi_tasklet;
 	int                   precise_ptr;
+	long                  irq_position;   /* latched by the irq handler, -1 outside */
 	u32                   control_register;	     /* cached value */
 	u32                   control2_register;     /* cached value */
 	u32                   creg_spdif;
@@ -1040,12 +1040,8 @@ static void hdsp_compute_period_size(struct hdsp *hdsp)
 	hdsp->period_bytes = 1 << ((hdsp_decode_latency(hdsp->control_register) + 8));
 }
 
-static snd_pcm_uframes_t hdsp_hw_pointer(struct hdsp *hdsp)
+static snd_pcm_uframes_t hdsp_decode_pointer(struct hdsp *hdsp, int position)
 {
-	int position;
-
-	position = hdsp_read(hdsp, HDSP_statusRegister);
-
 	if (!hdsp->precise_ptr)
 		return (position & HDSP_BufferID) ? (hdsp->period_bytes / 4) : 0;
 
@@ -1055,6 +1051,11 @@ static snd_pcm_uframes_t hdsp_hw_pointer(struct hdsp *hdsp)
 	return position;
 }
 
+static snd_pcm_uframes_t hdsp_hw_pointer(struct hdsp *hdsp)
+{
+	return hdsp_decode_pointer(hdsp, hdsp_read(hdsp, HDSP_statusRegister));
+}
+
 static void hdsp_reset_hw_pointer(struct hdsp *hdsp)
 {
 	hdsp_write (hdsp, HDSP_resetPointer, 0);
@@ -3850,11 +3851,14 @@ static irqreturn_t snd_hdsp_interrupt(int irq, void *dev_id)
 		return IRQ_HANDLED;
 
 	if (audio) {
+		/* both streams share the status just read for their pointer */
+		WRITE_ONCE(hdsp->irq_position, hdsp_decode_pointer(hdsp, status));
 		if (hdsp->capture_substream)
 			snd_pcm_period_elapsed(hdsp->pcm->streams[SNDRV_PCM_STREAM_CAPTURE].substream);
 
 		if (hdsp->playback_substream)
 			snd_pcm_period_elapsed(hdsp->pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream);
+		WRITE_ONCE(hdsp->irq_position, -1);
 	}
 
 	if (midi0 && midi0status) {
@@ -3887,6 +3891,10 @@ static irqreturn_t snd_hdsp_interrupt(int irq, void *dev_id)
 static snd_pcm_uframes_t snd_hdsp_hw_pointer(struct snd_pcm_substream *substream)
 {
 	struct hdsp *hdsp = snd_pcm_substream_chip(substream);
+	long position = READ_ONCE(hdsp->irq_position);
+
+	if (position >= 0)
+		return position;
 	return hdsp_hw_pointer(hdsp);
 }
 
@@ -4882,6 +4890,32 @@ static int snd_hdsp_hwdep_ioctl(struct snd_hwdep *hw, struct file *file, unsigne
 			return -EFAULT;
 		break;
 	}
+	case SNDRV_HDSP_IOCTL_GET_CHANNEL_MAP: {
+		struct hdsp_channel_map map;
+		unsigned long flags;
+		int i, mapped;
+
+		/* the channel map is set up with the firmware */
+		if (!(hdsp->state & HDSP_FirmwareLoaded)) {
+			dev_err(hdsp->card->dev,
+				"firmware needs to be uploaded to the card.\n");
+			return -EINVAL;
+		}
+
+		memset(&map, 0, sizeof(map));
+		spin_lock_irqsave(&hdsp->lock, flags);
+		map.channels = hdsp->max_channels;
+		map.step = 32;
+		for (i = 0; i < HDSP_MAX_CHANNELS; i++) {
+			mapped = i < hdsp->max_channels ? hdsp->channel_map[i] : -1;
+			map.offset[i] = mapped < 0 ? -1 :
+				mapped * HDSP_CHANNEL_BUFFER_BYTES;
+		}
+		spin_unlock_irqrestore(&hdsp->lock, flags);
+		if (copy_to_user(argp, &map, sizeof(map)))
+			return -EFAULT;
+		break;
+	}
 	default:
 		return -EINVAL;
 	}
@@ -5181,6 +5215,7 @@ static int snd_hdsp_create(struct snd_card *card,
 	int is_9632 = 0;
 
 	hdsp->irq = -1;
+	hdsp->irq_position = -1;
 	hdsp->state = 0;
 	hdsp->midi[0].rmidi = NULL;
 	hdsp->midi[1].rmidi = NULL;
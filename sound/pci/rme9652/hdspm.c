@@ -1049,6 +1049,7 @@ struct hdspm {
 	void __iomem *iobase;
 
 	int irq_count;		/* for debug */
+	long irq_position;	/* latched by the irq handler, -1 outside */
 	int midiPorts;
 
 	struct snd_card *card;	/* one card */
@@ -1481,12 +1482,9 @@ static inline void hdspm_compute_period_size(struct hdspm *hdspm)
 }
 
 
-static snd_pcm_uframes_t hdspm_hw_pointer(struct hdspm *hdspm)
+static snd_pcm_uframes_t hdspm_decode_pointer(struct hdspm *hdspm,
+					      int position)
 {
-	int position;
-
-	position = hdspm_read(hdspm, HDSPM_statusRegister);
-
 	switch (hdspm->io_type) {
 	case RayDAT:
 	case AIO:
@@ -1501,6 +1499,12 @@ static snd_pcm_uframes_t hdspm_hw_pointer(struct hdspm *hdspm)
 	return position;
 }
 
+static snd_pcm_uframes_t hdspm_hw_pointer(struct hdspm *hdspm)
+{
+	return hdspm_decode_pointer(hdspm,
+				    hdspm_read(hdspm, HDSPM_statusRegister));
+}
+
 
 static inline void hdspm_start_audio(struct hdspm * s)
 {
@@ -5437,11 +5441,15 @@ static irqreturn_t snd_hdspm_interrupt(int irq, void *dev_id)
 
 
 	if (audio) {
+		/* both streams share the status just read for their pointer */
+		WRITE_ONCE(hdspm->irq_position,
+			   hdspm_decode_pointer(hdspm, status));
 		if (hdspm->capture_substream)
 			snd_pcm_period_elapsed(hdspm->capture_substream);
 
 		if (hdspm->playback_substream)
 			snd_pcm_period_elapsed(hdspm->playback_substream);
+		WRITE_ONCE(hdspm->irq_position, -1);
 	}
 
 	if (midi) {
@@ -5479,6 +5487,10 @@ static snd_pcm_uframes_t snd_hdspm_hw_pointer(struct snd_pcm_substream
 					      *substream)
 {
 	struct hdspm *hdspm = snd_pcm_substream_chip(substream);
+	long position = READ_ONCE(hdspm->irq_position);
+
+	if (position >= 0)
+		return position;
 	return hdspm_hw_pointer(hdspm);
 }
 
@@ -6165,6 +6177,14 @@ static inline int copy_u32_le(void __user *dest, void __iomem *src)
 	return copy_to_user(dest, &val, 4);
 }
 
+static int hdspm_channel_offset(int channel, int channels,
+				const signed char *channel_map)
+{
+	if (channel >= channels || channel_map[channel] < 0)
+		return -1;
+	return channel_map[channel] * HDSPM_CHANNEL_BUFFER_BYTES;
+}
+
 static int snd_hdspm_hwdep_ioctl(struct snd_hwdep *hw, struct file *file,
 		unsigned int cmd, unsigned long arg)
 {
@@ -6176,6 +6196,7 @@ static int snd_hdspm_hwdep_ioctl(struct snd_hwdep *hw, struct file *file,
 	struct hdspm_version hdspm_version;
 	struct hdspm_peak_rms *levels;
 	struct hdspm_ltc ltc;
+	struct hdspm_channel_map map;
 	unsigned int statusregister;
 	long unsigned int s;
 	int i = 0;
@@ -6361,6 +6382,25 @@ static int snd_hdspm_hwdep_ioctl(struct snd_hwdep *hw, struct file *file,
 			return -EFAULT;
 		break;
 
+	case SNDRV_HDSPM_IOCTL_GET_CHANNEL_MAP:
+		memset(&map, 0, sizeof(map));
+		spin_lock_irq(&hdspm->lock);
+		map.channels_in = hdspm->max_channels_in;
+		map.channels_out = hdspm->max_channels_out;
+		map.step = 32;
+		for (i = 0; i < HDSPM_MAX_CHANNELS; i++) {
+			map.offset_in[i] = hdspm_channel_offset(i,
+					hdspm->max_channels_in,
+					hdspm->channel_map_in);
+			map.offset_out[i] = hdspm_channel_offset(i,
+					hdspm->max_channels_out,
+					hdspm->channel_map_out);
+		}
+		spin_unlock_irq(&hdspm->lock);
+		if (copy_to_user(argp, &map, sizeof(map)))
+			return -EFAULT;
+		break;
+
 	default:
 		return -EINVAL;
 	}
@@ -6552,6 +6592,7 @@ static int snd_hdspm_create(struct snd_card *card,
 	unsigned long io_extent;
 
 	hdspm->irq = -1;
+	hdspm->irq_position = -1;
 	hdspm->card = card;
 
 	spin_lock_init(&hdspm->lock);
@@ -48,6 +48,7 @@ static long mpu_port[SNDRV_CARDS];
 static long joystick_port[SNDRV_CARDS];
 #endif
 static bool rear_switch[SNDRV_CARDS];
+static int shared_clients[SNDRV_CARDS];
 
 module_param_array(index, int, NULL, 0444);
 MODULE_PARM_DESC(index, "Index value for the Yamaha DS-1 PCI soundcard.");
@@ -65,6 +66,8 @@ MODULE_PARM_DESC(joystick_port, "Joystick port address");
 #endif
 module_param_array(rear_switch, bool, NULL, 0444);
 MODULE_PARM_DESC(rear_switch, "Enable shared rear/line-in switch");
+module_param_array(shared_clients, int, NULL, 0444);
+MODULE_PARM_DESC(shared_clients, "Clients of the shared playback device (0 = none).");
 
 static const struct pci_device_id snd_ymfpci_ids[] = {
 	{ PCI_VDEVICE(YAMAHA, 0x0004), 0, },   /* YMF724 */
@@ -303,6 +306,12 @@ static int snd_card_ymfpci_probe(struct pci_dev *pci,
 		if (err < 0)
 			goto free_card;
 	}
+	if (shared_clients[dev] > 0) {
+		err = snd_pcm_new_shared(chip->pcm, 4, shared_clients[dev],
+					 48000);
+		if (err < 0)
+			goto free_card;
+	}
 	err = snd_ymfpci_timer(chip, 0);
 	if (err < 0)
 		goto free_card;
@@ -9,6 +9,7 @@
 #include <linux/crc32.h>
 #include <linux/firmware.h>
 #include <linux/kernel.h>
+#include <linux/kref.h>
 #include <linux/i2c.h>
 #include <linux/regmap.h>
 #include <linux/module.h>
@@ -33,6 +34,7 @@ struct sigmadsp_control {
 	const char *name;
 	struct snd_kcontrol *kcontrol;
 	bool cached;
+	bool dirty;	/* set by the user, not by the firmware */
 	uint8_t cache[];
 };
 
@@ -44,6 +46,25 @@ struct sigmadsp_data {
 	uint8_t data[];
 };
 
+/*
+ * A parsed firmware file, shared by the instances that use it and kept
+ * until the last of them is gone.  The controls are the templates of the
+ * per-instance ones.
+ */
+struct sigmadsp_firmware {
+	struct list_head head;
+	struct kref ref;
+	const char *name;
+
+	struct list_head ctrl_list;
+	struct list_head data_list;
+	unsigned int num_rates;
+	unsigned int *rates;
+};
+
+static LIST_HEAD(sigmadsp_firmware_list);
+static DEFINE_MUTEX(sigmadsp_firmware_lock);
+
 struct sigma_fw_chunk {
 	__le32 length;
 	__le32 tag;
@@ -138,14 +159,20 @@ static int sigmadsp_ctrl_put(struct snd_kcontrol *kcontrol,
 
 	data = ucontrol->value.bytes.data;
 
+	/* nothing to upload if the parameter doesn't change */
+	if (ctrl->cached && !memcmp(ctrl->cache, data, ctrl->num_bytes))
+		goto out;
+
 	if (!(kcontrol->vd[0].access & SNDRV_CTL_ELEM_ACCESS_INACTIVE))
 		ret = sigmadsp_ctrl_write(sigmadsp, ctrl, data);
 
 	if (ret == 0) {
 		memcpy(ctrl->cache, data, ctrl->num_bytes);
 		ctrl->cached = true;
+		ctrl->dirty = true;
 	}
 
+out:
 	mutex_unlock(&sigmadsp->lock);
 
 	return ret;
@@ -237,7 +264,7 @@ static int sigma_fw_load_control(struct sigmadsp *sigmadsp,
 	ctrl->num_bytes = num_bytes;
 	ctrl->samplerates = le32_to_cpu(chunk->samplerates);
 
-	list_add_tail(&ctrl->head, &sigmadsp->ctrl_list);
+	list_add_tail(&ctrl->head, &sigmadsp->fw->ctrl_list);
 
 	return 0;
 
@@ -268,7 +295,7 @@ static int sigma_fw_load_data(struct sigmadsp *sigmadsp,
 	data->length = length;
 	data->samplerates = le32_to_cpu(chunk->samplerates);
 	memcpy(data->data, data_chunk->data, length);
-	list_add_tail(&data->head, &sigmadsp->data_list);
+	list_add_tail(&data->head, &sigmadsp->fw->data_list);
 
 	return 0;
 }
@@ -289,7 +316,7 @@ static int sigma_fw_load_samplerates(struct sigmadsp *sigmadsp,
 		return -EINVAL;
 
 	/* We only allow one samplerates block per file */
-	if (sigmadsp->rate_constraints.count)
+	if (sigmadsp->fw->num_rates)
 		return -EINVAL;
 
 	rates = kcalloc(num_rates, sizeof(*rates), GFP_KERNEL);
@@ -299,8 +326,8 @@ static int sigma_fw_load_samplerates(struct sigmadsp *sigmadsp,
 	for (i = 0; i < num_rates; i++)
 		rates[i] = le32_to_cpu(rate_chunk->samplerates[i]);
 
-	sigmadsp->rate_constraints.count = num_rates;
-	sigmadsp->rate_constraints.list = rates;
+	sigmadsp->fw->num_rates = num_rates;
+	sigmadsp->fw->rates = rates;
 
 	return 0;
 }
@@ -410,7 +437,7 @@ static int process_sigma_action(struct sigmadsp *sigmadsp,
 		data->addr = be16_to_cpu(sa->addr);
 		data->length = len - 2;
 		memcpy(data->data, sa->payload, data->length);
-		list_add_tail(&data->head, &sigmadsp->data_list);
+		list_add_tail(&data->head, &sigmadsp->fw->data_list);
 		break;
 	case SIGMA_ACTION_END:
 		return 0;
@@ -452,26 +479,52 @@ static int sigmadsp_fw_load_v1(struct sigmadsp *sigmadsp,
 	return 0;
 }
 
-static void sigmadsp_firmware_release(struct sigmadsp *sigmadsp)
+static void sigmadsp_firmware_free(struct sigmadsp_firmware *fw)
 {
 	struct sigmadsp_control *ctrl, *_ctrl;
 	struct sigmadsp_data *data, *_data;
 
-	list_for_each_entry_safe(ctrl, _ctrl, &sigmadsp->ctrl_list, head) {
+	list_for_each_entry_safe(ctrl, _ctrl, &fw->ctrl_list, head) {
 		kfree(ctrl->name);
 		kfree(ctrl);
 	}
 
-	list_for_each_entry_safe(data, _data, &sigmadsp->data_list, head)
+	list_for_each_entry_safe(data, _data, &fw->data_list, head)
 		kfree(data);
 
+	kfree(fw->rates);
+	kfree(fw->name);
+	kfree(fw);
+}
+
+static void sigmadsp_firmware_release(struct kref *ref)
+{
+	struct sigmadsp_firmware *fw =
+		container_of(ref, struct sigmadsp_firmware, ref);
+
+	list_del(&fw->head);
+	mutex_unlock(&sigmadsp_firmware_lock);
+	sigmadsp_firmware_free(fw);
+}
+
+static void sigmadsp_release(struct sigmadsp *sigmadsp)
+{
+	struct sigmadsp_control *ctrl, *_ctrl;
+
+	/* the names belong to the firmware templates */
+	list_for_each_entry_safe(ctrl, _ctrl, &sigmadsp->ctrl_list, head)
+		kfree(ctrl);
 	INIT_LIST_HEAD(&sigmadsp->ctrl_list);
-	INIT_LIST_HEAD(&sigmadsp->data_list);
+
+	if (sigmadsp->fw)
+		kref_put_mutex(&sigmadsp->fw->ref, sigmadsp_firmware_release,
+			&sigmadsp_firmware_lock);
+	sigmadsp->fw = NULL;
 }
 
 static void devm_sigmadsp_release(struct device *dev, void *res)
 {
-	sigmadsp_firmware_release((struct sigmadsp *)res);
+	sigmadsp_release((struct sigmadsp *)res);
 }
 
 static int sigmadsp_firmware_load(struct sigmadsp *sigmadsp, const char *name)
@@ -532,26 +585,92 @@ static int sigmadsp_firmware_load(struct sigmadsp *sigmadsp, const char *name)
 		break;
 	}
 
-	if (ret)
-		sigmadsp_firmware_release(sigmadsp);
-
 done:
 	release_firmware(fw);
 
 	return ret;
 }
 
+/*
+ * Look up the firmware in the files already parsed for other instances,
+ * and only load it the first time.
+ */
+static int sigmadsp_firmware_get(struct sigmadsp *sigmadsp, const char *name)
+{
+	struct sigmadsp_firmware *fw;
+	int ret = 0;
+
+	mutex_lock(&sigmadsp_firmware_lock);
+
+	list_for_each_entry(fw, &sigmadsp_firmware_list, head) {
+		if (!strcmp(fw->name, name)) {
+			kref_get(&fw->ref);
+			sigmadsp->fw = fw;
+			goto out;
+		}
+	}
+
+	fw = kzalloc(sizeof(*fw), GFP_KERNEL);
+	if (!fw) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	kref_init(&fw->ref);
+	INIT_LIST_HEAD(&fw->ctrl_list);
+	INIT_LIST_HEAD(&fw->data_list);
+	fw->name = kstrdup(name, GFP_KERNEL);
+	if (!fw->name) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	sigmadsp->fw = fw;
+	ret = sigmadsp_firmware_load(sigmadsp, name);
+	if (ret)
+		goto err_free;
+
+	list_add(&fw->head, &sigmadsp_firmware_list);
+	goto out;
+
+err_free:
+	sigmadsp->fw = NULL;
+	sigmadsp_firmware_free(fw);
+out:
+	mutex_unlock(&sigmadsp_firmware_lock);
+
+	return ret;
+}
+
 static int sigmadsp_init(struct sigmadsp *sigmadsp, struct device *dev,
 	const struct sigmadsp_ops *ops, const char *firmware_name)
 {
+	struct sigmadsp_control *tmpl, *ctrl;
+	int ret;
+
 	sigmadsp->ops = ops;
 	sigmadsp->dev = dev;
 
 	INIT_LIST_HEAD(&sigmadsp->ctrl_list);
-	INIT_LIST_HEAD(&sigmadsp->data_list);
 	mutex_init(&sigmadsp->lock);
 
-	return sigmadsp_firmware_load(sigmadsp, firmware_name);
+	ret = sigmadsp_firmware_get(sigmadsp, firmware_name);
+	if (ret)
+		return ret;
+
+	sigmadsp->rate_constraints.count = sigmadsp->fw->num_rates;
+	sigmadsp->rate_constraints.list = sigmadsp->fw->rates;
+
+	list_for_each_entry(tmpl, &sigmadsp->fw->ctrl_list, head) {
+		ctrl = kmemdup(tmpl, sizeof(*ctrl) + tmpl->num_bytes,
+			GFP_KERNEL);
+		if (!ctrl) {
+			sigmadsp_release(sigmadsp);
+			return -ENOMEM;
+		}
+		list_add_tail(&ctrl->head, &sigmadsp->ctrl_list);
+	}
+
+	return 0;
 }
 
 /**
@@ -680,10 +799,17 @@ static void sigmadsp_activate_ctrl(struct sigmadsp *sigmadsp,
 	}
 	up_write(&card->controls_rwsem);
 
+	/*
+	 * Only the parameters set by the user need to be written again, the
+	 * others are what the firmware has just loaded, which may differ
+	 * from the cached value for another samplerate.
+	 */
 	if (active && changed) {
 		mutex_lock(&sigmadsp->lock);
-		if (ctrl->cached)
+		if (ctrl->dirty)
 			sigmadsp_ctrl_write(sigmadsp, ctrl, ctrl->cache);
+		else
+			ctrl->cached = false;
 		mutex_unlock(&sigmadsp->lock);
 	}
 
@@ -724,6 +850,103 @@ int sigmadsp_attach(struct sigmadsp *sigmadsp,
 }
 EXPORT_SYMBOL_GPL(sigmadsp_attach);
 
+/*
+ * Whether two ranges of DSP memory may overlap.  The addresses count words
+ * of at least one byte, so taking the lengths in bytes as a number of
+ * words can only find more overlaps than there are.
+ */
+static bool sigmadsp_overlap(unsigned int addr1, unsigned int len1,
+	unsigned int addr2, unsigned int len2)
+{
+	return addr1 < addr2 + len2 && addr2 < addr1 + len1;
+}
+
+/*
+ * Whether a data chunk is still in place from the setup for the previous
+ * samplerate: it was written then, and neither a chunk written only for
+ * the previous samplerate after it, nor a chunk for the new samplerate
+ * only before it, may have overwritten it since.  Neither may a parameter
+ * the user has changed through a control, nor a chunk before it that is
+ * written again for this setup.
+ */
+static bool sigmadsp_data_loaded(struct sigmadsp *sigmadsp,
+	struct sigmadsp_data *data, unsigned int loaded_mask,
+	unsigned int samplerate_mask, const bool *written)
+{
+	struct sigmadsp_control *ctrl;
+	struct sigmadsp_data *d;
+	bool after = false;
+	bool was_valid, is_valid;
+	unsigned int i = 0;
+
+	if (!loaded_mask ||
+	    !sigmadsp_samplerate_valid(data->samplerates, loaded_mask))
+		return false;
+
+	list_for_each_entry(ctrl, &sigmadsp->ctrl_list, head) {
+		if (ctrl->dirty && sigmadsp_overlap(data->addr, data->length,
+		    ctrl->addr, ctrl->num_bytes))
+			return false;
+	}
+
+	list_for_each_entry(d, &sigmadsp->fw->data_list, head) {
+		if (d == data) {
+			after = true;
+			continue;
+		}
+		if (!after && written[i++] && sigmadsp_overlap(data->addr,
+		    data->length, d->addr, d->length))
+			return false;
+		was_valid = sigmadsp_samplerate_valid(d->samplerates,
+			loaded_mask);
+		is_valid = sigmadsp_samplerate_valid(d->samplerates,
+			samplerate_mask);
+		if (after ? was_valid && !is_valid : is_valid && !was_valid)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * For the controls that stay active, write again the parameters the user
+ * has changed that a rewritten chunk may have reset, and read the others
+ * again from the DSP; the controls activated by this setup are handled
+ * when activated.
+ */
+static int sigmadsp_restore_dirty(struct sigmadsp *sigmadsp,
+	unsigned int loaded_mask, unsigned int samplerate_mask,
+	const bool *written)
+{
+	struct sigmadsp_control *ctrl;
+	struct sigmadsp_data *data;
+	unsigned int i;
+	int ret;
+
+	list_for_each_entry(ctrl, &sigmadsp->ctrl_list, head) {
+		if (!sigmadsp_samplerate_valid(ctrl->samplerates, loaded_mask) ||
+		    !sigmadsp_samplerate_valid(ctrl->samplerates,
+		    samplerate_mask))
+			continue;
+		i = 0;
+		list_for_each_entry(data, &sigmadsp->fw->data_list, head) {
+			if (!written[i++] || !sigmadsp_overlap(data->addr,
+			    data->length, ctrl->addr, ctrl->num_bytes))
+				continue;
+			if (!ctrl->dirty) {
+				ctrl->cached = false;
+				break;
+			}
+			ret = sigmadsp_ctrl_write(sigmadsp, ctrl, ctrl->cache);
+			if (ret)
+				return ret;
+			break;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * sigmadsp_setup() - Setup the DSP for the specified samplerate
  * @sigmadsp: The sigmadsp instance to configure
@@ -731,7 +954,9 @@ EXPORT_SYMBOL_GPL(sigmadsp_attach);
  *
  * Loads the appropriate firmware program and parameter memory (if not already
  * loaded) and enables the controls for the specified samplerate. Any control
- * parameter changes that have been made previously will be restored.
+ * parameter changes that have been made previously will be restored. When
+ * switching samplerates without a reset, the data shared with the previous
+ * samplerate isn't written again.
  *
  * Returns 0 on success, a negative error code otherwise.
  */
@@ -739,8 +964,11 @@ int sigmadsp_setup(struct sigmadsp *sigmadsp, unsigned int samplerate)
 {
 	struct sigmadsp_control *ctrl;
 	unsigned int samplerate_mask;
+	unsigned int loaded_mask;
 	struct sigmadsp_data *data;
-	int ret;
+	unsigned int i, num_data = 0;
+	bool *written;
+	int ret = 0;
 
 	if (sigmadsp->current_samplerate == samplerate)
 		return 0;
@@ -749,15 +977,39 @@ int sigmadsp_setup(struct sigmadsp *sigmadsp, unsigned int samplerate)
 	if (samplerate_mask == 0)
 		return -EINVAL;
 
-	list_for_each_entry(data, &sigmadsp->data_list, head) {
+	loaded_mask = sigmadsp_get_samplerate_mask(sigmadsp,
+		sigmadsp->current_samplerate);
+
+	list_for_each_entry(data, &sigmadsp->fw->data_list, head)
+		num_data++;
+	written = kcalloc(max(num_data, 1U), sizeof(*written), GFP_KERNEL);
+	if (!written)
+		return -ENOMEM;
+
+	/* the dirty flags and the parameter writes of the controls */
+	mutex_lock(&sigmadsp->lock);
+	i = 0;
+	list_for_each_entry(data, &sigmadsp->fw->data_list, head) {
 		if (!sigmadsp_samplerate_valid(data->samplerates,
-		    samplerate_mask))
+		    samplerate_mask) ||
+		    sigmadsp_data_loaded(sigmadsp, data, loaded_mask,
+		    samplerate_mask, written)) {
+			i++;
 			continue;
+		}
 		ret = sigmadsp_write(sigmadsp, data->addr, data->data,
 			data->length);
 		if (ret)
-			goto err;
+			break;
+		written[i++] = true;
 	}
+	if (!ret && loaded_mask)
+		ret = sigmadsp_restore_dirty(sigmadsp, loaded_mask,
+			samplerate_mask, written);
+	mutex_unlock(&sigmadsp->lock);
+	kfree(written);
+	if (ret)
+		goto err;
 
 	list_for_each_entry(ctrl, &sigmadsp->ctrl_list, head)
 		sigmadsp_activate_ctrl(sigmadsp, ctrl, samplerate_mask);
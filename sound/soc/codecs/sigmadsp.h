@@ -16,6 +16,7 @@
 #include <sound/pcm.h>
 
 struct sigmadsp;
+struct sigmadsp_firmware;
 struct snd_soc_component;
 struct snd_pcm_substream;
 
@@ -27,8 +28,8 @@ struct sigmadsp_ops {
 struct sigmadsp {
 	const struct sigmadsp_ops *ops;
 
+	struct sigmadsp_firmware *fw;
 	struct list_head ctrl_list;
-	struct list_head data_list;
 
 	struct snd_pcm_hw_constraint_list rate_constraints;
 
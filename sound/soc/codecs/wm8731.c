@@ -162,6 +162,9 @@ SOC_DOUBLE_R_TLV("Master Playback Volume", WM8731_LOUT1V, WM8731_ROUT1V,
 		 0, 127, 0, out_tlv),
 SOC_DOUBLE_R("Master Playback ZC Switch", WM8731_LOUT1V, WM8731_ROUT1V,
 	7, 1, 0),
+SOC_DOUBLE_R_RAMP("Master Playback Volume Ramp", WM8731_LOUT1V,
+		  WM8731_ROUT1V, 0, 127, 0),
+SOC_VOLSW_RAMP_TIME("Master Playback Volume Ramp Time", 100),
 
 SOC_DOUBLE_R_TLV("Capture Volume", WM8731_LINVOL, WM8731_RINVOL, 0, 31, 0,
 		 in_tlv),
@@ -449,6 +449,25 @@ struct dma_chan *fsl_asrc_get_dma_channel(struct fsl_asrc_pair *pair, bool dir)
 }
 EXPORT_SYMBOL_GPL(fsl_asrc_get_dma_channel);
 
+/*
+ * Rate the Back-End was set up with by DPCM, which may differ from the
+ * Front-End one as the ASRC converts between them; asrc_rate otherwise.
+ */
+static unsigned int fsl_asrc_be_rate(struct snd_pcm_substream *substream)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct fsl_asrc *asrc_priv = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+	struct snd_soc_dpcm *dpcm;
+
+	list_for_each_entry(dpcm, &rtd->dpcm[substream->stream].be_clients,
+			    list_be) {
+		if (dpcm->fe == rtd)
+			return params_rate(&dpcm->hw_params);
+	}
+
+	return asrc_priv->asrc_rate;
+}
+
 static int fsl_asrc_dai_hw_params(struct snd_pcm_substream *substream,
 				  struct snd_pcm_hw_params *params,
 				  struct snd_soc_dai *dai)
@@ -489,11 +508,11 @@ static int fsl_asrc_dai_hw_params(struct snd_pcm_substream *substream,
 		config.input_word_width   = width;
 		config.output_word_width  = word_width;
 		config.input_sample_rate  = rate;
-		config.output_sample_rate = asrc_priv->asrc_rate;
+		config.output_sample_rate = fsl_asrc_be_rate(substream);
 	} else {
 		config.input_word_width   = word_width;
 		config.output_word_width  = width;
-		config.input_sample_rate  = asrc_priv->asrc_rate;
+		config.input_sample_rate  = fsl_asrc_be_rate(substream);
 		config.output_sample_rate = rate;
 	}
 
@@ -579,6 +598,7 @@ static struct snd_soc_dai_driver fsl_asrc_dai = {
 		.rates = FSL_ASRC_RATES,
 		.formats = FSL_ASRC_FORMATS,
 	},
+	.rate_conversion = 1,
 	.ops = &fsl_asrc_dai_ops,
 };
 
@@ -537,6 +537,8 @@ static struct snd_soc_dai_link kabylake_dais[] = {
 		.trigger = {
 			SND_SOC_DPCM_TRIGGER_POST, SND_SOC_DPCM_TRIGGER_POST},
 		.dpcm_playback = 1,
+		/* speakers on SSP0 and headset on SSP1 set up independently */
+		.dpcm_parallel_be = 1,
 		.ops = &kabylake_rt5663_fe_ops,
 	},
 	[KBL_DPCM_AUDIO_CP] = {
@@ -654,6 +656,8 @@ static struct snd_soc_dai_link kabylake_dais[] = {
 		.no_pcm = 1,
 		.codecs = max98927_codec_components,
 		.num_codecs = ARRAY_SIZE(max98927_codec_components),
+		/* each amplifier has its own regmap */
+		.parallel_codecs = 1,
 		.dai_fmt = SND_SOC_DAIFMT_DSP_B |
 			SND_SOC_DAIFMT_NB_NF |
 			SND_SOC_DAIFMT_CBS_CFS,
@@ -878,6 +882,8 @@ static struct snd_soc_card kabylake_audio_card_rt5663_m98927 = {
 	.codec_conf = max98927_codec_conf,
 	.num_configs = ARRAY_SIZE(max98927_codec_conf),
 	.fully_routed = true,
+	/* the headset codec and the two amplifiers sequence independently */
+	.parallel_dapm_seq = true,
 	.late_probe = kabylake_card_late_probe,
 };
 
@@ -81,9 +81,8 @@ static int tx_wait_done(struct sst_generic_ipc *ipc,
 	return ret;
 }
 
-static int ipc_tx_message(struct sst_generic_ipc *ipc, u64 header,
-	void *tx_data, size_t tx_bytes, void *rx_data,
-	size_t rx_bytes, int wait)
+static struct ipc_message *ipc_tx_queue(struct sst_generic_ipc *ipc,
+	u64 header, void *tx_data, size_t tx_bytes, size_t rx_bytes, int wait)
 {
 	struct ipc_message *msg;
 	unsigned long flags;
@@ -93,7 +92,7 @@ static int ipc_tx_message(struct sst_generic_ipc *ipc, u64 header,
 	msg = msg_get_empty(ipc);
 	if (msg == NULL) {
 		spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
-		return -EBUSY;
+		return ERR_PTR(-EBUSY);
 	}
 
 	msg->header = header;
@@ -111,6 +110,19 @@ static int ipc_tx_message(struct sst_generic_ipc *ipc, u64 header,
 	schedule_work(&ipc->kwork);
 	spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
 
+	return msg;
+}
+
+static int ipc_tx_message(struct sst_generic_ipc *ipc, u64 header,
+	void *tx_data, size_t tx_bytes, void *rx_data,
+	size_t rx_bytes, int wait)
+{
+	struct ipc_message *msg;
+
+	msg = ipc_tx_queue(ipc, header, tx_data, tx_bytes, rx_bytes, wait);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
 	if (wait)
 		return tx_wait_done(ipc, msg, rx_data);
 	else
@@ -173,7 +185,10 @@ static void ipc_tx_msgs(struct work_struct *work)
 		}
 
 		msg = list_first_entry(&ipc->tx_list, struct ipc_message, list);
-		list_move(&msg->list, &ipc->rx_list);
+		/* keep the send order so that replies with the same header
+		 * are matched to the oldest message
+		 */
+		list_move_tail(&msg->list, &ipc->rx_list);
 
 		if (ipc->ops.tx_msg != NULL)
 			ipc->ops.tx_msg(ipc, msg);
@@ -223,6 +238,98 @@ int sst_ipc_tx_message_nopm(struct sst_generic_ipc *ipc, u64 header,
 }
 EXPORT_SYMBOL_GPL(sst_ipc_tx_message_nopm);
 
+/**
+ * sst_ipc_batch_init - initialize an IPC message batch
+ * @ipc: the generic IPC object
+ * @batch: the batch to initialize
+ */
+void sst_ipc_batch_init(struct sst_generic_ipc *ipc,
+	struct sst_ipc_batch *batch)
+{
+	batch->ipc = ipc;
+	batch->count = 0;
+	batch->err = 0;
+}
+EXPORT_SYMBOL_GPL(sst_ipc_batch_init);
+
+/**
+ * sst_ipc_batch_add - queue a message without waiting for the reply
+ * @batch: the batch to add to
+ * @header: message header
+ * @tx_data: message payload
+ * @tx_bytes: payload size
+ *
+ * The message is sent as soon as the DSP takes it, right after the reply
+ * of the previous one, and its reply is collected by sst_ipc_batch_flush().
+ * When the batch or the message pool is full, the batch is flushed first.
+ *
+ * Returns zero, or the first error of the batch so far.
+ */
+int sst_ipc_batch_add(struct sst_ipc_batch *batch, u64 header,
+	void *tx_data, size_t tx_bytes)
+{
+	struct sst_generic_ipc *ipc = batch->ipc;
+	struct ipc_message *msg;
+
+	if (batch->count >= IPC_BATCH_MAX_MSGS)
+		sst_ipc_batch_flush(batch);
+
+	if (!batch->count && ipc->ops.check_dsp_lp_on)
+		if (ipc->ops.check_dsp_lp_on(ipc->dsp, true))
+			return -EIO;
+
+	msg = ipc_tx_queue(ipc, header, tx_data, tx_bytes, 0, 1);
+	if (IS_ERR(msg) && batch->count) {
+		/* out of messages, wait for ours and retry */
+		sst_ipc_batch_flush(batch);
+		if (ipc->ops.check_dsp_lp_on)
+			if (ipc->ops.check_dsp_lp_on(ipc->dsp, true))
+				return -EIO;
+		msg = ipc_tx_queue(ipc, header, tx_data, tx_bytes, 0, 1);
+	}
+	if (IS_ERR(msg)) {
+		if (!batch->count && ipc->ops.check_dsp_lp_on)
+			ipc->ops.check_dsp_lp_on(ipc->dsp, false);
+		if (!batch->err)
+			batch->err = PTR_ERR(msg);
+		return batch->err;
+	}
+
+	batch->msgs[batch->count++] = msg;
+	return batch->err;
+}
+EXPORT_SYMBOL_GPL(sst_ipc_batch_add);
+
+/**
+ * sst_ipc_batch_flush - wait for the replies of all queued messages
+ * @batch: the batch to flush
+ *
+ * Returns zero if all messages succeeded, or the first error code.
+ */
+int sst_ipc_batch_flush(struct sst_ipc_batch *batch)
+{
+	struct sst_generic_ipc *ipc = batch->ipc;
+	unsigned int i;
+	int ret;
+
+	if (!batch->count)
+		return batch->err;
+
+	for (i = 0; i < batch->count; i++) {
+		ret = tx_wait_done(ipc, batch->msgs[i], NULL);
+		if (ret < 0 && !batch->err)
+			batch->err = ret;
+	}
+	batch->count = 0;
+
+	if (ipc->ops.check_dsp_lp_on)
+		if (ipc->ops.check_dsp_lp_on(ipc->dsp, false) && !batch->err)
+			batch->err = -EIO;
+
+	return batch->err;
+}
+EXPORT_SYMBOL_GPL(sst_ipc_batch_flush);
+
 struct ipc_message *sst_ipc_reply_find_msg(struct sst_generic_ipc *ipc,
 	u64 header)
 {
@@ -25,6 +25,7 @@
 #include <linux/sched.h>
 
 #define IPC_MAX_MAILBOX_BYTES	256
+#define IPC_BATCH_MAX_MSGS	8
 
 struct ipc_message {
 	struct list_head list;
@@ -74,6 +75,14 @@ struct sst_generic_ipc {
 	struct sst_plat_ipc_ops ops;
 };
 
+/* messages queued back to back, waited for at once */
+struct sst_ipc_batch {
+	struct sst_generic_ipc *ipc;
+	struct ipc_message *msgs[IPC_BATCH_MAX_MSGS];
+	unsigned int count;
+	int err;
+};
+
 int sst_ipc_tx_message_wait(struct sst_generic_ipc *ipc, u64 header,
 	void *tx_data, size_t tx_bytes, void *rx_data, size_t rx_bytes);
 
@@ -83,6 +92,14 @@ int sst_ipc_tx_message_nowait(struct sst_generic_ipc *ipc, u64 header,
 int sst_ipc_tx_message_nopm(struct sst_generic_ipc *ipc, u64 header,
 	void *tx_data, size_t tx_bytes, void *rx_data, size_t rx_bytes);
 
+void sst_ipc_batch_init(struct sst_generic_ipc *ipc,
+	struct sst_ipc_batch *batch);
+
+int sst_ipc_batch_add(struct sst_ipc_batch *batch, u64 header,
+	void *tx_data, size_t tx_bytes);
+
+int sst_ipc_batch_flush(struct sst_ipc_batch *batch);
+
 struct ipc_message *sst_ipc_reply_find_msg(struct sst_generic_ipc *ipc,
 	u64 header);
 
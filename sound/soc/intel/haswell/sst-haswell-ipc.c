@@ -850,9 +850,10 @@ int sst_hsw_stream_get_volume(struct sst_hsw *hsw, struct sst_hsw_stream *stream
 	return 0;
 }
 
-/* stream volume */
-int sst_hsw_stream_set_volume(struct sst_hsw *hsw,
-	struct sst_hsw_stream *stream, u32 stage_id, u32 channel, u32 volume)
+/* stream volume; queued to @batch when given, otherwise sent and waited */
+static int hsw_stream_set_volume(struct sst_hsw *hsw,
+	struct sst_hsw_stream *stream, u32 stage_id, u32 channel, u32 volume,
+	struct sst_ipc_batch *batch)
 {
 	struct sst_hsw_ipc_volume_req *req;
 	u32 header;
@@ -892,8 +893,11 @@ int sst_hsw_stream_set_volume(struct sst_hsw *hsw,
 		req->channel = channel;
 	}
 
-	ret = sst_ipc_tx_message_wait(&hsw->ipc, header, req,
-		sizeof(*req), NULL, 0);
+	if (batch)
+		ret = sst_ipc_batch_add(batch, header, req, sizeof(*req));
+	else
+		ret = sst_ipc_tx_message_wait(&hsw->ipc, header, req,
+			sizeof(*req), NULL, 0);
 	if (ret < 0) {
 		dev_err(hsw->dev, "error: set stream volume failed\n");
 		return ret;
@@ -902,6 +906,33 @@ int sst_hsw_stream_set_volume(struct sst_hsw *hsw,
 	return 0;
 }
 
+int sst_hsw_stream_set_volume(struct sst_hsw *hsw,
+	struct sst_hsw_stream *stream, u32 stage_id, u32 channel, u32 volume)
+{
+	return hsw_stream_set_volume(hsw, stream, stage_id, channel, volume,
+		NULL);
+}
+
+/* set the volume of both channels, sending the IPCs back to back */
+int sst_hsw_stream_set_volumes(struct sst_hsw *hsw,
+	struct sst_hsw_stream *stream, u32 stage_id, const u32 *volume)
+{
+	struct sst_ipc_batch batch;
+	int ret;
+
+	if (volume[0] == volume[1])
+		return hsw_stream_set_volume(hsw, stream, stage_id,
+			SST_HSW_CHANNELS_ALL, volume[0], NULL);
+
+	sst_ipc_batch_init(&hsw->ipc, &batch);
+	hsw_stream_set_volume(hsw, stream, stage_id, 0, volume[0], &batch);
+	hsw_stream_set_volume(hsw, stream, stage_id, 1, volume[1], &batch);
+	ret = sst_ipc_batch_flush(&batch);
+	if (ret < 0)
+		dev_err(hsw->dev, "error: set stream volumes failed\n");
+	return ret;
+}
+
 int sst_hsw_mixer_get_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
 	u32 *volume)
 {
@@ -915,9 +946,9 @@ int sst_hsw_mixer_get_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
 	return 0;
 }
 
-/* global mixer volume */
-int sst_hsw_mixer_set_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
-	u32 volume)
+/* global mixer volume; queued to @batch when given */
+static int hsw_mixer_set_volume(struct sst_hsw *hsw, u32 stage_id,
+	u32 channel, u32 volume, struct sst_ipc_batch *batch)
 {
 	struct sst_hsw_ipc_volume_req req;
 	u32 header;
@@ -958,8 +989,11 @@ int sst_hsw_mixer_set_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
 	req.curve_type = hsw->curve_type;
 	req.target_volume = volume;
 
-	ret = sst_ipc_tx_message_wait(&hsw->ipc, header, &req,
-		sizeof(req), NULL, 0);
+	if (batch)
+		ret = sst_ipc_batch_add(batch, header, &req, sizeof(req));
+	else
+		ret = sst_ipc_tx_message_wait(&hsw->ipc, header, &req,
+			sizeof(req), NULL, 0);
 	if (ret < 0) {
 		dev_err(hsw->dev, "error: set mixer volume failed\n");
 		return ret;
@@ -968,6 +1002,32 @@ int sst_hsw_mixer_set_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
 	return 0;
 }
 
+int sst_hsw_mixer_set_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
+	u32 volume)
+{
+	return hsw_mixer_set_volume(hsw, stage_id, channel, volume, NULL);
+}
+
+/* set the mixer volume of both channels, sending the IPCs back to back */
+int sst_hsw_mixer_set_volumes(struct sst_hsw *hsw, u32 stage_id,
+	const u32 *volume)
+{
+	struct sst_ipc_batch batch;
+	int ret;
+
+	if (volume[0] == volume[1])
+		return hsw_mixer_set_volume(hsw, stage_id,
+			SST_HSW_CHANNELS_ALL, volume[0], NULL);
+
+	sst_ipc_batch_init(&hsw->ipc, &batch);
+	hsw_mixer_set_volume(hsw, stage_id, 0, volume[0], &batch);
+	hsw_mixer_set_volume(hsw, stage_id, 1, volume[1], &batch);
+	ret = sst_ipc_batch_flush(&batch);
+	if (ret < 0)
+		dev_err(hsw->dev, "error: set mixer volumes failed\n");
+	return ret;
+}
+
 /* Stream API */
 struct sst_hsw_stream *sst_hsw_stream_new(struct sst_hsw *hsw, int id,
 	u32 (*notify_position)(struct sst_hsw_stream *stream, void *data),
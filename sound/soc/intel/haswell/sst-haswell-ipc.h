@@ -410,12 +410,16 @@ u32 create_channel_map(enum sst_hsw_channel_config config);
 /* Stream Mixer Controls - */
 int sst_hsw_stream_set_volume(struct sst_hsw *hsw,
 	struct sst_hsw_stream *stream, u32 stage_id, u32 channel, u32 volume);
+int sst_hsw_stream_set_volumes(struct sst_hsw *hsw,
+	struct sst_hsw_stream *stream, u32 stage_id, const u32 *volume);
 int sst_hsw_stream_get_volume(struct sst_hsw *hsw,
 	struct sst_hsw_stream *stream, u32 stage_id, u32 channel, u32 *volume);
 
 /* Global Mixer Controls - */
 int sst_hsw_mixer_set_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
 	u32 volume);
+int sst_hsw_mixer_set_volumes(struct sst_hsw *hsw, u32 stage_id,
+	const u32 *volume);
 int sst_hsw_mixer_get_volume(struct sst_hsw *hsw, u32 stage_id, u32 channel,
 	u32 *volume);
 
@@ -188,7 +188,7 @@ static int hsw_stream_volume_put(struct snd_kcontrol *kcontrol,
 		snd_soc_platform_get_drvdata(platform);
 	struct hsw_pcm_data *pcm_data;
 	struct sst_hsw *hsw = pdata->hsw;
-	u32 volume;
+	u32 volume[2];
 	int dai, stream;
 
 	dai = mod_map[mc->reg].dai_id;
@@ -209,17 +209,10 @@ static int hsw_stream_volume_put(struct snd_kcontrol *kcontrol,
 		return 0;
 	}
 
-	if (ucontrol->value.integer.value[0] ==
-		ucontrol->value.integer.value[1]) {
-		volume = hsw_mixer_to_ipc(ucontrol->value.integer.value[0]);
-		/* apply volume value to all channels */
-		sst_hsw_stream_set_volume(hsw, pcm_data->stream, 0, SST_HSW_CHANNELS_ALL, volume);
-	} else {
-		volume = hsw_mixer_to_ipc(ucontrol->value.integer.value[0]);
-		sst_hsw_stream_set_volume(hsw, pcm_data->stream, 0, 0, volume);
-		volume = hsw_mixer_to_ipc(ucontrol->value.integer.value[1]);
-		sst_hsw_stream_set_volume(hsw, pcm_data->stream, 0, 1, volume);
-	}
+	volume[0] = hsw_mixer_to_ipc(ucontrol->value.integer.value[0]);
+	volume[1] = hsw_mixer_to_ipc(ucontrol->value.integer.value[1]);
+	/* equal volumes are applied to all channels at once */
+	sst_hsw_stream_set_volumes(hsw, pcm_data->stream, 0, volume);
 
 	pm_runtime_mark_last_busy(pdata->dev);
 	pm_runtime_put_autosuspend(pdata->dev);
@@ -276,23 +269,13 @@ static int hsw_volume_put(struct snd_kcontrol *kcontrol,
 	struct snd_soc_platform *platform = snd_soc_kcontrol_platform(kcontrol);
 	struct hsw_priv_data *pdata = snd_soc_platform_get_drvdata(platform);
 	struct sst_hsw *hsw = pdata->hsw;
-	u32 volume;
+	u32 volume[2];
 
 	pm_runtime_get_sync(pdata->dev);
 
-	if (ucontrol->value.integer.value[0] ==
-		ucontrol->value.integer.value[1]) {
-
-		volume = hsw_mixer_to_ipc(ucontrol->value.integer.value[0]);
-		sst_hsw_mixer_set_volume(hsw, 0, SST_HSW_CHANNELS_ALL, volume);
-
-	} else {
-		volume = hsw_mixer_to_ipc(ucontrol->value.integer.value[0]);
-		sst_hsw_mixer_set_volume(hsw, 0, 0, volume);
-
-		volume = hsw_mixer_to_ipc(ucontrol->value.integer.value[1]);
-		sst_hsw_mixer_set_volume(hsw, 0, 1, volume);
-	}
+	volume[0] = hsw_mixer_to_ipc(ucontrol->value.integer.value[0]);
+	volume[1] = hsw_mixer_to_ipc(ucontrol->value.integer.value[1]);
+	sst_hsw_mixer_set_volumes(hsw, 0, volume);
 
 	pm_runtime_mark_last_busy(pdata->dev);
 	pm_runtime_put_autosuspend(pdata->dev);
@@ -651,10 +634,8 @@ static int hsw_pcm_hw_params(struct snd_pcm_substream *substream,
 
 	if (!pcm_data->allocated) {
 		/* Set previous saved volume */
-		sst_hsw_stream_set_volume(hsw, pcm_data->stream, 0,
-				0, pcm_data->volume[0]);
-		sst_hsw_stream_set_volume(hsw, pcm_data->stream, 0,
-				1, pcm_data->volume[1]);
+		sst_hsw_stream_set_volumes(hsw, pcm_data->stream, 0,
+				pcm_data->volume);
 		pcm_data->allocated = true;
 	}
 
@@ -27,10 +27,18 @@
 struct lpass_pcm_data {
 	int dma_ch;
 	int i2s_port;
+
+	/* period wakeups from a timer, see period_timer */
+	struct snd_pcm_period_timer timer;
 };
 
+static bool period_timer;
+module_param(period_timer, bool, 0444);
+MODULE_PARM_DESC(period_timer, "Wake up periods from a timer instead of DMA interrupts, with a larger buffer.");
+
 #define LPASS_PLATFORM_BUFFER_SIZE	(16 * 1024)
 #define LPASS_PLATFORM_PERIODS		2
+#define LPASS_PLATFORM_TIMER_BUFFER_SIZE	(256 * 1024)
 
 static const struct snd_pcm_hardware lpass_platform_pcm_hardware = {
 	.info			=	SNDRV_PCM_INFO_MMAP |
@@ -56,6 +64,59 @@ static const struct snd_pcm_hardware lpass_platform_pcm_hardware = {
 	.fifo_size		=	0,
 };
 
+/*
+ * With period_timer the DMA never interrupts for periods, so their size is
+ * up to the application; the position always comes from the current
+ * address register.
+ */
+static const struct snd_pcm_hardware lpass_platform_timer_pcm_hardware = {
+	.info			=	SNDRV_PCM_INFO_MMAP |
+					SNDRV_PCM_INFO_MMAP_VALID |
+					SNDRV_PCM_INFO_INTERLEAVED |
+					SNDRV_PCM_INFO_PAUSE |
+					SNDRV_PCM_INFO_RESUME |
+					SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
+	.formats		=	SNDRV_PCM_FMTBIT_S16 |
+					SNDRV_PCM_FMTBIT_S24 |
+					SNDRV_PCM_FMTBIT_S32,
+	.rates			=	SNDRV_PCM_RATE_8000_192000,
+	.rate_min		=	8000,
+	.rate_max		=	192000,
+	.channels_min		=	1,
+	.channels_max		=	8,
+	.buffer_bytes_max	=	LPASS_PLATFORM_TIMER_BUFFER_SIZE,
+	.period_bytes_max	=	LPASS_PLATFORM_TIMER_BUFFER_SIZE /
+						LPASS_PLATFORM_PERIODS,
+	.period_bytes_min	=	256,
+	.periods_min		=	LPASS_PLATFORM_PERIODS,
+	.periods_max		=	LPASS_PLATFORM_TIMER_BUFFER_SIZE / 256,
+	.fifo_size		=	0,
+};
+
+static const struct snd_pcm_hardware *lpass_platform_hardware(void)
+{
+	if (period_timer)
+		return &lpass_platform_timer_pcm_hardware;
+
+	return &lpass_platform_pcm_hardware;
+}
+
+static void lpass_platform_start_timer(struct snd_pcm_substream *substream)
+{
+	struct lpass_pcm_data *data = substream->runtime->private_data;
+
+	if (period_timer)
+		snd_pcm_period_timer_start(&data->timer);
+}
+
+static void lpass_platform_stop_timer(struct snd_pcm_substream *substream)
+{
+	struct lpass_pcm_data *data = substream->runtime->private_data;
+
+	if (period_timer)
+		snd_pcm_period_timer_stop(&data->timer);
+}
+
 static int lpass_platform_pcmops_open(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -72,6 +133,7 @@ static int lpass_platform_pcmops_open(struct snd_pcm_substream *substream)
 		return -ENOMEM;
 
 	data->i2s_port = cpu_dai->driver->id;
+	snd_pcm_period_timer_init(&data->timer, substream);
 	runtime->private_data = data;
 
 	dma_ch = 0;
@@ -95,9 +157,9 @@ static int lpass_platform_pcmops_open(struct snd_pcm_substream *substream)
 
 	data->dma_ch = dma_ch;
 
-	snd_soc_set_runtime_hwparams(substream, &lpass_platform_pcm_hardware);
+	snd_soc_set_runtime_hwparams(substream, lpass_platform_hardware());
 
-	runtime->dma_bytes = lpass_platform_pcm_hardware.buffer_bytes_max;
+	runtime->dma_bytes = lpass_platform_hardware()->buffer_bytes_max;
 
 	ret = snd_pcm_hw_constraint_integer(runtime,
 			SNDRV_PCM_HW_PARAM_PERIODS);
@@ -122,6 +184,7 @@ static int lpass_platform_pcmops_close(struct snd_pcm_substream *substream)
 	struct lpass_pcm_data *data;
 
 	data = runtime->private_data;
+	snd_pcm_period_timer_sync(&data->timer);
 	v = drvdata->variant;
 	drvdata->substream[data->dma_ch] = NULL;
 	if (v->free_dma_channel)
@@ -275,9 +338,11 @@ static int lpass_platform_pcmops_prepare(struct snd_pcm_substream *substream)
 		return ret;
 	}
 
+	/* with period_timer a single DMA period spans the buffer */
 	ret = regmap_write(drvdata->lpaif_map,
 			LPAIF_DMAPER_REG(v, ch, dir),
-			(snd_pcm_lib_period_bytes(substream) >> 2) - 1);
+			((period_timer ? snd_pcm_lib_buffer_bytes(substream) :
+			  snd_pcm_lib_period_bytes(substream)) >> 2) - 1);
 	if (ret) {
 		dev_err(soc_runtime->dev, "error writing to rdmaper reg: %d\n",
 			ret);
@@ -306,9 +371,16 @@ static int lpass_platform_pcmops_trigger(struct snd_pcm_substream *substream,
 	struct lpass_pcm_data *pcm_data = rt->private_data;
 	struct lpass_variant *v = drvdata->variant;
 	int ret, ch, dir = substream->stream;
+	unsigned int irqs;
 
 	ch = pcm_data->dma_ch;
 
+	/* only xrun and bus errors are signalled when periods are timed */
+	if (period_timer)
+		irqs = LPAIF_IRQ_XRUN(ch) | LPAIF_IRQ_ERR(ch);
+	else
+		irqs = LPAIF_IRQ_ALL(ch);
+
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_RESUME:
@@ -325,8 +397,7 @@ static int lpass_platform_pcmops_trigger(struct snd_pcm_substream *substream,
 
 		ret = regmap_update_bits(drvdata->lpaif_map,
 				LPAIF_IRQEN_REG(v, LPAIF_IRQ_PORT_HOST),
-				LPAIF_IRQ_ALL(ch),
-				LPAIF_IRQ_ALL(ch));
+				LPAIF_IRQ_ALL(ch), irqs);
 		if (ret) {
 			dev_err(soc_runtime->dev,
 				"error writing to irqen reg: %d\n", ret);
@@ -342,10 +413,12 @@ static int lpass_platform_pcmops_trigger(struct snd_pcm_substream *substream,
 				"error writing to rdmactl reg: %d\n", ret);
 			return ret;
 		}
+		lpass_platform_start_timer(substream);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		lpass_platform_stop_timer(substream);
 		ret = regmap_update_bits(drvdata->lpaif_map,
 				LPAIF_DMACTL_REG(v, ch, dir),
 				LPAIF_DMACTL_ENABLE_MASK,
@@ -512,7 +585,7 @@ static int lpass_platform_pcm_new(struct snd_soc_pcm_runtime *soc_runtime)
 	struct snd_pcm *pcm = soc_runtime->pcm;
 	struct snd_pcm_substream *psubstream, *csubstream;
 	int ret = -EINVAL;
-	size_t size = lpass_platform_pcm_hardware.buffer_bytes_max;
+	size_t size = lpass_platform_hardware()->buffer_bytes_max;
 
 	psubstream = pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream;
 	if (psubstream) {
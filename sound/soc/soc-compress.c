@@ -641,6 +641,22 @@ static int soc_compr_copy(struct snd_compr_stream *cstream,
 	return ret;
 }
 
+static int soc_compr_mmap(struct snd_compr_stream *cstream,
+			  struct vm_area_struct *vma)
+{
+	struct snd_soc_pcm_runtime *rtd = cstream->private_data;
+	struct snd_soc_platform *platform = rtd->platform;
+	int ret = 0;
+
+	mutex_lock_nested(&rtd->pcm_mutex, rtd->pcm_subclass);
+
+	if (platform->driver->compr_ops && platform->driver->compr_ops->mmap)
+		ret = platform->driver->compr_ops->mmap(cstream, vma);
+
+	mutex_unlock(&rtd->pcm_mutex);
+	return ret;
+}
+
 static int soc_compr_set_metadata(struct snd_compr_stream *cstream,
 				struct snd_compr_metadata *metadata)
 {
@@ -802,6 +818,10 @@ int snd_soc_new_compress(struct snd_soc_pcm_runtime *rtd, int num)
 	if (platform->driver->compr_ops && platform->driver->compr_ops->copy)
 		compr->ops->copy = soc_compr_copy;
 
+	/* Let the application map DSP memory directly */
+	if (platform->driver->compr_ops && platform->driver->compr_ops->mmap)
+		compr->ops->mmap = soc_compr_mmap;
+
 	mutex_init(&compr->lock);
 	ret = snd_compress_new(rtd->card->snd_card, num, direction,
 				new_name, compr);
@@ -644,6 +644,8 @@ static struct snd_soc_pcm_runtime *soc_new_pcm_runtime(
 
 static void soc_free_pcm_runtime(struct snd_soc_pcm_runtime *rtd)
 {
+	kfree(rtd->dpcm[SNDRV_PCM_STREAM_PLAYBACK].path_cache);
+	kfree(rtd->dpcm[SNDRV_PCM_STREAM_CAPTURE].path_cache);
 	kfree(rtd->codec_dais);
 	snd_soc_rtdcom_del_all(rtd);
 	kfree(rtd);
@@ -2450,6 +2452,13 @@ static int soc_cleanup_card_resources(struct snd_soc_card *card)
 	list_for_each_entry(rtd, &card->rtd_list, list)
 		flush_delayed_work(&rtd->delayed_work);
 
+	/*
+	 * the ramps refer to the controls freed with the ALSA card; stop
+	 * them once no new control write can come in
+	 */
+	snd_card_disconnect(card->snd_card);
+	snd_soc_volsw_ramp_free(card);
+
 	/* free the ALSA card at first; this syncs with pending operations */
 	snd_card_free(card->snd_card);
 
@@ -3063,6 +3072,7 @@ int snd_soc_register_card(struct snd_soc_card *card)
 
 	INIT_LIST_HEAD(&card->dapm_dirty);
 	INIT_LIST_HEAD(&card->dobj_list);
+	snd_soc_volsw_ramp_init(card);
 	card->instantiated = 0;
 	mutex_init(&card->mutex);
 	mutex_init(&card->dapm_mutex);
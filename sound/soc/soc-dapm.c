@@ -157,6 +157,17 @@ static void pop_dbg(struct device *dev, u32 pop_time, const char *fmt, ...)
 	kfree(buf);
 }
 
+/*
+ * Called whenever the set of paths between widgets, or the endpoints they
+ * end at, may have changed; this drops the DPCM path tables cached by
+ * dpcm_path_get().
+ */
+static void dapm_routes_changed(struct snd_soc_card *card)
+{
+	if (card)
+		card->dapm_route_gen++;
+}
+
 static bool dapm_dirty_widget(struct snd_soc_dapm_widget *w)
 {
 	return !list_empty(&w->dirty);
@@ -281,6 +292,9 @@ void dapm_mark_endpoints_dirty(struct snd_soc_card *card)
 
 	mutex_lock(&card->dapm_mutex);
 
+	/* endpoints depend on the suspend state */
+	dapm_routes_changed(card);
+
 	list_for_each_entry(w, &card->widgets, list) {
 		if (w->is_ep) {
 			dapm_mark_dirty(w, "Rechecking endpoints");
@@ -501,7 +515,8 @@ unsigned int dapm_kcontrol_get_value(const struct snd_kcontrol *kcontrol)
 {
 	struct dapm_kcontrol_data *data = snd_kcontrol_chip(kcontrol);
 
-	return data->value;
+	/* may be read without dapm_mutex, see snd_soc_dapm_get_volsw() */
+	return READ_ONCE(data->value);
 }
 EXPORT_SYMBOL_GPL(dapm_kcontrol_get_value);
 
@@ -516,7 +531,7 @@ static bool dapm_kcontrol_set_value(const struct snd_kcontrol *kcontrol,
 	if (data->widget)
 		data->widget->on_val = value;
 
-	data->value = value;
+	WRITE_ONCE(data->value, value);
 
 	return true;
 }
@@ -577,13 +592,18 @@ static int soc_dapm_read(struct snd_soc_dapm_context *dapm, int reg,
 	return snd_soc_component_read(dapm->component, reg, value);
 }
 
+/*
+ * DAPM writes are queued asynchronously; soc_dapm_async_complete() is run
+ * before any widget event and at the end of each power sequence, so the
+ * writes of a whole sequence step can be in flight together.
+ */
 static int soc_dapm_update_bits(struct snd_soc_dapm_context *dapm,
 	int reg, unsigned int mask, unsigned int value)
 {
 	if (!dapm->component)
 		return -EIO;
-	return snd_soc_component_update_bits(dapm->component, reg,
-					     mask, value);
+	return snd_soc_component_update_bits_async(dapm->component, reg,
+						   mask, value);
 }
 
 static int soc_dapm_test_bits(struct snd_soc_dapm_context *dapm,
@@ -1452,50 +1472,95 @@ static void dapm_seq_check_event(struct snd_soc_card *card,
 		return;
 
 	if (w->event && (w->event_flags & event)) {
+		ktime_t start;
+		s64 ns;
+
 		pop_dbg(w->dapm->dev, card->pop_time, "pop test : %s %s\n",
 			w->name, ev_name);
 		soc_dapm_async_complete(w->dapm);
 		trace_snd_soc_dapm_widget_event_start(w, event);
+		start = ktime_get();
 		ret = w->event(w, NULL, event);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 		trace_snd_soc_dapm_widget_event_done(w, event);
+		trace_snd_soc_dapm_widget_time(w, event, ns);
+		w->event_ns += ns;
 		if (ret < 0)
 			dev_err(w->dapm->dev, "ASoC: %s: %s event failed: %d\n",
 			       ev_name, w->name, ret);
 	}
 }
 
-/* Apply the coalesced changes from a DAPM sequence */
-static void dapm_seq_run_coalesced(struct snd_soc_card *card,
-				   struct list_head *pending)
+/* Update the power of widgets sharing a register and run their PRE
+ * events; returns the bits of the coalesced write in mask and value.
+ */
+static void dapm_seq_coalesce(struct snd_soc_card *card,
+			      struct list_head *pending,
+			      unsigned int *mask, unsigned int *value)
 {
 	struct snd_soc_dapm_context *dapm;
 	struct snd_soc_dapm_widget *w;
 	int reg;
-	unsigned int value = 0;
-	unsigned int mask = 0;
 
 	w = list_first_entry(pending, struct snd_soc_dapm_widget, power_list);
 	reg = w->reg;
 	dapm = w->dapm;
+	*mask = 0;
+	*value = 0;
 
 	list_for_each_entry(w, pending, power_list) {
 		WARN_ON(reg != w->reg || dapm != w->dapm);
 		w->power = w->new_power;
+		w->power_count++;
 
-		mask |= w->mask << w->shift;
+		*mask |= w->mask << w->shift;
 		if (w->power)
-			value |= w->on_val << w->shift;
+			*value |= w->on_val << w->shift;
 		else
-			value |= w->off_val << w->shift;
+			*value |= w->off_val << w->shift;
 
 		pop_dbg(dapm->dev, card->pop_time,
 			"pop test : Queue %s: reg=0x%x, 0x%x/0x%x\n",
-			w->name, reg, value, mask);
+			w->name, reg, *value, *mask);
 
 		/* Check for events */
 		dapm_seq_check_event(card, w, SND_SOC_DAPM_PRE_PMU);
 		dapm_seq_check_event(card, w, SND_SOC_DAPM_PRE_PMD);
 	}
+}
+
+/* Run the POST events of a coalesced write */
+static void dapm_seq_coalesce_done(struct snd_soc_card *card,
+				   struct list_head *pending,
+				   s64 pop_ns, s64 write_ns)
+{
+	struct snd_soc_dapm_widget *w;
+
+	/* the widgets share the write, each is charged all of it */
+	list_for_each_entry(w, pending, power_list) {
+		w->pop_ns += pop_ns;
+		w->write_ns += write_ns;
+		dapm_seq_check_event(card, w, SND_SOC_DAPM_POST_PMU);
+		dapm_seq_check_event(card, w, SND_SOC_DAPM_POST_PMD);
+	}
+}
+
+/* Apply the coalesced changes from a DAPM sequence */
+static void dapm_seq_run_coalesced(struct snd_soc_card *card,
+				   struct list_head *pending)
+{
+	struct snd_soc_dapm_context *dapm;
+	struct snd_soc_dapm_widget *w;
+	int reg;
+	unsigned int value, mask;
+	ktime_t start;
+	s64 pop_ns = 0, write_ns = 0;
+
+	w = list_first_entry(pending, struct snd_soc_dapm_widget, power_list);
+	reg = w->reg;
+	dapm = w->dapm;
+
+	dapm_seq_coalesce(card, pending, &mask, &value);
 
 	if (reg >= 0) {
 		/* Any widget will do, they should all be updating the
@@ -1505,13 +1570,164 @@ static void dapm_seq_run_coalesced(struct snd_soc_card *card,
 		pop_dbg(dapm->dev, card->pop_time,
 			"pop test : Applying 0x%x/0x%x to %x in %dms\n",
 			value, mask, reg, card->pop_time);
+		start = ktime_get();
 		pop_wait(card->pop_time);
+		pop_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		/* only the queueing when the write goes out asynchronously */
+		start = ktime_get();
 		soc_dapm_update_bits(dapm, reg, mask, value);
+		write_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 	}
 
-	list_for_each_entry(w, pending, power_list) {
-		dapm_seq_check_event(card, w, SND_SOC_DAPM_POST_PMU);
-		dapm_seq_check_event(card, w, SND_SOC_DAPM_POST_PMD);
+	dapm_seq_coalesce_done(card, pending, pop_ns, write_ns);
+}
+
+/* Write the register of the widgets a context has in seq_group; runs
+ * from the async domain, so the widget events stay with the caller,
+ * which holds dapm_mutex
+ */
+static void dapm_seq_write_context(void *data, async_cookie_t cookie)
+{
+	struct snd_soc_dapm_context *d = data;
+	struct snd_soc_dapm_widget *w;
+	ktime_t start = ktime_get();
+
+	w = list_first_entry(&d->seq_group, struct snd_soc_dapm_widget,
+			     power_list);
+	soc_dapm_update_bits(d, w->reg, d->seq_mask, d->seq_value);
+	soc_dapm_async_complete(d);
+	d->seq_write_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+/* Move the next widgets of a context sharing a register to seq_group */
+static void dapm_seq_next_group(struct snd_soc_dapm_context *d)
+{
+	struct snd_soc_dapm_widget *w, *last;
+
+	last = list_first_entry(&d->seq_pending, struct snd_soc_dapm_widget,
+				power_list);
+	w = last;
+	list_for_each_entry_continue(w, &d->seq_pending, power_list) {
+		if (w->reg != last->reg)
+			break;
+		last = w;
+	}
+	list_cut_position(&d->seq_group, &d->seq_pending, &last->power_list);
+}
+
+static void dapm_seq_run_pre_post(struct snd_soc_dapm_widget *w, int event)
+{
+	int ret = 0;
+
+	if (!w->event)
+		return;
+
+	if (w->id == snd_soc_dapm_pre) {
+		if (event == SND_SOC_DAPM_STREAM_START)
+			ret = w->event(w, NULL, SND_SOC_DAPM_PRE_PMU);
+		else if (event == SND_SOC_DAPM_STREAM_STOP)
+			ret = w->event(w, NULL, SND_SOC_DAPM_PRE_PMD);
+	} else {
+		if (event == SND_SOC_DAPM_STREAM_START)
+			ret = w->event(w, NULL, SND_SOC_DAPM_POST_PMU);
+		else if (event == SND_SOC_DAPM_STREAM_STOP)
+			ret = w->event(w, NULL, SND_SOC_DAPM_POST_PMD);
+	}
+
+	if (ret < 0)
+		dev_err(w->dapm->dev,
+			"ASoC: Failed to apply widget power: %d\n", ret);
+}
+
+/* Apply a DAPM power sequence with the contexts of each sequence level
+ * (sort order and subsequence) writing their registers in parallel.
+ * Each context writes one register at a time, and all writes are done
+ * before the next round, so the ordering a single component sees is
+ * unchanged; every level is a barrier as well.  The widget events run
+ * here under dapm_mutex, between the rounds.  Pre and post widgets run
+ * on their own, as before.
+ */
+static void dapm_seq_run_parallel(struct snd_soc_card *card,
+	struct list_head *list, int event, bool power_up)
+{
+	struct snd_soc_dapm_widget *w, *n;
+	struct snd_soc_dapm_context *d;
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	int cur_sort, cur_subseq, i;
+	bool more;
+	int *sort;
+
+	if (power_up)
+		sort = dapm_up_seq;
+	else
+		sort = dapm_down_seq;
+
+	list_for_each_entry(d, &card->dapm_list, list) {
+		INIT_LIST_HEAD(&d->seq_pending);
+		INIT_LIST_HEAD(&d->seq_group);
+	}
+
+	while (!list_empty(list)) {
+		w = list_first_entry(list, struct snd_soc_dapm_widget,
+				     power_list);
+
+		if (w->id == snd_soc_dapm_pre || w->id == snd_soc_dapm_post) {
+			list_del_init(&w->power_list);
+			dapm_seq_run_pre_post(w, event);
+			continue;
+		}
+
+		/* The list is sorted, so a level is a run of widgets */
+		cur_sort = sort[w->id];
+		cur_subseq = w->subseq;
+		list_for_each_entry_safe(w, n, list, power_list) {
+			if (w->id == snd_soc_dapm_pre ||
+			    w->id == snd_soc_dapm_post ||
+			    sort[w->id] != cur_sort || w->subseq != cur_subseq)
+				break;
+			list_move_tail(&w->power_list, &w->dapm->seq_pending);
+		}
+
+		list_for_each_entry(d, &card->dapm_list, list)
+			d->seq_active = !list_empty(&d->seq_pending);
+
+		do {
+			list_for_each_entry(d, &card->dapm_list, list) {
+				if (list_empty(&d->seq_pending))
+					continue;
+				dapm_seq_next_group(d);
+				dapm_seq_coalesce(card, &d->seq_group,
+						  &d->seq_mask, &d->seq_value);
+				d->seq_write_ns = 0;
+				w = list_first_entry(&d->seq_group,
+						     struct snd_soc_dapm_widget,
+						     power_list);
+				if (w->reg >= 0)
+					async_schedule_domain(dapm_seq_write_context,
+							      d, &async_domain);
+			}
+			async_synchronize_full_domain(&async_domain);
+
+			more = false;
+			list_for_each_entry(d, &card->dapm_list, list) {
+				if (list_empty(&d->seq_group))
+					continue;
+				dapm_seq_coalesce_done(card, &d->seq_group, 0,
+						       d->seq_write_ns);
+				INIT_LIST_HEAD(&d->seq_group);
+				if (!list_empty(&d->seq_pending))
+					more = true;
+			}
+		} while (more);
+
+		list_for_each_entry(d, &card->dapm_list, list) {
+			if (!d->seq_active || !d->seq_notifier)
+				continue;
+			for (i = 0; i < ARRAY_SIZE(dapm_up_seq); i++)
+				if (sort[i] == cur_sort)
+					d->seq_notifier(d, i, cur_subseq);
+		}
 	}
 }
 
@@ -1533,17 +1749,21 @@ static void dapm_seq_run(struct snd_soc_card *card,
 	int cur_subseq = -1;
 	int cur_reg = SND_SOC_NOPM;
 	struct snd_soc_dapm_context *cur_dapm = NULL;
-	int ret, i;
+	int i;
 	int *sort;
 
+	/* pop_time is for listening to each write, keep those serial */
+	if (card->parallel_dapm_seq && !card->pop_time) {
+		dapm_seq_run_parallel(card, list, event, power_up);
+		return;
+	}
+
 	if (power_up)
 		sort = dapm_up_seq;
 	else
 		sort = dapm_down_seq;
 
 	list_for_each_entry_safe(w, n, list, power_list) {
-		ret = 0;
-
 		/* Do we need to apply any queued changes? */
 		if (sort[w->id] != cur_sort || w->reg != cur_reg ||
 		    w->dapm != cur_dapm || w->subseq != cur_subseq) {
@@ -1570,29 +1790,8 @@ static void dapm_seq_run(struct snd_soc_card *card,
 
 		switch (w->id) {
 		case snd_soc_dapm_pre:
-			if (!w->event)
-				list_for_each_entry_safe_continue(w, n, list,
-								  power_list);
-
-			if (event == SND_SOC_DAPM_STREAM_START)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_PRE_PMU);
-			else if (event == SND_SOC_DAPM_STREAM_STOP)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_PRE_PMD);
-			break;
-
 		case snd_soc_dapm_post:
-			if (!w->event)
-				list_for_each_entry_safe_continue(w, n, list,
-								  power_list);
-
-			if (event == SND_SOC_DAPM_STREAM_START)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_POST_PMU);
-			else if (event == SND_SOC_DAPM_STREAM_STOP)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_POST_PMD);
+			dapm_seq_run_pre_post(w, event);
 			break;
 
 		default:
@@ -1604,10 +1803,6 @@ static void dapm_seq_run(struct snd_soc_card *card,
 			list_move(&w->power_list, &pending);
 			break;
 		}
-
-		if (ret < 0)
-			dev_err(w->dapm->dev,
-				"ASoC: Failed to apply widget power: %d\n", ret);
 	}
 
 	if (!list_empty(&pending))
@@ -1667,6 +1862,8 @@ static void dapm_widget_update(struct snd_soc_card *card)
 				w->name, ret);
 	}
 
+	soc_dapm_async_complete(w->dapm);
+
 	for (wi = 0; wi < wlist->num_widgets; wi++) {
 		w = wlist->widgets[wi];
 
@@ -1834,6 +2031,17 @@ static bool dapm_idle_bias_off(struct snd_soc_dapm_context *dapm)
 	return false;
 }
 
+/* True if no context in the card has a bias transition pending */
+static bool dapm_bias_settled(struct snd_soc_card *card)
+{
+	struct snd_soc_dapm_context *d;
+
+	list_for_each_entry(d, &card->dapm_list, list)
+		if (d->bias_level != d->target_bias_level)
+			return false;
+	return true;
+}
+
 /*
  * Scan each dapm widget for complete audio path.
  * A complete path is a route that has valid endpoints i.e.:-
@@ -1851,6 +2059,7 @@ static int dapm_power_widgets(struct snd_soc_card *card, int event)
 	LIST_HEAD(down_list);
 	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
 	enum snd_soc_bias_level bias;
+	ktime_t start;
 
 	lockdep_assert_held(&card->dapm_mutex);
 
@@ -1928,6 +2137,16 @@ static int dapm_power_widgets(struct snd_soc_card *card, int event)
 
 	trace_snd_soc_dapm_walk_done(card);
 
+	/* The walk only visits dirty widgets; if none of them changed
+	 * power and no context needs a new bias level there is nothing
+	 * to sequence, just apply any pending register update.
+	 */
+	if (list_empty(&up_list) && list_empty(&down_list) &&
+	    dapm_bias_settled(card)) {
+		dapm_widget_update(card);
+		goto out;
+	}
+
 	/* Run card bias changes at first */
 	dapm_pre_sequence_async(&card->dapm, 0);
 	/* Run other bias changes in parallel */
@@ -1947,12 +2166,18 @@ static int dapm_power_widgets(struct snd_soc_card *card, int event)
 	}
 
 	/* Power down widgets first; try to avoid amplifying pops. */
+	start = ktime_get();
 	dapm_seq_run(card, &down_list, event, false);
+	trace_snd_soc_dapm_seq_time(card, false,
+				    ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	dapm_widget_update(card);
 
 	/* Now power up. */
+	start = ktime_get();
 	dapm_seq_run(card, &up_list, event, true);
+	trace_snd_soc_dapm_seq_time(card, true,
+				    ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	/* Run all the bias changes in parallel */
 	list_for_each_entry(d, &card->dapm_list, list) {
@@ -1964,16 +2189,17 @@ static int dapm_power_widgets(struct snd_soc_card *card, int event)
 	/* Run card bias changes at last */
 	dapm_post_sequence_async(&card->dapm, 0);
 
+	pop_dbg(card->dev, card->pop_time,
+		"DAPM sequencing finished, waiting %dms\n", card->pop_time);
+	pop_wait(card->pop_time);
+
+out:
 	/* do we need to notify any clients that DAPM event is complete */
 	list_for_each_entry(d, &card->dapm_list, list) {
 		if (d->stream_event)
 			d->stream_event(d, event);
 	}
 
-	pop_dbg(card->dev, card->pop_time,
-		"DAPM sequencing finished, waiting %dms\n", card->pop_time);
-	pop_wait(card->pop_time);
-
 	trace_snd_soc_dapm_done(card);
 
 	return 0;
@@ -2023,6 +2249,14 @@ static ssize_t dapm_widget_power_read_file(struct file *file,
 				w->sname,
 				w->active ? "active" : "inactive");
 
+	if (w->power_count)
+		ret += snprintf(buf + ret, PAGE_SIZE - ret,
+				" time %llu us events, %llu us writes, %llu us pop waits over %u power changes\n",
+				div_u64(w->event_ns, NSEC_PER_USEC),
+				div_u64(w->write_ns, NSEC_PER_USEC),
+				div_u64(w->pop_ns, NSEC_PER_USEC),
+				w->power_count);
+
 	snd_soc_dapm_for_each_direction(dir) {
 		rdir = SND_SOC_DAPM_DIR_REVERSE(dir);
 		snd_soc_dapm_widget_for_each_path(w, dir, p) {
@@ -2168,6 +2402,7 @@ static void soc_dapm_connect_path(struct snd_soc_dapm_path *path,
 	dapm_mark_dirty(path->source, reason);
 	dapm_mark_dirty(path->sink, reason);
 	dapm_path_invalidate(path);
+	dapm_routes_changed(path->source->dapm->card);
 }
 
 /* test and update the power status of a mux widget */
@@ -2373,6 +2608,7 @@ struct attribute *soc_dapm_dev_attrs[] = {
 
 static void dapm_free_path(struct snd_soc_dapm_path *path)
 {
+	dapm_routes_changed(path->source->dapm->card);
 	list_del(&path->list_node[SND_SOC_DAPM_DIR_IN]);
 	list_del(&path->list_node[SND_SOC_DAPM_DIR_OUT]);
 	list_del(&path->list_kcontrol);
@@ -2458,6 +2694,7 @@ static int snd_soc_dapm_set_pin(struct snd_soc_dapm_context *dapm,
 		dapm_mark_dirty(w, "pin configuration");
 		dapm_widget_invalidate_input_paths(w);
 		dapm_widget_invalidate_output_paths(w);
+		dapm_routes_changed(dapm->card);
 	}
 
 	w->connected = status;
@@ -2710,6 +2947,7 @@ static int snd_soc_dapm_add_path(struct snd_soc_dapm_context *dapm,
 
 	if (dapm->card->instantiated && path->connect)
 		dapm_path_invalidate(path);
+	dapm_routes_changed(dapm->card);
 
 	return 0;
 err:
@@ -3101,10 +3339,17 @@ int snd_soc_dapm_get_volsw(struct snd_kcontrol *kcontrol,
 	unsigned int mask = (1 << fls(max)) - 1;
 	unsigned int invert = mc->invert;
 	unsigned int reg_val, val, rval = 0;
+	bool locked = reg != SND_SOC_NOPM;
 	int ret = 0;
 
-	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
-	if (dapm_kcontrol_is_powered(kcontrol) && reg != SND_SOC_NOPM) {
+	/*
+	 * A virtual control only has its cached value, which is a single
+	 * word, so don't contend with power updates and stream events for
+	 * dapm_mutex just to read it.
+	 */
+	if (locked)
+		mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
+	if (reg != SND_SOC_NOPM && dapm_kcontrol_is_powered(kcontrol)) {
 		ret = soc_dapm_read(dapm, reg, &reg_val);
 		val = (reg_val >> shift) & mask;
 
@@ -3120,7 +3365,8 @@ int snd_soc_dapm_get_volsw(struct snd_kcontrol *kcontrol,
 		if (snd_soc_volsw_is_stereo(mc))
 			rval = (reg_val >> width) & mask;
 	}
-	mutex_unlock(&card->dapm_mutex);
+	if (locked)
+		mutex_unlock(&card->dapm_mutex);
 
 	if (ret)
 		return ret;
@@ -3250,17 +3496,23 @@ int snd_soc_dapm_get_enum_double(struct snd_kcontrol *kcontrol,
 	struct soc_enum *e = (struct soc_enum *)kcontrol->private_value;
 	unsigned int reg_val, val;
 
-	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
-	if (e->reg != SND_SOC_NOPM && dapm_kcontrol_is_powered(kcontrol)) {
-		int ret = soc_dapm_read(dapm, e->reg, &reg_val);
-		if (ret) {
-			mutex_unlock(&card->dapm_mutex);
-			return ret;
-		}
-	} else {
+	/* virtual muxes are read locklessly, as in snd_soc_dapm_get_volsw() */
+	if (e->reg == SND_SOC_NOPM) {
 		reg_val = dapm_kcontrol_get_value(kcontrol);
+	} else {
+		mutex_lock_nested(&card->dapm_mutex,
+				  SND_SOC_DAPM_CLASS_RUNTIME);
+		if (dapm_kcontrol_is_powered(kcontrol)) {
+			int ret = soc_dapm_read(dapm, e->reg, &reg_val);
+			if (ret) {
+				mutex_unlock(&card->dapm_mutex);
+				return ret;
+			}
+		} else {
+			reg_val = dapm_kcontrol_get_value(kcontrol);
+		}
+		mutex_unlock(&card->dapm_mutex);
 	}
-	mutex_unlock(&card->dapm_mutex);
 
 	val = (reg_val >> e->shift_l) & e->mask;
 	ucontrol->value.enumerated.item[0] = snd_soc_enum_val_to_item(e, val);
@@ -4100,10 +4352,14 @@ static void soc_dapm_dai_stream_event(struct snd_soc_dai *dai, int stream,
 		switch (event) {
 		case SND_SOC_DAPM_STREAM_START:
 			w->active = 1;
+			if (w->is_ep != ep)
+				dapm_routes_changed(w->dapm->card);
 			w->is_ep = ep;
 			break;
 		case SND_SOC_DAPM_STREAM_STOP:
 			w->active = 0;
+			if (w->is_ep)
+				dapm_routes_changed(w->dapm->card);
 			w->is_ep = 0;
 			break;
 		case SND_SOC_DAPM_STREAM_SUSPEND:
@@ -4132,15 +4388,20 @@ void snd_soc_dapm_connect_dai_link_widgets(struct snd_soc_card *card)
 	}
 }
 
-static void soc_dapm_stream_event(struct snd_soc_pcm_runtime *rtd, int stream,
-	int event)
+static void soc_dapm_rtd_stream_event(struct snd_soc_pcm_runtime *rtd,
+	int stream, int event)
 {
 	int i;
 
 	soc_dapm_dai_stream_event(rtd->cpu_dai, stream, event);
 	for (i = 0; i < rtd->num_codecs; i++)
 		soc_dapm_dai_stream_event(rtd->codec_dais[i], stream, event);
+}
 
+static void soc_dapm_stream_event(struct snd_soc_pcm_runtime *rtd, int stream,
+	int event)
+{
+	soc_dapm_rtd_stream_event(rtd, stream, event);
 	dapm_power_widgets(rtd->card, event);
 }
 
@@ -4165,6 +4426,41 @@ void snd_soc_dapm_stream_event(struct snd_soc_pcm_runtime *rtd, int stream,
 	mutex_unlock(&card->dapm_mutex);
 }
 
+/**
+ * snd_soc_dapm_stream_mark - flag a stream event without powering widgets
+ * @rtd: PCM runtime data
+ * @stream: stream name
+ * @event: stream event
+ *
+ * As snd_soc_dapm_stream_event(), but the widget power changes are left to
+ * the next snd_soc_dapm_stream_sync() so that the events of several
+ * streams are applied in a single DAPM run.
+ */
+void snd_soc_dapm_stream_mark(struct snd_soc_pcm_runtime *rtd, int stream,
+			      int event)
+{
+	struct snd_soc_card *card = rtd->card;
+
+	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
+	soc_dapm_rtd_stream_event(rtd, stream, event);
+	mutex_unlock(&card->dapm_mutex);
+}
+
+/**
+ * snd_soc_dapm_stream_sync - apply the stream events flagged on a card
+ * @card: the card
+ * @event: stream event handed to the stream_event callbacks
+ *
+ * Makes the widget power changes for the events flagged with
+ * snd_soc_dapm_stream_mark().
+ */
+void snd_soc_dapm_stream_sync(struct snd_soc_card *card, int event)
+{
+	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
+	dapm_power_widgets(card, event);
+	mutex_unlock(&card->dapm_mutex);
+}
+
 /**
  * snd_soc_dapm_enable_pin_unlocked - enable pin.
  * @dapm: DAPM context
@@ -4242,6 +4538,7 @@ int snd_soc_dapm_force_enable_pin_unlocked(struct snd_soc_dapm_context *dapm,
 		 */
 		dapm_widget_invalidate_input_paths(w);
 		dapm_widget_invalidate_output_paths(w);
+		dapm_routes_changed(dapm->card);
 		w->connected = 1;
 	}
 	w->force = 1;
@@ -4416,6 +4713,7 @@ int snd_soc_dapm_ignore_suspend(struct snd_soc_dapm_context *dapm,
 	}
 
 	w->ignore_suspend = 1;
+	dapm_routes_changed(dapm->card);
 
 	return 0;
 }
@@ -20,6 +20,7 @@
 #include <sound/pcm_params.h>
 #include <sound/soc.h>
 #include <linux/dma-mapping.h>
+#include <linux/genalloc.h>
 #include <linux/of.h>
 
 #include <sound/dmaengine_pcm.h>
@@ -214,7 +215,25 @@ static int dmaengine_pcm_open(struct snd_pcm_substream *substream)
 	if (ret)
 		return ret;
 
-	return snd_dmaengine_pcm_open(substream, chan);
+	ret = snd_dmaengine_pcm_open(substream, chan);
+	if (ret)
+		return ret;
+
+	if ((pcm->flags & SND_DMAENGINE_PCM_FLAG_PERIOD_TIMER) &&
+	    !(pcm->flags & SND_DMAENGINE_PCM_FLAG_NO_RESIDUE))
+		snd_dmaengine_pcm_use_period_timer(substream);
+
+	/* a bigger buffer would be reallocated outside of the on-chip RAM */
+	if (substream->dma_buffer.dev.type == SNDRV_DMA_TYPE_DEV_IRAM &&
+	    (pcm->flags & SND_DMAENGINE_PCM_FLAG_IRAM)) {
+		ret = snd_pcm_hw_constraint_minmax(substream->runtime,
+				SNDRV_PCM_HW_PARAM_BUFFER_BYTES, 0,
+				substream->dma_buffer.bytes);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
 }
 
 static struct dma_chan *dmaengine_pcm_compat_request_channel(
@@ -258,6 +277,26 @@ static bool dmaengine_pcm_can_report_residue(struct device *dev,
 	return true;
 }
 
+/* Largest buffer up to size the "iram" pool of dev can still hand out */
+static size_t dmaengine_pcm_iram_size(struct device *dev, size_t size)
+{
+#ifdef CONFIG_GENERIC_ALLOCATOR
+	struct gen_pool *pool;
+
+	if (!dev || !dev->of_node)
+		return 0;
+
+	pool = of_gen_pool_get(dev->of_node, "iram", 0);
+	if (!pool)
+		return 0;
+
+	return min_t(size_t, size,
+		     rounddown(gen_pool_avail(pool), PAGE_SIZE));
+#else
+	return 0;
+#endif
+}
+
 static int dmaengine_pcm_new(struct snd_soc_pcm_runtime *rtd)
 {
 	struct dmaengine_pcm *pcm = soc_platform_to_pcm(rtd->platform);
@@ -267,6 +306,7 @@ static int dmaengine_pcm_new(struct snd_soc_pcm_runtime *rtd)
 	struct snd_pcm_substream *substream;
 	size_t prealloc_buffer_size;
 	size_t max_buffer_size;
+	size_t prealloc_size, max_size, iram_size;
 	unsigned int i;
 	int ret;
 
@@ -301,11 +341,25 @@ static int dmaengine_pcm_new(struct snd_soc_pcm_runtime *rtd)
 			return -EINVAL;
 		}
 
+		prealloc_size = prealloc_buffer_size;
+		max_size = max_buffer_size;
+
+		if ((pcm->flags & SND_DMAENGINE_PCM_FLAG_IRAM) &&
+		    i == SNDRV_PCM_STREAM_PLAYBACK) {
+			iram_size = dmaengine_pcm_iram_size(
+				dmaengine_dma_dev(pcm, substream),
+				prealloc_buffer_size);
+			if (iram_size)
+				prealloc_size = max_size = iram_size;
+			else
+				dev_warn(dev,
+					 "No on-chip RAM, playback buffer in system memory\n");
+		}
+
 		ret = snd_pcm_lib_preallocate_pages(substream,
 				SNDRV_DMA_TYPE_DEV_IRAM,
 				dmaengine_dma_dev(pcm, substream),
-				prealloc_buffer_size,
-				max_buffer_size);
+				prealloc_size, max_size);
 		if (ret)
 			return ret;
 
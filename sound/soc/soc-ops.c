@@ -24,6 +24,8 @@
 #include <linux/bitops.h>
 #include <linux/ctype.h>
 #include <linux/slab.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
 #include <sound/core.h>
 #include <sound/jack.h>
 #include <sound/pcm.h>
@@ -294,22 +296,10 @@ int snd_soc_get_volsw(struct snd_kcontrol *kcontrol,
 }
 EXPORT_SYMBOL_GPL(snd_soc_get_volsw);
 
-/**
- * snd_soc_put_volsw - single mixer put callback
- * @kcontrol: mixer control
- * @ucontrol: control element information
- *
- * Callback to set the value of a single mixer control, or a double mixer
- * control that spans 2 registers.
- *
- * Returns 0 for success.
- */
-int snd_soc_put_volsw(struct snd_kcontrol *kcontrol,
-	struct snd_ctl_elem_value *ucontrol)
+/* write the control values of a single or double mixer control */
+static int soc_volsw_write(struct snd_soc_component *component,
+			   struct soc_mixer_control *mc, const long *values)
 {
-	struct snd_soc_component *component = snd_kcontrol_chip(kcontrol);
-	struct soc_mixer_control *mc =
-		(struct soc_mixer_control *)kcontrol->private_value;
 	unsigned int reg = mc->reg;
 	unsigned int reg2 = mc->rreg;
 	unsigned int shift = mc->shift;
@@ -327,13 +317,13 @@ int snd_soc_put_volsw(struct snd_kcontrol *kcontrol,
 	if (sign_bit)
 		mask = BIT(sign_bit + 1) - 1;
 
-	val = ((ucontrol->value.integer.value[0] + min) & mask);
+	val = ((values[0] + min) & mask);
 	if (invert)
 		val = max - val;
 	val_mask = mask << shift;
 	val = val << shift;
 	if (snd_soc_volsw_is_stereo(mc)) {
-		val2 = ((ucontrol->value.integer.value[1] + min) & mask);
+		val2 = ((values[1] + min) & mask);
 		if (invert)
 			val2 = max - val2;
 		if (reg == reg2) {
@@ -344,18 +334,458 @@ int snd_soc_put_volsw(struct snd_kcontrol *kcontrol,
 			type_2r = true;
 		}
 	}
-	err = snd_soc_component_update_bits(component, reg, val_mask, val);
-	if (err < 0)
-		return err;
-
-	if (type_2r)
-		err = snd_soc_component_update_bits(component, reg2, val_mask,
-			val2);
+	if (!type_2r)
+		return snd_soc_component_update_bits(component, reg, val_mask,
+						     val);
+
+	/* let the two channel writes go out back to back */
+	err = snd_soc_component_update_bits_async(component, reg, val_mask,
+						  val);
+	if (err >= 0)
+		err = snd_soc_component_update_bits_async(component, reg2,
+							  val_mask, val2);
+	snd_soc_component_async_complete(component);
 
 	return err;
 }
+
+static void soc_volsw_ramp_cancel(struct snd_soc_component *component,
+				  struct soc_mixer_control *mc);
+
+/**
+ * snd_soc_put_volsw - single mixer put callback
+ * @kcontrol: mixer control
+ * @ucontrol: control element information
+ *
+ * Callback to set the value of a single mixer control, or a double mixer
+ * control that spans 2 registers.  A volume ramp running on the same
+ * registers is stopped.
+ *
+ * Returns 0 for success.
+ */
+int snd_soc_put_volsw(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component = snd_kcontrol_chip(kcontrol);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+
+	soc_volsw_ramp_cancel(component, mc);
+	return soc_volsw_write(component, mc, ucontrol->value.integer.value);
+}
 EXPORT_SYMBOL_GPL(snd_soc_put_volsw);
 
+/*
+ * Volume ramps
+ *
+ * A ramp control moves the registers of a volsw control to a target
+ * value over a given time in the kernel, so that a fade takes a single
+ * control write instead of one per step.  The duration is the value of
+ * the companion "<ramp control> Time" control, in milliseconds.  The
+ * running ramps of a card are stepped together from a work, kicked by an
+ * hrtimer at the next register value change of any ramp, but not more
+ * often than every SOC_VOLSW_RAMP_STEP_US; the value change notifications
+ * are sent at most every SOC_VOLSW_RAMP_NOTIFY_MS and at the end of a
+ * ramp.
+ */
+#define SOC_VOLSW_RAMP_STEP_US		2000
+#define SOC_VOLSW_RAMP_NOTIFY_MS	50
+#define SOC_VOLSW_RAMP_MAX_MS		60000
+
+struct soc_volsw_ramp {
+	struct list_head list;
+	struct snd_kcontrol *kcontrol;	/* the ramp control */
+	struct snd_kcontrol *volume;	/* the volume control, if found */
+	struct snd_soc_component *component;
+	struct soc_mixer_control *mc;
+	long start[2], target[2], cur[2];
+	ktime_t start_time, last_notify;
+	s64 duration;			/* in ns */
+	bool notify;			/* a change not notified yet */
+};
+
+static bool soc_volsw_same_regs(struct soc_mixer_control *a,
+				struct soc_mixer_control *b)
+{
+	return a->reg == b->reg && a->rreg == b->rreg &&
+		a->shift == b->shift && a->rshift == b->rshift;
+}
+
+static struct soc_volsw_ramp *
+soc_volsw_ramp_find(struct snd_soc_card *card, struct snd_kcontrol *kcontrol)
+{
+	struct soc_volsw_ramp *ramp;
+
+	list_for_each_entry(ramp, &card->volsw_ramps, list)
+		if (ramp->kcontrol == kcontrol)
+			return ramp;
+	return NULL;
+}
+
+static void soc_volsw_ramp_notify(struct snd_soc_card *card,
+				  struct soc_volsw_ramp *ramp)
+{
+	snd_ctl_notify(card->snd_card, SNDRV_CTL_EVENT_MASK_VALUE,
+		       &ramp->kcontrol->id);
+	if (ramp->volume)
+		snd_ctl_notify(card->snd_card, SNDRV_CTL_EVENT_MASK_VALUE,
+			       &ramp->volume->id);
+}
+
+/* a direct write to the volume stops the ramps on its registers */
+static void soc_volsw_ramp_cancel(struct snd_soc_component *component,
+				  struct soc_mixer_control *mc)
+{
+	struct snd_soc_card *card = component->card;
+	struct soc_volsw_ramp *ramp, *n;
+
+	if (!card || list_empty(&card->volsw_ramps))
+		return;
+
+	mutex_lock(&card->volsw_ramp_mutex);
+	list_for_each_entry_safe(ramp, n, &card->volsw_ramps, list) {
+		if (ramp->component == component &&
+		    soc_volsw_same_regs(ramp->mc, mc)) {
+			list_del(&ramp->list);
+			snd_ctl_notify(card->snd_card,
+				       SNDRV_CTL_EVENT_MASK_VALUE,
+				       &ramp->kcontrol->id);
+			kfree(ramp);
+		}
+	}
+	mutex_unlock(&card->volsw_ramp_mutex);
+}
+
+/*
+ * the time into the ramp at which the next work has something to do: a
+ * register value change, a notification or the end
+ */
+static s64 soc_volsw_ramp_next(struct soc_volsw_ramp *ramp)
+{
+	int ch, channels = snd_soc_volsw_is_stereo(ramp->mc) ? 2 : 1;
+	s64 next = ramp->duration, t;
+	u64 delta, step;
+
+	for (ch = 0; ch < channels; ch++) {
+		delta = abs(ramp->target[ch] - ramp->start[ch]);
+		if (!delta)
+			continue;
+		/* the values are truncated towards the start */
+		step = abs(ramp->cur[ch] - ramp->start[ch]) + 1;
+		if (step > delta)
+			continue;
+		t = div64_u64(ramp->duration * step + delta - 1, delta);
+		next = min(next, t);
+	}
+	if (ramp->notify) {
+		t = ktime_to_ns(ktime_sub(ramp->last_notify,
+					  ramp->start_time)) +
+			SOC_VOLSW_RAMP_NOTIFY_MS * NSEC_PER_MSEC;
+		next = min(next, t);
+	}
+	return next;
+}
+
+/* called with volsw_ramp_mutex held */
+static void soc_volsw_ramp_schedule(struct snd_soc_card *card, ktime_t now)
+{
+	struct soc_volsw_ramp *ramp;
+	s64 delay, min_delay = S64_MAX;
+
+	list_for_each_entry(ramp, &card->volsw_ramps, list) {
+		delay = soc_volsw_ramp_next(ramp) -
+			ktime_to_ns(ktime_sub(now, ramp->start_time));
+		min_delay = min(min_delay, delay);
+	}
+	if (min_delay == S64_MAX)
+		return;
+	min_delay = max_t(s64, min_delay,
+			  SOC_VOLSW_RAMP_STEP_US * NSEC_PER_USEC);
+	hrtimer_start(&card->volsw_ramp_timer, ns_to_ktime(min_delay),
+		      HRTIMER_MODE_REL);
+}
+
+static void soc_volsw_ramp_work(struct work_struct *work)
+{
+	struct snd_soc_card *card =
+		container_of(work, struct snd_soc_card, volsw_ramp_work);
+	struct soc_volsw_ramp *ramp, *n;
+	ktime_t now = ktime_get();
+	long val[2];
+	bool done, changed;
+	s64 elapsed;
+	int ch, channels;
+
+	mutex_lock(&card->volsw_ramp_mutex);
+	list_for_each_entry_safe(ramp, n, &card->volsw_ramps, list) {
+		channels = snd_soc_volsw_is_stereo(ramp->mc) ? 2 : 1;
+		elapsed = ktime_to_ns(ktime_sub(now, ramp->start_time));
+		done = elapsed >= ramp->duration;
+		changed = false;
+		for (ch = 0; ch < channels; ch++) {
+			if (done)
+				val[ch] = ramp->target[ch];
+			else
+				val[ch] = ramp->start[ch] +
+					div64_s64((s64)(ramp->target[ch] -
+							ramp->start[ch]) * elapsed,
+						  ramp->duration);
+			if (val[ch] != ramp->cur[ch])
+				changed = true;
+		}
+
+		if (changed) {
+			if (soc_volsw_write(ramp->component, ramp->mc,
+					    val) < 0) {
+				dev_err(ramp->component->dev,
+					"ASoC: volume ramp of %s failed\n",
+					ramp->kcontrol->id.name);
+				done = true;
+			}
+			memcpy(ramp->cur, val, sizeof(ramp->cur));
+			ramp->notify = true;
+		}
+
+		if (done || (ramp->notify &&
+			     ktime_ms_delta(now, ramp->last_notify) >=
+			     SOC_VOLSW_RAMP_NOTIFY_MS)) {
+			soc_volsw_ramp_notify(card, ramp);
+			ramp->last_notify = now;
+			ramp->notify = false;
+		}
+
+		if (done) {
+			list_del(&ramp->list);
+			kfree(ramp);
+		}
+	}
+
+	soc_volsw_ramp_schedule(card, now);
+	mutex_unlock(&card->volsw_ramp_mutex);
+}
+
+static enum hrtimer_restart soc_volsw_ramp_timer(struct hrtimer *timer)
+{
+	struct snd_soc_card *card =
+		container_of(timer, struct snd_soc_card, volsw_ramp_timer);
+
+	queue_work(system_highpri_wq, &card->volsw_ramp_work);
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * snd_soc_volsw_ramp_init - initialize the volume ramps of a card
+ * @card: the card
+ */
+void snd_soc_volsw_ramp_init(struct snd_soc_card *card)
+{
+	INIT_LIST_HEAD(&card->volsw_ramps);
+	mutex_init(&card->volsw_ramp_mutex);
+	card->volsw_ramps_stopped = false;
+	hrtimer_init(&card->volsw_ramp_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	card->volsw_ramp_timer.function = soc_volsw_ramp_timer;
+	INIT_WORK(&card->volsw_ramp_work, soc_volsw_ramp_work);
+}
+EXPORT_SYMBOL_GPL(snd_soc_volsw_ramp_init);
+
+/**
+ * snd_soc_volsw_ramp_free - stop all the volume ramps of a card
+ * @card: the card
+ *
+ * The ramps are dropped where they are, and no new ramp can be started
+ * afterwards.  Called once the card is disconnected and before its
+ * controls are freed.
+ */
+void snd_soc_volsw_ramp_free(struct snd_soc_card *card)
+{
+	struct soc_volsw_ramp *ramp, *n;
+
+	mutex_lock(&card->volsw_ramp_mutex);
+	card->volsw_ramps_stopped = true;
+	list_for_each_entry_safe(ramp, n, &card->volsw_ramps, list) {
+		list_del(&ramp->list);
+		kfree(ramp);
+	}
+	mutex_unlock(&card->volsw_ramp_mutex);
+	/* the work doesn't rearm the timer with the list empty */
+	hrtimer_cancel(&card->volsw_ramp_timer);
+	cancel_work_sync(&card->volsw_ramp_work);
+}
+EXPORT_SYMBOL_GPL(snd_soc_volsw_ramp_free);
+
+/**
+ * snd_soc_info_volsw_ramp_time - volume ramp duration info callback
+ * @kcontrol: mixer control
+ * @uinfo: control element information
+ *
+ * Returns 0 for success.
+ */
+int snd_soc_info_volsw_ramp_time(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+	uinfo->value.integer.min = 0;
+	uinfo->value.integer.max = SOC_VOLSW_RAMP_MAX_MS;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_info_volsw_ramp_time);
+
+/**
+ * snd_soc_get_volsw_ramp_time - volume ramp duration get callback
+ * @kcontrol: mixer control
+ * @ucontrol: control element information
+ *
+ * Returns 0 for success.
+ */
+int snd_soc_get_volsw_ramp_time(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = READ_ONCE(kcontrol->private_value);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(snd_soc_get_volsw_ramp_time);
+
+/**
+ * snd_soc_put_volsw_ramp_time - volume ramp duration put callback
+ * @kcontrol: mixer control
+ * @ucontrol: control element information
+ *
+ * Sets the duration in milliseconds of the next ramps started on the
+ * ramp control this one is named after; a running ramp keeps its own.
+ *
+ * Returns 0 if unchanged, 1 if changed, or a negative error code.
+ */
+int snd_soc_put_volsw_ramp_time(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	long ms = ucontrol->value.integer.value[0];
+
+	if (ms < 0 || ms > SOC_VOLSW_RAMP_MAX_MS)
+		return -EINVAL;
+	if (ms == kcontrol->private_value)
+		return 0;
+	WRITE_ONCE(kcontrol->private_value, ms);
+	return 1;
+}
+EXPORT_SYMBOL_GPL(snd_soc_put_volsw_ramp_time);
+
+/* "Foo Volume Ramp" ramps "Foo Volume" over "Foo Volume Ramp Time" */
+static unsigned int soc_volsw_ramp_lookup(struct snd_soc_card *card,
+					  struct snd_kcontrol *kcontrol,
+					  struct snd_kcontrol **volume)
+{
+	char name[SNDRV_CTL_ELEM_ID_NAME_MAXLEN];
+	struct snd_kcontrol *time;
+	size_t len;
+
+	*volume = NULL;
+	strlcpy(name, kcontrol->id.name, sizeof(name));
+	len = strlen(name);
+	if (len > 5 && !strcmp(name + len - 5, " Ramp")) {
+		name[len - 5] = 0;
+		*volume = snd_soc_card_get_kcontrol(card, name);
+	}
+
+	strlcpy(name, kcontrol->id.name, sizeof(name));
+	strlcat(name, " Time", sizeof(name));
+	time = snd_soc_card_get_kcontrol(card, name);
+	return time ? READ_ONCE(time->private_value) : 0;
+}
+
+/**
+ * snd_soc_put_volsw_ramp - volume ramp put callback
+ * @kcontrol: mixer control
+ * @ucontrol: control element information
+ *
+ * Starts moving the volume from its current value to the given one over
+ * the duration set in the "Time" control of the ramp, replacing a ramp
+ * already running on this control.  A zero duration, or no such control,
+ * sets the volume at once.  Reading the control returns the current
+ * volume.
+ *
+ * Returns 0 if the volume or the running ramp already has this target,
+ * 1 if changed, or a negative error code.
+ */
+int snd_soc_put_volsw_ramp(struct snd_kcontrol *kcontrol,
+	struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component = snd_kcontrol_chip(kcontrol);
+	struct soc_mixer_control *mc =
+		(struct soc_mixer_control *)kcontrol->private_value;
+	struct snd_soc_card *card = component->card;
+	struct snd_kcontrol *volume;
+	struct soc_volsw_ramp *ramp;
+	int channels = snd_soc_volsw_is_stereo(mc) ? 2 : 1;
+	long target[2] = { 0 };
+	unsigned int ms;
+	int ch, ret;
+
+	if (!mc->platform_max)
+		mc->platform_max = mc->max;
+	for (ch = 0; ch < channels; ch++) {
+		target[ch] = ucontrol->value.integer.value[ch];
+		if (target[ch] < 0 || target[ch] > mc->platform_max - mc->min)
+			return -EINVAL;
+	}
+
+	ms = soc_volsw_ramp_lookup(card, kcontrol, &volume);
+	if (!ms) {
+		soc_volsw_ramp_cancel(component, mc);
+		return soc_volsw_write(component, mc, target);
+	}
+
+	/* the ramp starts from the current register values */
+	ret = snd_soc_get_volsw(kcontrol, ucontrol);
+	if (ret)
+		return ret;
+
+	mutex_lock(&card->volsw_ramp_mutex);
+	if (card->volsw_ramps_stopped) {
+		ret = -ENODEV;
+		goto unlock;
+	}
+	ramp = soc_volsw_ramp_find(card, kcontrol);
+	if (ramp ? !memcmp(ramp->target, target, sizeof(target)) :
+	    !memcmp(ucontrol->value.integer.value, target,
+		    channels * sizeof(target[0]))) {
+		ret = 0;
+		goto unlock;
+	}
+	if (!ramp) {
+		ramp = kzalloc(sizeof(*ramp), GFP_KERNEL);
+		if (!ramp) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
+		ramp->kcontrol = kcontrol;
+		ramp->volume = volume;
+		ramp->component = component;
+		ramp->mc = mc;
+		list_add_tail(&ramp->list, &card->volsw_ramps);
+	}
+	for (ch = 0; ch < channels; ch++) {
+		ramp->start[ch] = ucontrol->value.integer.value[ch];
+		ramp->cur[ch] = ramp->start[ch];
+		ramp->target[ch] = target[ch];
+	}
+	ramp->start_time = ktime_get();
+	ramp->last_notify = ramp->start_time;
+	ramp->notify = false;
+	ramp->duration = (s64)ms * NSEC_PER_MSEC;
+	soc_volsw_ramp_schedule(card, ramp->start_time);
+	ret = 1;
+unlock:
+	mutex_unlock(&card->volsw_ramp_mutex);
+
+	/* give the caller its request back */
+	for (ch = 0; ch < channels; ch++)
+		ucontrol->value.integer.value[ch] = target[ch];
+	return ret;
+}
+EXPORT_SYMBOL_GPL(snd_soc_put_volsw_ramp);
+
 /**
  * snd_soc_get_volsw_sx - single mixer get callback
  * @kcontrol: mixer control
@@ -431,18 +861,22 @@ int snd_soc_put_volsw_sx(struct snd_kcontrol *kcontrol,
 	val = (ucontrol->value.integer.value[0] + min) & mask;
 	val = val << shift;
 
-	err = snd_soc_component_update_bits(component, reg, val_mask, val);
-	if (err < 0)
-		return err;
+	if (!snd_soc_volsw_is_stereo(mc))
+		return snd_soc_component_update_bits(component, reg, val_mask,
+						     val);
 
-	if (snd_soc_volsw_is_stereo(mc)) {
+	err = snd_soc_component_update_bits_async(component, reg, val_mask,
+						  val);
+	if (err >= 0) {
 		val_mask = mask << rshift;
 		val2 = (ucontrol->value.integer.value[1] + min) & mask;
 		val2 = val2 << rshift;
 
-		err = snd_soc_component_update_bits(component, reg2, val_mask,
-			val2);
+		err = snd_soc_component_update_bits_async(component, reg2,
+							  val_mask, val2);
 	}
+	snd_soc_component_async_complete(component);
+
 	return err;
 }
 EXPORT_SYMBOL_GPL(snd_soc_put_volsw_sx);
@@ -510,11 +944,13 @@ int snd_soc_put_volsw_range(struct snd_kcontrol *kcontrol,
 	val_mask = mask << shift;
 	val = val << shift;
 
-	ret = snd_soc_component_update_bits(component, reg, val_mask, val);
-	if (ret < 0)
-		return ret;
+	if (!snd_soc_volsw_is_stereo(mc))
+		return snd_soc_component_update_bits(component, reg, val_mask,
+						     val);
 
-	if (snd_soc_volsw_is_stereo(mc)) {
+	ret = snd_soc_component_update_bits_async(component, reg, val_mask,
+						  val);
+	if (ret >= 0) {
 		if (invert)
 			val = (max - ucontrol->value.integer.value[1]) & mask;
 		else
@@ -522,9 +958,10 @@ int snd_soc_put_volsw_range(struct snd_kcontrol *kcontrol,
 		val_mask = mask << shift;
 		val = val << shift;
 
-		ret = snd_soc_component_update_bits(component, rreg, val_mask,
-			val);
+		ret = snd_soc_component_update_bits_async(component, rreg,
+							  val_mask, val);
 	}
+	snd_soc_component_async_complete(component);
 
 	return ret;
 }
@@ -892,7 +1329,7 @@ int snd_soc_put_xr_sx(struct snd_kcontrol *kcontrol,
 	long max = mc->max;
 	long val = ucontrol->value.integer.value[0];
 	unsigned int i, regval, regmask;
-	int err;
+	int err = 0;
 
 	if (invert)
 		val = max - val;
@@ -900,13 +1337,14 @@ int snd_soc_put_xr_sx(struct snd_kcontrol *kcontrol,
 	for (i = 0; i < regcount; i++) {
 		regval = (val >> (regwshift*(regcount-i-1))) & regwmask;
 		regmask = (mask >> (regwshift*(regcount-i-1))) & regwmask;
-		err = snd_soc_component_update_bits(component, regbase+i,
-				regmask, regval);
+		err = snd_soc_component_update_bits_async(component,
+				regbase+i, regmask, regval);
 		if (err < 0)
-			return err;
+			break;
 	}
+	snd_soc_component_async_complete(component);
 
-	return 0;
+	return err < 0 ? err : 0;
 }
 EXPORT_SYMBOL_GPL(snd_soc_put_xr_sx);
 
@@ -16,6 +16,7 @@
  *
  */
 
+#include <linux/async.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/delay.h>
@@ -369,11 +370,15 @@ static void soc_pcm_apply_msb(struct snd_pcm_substream *substream)
 	soc_pcm_set_msb(substream, cpu_bits);
 }
 
-static void soc_pcm_init_runtime_hw(struct snd_pcm_substream *substream)
+/*
+ * Intersect the capabilities of the CPU and CODEC DAIs of a link.  They
+ * are fixed once the card is bound, so this runs when the PCM is created
+ * and soc_pcm_init_runtime_hw() only applies the result at each open.
+ */
+static void soc_pcm_init_dai_caps(struct snd_soc_pcm_runtime *rtd,
+				  int stream)
 {
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	struct snd_pcm_hardware *hw = &runtime->hw;
-	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct snd_soc_pcm_stream *caps = &rtd->dai_caps[stream];
 	struct snd_soc_dai_driver *cpu_dai_drv = rtd->cpu_dai->driver;
 	struct snd_soc_dai_driver *codec_dai_drv;
 	struct snd_soc_pcm_stream *codec_stream;
@@ -384,7 +389,7 @@ static void soc_pcm_init_runtime_hw(struct snd_pcm_substream *substream)
 	u64 formats = ULLONG_MAX;
 	int i;
 
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (stream == SNDRV_PCM_STREAM_PLAYBACK)
 		cpu_stream = &cpu_dai_drv->playback;
 	else
 		cpu_stream = &cpu_dai_drv->capture;
@@ -401,12 +406,11 @@ static void soc_pcm_init_runtime_hw(struct snd_pcm_substream *substream)
 		 * bailed out on a higher level, since there would be no
 		 * CODEC to support the transfer direction in that case.
 		 */
-		if (!snd_soc_dai_stream_valid(rtd->codec_dais[i],
-					      substream->stream))
+		if (!snd_soc_dai_stream_valid(rtd->codec_dais[i], stream))
 			continue;
 
 		codec_dai_drv = rtd->codec_dais[i]->driver;
-		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		if (stream == SNDRV_PCM_STREAM_PLAYBACK)
 			codec_stream = &codec_dai_drv->playback;
 		else
 			codec_stream = &codec_dai_drv->capture;
@@ -428,20 +432,33 @@ static void soc_pcm_init_runtime_hw(struct snd_pcm_substream *substream)
 		chan_max = cpu_stream->channels_max;
 	}
 
-	hw->channels_min = max(chan_min, cpu_stream->channels_min);
-	hw->channels_max = min(chan_max, cpu_stream->channels_max);
+	caps->channels_min = max(chan_min, cpu_stream->channels_min);
+	caps->channels_max = min(chan_max, cpu_stream->channels_max);
+	caps->formats = formats & cpu_stream->formats;
+	caps->rates = snd_pcm_rate_mask_intersect(rates, cpu_stream->rates);
+	caps->rate_min = max(rate_min, cpu_stream->rate_min);
+	caps->rate_max = min_not_zero(rate_max, cpu_stream->rate_max);
+}
+
+static void soc_pcm_init_runtime_hw(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_hardware *hw = &runtime->hw;
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct snd_soc_pcm_stream *caps = &rtd->dai_caps[substream->stream];
+
+	hw->channels_min = caps->channels_min;
+	hw->channels_max = caps->channels_max;
 	if (hw->formats)
-		hw->formats &= formats & cpu_stream->formats;
+		hw->formats &= caps->formats;
 	else
-		hw->formats = formats & cpu_stream->formats;
-	hw->rates = snd_pcm_rate_mask_intersect(rates, cpu_stream->rates);
+		hw->formats = caps->formats;
+	hw->rates = caps->rates;
 
 	snd_pcm_limit_hw_rates(runtime);
 
-	hw->rate_min = max(hw->rate_min, cpu_stream->rate_min);
-	hw->rate_min = max(hw->rate_min, rate_min);
-	hw->rate_max = min_not_zero(hw->rate_max, cpu_stream->rate_max);
-	hw->rate_max = min_not_zero(hw->rate_max, rate_max);
+	hw->rate_min = max(hw->rate_min, caps->rate_min);
+	hw->rate_max = min_not_zero(hw->rate_max, caps->rate_max);
 }
 
 /*
@@ -624,16 +641,38 @@ static int soc_pcm_open(struct snd_pcm_substream *substream)
 	return ret;
 }
 
+/* other playback streams due this soon are powered down along */
+#define SOC_PCM_PMDOWN_SLACK_MS	1000
+
+/* called with rtd->pcm_mutex held */
+static bool soc_pcm_pmdown_mark(struct snd_soc_pcm_runtime *rtd)
+{
+	if (!rtd->pop_wait || !rtd->pmdown_deadline)
+		return false;
+
+	/* idle for the whole delay, back to plain pmdown_time */
+	rtd->pop_wait = 0;
+	rtd->pmdown_deadline = 0;
+	rtd->pmdown_shift = 0;
+	snd_soc_dapm_stream_mark(rtd, SNDRV_PCM_STREAM_PLAYBACK,
+				 SND_SOC_DAPM_STREAM_STOP);
+	return true;
+}
+
 /*
  * Power down the audio subsystem pmdown_time msecs after close is called.
  * This is to ensure there are no pops or clicks in between any music tracks
- * due to DAPM power cycling.
+ * due to DAPM power cycling.  The playback streams of the card due within
+ * SOC_PCM_PMDOWN_SLACK_MS are stopped in the same DAPM run.
  */
 static void close_delayed_work(struct work_struct *work)
 {
 	struct snd_soc_pcm_runtime *rtd =
 			container_of(work, struct snd_soc_pcm_runtime, delayed_work.work);
 	struct snd_soc_dai *codec_dai = rtd->codec_dais[0];
+	struct snd_soc_pcm_runtime *r;
+	unsigned long due;
+	bool stop;
 
 	mutex_lock_nested(&rtd->pcm_mutex, rtd->pcm_subclass);
 
@@ -643,13 +682,26 @@ static void close_delayed_work(struct work_struct *work)
 		 rtd->pop_wait ? "yes" : "no");
 
 	/* are we waiting on this codec DAI stream */
-	if (rtd->pop_wait == 1) {
-		rtd->pop_wait = 0;
-		snd_soc_dapm_stream_event(rtd, SNDRV_PCM_STREAM_PLAYBACK,
-					  SND_SOC_DAPM_STREAM_STOP);
-	}
+	stop = soc_pcm_pmdown_mark(rtd);
 
 	mutex_unlock(&rtd->pcm_mutex);
+
+	if (!stop)
+		return;
+
+	due = jiffies + msecs_to_jiffies(SOC_PCM_PMDOWN_SLACK_MS);
+	list_for_each_entry(r, &rtd->card->rtd_list, list) {
+		if (r == rtd)
+			continue;
+
+		mutex_lock_nested(&r->pcm_mutex, r->pcm_subclass);
+		if (r->pmdown_deadline && time_before_eq(r->pmdown_deadline, due) &&
+		    soc_pcm_pmdown_mark(r))
+			cancel_delayed_work(&r->delayed_work);
+		mutex_unlock(&r->pcm_mutex);
+	}
+
+	snd_soc_dapm_stream_sync(rtd->card, SND_SOC_DAPM_STREAM_STOP);
 }
 
 /*
@@ -705,11 +757,14 @@ static int soc_pcm_close(struct snd_pcm_substream *substream)
 						  SNDRV_PCM_STREAM_PLAYBACK,
 						  SND_SOC_DAPM_STREAM_STOP);
 		} else {
+			unsigned long delay = msecs_to_jiffies(rtd->pmdown_time <<
+							       rtd->pmdown_shift);
+
 			/* start delayed pop wq here for playback streams */
 			rtd->pop_wait = 1;
+			rtd->pmdown_deadline = (jiffies + delay) | 1;
 			queue_delayed_work(system_power_efficient_wq,
-					   &rtd->delayed_work,
-					   msecs_to_jiffies(rtd->pmdown_time));
+					   &rtd->delayed_work, delay);
 		}
 	} else {
 		/* capture streams can be powered down now */
@@ -736,6 +791,113 @@ static int soc_pcm_close(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+/* One CODEC DAI operation of a parallel fan-out, see parallel_codecs */
+struct soc_codec_async {
+	struct snd_pcm_substream *substream;
+	struct snd_soc_dai *dai;
+	struct snd_pcm_hw_params params;
+	int mute;
+	int ret;
+};
+
+static struct soc_codec_async *soc_codec_async_alloc(
+	struct snd_soc_pcm_runtime *rtd)
+{
+	if (!rtd->dai_link->parallel_codecs || rtd->num_codecs < 2)
+		return NULL;
+
+	/* falls back to the serial path on failure */
+	return kcalloc(rtd->num_codecs, sizeof(struct soc_codec_async),
+		       GFP_KERNEL);
+}
+
+static void soc_codec_prepare_async(void *data, async_cookie_t cookie)
+{
+	struct soc_codec_async *op = data;
+
+	op->ret = op->dai->driver->ops->prepare(op->substream, op->dai);
+}
+
+static void soc_codec_mute_async(void *data, async_cookie_t cookie)
+{
+	struct soc_codec_async *op = data;
+
+	snd_soc_dai_digital_mute(op->dai, op->mute, op->substream->stream);
+}
+
+/* As the prepare loop of soc_pcm_prepare(), with all CODECs in flight */
+static int soc_pcm_codecs_prepare_parallel(struct snd_pcm_substream *substream,
+	struct soc_codec_async *ops)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct snd_soc_dai *codec_dai;
+	int i, n = 0, ret = 0;
+
+	for (i = 0; i < rtd->num_codecs; i++) {
+		codec_dai = rtd->codec_dais[i];
+		if (!codec_dai->driver->ops->prepare)
+			continue;
+
+		ops[n].substream = substream;
+		ops[n].dai = codec_dai;
+		async_schedule_domain(soc_codec_prepare_async, &ops[n],
+				      &async_domain);
+		n++;
+	}
+	async_synchronize_full_domain(&async_domain);
+
+	for (i = 0; i < n; i++) {
+		if (ops[i].ret < 0) {
+			dev_err(ops[i].dai->dev,
+				"ASoC: codec DAI prepare error: %d\n",
+				ops[i].ret);
+			if (!ret)
+				ret = ops[i].ret;
+		}
+	}
+
+	kfree(ops);
+	return ret;
+}
+
+/* Mute or unmute the CODEC DAIs of the link, concurrently if allowed */
+static void soc_pcm_codecs_mute(struct snd_pcm_substream *substream,
+	int mute, bool active_only)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	bool playback = substream->stream == SNDRV_PCM_STREAM_PLAYBACK;
+	struct soc_codec_async *ops = soc_codec_async_alloc(rtd);
+	struct snd_soc_dai *codec_dai;
+	int i;
+
+	for (i = 0; i < rtd->num_codecs; i++) {
+		codec_dai = rtd->codec_dais[i];
+		if (active_only &&
+		    !((playback && codec_dai->playback_active == 1) ||
+		      (!playback && codec_dai->capture_active == 1)))
+			continue;
+
+		if (!ops) {
+			snd_soc_dai_digital_mute(codec_dai, mute,
+						 substream->stream);
+			continue;
+		}
+
+		ops[i].substream = substream;
+		ops[i].dai = codec_dai;
+		ops[i].mute = mute;
+		async_schedule_domain(soc_codec_mute_async, &ops[i],
+				      &async_domain);
+	}
+
+	if (ops) {
+		async_synchronize_full_domain(&async_domain);
+		kfree(ops);
+	}
+}
+
 /*
  * Called by ALSA when the PCM substream is prepared, can set format, sample
  * rate, etc.  This function is non atomic and can be called multiple times,
@@ -747,6 +909,7 @@ static int soc_pcm_prepare(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform = rtd->platform;
 	struct snd_soc_dai *cpu_dai = rtd->cpu_dai;
 	struct snd_soc_dai *codec_dai;
+	struct soc_codec_async *ops;
 	int i, ret = 0;
 
 	mutex_lock_nested(&rtd->pcm_mutex, rtd->pcm_subclass);
@@ -769,7 +932,14 @@ static int soc_pcm_prepare(struct snd_pcm_substream *substream)
 		}
 	}
 
-	for (i = 0; i < rtd->num_codecs; i++) {
+	ops = soc_codec_async_alloc(rtd);
+	if (ops) {
+		ret = soc_pcm_codecs_prepare_parallel(substream, ops);
+		if (ret < 0)
+			goto out;
+	}
+
+	for (i = 0; !ops && i < rtd->num_codecs; i++) {
 		codec_dai = rtd->codec_dais[i];
 		if (codec_dai->driver->ops->prepare) {
 			ret = codec_dai->driver->ops->prepare(substream,
@@ -792,19 +962,24 @@ static int soc_pcm_prepare(struct snd_pcm_substream *substream)
 		}
 	}
 
-	/* cancel any delayed stream shutdown that is pending */
+	/*
+	 * Cancel any delayed stream shutdown that is pending.  The widgets
+	 * were kept up, so the start below has nothing to power.  Streams
+	 * that come back like this are given a longer delay next time.
+	 */
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
 	    rtd->pop_wait) {
 		rtd->pop_wait = 0;
+		rtd->pmdown_deadline = 0;
+		if (rtd->pmdown_shift < 2)
+			rtd->pmdown_shift++;
 		cancel_delayed_work(&rtd->delayed_work);
 	}
 
 	snd_soc_dapm_stream_event(rtd, substream->stream,
 			SND_SOC_DAPM_STREAM_START);
 
-	for (i = 0; i < rtd->num_codecs; i++)
-		snd_soc_dai_digital_mute(rtd->codec_dais[i], 0,
-					 substream->stream);
+	soc_pcm_codecs_mute(substream, 0, false);
 	snd_soc_dai_digital_mute(cpu_dai, 0, substream->stream);
 
 out:
@@ -853,6 +1028,77 @@ int soc_dai_hw_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+static void soc_codec_hw_params_async(void *data, async_cookie_t cookie)
+{
+	struct soc_codec_async *op = data;
+
+	op->ret = soc_dai_hw_params(op->substream, &op->params, op->dai);
+}
+
+/*
+ * As the CODEC loop of soc_pcm_hw_params(), with all CODECs in flight.
+ * If any of them fails, the ones that succeeded are freed again.
+ */
+static int soc_pcm_codecs_hw_params_parallel(
+	struct snd_pcm_substream *substream,
+	struct snd_pcm_hw_params *params, struct soc_codec_async *ops)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct snd_soc_dai *codec_dai;
+	int i, n = 0, ret = 0;
+
+	for (i = 0; i < rtd->num_codecs; i++) {
+		codec_dai = rtd->codec_dais[i];
+
+		/* see soc_pcm_hw_params() */
+		if (!snd_soc_dai_stream_valid(codec_dai, substream->stream))
+			continue;
+
+		ops[n].substream = substream;
+		ops[n].dai = codec_dai;
+		ops[n].params = *params;
+
+		/* fixup params based on TDM slot masks */
+		if (codec_dai->tx_mask)
+			soc_pcm_codec_params_fixup(&ops[n].params,
+						   codec_dai->tx_mask);
+		if (codec_dai->rx_mask)
+			soc_pcm_codec_params_fixup(&ops[n].params,
+						   codec_dai->rx_mask);
+
+		async_schedule_domain(soc_codec_hw_params_async, &ops[n],
+				      &async_domain);
+		n++;
+	}
+	async_synchronize_full_domain(&async_domain);
+
+	for (i = 0; i < n; i++) {
+		if (ops[i].ret < 0 && !ret)
+			ret = ops[i].ret;
+	}
+
+	for (i = n - 1; i >= 0; i--) {
+		codec_dai = ops[i].dai;
+
+		if (ret < 0) {
+			if (ops[i].ret >= 0 && codec_dai->driver->ops->hw_free)
+				codec_dai->driver->ops->hw_free(substream,
+								codec_dai);
+			codec_dai->rate = 0;
+			continue;
+		}
+
+		codec_dai->rate = params_rate(&ops[i].params);
+		codec_dai->channels = params_channels(&ops[i].params);
+		codec_dai->sample_bits = snd_pcm_format_physical_width(
+						params_format(&ops[i].params));
+	}
+
+	kfree(ops);
+	return ret;
+}
+
 /*
  * Called by ALSA when the hardware params are set by application. This
  * function can also be called multiple times and can allocate buffers
@@ -864,6 +1110,7 @@ static int soc_pcm_hw_params(struct snd_pcm_substream *substream,
 	struct snd_soc_pcm_runtime *rtd = substream->private_data;
 	struct snd_soc_platform *platform = rtd->platform;
 	struct snd_soc_dai *cpu_dai = rtd->cpu_dai;
+	struct soc_codec_async *ops;
 	int i, ret = 0;
 
 	mutex_lock_nested(&rtd->pcm_mutex, rtd->pcm_subclass);
@@ -876,7 +1123,17 @@ static int soc_pcm_hw_params(struct snd_pcm_substream *substream,
 		}
 	}
 
-	for (i = 0; i < rtd->num_codecs; i++) {
+	ops = soc_codec_async_alloc(rtd);
+	if (ops) {
+		ret = soc_pcm_codecs_hw_params_parallel(substream, params, ops);
+		if (ret < 0) {
+			/* the CODECs are already unwound */
+			i = 0;
+			goto codec_err;
+		}
+	}
+
+	for (i = 0; !ops && i < rtd->num_codecs; i++) {
 		struct snd_soc_dai *codec_dai = rtd->codec_dais[i];
 		struct snd_pcm_hw_params codec_params;
 
@@ -976,7 +1233,6 @@ static int soc_pcm_hw_free(struct snd_pcm_substream *substream)
 	struct snd_soc_platform *platform = rtd->platform;
 	struct snd_soc_dai *cpu_dai = rtd->cpu_dai;
 	struct snd_soc_dai *codec_dai;
-	bool playback = substream->stream == SNDRV_PCM_STREAM_PLAYBACK;
 	int i;
 
 	mutex_lock_nested(&rtd->pcm_mutex, rtd->pcm_subclass);
@@ -998,12 +1254,7 @@ static int soc_pcm_hw_free(struct snd_pcm_substream *substream)
 	}
 
 	/* apply codec digital mute */
-	for (i = 0; i < rtd->num_codecs; i++) {
-		if ((playback && rtd->codec_dais[i]->playback_active == 1) ||
-		    (!playback && rtd->codec_dais[i]->capture_active == 1))
-			snd_soc_dai_digital_mute(rtd->codec_dais[i], 1,
-						 substream->stream);
-	}
+	soc_pcm_codecs_mute(substream, 1, true);
 
 	/* free any machine hw params */
 	if (rtd->dai_link->ops->hw_free)
@@ -1338,12 +1589,37 @@ static bool dpcm_end_walk_at_be(struct snd_soc_dapm_widget *widget,
 	return false;
 }
 
+static size_t dpcm_path_size(struct snd_soc_dapm_widget_list *list)
+{
+	return sizeof(*list) + list->num_widgets * sizeof(list->widgets[0]);
+}
+
+/*
+ * The widgets reachable from a FE only change along with the DAPM routes,
+ * so the result of the graph walk is kept per FE stream and handed out
+ * again, as a copy, until card->dapm_route_gen moves on.  Callers hold
+ * card->mutex, which serialises the use of the cache.
+ */
 int dpcm_path_get(struct snd_soc_pcm_runtime *fe,
 	int stream, struct snd_soc_dapm_widget_list **list)
 {
+	struct snd_soc_dpcm_runtime *dpcm = &fe->dpcm[stream];
+	struct snd_soc_card *card = fe->card;
 	struct snd_soc_dai *cpu_dai = fe->cpu_dai;
+	unsigned int gen;
 	int paths;
 
+	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
+	gen = card->dapm_route_gen;
+	if (dpcm->path_cache && dpcm->path_gen == gen) {
+		*list = kmemdup(dpcm->path_cache,
+				dpcm_path_size(dpcm->path_cache), GFP_KERNEL);
+		paths = *list ? dpcm->path_count : -ENOMEM;
+		mutex_unlock(&card->dapm_mutex);
+		return paths;
+	}
+	mutex_unlock(&card->dapm_mutex);
+
 	/* get number of valid DAI paths and their widgets */
 	paths = snd_soc_dapm_dai_get_connected_widgets(cpu_dai, stream, list,
 			dpcm_end_walk_at_be);
@@ -1351,6 +1627,15 @@ int dpcm_path_get(struct snd_soc_pcm_runtime *fe,
 	dev_dbg(fe->dev, "ASoC: found %d audio %s paths\n", paths,
 			stream ? "capture" : "playback");
 
+	/* a route change during the walk leaves gen stale, so no harm done */
+	if (paths >= 0) {
+		kfree(dpcm->path_cache);
+		dpcm->path_cache = kmemdup(*list, dpcm_path_size(*list),
+					   GFP_KERNEL);
+		dpcm->path_gen = gen;
+		dpcm->path_count = paths;
+	}
+
 	return paths;
 }
 
@@ -1907,11 +2192,203 @@ static int dpcm_fe_dai_hw_free(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+/*
+ * Move the BE to the supported rate closest to the FE one when the FE CPU
+ * DAI converts the sample rate (rate_conversion), so a rate the BE cannot
+ * run at is resampled on the way instead of failing BE hw_params.
+ */
+static void dpcm_be_rate_fixup(struct snd_soc_pcm_runtime *fe,
+	struct snd_soc_pcm_runtime *be, int stream,
+	struct snd_pcm_hw_params *params)
+{
+	struct snd_soc_pcm_stream *dai_stream;
+	struct snd_interval *interval;
+	unsigned int rate_min = 0, rate_max = UINT_MAX;
+	unsigned int rates = UINT_MAX;
+	unsigned int rate = params_rate(params);
+	unsigned int best = 0, r, bit;
+	int i;
+
+	if (!fe->cpu_dai->driver->rate_conversion)
+		return;
+
+	for (i = 0; i <= be->num_codecs; i++) {
+		struct snd_soc_dai *dai = i < be->num_codecs ?
+			be->codec_dais[i] : be->cpu_dai;
+
+		if (!snd_soc_dai_stream_valid(dai, stream))
+			continue;
+
+		if (stream == SNDRV_PCM_STREAM_PLAYBACK)
+			dai_stream = &dai->driver->playback;
+		else
+			dai_stream = &dai->driver->capture;
+		rate_min = max(rate_min, dai_stream->rate_min);
+		rate_max = min_not_zero(rate_max, dai_stream->rate_max);
+		rates = snd_pcm_rate_mask_intersect(dai_stream->rates, rates);
+	}
+
+	if (rate >= rate_min && rate <= rate_max &&
+	    (rates & (SNDRV_PCM_RATE_CONTINUOUS | SNDRV_PCM_RATE_KNOT |
+		      snd_pcm_rate_to_rate_bit(rate))))
+		return;
+
+	for (bit = 1; bit < SNDRV_PCM_RATE_CONTINUOUS; bit <<= 1) {
+		if (!(rates & bit))
+			continue;
+		r = snd_pcm_rate_bit_to_rate(bit);
+		if (!r || r < rate_min || r > rate_max)
+			continue;
+		if (!best || abs((int)r - (int)rate) <= abs((int)best - (int)rate))
+			best = r;
+	}
+	/* any rate in range will do, the closest is at the range ends */
+	if ((rates & SNDRV_PCM_RATE_CONTINUOUS) && rate_min <= rate_max) {
+		r = clamp(rate, rate_min, rate_max);
+		if (!best || abs((int)r - (int)rate) <= abs((int)best - (int)rate))
+			best = r;
+	}
+	if (!best)
+		return;
+
+	dev_dbg(be->dev, "ASoC: %s converts %u Hz to %u Hz\n",
+		fe->cpu_dai->name, rate, best);
+
+	interval = hw_param_interval(params, SNDRV_PCM_HW_PARAM_RATE);
+	interval->min = best;
+	interval->max = best;
+}
+
+/* One BE operation of a parallel fan-out, see dpcm_parallel_be */
+struct dpcm_be_async {
+	struct snd_soc_dpcm *dpcm;
+	struct snd_pcm_substream *substream;
+	int ret;
+};
+
+static struct dpcm_be_async *dpcm_be_async_alloc(
+	struct snd_soc_pcm_runtime *fe, int stream)
+{
+	struct snd_soc_dpcm *dpcm;
+	int n = 0;
+
+	if (!fe->dai_link->dpcm_parallel_be)
+		return NULL;
+
+	list_for_each_entry(dpcm, &fe->dpcm[stream].be_clients, list_be)
+		n++;
+	if (n < 2)
+		return NULL;
+
+	/* falls back to the serial path on failure */
+	return kcalloc(n, sizeof(struct dpcm_be_async), GFP_KERNEL);
+}
+
+static void dpcm_be_hw_params_async(void *data, async_cookie_t cookie)
+{
+	struct dpcm_be_async *op = data;
+
+	op->ret = soc_pcm_hw_params(op->substream, &op->dpcm->hw_params);
+}
+
+static void dpcm_be_prepare_async(void *data, async_cookie_t cookie)
+{
+	struct dpcm_be_async *op = data;
+
+	op->ret = soc_pcm_prepare(op->substream);
+}
+
+/*
+ * As dpcm_be_dai_hw_params(), but with the soc_pcm_hw_params() calls of
+ * all BEs in flight at once.  The fixups and state checks still run in
+ * list order, while the earlier BEs are already set up.  If a fixup or
+ * any BE fails, the ones that succeeded are freed again in reverse list
+ * order once all are done.
+ */
+static int dpcm_be_dai_hw_params_parallel(struct snd_soc_pcm_runtime *fe,
+	int stream, struct dpcm_be_async *ops)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	struct snd_soc_dpcm *dpcm;
+	int i, n = 0, ret = 0;
+
+	list_for_each_entry(dpcm, &fe->dpcm[stream].be_clients, list_be) {
+		struct snd_soc_pcm_runtime *be = dpcm->be;
+
+		if (!snd_soc_dpcm_be_can_update(fe, be, stream))
+			continue;
+
+		memcpy(&dpcm->hw_params, &fe->dpcm[stream].hw_params,
+				sizeof(struct snd_pcm_hw_params));
+
+		if (be->dai_link->be_hw_params_fixup) {
+			ret = be->dai_link->be_hw_params_fixup(be,
+					&dpcm->hw_params);
+			if (ret < 0) {
+				dev_err(be->dev,
+					"ASoC: hw_params BE fixup failed %d\n",
+					ret);
+				/* wait for and unwind the BEs in flight */
+				break;
+			}
+		}
+		dpcm_be_rate_fixup(fe, be, stream, &dpcm->hw_params);
+
+		if (!snd_soc_dpcm_can_be_params(fe, be, stream))
+			continue;
+
+		if ((be->dpcm[stream].state != SND_SOC_DPCM_STATE_OPEN) &&
+		    (be->dpcm[stream].state != SND_SOC_DPCM_STATE_HW_PARAMS) &&
+		    (be->dpcm[stream].state != SND_SOC_DPCM_STATE_HW_FREE))
+			continue;
+
+		dev_dbg(be->dev, "ASoC: hw_params BE %s\n",
+			be->dai_link->name);
+
+		ops[n].dpcm = dpcm;
+		ops[n].substream = snd_soc_dpcm_get_substream(be, stream);
+		async_schedule_domain(dpcm_be_hw_params_async, &ops[n],
+				      &async_domain);
+		n++;
+	}
+	async_synchronize_full_domain(&async_domain);
+
+	for (i = 0; i < n; i++) {
+		if (ops[i].ret < 0) {
+			dev_err(ops[i].dpcm->be->dev,
+				"ASoC: hw_params BE failed %d\n", ops[i].ret);
+			if (!ret)
+				ret = ops[i].ret;
+			continue;
+		}
+		ops[i].dpcm->be->dpcm[stream].state =
+			SND_SOC_DPCM_STATE_HW_PARAMS;
+	}
+
+	if (ret < 0) {
+		for (i = n - 1; i >= 0; i--) {
+			if (ops[i].ret < 0 ||
+			    !snd_soc_dpcm_can_be_free_stop(fe, ops[i].dpcm->be,
+							   stream))
+				continue;
+			soc_pcm_hw_free(ops[i].substream);
+		}
+	}
+
+	kfree(ops);
+	return ret;
+}
+
 int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 {
+	struct dpcm_be_async *ops;
 	struct snd_soc_dpcm *dpcm;
 	int ret;
 
+	ops = dpcm_be_async_alloc(fe, stream);
+	if (ops)
+		return dpcm_be_dai_hw_params_parallel(fe, stream, ops);
+
 	list_for_each_entry(dpcm, &fe->dpcm[stream].be_clients, list_be) {
 
 		struct snd_soc_pcm_runtime *be = dpcm->be;
@@ -1937,6 +2414,7 @@ int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 				goto unwind;
 			}
 		}
+		dpcm_be_rate_fixup(fe, be, stream, &dpcm->hw_params);
 
 		/* only allow hw_params() if no connected FEs are running */
 		if (!snd_soc_dpcm_can_be_params(fe, be, stream))
@@ -2224,11 +2702,62 @@ static int dpcm_fe_dai_trigger(struct snd_pcm_substream *substream, int cmd)
 	return dpcm_fe_dai_do_trigger(substream, cmd);
 }
 
+/* As dpcm_be_dai_prepare(), with all BEs prepared concurrently */
+static int dpcm_be_dai_prepare_parallel(struct snd_soc_pcm_runtime *fe,
+	int stream, struct dpcm_be_async *ops)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	struct snd_soc_dpcm *dpcm;
+	int i, n = 0, ret = 0;
+
+	list_for_each_entry(dpcm, &fe->dpcm[stream].be_clients, list_be) {
+		struct snd_soc_pcm_runtime *be = dpcm->be;
+
+		if (!snd_soc_dpcm_be_can_update(fe, be, stream))
+			continue;
+
+		if ((be->dpcm[stream].state != SND_SOC_DPCM_STATE_HW_PARAMS) &&
+		    (be->dpcm[stream].state != SND_SOC_DPCM_STATE_STOP) &&
+		    (be->dpcm[stream].state != SND_SOC_DPCM_STATE_SUSPEND))
+			continue;
+
+		dev_dbg(be->dev, "ASoC: prepare BE %s\n",
+			be->dai_link->name);
+
+		ops[n].dpcm = dpcm;
+		ops[n].substream = snd_soc_dpcm_get_substream(be, stream);
+		async_schedule_domain(dpcm_be_prepare_async, &ops[n],
+				      &async_domain);
+		n++;
+	}
+	async_synchronize_full_domain(&async_domain);
+
+	for (i = 0; i < n; i++) {
+		if (ops[i].ret < 0) {
+			dev_err(ops[i].dpcm->be->dev,
+				"ASoC: backend prepare failed %d\n",
+				ops[i].ret);
+			if (!ret)
+				ret = ops[i].ret;
+			continue;
+		}
+		ops[i].dpcm->be->dpcm[stream].state = SND_SOC_DPCM_STATE_PREPARE;
+	}
+
+	kfree(ops);
+	return ret;
+}
+
 int dpcm_be_dai_prepare(struct snd_soc_pcm_runtime *fe, int stream)
 {
+	struct dpcm_be_async *ops;
 	struct snd_soc_dpcm *dpcm;
 	int ret = 0;
 
+	ops = dpcm_be_async_alloc(fe, stream);
+	if (ops)
+		return dpcm_be_dai_prepare_parallel(fe, stream, ops);
+
 	list_for_each_entry(dpcm, &fe->dpcm[stream].be_clients, list_be) {
 
 		struct snd_soc_pcm_runtime *be = dpcm->be;
@@ -2773,11 +3302,15 @@ int soc_new_pcm(struct snd_soc_pcm_runtime *rtd, int num)
 		rtd->ops.mmap		= platform->driver->ops->mmap;
 	}
 
-	if (playback)
+	if (playback) {
 		snd_pcm_set_ops(pcm, SNDRV_PCM_STREAM_PLAYBACK, &rtd->ops);
+		soc_pcm_init_dai_caps(rtd, SNDRV_PCM_STREAM_PLAYBACK);
+	}
 
-	if (capture)
+	if (capture) {
 		snd_pcm_set_ops(pcm, SNDRV_PCM_STREAM_CAPTURE, &rtd->ops);
+		soc_pcm_init_dai_caps(rtd, SNDRV_PCM_STREAM_CAPTURE);
+	}
 
 	if (platform->driver->pcm_new) {
 		ret = platform->driver->pcm_new(rtd);
@@ -29,6 +29,7 @@
 #include <linux/export.h>
 #include <linux/list.h>
 #include <linux/firmware.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -54,6 +55,18 @@
 #define SOC_TPLG_PASS_START	SOC_TPLG_PASS_MANIFEST
 #define SOC_TPLG_PASS_END	SOC_TPLG_PASS_LINK
 
+static const char * const soc_tplg_pass_names[] = {
+	[SOC_TPLG_PASS_MANIFEST] = "manifest",
+	[SOC_TPLG_PASS_VENDOR] = "vendor",
+	[SOC_TPLG_PASS_MIXER] = "mixer",
+	[SOC_TPLG_PASS_WIDGET] = "widget",
+	[SOC_TPLG_PASS_PCM_DAI] = "pcm dai",
+	[SOC_TPLG_PASS_GRAPH] = "graph",
+	[SOC_TPLG_PASS_PINS] = "pins",
+	[SOC_TPLG_PASS_BE_DAI] = "be dai",
+	[SOC_TPLG_PASS_LINK] = "link",
+};
+
 /*
  * Old version of ABI structs, supported for backward compatibility.
  */
@@ -2475,6 +2488,7 @@ static int soc_tplg_load_header(struct soc_tplg *tplg,
 static int soc_tplg_process_headers(struct soc_tplg *tplg)
 {
 	struct snd_soc_tplg_hdr *hdr;
+	ktime_t start;
 	int ret;
 
 	tplg->pass = SOC_TPLG_PASS_START;
@@ -2482,6 +2496,7 @@ static int soc_tplg_process_headers(struct soc_tplg *tplg)
 	/* process the header types from start to end */
 	while (tplg->pass <= SOC_TPLG_PASS_END) {
 
+		start = ktime_get();
 		tplg->hdr_pos = tplg->fw->data;
 		hdr = (struct snd_soc_tplg_hdr *)tplg->hdr_pos;
 
@@ -2505,15 +2520,23 @@ static int soc_tplg_process_headers(struct soc_tplg *tplg)
 			hdr = (struct snd_soc_tplg_hdr *)tplg->hdr_pos;
 		}
 
+		dev_dbg(tplg->dev, "ASoC: topology %s pass took %lld us\n",
+			soc_tplg_pass_names[tplg->pass],
+			ktime_us_delta(ktime_get(), start));
+
 		/* next data type pass */
 		tplg->pass++;
 	}
 
 	/* signal DAPM we are complete */
+	start = ktime_get();
 	ret = soc_tplg_dapm_complete(tplg);
 	if (ret < 0)
 		dev_err(tplg->dev,
 			"ASoC: failed to initialise DAPM from Firmware\n");
+	else
+		dev_dbg(tplg->dev, "ASoC: topology DAPM setup took %lld us\n",
+			ktime_us_delta(ktime_get(), start));
 
 	return ret;
 }
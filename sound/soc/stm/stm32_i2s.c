@@ -896,8 +896,10 @@ static int stm32_i2s_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_clocks_disable;
 
+	/* short periods without a DMA interrupt each */
 	ret = devm_snd_dmaengine_pcm_register(&pdev->dev,
-					      &stm32_i2s_pcm_config, 0);
+					      &stm32_i2s_pcm_config,
+					      SND_DMAENGINE_PCM_FLAG_PERIOD_TIMER);
 	if (ret)
 		goto err_clocks_disable;
 
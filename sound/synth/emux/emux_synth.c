@@ -61,7 +61,7 @@ snd_emux_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 {
 	struct snd_emux *emu;
 	int i, key, nvoices;
-	struct snd_emux_voice *vp;
+	struct snd_emux_voice *vp, *next;
 	struct snd_sf_zone *table[SNDRV_EMUX_MAX_MULTI_VOICES];
 	unsigned long flags;
 	struct snd_emux_port *port;
@@ -120,21 +120,22 @@ snd_emux_note_on(void *p, int note, int vel, struct snd_midi_channel *chan)
 
 		setup_voice(vp);
 
-		vp->state = SNDRV_EMUX_ST_STANDBY;
+		snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_STANDBY);
 		if (emu->ops.prepare) {
-			vp->state = SNDRV_EMUX_ST_OFF;
+			snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_OFF);
 			if (emu->ops.prepare(vp) >= 0)
-				vp->state = SNDRV_EMUX_ST_STANDBY;
+				snd_emux_voice_set_state(vp,
+							 SNDRV_EMUX_ST_STANDBY);
 		}
 	}
 
 	/* start envelope now */
-	for (i = 0; i < emu->max_voices; i++) {
-		vp = &emu->voices[i];
-		if (vp->state == SNDRV_EMUX_ST_STANDBY &&
-		    vp->chan == chan) {
+	list_for_each_entry_safe(vp, next,
+				 &emu->voice_list[SNDRV_EMUX_VOICE_STANDBY],
+				 list) {
+		if (vp->chan == chan) {
 			emu->ops.trigger(vp);
-			vp->state = SNDRV_EMUX_ST_ON;
+			snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_ON);
 			vp->ontime = jiffies; /* remember the trigger timing */
 		}
 	}
@@ -177,14 +178,15 @@ snd_emux_note_off(void *p, int note, int vel, struct snd_midi_channel *chan)
 		vp = &emu->voices[ch];
 		if (STATE_IS_PLAYING(vp->state) &&
 		    vp->chan == chan && vp->key == note) {
-			vp->state = SNDRV_EMUX_ST_RELEASED;
+			snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_RELEASED);
 			if (vp->ontime == jiffies) {
 				/* if note-off is sent too shortly after
 				 * note-on, emuX engine cannot produce the sound
 				 * correctly.  so we'll release this note
 				 * a bit later via timer callback.
 				 */
-				vp->state = SNDRV_EMUX_ST_PENDING;
+				snd_emux_voice_set_state(vp,
+							 SNDRV_EMUX_ST_PENDING);
 				if (! emu->timer_active) {
 					mod_timer(&emu->tlist, jiffies + 1);
 					emu->timer_active = 1;
@@ -205,19 +207,21 @@ snd_emux_note_off(void *p, int note, int vel, struct snd_midi_channel *chan)
 void snd_emux_timer_callback(unsigned long data)
 {
 	struct snd_emux *emu = (struct snd_emux *) data;
-	struct snd_emux_voice *vp;
+	struct snd_emux_voice *vp, *next;
 	unsigned long flags;
-	int ch, do_again = 0;
+	int do_again = 0;
 
 	spin_lock_irqsave(&emu->voice_lock, flags);
-	for (ch = 0; ch < emu->max_voices; ch++) {
-		vp = &emu->voices[ch];
+	list_for_each_entry_safe(vp, next,
+				 &emu->voice_list[SNDRV_EMUX_VOICE_RELEASED],
+				 list) {
 		if (vp->state == SNDRV_EMUX_ST_PENDING) {
 			if (vp->ontime == jiffies)
 				do_again++; /* release this at the next interrupt */
 			else {
 				emu->ops.release(vp);
-				vp->state = SNDRV_EMUX_ST_RELEASED;
+				snd_emux_voice_set_state(vp,
+							 SNDRV_EMUX_ST_RELEASED);
 			}
 		}
 	}
@@ -512,7 +516,7 @@ terminate_voice(struct snd_emux *emu, struct snd_emux_voice *vp, int free)
 	vp->port = NULL;
 	vp->zone = NULL;
 	vp->block = NULL;
-	vp->state = SNDRV_EMUX_ST_OFF;
+	snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_OFF);
 	if (free && emu->ops.free_voice)
 		emu->ops.free_voice(vp);
 }
@@ -932,19 +936,109 @@ snd_emux_init_voices(struct snd_emux *emu)
 	unsigned long flags;
 
 	spin_lock_irqsave(&emu->voice_lock, flags);
+	for (i = 0; i < SNDRV_EMUX_VOICE_LISTS; i++)
+		INIT_LIST_HEAD(&emu->voice_list[i]);
 	for (i = 0; i < emu->max_voices; i++) {
 		vp = &emu->voices[i];
 		vp->ch = -1; /* not used */
-		vp->state = SNDRV_EMUX_ST_OFF;
 		vp->chan = NULL;
 		vp->port = NULL;
 		vp->time = 0;
 		vp->emu = emu;
 		vp->hw = emu->hw;
+		INIT_LIST_HEAD(&vp->list);
+		snd_emux_voice_set_state(vp, SNDRV_EMUX_ST_OFF);
 	}
 	spin_unlock_irqrestore(&emu->voice_lock, flags);
 }
 
+/*
+ * The voices are kept on per-state lists, each in the order of the last
+ * state change, so that a voice for a new note is found at a list head
+ * instead of by scanning all voices.  Call with voice_lock held.
+ */
+static int voice_list_index(struct snd_emux_voice *vp)
+{
+	switch (vp->state) {
+	case SNDRV_EMUX_ST_OFF:
+		return vp->ch < 0 ? SNDRV_EMUX_VOICE_FREE :
+			SNDRV_EMUX_VOICE_OFF;
+	case SNDRV_EMUX_ST_RELEASED:
+	case SNDRV_EMUX_ST_PENDING:
+		return SNDRV_EMUX_VOICE_RELEASED;
+	case SNDRV_EMUX_ST_STANDBY:
+		return SNDRV_EMUX_VOICE_STANDBY;
+	case SNDRV_EMUX_ST_LOCKED:
+		return -1;
+	default:
+		return SNDRV_EMUX_VOICE_PLAYING;
+	}
+}
+
+/* set the voice state; call it also after changing vp->ch of an off voice */
+void snd_emux_voice_set_state(struct snd_emux_voice *vp, int state)
+{
+	int idx;
+
+	vp->state = state;
+	idx = voice_list_index(vp);
+	if (idx < 0)
+		list_del_init(&vp->list);
+	else
+		list_move_tail(&vp->list, &vp->emu->voice_list[idx]);
+}
+EXPORT_SYMBOL(snd_emux_voice_set_state);
+
+/*
+ * Pick a voice for a new note: a free one, else the oldest off one.
+ * Otherwise the oldest few released and playing voices are checked
+ * with finished() for having gone silent, before the oldest released
+ * and then the oldest playing voice is taken.  With active_only, the
+ * voices without hardware channel are skipped.  Call with voice_lock
+ * held.
+ */
+struct snd_emux_voice *
+snd_emux_find_voice(struct snd_emux *emu, int active_only,
+		    int (*finished)(struct snd_emux_voice *vp))
+{
+	static const int steal[] = {
+		SNDRV_EMUX_VOICE_RELEASED, SNDRV_EMUX_VOICE_PLAYING
+	};
+	struct snd_emux_voice *vp;
+	struct list_head *head;
+	int i, n;
+
+	for (i = active_only ? SNDRV_EMUX_VOICE_OFF : SNDRV_EMUX_VOICE_FREE;
+	     i <= SNDRV_EMUX_VOICE_OFF; i++) {
+		head = &emu->voice_list[i];
+		if (!list_empty(head))
+			return list_first_entry(head, struct snd_emux_voice,
+						list);
+	}
+
+	if (finished) {
+		for (i = 0; i < ARRAY_SIZE(steal); i++) {
+			n = 0;
+			list_for_each_entry(vp, &emu->voice_list[steal[i]],
+					    list) {
+				if (n++ >= SNDRV_EMUX_PROBE_VOICES)
+					break;
+				if (finished(vp))
+					return vp;
+			}
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(steal); i++) {
+		head = &emu->voice_list[steal[i]];
+		if (!list_empty(head))
+			return list_first_entry(head, struct snd_emux_voice,
+						list);
+	}
+	return NULL;
+}
+EXPORT_SYMBOL(snd_emux_find_voice);
+
 /*
  */
 void snd_emux_lock_voice(struct snd_emux *emu, int voice)
@@ -953,7 +1047,8 @@ void snd_emux_lock_voice(struct snd_emux *emu, int voice)
 
 	spin_lock_irqsave(&emu->voice_lock, flags);
 	if (emu->voices[voice].state == SNDRV_EMUX_ST_OFF)
-		emu->voices[voice].state = SNDRV_EMUX_ST_LOCKED;
+		snd_emux_voice_set_state(&emu->voices[voice],
+					 SNDRV_EMUX_ST_LOCKED);
 	else
 		snd_printk(KERN_WARNING
 			   "invalid voice for lock %d (state = %x)\n",
@@ -971,7 +1066,8 @@ void snd_emux_unlock_voice(struct snd_emux *emu, int voice)
 
 	spin_lock_irqsave(&emu->voice_lock, flags);
 	if (emu->voices[voice].state == SNDRV_EMUX_ST_LOCKED)
-		emu->voices[voice].state = SNDRV_EMUX_ST_OFF;
+		snd_emux_voice_set_state(&emu->voices[voice],
+					 SNDRV_EMUX_ST_OFF);
 	else
 		snd_printk(KERN_WARNING
 			   "invalid voice for unlock %d (state = %x)\n",
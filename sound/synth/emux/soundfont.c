@@ -27,7 +27,9 @@
  */
 #include <linux/uaccess.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <linux/export.h>
+#include <crypto/hash.h>
 #include <sound/core.h>
 #include <sound/soundfont.h>
 #include <sound/seq_oss_legacy.h>
@@ -48,6 +50,8 @@ static void set_sample_counter(struct snd_sf_list *sflist,
 			       struct snd_soundfont *sf, struct snd_sf_sample *sp);
 static struct snd_sf_sample *sf_sample_new(struct snd_sf_list *sflist,
 					   struct snd_soundfont *sf);
+static void sf_sample_free(struct snd_sf_list *sflist,
+			   struct snd_sf_sample *sp);
 static void sf_sample_delete(struct snd_sf_list *sflist,
 			     struct snd_soundfont *sf, struct snd_sf_sample *sp);
 static int load_map(struct snd_sf_list *sflist, const void __user *data, int count);
@@ -404,6 +408,35 @@ sf_sample_new(struct snd_sf_list *sflist, struct snd_soundfont *sf)
 	return sp;
 }
 
+/*
+ * release the data block of a sample; a shared one is freed with its
+ * last user only
+ */
+static void
+sf_sample_free(struct snd_sf_list *sflist, struct snd_sf_sample *sp)
+{
+	struct snd_sf_shared *sh = sp->shared, **p;
+
+	if (sh) {
+		sp->shared = NULL;
+		if (--sh->refcount > 0) {
+			sp->block = NULL;
+			return;
+		}
+		for (p = &sflist->shared; *p; p = &(*p)->next) {
+			if (*p == sh) {
+				*p = sh->next;
+				break;
+			}
+		}
+		kfree(sh);
+	}
+	sflist->mem_used -= sp->v.truesize;
+	if (sflist->callback.sample_free)
+		sflist->callback.sample_free(sflist->callback.private_data,
+					     sp, sflist->memhdr);
+}
+
 /*
  * delete sample list -- this is an exceptional job.
  * only the last allocated sample can be deleted.
@@ -698,6 +731,117 @@ find_sample(struct snd_soundfont *sf, int sample_id)
 }
 
 
+static int
+same_sample_layout(const struct soundfont_sample_info *a,
+		   const struct soundfont_sample_info *b)
+{
+	return a->start == b->start && a->end == b->end &&
+		a->loopstart == b->loopstart && a->loopend == b->loopend &&
+		a->size == b->size && a->mode_flags == b->mode_flags;
+}
+
+/*
+ * SHA-256 of the wave data; two blocks with the same digest are taken
+ * as the same data
+ */
+static int
+sample_digest(const void *buf, long count, u8 *digest)
+{
+	struct crypto_shash *tfm;
+	int rc;
+
+	tfm = crypto_alloc_shash("sha256", 0, 0);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+	{
+		SHASH_DESC_ON_STACK(desc, tfm);
+
+		desc->tfm = tfm;
+		desc->flags = 0;
+		rc = crypto_shash_digest(desc, buf, count, digest);
+		shash_desc_zero(desc);
+	}
+	crypto_free_shash(tfm);
+	return rc;
+}
+
+/*
+ * Load the wave data of a sample, or share the block of a sample already
+ * loaded with the same data, e.g. the same bank loaded by another client.
+ */
+static int
+load_sample_data(struct snd_sf_list *sflist, struct snd_sf_sample *sp,
+		 const void __user *data, long count)
+{
+	struct soundfont_sample_info key = sp->v;
+	struct snd_sf_shared *sh;
+	u8 digest[SHA256_DIGEST_SIZE];
+	mm_segment_t fs;
+	void *buf;
+	int rc;
+
+	/* a block larger than the whole synth memory can't be loaded */
+	if (sflist->memhdr && count > sflist->memhdr->size)
+		return -ENOMEM;
+
+	/*
+	 * read the data once: the block is loaded from the same copy that
+	 * is hashed, whatever user-space does meanwhile; the copy is only
+	 * kept for the load
+	 */
+	buf = vmalloc(count);
+	if (!buf)
+		return -ENOMEM;
+	if (copy_from_user(buf, data, count)) {
+		rc = -EFAULT;
+		goto out;
+	}
+	rc = sample_digest(buf, count, digest);
+	if (rc < 0)
+		goto out;
+
+	for (sh = sflist->shared; sh; sh = sh->next) {
+		if (sh->count == count && same_sample_layout(&sh->key, &key) &&
+		    !memcmp(sh->digest, digest, sizeof(digest))) {
+			sp->v = sh->v;
+			sp->v.sample = key.sample;
+			sp->v.sf_id = key.sf_id;
+			sp->block = sh->block;
+			sp->shared = sh;
+			sh->refcount++;
+			rc = 0;
+			goto out;
+		}
+	}
+
+	fs = get_fs();
+	set_fs(KERNEL_DS);
+	rc = sflist->callback.sample_new
+		(sflist->callback.private_data, sp, sflist->memhdr,
+		 (const void __force __user *)buf, count);
+	set_fs(fs);
+	if (rc < 0)
+		goto out;
+	sflist->mem_used += sp->v.truesize;
+
+	/* not shared if out of memory, but loaded all the same */
+	sh = kzalloc(sizeof(*sh), GFP_KERNEL);
+	if (sh) {
+		memcpy(sh->digest, digest, sizeof(digest));
+		sh->key = key;
+		sh->v = sp->v;
+		sh->block = sp->block;
+		sh->count = count;
+		sh->refcount = 1;
+		sh->next = sflist->shared;
+		sflist->shared = sh;
+		sp->shared = sh;
+	}
+out:
+	vfree(buf);
+	return rc;
+}
+
 /*
  * Load sample information, this can include data to be loaded onto
  * the soundcard.  It can also just be a pointer into soundcard ROM.
@@ -749,14 +893,11 @@ load_data(struct snd_sf_list *sflist, const void __user *data, long count)
 	 */
 	if (sp->v.size > 0) {
 		int  rc;
-		rc = sflist->callback.sample_new
-			(sflist->callback.private_data, sp, sflist->memhdr,
-			 data + off, count - off);
+		rc = load_sample_data(sflist, sp, data + off, count - off);
 		if (rc < 0) {
 			sf_sample_delete(sflist, sf, sp);
 			return rc;
 		}
-		sflist->mem_used += sp->v.truesize;
 	}
 
 	return count;
@@ -1357,6 +1498,7 @@ snd_sf_init(struct snd_sf_list *sflist)
 	sflist->sample_counter = 0;
 	sflist->zone_locked = 0;
 	sflist->sample_locked = 0;
+	sflist->shared = NULL;
 }
 
 /*
@@ -1377,9 +1519,7 @@ snd_sf_clear(struct snd_sf_list *sflist)
 		}
 		for (sp = sf->samples; sp; sp = nextsp) {
 			nextsp = sp->next;
-			if (sflist->callback.sample_free)
-				sflist->callback.sample_free(sflist->callback.private_data,
-							     sp, sflist->memhdr);
+			sf_sample_free(sflist, sp);
 			kfree(sp);
 		}
 		kfree(sf);
@@ -1479,10 +1619,7 @@ snd_soundfont_remove_unlocked(struct snd_sf_list *sflist)
 				break;
 			nextsp = sp->next;
 			sf->samples = nextsp;
-			sflist->mem_used -= sp->v.truesize;
-			if (sflist->callback.sample_free)
-				sflist->callback.sample_free(sflist->callback.private_data,
-							     sp, sflist->memhdr);
+			sf_sample_free(sflist, sp);
 			kfree(sp);
 		}
 	}
@@ -37,6 +37,10 @@ enum { /* settings for pcm */
 	OUT_EP = 6, IN_EP = 2, MAX_BUFSIZE = 128 * 1024
 };
 
+static int n_urbs = PCM_N_URBS;
+module_param(n_urbs, int, 0444);
+MODULE_PARM_DESC(n_urbs, "Number of URBs in flight per direction (2-16, default: 16).");
+
 enum { /* pcm streaming states */
 	STREAM_DISABLED, /* no pcm streaming */
 	STREAM_STARTING, /* pcm streaming requested, waiting to become ready */
@@ -163,7 +167,9 @@ static int usb6fire_pcm_stream_start(struct pcm_runtime *rt)
 		/* submit our in urbs */
 		rt->stream_wait_cond = false;
 		rt->stream_state = STREAM_STARTING;
-		for (i = 0; i < PCM_N_URBS; i++) {
+		snd_usb_urb_stats_reset(&rt->in_stats);
+		snd_usb_urb_stats_reset(&rt->out_stats);
+		for (i = 0; i < rt->n_urbs; i++) {
 			for (k = 0; k < PCM_N_PACKETS_PER_URB; k++) {
 				packet = &rt->in_urbs[i].packets[k];
 				packet->offset = k * rt->in_packet_size;
@@ -198,6 +204,7 @@ static void usb6fire_pcm_capture(struct pcm_substream *sub, struct pcm_urb *urb)
 	int i;
 	int frame;
 	int frame_count;
+	int n;
 	unsigned int total_length = 0;
 	struct pcm_runtime *rt = snd_pcm_substream_chip(sub->instance);
 	struct snd_pcm_runtime *alsa_rt = sub->instance->runtime;
@@ -225,12 +232,17 @@ static void usb6fire_pcm_capture(struct pcm_substream *sub, struct pcm_urb *urb)
 			return;
 		src++; /* skip leading 4 bytes of every packet */
 		total_length += urb->packets[i].length;
-		for (frame = 0; frame < frame_count; frame++) {
-			memcpy(dest, src, bytes_per_frame);
-			dest += alsa_rt->channels;
-			src += rt->in_n_analog;
-			sub->dma_off++;
-			sub->period_off++;
+		for (frame = 0; frame < frame_count; frame += n) {
+			/* same frame layout: copy up to the buffer end */
+			n = 1;
+			if (alsa_rt->channels == rt->in_n_analog)
+				n = min_t(int, frame_count - frame,
+					  alsa_rt->buffer_size - sub->dma_off);
+			memcpy(dest, src, n * bytes_per_frame);
+			dest += n * alsa_rt->channels;
+			src += n * rt->in_n_analog;
+			sub->dma_off += n;
+			sub->period_off += n;
 			if (dest == dest_end) {
 				sub->dma_off = 0;
 				dest = (u32 *) alsa_rt->dma_area;
@@ -246,6 +258,7 @@ static void usb6fire_pcm_playback(struct pcm_substream *sub,
 	int i;
 	int frame;
 	int frame_count;
+	int n;
 	struct pcm_runtime *rt = snd_pcm_substream_chip(sub->instance);
 	struct snd_pcm_runtime *alsa_rt = sub->instance->runtime;
 	u32 *src = (u32 *) (alsa_rt->dma_area + sub->dma_off
@@ -273,12 +286,17 @@ static void usb6fire_pcm_playback(struct pcm_substream *sub,
 		else
 			frame_count = 0;
 		dest++; /* skip leading 4 bytes of every frame */
-		for (frame = 0; frame < frame_count; frame++) {
-			memcpy(dest, src, bytes_per_frame);
-			src += alsa_rt->channels;
-			dest += rt->out_n_analog;
-			sub->dma_off++;
-			sub->period_off++;
+		for (frame = 0; frame < frame_count; frame += n) {
+			/* same frame layout: copy up to the buffer end */
+			n = 1;
+			if (alsa_rt->channels == rt->out_n_analog)
+				n = min_t(int, frame_count - frame,
+					  alsa_rt->buffer_size - sub->dma_off);
+			memcpy(dest, src, n * bytes_per_frame);
+			src += n * alsa_rt->channels;
+			dest += n * rt->out_n_analog;
+			sub->dma_off += n;
+			sub->period_off += n;
 			if (src == src_end) {
 				src = (u32 *) alsa_rt->dma_area;
 				sub->dma_off = 0;
@@ -299,15 +317,19 @@ static void usb6fire_pcm_in_urb_handler(struct urb *usb_urb)
 	int frame;
 	int channel;
 	int i;
+	int ret;
 	u8 *dest;
 
 	if (usb_urb->status || rt->panic || rt->stream_state == STREAM_STOPPING)
 		return;
 	for (i = 0; i < PCM_N_PACKETS_PER_URB; i++)
 		if (in_urb->packets[i].status) {
+			snd_usb_urb_stats_error(&rt->in_stats,
+						in_urb->packets[i].status);
 			rt->panic = true;
 			return;
 		}
+	snd_usb_urb_stats_complete(&rt->in_stats, PCM_URB_PERIOD_US);
 
 	if (rt->stream_state == STREAM_DISABLED) {
 		dev_err(&rt->chip->dev->dev,
@@ -372,8 +394,12 @@ static void usb6fire_pcm_in_urb_handler(struct urb *usb_urb)
 					*(dest++) = 0x40;
 				}
 		}
-	usb_submit_urb(&out_urb->instance, GFP_ATOMIC);
-	usb_submit_urb(&in_urb->instance, GFP_ATOMIC);
+	ret = usb_submit_urb(&out_urb->instance, GFP_ATOMIC);
+	if (ret < 0)
+		snd_usb_urb_stats_error(&rt->out_stats, ret);
+	ret = usb_submit_urb(&in_urb->instance, GFP_ATOMIC);
+	if (ret < 0)
+		snd_usb_urb_stats_error(&rt->in_stats, ret);
 }
 
 static void usb6fire_pcm_out_urb_handler(struct urb *usb_urb)
@@ -381,6 +407,11 @@ static void usb6fire_pcm_out_urb_handler(struct urb *usb_urb)
 	struct pcm_urb *urb = usb_urb->context;
 	struct pcm_runtime *rt = urb->chip->pcm;
 
+	if (usb_urb->status)
+		snd_usb_urb_stats_error(&rt->out_stats, usb_urb->status);
+	else
+		snd_usb_urb_stats_complete(&rt->out_stats, PCM_URB_PERIOD_US);
+
 	if (rt->stream_state == STREAM_STARTING) {
 		rt->stream_wait_cond = true;
 		wake_up(&rt->stream_wait_queue);
@@ -586,6 +617,15 @@ static void usb6fire_pcm_init_urb(struct pcm_urb *urb,
 	urb->instance.number_of_packets = PCM_N_PACKETS_PER_URB;
 }
 
+static void usb6fire_pcm_proc_read(struct snd_info_entry *entry,
+				   struct snd_info_buffer *buffer)
+{
+	struct pcm_runtime *rt = entry->private_data;
+
+	snd_usb_urb_stats_print(buffer, "Capture", rt->n_urbs, &rt->in_stats);
+	snd_usb_urb_stats_print(buffer, "Playback", rt->n_urbs, &rt->out_stats);
+}
+
 static int usb6fire_pcm_buffers_init(struct pcm_runtime *rt)
 {
 	int i;
@@ -618,6 +658,7 @@ int usb6fire_pcm_init(struct sfire_chip *chip)
 	int i;
 	int ret;
 	struct snd_pcm *pcm;
+	struct snd_info_entry *entry;
 	struct pcm_runtime *rt =
 			kzalloc(sizeof(struct pcm_runtime), GFP_KERNEL);
 
@@ -632,6 +673,7 @@ int usb6fire_pcm_init(struct sfire_chip *chip)
 	}
 
 	rt->chip = chip;
+	rt->n_urbs = clamp(n_urbs, 2, (int)PCM_N_URBS);
 	rt->stream_state = STREAM_DISABLED;
 	rt->rate = ARRAY_SIZE(rates);
 	init_waitqueue_head(&rt->stream_wait_queue);
@@ -672,6 +714,9 @@ int usb6fire_pcm_init(struct sfire_chip *chip)
 	}
 	rt->instance = pcm;
 
+	if (!snd_card_proc_new(chip->card, "pcm_stats", &entry))
+		snd_info_set_text_ops(entry, rt, usb6fire_pcm_proc_read);
+
 	chip->pcm = rt;
 	return 0;
 }
@@ -18,11 +18,14 @@
 #include <linux/mutex.h>
 
 #include "common.h"
+#include "../urb_stats.h"
 
 enum /* settings for pcm */
 {
 	/* maximum of EP_W_MAX_PACKET_SIZE[] (see firmware.c) */
-	PCM_N_URBS = 16, PCM_N_PACKETS_PER_URB = 8, PCM_MAX_PACKET_SIZE = 604
+	PCM_N_URBS = 16, PCM_N_PACKETS_PER_URB = 8, PCM_MAX_PACKET_SIZE = 604,
+	/* one packet per high speed microframe */
+	PCM_URB_PERIOD_US = PCM_N_PACKETS_PER_URB * 125
 };
 
 struct pcm_urb {
@@ -57,6 +60,9 @@ struct pcm_runtime {
 
 	struct pcm_urb in_urbs[PCM_N_URBS];
 	struct pcm_urb out_urbs[PCM_N_URBS];
+	int n_urbs; /* in urbs submitted, see the n_urbs option */
+	struct snd_usb_urb_stats in_stats;
+	struct snd_usb_urb_stats out_stats;
 	int in_packet_size;
 	int out_packet_size;
 	int in_n_analog; /* number of analog channels soundcard sends */
@@ -20,6 +20,7 @@
 #include <linux/spinlock.h>
 #include <linux/slab.h>
 #include <linux/init.h>
+#include <linux/module.h>
 #include <linux/usb.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -40,6 +41,10 @@
 #define ENDPOINT_CAPTURE	2
 #define ENDPOINT_PLAYBACK	6
 
+static int n_urbs = N_URBS;
+module_param(n_urbs, int, 0444);
+MODULE_PARM_DESC(n_urbs, "Number of input URBs in flight (2-" __stringify(N_URBS) ", default: " __stringify(N_URBS) ").");
+
 #define MAKE_CHECKBYTE(cdev,stream,i) \
 	(stream << 1) | (~(i / (cdev->n_streams * BYTES_PER_SAMPLE_USB)) & 1)
 
@@ -116,8 +121,10 @@ static int stream_start(struct snd_usb_caiaqdev *cdev)
 	cdev->first_packet = 4;
 	cdev->streaming = 1;
 	cdev->warned = 0;
+	snd_usb_urb_stats_reset(&cdev->in_stats);
+	snd_usb_urb_stats_reset(&cdev->out_stats);
 
-	for (i = 0; i < N_URBS; i++) {
+	for (i = 0; i < cdev->n_urbs; i++) {
 		ret = usb_submit_urb(cdev->data_urbs_in[i], GFP_ATOMIC);
 		if (ret) {
 			dev_err(dev, "unable to trigger read #%d! (ret %d)\n",
@@ -638,7 +645,7 @@ static void read_completed(struct urb *urb)
 	int i, frame, len, send_it = 0, outframe = 0;
 	size_t offset = 0;
 
-	if (urb->status || !info)
+	if (!info)
 		return;
 
 	cdev = info->cdev;
@@ -647,6 +654,12 @@ static void read_completed(struct urb *urb)
 	if (!cdev->streaming)
 		return;
 
+	if (urb->status) {
+		snd_usb_urb_stats_error(&cdev->in_stats, urb->status);
+		return;
+	}
+	snd_usb_urb_stats_complete(&cdev->in_stats, cdev->urb_period_us);
+
 	/* find an unused output urb that is unused */
 	for (i = 0; i < N_URBS; i++)
 		if (test_and_set_bit(i, &cdev->outurb_active_mask) == 0) {
@@ -685,8 +698,12 @@ static void read_completed(struct urb *urb)
 	}
 
 	if (send_it) {
+		int err;
+
 		out->number_of_packets = outframe;
-		usb_submit_urb(out, GFP_ATOMIC);
+		err = usb_submit_urb(out, GFP_ATOMIC);
+		if (err < 0)
+			snd_usb_urb_stats_error(&cdev->out_stats, err);
 	} else {
 		struct snd_usb_caiaq_cb_info *oinfo = out->context;
 		clear_bit(oinfo->index, &cdev->outurb_active_mask);
@@ -709,6 +726,12 @@ static void write_completed(struct urb *urb)
 	struct snd_usb_caiaq_cb_info *info = urb->context;
 	struct snd_usb_caiaqdev *cdev = info->cdev;
 
+	if (urb->status)
+		snd_usb_urb_stats_error(&cdev->out_stats, urb->status);
+	else
+		snd_usb_urb_stats_complete(&cdev->out_stats,
+					   cdev->urb_period_us);
+
 	if (!cdev->output_running) {
 		cdev->output_running = 1;
 		wake_up(&cdev->prepare_wait_queue);
@@ -790,10 +813,22 @@ static void free_urbs(struct urb **urbs)
 	kfree(urbs);
 }
 
+static void proc_read_stats(struct snd_info_entry *entry,
+			    struct snd_info_buffer *buffer)
+{
+	struct snd_usb_caiaqdev *cdev = entry->private_data;
+
+	snd_usb_urb_stats_print(buffer, "Capture", cdev->n_urbs,
+				&cdev->in_stats);
+	snd_usb_urb_stats_print(buffer, "Playback", cdev->n_urbs,
+				&cdev->out_stats);
+}
+
 int snd_usb_caiaq_audio_init(struct snd_usb_caiaqdev *cdev)
 {
 	int i, ret;
 	struct device *dev = caiaqdev_to_dev(cdev);
+	struct snd_info_entry *entry;
 
 	cdev->n_audio_in  = max(cdev->spec.num_analog_audio_in,
 			       cdev->spec.num_digital_audio_in) /
@@ -865,6 +900,9 @@ int snd_usb_caiaq_audio_init(struct snd_usb_caiaqdev *cdev)
 
 	cdev->outurb_active_mask = 0;
 	BUILD_BUG_ON(N_URBS > (sizeof(cdev->outurb_active_mask) * 8));
+	cdev->n_urbs = clamp(n_urbs, 2, N_URBS);
+	cdev->urb_period_us = FRAMES_PER_URB *
+		(cdev->chip.dev->speed == USB_SPEED_FULL ? 1000 : 125);
 
 	for (i = 0; i < N_URBS; i++) {
 		cdev->data_cb_info[i].cdev = cdev;
@@ -886,6 +924,9 @@ int snd_usb_caiaq_audio_init(struct snd_usb_caiaqdev *cdev)
 		return ret;
 	}
 
+	if (!snd_card_proc_new(cdev->chip.card, "pcm_stats", &entry))
+		snd_info_set_text_ops(entry, cdev, proc_read_stats);
+
 	return 0;
 }
 
@@ -3,6 +3,7 @@
 #define CAIAQ_DEVICE_H
 
 #include "../usbaudio.h"
+#include "../urb_stats.h"
 
 #define USB_VID_NATIVEINSTRUMENTS 0x17cc
 
@@ -90,6 +91,9 @@ struct snd_usb_caiaqdev {
 	char *audio_in_buf, *audio_out_buf;
 	unsigned int samplerates, bpp;
 	unsigned long outurb_active_mask;
+	int n_urbs;			/* input urbs submitted */
+	unsigned int urb_period_us;
+	struct snd_usb_urb_stats in_stats, out_stats;
 
 	struct snd_pcm_substream *sub_playback[MAX_STREAMS];
 	struct snd_pcm_substream *sub_capture[MAX_STREAMS];
@@ -45,6 +45,8 @@
 #include <linux/usb/audio.h>
 #include <linux/usb/audio-v2.h>
 #include <linux/module.h>
+#include <linux/sched.h>
+#include <uapi/linux/sched/types.h>
 
 #include <sound/control.h>
 #include <sound/core.h>
@@ -64,6 +66,7 @@
 #include "debug.h"
 #include "pcm.h"
 #include "format.h"
+#include "packets.h"
 #include "power.h"
 #include "stream.h"
 
@@ -82,6 +85,17 @@ static int pid[SNDRV_CARDS] = { [0 ... (SNDRV_CARDS-1)] = -1 };
 static int device_setup[SNDRV_CARDS]; /* device parameter for this card */
 static bool ignore_ctl_error;
 static bool autoclock = true;
+static bool zerocopy;
+static bool lowlatency;
+static bool packet_mmap;
+static int feedback_filter;
+static bool lazy_mixer = true;
+static bool mixer_cache = true;
+static bool reinit_clock[SNDRV_CARDS];
+static int max_urbs[SNDRV_CARDS] = { [0 ... (SNDRV_CARDS-1)] = MAX_URBS };
+static int max_queue[SNDRV_CARDS] = { [0 ... (SNDRV_CARDS-1)] = MAX_QUEUE };
+static int urb_cpu[SNDRV_CARDS] = { [0 ... (SNDRV_CARDS-1)] = -1 };
+static int clock_follow[SNDRV_CARDS] = { [0 ... (SNDRV_CARDS-1)] = -1 };
 static char *quirk_alias[SNDRV_CARDS];
 
 module_param_array(index, int, NULL, 0444);
@@ -101,6 +115,28 @@ MODULE_PARM_DESC(ignore_ctl_error,
 		 "Ignore errors from USB controller for mixer interfaces.");
 module_param(autoclock, bool, 0444);
 MODULE_PARM_DESC(autoclock, "Enable auto-clock selection for UAC2 devices (default: yes).");
+module_param(zerocopy, bool, 0444);
+MODULE_PARM_DESC(zerocopy, "Send playback URBs directly from the PCM buffer (default: no).");
+module_param(lowlatency, bool, 0444);
+MODULE_PARM_DESC(lowlatency, "Queue only the written playback data to the device (default: no).");
+module_param(packet_mmap, bool, 0444);
+MODULE_PARM_DESC(packet_mmap, "Publish a read-only log of the stream packets through a hwdep device (default: no).");
+module_param(feedback_filter, int, 0444);
+MODULE_PARM_DESC(feedback_filter, "Low-pass the feedback rate over 2^N values (0-" __stringify(FEEDBACK_FILTER_MAX) ", default: 0 = off).");
+module_param(lazy_mixer, bool, 0444);
+MODULE_PARM_DESC(lazy_mixer, "Query the mixer control ranges on their first access (default: yes).");
+module_param(mixer_cache, bool, 0444);
+MODULE_PARM_DESC(mixer_cache, "Reuse the mixer control ranges of identical devices (default: yes).");
+module_param_array(reinit_clock, bool, NULL, 0444);
+MODULE_PARM_DESC(reinit_clock, "Redo the clock setup at each stream setup, even if unchanged.");
+module_param_array(max_urbs, int, NULL, 0444);
+MODULE_PARM_DESC(max_urbs, "Max. number of URBs per endpoint (4-" __stringify(MAX_URBS_LIMIT) ", default: " __stringify(MAX_URBS) ").");
+module_param_array(max_queue, int, NULL, 0444);
+MODULE_PARM_DESC(max_queue, "Max. playback URB queue length in ms (default: " __stringify(MAX_QUEUE) ").");
+module_param_array(urb_cpu, int, NULL, 0444);
+MODULE_PARM_DESC(urb_cpu, "Process URB completions on an RT thread on this CPU (default: -1 = in the completion handler).");
+module_param_array(clock_follow, int, NULL, 0444);
+MODULE_PARM_DESC(clock_follow, "Pace adaptive playback by the feedback of this sound card number (default: -1 = off).");
 module_param_array(quirk_alias, charp, NULL, 0444);
 MODULE_PARM_DESC(quirk_alias, "Quirk aliases, e.g. 0123abcd:5678beef.");
 
@@ -330,6 +366,9 @@ static int snd_usb_audio_free(struct snd_usb_audio *chip)
 {
 	struct snd_usb_endpoint *ep, *n;
 
+	if (chip->urb_worker)
+		kthread_destroy_worker(chip->urb_worker);
+
 	list_for_each_entry_safe(ep, n, &chip->ep_list, list)
 		snd_usb_endpoint_free(ep);
 
@@ -346,6 +385,101 @@ static int snd_usb_audio_dev_free(struct snd_device *device)
 	return snd_usb_audio_free(chip);
 }
 
+/*
+ * URB queue depth; a deeper queue rides out late completions at the cost
+ * of latency.  The new values apply from the next stream setup.
+ */
+static ssize_t max_urbs_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct snd_usb_audio *chip = dev_to_snd_card(dev)->private_data;
+
+	return sprintf(buf, "%u\n", chip->max_urbs);
+}
+
+static ssize_t max_urbs_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct snd_usb_audio *chip = dev_to_snd_card(dev)->private_data;
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(buf, 0, &val);
+	if (err < 0)
+		return err;
+	if (val < SYNC_URBS || val > MAX_URBS_LIMIT)
+		return -EINVAL;
+	chip->max_urbs = val;
+	return count;
+}
+
+static DEVICE_ATTR_RW(max_urbs);
+
+static ssize_t max_queue_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct snd_usb_audio *chip = dev_to_snd_card(dev)->private_data;
+
+	return sprintf(buf, "%u\n", chip->max_queue);
+}
+
+static ssize_t max_queue_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct snd_usb_audio *chip = dev_to_snd_card(dev)->private_data;
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(buf, 0, &val);
+	if (err < 0)
+		return err;
+	if (!val || val > MAX_QUEUE_LIMIT)
+		return -EINVAL;
+	chip->max_queue = val;
+	return count;
+}
+
+static DEVICE_ATTR_RW(max_queue);
+
+static struct attribute *usb_audio_card_attrs[] = {
+	&dev_attr_max_urbs.attr,
+	&dev_attr_max_queue.attr,
+	NULL
+};
+
+static const struct attribute_group usb_audio_card_attr_group = {
+	.attrs = usb_audio_card_attrs,
+};
+
+/*
+ * Create the thread processing the URB completions of all endpoints of
+ * the card, so that busy cards can be spread over CPUs instead of all
+ * sharing the host controller interrupt.
+ */
+static void snd_usb_create_urb_worker(struct snd_usb_audio *chip, int cpu)
+{
+	struct sched_param param = { .sched_priority = SNDRV_RT_PRIO };
+	struct kthread_worker *worker;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu)) {
+		dev_warn(&chip->dev->dev, "invalid urb_cpu %d, ignored\n", cpu);
+		return;
+	}
+
+	worker = kthread_create_worker_on_cpu(cpu, 0, "usbaudio%d/%d",
+					      chip->index, cpu);
+	if (IS_ERR(worker)) {
+		dev_warn(&chip->dev->dev,
+			 "cannot create the URB worker: %ld\n", PTR_ERR(worker));
+		return;
+	}
+	sched_setscheduler(worker->task, SCHED_FIFO, &param);
+	chip->urb_worker = worker;
+	chip->urb_cpu = cpu;
+}
+
 /*
  * create a chip instance and set its names.
  */
@@ -398,11 +532,26 @@ static int snd_usb_audio_create(struct usb_interface *intf,
 	chip->card = card;
 	chip->setup = device_setup[idx];
 	chip->autoclock = autoclock;
+	chip->zerocopy = zerocopy;
+	chip->lowlatency = lowlatency;
+	chip->packet_mmap = packet_mmap;
+	chip->feedback_filter = clamp(feedback_filter, 0, FEEDBACK_FILTER_MAX);
+	chip->lazy_mixer = lazy_mixer;
+	chip->mixer_cache = mixer_cache;
+	chip->reinit_clock = reinit_clock[idx];
+	atomic_set(&chip->clock_gen, 0);
+	chip->max_urbs = clamp_t(int, max_urbs[idx], SYNC_URBS, MAX_URBS_LIMIT);
+	chip->max_queue = clamp_t(int, max_queue[idx], 1, MAX_QUEUE_LIMIT);
+	chip->clock_follow = clock_follow[idx] < SNDRV_CARDS ?
+		clock_follow[idx] : -1;
+	if (urb_cpu[idx] >= 0)
+		snd_usb_create_urb_worker(chip, urb_cpu[idx]);
 	atomic_set(&chip->active, 1); /* avoid autopm during probing */
 	atomic_set(&chip->usage_count, 0);
 	atomic_set(&chip->shutdown, 0);
 
 	chip->usb_id = usb_id;
+	snd_usb_init_quirk_flags(chip);
 	INIT_LIST_HEAD(&chip->pcm_list);
 	INIT_LIST_HEAD(&chip->ep_list);
 	INIT_LIST_HEAD(&chip->midi_list);
@@ -414,6 +563,9 @@ static int snd_usb_audio_create(struct usb_interface *intf,
 		return err;
 	}
 
+	card->private_data = chip;
+	snd_card_add_dev_attr(card, &usb_audio_card_attr_group);
+
 	strcpy(card->driver, "USB-Audio");
 	sprintf(component, "USB%04x:%04x",
 		USB_ID_VENDOR(chip->usb_id), USB_ID_PRODUCT(chip->usb_id));
@@ -577,6 +729,10 @@ static int usb_audio_probe(struct usb_interface *intf,
 			}
 			chip = usb_chip[i];
 			atomic_inc(&chip->active); /* avoid autopm */
+			/* the card may still be registering for the
+			 * previous interface; add the streams after it
+			 */
+			snd_card_async_synchronize(chip->card);
 			break;
 		}
 	}
@@ -625,13 +781,25 @@ static int usb_audio_probe(struct usb_interface *intf,
 		err = snd_usb_create_streams(chip, ifnum);
 		if (err < 0)
 			goto __error;
+		if (chip->packet_mmap && !chip->packets_hwdep) {
+			err = snd_usb_packets_hwdep_new(chip);
+			if (err < 0)
+				goto __error;
+		}
 		err = snd_usb_create_mixer(chip, ifnum, ignore_ctl_error);
 		if (err < 0)
 			goto __error;
 	}
 
-	/* we are allowed to call snd_card_register() many times */
-	err = snd_card_register(chip->card);
+	/* we are allowed to call snd_card_register() many times; the device
+	 * nodes of a new card are created in the background, in parallel with
+	 * other cards, while the later interfaces register synchronously and
+	 * get the error of that registration as well
+	 */
+	if (chip->num_interfaces)
+		err = snd_card_register(chip->card);
+	else
+		err = snd_card_register_async(chip->card);
 	if (err < 0)
 		goto __error;
 
@@ -667,7 +835,12 @@ static void usb_audio_disconnect(struct usb_interface *intf)
 
 	card = chip->card;
 
-	mutex_lock(&register_mutex);
+	/*
+	 * The teardown below only touches this chip and is guarded by the
+	 * shutdown count, so it runs without register_mutex; this keeps the
+	 * disconnection of one device from stalling the probe or removal
+	 * of the others.
+	 */
 	if (atomic_inc_return(&chip->shutdown) == 1) {
 		struct snd_usb_stream *as;
 		struct snd_usb_endpoint *ep;
@@ -683,7 +856,12 @@ static void usb_audio_disconnect(struct usb_interface *intf)
 		list_for_each_entry(as, &chip->pcm_list, list) {
 			snd_usb_stream_disconnect(as);
 		}
-		/* release the endpoint resources */
+		/* unlink the URBs of all endpoints first, then wait for
+		 * them, so that the endpoints retire in parallel
+		 */
+		list_for_each_entry(ep, &chip->ep_list, list) {
+			snd_usb_endpoint_kill(ep);
+		}
 		list_for_each_entry(ep, &chip->ep_list, list) {
 			snd_usb_endpoint_release(ep);
 		}
@@ -697,6 +875,7 @@ static void usb_audio_disconnect(struct usb_interface *intf)
 		}
 	}
 
+	mutex_lock(&register_mutex);
 	chip->num_interfaces--;
 	if (chip->num_interfaces <= 0) {
 		usb_chip[chip->index] = NULL;
@@ -773,6 +952,9 @@ static int usb_audio_suspend(struct usb_interface *intf, pm_message_t message)
 			snd_pcm_suspend_all(as->pcm);
 			as->substream[0].need_setup_ep =
 				as->substream[1].need_setup_ep = true;
+			/* the device may forget its settings meanwhile */
+			as->substream[0].clock_fmt = as->substream[1].clock_fmt = NULL;
+			as->substream[0].pitch_fmt = as->substream[1].pitch_fmt = NULL;
 		}
 		list_for_each(p, &chip->midi_list)
 			snd_usbmidi_suspend(p);
@@ -858,4 +1040,16 @@ static struct usb_driver usb_audio_driver = {
 	.supports_autosuspend = 1,
 };
 
-module_usb_driver(usb_audio_driver);
+static int __init usb_audio_init(void)
+{
+	return usb_register(&usb_audio_driver);
+}
+
+static void __exit usb_audio_cleanup(void)
+{
+	usb_deregister(&usb_audio_driver);
+	snd_usb_mixer_free_range_cache();
+}
+
+module_init(usb_audio_init);
+module_exit(usb_audio_cleanup);
@@ -2,12 +2,20 @@
 #ifndef __USBAUDIO_CARD_H
 #define __USBAUDIO_CARD_H
 
+#include <linux/kthread.h>
+#include <linux/llist.h>
+
+#include "urb_stats.h"
+
 #define MAX_NR_RATES	1024
 #define MAX_PACKS	6		/* per URB */
 #define MAX_PACKS_HS	(MAX_PACKS * 8)	/* in high speed mode */
-#define MAX_URBS	12
+#define MAX_URBS	12	/* default, see the max_urbs option */
+#define MAX_URBS_LIMIT	BITS_PER_LONG	/* size of active_mask */
 #define SYNC_URBS	4	/* always four urbs for sync */
 #define MAX_QUEUE	18	/* try not to exceed this queue length, in ms */
+#define MAX_QUEUE_LIMIT	1000
+#define FEEDBACK_FILTER_MAX	10	/* log2 of the feedback time constant */
 
 struct audioformat {
 	struct list_head list;
@@ -37,15 +45,29 @@ struct audioformat {
 struct snd_usb_substream;
 struct snd_usb_endpoint;
 
+/* endpoint statistics since the last start, shown in proc */
+struct snd_usb_ep_stats {
+	struct snd_usb_urb_stats urb;	/* completions, failed packets and submissions */
+	unsigned int queued_min;	/* fewest urbs left queued at a completion */
+	unsigned int silent;		/* urbs sent with silence */
+	unsigned int fb_corrected;	/* feedback values fixed up by a quirk */
+	unsigned int fb_rejected;	/* feedback values out of range */
+};
+
 struct snd_urb_ctx {
 	struct urb *urb;
 	unsigned int buffer_size;	/* size of data buffer, if data URB */
+	void *buffer;			/* own data buffer; the urb may point */
+	dma_addr_t buffer_dma;		/* into the PCM buffer instead */
+	unsigned int queued;		/* PCM bytes accounted in inflight */
+	bool period_elapsed;		/* notify at retire (lowlatency) */
 	struct snd_usb_substream *subs;
 	struct snd_usb_endpoint *ep;
 	int index;	/* index for urb array */
 	int packets;	/* number of packets per urb */
 	int packet_size[MAX_PACKS_HS]; /* size of packets for next submission */
 	struct list_head ready_list;
+	struct llist_node done_node;	/* completed, for the urb worker */
 };
 
 struct snd_usb_endpoint {
@@ -56,8 +78,8 @@ struct snd_usb_endpoint {
 	int type;		/* SND_USB_ENDPOINT_TYPE_* */
 	unsigned long flags;
 
-	void (*prepare_data_urb) (struct snd_usb_substream *subs,
-				  struct urb *urb);
+	int (*prepare_data_urb) (struct snd_usb_substream *subs,
+				 struct urb *urb);
 	void (*retire_data_urb) (struct snd_usb_substream *subs,
 				 struct urb *urb);
 
@@ -65,13 +87,14 @@ struct snd_usb_endpoint {
 	struct snd_usb_endpoint *sync_master;
 	struct snd_usb_endpoint *sync_slave;
 
-	struct snd_urb_ctx urb[MAX_URBS];
+	struct snd_urb_ctx *urb;	/* max_urbs entries */
 
 	struct snd_usb_packet_info {
 		uint32_t packet_size[MAX_PACKS_HS];
 		int packets;
-	} next_packet[MAX_URBS];
+	} *next_packet;			/* max_urbs entries */
 	int next_packet_read_pos, next_packet_write_pos;
+	unsigned int max_urbs;		/* size of urb[] and next_packet[] */
 	struct list_head ready_playback_urbs;
 
 	unsigned int nurbs;		/* # urbs */
@@ -86,6 +109,13 @@ struct snd_usb_endpoint {
 	int	   freqshift;		/* how much to shift the feedback value to get Q16.16 */
 	unsigned int freqmax;		/* maximum sampling rate, used for buffer management */
 	unsigned int phase;		/* phase accumulator */
+	u64 fb_avg;			/* filtered feedback << feedback_filter */
+	unsigned int fb_count;		/* feedback values since setup */
+	unsigned int fb_min, fb_max;	/* raw feedback range, Q16.16 */
+	unsigned int fb_last;		/* last raw feedback value */
+	unsigned int fb_jitter;		/* average change between values << 4 */
+	unsigned int fb_jitter_max;	/* largest change between values */
+	struct snd_usb_ep_stats stats;
 	unsigned int maxpacksize;	/* max packet size in bytes */
 	unsigned int maxframesize;      /* max packet size in frames */
 	unsigned int max_urb_frames;	/* max URB size in frames */
@@ -94,6 +124,9 @@ struct snd_usb_endpoint {
 	unsigned int syncmaxsize;	/* sync endpoint packet size */
 	unsigned int fill_max:1;	/* fill max packet size always */
 	unsigned int tenor_fb_quirk:1;	/* corrupted feedback data */
+	unsigned int lowlatency:1;	/* send only the available data */
+	unsigned int clock_follow:1;	/* freqm follows chip->clock_follow */
+	unsigned int clock_source:1;	/* publishes its feedback rate */
 	unsigned int datainterval;      /* log_2 of data packet interval */
 	unsigned int syncinterval;	/* P for adaptive mode, 0 otherwise */
 	unsigned char silence_value;
@@ -103,6 +136,9 @@ struct snd_usb_endpoint {
 					   in a stream */
 
 	spinlock_t lock;
+	spinlock_t submit_lock;		/* serializes the lowlatency refills */
+	struct llist_head done_urbs;	/* completions for chip->urb_worker */
+	struct kthread_work complete_work;
 	struct list_head list;
 };
 
@@ -130,6 +166,8 @@ struct snd_usb_substream {
 	unsigned int running: 1;	/* running status */
 
 	unsigned int hwptr_done;	/* processed byte position in the buffer */
+	snd_pcm_uframes_t sent_frames;	/* frames sent since prepare, up to boundary */
+	unsigned int inflight;		/* bytes queued (zerocopy), not yet retired */
 	unsigned int transfer_done;		/* processed frames since last period update */
 	unsigned int frame_limit;	/* limits number of packets in URB */
 
@@ -157,6 +195,16 @@ struct snd_usb_substream {
 	} dsd_dop;
 
 	bool trigger_tstamp_pending_update; /* trigger timestamp being updated from initial estimate */
+
+	/* the last clock setup, valid while chip->clock_gen is unchanged */
+	struct audioformat *clock_fmt;
+	unsigned int clock_rate;
+	unsigned int clock_gen;
+	/* the format the pitch control was set for, until the next altsetting */
+	struct audioformat *pitch_fmt;
+
+	struct snd_dma_buffer zc_buf;	/* coherent buffer for zerocopy playback */
+	struct usb_audio_packets *pkt_ring;	/* see the packet_mmap option */
 };
 
 struct snd_usb_stream {
@@ -21,6 +21,7 @@
 #include <linux/usb.h>
 #include <linux/usb/audio.h>
 #include <linux/slab.h>
+#include <linux/math64.h>
 
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -33,6 +34,9 @@
 #include "pcm.h"
 #include "quirks.h"
 
+#define CREATE_TRACE_POINTS
+#include "trace.h"
+
 #define EP_FLAG_RUNNING		1
 #define EP_FLAG_STOPPING	2
 
@@ -88,15 +92,29 @@ static void release_urb_ctx(struct snd_urb_ctx *u)
 {
 	if (u->buffer_size)
 		usb_free_coherent(u->ep->chip->dev, u->buffer_size,
-				  u->urb->transfer_buffer,
-				  u->urb->transfer_dma);
+				  u->buffer, u->buffer_dma);
 	usb_free_urb(u->urb);
 	u->urb = NULL;
 }
 
-static const char *usb_error_string(int err)
+/* also used for the completion status shown in proc */
+const char *snd_usb_error_string(int err)
 {
 	switch (err) {
+	case 0:
+		return "no error";
+	case -EPROTO:
+	case -EILSEQ:
+		return "protocol error";
+	case -ETIME:
+		return "timeout";
+	case -EOVERFLOW:
+		return "babble";
+	case -EXDEV:
+		return "packet not transferred";
+	case -ENOSR:
+	case -ECOMM:
+		return "host buffer overrun";
 	case -ENODEV:
 		return "no device";
 	case -ENOENT:
@@ -135,25 +153,50 @@ int snd_usb_endpoint_implicit_feedback_sink(struct snd_usb_endpoint *ep)
 		usb_pipeout(ep->pipe);
 }
 
+/*
+ * Clock following: the rate measured by the feedback of a card's
+ * endpoints is published here as freqm/freqn in Q2.30, by card number.
+ * The adaptive playback endpoints of the cards set to follow it scale
+ * their packet sizes by the same ratio, so that they run off one clock.
+ */
+static u32 clock_ratio[SNDRV_CARDS];
+
+static void follow_clock(struct snd_usb_endpoint *ep)
+{
+	u32 ratio = READ_ONCE(clock_ratio[ep->chip->clock_follow]);
+
+	ep->freqm = ratio ? mul_u64_u32_shr(ep->freqn, ratio, 30) : ep->freqn;
+}
+
 /*
  * For streaming based on information derived from sync endpoints,
  * prepare_outbound_urb_sizes() will call next_packet_size() to
  * determine the number of samples to be sent in the next packet.
+ * If the packet would take more than @avail frames, -EAGAIN is returned
+ * and the phase is left untouched; a negative @avail means no limit.
  *
  * For implicit feedback, next_packet_size() is unused.
  */
-int snd_usb_endpoint_next_packet_size(struct snd_usb_endpoint *ep)
+int snd_usb_endpoint_next_packet_size(struct snd_usb_endpoint *ep, int avail)
 {
 	unsigned long flags;
+	unsigned int phase;
 	int ret;
 
-	if (ep->fill_max)
-		return ep->maxframesize;
+	if (ep->fill_max) {
+		ret = ep->maxframesize;
+		return (avail >= 0 && ret > avail) ? -EAGAIN : ret;
+	}
 
 	spin_lock_irqsave(&ep->lock, flags);
-	ep->phase = (ep->phase & 0xffff)
-		+ (ep->freqm << ep->datainterval);
-	ret = min(ep->phase >> 16, ep->maxframesize);
+	if (ep->clock_follow)
+		follow_clock(ep);
+	phase = (ep->phase & 0xffff) + (ep->freqm << ep->datainterval);
+	ret = min(phase >> 16, ep->maxframesize);
+	if (avail >= 0 && ret > avail)
+		ret = -EAGAIN;
+	else
+		ep->phase = phase;
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	return ret;
@@ -183,6 +226,14 @@ static void retire_inbound_urb(struct snd_usb_endpoint *ep,
 		ep->retire_data_urb(ep->data_subs, urb);
 }
 
+/* count a failed packet or submission, see snd_usb_ep_stats */
+static void record_urb_error(struct snd_usb_endpoint *ep,
+			     struct snd_urb_ctx *ctx, int err)
+{
+	snd_usb_urb_stats_error(&ep->stats.urb, err);
+	trace_snd_usb_urb_error(ep, ctx, err);
+}
+
 static void prepare_silent_urb(struct snd_usb_endpoint *ep,
 			       struct snd_urb_ctx *ctx)
 {
@@ -204,7 +255,7 @@ static void prepare_silent_urb(struct snd_usb_endpoint *ep,
 		if (ctx->packet_size[i])
 			counts = ctx->packet_size[i];
 		else
-			counts = snd_usb_endpoint_next_packet_size(ep);
+			counts = snd_usb_endpoint_next_packet_size(ep, -1);
 
 		length = counts * ep->stride; /* number of silent bytes */
 		offset = offs * ep->stride + extra * i;
@@ -222,23 +273,35 @@ static void prepare_silent_urb(struct snd_usb_endpoint *ep,
 
 	urb->number_of_packets = ctx->packets;
 	urb->transfer_buffer_length = offs * ep->stride + ctx->packets * extra;
+
+	ep->stats.silent++;
+	trace_snd_usb_silent_urb(ep, ctx, offs);
 }
 
 /*
  * Prepare a PLAYBACK urb for submission to the bus.
+ *
+ * Returns -EAGAIN when a lowlatency endpoint has no data to send yet.
  */
-static void prepare_outbound_urb(struct snd_usb_endpoint *ep,
-				 struct snd_urb_ctx *ctx)
+static int prepare_outbound_urb(struct snd_usb_endpoint *ep,
+				struct snd_urb_ctx *ctx)
 {
 	struct urb *urb = ctx->urb;
 	unsigned char *cp = urb->transfer_buffer;
+	int err = 0;
 
 	urb->dev = ep->chip->dev; /* we need to set this at each time */
 
 	switch (ep->type) {
 	case SND_USB_ENDPOINT_TYPE_DATA:
+		/* the last submission may have been sent from the PCM buffer */
+		urb->transfer_buffer = ctx->buffer;
+		urb->transfer_dma = ctx->buffer_dma;
+		ctx->queued = 0;
+		ctx->period_elapsed = false;
+
 		if (ep->prepare_data_urb) {
-			ep->prepare_data_urb(ep->data_subs, urb);
+			err = ep->prepare_data_urb(ep->data_subs, urb);
 		} else {
 			/* no data provider, so send silence */
 			prepare_silent_urb(ep, ctx);
@@ -271,6 +334,8 @@ static void prepare_outbound_urb(struct snd_usb_endpoint *ep,
 
 		break;
 	}
+
+	return err;
 }
 
 /*
@@ -332,7 +397,7 @@ static void queue_pending_output_urbs(struct snd_usb_endpoint *ep)
 		if (ep->next_packet_read_pos != ep->next_packet_write_pos) {
 			packet = ep->next_packet + ep->next_packet_read_pos;
 			ep->next_packet_read_pos++;
-			ep->next_packet_read_pos %= MAX_URBS;
+			ep->next_packet_read_pos %= ep->max_urbs;
 
 			/* take URB out of FIFO */
 			if (!list_empty(&ep->ready_playback_urbs))
@@ -355,25 +420,76 @@ static void queue_pending_output_urbs(struct snd_usb_endpoint *ep)
 		prepare_outbound_urb(ep, ctx);
 
 		err = usb_submit_urb(ctx->urb, GFP_ATOMIC);
-		if (err < 0)
+		if (err < 0) {
+			record_urb_error(ep, ctx, err);
 			usb_audio_err(ep->chip,
 				"Unable to submit urb #%d: %d (urb %p)\n",
 				ctx->index, err, ctx->urb);
-		else
+		} else {
 			set_bit(ctx->index, &ep->active_mask);
+		}
 	}
 }
 
+/**
+ * snd_usb_endpoint_send_pending: Submit the parked lowlatency playback urbs
+ *
+ * @ep: the endpoint
+ *
+ * In the lowlatency mode, a playback urb which finds no data to send is
+ * parked on ep->ready_playback_urbs instead of being resubmitted.  This
+ * sends the parked urbs, in order, as long as there is data to fill them.
+ * It's called from the completion handler and from the PCM ack callback
+ * when the application has written new data.
+ */
+void snd_usb_endpoint_send_pending(struct snd_usb_endpoint *ep)
+{
+	struct snd_urb_ctx *ctx;
+	unsigned long flags;
+	int err;
+
+	spin_lock_irqsave(&ep->submit_lock, flags);
+	while (test_bit(EP_FLAG_RUNNING, &ep->flags)) {
+		spin_lock(&ep->lock);
+		ctx = list_first_entry_or_null(&ep->ready_playback_urbs,
+					       struct snd_urb_ctx, ready_list);
+		if (ctx)
+			list_del_init(&ctx->ready_list);
+		spin_unlock(&ep->lock);
+		if (!ctx)
+			break;
+
+		if (prepare_outbound_urb(ep, ctx) == -EAGAIN) {
+			/* not enough data yet, keep it at the head */
+			spin_lock(&ep->lock);
+			list_add(&ctx->ready_list, &ep->ready_playback_urbs);
+			spin_unlock(&ep->lock);
+			break;
+		}
+
+		err = usb_submit_urb(ctx->urb, GFP_ATOMIC);
+		if (err < 0) {
+			record_urb_error(ep, ctx, err);
+			usb_audio_err(ep->chip,
+				"Unable to submit urb #%d: %d (urb %p)\n",
+				ctx->index, err, ctx->urb);
+		} else {
+			set_bit(ctx->index, &ep->active_mask);
+		}
+	}
+	spin_unlock_irqrestore(&ep->submit_lock, flags);
+}
+
 /*
- * complete callback for urbs
+ * process a completed urb
  */
-static void snd_complete_urb(struct urb *urb)
+static void process_complete_urb(struct urb *urb)
 {
 	struct snd_urb_ctx *ctx = urb->context;
 	struct snd_usb_endpoint *ep = ctx->ep;
 	struct snd_pcm_substream *substream;
 	unsigned long flags;
-	int err;
+	int i, err;
 
 	if (unlikely(urb->status == -ENOENT ||		/* unlinked */
 		     urb->status == -ENODEV ||		/* device removed */
@@ -387,6 +503,12 @@ static void snd_complete_urb(struct urb *urb)
 	if (unlikely(!test_bit(EP_FLAG_RUNNING, &ep->flags)))
 		goto exit_clear;
 
+	if (unlikely(urb->status))
+		record_urb_error(ep, ctx, urb->status);
+	for (i = 0; i < urb->number_of_packets; i++)
+		if (unlikely(urb->iso_frame_desc[i].status))
+			record_urb_error(ep, ctx, urb->iso_frame_desc[i].status);
+
 	if (usb_pipeout(ep->pipe)) {
 		retire_outbound_urb(ep, ctx);
 		/* can be stopped during retire callback */
@@ -402,6 +524,16 @@ static void snd_complete_urb(struct urb *urb)
 			goto exit_clear;
 		}
 
+		if (ep->lowlatency) {
+			/* refill in order with whatever has been written */
+			clear_bit(ctx->index, &ep->active_mask);
+			spin_lock_irqsave(&ep->lock, flags);
+			list_add_tail(&ctx->ready_list, &ep->ready_playback_urbs);
+			spin_unlock_irqrestore(&ep->lock, flags);
+			snd_usb_endpoint_send_pending(ep);
+			return;
+		}
+
 		prepare_outbound_urb(ep, ctx);
 	} else {
 		retire_inbound_urb(ep, ctx);
@@ -416,6 +548,7 @@ static void snd_complete_urb(struct urb *urb)
 	if (err == 0)
 		return;
 
+	record_urb_error(ep, ctx, err);
 	usb_audio_err(ep->chip, "cannot submit urb (err = %d)\n", err);
 	if (ep->data_subs && ep->data_subs->pcm_substream) {
 		substream = ep->data_subs->pcm_substream;
@@ -426,6 +559,68 @@ static void snd_complete_urb(struct urb *urb)
 	clear_bit(ctx->index, &ep->active_mask);
 }
 
+/*
+ * the completions handed over to chip->urb_worker, oldest first
+ */
+static void complete_urb_work(struct kthread_work *work)
+{
+	struct snd_usb_endpoint *ep =
+		container_of(work, struct snd_usb_endpoint, complete_work);
+	struct llist_node *done = llist_del_all(&ep->done_urbs);
+	struct snd_urb_ctx *ctx, *next;
+
+	done = llist_reverse_order(done);
+	llist_for_each_entry_safe(ctx, next, done, done_node)
+		process_complete_urb(ctx->urb);
+}
+
+/*
+ * collect the completion timing and the queue depth, see snd_usb_ep_stats
+ */
+static void update_complete_stats(struct snd_usb_endpoint *ep,
+				  struct snd_urb_ctx *ctx)
+{
+	struct snd_usb_ep_stats *st = &ep->stats;
+	unsigned int interval, period, shift;
+	unsigned int queued = hweight_long(ep->active_mask);
+
+	/* not counting the urb just completed */
+	if (queued)
+		queued--;
+
+	shift = ep->type == SND_USB_ENDPOINT_TYPE_SYNC ?
+		ep->syncinterval : ep->datainterval;
+	period = ctx->packets *
+		((snd_usb_get_speed(ep->chip->dev) == USB_SPEED_FULL ?
+		  1000 : 125) << shift);
+	interval = snd_usb_urb_stats_complete(&st->urb, period);
+	if (st->urb.urbs > 1)
+		st->queued_min = min(st->queued_min, queued);
+	else
+		st->queued_min = queued;
+	trace_snd_usb_urb_complete(ep, ctx, interval, queued);
+}
+
+/*
+ * complete callback for urbs
+ */
+static void snd_complete_urb(struct urb *urb)
+{
+	struct snd_urb_ctx *ctx = urb->context;
+	struct snd_usb_endpoint *ep = ctx->ep;
+
+	if (likely(test_bit(EP_FLAG_RUNNING, &ep->flags)))
+		update_complete_stats(ep, ctx);
+
+	if (!ep->chip->urb_worker) {
+		process_complete_urb(urb);
+		return;
+	}
+
+	llist_add(&ctx->done_node, &ep->done_urbs);
+	kthread_queue_work(ep->chip->urb_worker, &ep->complete_work);
+}
+
 /**
  * snd_usb_add_endpoint: Add an endpoint to an USB audio chip
  *
@@ -479,6 +674,9 @@ struct snd_usb_endpoint *snd_usb_add_endpoint(struct snd_usb_audio *chip,
 
 	ep->chip = chip;
 	spin_lock_init(&ep->lock);
+	spin_lock_init(&ep->submit_lock);
+	init_llist_head(&ep->done_urbs);
+	kthread_init_work(&ep->complete_work, complete_urb_work);
 	ep->type = type;
 	ep->ep_num = ep_num;
 	ep->iface = alts->desc.bInterfaceNumber;
@@ -608,6 +806,32 @@ static void release_urbs(struct snd_usb_endpoint *ep, int force)
 	ep->nurbs = 0;
 }
 
+/*
+ * (re)allocate the URB contexts for the current max_urbs setting
+ */
+static int alloc_urb_ctxs(struct snd_usb_endpoint *ep)
+{
+	unsigned int n = ep->chip->max_urbs;
+
+	if (ep->urb && ep->max_urbs == n)
+		return 0;
+
+	kfree(ep->urb);
+	kfree(ep->next_packet);
+	ep->urb = kcalloc(n, sizeof(*ep->urb), GFP_KERNEL);
+	ep->next_packet = kcalloc(n, sizeof(*ep->next_packet), GFP_KERNEL);
+	if (!ep->urb || !ep->next_packet) {
+		kfree(ep->urb);
+		kfree(ep->next_packet);
+		ep->urb = NULL;
+		ep->next_packet = NULL;
+		ep->max_urbs = 0;
+		return -ENOMEM;
+	}
+	ep->max_urbs = n;
+	return 0;
+}
+
 /*
  * configure a data endpoint
  */
@@ -704,6 +928,19 @@ static int data_ep_set_params(struct snd_usb_endpoint *ep,
 					1U << sync_ep->syncinterval);
 	max_packs_per_urb = max(1u, max_packs_per_urb >> ep->datainterval);
 
+	/* only adaptive endpoints recover their clock from the data rate;
+	 * synchronous ones run off the USB SOF clock whatever is sent
+	 */
+	ep->clock_follow = ep->chip->clock_follow >= 0 && !sync_ep &&
+		ep->chip->clock_follow != ep->chip->card->number &&
+		usb_pipeout(ep->pipe) &&
+		(fmt->ep_attr & USB_ENDPOINT_SYNCTYPE) ==
+		USB_ENDPOINT_SYNC_ADAPTIVE;
+
+	/* lowlatency needs the sync from a feedback endpoint or none */
+	ep->lowlatency = ep->chip->lowlatency && usb_pipeout(ep->pipe) &&
+		!snd_usb_endpoint_implicit_feedback_sink(ep);
+
 	/*
 	 * Capture endpoints need to use small URBs because there's no way
 	 * to tell in advance where the next period will end, and we don't
@@ -733,13 +970,13 @@ static int data_ep_set_params(struct snd_usb_endpoint *ep,
 		urb_packs = min(max_packs_per_urb, urb_packs);
 		while (urb_packs > 1 && urb_packs * maxsize >= period_bytes)
 			urb_packs >>= 1;
-		ep->nurbs = MAX_URBS;
+		ep->nurbs = ep->max_urbs;
 
 	/*
 	 * Playback endpoints without implicit sync are adjusted so that
 	 * a period fits as evenly as possible in the smallest number of
 	 * URBs.  The total number of URBs is adjusted to the size of the
-	 * ALSA buffer, subject to the MAX_URBS and MAX_QUEUE limits.
+	 * ALSA buffer, subject to the max_urbs and max_queue limits.
 	 */
 	} else {
 		/* determine how small a packet can be */
@@ -764,8 +1001,8 @@ static int data_ep_set_params(struct snd_usb_endpoint *ep,
 					urbs_per_period);
 
 		/* try to use enough URBs to contain an entire ALSA buffer */
-		max_urbs = min((unsigned) MAX_URBS,
-				MAX_QUEUE * packs_per_ms / urb_packs);
+		max_urbs = min(ep->max_urbs,
+			       ep->chip->max_queue * packs_per_ms / urb_packs);
 		ep->nurbs = min(max_urbs, urbs_per_period * periods_per_buffer);
 	}
 
@@ -783,13 +1020,17 @@ static int data_ep_set_params(struct snd_usb_endpoint *ep,
 		if (!u->urb)
 			goto out_of_memory;
 
-		u->urb->transfer_buffer =
-			usb_alloc_coherent(ep->chip->dev, u->buffer_size,
-					   GFP_KERNEL, &u->urb->transfer_dma);
-		if (!u->urb->transfer_buffer)
+		u->buffer = usb_alloc_coherent(ep->chip->dev, u->buffer_size,
+					       GFP_KERNEL, &u->buffer_dma);
+		if (!u->buffer)
 			goto out_of_memory;
+		u->urb->transfer_buffer = u->buffer;
+		u->urb->transfer_dma = u->buffer_dma;
 		u->urb->pipe = ep->pipe;
 		u->urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
+		/* parked urbs restart the stream after a gap */
+		if (ep->lowlatency)
+			u->urb->transfer_flags |= URB_ISO_ASAP;
 		u->urb->interval = 1 << ep->datainterval;
 		u->urb->context = u;
 		u->urb->complete = snd_complete_urb;
@@ -882,6 +1123,10 @@ int snd_usb_endpoint_set_params(struct snd_usb_endpoint *ep,
 	/* release old buffers, if any */
 	release_urbs(ep, 0);
 
+	err = alloc_urb_ctxs(ep);
+	if (err < 0)
+		return err;
+
 	ep->datainterval = fmt->datainterval;
 	ep->maxpacksize = fmt->maxpacksize;
 	ep->fill_max = !!(fmt->attributes & UAC_EP_CS_ATTR_FILL_MAX);
@@ -894,6 +1139,7 @@ int snd_usb_endpoint_set_params(struct snd_usb_endpoint *ep,
 	/* calculate the frequency in 16.16 format */
 	ep->freqm = ep->freqn;
 	ep->freqshift = INT_MIN;
+	ep->fb_count = 0;
 
 	ep->phase = 0;
 
@@ -948,6 +1194,7 @@ int snd_usb_endpoint_start(struct snd_usb_endpoint *ep)
 	ep->active_mask = 0;
 	ep->unlink_mask = 0;
 	ep->phase = 0;
+	memset(&ep->stats, 0, sizeof(ep->stats));
 
 	snd_usb_endpoint_start_quirk(ep);
 
@@ -985,7 +1232,7 @@ int snd_usb_endpoint_start(struct snd_usb_endpoint *ep)
 		if (err < 0) {
 			usb_audio_err(ep->chip,
 				"cannot submit urb %d, error %d: %s\n",
-				i, err, usb_error_string(err));
+				i, err, snd_usb_error_string(err));
 			goto __error;
 		}
 		set_bit(i, &ep->active_mask);
@@ -1025,6 +1272,10 @@ void snd_usb_endpoint_stop(struct snd_usb_endpoint *ep)
 	if (--ep->use_count == 0) {
 		deactivate_urbs(ep, false);
 		set_bit(EP_FLAG_STOPPING, &ep->flags);
+		if (ep->clock_source) {
+			WRITE_ONCE(clock_ratio[ep->chip->card->number], 0);
+			ep->clock_source = 0;
+		}
 	}
 }
 
@@ -1050,6 +1301,25 @@ void snd_usb_endpoint_deactivate(struct snd_usb_endpoint *ep)
 	wait_clear_urbs(ep);
 }
 
+/**
+ * snd_usb_endpoint_kill: Unlink the URBs of an snd_usb_endpoint
+ *
+ * @ep: the endpoint to kill
+ *
+ * Like snd_usb_endpoint_release(), this ignores the use count, but it only
+ * unlinks the URBs without waiting for them to retire.  Killing all
+ * endpoints of a device before releasing them lets the host controller
+ * give back their URBs in parallel instead of one endpoint at a time.
+ */
+void snd_usb_endpoint_kill(struct snd_usb_endpoint *ep)
+{
+	/* route incoming urbs to nirvana */
+	ep->retire_data_urb = NULL;
+	ep->prepare_data_urb = NULL;
+
+	deactivate_urbs(ep, true);
+}
+
 /**
  * snd_usb_endpoint_release: Tear down an snd_usb_endpoint
  *
@@ -1072,9 +1342,40 @@ void snd_usb_endpoint_release(struct snd_usb_endpoint *ep)
  */
 void snd_usb_endpoint_free(struct snd_usb_endpoint *ep)
 {
+	kfree(ep->urb);
+	kfree(ep->next_packet);
 	kfree(ep);
 }
 
+/*
+ * Smooth the feedback with a first-order low-pass over 2^feedback_filter
+ * values and collect the jitter statistics shown in proc.
+ * Called with ep->lock held.
+ */
+static unsigned int filter_feedback(struct snd_usb_endpoint *ep,
+				    unsigned int f)
+{
+	unsigned int shift = ep->chip->feedback_filter;
+	unsigned int delta;
+
+	if (!ep->fb_count++) {
+		ep->fb_avg = (u64)f << shift;
+		ep->fb_min = ep->fb_max = ep->fb_last = f;
+		ep->fb_jitter = ep->fb_jitter_max = 0;
+		return f;
+	}
+
+	delta = f > ep->fb_last ? f - ep->fb_last : ep->fb_last - f;
+	ep->fb_last = f;
+	ep->fb_jitter += delta - (ep->fb_jitter >> 4);
+	ep->fb_jitter_max = max(ep->fb_jitter_max, delta);
+	ep->fb_min = min(ep->fb_min, f);
+	ep->fb_max = max(ep->fb_max, f);
+
+	ep->fb_avg += f - (ep->fb_avg >> shift);
+	return ep->fb_avg >> shift;
+}
+
 /**
  * snd_usb_handle_sync_urb: parse an USB sync packet
  *
@@ -1090,7 +1391,7 @@ void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 			     const struct urb *urb)
 {
 	int shift;
-	unsigned int f;
+	unsigned int f, raw;
 	unsigned long flags;
 
 	snd_BUG_ON(ep == sender);
@@ -1146,7 +1447,7 @@ void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 		}
 
 		ep->next_packet_write_pos++;
-		ep->next_packet_write_pos %= MAX_URBS;
+		ep->next_packet_write_pos %= ep->max_urbs;
 		spin_unlock_irqrestore(&ep->lock, flags);
 		queue_pending_output_urbs(ep);
 
@@ -1180,6 +1481,7 @@ void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 
 	if (f == 0)
 		return;
+	raw = f;
 
 	if (unlikely(sender->tenor_fb_quirk)) {
 		/*
@@ -1187,10 +1489,13 @@ void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 		 * and others) sometimes change the feedback value
 		 * by +/- 0x1.0000.
 		 */
-		if (f < ep->freqn - 0x8000)
+		if (f < ep->freqn - 0x8000) {
 			f += 0xf000;
-		else if (f > ep->freqn + 0x8000)
+			ep->stats.fb_corrected++;
+		} else if (f > ep->freqn + 0x8000) {
 			f -= 0xf000;
+			ep->stats.fb_corrected++;
+		}
 	} else if (unlikely(ep->freqshift == INT_MIN)) {
 		/*
 		 * The first time we see a feedback value, determine its format
@@ -1218,14 +1523,22 @@ void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 		 * If the frequency looks valid, set it.
 		 * This value is referred to in prepare_playback_urb().
 		 */
+		trace_snd_usb_feedback(ep, raw, f, true);
 		spin_lock_irqsave(&ep->lock, flags);
+		f = filter_feedback(ep, f);
 		ep->freqm = f;
 		spin_unlock_irqrestore(&ep->lock, flags);
+		/* for the endpoints following this card's clock */
+		WRITE_ONCE(clock_ratio[ep->chip->card->number],
+			   div_u64((u64)f << 30, ep->freqn));
+		ep->clock_source = 1;
 	} else {
 		/*
 		 * Out of range; maybe the shift value is wrong.
 		 * Reset it so that we autodetect again the next time.
 		 */
+		trace_snd_usb_feedback(ep, raw, f, false);
+		ep->stats.fb_rejected++;
 		ep->freqshift = INT_MIN;
 	}
 }
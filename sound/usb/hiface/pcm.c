@@ -14,17 +14,23 @@
  * (at your option) any later version.
  */
 
+#include <linux/module.h>
 #include <linux/slab.h>
 #include <sound/pcm.h>
 
 #include "pcm.h"
 #include "chip.h"
+#include "../urb_stats.h"
 
 #define OUT_EP          0x2
 #define PCM_N_URBS      8
 #define PCM_PACKET_SIZE 4096
 #define PCM_BUFFER_SIZE (2 * PCM_N_URBS * PCM_PACKET_SIZE)
 
+static int n_urbs = PCM_N_URBS;
+module_param(n_urbs, int, 0444);
+MODULE_PARM_DESC(n_urbs, "Number of URBs in flight (2-" __stringify(PCM_N_URBS) ", default: " __stringify(PCM_N_URBS) ").");
+
 struct pcm_urb {
 	struct hiface_chip *chip;
 
@@ -57,6 +63,9 @@ struct pcm_runtime {
 	bool panic; /* if set driver won't do anymore pcm on device */
 
 	struct pcm_urb out_urbs[PCM_N_URBS];
+	int n_urbs; /* urbs submitted, see the n_urbs option */
+	unsigned int urb_period_us;
+	struct snd_usb_urb_stats stats;
 
 	struct mutex stream_mutex;
 	u8 stream_state; /* one of STREAM_XXX */
@@ -219,7 +228,8 @@ static int hiface_pcm_stream_start(struct pcm_runtime *rt)
 
 		/* submit our out urbs zero init */
 		rt->stream_state = STREAM_STARTING;
-		for (i = 0; i < PCM_N_URBS; i++) {
+		snd_usb_urb_stats_reset(&rt->stats);
+		for (i = 0; i < rt->n_urbs; i++) {
 			memset(rt->out_urbs[i].buffer, 0, PCM_PACKET_SIZE);
 			usb_anchor_urb(&rt->out_urbs[i].instance,
 				       &rt->out_urbs[i].submitted);
@@ -323,6 +333,10 @@ static void hiface_pcm_out_urb_handler(struct urb *usb_urb)
 		     usb_urb->status == -ESHUTDOWN)) {	/* device disabled */
 		goto out_fail;
 	}
+	if (usb_urb->status)
+		snd_usb_urb_stats_error(&rt->stats, usb_urb->status);
+	else
+		snd_usb_urb_stats_complete(&rt->stats, rt->urb_period_us);
 
 	if (rt->stream_state == STREAM_STARTING) {
 		rt->stream_wait_cond = true;
@@ -343,8 +357,10 @@ static void hiface_pcm_out_urb_handler(struct urb *usb_urb)
 		snd_pcm_period_elapsed(sub->instance);
 
 	ret = usb_submit_urb(&out_urb->instance, GFP_ATOMIC);
-	if (ret < 0)
+	if (ret < 0) {
+		snd_usb_urb_stats_error(&rt->stats, ret);
 		goto out_fail;
+	}
 
 	return;
 
@@ -451,6 +467,9 @@ static int hiface_pcm_prepare(struct snd_pcm_substream *alsa_sub)
 	sub->period_off = 0;
 
 	if (rt->stream_state == STREAM_DISABLED) {
+		/* 8 bytes per frame in each urb */
+		rt->urb_period_us = PCM_PACKET_SIZE / 8 * 1000000 /
+				    alsa_rt->rate;
 
 		ret = hiface_pcm_set_rate(rt, alsa_rt->rate);
 		if (ret) {
@@ -546,6 +565,14 @@ static int hiface_pcm_init_urb(struct pcm_urb *urb,
 	return 0;
 }
 
+static void hiface_pcm_proc_read(struct snd_info_entry *entry,
+				 struct snd_info_buffer *buffer)
+{
+	struct pcm_runtime *rt = entry->private_data;
+
+	snd_usb_urb_stats_print(buffer, "Playback", rt->n_urbs, &rt->stats);
+}
+
 void hiface_pcm_abort(struct hiface_chip *chip)
 {
 	struct pcm_runtime *rt = chip->pcm;
@@ -584,6 +611,7 @@ int hiface_pcm_init(struct hiface_chip *chip, u8 extra_freq)
 	int i;
 	int ret;
 	struct snd_pcm *pcm;
+	struct snd_info_entry *entry;
 	struct pcm_runtime *rt;
 
 	rt = kzalloc(sizeof(*rt), GFP_KERNEL);
@@ -591,6 +619,7 @@ int hiface_pcm_init(struct hiface_chip *chip, u8 extra_freq)
 		return -ENOMEM;
 
 	rt->chip = chip;
+	rt->n_urbs = clamp(n_urbs, 2, PCM_N_URBS);
 	rt->stream_state = STREAM_DISABLED;
 	if (extra_freq)
 		rt->extra_freq = 1;
@@ -618,6 +647,9 @@ int hiface_pcm_init(struct hiface_chip *chip, u8 extra_freq)
 
 	rt->instance = pcm;
 
+	if (!snd_card_proc_new(chip->card, "pcm_stats", &entry))
+		snd_info_set_text_ops(entry, rt, hiface_pcm_proc_read);
+
 	chip->pcm = rt;
 	return 0;
 }
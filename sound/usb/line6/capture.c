@@ -22,20 +22,15 @@
 	Find a free URB and submit it.
 	must be called in line6pcm->in.lock context
 */
-static int submit_audio_in_urb(struct snd_line6_pcm *line6pcm)
+int line6_submit_audio_in_urb(struct snd_line6_pcm *line6pcm)
 {
 	int index;
 	int i, urb_size;
-	int ret;
 	struct urb *urb_in;
 
-	index = find_first_zero_bit(&line6pcm->in.active_urbs,
-				    line6pcm->line6->iso_buffers);
-
-	if (index < 0 || index >= line6pcm->line6->iso_buffers) {
-		dev_err(line6pcm->line6->ifcdev, "no free URB found\n");
-		return -EINVAL;
-	}
+	index = line6_find_free_urb(line6pcm, &line6pcm->in);
+	if (index < 0)
+		return index;
 
 	urb_in = line6pcm->in.urbs[index];
 	urb_size = 0;
@@ -52,36 +47,11 @@ static int submit_audio_in_urb(struct snd_line6_pcm *line6pcm)
 	    line6pcm->in.buffer +
 	    index * LINE6_ISO_PACKETS * line6pcm->max_packet_size_in;
 	urb_in->transfer_buffer_length = urb_size;
-	urb_in->context = line6pcm;
-
-	ret = usb_submit_urb(urb_in, GFP_ATOMIC);
-
-	if (ret == 0)
-		set_bit(index, &line6pcm->in.active_urbs);
-	else
-		dev_err(line6pcm->line6->ifcdev,
-			"URB in #%d submission failed (%d)\n", index, ret);
 
+	line6_submit_urb(line6pcm, &line6pcm->in, index);
 	return 0;
 }
 
-/*
-	Submit all currently available capture URBs.
-	must be called in line6pcm->in.lock context
-*/
-int line6_submit_audio_in_all_urbs(struct snd_line6_pcm *line6pcm)
-{
-	int ret = 0, i;
-
-	for (i = 0; i < line6pcm->line6->iso_buffers; ++i) {
-		ret = submit_audio_in_urb(line6pcm);
-		if (ret < 0)
-			break;
-	}
-
-	return ret;
-}
-
 /*
 	Copy data into ALSA capture buffer.
 */
@@ -98,31 +68,8 @@ void line6_capture_copy(struct snd_line6_pcm *line6pcm, char *fbuf, int fsize)
 	if (runtime == NULL)
 		return;
 
-	if (line6pcm->in.pos_done + frames > runtime->buffer_size) {
-		/*
-		   The transferred area goes over buffer boundary,
-		   copy two separate chunks.
-		 */
-		int len;
-
-		len = runtime->buffer_size - line6pcm->in.pos_done;
-
-		if (len > 0) {
-			memcpy(runtime->dma_area +
-			       line6pcm->in.pos_done * bytes_per_frame, fbuf,
-			       len * bytes_per_frame);
-			memcpy(runtime->dma_area, fbuf + len * bytes_per_frame,
-			       (frames - len) * bytes_per_frame);
-		} else {
-			/* this is somewhat paranoid */
-			dev_err(line6pcm->line6->ifcdev,
-				"driver bug: len = %d\n", len);
-		}
-	} else {
-		/* copy single chunk */
-		memcpy(runtime->dma_area +
-		       line6pcm->in.pos_done * bytes_per_frame, fbuf, fsize);
-	}
+	line6_copy_pcm(runtime, line6pcm->in.pos_done, fbuf, frames,
+		       bytes_per_frame, true);
 
 	line6pcm->in.pos_done += frames;
 	if (line6pcm->in.pos_done >= runtime->buffer_size)
@@ -146,7 +93,7 @@ void line6_capture_check_period(struct snd_line6_pcm *line6pcm, int length)
 /*
  * Callback for completed capture URB.
  */
-static void audio_in_callback(struct urb *urb)
+void line6_audio_in_callback(struct urb *urb)
 {
 	int i, index, length = 0, shutdown = 0;
 	unsigned long flags;
@@ -155,10 +102,7 @@ static void audio_in_callback(struct urb *urb)
 
 	line6pcm->in.last_frame = urb->start_frame;
 
-	/* find index of URB */
-	for (index = 0; index < line6pcm->line6->iso_buffers; ++index)
-		if (urb == line6pcm->in.urbs[index])
-			break;
+	index = line6_urb_index(line6pcm, &line6pcm->in, urb);
 
 	spin_lock_irqsave(&line6pcm->in.lock, flags);
 
@@ -209,7 +153,7 @@ static void audio_in_callback(struct urb *urb)
 		shutdown = 1;
 
 	if (!shutdown) {
-		submit_audio_in_urb(line6pcm);
+		line6_submit_audio_in_urb(line6pcm);
 
 		if (!test_bit(LINE6_STREAM_IMPULSE, &line6pcm->in.running) &&
 		    test_bit(LINE6_STREAM_PCM, &line6pcm->in.running))
@@ -258,40 +202,3 @@ struct snd_pcm_ops snd_line6_capture_ops = {
 	.trigger = snd_line6_trigger,
 	.pointer = snd_line6_pointer,
 };
-
-int line6_create_audio_in_urbs(struct snd_line6_pcm *line6pcm)
-{
-	struct usb_line6 *line6 = line6pcm->line6;
-	int i;
-
-	line6pcm->in.urbs = kzalloc(
-		sizeof(struct urb *) * line6->iso_buffers, GFP_KERNEL);
-	if (line6pcm->in.urbs == NULL)
-		return -ENOMEM;
-
-	/* create audio URBs and fill in constant values: */
-	for (i = 0; i < line6->iso_buffers; ++i) {
-		struct urb *urb;
-
-		/* URB for audio in: */
-		urb = line6pcm->in.urbs[i] =
-		    usb_alloc_urb(LINE6_ISO_PACKETS, GFP_KERNEL);
-
-		if (urb == NULL)
-			return -ENOMEM;
-
-		urb->dev = line6->usbdev;
-		urb->pipe =
-		    usb_rcvisocpipe(line6->usbdev,
-				    line6->properties->ep_audio_r &
-				    USB_ENDPOINT_NUMBER_MASK);
-		urb->transfer_flags = URB_ISO_ASAP;
-		urb->start_frame = -1;
-		urb->number_of_packets = LINE6_ISO_PACKETS;
-		urb->interval = LINE6_ISO_INTERVAL;
-		urb->error_count = 0;
-		urb->complete = audio_in_callback;
-	}
-
-	return 0;
-}
@@ -23,7 +23,7 @@ extern void line6_capture_copy(struct snd_line6_pcm *line6pcm, char *fbuf,
 			       int fsize);
 extern void line6_capture_check_period(struct snd_line6_pcm *line6pcm,
 				       int length);
-extern int line6_create_audio_in_urbs(struct snd_line6_pcm *line6pcm);
-extern int line6_submit_audio_in_all_urbs(struct snd_line6_pcm *line6pcm);
+extern void line6_audio_in_callback(struct urb *urb);
+extern int line6_submit_audio_in_urb(struct snd_line6_pcm *line6pcm);
 
 #endif
@@ -35,6 +35,11 @@ const unsigned char line6_midi_id[3] = {
 };
 EXPORT_SYMBOL_GPL(line6_midi_id);
 
+static int iso_buffers;
+module_param(iso_buffers, int, 0444);
+MODULE_PARM_DESC(iso_buffers,
+		 "Number of isochronous URBs per PCM direction (2-" __stringify(LINE6_ISO_BUFFERS_MAX) ", default: 0 = by USB speed).");
+
 /*
 	Code to request version of POD, Variax interface
 	(and maybe other devices).
@@ -531,6 +536,8 @@ static void line6_get_usb_properties(struct usb_line6 *line6)
 		line6->intervals_per_second = USB_HIGH_INTERVALS_PER_SECOND;
 		line6->iso_buffers = USB_HIGH_ISO_BUFFERS;
 	}
+	if (iso_buffers)
+		line6->iso_buffers = clamp(iso_buffers, 2, LINE6_ISO_BUFFERS_MAX);
 }
 
 /* Enable buffering of incoming messages, flush the buffer */
@@ -27,6 +27,9 @@
 #define USB_HIGH_INTERVALS_PER_SECOND 8000
 #define USB_HIGH_ISO_BUFFERS 16
 
+/* active_urbs and unlink_urbs of a PCM stream are bit masks */
+#define LINE6_ISO_BUFFERS_MAX BITS_PER_LONG
+
 /* Fallback USB interval and max packet size values */
 #define LINE6_FALLBACK_INTERVAL 10
 #define LINE6_FALLBACK_MAXPACKETSIZE 16
@@ -21,8 +21,7 @@
 #define line6_rawmidi_substream_midi(substream) \
 	((struct snd_line6_midi *)((substream)->rmidi->private_data))
 
-static int send_midi_async(struct usb_line6 *line6, unsigned char *data,
-			   int length);
+static int send_midi_async(struct usb_line6 *line6, int index);
 
 /*
 	Pass data received via USB to MIDI.
@@ -38,34 +37,56 @@ void line6_midi_receive(struct usb_line6 *line6, unsigned char *data,
 /*
 	Read data from MIDI buffer and transmit them via USB.
 */
-static void line6_midi_transmit(struct snd_rawmidi_substream *substream)
+static void line6_midi_transmit(struct usb_line6 *line6)
 {
-	struct usb_line6 *line6 =
-	    line6_rawmidi_substream_midi(substream)->line6;
 	struct snd_line6_midi *line6midi = line6->line6midi;
+	struct snd_rawmidi_substream *substream = line6midi->substream_transmit;
 	struct midi_buffer *mb = &line6midi->midibuf_out;
-	unsigned char chunk[LINE6_FALLBACK_MAXPACKETSIZE];
-	int req, done;
+	unsigned char *data;
+	int req, done, index, length;
+
+	/* move the pending data into the MIDI buffer in place */
+	while (substream) {
+		req = line6_midibuf_write_area(mb, &data);
 
-	for (;;) {
-		req = min(line6_midibuf_bytes_free(mb), line6->max_packet_size);
-		done = snd_rawmidi_transmit_peek(substream, chunk, req);
+		if (req == 0)
+			break;
+
+		done = snd_rawmidi_transmit_peek(substream, data, req);
 
 		if (done == 0)
 			break;
 
-		line6_midibuf_write(mb, chunk, done);
+		/* skip trailing active sense */
+		line6_midibuf_write_commit(mb,
+					   data[done - 1] == 0xfe ? done - 1 : done);
 		snd_rawmidi_transmit_ack(substream, done);
 	}
 
-	for (;;) {
-		done = line6_midibuf_read(mb, chunk,
-					  LINE6_FALLBACK_MAXPACKETSIZE);
+	/* fill each idle URB with as many complete messages as fit */
+	while (line6midi->urbs_out_active != (1UL << LINE6_MIDI_OUT_URBS) - 1) {
+		index = ffz(line6midi->urbs_out_active);
+		data = line6midi->urbs_out[index]->transfer_buffer;
+		length = 0;
 
-		if (done == 0)
+		/* line6_midibuf_read() needs room for a 3 byte message */
+		while (line6midi->urb_out_size - length >= 3) {
+			done = line6_midibuf_read(mb, data + length,
+						  line6midi->urb_out_size - length);
+
+			if (done <= 0)
+				break;
+
+			length += done;
+		}
+
+		if (length == 0)
 			break;
 
-		send_midi_async(line6, chunk, done);
+		line6midi->urbs_out[index]->transfer_buffer_length = length;
+
+		if (send_midi_async(line6, index) < 0)
+			break;
 	}
 }
 
@@ -78,20 +99,23 @@ static void midi_sent(struct urb *urb)
 	int status;
 	int num;
 	struct usb_line6 *line6 = (struct usb_line6 *)urb->context;
+	struct snd_line6_midi *line6midi = line6->line6midi;
+	int i;
 
 	status = urb->status;
-	kfree(urb->transfer_buffer);
-	usb_free_urb(urb);
 
-	if (status == -ESHUTDOWN)
-		return;
+	spin_lock_irqsave(&line6midi->lock, flags);
 
-	spin_lock_irqsave(&line6->line6midi->lock, flags);
-	num = --line6->line6midi->num_active_send_urbs;
+	for (i = 0; i < LINE6_MIDI_OUT_URBS; i++)
+		if (line6midi->urbs_out[i] == urb)
+			__clear_bit(i, &line6midi->urbs_out_active);
+
+	num = --line6midi->num_active_send_urbs;
 
-	if (num == 0) {
-		line6_midi_transmit(line6->line6midi->substream_transmit);
-		num = line6->line6midi->num_active_send_urbs;
+	/* refill the URB right away, so that the next ones follow */
+	if (status != -ESHUTDOWN && status != -ENOENT) {
+		line6_midi_transmit(line6);
+		num = line6midi->num_active_send_urbs;
 	}
 
 	if (num == 0)
@@ -101,44 +125,26 @@ static void midi_sent(struct urb *urb)
 }
 
 /*
-	Send an asynchronous MIDI message.
+	Send the MIDI messages filled into the given output URB.
 	Assumes that line6->line6midi->lock is held
 	(i.e., this function is serialized).
 */
-static int send_midi_async(struct usb_line6 *line6, unsigned char *data,
-			   int length)
+static int send_midi_async(struct usb_line6 *line6, int index)
 {
-	struct urb *urb;
+	struct snd_line6_midi *line6midi = line6->line6midi;
+	struct urb *urb = line6midi->urbs_out[index];
 	int retval;
-	unsigned char *transfer_buffer;
-
-	urb = usb_alloc_urb(0, GFP_ATOMIC);
-
-	if (urb == NULL)
-		return -ENOMEM;
-
-	transfer_buffer = kmemdup(data, length, GFP_ATOMIC);
-
-	if (transfer_buffer == NULL) {
-		usb_free_urb(urb);
-		return -ENOMEM;
-	}
 
-	usb_fill_int_urb(urb, line6->usbdev,
-			 usb_sndbulkpipe(line6->usbdev,
-					 line6->properties->ep_ctrl_w),
-			 transfer_buffer, length, midi_sent, line6,
-			 line6->interval);
 	urb->actual_length = 0;
 	retval = usb_submit_urb(urb, GFP_ATOMIC);
 
 	if (retval < 0) {
 		dev_err(line6->ifcdev, "usb_submit_urb failed\n");
-		usb_free_urb(urb);
 		return retval;
 	}
 
-	++line6->line6midi->num_active_send_urbs;
+	__set_bit(index, &line6midi->urbs_out_active);
+	++line6midi->num_active_send_urbs;
 	return 0;
 }
 
@@ -149,6 +155,14 @@ static int line6_midi_output_open(struct snd_rawmidi_substream *substream)
 
 static int line6_midi_output_close(struct snd_rawmidi_substream *substream)
 {
+	struct usb_line6 *line6 =
+	    line6_rawmidi_substream_midi(substream)->line6;
+	unsigned long flags;
+
+	/* the completion handler refills the URBs from the substream */
+	spin_lock_irqsave(&line6->line6midi->lock, flags);
+	line6->line6midi->substream_transmit = NULL;
+	spin_unlock_irqrestore(&line6->line6midi->lock, flags);
 	return 0;
 }
 
@@ -159,12 +173,9 @@ static void line6_midi_output_trigger(struct snd_rawmidi_substream *substream,
 	struct usb_line6 *line6 =
 	    line6_rawmidi_substream_midi(substream)->line6;
 
-	line6->line6midi->substream_transmit = substream;
 	spin_lock_irqsave(&line6->line6midi->lock, flags);
-
-	if (line6->line6midi->num_active_send_urbs == 0)
-		line6_midi_transmit(substream);
-
+	line6->line6midi->substream_transmit = substream;
+	line6_midi_transmit(line6);
 	spin_unlock_irqrestore(&line6->line6midi->lock, flags);
 }
 
@@ -243,6 +254,17 @@ static int snd_line6_new_midi(struct usb_line6 *line6,
 static void snd_line6_midi_free(struct snd_rawmidi *rmidi)
 {
 	struct snd_line6_midi *line6midi = rmidi->private_data;
+	struct urb *urb;
+	int i;
+
+	for (i = 0; i < LINE6_MIDI_OUT_URBS; i++) {
+		urb = line6midi->urbs_out[i];
+		if (!urb)
+			continue;
+		usb_kill_urb(urb);
+		kfree(urb->transfer_buffer);
+		usb_free_urb(urb);
+	}
 
 	line6_midibuf_destroy(&line6midi->midibuf_in);
 	line6_midibuf_destroy(&line6midi->midibuf_out);
@@ -254,9 +276,11 @@ static void snd_line6_midi_free(struct snd_rawmidi *rmidi)
 */
 int line6_init_midi(struct usb_line6 *line6)
 {
-	int err;
+	int err, i;
 	struct snd_rawmidi *rmidi;
 	struct snd_line6_midi *line6midi;
+	struct urb *urb;
+	unsigned char *buf;
 
 	if (!(line6->properties->capabilities & LINE6_CAP_CONTROL_MIDI)) {
 		/* skip MIDI initialization and report success */
@@ -286,6 +310,26 @@ int line6_init_midi(struct usb_line6 *line6)
 	if (err < 0)
 		return err;
 
+	line6midi->urb_out_size = max(line6->max_packet_size,
+				      LINE6_FALLBACK_MAXPACKETSIZE);
+
+	for (i = 0; i < LINE6_MIDI_OUT_URBS; i++) {
+		urb = usb_alloc_urb(0, GFP_KERNEL);
+		if (!urb)
+			return -ENOMEM;
+		buf = kmalloc(line6midi->urb_out_size, GFP_KERNEL);
+		if (!buf) {
+			usb_free_urb(urb);
+			return -ENOMEM;
+		}
+		usb_fill_int_urb(urb, line6->usbdev,
+				 usb_sndbulkpipe(line6->usbdev,
+						 line6->properties->ep_ctrl_w),
+				 buf, line6midi->urb_out_size, midi_sent, line6,
+				 line6->interval);
+		line6midi->urbs_out[i] = urb;
+	}
+
 	line6->line6midi = line6midi;
 	return 0;
 }
@@ -18,6 +18,9 @@
 
 #define MIDI_BUFFER_SIZE 1024
 
+/* number of URBs for MIDI output, each carrying as many messages as fit */
+#define LINE6_MIDI_OUT_URBS 4
+
 struct snd_line6_midi {
 	/* Pointer back to the Line 6 driver data structure */
 	struct usb_line6 *line6;
@@ -31,6 +34,13 @@ struct snd_line6_midi {
 	/* Number of currently active MIDI send URBs */
 	int num_active_send_urbs;
 
+	/* Preallocated MIDI send URBs and the set of those in flight */
+	struct urb *urbs_out[LINE6_MIDI_OUT_URBS];
+	unsigned long urbs_out_active;
+
+	/* Transfer buffer size of the MIDI send URBs */
+	int urb_out_size;
+
 	/* Spin lock to protect MIDI buffer handling */
 	spinlock_t lock;
 
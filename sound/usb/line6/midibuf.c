@@ -48,10 +48,32 @@ static int midibuf_is_full(struct midi_buffer *this)
 	return this->full;
 }
 
+/*
+	Search the pending message for the next status byte, starting at
+	offset start.  Returns its offset, or length if there is none.
+*/
+static int midibuf_find_end(struct midi_buffer *this, int start, int length)
+{
+	int length1 = min(length, this->size - this->pos_read);
+	unsigned char *p = this->buf + this->pos_read;
+	int i;
+
+	for (i = start; i < length1; ++i)
+		if (p[i] & 0x80)
+			return i;
+
+	for (; i < length; ++i)
+		if (this->buf[i - length1] & 0x80)
+			return i;
+
+	return length;
+}
+
 void line6_midibuf_reset(struct midi_buffer *this)
 {
 	this->pos_read = this->pos_write = this->full = 0;
 	this->command_prev = -1;
+	this->scanned = 0;
 }
 
 int line6_midibuf_init(struct midi_buffer *this, int size, int split)
@@ -128,6 +150,37 @@ int line6_midibuf_write(struct midi_buffer *this, unsigned char *data,
 	return length + skip_active_sense;
 }
 
+/*
+	Get the contiguous free area at the write position, so that data can
+	be stored in place.  Returns its length.
+*/
+int line6_midibuf_write_area(struct midi_buffer *this, unsigned char **data)
+{
+	if (midibuf_is_full(this))
+		return 0;
+
+	*data = this->buf + this->pos_write;
+
+	if (this->pos_write < this->pos_read)
+		return this->pos_read - this->pos_write;
+
+	return this->size - this->pos_write;
+}
+
+/*
+	Account length bytes stored via line6_midibuf_write_area().
+*/
+void line6_midibuf_write_commit(struct midi_buffer *this, int length)
+{
+	if (length <= 0)
+		return;
+
+	this->pos_write = (this->pos_write + length) % this->size;
+
+	if (this->pos_write == this->pos_read)
+		this->full = 1;
+}
+
 int line6_midibuf_read(struct midi_buffer *this, unsigned char *data,
 		       int length)
 {
@@ -136,7 +189,6 @@ int line6_midibuf_read(struct midi_buffer *this, unsigned char *data,
 	int command;
 	int midi_length;
 	int repeat = 0;
-	int i;
 
 	/* we need to be able to store at least a 3 byte MIDI message */
 	if (length < 3)
@@ -173,35 +225,18 @@ int line6_midibuf_read(struct midi_buffer *this, unsigned char *data,
 	}
 
 	if (midi_length < 0) {
-		/* search for end of message */
-		if (length < length1) {
-			/* no buffer wraparound */
-			for (i = 1; i < length; ++i)
-				if (this->buf[this->pos_read + i] & 0x80)
-					break;
-
-			midi_length = i;
-		} else {
-			/* buffer wraparound */
-			length2 = length - length1;
-
-			for (i = 1; i < length1; ++i)
-				if (this->buf[this->pos_read + i] & 0x80)
-					break;
-
-			if (i < length1)
-				midi_length = i;
-			else {
-				for (i = 0; i < length2; ++i)
-					if (this->buf[i] & 0x80)
-						break;
-
-				midi_length = length1 + i;
-			}
-		}
+		/*
+		   search for end of message; the part checked by the previous
+		   calls doesn't have to be searched again, which matters for
+		   long sysex dumps arriving in many small packets
+		 */
+		midi_length = midibuf_find_end(this, max(this->scanned, 1),
+					       length);
 
-		if (midi_length == length)
+		if (midi_length == length) {
 			midi_length = -1;	/* end of message not found */
+			this->scanned = length;
+		}
 	}
 
 	if (midi_length < 0) {
@@ -230,6 +265,7 @@ int line6_midibuf_read(struct midi_buffer *this, unsigned char *data,
 		data[0] = this->command_prev;
 
 	this->full = 0;
+	this->scanned = 0;
 	return length + repeat;
 }
 
@@ -242,6 +278,7 @@ int line6_midibuf_ignore(struct midi_buffer *this, int length)
 
 	this->pos_read = (this->pos_read + length) % this->size;
 	this->full = 0;
+	this->scanned = 0;
 	return length;
 }
 
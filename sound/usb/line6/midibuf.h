@@ -19,6 +19,7 @@ struct midi_buffer {
 	int pos_read, pos_write;
 	int full;
 	int command_prev;
+	int scanned;	/* bytes of the pending message known not to end it */
 };
 
 extern int line6_midibuf_bytes_used(struct midi_buffer *mb);
@@ -31,5 +32,8 @@ extern int line6_midibuf_read(struct midi_buffer *mb, unsigned char *data,
 extern void line6_midibuf_reset(struct midi_buffer *mb);
 extern int line6_midibuf_write(struct midi_buffer *mb, unsigned char *data,
 			       int length);
+extern int line6_midibuf_write_area(struct midi_buffer *mb,
+				    unsigned char **data);
+extern void line6_midibuf_write_commit(struct midi_buffer *mb, int length);
 
 #endif
@@ -145,6 +145,78 @@ get_stream(struct snd_line6_pcm *line6pcm, int direction)
 		&line6pcm->out : &line6pcm->in;
 }
 
+/*
+	Find a free URB of a stream.
+	must be called in pcms->lock context
+*/
+int line6_find_free_urb(struct snd_line6_pcm *line6pcm,
+			struct line6_pcm_stream *pcms)
+{
+	int index;
+
+	index = find_first_zero_bit(&pcms->active_urbs,
+				    line6pcm->line6->iso_buffers);
+	if (index >= line6pcm->line6->iso_buffers) {
+		dev_err(line6pcm->line6->ifcdev, "no free URB found\n");
+		return -EINVAL;
+	}
+	return index;
+}
+
+/*
+	Submit a prepared URB of a stream.
+	must be called in pcms->lock context
+*/
+void line6_submit_urb(struct snd_line6_pcm *line6pcm,
+		      struct line6_pcm_stream *pcms, int index)
+{
+	int ret;
+
+	ret = usb_submit_urb(pcms->urbs[index], GFP_ATOMIC);
+	if (ret == 0)
+		set_bit(index, &pcms->active_urbs);
+	else
+		dev_err(line6pcm->line6->ifcdev,
+			"URB %s #%d submission failed (%d)\n",
+			pcms == &line6pcm->out ? "out" : "in", index, ret);
+}
+
+/*
+	Find the index of a completed URB;
+	returns iso_buffers if it has been unlinked asynchronously.
+*/
+int line6_urb_index(struct snd_line6_pcm *line6pcm,
+		    struct line6_pcm_stream *pcms, struct urb *urb)
+{
+	int index;
+
+	for (index = 0; index < line6pcm->line6->iso_buffers; index++)
+		if (urb == pcms->urbs[index])
+			break;
+	return index;
+}
+
+/*
+	Copy frames between the ALSA buffer at pos and a linear buffer,
+	in at most two chunks at the buffer boundary.
+*/
+void line6_copy_pcm(struct snd_pcm_runtime *runtime, snd_pcm_uframes_t pos,
+		    void *buf, int frames, int bytes_per_frame, bool to_pcm)
+{
+	int len = min_t(int, frames, runtime->buffer_size - pos);
+	void *pcm = runtime->dma_area + pos * bytes_per_frame;
+
+	if (to_pcm) {
+		memcpy(pcm, buf, len * bytes_per_frame);
+		memcpy(runtime->dma_area, buf + len * bytes_per_frame,
+		       (frames - len) * bytes_per_frame);
+	} else {
+		memcpy(buf, pcm, len * bytes_per_frame);
+		memcpy(buf + len * bytes_per_frame, runtime->dma_area,
+		       (frames - len) * bytes_per_frame);
+	}
+}
+
 /* allocate a buffer if not opened yet;
  * call this in line6pcm.state_mutex
  */
@@ -186,17 +258,19 @@ static int line6_stream_start(struct snd_line6_pcm *line6pcm, int direction,
 {
 	unsigned long flags;
 	struct line6_pcm_stream *pstr = get_stream(line6pcm, direction);
-	int ret = 0;
+	int i, ret = 0;
 
 	spin_lock_irqsave(&pstr->lock, flags);
 	if (!test_and_set_bit(type, &pstr->running) &&
 	    !(pstr->active_urbs || pstr->unlink_urbs)) {
 		pstr->count = 0;
 		/* Submit all currently available URBs */
-		if (direction == SNDRV_PCM_STREAM_PLAYBACK)
-			ret = line6_submit_audio_out_all_urbs(line6pcm);
-		else
-			ret = line6_submit_audio_in_all_urbs(line6pcm);
+		for (i = 0; i < line6pcm->line6->iso_buffers && !ret; i++) {
+			if (direction == SNDRV_PCM_STREAM_PLAYBACK)
+				ret = line6_submit_audio_out_urb(line6pcm);
+			else
+				ret = line6_submit_audio_in_urb(line6pcm);
+		}
 	}
 
 	if (ret < 0)
@@ -454,6 +528,42 @@ static const struct snd_kcontrol_new line6_controls[] = {
 	},
 };
 
+/*
+	Allocate the URBs of a stream and fill in the constant values.
+*/
+static int line6_create_audio_urbs(struct snd_line6_pcm *line6pcm,
+				   struct line6_pcm_stream *pcms,
+				   unsigned int pipe, usb_complete_t complete)
+{
+	struct usb_line6 *line6 = line6pcm->line6;
+	struct urb *urb;
+	int i;
+
+	pcms->urbs = kcalloc(line6->iso_buffers, sizeof(struct urb *),
+			     GFP_KERNEL);
+	if (pcms->urbs == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < line6->iso_buffers; ++i) {
+		urb = pcms->urbs[i] =
+		    usb_alloc_urb(LINE6_ISO_PACKETS, GFP_KERNEL);
+		if (urb == NULL)
+			return -ENOMEM;
+
+		urb->dev = line6->usbdev;
+		urb->pipe = pipe;
+		urb->transfer_flags = URB_ISO_ASAP;
+		urb->start_frame = -1;
+		urb->number_of_packets = LINE6_ISO_PACKETS;
+		urb->interval = LINE6_ISO_INTERVAL;
+		urb->error_count = 0;
+		urb->complete = complete;
+		urb->context = line6pcm;
+	}
+
+	return 0;
+}
+
 /*
 	Cleanup the PCM device.
 */
@@ -568,11 +678,17 @@ int line6_init_pcm(struct usb_line6 *line6,
 	pcm->private_data = line6pcm;
 	pcm->private_free = line6_cleanup_pcm;
 
-	err = line6_create_audio_out_urbs(line6pcm);
+	err = line6_create_audio_urbs(line6pcm, &line6pcm->out,
+			usb_sndisocpipe(line6->usbdev,
+					ep_write & USB_ENDPOINT_NUMBER_MASK),
+			line6_audio_out_callback);
 	if (err < 0)
 		return err;
 
-	err = line6_create_audio_in_urbs(line6pcm);
+	err = line6_create_audio_urbs(line6pcm, &line6pcm->in,
+			usb_rcvisocpipe(line6->usbdev,
+					ep_read & USB_ENDPOINT_NUMBER_MASK),
+			line6_audio_in_callback);
 	if (err < 0)
 		return err;
 
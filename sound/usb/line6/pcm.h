@@ -192,6 +192,15 @@ extern int snd_line6_hw_params(struct snd_pcm_substream *substream,
 extern int snd_line6_hw_free(struct snd_pcm_substream *substream);
 extern snd_pcm_uframes_t snd_line6_pointer(struct snd_pcm_substream *substream);
 extern void line6_pcm_disconnect(struct snd_line6_pcm *line6pcm);
+extern int line6_find_free_urb(struct snd_line6_pcm *line6pcm,
+			       struct line6_pcm_stream *pcms);
+extern void line6_submit_urb(struct snd_line6_pcm *line6pcm,
+			     struct line6_pcm_stream *pcms, int index);
+extern int line6_urb_index(struct snd_line6_pcm *line6pcm,
+			   struct line6_pcm_stream *pcms, struct urb *urb);
+extern void line6_copy_pcm(struct snd_pcm_runtime *runtime,
+			   snd_pcm_uframes_t pos, void *buf, int frames,
+			   int bytes_per_frame, bool to_pcm);
 extern int line6_pcm_acquire(struct snd_line6_pcm *line6pcm, int type,
 			       bool start);
 extern void line6_pcm_release(struct snd_line6_pcm *line6pcm, int type);
@@ -141,11 +141,10 @@ static void add_monitor_signal(struct urb *urb_out, unsigned char *signal,
 	Find a free URB, prepare audio data, and submit URB.
 	must be called in line6pcm->out.lock context
 */
-static int submit_audio_out_urb(struct snd_line6_pcm *line6pcm)
+int line6_submit_audio_out_urb(struct snd_line6_pcm *line6pcm)
 {
 	int index;
 	int i, urb_size, urb_frames;
-	int ret;
 	const int bytes_per_frame =
 		line6pcm->properties->bytes_per_channel *
 		line6pcm->properties->playback_hw.channels_max;
@@ -156,13 +155,9 @@ static int submit_audio_out_urb(struct snd_line6_pcm *line6pcm)
 		(line6pcm->line6->intervals_per_second / LINE6_ISO_INTERVAL);
 	struct urb *urb_out;
 
-	index = find_first_zero_bit(&line6pcm->out.active_urbs,
-				    line6pcm->line6->iso_buffers);
-
-	if (index < 0 || index >= line6pcm->line6->iso_buffers) {
-		dev_err(line6pcm->line6->ifcdev, "no free URB found\n");
-		return -EINVAL;
-	}
+	index = line6_find_free_urb(line6pcm, &line6pcm->out);
+	if (index < 0)
+		return index;
 
 	urb_out = line6pcm->out.urbs[index];
 	urb_size = 0;
@@ -202,39 +197,15 @@ static int submit_audio_out_urb(struct snd_line6_pcm *line6pcm)
 	    line6pcm->out.buffer +
 	    index * LINE6_ISO_PACKETS * line6pcm->max_packet_size_out;
 	urb_out->transfer_buffer_length = urb_size;
-	urb_out->context = line6pcm;
 
 	if (test_bit(LINE6_STREAM_PCM, &line6pcm->out.running) &&
 	    !test_bit(LINE6_FLAG_PAUSE_PLAYBACK, &line6pcm->flags)) {
 		struct snd_pcm_runtime *runtime =
 		    get_substream(line6pcm, SNDRV_PCM_STREAM_PLAYBACK)->runtime;
 
-		if (line6pcm->out.pos + urb_frames > runtime->buffer_size) {
-			/*
-			   The transferred area goes over buffer boundary,
-			   copy the data to the temp buffer.
-			 */
-			int len;
-
-			len = runtime->buffer_size - line6pcm->out.pos;
-
-			if (len > 0) {
-				memcpy(urb_out->transfer_buffer,
-				       runtime->dma_area +
-				       line6pcm->out.pos * bytes_per_frame,
-				       len * bytes_per_frame);
-				memcpy(urb_out->transfer_buffer +
-				       len * bytes_per_frame, runtime->dma_area,
-				       (urb_frames - len) * bytes_per_frame);
-			} else
-				dev_err(line6pcm->line6->ifcdev, "driver bug: len = %d\n",
-					len);
-		} else {
-			memcpy(urb_out->transfer_buffer,
-			       runtime->dma_area +
-			       line6pcm->out.pos * bytes_per_frame,
-			       urb_out->transfer_buffer_length);
-		}
+		line6_copy_pcm(runtime, line6pcm->out.pos,
+			       urb_out->transfer_buffer, urb_frames,
+			       bytes_per_frame, false);
 
 		line6pcm->out.pos += urb_frames;
 		if (line6pcm->out.pos >= runtime->buffer_size)
@@ -272,38 +243,14 @@ static int submit_audio_out_urb(struct snd_line6_pcm *line6pcm)
 	}
 	spin_unlock(&line6pcm->in.lock);
 
-	ret = usb_submit_urb(urb_out, GFP_ATOMIC);
-
-	if (ret == 0)
-		set_bit(index, &line6pcm->out.active_urbs);
-	else
-		dev_err(line6pcm->line6->ifcdev,
-			"URB out #%d submission failed (%d)\n", index, ret);
-
+	line6_submit_urb(line6pcm, &line6pcm->out, index);
 	return 0;
 }
 
-/*
-	Submit all currently available playback URBs.
-	must be called in line6pcm->out.lock context
- */
-int line6_submit_audio_out_all_urbs(struct snd_line6_pcm *line6pcm)
-{
-	int ret = 0, i;
-
-	for (i = 0; i < line6pcm->line6->iso_buffers; ++i) {
-		ret = submit_audio_out_urb(line6pcm);
-		if (ret < 0)
-			break;
-	}
-
-	return ret;
-}
-
 /*
 	Callback for completed playback URB.
 */
-static void audio_out_callback(struct urb *urb)
+void line6_audio_out_callback(struct urb *urb)
 {
 	int i, index, length = 0, shutdown = 0;
 	unsigned long flags;
@@ -320,11 +267,7 @@ static void audio_out_callback(struct urb *urb)
 
 	line6pcm->out.last_frame = urb->start_frame;
 
-	/* find index of URB */
-	for (index = 0; index < line6pcm->line6->iso_buffers; index++)
-		if (urb == line6pcm->out.urbs[index])
-			break;
-
+	index = line6_urb_index(line6pcm, &line6pcm->out, urb);
 	if (index >= line6pcm->line6->iso_buffers)
 		return;		/* URB has been unlinked asynchronously */
 
@@ -355,7 +298,7 @@ static void audio_out_callback(struct urb *urb)
 		shutdown = 1;
 
 	if (!shutdown) {
-		submit_audio_out_urb(line6pcm);
+		line6_submit_audio_out_urb(line6pcm);
 
 		if (test_bit(LINE6_STREAM_PCM, &line6pcm->out.running)) {
 			line6pcm->out.bytes += length;
@@ -403,40 +346,3 @@ struct snd_pcm_ops snd_line6_playback_ops = {
 	.trigger = snd_line6_trigger,
 	.pointer = snd_line6_pointer,
 };
-
-int line6_create_audio_out_urbs(struct snd_line6_pcm *line6pcm)
-{
-	struct usb_line6 *line6 = line6pcm->line6;
-	int i;
-
-	line6pcm->out.urbs = kzalloc(
-		sizeof(struct urb *) * line6->iso_buffers, GFP_KERNEL);
-	if (line6pcm->out.urbs == NULL)
-		return -ENOMEM;
-
-	/* create audio URBs and fill in constant values: */
-	for (i = 0; i < line6->iso_buffers; ++i) {
-		struct urb *urb;
-
-		/* URB for audio out: */
-		urb = line6pcm->out.urbs[i] =
-		    usb_alloc_urb(LINE6_ISO_PACKETS, GFP_KERNEL);
-
-		if (urb == NULL)
-			return -ENOMEM;
-
-		urb->dev = line6->usbdev;
-		urb->pipe =
-		    usb_sndisocpipe(line6->usbdev,
-				    line6->properties->ep_audio_w &
-				    USB_ENDPOINT_NUMBER_MASK);
-		urb->transfer_flags = URB_ISO_ASAP;
-		urb->start_frame = -1;
-		urb->number_of_packets = LINE6_ISO_PACKETS;
-		urb->interval = LINE6_ISO_INTERVAL;
-		urb->error_count = 0;
-		urb->complete = audio_out_callback;
-	}
-
-	return 0;
-}
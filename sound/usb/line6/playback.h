@@ -29,7 +29,7 @@
 
 extern struct snd_pcm_ops snd_line6_playback_ops;
 
-extern int line6_create_audio_out_urbs(struct snd_line6_pcm *line6pcm);
-extern int line6_submit_audio_out_all_urbs(struct snd_line6_pcm *line6pcm);
+extern void line6_audio_out_callback(struct urb *urb);
+extern int line6_submit_audio_out_urb(struct snd_line6_pcm *line6pcm);
 
 #endif
@@ -44,14 +44,17 @@
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
 #include <linux/usb.h>
 #include <linux/wait.h>
 #include <linux/usb/audio.h>
 #include <linux/module.h>
+#include <linux/workqueue.h>
 
 #include <sound/core.h>
 #include <sound/control.h>
 #include <sound/rawmidi.h>
+#include <sound/info.h>
 #include <sound/asequencer.h>
 #include "usbaudio.h"
 #include "midi.h"
@@ -70,13 +73,32 @@
 #define ERROR_DELAY_JIFFIES (HZ / 10)
 
 #define OUTPUT_URBS 7
-#define INPUT_URBS 7
+
+/*
+ * An input endpoint starts with INPUT_URBS_MIN URBs of one packet each.
+ * While transfers come back full, it gets INPUT_URBS_STEP more URBs at a
+ * time, up to INPUT_URBS; for bulk endpoints, those may take up to
+ * INPUT_BULK_PACKETS packets.  They are released again once no transfer
+ * has been full for INPUT_IDLE_DELAY.
+ */
+#define INPUT_URBS 16
+#define INPUT_URBS_MIN 4
+#define INPUT_URBS_STEP 4
+#define INPUT_BULK_PACKETS 8
+#define INPUT_IDLE_DELAY (5 * HZ)
 
 
 MODULE_AUTHOR("Clemens Ladisch <clemens@ladisch.de>");
 MODULE_DESCRIPTION("USB Audio/MIDI helper module");
 MODULE_LICENSE("Dual BSD/GPL");
 
+static unsigned int out_coalesce_us;
+module_param(out_coalesce_us, uint, 0644);
+MODULE_PARM_DESC(out_coalesce_us, "Max. delay (in us) for packing MIDI output into fuller URBs (0 = off).");
+static unsigned int bulk_out_packets = 1;
+module_param(bulk_out_packets, uint, 0444);
+MODULE_PARM_DESC(bulk_out_packets, "Max. USB packets per MIDI bulk output URB (1-8).");
+
 
 struct usb_ms_header_descriptor {
 	__u8  bLength;
@@ -146,6 +168,16 @@ struct snd_usb_midi_out_endpoint {
 	unsigned int next_urb;
 	spinlock_t buffer_lock;
 
+	/*
+	 * Output coalescing: while URBs are in flight, a partially filled
+	 * URB is held at next_urb and filled further, until it is full, an
+	 * URB completes, or the coalesce timer expires.
+	 */
+	unsigned int can_coalesce:1;	/* URBs are filled incrementally */
+	unsigned int holding:1;		/* next_urb holds data */
+	unsigned int flush:1;		/* submit the held URB */
+	struct hrtimer coalesce_timer;
+
 	struct usbmidi_out_port {
 		struct snd_usb_midi_out_endpoint *ep;
 		struct snd_rawmidi_substream *substream;
@@ -169,6 +201,20 @@ struct snd_usb_midi_out_endpoint {
 struct snd_usb_midi_in_endpoint {
 	struct snd_usb_midi *umidi;
 	struct urb *urbs[INPUT_URBS];
+	unsigned int num_urbs;		/* urbs[0..num_urbs) are in use */
+	unsigned int pipe;
+	int interval;
+	unsigned int max_packet;
+	unsigned int extra_length;	/* length of the URBs beyond the minimum */
+	unsigned int full_count;	/* consecutive full transfers */
+	unsigned long last_full;	/* jiffies of the last full transfer */
+	struct delayed_work adapt_work;
+	/* statistics */
+	unsigned long bytes;
+	unsigned long full_urbs;
+	unsigned long overflows;	/* bytes dropped by the rawmidi buffer */
+	unsigned int peak_urbs;
+	u8 ep_num;
 	struct usbmidi_in_port {
 		struct snd_rawmidi_substream *substream;
 		u8 running_status_length;
@@ -227,6 +273,7 @@ static void snd_usbmidi_input_data(struct snd_usb_midi_in_endpoint *ep,
 				   int portidx, uint8_t *data, int length)
 {
 	struct usbmidi_in_port *port = &ep->ports[portidx];
+	int err;
 
 	if (!port->substream) {
 		dev_dbg(&ep->umidi->dev->dev, "unexpected port %d!\n", portidx);
@@ -234,7 +281,9 @@ static void snd_usbmidi_input_data(struct snd_usb_midi_in_endpoint *ep,
 	}
 	if (!test_bit(port->substream->number, &ep->umidi->input_triggered))
 		return;
-	snd_rawmidi_receive(port->substream, data, length);
+	err = snd_rawmidi_receive(port->substream, data, length);
+	if (err >= 0 && err < length)
+		ep->overflows += length - err;
 }
 
 #ifdef DUMP_PACKETS
@@ -252,6 +301,35 @@ static void dump_urb(const char *type, const u8 *data, int length)
 /*
  * Processes the data read from the device.
  */
+/* is the URB still in use, i.e., not released by the adapt work? */
+static bool snd_usbmidi_in_urb_used(struct snd_usb_midi_in_endpoint *ep,
+				    struct urb *urb)
+{
+	unsigned int i, num = READ_ONCE(ep->num_urbs);
+
+	for (i = 0; i < num; ++i)
+		if (ep->urbs[i] == urb)
+			return true;
+	return false;
+}
+
+/* account a completed transfer; ask for more URBs when they run full */
+static void snd_usbmidi_in_adapt(struct snd_usb_midi_in_endpoint *ep,
+				 struct urb *urb)
+{
+	ep->bytes += urb->actual_length;
+	if (urb->actual_length < urb->transfer_buffer_length) {
+		ep->full_count = 0;
+		return;
+	}
+	ep->full_urbs++;
+	ep->last_full = jiffies;
+	if (++ep->full_count >= 2 && ep->num_urbs < INPUT_URBS) {
+		ep->full_count = 0;
+		mod_delayed_work(system_wq, &ep->adapt_work, 0);
+	}
+}
+
 static void snd_usbmidi_in_urb_complete(struct urb *urb)
 {
 	struct snd_usb_midi_in_endpoint *ep = urb->context;
@@ -260,6 +338,7 @@ static void snd_usbmidi_in_urb_complete(struct urb *urb)
 		dump_urb("received", urb->transfer_buffer, urb->actual_length);
 		ep->umidi->usb_protocol_ops->input(ep, urb->transfer_buffer,
 						   urb->actual_length);
+		snd_usbmidi_in_adapt(ep, urb);
 	} else {
 		int err = snd_usbmidi_urb_error(urb);
 		if (err < 0) {
@@ -272,6 +351,8 @@ static void snd_usbmidi_in_urb_complete(struct urb *urb)
 		}
 	}
 
+	if (!snd_usbmidi_in_urb_used(ep, urb))
+		return;
 	urb->dev = ep->umidi->dev;
 	snd_usbmidi_submit_urb(urb, GFP_ATOMIC);
 }
@@ -285,6 +366,9 @@ static void snd_usbmidi_out_urb_complete(struct urb *urb)
 	spin_lock(&ep->buffer_lock);
 	urb_index = context - ep->urbs;
 	ep->active_urbs &= ~(1 << urb_index);
+	/* don't hold data back when the pipe runs dry */
+	if (!ep->active_urbs)
+		ep->flush = 1;
 	if (unlikely(ep->drain_urbs)) {
 		ep->drain_urbs &= ~(1 << urb_index);
 		wake_up(&ep->drain_wait);
@@ -311,6 +395,7 @@ static void snd_usbmidi_do_output(struct snd_usb_midi_out_endpoint *ep)
 	unsigned int urb_index;
 	struct urb *urb;
 	unsigned long flags;
+	unsigned int coalesce_us;
 
 	spin_lock_irqsave(&ep->buffer_lock, flags);
 	if (ep->umidi->disconnected) {
@@ -318,15 +403,34 @@ static void snd_usbmidi_do_output(struct snd_usb_midi_out_endpoint *ep)
 		return;
 	}
 
+	coalesce_us = ep->can_coalesce ? READ_ONCE(out_coalesce_us) : 0;
 	urb_index = ep->next_urb;
 	for (;;) {
 		if (!(ep->active_urbs & (1 << urb_index))) {
 			urb = ep->urbs[urb_index].urb;
-			urb->transfer_buffer_length = 0;
+			if (!ep->holding)
+				urb->transfer_buffer_length = 0;
 			ep->umidi->usb_protocol_ops->output(ep, urb);
 			if (urb->transfer_buffer_length == 0)
 				break;
 
+			/* wait for more data as long as others are in flight */
+			if (coalesce_us && !ep->flush && ep->active_urbs &&
+			    urb->transfer_buffer_length + 3 < ep->max_transfer) {
+				if (!ep->holding) {
+					ep->holding = 1;
+					hrtimer_start(&ep->coalesce_timer,
+						      ns_to_ktime(coalesce_us * NSEC_PER_USEC),
+						      HRTIMER_MODE_REL);
+				}
+				break;
+			}
+			if (ep->holding) {
+				ep->holding = 0;
+				hrtimer_try_to_cancel(&ep->coalesce_timer);
+			}
+			ep->flush = 0;
+
 			dump_urb("sending", urb->transfer_buffer,
 				 urb->transfer_buffer_length);
 			urb->dev = ep->umidi->dev;
@@ -351,6 +455,21 @@ static void snd_usbmidi_out_tasklet(unsigned long data)
 	snd_usbmidi_do_output(ep);
 }
 
+/* the latency bound for held output data has been reached */
+static enum hrtimer_restart snd_usbmidi_coalesce_timer(struct hrtimer *timer)
+{
+	struct snd_usb_midi_out_endpoint *ep =
+		container_of(timer, struct snd_usb_midi_out_endpoint,
+			     coalesce_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ep->buffer_lock, flags);
+	ep->flush = 1;
+	spin_unlock_irqrestore(&ep->buffer_lock, flags);
+	tasklet_schedule(&ep->tasklet);
+	return HRTIMER_NORESTART;
+}
+
 /* called after transfers had been interrupted due to some USB error */
 static void snd_usbmidi_error_timer(unsigned long data)
 {
@@ -366,7 +485,7 @@ static void snd_usbmidi_error_timer(unsigned long data)
 		struct snd_usb_midi_in_endpoint *in = umidi->endpoints[i].in;
 		if (in && in->error_resubmit) {
 			in->error_resubmit = 0;
-			for (j = 0; j < INPUT_URBS; ++j) {
+			for (j = 0; j < in->num_urbs; ++j) {
 				if (atomic_read(&in->urbs[j]->use_count))
 					continue;
 				in->urbs[j]->dev = umidi->dev;
@@ -1192,11 +1311,18 @@ static void snd_usbmidi_output_drain(struct snd_rawmidi_substream *substream)
 
 	if (ep->umidi->disconnected)
 		return;
+	/* send out the data held for coalescing first */
+	spin_lock_irq(&ep->buffer_lock);
+	if (ep->holding) {
+		ep->flush = 1;
+		spin_unlock_irq(&ep->buffer_lock);
+		snd_usbmidi_do_output(ep);
+		spin_lock_irq(&ep->buffer_lock);
+	}
 	/*
 	 * The substream buffer is empty, but some data might still be in the
 	 * currently active URBs, so we have to wait for those to complete.
 	 */
-	spin_lock_irq(&ep->buffer_lock);
 	drain_urbs = ep->active_urbs;
 	if (drain_urbs) {
 		ep->drain_urbs |= drain_urbs;
@@ -1259,14 +1385,102 @@ static void free_urb_and_buffer(struct snd_usb_midi *umidi, struct urb *urb,
  * Frees an input endpoint.
  * May be called when ep hasn't been initialized completely.
  */
+static unsigned int snd_usbmidi_in_urb_length(struct snd_usb_midi_in_endpoint *ep,
+					      unsigned int index)
+{
+	return index < INPUT_URBS_MIN ? ep->max_packet : ep->extra_length;
+}
+
+/*
+ * Allocates an input URB with its buffer; the length depends on the slot.
+ */
+static struct urb *snd_usbmidi_in_urb_new(struct snd_usb_midi_in_endpoint *ep,
+					  unsigned int index)
+{
+	struct snd_usb_midi *umidi = ep->umidi;
+	unsigned int length = snd_usbmidi_in_urb_length(ep, index);
+	struct urb *urb;
+	void *buffer;
+
+	urb = usb_alloc_urb(0, GFP_KERNEL);
+	if (!urb)
+		return NULL;
+	buffer = usb_alloc_coherent(umidi->dev, length, GFP_KERNEL,
+				    &urb->transfer_dma);
+	if (!buffer) {
+		usb_free_urb(urb);
+		return NULL;
+	}
+	if (ep->interval)
+		usb_fill_int_urb(urb, umidi->dev, ep->pipe, buffer, length,
+				 snd_usbmidi_in_urb_complete, ep, ep->interval);
+	else
+		usb_fill_bulk_urb(urb, umidi->dev, ep->pipe, buffer, length,
+				  snd_usbmidi_in_urb_complete, ep);
+	urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
+	return urb;
+}
+
+/*
+ * Grows the set of input URBs while the endpoint is busy, and shrinks it
+ * back to the minimum once it has been idle for a while.
+ */
+static void snd_usbmidi_in_adapt_work(struct work_struct *work)
+{
+	struct snd_usb_midi_in_endpoint *ep =
+		container_of(to_delayed_work(work),
+			     struct snd_usb_midi_in_endpoint, adapt_work);
+	struct snd_usb_midi *umidi = ep->umidi;
+	struct urb *urb;
+	unsigned int i, num;
+
+	mutex_lock(&umidi->mutex);
+	if (umidi->disconnected)
+		goto unlock;
+	num = ep->num_urbs;
+	if (time_before(jiffies, ep->last_full + INPUT_IDLE_DELAY)) {
+		for (i = num; i < min(num + INPUT_URBS_STEP, INPUT_URBS); ++i) {
+			urb = snd_usbmidi_in_urb_new(ep, i);
+			if (!urb)
+				break;
+			spin_lock_irq(&umidi->disc_lock);
+			ep->urbs[i] = urb;
+			ep->num_urbs = i + 1;
+			spin_unlock_irq(&umidi->disc_lock);
+			if (umidi->input_running) {
+				urb->dev = umidi->dev;
+				snd_usbmidi_submit_urb(urb, GFP_KERNEL);
+			}
+		}
+		ep->peak_urbs = max(ep->peak_urbs, ep->num_urbs);
+		/* check again later whether the burst is over */
+		if (ep->num_urbs > INPUT_URBS_MIN)
+			schedule_delayed_work(&ep->adapt_work, INPUT_IDLE_DELAY);
+	} else if (num > INPUT_URBS_MIN) {
+		/* the completion handler doesn't resubmit released URBs */
+		spin_lock_irq(&umidi->disc_lock);
+		ep->num_urbs = INPUT_URBS_MIN;
+		spin_unlock_irq(&umidi->disc_lock);
+		for (i = INPUT_URBS_MIN; i < num; ++i) {
+			usb_kill_urb(ep->urbs[i]);
+			free_urb_and_buffer(umidi, ep->urbs[i],
+					    snd_usbmidi_in_urb_length(ep, i));
+			ep->urbs[i] = NULL;
+		}
+	}
+ unlock:
+	mutex_unlock(&umidi->mutex);
+}
+
 static void snd_usbmidi_in_endpoint_delete(struct snd_usb_midi_in_endpoint *ep)
 {
 	unsigned int i;
 
+	cancel_delayed_work_sync(&ep->adapt_work);
 	for (i = 0; i < INPUT_URBS; ++i)
 		if (ep->urbs[i])
 			free_urb_and_buffer(ep->umidi, ep->urbs[i],
-					    ep->urbs[i]->transfer_buffer_length);
+					    snd_usbmidi_in_urb_length(ep, i));
 	kfree(ep);
 }
 
@@ -1278,9 +1492,6 @@ static int snd_usbmidi_in_endpoint_create(struct snd_usb_midi *umidi,
 					  struct snd_usb_midi_endpoint *rep)
 {
 	struct snd_usb_midi_in_endpoint *ep;
-	void *buffer;
-	unsigned int pipe;
-	int length;
 	unsigned int i;
 
 	rep->in = NULL;
@@ -1288,37 +1499,29 @@ static int snd_usbmidi_in_endpoint_create(struct snd_usb_midi *umidi,
 	if (!ep)
 		return -ENOMEM;
 	ep->umidi = umidi;
+	ep->ep_num = ep_info->in_ep;
+	INIT_DELAYED_WORK(&ep->adapt_work, snd_usbmidi_in_adapt_work);
 
-	for (i = 0; i < INPUT_URBS; ++i) {
-		ep->urbs[i] = usb_alloc_urb(0, GFP_KERNEL);
-		if (!ep->urbs[i]) {
-			snd_usbmidi_in_endpoint_delete(ep);
-			return -ENOMEM;
-		}
-	}
-	if (ep_info->in_interval)
-		pipe = usb_rcvintpipe(umidi->dev, ep_info->in_ep);
+	ep->interval = ep_info->in_interval;
+	if (ep->interval)
+		ep->pipe = usb_rcvintpipe(umidi->dev, ep_info->in_ep);
 	else
-		pipe = usb_rcvbulkpipe(umidi->dev, ep_info->in_ep);
-	length = usb_maxpacket(umidi->dev, pipe, 0);
-	for (i = 0; i < INPUT_URBS; ++i) {
-		buffer = usb_alloc_coherent(umidi->dev, length, GFP_KERNEL,
-					    &ep->urbs[i]->transfer_dma);
-		if (!buffer) {
+		ep->pipe = usb_rcvbulkpipe(umidi->dev, ep_info->in_ep);
+	ep->max_packet = usb_maxpacket(umidi->dev, ep->pipe, 0);
+	/* an interrupt URB carries one packet per interval */
+	ep->extra_length = ep->max_packet;
+	if (!ep->interval)
+		ep->extra_length *= INPUT_BULK_PACKETS;
+
+	for (i = 0; i < INPUT_URBS_MIN; ++i) {
+		ep->urbs[i] = snd_usbmidi_in_urb_new(ep, i);
+		if (!ep->urbs[i]) {
 			snd_usbmidi_in_endpoint_delete(ep);
 			return -ENOMEM;
 		}
-		if (ep_info->in_interval)
-			usb_fill_int_urb(ep->urbs[i], umidi->dev,
-					 pipe, buffer, length,
-					 snd_usbmidi_in_urb_complete,
-					 ep, ep_info->in_interval);
-		else
-			usb_fill_bulk_urb(ep->urbs[i], umidi->dev,
-					  pipe, buffer, length,
-					  snd_usbmidi_in_urb_complete, ep);
-		ep->urbs[i]->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
 	}
+	ep->num_urbs = INPUT_URBS_MIN;
+	ep->peak_urbs = INPUT_URBS_MIN;
 
 	rep->in = ep;
 	return 0;
@@ -1376,9 +1579,15 @@ static int snd_usbmidi_out_endpoint_create(struct snd_usb_midi *umidi,
 		pipe = usb_sndintpipe(umidi->dev, ep_info->out_ep);
 	else
 		pipe = usb_sndbulkpipe(umidi->dev, ep_info->out_ep);
+	/* only the standard packet format is appended to a held URB */
+	ep->can_coalesce =
+		umidi->usb_protocol_ops->output == snd_usbmidi_standard_output;
 	switch (umidi->usb_id) {
 	default:
 		ep->max_transfer = usb_maxpacket(umidi->dev, pipe, 1);
+		/* a bulk URB may span several packets */
+		if (ep->can_coalesce && !ep_info->out_interval)
+			ep->max_transfer *= clamp(bulk_out_packets, 1U, 8U);
 		break;
 		/*
 		 * Various chips declare a packet size larger than 4 bytes, but
@@ -1424,6 +1633,8 @@ static int snd_usbmidi_out_endpoint_create(struct snd_usb_midi *umidi,
 
 	spin_lock_init(&ep->buffer_lock);
 	tasklet_init(&ep->tasklet, snd_usbmidi_out_tasklet, (unsigned long)ep);
+	hrtimer_init(&ep->coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ep->coalesce_timer.function = snd_usbmidi_coalesce_timer;
 	init_waitqueue_head(&ep->drain_wait);
 
 	for (i = 0; i < 0x10; ++i)
@@ -1479,8 +1690,10 @@ void snd_usbmidi_disconnect(struct list_head *p)
 
 	for (i = 0; i < MIDI_MAX_ENDPOINTS; ++i) {
 		struct snd_usb_midi_endpoint *ep = &umidi->endpoints[i];
-		if (ep->out)
+		if (ep->out) {
+			hrtimer_cancel(&ep->out->coalesce_timer);
 			tasklet_kill(&ep->out->tasklet);
+		}
 		if (ep->out) {
 			for (j = 0; j < OUTPUT_URBS; ++j)
 				usb_kill_urb(ep->out->urbs[j].urb);
@@ -1492,9 +1705,11 @@ void snd_usbmidi_disconnect(struct list_head *p)
 				wake_up(&ep->out->drain_wait);
 			}
 		}
-		if (ep->in)
+		if (ep->in) {
+			cancel_delayed_work_sync(&ep->in->adapt_work);
 			for (j = 0; j < INPUT_URBS; ++j)
 				usb_kill_urb(ep->in->urbs[j]);
+		}
 		/* free endpoints here; later call can result in Oops */
 		if (ep->out)
 			snd_usbmidi_out_endpoint_clear(ep->out);
@@ -2212,10 +2427,39 @@ static const struct snd_rawmidi_global_ops snd_usbmidi_ops = {
 	.get_port_info = snd_usbmidi_get_port_info,
 };
 
+static void snd_usbmidi_proc_read(struct snd_info_entry *entry,
+				  struct snd_info_buffer *buffer)
+{
+	struct snd_usb_midi *umidi = entry->private_data;
+	struct snd_usb_midi_in_endpoint *ep;
+	unsigned int i;
+
+	down_read(&umidi->disc_rwsem);
+	if (umidi->disconnected)
+		goto unlock;
+	for (i = 0; i < MIDI_MAX_ENDPOINTS; ++i) {
+		ep = umidi->endpoints[i].in;
+		if (!ep)
+			continue;
+		snd_iprintf(buffer, "Input endpoint 0x%02x:\n", ep->ep_num);
+		snd_iprintf(buffer, "  URBs: %u (peak %u)\n",
+			    READ_ONCE(ep->num_urbs), ep->peak_urbs);
+		snd_iprintf(buffer, "  URB size: %u/%u\n",
+			    ep->max_packet, ep->extra_length);
+		snd_iprintf(buffer, "  Received bytes: %lu\n", ep->bytes);
+		snd_iprintf(buffer, "  Full URBs: %lu\n", ep->full_urbs);
+		snd_iprintf(buffer, "  Overflows: %lu\n", ep->overflows);
+	}
+ unlock:
+	up_read(&umidi->disc_rwsem);
+}
+
 static int snd_usbmidi_create_rawmidi(struct snd_usb_midi *umidi,
 				      int out_ports, int in_ports)
 {
 	struct snd_rawmidi *rmidi;
+	struct snd_info_entry *entry;
+	char name[16];
 	int err;
 
 	err = snd_rawmidi_new(umidi->card, "USB MIDI",
@@ -2236,6 +2480,10 @@ static int snd_usbmidi_create_rawmidi(struct snd_usb_midi *umidi,
 			    &snd_usbmidi_input_ops);
 
 	umidi->rmidi = rmidi;
+
+	sprintf(name, "usbmidi%d", rmidi->device);
+	if (!snd_card_proc_new(umidi->card, name, &entry))
+		snd_info_set_text_ops(entry, umidi, snd_usbmidi_proc_read);
 	return 0;
 }
 
@@ -2266,7 +2514,7 @@ static void snd_usbmidi_input_start_ep(struct snd_usb_midi_in_endpoint *ep)
 
 	if (!ep)
 		return;
-	for (i = 0; i < INPUT_URBS; ++i) {
+	for (i = 0; i < ep->num_urbs; ++i) {
 		struct urb *urb = ep->urbs[i];
 		urb->dev = ep->umidi->dev;
 		snd_usbmidi_submit_urb(urb, GFP_KERNEL);
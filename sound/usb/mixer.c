@@ -43,7 +43,9 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/hashtable.h>
 #include <linux/init.h>
+#include <linux/jhash.h>
 #include <linux/list.h>
 #include <linux/log2.h>
 #include <linux/slab.h>
@@ -537,6 +539,9 @@ int snd_usb_set_cur_mix_value(struct usb_mixer_elem_info *cval, int channel,
 	return 0;
 }
 
+static void init_ctl_range(struct usb_mixer_elem_info *cval,
+			   struct snd_kcontrol *kctl);
+
 /*
  * TLV callback for mixer volume controls
  */
@@ -548,6 +553,8 @@ int snd_usb_mixer_vol_tlv(struct snd_kcontrol *kcontrol, int op_flag,
 
 	if (size < sizeof(scale))
 		return -ENOMEM;
+	if (cval->lazy_range)
+		init_ctl_range(cval, kcontrol);
 	if (cval->min_mute)
 		scale[0] = SNDRV_CTL_TLVT_DB_MINMAX_MUTE;
 	scale[2] = cval->dBmin;
@@ -954,6 +961,124 @@ static void volume_control_quirks(struct usb_mixer_elem_info *cval,
 	}
 }
 
+/*
+ * Cache of the queried control ranges, shared by all devices.  Probing a
+ * volume control takes a dozen round trips for the resolution tests, so the
+ * results are kept across plug-ins of devices with the same ID and the same
+ * configuration descriptors.
+ */
+struct usb_mixer_range {
+	struct hlist_node node;
+	u32 usb_id;
+	u32 desc_hash;
+	int id;
+	unsigned int control;
+	int minchn;
+	int val_type;
+	int min, max, res;
+	int set_res;		/* value for UAC_SET_RES, or 0 */
+};
+
+#define RANGE_CACHE_BITS	6
+#define RANGE_CACHE_MAX		1024	/* entries, at most */
+
+static DEFINE_HASHTABLE(range_cache, RANGE_CACHE_BITS);
+static DEFINE_MUTEX(range_cache_mutex);
+static unsigned int range_cache_count;
+
+static u32 range_key(struct usb_mixer_elem_info *cval, int minchn)
+{
+	return jhash_3words(cval->head.mixer->desc_hash,
+			    (cval->head.id << 16) | cval->control,
+			    (minchn << 8) | cval->val_type, 0);
+}
+
+static bool range_match(const struct usb_mixer_range *r,
+			struct usb_mixer_elem_info *cval, int minchn)
+{
+	struct usb_mixer_interface *mixer = cval->head.mixer;
+
+	return r->usb_id == mixer->chip->usb_id &&
+		r->desc_hash == mixer->desc_hash &&
+		r->id == cval->head.id && r->control == cval->control &&
+		r->minchn == minchn && r->val_type == cval->val_type;
+}
+
+/* restore a cached range and redo its UAC_SET_RES; false if none */
+static bool get_cached_range(struct usb_mixer_elem_info *cval, int minchn)
+{
+	struct usb_mixer_range *r;
+	int set_res = 0;
+	bool found = false;
+
+	if (!cval->head.mixer->chip->mixer_cache)
+		return false;
+	mutex_lock(&range_cache_mutex);
+	hash_for_each_possible(range_cache, r, node, range_key(cval, minchn)) {
+		if (range_match(r, cval, minchn)) {
+			cval->min = r->min;
+			cval->max = r->max;
+			cval->res = r->res;
+			set_res = r->set_res;
+			found = true;
+			break;
+		}
+	}
+	mutex_unlock(&range_cache_mutex);
+	if (set_res)
+		snd_usb_mixer_set_ctl_value(cval, UAC_SET_RES,
+					    (cval->control << 8) | minchn,
+					    set_res);
+	return found;
+}
+
+static void cache_range(struct usb_mixer_elem_info *cval, int minchn,
+			int set_res)
+{
+	struct usb_mixer_range *r;
+
+	if (!cval->head.mixer->chip->mixer_cache)
+		return;
+	mutex_lock(&range_cache_mutex);
+	if (range_cache_count >= RANGE_CACHE_MAX)
+		goto unlock;
+	hash_for_each_possible(range_cache, r, node, range_key(cval, minchn))
+		if (range_match(r, cval, minchn))
+			goto unlock;
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		goto unlock;
+	r->usb_id = cval->head.mixer->chip->usb_id;
+	r->desc_hash = cval->head.mixer->desc_hash;
+	r->id = cval->head.id;
+	r->control = cval->control;
+	r->minchn = minchn;
+	r->val_type = cval->val_type;
+	r->min = cval->min;
+	r->max = cval->max;
+	r->res = cval->res;
+	r->set_res = set_res;
+	hash_add(range_cache, &r->node, range_key(cval, minchn));
+	range_cache_count++;
+ unlock:
+	mutex_unlock(&range_cache_mutex);
+}
+
+void snd_usb_mixer_free_range_cache(void)
+{
+	struct usb_mixer_range *r;
+	struct hlist_node *tmp;
+	int bkt;
+
+	mutex_lock(&range_cache_mutex);
+	hash_for_each_safe(range_cache, bkt, tmp, r, node) {
+		hash_del(&r->node);
+		kfree(r);
+	}
+	range_cache_count = 0;
+	mutex_unlock(&range_cache_mutex);
+}
+
 /*
  * retrieve the minimum and maximum values for the specified control
  */
@@ -971,6 +1096,8 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 		cval->initialized = 1;
 	} else {
 		int minchn = 0;
+		int set_res = 0;
+
 		if (cval->cmask) {
 			int i;
 			for (i = 0; i < MAX_CHANNELS; i++)
@@ -979,6 +1106,10 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 					break;
 				}
 		}
+		if (get_cached_range(cval, minchn)) {
+			cval->initialized = 1;
+			goto quirks;
+		}
 		if (get_ctl_value(cval, UAC_GET_MAX, (cval->control << 8) | minchn, &cval->max) < 0 ||
 		    get_ctl_value(cval, UAC_GET_MIN, (cval->control << 8) | minchn, &cval->min) < 0) {
 			usb_audio_err(cval->head.mixer->chip,
@@ -1000,6 +1131,7 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 								cval->res / 2) < 0)
 					break;
 				cval->res /= 2;
+				set_res = cval->res;
 			}
 			if (get_ctl_value(cval, UAC_GET_RES,
 					  (cval->control << 8) | minchn, &cval->res) < 0)
@@ -1037,9 +1169,11 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 			snd_usb_set_cur_mix_value(cval, minchn, 0, saved);
 		}
 
+		cache_range(cval, minchn, set_res);
 		cval->initialized = 1;
 	}
 
+ quirks:
 	if (kctl)
 		volume_control_quirks(cval, kctl);
 
@@ -1065,6 +1199,48 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 
 #define get_min_max(cval, def)	get_min_max_with_quirks(cval, def, NULL)
 
+static void warn_volume_range(struct usb_mixer_elem_info *cval,
+			      struct snd_kcontrol *kctl)
+{
+	struct snd_usb_audio *chip = cval->head.mixer->chip;
+	unsigned int range = (cval->max - cval->min) / cval->res;
+
+	/*
+	 * Are there devices with volume range more than 255? I use a bit more
+	 * to be sure. 384 is a resolution magic number found on Logitech
+	 * devices. It will definitively catch all buggy Logitech devices.
+	 */
+	if (range > 384) {
+		usb_audio_warn(chip,
+			       "Warning! Unlikely big volume range (=%u), cval->res is probably wrong.",
+			       range);
+		usb_audio_warn(chip,
+			       "[%d] FU [%s] ch = %d, val = %d/%d/%d",
+			       cval->head.id, kctl->id.name, cval->channels,
+			       cval->min, cval->max, cval->res);
+	}
+}
+
+/* query the range if not done yet, e.g. deferred by build_feature_ctl() */
+static void init_ctl_range(struct usb_mixer_elem_info *cval,
+			   struct snd_kcontrol *kctl)
+{
+	if (cval->initialized)
+		return;
+	get_min_max_with_quirks(cval, 0, kctl);
+	if (!cval->initialized)
+		return;
+	if (cval->lazy_range)
+		warn_volume_range(cval, kctl);
+	if (cval->dBmin >= cval->dBmax) {
+		kctl->vd[0].access &=
+			~(SNDRV_CTL_ELEM_ACCESS_TLV_READ |
+			  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK);
+		snd_ctl_notify(cval->head.mixer->chip->card,
+			       SNDRV_CTL_EVENT_MASK_INFO, &kctl->id);
+	}
+}
+
 /* get a feature/mixer unit info */
 static int mixer_ctl_feature_info(struct snd_kcontrol *kcontrol,
 				  struct snd_ctl_elem_info *uinfo)
@@ -1082,17 +1258,7 @@ static int mixer_ctl_feature_info(struct snd_kcontrol *kcontrol,
 		uinfo->value.integer.min = 0;
 		uinfo->value.integer.max = 1;
 	} else {
-		if (!cval->initialized) {
-			get_min_max_with_quirks(cval, 0, kcontrol);
-			if (cval->initialized && cval->dBmin >= cval->dBmax) {
-				kcontrol->vd[0].access &= 
-					~(SNDRV_CTL_ELEM_ACCESS_TLV_READ |
-					  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK);
-				snd_ctl_notify(cval->head.mixer->chip->card,
-					       SNDRV_CTL_EVENT_MASK_INFO,
-					       &kcontrol->id);
-			}
-		}
+		init_ctl_range(cval, kcontrol);
 		uinfo->value.integer.min = 0;
 		uinfo->value.integer.max =
 			(cval->max - cval->min + cval->res - 1) / cval->res;
@@ -1107,6 +1273,8 @@ static int mixer_ctl_feature_get(struct snd_kcontrol *kcontrol,
 	struct usb_mixer_elem_info *cval = kcontrol->private_data;
 	int c, cnt, val, err;
 
+	if (cval->lazy_range)
+		init_ctl_range(cval, kcontrol);
 	ucontrol->value.integer.value[0] = cval->min;
 	if (cval->cmask) {
 		cnt = 0;
@@ -1140,6 +1308,8 @@ static int mixer_ctl_feature_put(struct snd_kcontrol *kcontrol,
 	int c, cnt, val, oval, err;
 	int changed = 0;
 
+	if (cval->lazy_range)
+		init_ctl_range(cval, kcontrol);
 	if (cval->cmask) {
 		cnt = 0;
 		for (c = 0; c < MAX_CHANNELS; c++) {
@@ -1243,7 +1413,6 @@ static void build_feature_ctl(struct mixer_build *state, void *raw_desc,
 	struct snd_kcontrol *kctl;
 	struct usb_mixer_elem_info *cval;
 	const struct usbmix_name_map *map;
-	unsigned int range;
 
 	control++; /* change from zero-based to 1-based value */
 
@@ -1351,8 +1520,22 @@ static void build_feature_ctl(struct mixer_build *state, void *raw_desc,
 		break;
 	}
 
-	/* get min/max values */
-	get_min_max_with_quirks(cval, 0, kctl);
+	/*
+	 * get min/max values; the queries can take long, so unless the build
+	 * relies on them, leave them to the first access of the control
+	 */
+	if (state->chip->lazy_mixer &&
+	    cval->val_type != USB_MIXER_BOOLEAN &&
+	    cval->val_type != USB_MIXER_INV_BOOLEAN &&
+	    !(map && map->dB) &&
+	    !snd_usb_mixer_fu_quirk_needs_range(state->mixer, unitid, control)) {
+		/* for failsafe */
+		cval->max = 1;
+		cval->res = 1;
+		cval->lazy_range = 1;
+	} else {
+		get_min_max_with_quirks(cval, 0, kctl);
+	}
 
 	if (control == UAC_FU_VOLUME) {
 		check_mapped_dB(map, cval);
@@ -1366,21 +1549,8 @@ static void build_feature_ctl(struct mixer_build *state, void *raw_desc,
 
 	snd_usb_mixer_fu_apply_quirk(state->mixer, cval, unitid, kctl);
 
-	range = (cval->max - cval->min) / cval->res;
-	/*
-	 * Are there devices with volume range more than 255? I use a bit more
-	 * to be sure. 384 is a resolution magic number found on Logitech
-	 * devices. It will definitively catch all buggy Logitech devices.
-	 */
-	if (range > 384) {
-		usb_audio_warn(state->chip,
-			       "Warning! Unlikely big volume range (=%u), cval->res is probably wrong.",
-			       range);
-		usb_audio_warn(state->chip,
-			       "[%d] FU [%s] ch = %d, val = %d/%d/%d",
-			       cval->head.id, kctl->id.name, cval->channels,
-			       cval->min, cval->max, cval->res);
-	}
+	if (!cval->lazy_range)
+		warn_volume_range(cval, kctl);
 
 	usb_audio_dbg(state->chip, "[%d] FU [%s] ch = %d, val = %d/%d/%d\n",
 		      cval->head.id, kctl->id.name, cval->channels,
@@ -2528,6 +2698,19 @@ static int snd_usb_mixer_status_create(struct usb_mixer_interface *mixer)
 	return 0;
 }
 
+/* hash of the active configuration, for telling apart firmware versions */
+static u32 mixer_desc_hash(struct usb_mixer_interface *mixer)
+{
+	struct usb_device *dev = mixer->chip->dev;
+	struct usb_host_config *config = dev->actconfig;
+	u32 hash = get_iface_desc(mixer->hostif)->bInterfaceNumber;
+
+	if (config && dev->rawdescriptors)
+		hash = jhash(dev->rawdescriptors[config - dev->config],
+			     le16_to_cpu(config->desc.wTotalLength), hash);
+	return jhash_1word(le16_to_cpu(dev->descriptor.bcdDevice), hash);
+}
+
 int snd_usb_create_mixer(struct snd_usb_audio *chip, int ctrlif,
 			 int ignore_error)
 {
@@ -2562,6 +2745,7 @@ int snd_usb_create_mixer(struct snd_usb_audio *chip, int ctrlif,
 		mixer->protocol = UAC_VERSION_2;
 		break;
 	}
+	mixer->desc_hash = mixer_desc_hash(mixer);
 
 	if ((err = snd_usb_mixer_controls(mixer)) < 0 ||
 	    (err = snd_usb_mixer_status_create(mixer)) < 0)
@@ -16,6 +16,9 @@ struct usb_mixer_interface {
 	/* the usb audio specification version this interface complies to */
 	int protocol;
 
+	/* hash of the active configuration, for the range cache */
+	u32 desc_hash;
+
 	/* Sound Blaster remote control stuff */
 	const struct rc_config *rc_cfg;
 	u32 rc_code;
@@ -67,6 +70,7 @@ struct usb_mixer_elem_info {
 	int cached;
 	int cache_val[MAX_CHANNELS];
 	u8 initialized;
+	u8 lazy_range;	/* min/max/res not queried at build time */
 	u8 min_mute;
 	void *private_data;
 };
@@ -74,6 +78,7 @@ struct usb_mixer_elem_info {
 int snd_usb_create_mixer(struct snd_usb_audio *chip, int ctrlif,
 			 int ignore_error);
 void snd_usb_mixer_disconnect(struct usb_mixer_interface *mixer);
+void snd_usb_mixer_free_range_cache(void);
 
 void snd_usb_mixer_notify_id(struct usb_mixer_interface *mixer, int unitid);
 
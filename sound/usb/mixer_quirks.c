@@ -1887,3 +1887,14 @@ void snd_usb_mixer_fu_apply_quirk(struct usb_mixer_interface *mixer,
 	}
 }
 
+/* does snd_usb_mixer_fu_apply_quirk() look at the queried range? */
+bool snd_usb_mixer_fu_quirk_needs_range(struct usb_mixer_interface *mixer,
+					int unitid, int control)
+{
+	switch (mixer->chip->usb_id) {
+	case USB_ID(0x21b4, 0x0081): /* AudioQuest DragonFly */
+		return unitid == 7 && control == UAC_FU_VOLUME;
+	}
+	return false;
+}
+
@@ -13,6 +13,8 @@ void snd_usb_mixer_rc_memory_change(struct usb_mixer_interface *mixer,
 void snd_usb_mixer_fu_apply_quirk(struct usb_mixer_interface *mixer,
 				  struct usb_mixer_elem_info *cval, int unitid,
 				  struct snd_kcontrol *kctl);
+bool snd_usb_mixer_fu_quirk_needs_range(struct usb_mixer_interface *mixer,
+					int unitid, int control);
 
 #endif /* SND_USB_MIXER_QUIRKS_H */
 
@@ -0,0 +1,177 @@
+/*
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Packet log of the usb-audio streams, after the usb_stream interface of
+ * the US-122L: each substream records the PCM buffer range of every
+ * packet it sends or receives, together with the rate the device
+ * feedback asks for, in a page that userspace maps read-only through a
+ * hwdep device.
+ *
+ * Unlike usb_stream, this is not a data path.  The samples stay in the
+ * PCM buffer and the URBs are still built by the endpoint code, with all
+ * its quirks; a client uses the log only to align its writes with the
+ * packets actually sent.
+ */
+
+#include <linux/mm.h>
+#include <linux/usb.h>
+
+#include <sound/core.h>
+#include <sound/hwdep.h>
+#include <sound/pcm.h>
+#include <uapi/sound/usb_stream.h>
+
+#include "usbaudio.h"
+#include "card.h"
+#include "packets.h"
+
+#define PACKETS_RING_SIZE \
+	((PAGE_SIZE - sizeof(struct usb_audio_packets)) / \
+	 sizeof(struct usb_stream_packet))
+
+int snd_usb_packets_alloc(struct snd_usb_substream *subs)
+{
+	struct usb_audio_packets *ring;
+
+	ring = (struct usb_audio_packets *)get_zeroed_page(GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+	ring->version = USB_AUDIO_PACKETS_VERSION;
+	ring->state = usb_stream_stopped;
+	ring->packets = PACKETS_RING_SIZE;
+	subs->pkt_ring = ring;
+	return 0;
+}
+
+void snd_usb_packets_free(struct snd_usb_substream *subs)
+{
+	free_page((unsigned long)subs->pkt_ring);
+	subs->pkt_ring = NULL;
+}
+
+void snd_usb_packets_prepare(struct snd_usb_substream *subs)
+{
+	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
+	struct snd_usb_endpoint *ep = subs->data_endpoint;
+	struct usb_audio_packets *ring = subs->pkt_ring;
+
+	ring->state = usb_stream_stopped;
+	smp_wmb(); /* stopped before the new parameters */
+	ring->rate = runtime->rate;
+	ring->frame_size = frames_to_bytes(runtime, 1);
+	ring->buffer_bytes = frames_to_bytes(runtime, runtime->buffer_size);
+	ring->datainterval = ep->datainterval;
+	ring->freqn = ep->freqn;
+	ring->freqm = ep->freqm;
+	ring->frame_number = 0;
+	ring->head = 0;
+	smp_wmb();
+	ring->state = usb_stream_ready;
+}
+
+void snd_usb_packets_set_state(struct snd_usb_substream *subs,
+			       unsigned int state)
+{
+	if (subs->pkt_ring)
+		WRITE_ONCE(subs->pkt_ring->state, state);
+}
+
+/*
+ * Record the packets of an urb, laid out back to back in the PCM buffer
+ * from pos on; lens holds their lengths in bytes.  Called under
+ * subs->lock, from the urb completion or the lowlatency refill.
+ */
+void snd_usb_packets_record(struct snd_usb_substream *subs,
+			    unsigned int pos, unsigned int wrap,
+			    const unsigned int *lens, int count)
+{
+	struct usb_audio_packets *ring = subs->pkt_ring;
+	struct usb_stream_packet *p;
+	unsigned int head = ring->head;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		p = &ring->packet[head++ % PACKETS_RING_SIZE];
+		p->offset = pos;
+		p->length = lens[i];
+		pos += lens[i];
+		if (pos >= wrap)
+			pos -= wrap;
+	}
+	ring->freqm = subs->data_endpoint->freqm;
+	ring->frame_number = usb_get_current_frame_number(subs->dev);
+	smp_wmb(); /* the entries before the new head */
+	WRITE_ONCE(ring->head, head);
+}
+
+static struct usb_audio_packets *
+find_ring(struct snd_usb_audio *chip, unsigned long pgoff)
+{
+	struct snd_usb_stream *as;
+
+	list_for_each_entry(as, &chip->pcm_list, list) {
+		if (as->pcm_index == pgoff / 2)
+			return as->substream[pgoff % 2].pkt_ring;
+	}
+	return NULL;
+}
+
+static int packets_vm_fault(struct vm_fault *vmf)
+{
+	struct snd_usb_audio *chip = vmf->vma->vm_private_data;
+	struct usb_audio_packets *ring;
+	struct page *page;
+
+	ring = find_ring(chip, vmf->pgoff);
+	if (!ring)
+		return VM_FAULT_SIGBUS;
+	page = virt_to_page(ring);
+	get_page(page);
+	vmf->page = page;
+	return 0;
+}
+
+static const struct vm_operations_struct packets_vm_ops = {
+	.fault = packets_vm_fault,
+};
+
+static int packets_hwdep_mmap(struct snd_hwdep *hw, struct file *file,
+			      struct vm_area_struct *area)
+{
+	if (area->vm_flags & VM_WRITE)
+		return -EPERM;
+	area->vm_ops = &packets_vm_ops;
+	/* no mprotect() to writable later */
+	area->vm_flags &= ~VM_MAYWRITE;
+	area->vm_flags |= VM_DONTDUMP | VM_DONTEXPAND;
+	area->vm_private_data = hw->private_data;
+	return 0;
+}
+
+int snd_usb_packets_hwdep_new(struct snd_usb_audio *chip)
+{
+	struct snd_hwdep *hw;
+	int err;
+
+	err = snd_hwdep_new(chip->card, "USB Packets", 0, &hw);
+	if (err < 0)
+		return err;
+
+	hw->iface = SNDRV_HWDEP_IFACE_USB_PACKETS;
+	hw->private_data = chip;
+	hw->ops.mmap = packets_hwdep_mmap;
+	sprintf(hw->name, "USB Packets %s", chip->card->shortname);
+	chip->packets_hwdep = hw;
+	return 0;
+}
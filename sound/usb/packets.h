@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __USBAUDIO_PACKETS_H
+#define __USBAUDIO_PACKETS_H
+
+int snd_usb_packets_alloc(struct snd_usb_substream *subs);
+void snd_usb_packets_free(struct snd_usb_substream *subs);
+void snd_usb_packets_prepare(struct snd_usb_substream *subs);
+void snd_usb_packets_set_state(struct snd_usb_substream *subs,
+			       unsigned int state);
+void snd_usb_packets_record(struct snd_usb_substream *subs,
+			    unsigned int pos, unsigned int wrap,
+			    const unsigned int *lens, int count);
+int snd_usb_packets_hwdep_new(struct snd_usb_audio *chip);
+
+#endif /* __USBAUDIO_PACKETS_H */
@@ -17,6 +17,7 @@
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/bitrev.h>
+#include <linux/dma-mapping.h>
 #include <linux/ratelimit.h>
 #include <linux/usb.h>
 #include <linux/usb/audio.h>
@@ -25,6 +26,7 @@
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
+#include <uapi/sound/usb_stream.h>
 
 #include "usbaudio.h"
 #include "card.h"
@@ -35,6 +37,7 @@
 #include "pcm.h"
 #include "clock.h"
 #include "power.h"
+#include "packets.h"
 
 #define SUBSTREAM_FLAG_DATA_EP_STARTED	0
 #define SUBSTREAM_FLAG_SYNC_EP_STARTED	1
@@ -71,6 +74,18 @@ snd_pcm_uframes_t snd_usb_pcm_delay(struct snd_usb_substream *subs,
 	return est_delay;
 }
 
+/*
+ * the whole delay computed by the pointer callback is made of the packets
+ * queued in the URBs
+ */
+static int snd_usb_pcm_latency(struct snd_pcm_substream *substream,
+			       struct snd_pcm_latency *latency)
+{
+	latency->stage[SNDRV_PCM_LATENCY_TRANSPORT].frames =
+		substream->runtime->delay;
+	return 0;
+}
+
 /*
  * return the current pcm pointer.  just based on the hwptr_done value.
  */
@@ -86,6 +101,23 @@ static snd_pcm_uframes_t snd_usb_pcm_pointer(struct snd_pcm_substream *substream
 	hwptr_done = subs->hwptr_done;
 	substream->runtime->delay = snd_usb_pcm_delay(subs,
 						substream->runtime->rate);
+	if (subs->inflight) {
+		/*
+		 * The data sent in place are still read by the host
+		 * controller; don't let the application overwrite them yet.
+		 */
+		unsigned int frames = bytes_to_frames(substream->runtime,
+						      subs->inflight);
+
+		if (hwptr_done < subs->inflight)
+			hwptr_done += frames_to_bytes(substream->runtime,
+					substream->runtime->buffer_size);
+		hwptr_done -= subs->inflight;
+		if (substream->runtime->delay > frames)
+			substream->runtime->delay -= frames;
+		else
+			substream->runtime->delay = 0;
+	}
 	spin_unlock(&subs->lock);
 	return hwptr_done / (substream->runtime->frame_bits >> 3);
 }
@@ -484,6 +516,17 @@ static int set_sync_endpoint(struct snd_usb_substream *subs,
 	return 0;
 }
 
+/*
+ * The interface left its altsetting; the endpoint controls may have been
+ * reset.  UAC2 clocks are entities of their own and keep their rate.
+ */
+static void altsetting_changed(struct snd_usb_substream *subs)
+{
+	subs->pitch_fmt = NULL;
+	if (subs->clock_fmt && subs->clock_fmt->protocol == UAC_VERSION_1)
+		subs->clock_fmt = NULL;
+}
+
 /*
  * find a matching format and set up the interface
  */
@@ -517,6 +560,7 @@ static int set_format(struct snd_usb_substream *subs, struct audioformat *fmt)
 		}
 		subs->interface = -1;
 		subs->altset_idx = 0;
+		altsetting_changed(subs);
 	}
 
 	/* set interface */
@@ -538,6 +582,7 @@ static int set_format(struct snd_usb_substream *subs, struct audioformat *fmt)
 			fmt->iface, fmt->altsetting);
 		subs->interface = fmt->iface;
 		subs->altset_idx = fmt->altset_idx;
+		altsetting_changed(subs);
 
 		snd_usb_set_interface_quirk(dev);
 	}
@@ -553,9 +598,13 @@ static int set_format(struct snd_usb_substream *subs, struct audioformat *fmt)
 	if (err < 0)
 		return err;
 
-	err = snd_usb_init_pitch(subs->stream->chip, fmt->iface, alts, fmt);
-	if (err < 0)
-		return err;
+	if (subs->pitch_fmt != fmt || subs->stream->chip->reinit_clock) {
+		err = snd_usb_init_pitch(subs->stream->chip, fmt->iface,
+					 alts, fmt);
+		if (err < 0)
+			return err;
+		subs->pitch_fmt = fmt;
+	}
 
 	subs->cur_audiofmt = fmt;
 
@@ -720,6 +769,66 @@ static int configure_endpoint(struct snd_usb_substream *subs)
  * if sg buffer is supported on the later version of alsa, we'll follow
  * that.
  */
+static void snd_usb_pcm_free_buffer(struct snd_pcm_substream *substream)
+{
+	struct snd_usb_substream *subs = substream->runtime->private_data;
+
+	if (subs->zc_buf.area) {
+		snd_pcm_set_runtime_buffer(substream, NULL);
+		snd_dma_free_pages(&subs->zc_buf);
+		subs->zc_buf.area = NULL;
+	} else {
+		snd_pcm_lib_free_vmalloc_buffer(substream);
+	}
+}
+
+/*
+ * With the zerocopy option, the playback buffer is allocated coherently
+ * for the host controller so that the data URBs can be sent directly from
+ * it.  Formats that are rewritten on the way (DSD, length quirk) and host
+ * controllers without DMA keep the vmalloc buffer and copy.
+ */
+static bool can_zerocopy(struct snd_usb_substream *subs,
+			 struct audioformat *fmt)
+{
+	struct usb_bus *bus = subs->dev->bus;
+
+	return subs->stream->chip->zerocopy &&
+		subs->direction == SNDRV_PCM_STREAM_PLAYBACK &&
+		!subs->tx_length_quirk && !fmt->dsd_dop && !fmt->dsd_bitrev &&
+		IS_ENABLED(CONFIG_HAS_DMA) && bus->sysdev &&
+		is_device_dma_capable(bus->sysdev);
+}
+
+static int snd_usb_pcm_alloc_buffer(struct snd_pcm_substream *substream,
+				    struct audioformat *fmt, size_t size)
+{
+	struct snd_usb_substream *subs = substream->runtime->private_data;
+
+	if (can_zerocopy(subs, fmt)) {
+		if (subs->zc_buf.area && subs->zc_buf.bytes >= size)
+			goto set_size;
+		snd_usb_pcm_free_buffer(substream);
+		if (!snd_dma_alloc_pages(SNDRV_DMA_TYPE_DEV,
+					 subs->dev->bus->sysdev, size,
+					 &subs->zc_buf)) {
+			snd_pcm_set_runtime_buffer(substream, &subs->zc_buf);
+			goto set_size;
+		}
+		subs->zc_buf.area = NULL;
+		dev_dbg(&subs->dev->dev,
+			"no coherent buffer of %zu bytes, copying\n", size);
+	} else if (subs->zc_buf.area) {
+		snd_usb_pcm_free_buffer(substream);
+	}
+
+	return snd_pcm_lib_alloc_vmalloc_buffer(substream, size);
+
+ set_size:
+	substream->runtime->dma_bytes = size;
+	return 0;
+}
+
 static int snd_usb_hw_params(struct snd_pcm_substream *substream,
 			     struct snd_pcm_hw_params *hw_params)
 {
@@ -727,11 +836,6 @@ static int snd_usb_hw_params(struct snd_pcm_substream *substream,
 	struct audioformat *fmt;
 	int ret;
 
-	ret = snd_pcm_lib_alloc_vmalloc_buffer(substream,
-					       params_buffer_bytes(hw_params));
-	if (ret < 0)
-		return ret;
-
 	subs->pcm_format = params_format(hw_params);
 	subs->period_bytes = params_period_bytes(hw_params);
 	subs->period_frames = params_period_size(hw_params);
@@ -747,6 +851,11 @@ static int snd_usb_hw_params(struct snd_pcm_substream *substream,
 		return -EINVAL;
 	}
 
+	ret = snd_usb_pcm_alloc_buffer(substream, fmt,
+				       params_buffer_bytes(hw_params));
+	if (ret < 0)
+		return ret;
+
 	ret = snd_usb_lock_shutdown(subs->stream->chip);
 	if (ret < 0)
 		return ret;
@@ -762,6 +871,33 @@ static int snd_usb_hw_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+/*
+ * hw_reconfig callback
+ *
+ * only the period and buffer sizes change: keep the format and the
+ * interface, and set up the endpoints for the new sizes at prepare
+ */
+static int snd_usb_hw_reconfig(struct snd_pcm_substream *substream,
+			       struct snd_pcm_hw_params *hw_params)
+{
+	struct snd_usb_substream *subs = substream->runtime->private_data;
+	int ret;
+
+	if (!subs->cur_audiofmt)
+		return -ENXIO;
+
+	ret = snd_usb_pcm_alloc_buffer(substream, subs->cur_audiofmt,
+				       params_buffer_bytes(hw_params));
+	if (ret < 0)
+		return ret;
+
+	subs->period_bytes = params_period_bytes(hw_params);
+	subs->period_frames = params_period_size(hw_params);
+	subs->buffer_periods = params_periods(hw_params);
+	subs->need_setup_ep = true;
+	return 0;
+}
+
 /*
  * hw_free callback
  *
@@ -780,7 +916,8 @@ static int snd_usb_hw_free(struct snd_pcm_substream *substream)
 		snd_usb_endpoint_deactivate(subs->data_endpoint);
 		snd_usb_unlock_shutdown(subs->stream->chip);
 	}
-	return snd_pcm_lib_free_vmalloc_buffer(substream);
+	snd_usb_pcm_free_buffer(substream);
+	return 0;
 }
 
 /*
@@ -817,16 +954,32 @@ static int snd_usb_pcm_prepare(struct snd_pcm_substream *substream)
 		goto unlock;
 
 	if (subs->need_setup_ep) {
+		struct snd_usb_audio *chip = subs->stream->chip;
 
-		iface = usb_ifnum_to_if(subs->dev, subs->cur_audiofmt->iface);
-		alts = &iface->altsetting[subs->cur_audiofmt->altset_idx];
-		ret = snd_usb_init_sample_rate(subs->stream->chip,
-					       subs->cur_audiofmt->iface,
-					       alts,
-					       subs->cur_audiofmt,
-					       subs->cur_rate);
-		if (ret < 0)
-			goto unlock;
+		/*
+		 * Skip the clock setup when nothing has touched the clock
+		 * since this stream did the same setup; it costs control
+		 * transfers and sometimes an interface reset.
+		 */
+		if (chip->reinit_clock ||
+		    subs->clock_fmt != subs->cur_audiofmt ||
+		    subs->clock_rate != subs->cur_rate ||
+		    subs->clock_gen != atomic_read(&chip->clock_gen)) {
+			iface = usb_ifnum_to_if(subs->dev,
+						subs->cur_audiofmt->iface);
+			alts = &iface->altsetting[subs->cur_audiofmt->altset_idx];
+			subs->clock_fmt = NULL;
+			ret = snd_usb_init_sample_rate(chip,
+						       subs->cur_audiofmt->iface,
+						       alts,
+						       subs->cur_audiofmt,
+						       subs->cur_rate);
+			if (ret < 0)
+				goto unlock;
+			subs->clock_fmt = subs->cur_audiofmt;
+			subs->clock_rate = subs->cur_rate;
+			subs->clock_gen = atomic_inc_return(&chip->clock_gen);
+		}
 
 		ret = configure_endpoint(subs);
 		if (ret < 0)
@@ -834,6 +987,12 @@ static int snd_usb_pcm_prepare(struct snd_pcm_substream *substream)
 		subs->need_setup_ep = false;
 	}
 
+	/* the card CPU list, when set, overrides urb_cpu */
+	if (subs->stream->chip->urb_worker)
+		snd_card_bind_task(subs->stream->chip->card,
+				   subs->stream->chip->urb_worker->task,
+				   cpumask_of(subs->stream->chip->urb_cpu));
+
 	/* some unit conversions in runtime */
 	subs->data_endpoint->maxframesize =
 		bytes_to_frames(runtime, subs->data_endpoint->maxpacksize);
@@ -842,10 +1001,14 @@ static int snd_usb_pcm_prepare(struct snd_pcm_substream *substream)
 
 	/* reset the pointer */
 	subs->hwptr_done = 0;
+	subs->sent_frames = 0;
+	subs->inflight = 0;
 	subs->transfer_done = 0;
 	subs->last_delay = 0;
 	subs->last_frame_number = 0;
 	runtime->delay = 0;
+	if (subs->pkt_ring)
+		snd_usb_packets_prepare(subs);
 
 	/* for playback, submit the URBs now; otherwise, the first hwptr_done
 	 * updates for all URBs would happen at the same time when starting */
@@ -1236,6 +1399,9 @@ static int snd_usb_pcm_open(struct snd_pcm_substream *substream, int direction)
 	subs->interface = -1;
 	subs->altset_idx = 0;
 	runtime->hw = snd_usb_hardware;
+	/* the lowlatency mode flushes its tail at drain */
+	if (direction == SNDRV_PCM_STREAM_PLAYBACK)
+		runtime->hw.info |= SNDRV_PCM_INFO_DRAIN_TRIGGER;
 	runtime->private_data = subs;
 	subs->pcm_substream = substream;
 	/* runtime PM is also done there */
@@ -1259,6 +1425,7 @@ static int snd_usb_pcm_close(struct snd_pcm_substream *substream, int direction)
 	    !snd_usb_lock_shutdown(subs->stream->chip)) {
 		usb_set_interface(subs->dev, subs->interface, 0);
 		subs->interface = -1;
+		altsetting_changed(subs);
 		snd_usb_unlock_shutdown(subs->stream->chip);
 	}
 
@@ -1268,6 +1435,25 @@ static int snd_usb_pcm_close(struct snd_pcm_substream *substream, int direction)
 	return 0;
 }
 
+/* copy a chunk of captured data to the PCM buffer, wrapping around */
+static void copy_capture_chunk(struct snd_pcm_runtime *runtime,
+			       unsigned int *ptr, const unsigned char *cp,
+			       unsigned int bytes, unsigned int wrap)
+{
+	if (*ptr + bytes > wrap) {
+		unsigned int bytes1 = wrap - *ptr;
+
+		memcpy(runtime->dma_area + *ptr, cp, bytes1);
+		memcpy(runtime->dma_area, cp + bytes1, bytes - bytes1);
+		*ptr = bytes - bytes1;
+	} else {
+		memcpy(runtime->dma_area + *ptr, cp, bytes);
+		*ptr += bytes;
+		if (*ptr == wrap)
+			*ptr = 0;
+	}
+}
+
 /* Since a URB can handle only a single linear buffer, we must use double
  * buffering when the data to be transferred overflows the buffer boundary.
  * To avoid inconsistencies when updating hwptr_done, we use double buffering
@@ -1277,19 +1463,23 @@ static void retire_capture_urb(struct snd_usb_substream *subs,
 			       struct urb *urb)
 {
 	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
-	unsigned int stride, frames, bytes, oldptr;
+	unsigned int stride, frames, bytes, oldptr, total, wrap;
+	unsigned int lens[MAX_PACKS_HS];
 	int i, period_elapsed = 0;
 	unsigned long flags;
-	unsigned char *cp;
+	unsigned char *cp, *run;
+	unsigned int run_bytes;
 	int current_frame_number;
 
 	/* read frame number here, update pointer in critical section */
 	current_frame_number = usb_get_current_frame_number(subs->dev);
 
 	stride = runtime->frame_bits >> 3;
+	wrap = runtime->buffer_size * stride;
 
+	/* validate the packet lengths first */
+	total = 0;
 	for (i = 0; i < urb->number_of_packets; i++) {
-		cp = (unsigned char *)urb->transfer_buffer + urb->iso_frame_desc[i].offset + subs->pkt_offset_adj;
 		if (urb->iso_frame_desc[i].status && printk_ratelimit()) {
 			dev_dbg(&subs->dev->dev, "frame %d active: %d\n",
 				i, urb->iso_frame_desc[i].status);
@@ -1306,38 +1496,55 @@ static void retire_capture_urb(struct snd_usb_substream *subs,
 				 "Corrected urb data len. %d->%d\n",
 							oldbytes, bytes);
 		}
-		/* update the current pointer */
-		spin_lock_irqsave(&subs->lock, flags);
-		oldptr = subs->hwptr_done;
-		subs->hwptr_done += bytes;
-		if (subs->hwptr_done >= runtime->buffer_size * stride)
-			subs->hwptr_done -= runtime->buffer_size * stride;
-		frames = (bytes + (oldptr % stride)) / stride;
-		subs->transfer_done += frames;
-		if (subs->transfer_done >= runtime->period_size) {
-			subs->transfer_done -= runtime->period_size;
-			period_elapsed = 1;
-		}
-		/* capture delay is by construction limited to one URB,
-		 * reset delays here
-		 */
-		runtime->delay = subs->last_delay = 0;
+		lens[i] = bytes;
+		total += bytes;
+	}
 
-		/* realign last_frame_number */
-		subs->last_frame_number = current_frame_number;
-		subs->last_frame_number &= 0xFF; /* keep 8 LSBs */
+	/* update the current pointer once for the whole URB */
+	spin_lock_irqsave(&subs->lock, flags);
+	oldptr = subs->hwptr_done;
+	subs->hwptr_done += total;
+	while (subs->hwptr_done >= wrap)
+		subs->hwptr_done -= wrap;
+	frames = (total + (oldptr % stride)) / stride;
+	subs->transfer_done += frames;
+	while (subs->transfer_done >= runtime->period_size) {
+		subs->transfer_done -= runtime->period_size;
+		period_elapsed = 1;
+	}
+	/* capture delay is by construction limited to one URB,
+	 * reset delays here
+	 */
+	runtime->delay = subs->last_delay = 0;
 
-		spin_unlock_irqrestore(&subs->lock, flags);
-		/* copy a data chunk */
-		if (oldptr + bytes > runtime->buffer_size * stride) {
-			unsigned int bytes1 =
-					runtime->buffer_size * stride - oldptr;
-			memcpy(runtime->dma_area + oldptr, cp, bytes1);
-			memcpy(runtime->dma_area, cp + bytes1, bytes - bytes1);
-		} else {
-			memcpy(runtime->dma_area + oldptr, cp, bytes);
+	/* realign last_frame_number */
+	subs->last_frame_number = current_frame_number;
+	subs->last_frame_number &= 0xFF; /* keep 8 LSBs */
+
+	if (subs->pkt_ring)
+		snd_usb_packets_record(subs, oldptr, wrap, lens,
+				       urb->number_of_packets);
+	spin_unlock_irqrestore(&subs->lock, flags);
+
+	/*
+	 * copy the data, merging the packets that follow each other in the
+	 * transfer buffer; a full URB goes in one chunk
+	 */
+	run = NULL;
+	run_bytes = 0;
+	for (i = 0; i < urb->number_of_packets; i++) {
+		cp = (unsigned char *)urb->transfer_buffer + urb->iso_frame_desc[i].offset + subs->pkt_offset_adj;
+		if (run && run + run_bytes == cp) {
+			run_bytes += lens[i];
+			continue;
 		}
+		if (run_bytes)
+			copy_capture_chunk(runtime, &oldptr, run, run_bytes, wrap);
+		run = cp;
+		run_bytes = lens[i];
 	}
+	if (run_bytes)
+		copy_capture_chunk(runtime, &oldptr, run, run_bytes, wrap);
 
 	if (period_elapsed)
 		snd_pcm_period_elapsed(subs->pcm_substream);
@@ -1422,6 +1629,25 @@ static void copy_to_urb(struct snd_usb_substream *subs, struct urb *urb,
 		subs->hwptr_done -= runtime->buffer_size * stride;
 }
 
+/* point the urb into the PCM buffer, unless the area wraps around */
+static bool send_in_place(struct snd_usb_substream *subs, struct urb *urb,
+			  int stride, unsigned int bytes)
+{
+	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
+	struct snd_urb_ctx *ctx = urb->context;
+
+	if (subs->hwptr_done + bytes > runtime->buffer_size * stride)
+		return false;
+	urb->transfer_buffer = runtime->dma_area + subs->hwptr_done;
+	urb->transfer_dma = runtime->dma_addr + subs->hwptr_done;
+	ctx->queued = bytes;
+	subs->inflight += bytes;
+	subs->hwptr_done += bytes;
+	if (subs->hwptr_done >= runtime->buffer_size * stride)
+		subs->hwptr_done -= runtime->buffer_size * stride;
+	return true;
+}
+
 static unsigned int copy_to_urb_quirk(struct snd_usb_substream *subs,
 				      struct urb *urb, int stride,
 				      unsigned int bytes)
@@ -1448,14 +1674,38 @@ static unsigned int copy_to_urb_quirk(struct snd_usb_substream *subs,
 	return bytes;
 }
 
-static void prepare_playback_urb(struct snd_usb_substream *subs,
-				 struct urb *urb)
+/* frames written by the application and not sent yet */
+static int playback_pending_frames(struct snd_usb_substream *subs,
+				   struct snd_pcm_runtime *runtime)
+{
+	snd_pcm_sframes_t sent;
+
+	/* sent ahead of the last reported hw_ptr; not taken modulo the
+	 * buffer size, which would read a full buffer as nothing sent
+	 */
+	sent = subs->sent_frames - runtime->status->hw_ptr;
+	if (sent < 0)
+		sent += runtime->boundary;
+	return max_t(snd_pcm_sframes_t,
+		     snd_pcm_playback_hw_avail(runtime) - sent, 0);
+}
+
+/*
+ * Returns -EAGAIN when the lowlatency mode has no complete packet to send;
+ * the endpoint parks the urb until snd_usb_endpoint_send_pending().  While
+ * draining, the remaining frames go out as a short packet instead, and
+ * the period is reported with the last of them so that the drain ends.
+ */
+static int prepare_playback_urb(struct snd_usb_substream *subs,
+				struct urb *urb)
 {
 	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
 	struct snd_usb_endpoint *ep = subs->data_endpoint;
 	struct snd_urb_ctx *ctx = urb->context;
 	unsigned int counts, frames, bytes;
 	int i, stride, period_elapsed = 0;
+	int avail = -1;
+	bool draining = false;
 	unsigned long flags;
 
 	stride = runtime->frame_bits >> 3;
@@ -1463,12 +1713,24 @@ static void prepare_playback_urb(struct snd_usb_substream *subs,
 	frames = 0;
 	urb->number_of_packets = 0;
 	spin_lock_irqsave(&subs->lock, flags);
+	if (ep->lowlatency) {
+		avail = playback_pending_frames(subs, runtime);
+		draining = runtime->status->state == SNDRV_PCM_STATE_DRAINING;
+	}
 	subs->frame_limit += ep->max_urb_frames;
 	for (i = 0; i < ctx->packets; i++) {
-		if (ctx->packet_size[i])
+		if (ctx->packet_size[i]) {
 			counts = ctx->packet_size[i];
-		else
-			counts = snd_usb_endpoint_next_packet_size(ep);
+		} else {
+			int left = avail < 0 ? -1 : avail - frames;
+			int size = snd_usb_endpoint_next_packet_size(ep, left);
+
+			if (size < 0 && draining && left > 0)
+				size = left; /* flush the tail */
+			if (size < 0)
+				break; /* send what we have so far */
+			counts = size;
+		}
 
 		/* set up descriptor */
 		urb->iso_frame_desc[i].offset = frames * ep->stride;
@@ -1507,7 +1769,29 @@ static void prepare_playback_urb(struct snd_usb_substream *subs,
 		    !snd_usb_endpoint_implicit_feedback_sink(ep))
 			break;
 	}
+	if (!frames && ep->lowlatency) {
+		subs->frame_limit -= ep->max_urb_frames;
+		spin_unlock_irqrestore(&subs->lock, flags);
+		return -EAGAIN;
+	}
+	if (draining && frames == avail)
+		period_elapsed = 1;
 	bytes = frames * ep->stride;
+	subs->sent_frames += frames;
+	if (subs->sent_frames >= runtime->boundary)
+		subs->sent_frames -= runtime->boundary;
+
+	if (subs->pkt_ring) {
+		unsigned int lens[MAX_PACKS_HS];
+
+		/* the PCM buffer bytes, not the wire bytes, differ for DoP */
+		for (i = 0; i < urb->number_of_packets; i++)
+			lens[i] = urb->iso_frame_desc[i].length / ep->stride *
+				  stride;
+		snd_usb_packets_record(subs, subs->hwptr_done,
+				       runtime->buffer_size * stride, lens,
+				       urb->number_of_packets);
+	}
 
 	if (unlikely(subs->pcm_format == SNDRV_PCM_FORMAT_DSD_U16_LE &&
 		     subs->cur_audiofmt->dsd_dop)) {
@@ -1527,11 +1811,19 @@ static void prepare_playback_urb(struct snd_usb_substream *subs,
 			subs->hwptr_done -= runtime->buffer_size * stride;
 	} else {
 		/* usual PCM */
-		if (!subs->tx_length_quirk)
-			copy_to_urb(subs, urb, 0, stride, bytes);
-		else
-			bytes = copy_to_urb_quirk(subs, urb, stride, bytes);
+		if (subs->tx_length_quirk) {
 			/* bytes is now amount of outgoing data */
+			bytes = copy_to_urb_quirk(subs, urb, stride, bytes);
+		} else if (!subs->zc_buf.area) {
+			copy_to_urb(subs, urb, 0, stride, bytes);
+		} else if (!send_in_place(subs, urb, stride, bytes)) {
+			/* the pointer lags by all the bytes queued after
+			 * in-place data, including the copied ones
+			 */
+			copy_to_urb(subs, urb, 0, stride, bytes);
+			ctx->queued = bytes;
+			subs->inflight += bytes;
+		}
 	}
 
 	/* update delay with exact number of samples queued */
@@ -1553,8 +1845,17 @@ static void prepare_playback_urb(struct snd_usb_substream *subs,
 
 	spin_unlock_irqrestore(&subs->lock, flags);
 	urb->transfer_buffer_length = bytes;
-	if (period_elapsed)
-		snd_pcm_period_elapsed(subs->pcm_substream);
+	if (period_elapsed) {
+		/*
+		 * The lowlatency mode may be called from the ack callback
+		 * under the stream lock; report when the urb is retired.
+		 */
+		if (ep->lowlatency)
+			ctx->period_elapsed = true;
+		else
+			snd_pcm_period_elapsed(subs->pcm_substream);
+	}
+	return 0;
 }
 
 /*
@@ -1567,6 +1868,7 @@ static void retire_playback_urb(struct snd_usb_substream *subs,
 	unsigned long flags;
 	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
 	struct snd_usb_endpoint *ep = subs->data_endpoint;
+	struct snd_urb_ctx *ctx = urb->context;
 	int processed = urb->transfer_buffer_length / ep->stride;
 	int est_delay;
 
@@ -1574,9 +1876,14 @@ static void retire_playback_urb(struct snd_usb_substream *subs,
 	 * silent payloads are procssed before handling the actual data
 	 */
 	if (!processed)
-		return;
+		goto period;
 
 	spin_lock_irqsave(&subs->lock, flags);
+	if (ctx->queued) {
+		/* the host controller is done with the in-place data */
+		subs->inflight -= min(subs->inflight, ctx->queued);
+		ctx->queued = 0;
+	}
 	if (!subs->last_delay)
 		goto out; /* short path */
 
@@ -1608,6 +1915,11 @@ static void retire_playback_urb(struct snd_usb_substream *subs,
 
  out:
 	spin_unlock_irqrestore(&subs->lock, flags);
+ period:
+	if (ctx->period_elapsed) {
+		ctx->period_elapsed = false;
+		snd_pcm_period_elapsed(subs->pcm_substream);
+	}
 }
 
 static int snd_usb_playback_open(struct snd_pcm_substream *substream)
@@ -1630,6 +1942,40 @@ static int snd_usb_capture_close(struct snd_pcm_substream *substream)
 	return snd_usb_pcm_close(substream, SNDRV_PCM_STREAM_CAPTURE);
 }
 
+/*
+ * RESET moves hw_ptr, keep the frames in flight ahead of it, so that the
+ * lowlatency mode doesn't take the written data as already sent
+ */
+static int snd_usb_pcm_playback_ioctl(struct snd_pcm_substream *substream,
+				      unsigned int cmd, void *arg)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_usb_substream *subs = runtime->private_data;
+	snd_pcm_sframes_t ahead;
+	unsigned long flags;
+	int err;
+
+	if (cmd != SNDRV_PCM_IOCTL1_RESET)
+		return snd_pcm_lib_ioctl(substream, cmd, arg);
+
+	spin_lock_irqsave(&subs->lock, flags);
+	ahead = subs->sent_frames - runtime->status->hw_ptr;
+	if (ahead < 0)
+		ahead += runtime->boundary;
+	spin_unlock_irqrestore(&subs->lock, flags);
+
+	err = snd_pcm_lib_ioctl(substream, cmd, arg);
+	if (err < 0)
+		return err;
+
+	spin_lock_irqsave(&subs->lock, flags);
+	subs->sent_frames = runtime->status->hw_ptr + ahead;
+	if (subs->sent_frames >= runtime->boundary)
+		subs->sent_frames -= runtime->boundary;
+	spin_unlock_irqrestore(&subs->lock, flags);
+	return 0;
+}
+
 static int snd_usb_substream_playback_trigger(struct snd_pcm_substream *substream,
 					      int cmd)
 {
@@ -1642,16 +1988,26 @@ static int snd_usb_substream_playback_trigger(struct snd_pcm_substream *substrea
 		subs->data_endpoint->prepare_data_urb = prepare_playback_urb;
 		subs->data_endpoint->retire_data_urb = retire_playback_urb;
 		subs->running = 1;
+		snd_usb_packets_set_state(subs, usb_stream_running);
+		if (subs->data_endpoint->lowlatency)
+			snd_usb_endpoint_send_pending(subs->data_endpoint);
 		return 0;
 	case SNDRV_PCM_TRIGGER_STOP:
 		stop_endpoints(subs, false);
 		subs->running = 0;
+		snd_usb_packets_set_state(subs, usb_stream_stopped);
 		return 0;
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 		subs->data_endpoint->prepare_data_urb = NULL;
 		/* keep retire_data_urb for delay calculation */
 		subs->data_endpoint->retire_data_urb = retire_playback_urb;
 		subs->running = 0;
+		snd_usb_packets_set_state(subs, usb_stream_ready);
+		return 0;
+	case SNDRV_PCM_TRIGGER_DRAIN:
+		/* send the tail shorter than a packet, see prepare_playback_urb() */
+		if (subs->data_endpoint->lowlatency && subs->running)
+			snd_usb_endpoint_send_pending(subs->data_endpoint);
 		return 0;
 	}
 
@@ -1672,35 +2028,77 @@ static int snd_usb_substream_capture_trigger(struct snd_pcm_substream *substream
 
 		subs->data_endpoint->retire_data_urb = retire_capture_urb;
 		subs->running = 1;
+		snd_usb_packets_set_state(subs, usb_stream_running);
 		return 0;
 	case SNDRV_PCM_TRIGGER_STOP:
 		stop_endpoints(subs, false);
 		subs->running = 0;
+		snd_usb_packets_set_state(subs, usb_stream_stopped);
 		return 0;
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 		subs->data_endpoint->retire_data_urb = NULL;
 		subs->running = 0;
+		snd_usb_packets_set_state(subs, usb_stream_ready);
 		return 0;
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		subs->data_endpoint->retire_data_urb = retire_capture_urb;
 		subs->running = 1;
+		snd_usb_packets_set_state(subs, usb_stream_running);
 		return 0;
 	}
 
 	return -EINVAL;
 }
 
+static struct page *snd_usb_pcm_page(struct snd_pcm_substream *substream,
+				      unsigned long offset)
+{
+	struct snd_usb_substream *subs = substream->runtime->private_data;
+
+	if (subs->zc_buf.area)
+		return NULL; /* mapped at once in snd_usb_pcm_mmap() */
+	return snd_pcm_lib_get_vmalloc_page(substream, offset);
+}
+
+static int snd_usb_pcm_mmap(struct snd_pcm_substream *substream,
+			    struct vm_area_struct *area)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_usb_substream *subs = runtime->private_data;
+
+	if (!subs->zc_buf.area)
+		return snd_pcm_lib_default_mmap(substream, area);
+	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	return dma_mmap_coherent(subs->zc_buf.dev.dev, area,
+				 runtime->dma_area, runtime->dma_addr,
+				 area->vm_end - area->vm_start);
+}
+
+/* in the lowlatency mode, send the new data right away */
+static int snd_usb_pcm_playback_ack(struct snd_pcm_substream *substream)
+{
+	struct snd_usb_substream *subs = substream->runtime->private_data;
+	struct snd_usb_endpoint *ep = subs->data_endpoint;
+
+	if (ep && ep->lowlatency && subs->running)
+		snd_usb_endpoint_send_pending(ep);
+	return 0;
+}
+
 static const struct snd_pcm_ops snd_usb_playback_ops = {
 	.open =		snd_usb_playback_open,
 	.close =	snd_usb_playback_close,
-	.ioctl =	snd_pcm_lib_ioctl,
+	.ioctl =	snd_usb_pcm_playback_ioctl,
 	.hw_params =	snd_usb_hw_params,
 	.hw_free =	snd_usb_hw_free,
+	.hw_reconfig =	snd_usb_hw_reconfig,
 	.prepare =	snd_usb_pcm_prepare,
 	.trigger =	snd_usb_substream_playback_trigger,
 	.pointer =	snd_usb_pcm_pointer,
-	.page =		snd_pcm_lib_get_vmalloc_page,
-	.mmap =		snd_pcm_lib_mmap_vmalloc,
+	.ack =		snd_usb_pcm_playback_ack,
+	.latency =	snd_usb_pcm_latency,
+	.page =		snd_usb_pcm_page,
+	.mmap =		snd_usb_pcm_mmap,
 };
 
 static const struct snd_pcm_ops snd_usb_capture_ops = {
@@ -1709,9 +2107,11 @@ static const struct snd_pcm_ops snd_usb_capture_ops = {
 	.ioctl =	snd_pcm_lib_ioctl,
 	.hw_params =	snd_usb_hw_params,
 	.hw_free =	snd_usb_hw_free,
+	.hw_reconfig =	snd_usb_hw_reconfig,
 	.prepare =	snd_usb_pcm_prepare,
 	.trigger =	snd_usb_substream_capture_trigger,
 	.pointer =	snd_usb_pcm_pointer,
+	.latency =	snd_usb_pcm_latency,
 	.page =		snd_pcm_lib_get_vmalloc_page,
 	.mmap =		snd_pcm_lib_mmap_vmalloc,
 };
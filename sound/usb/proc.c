@@ -115,6 +115,25 @@ static void proc_dump_substream_formats(struct snd_usb_substream *subs, struct s
 	}
 }
 
+static void proc_dump_ep_stats(const char *name,
+			       struct snd_usb_endpoint *ep,
+			       struct snd_info_buffer *buffer)
+{
+	struct snd_usb_ep_stats *st = &ep->stats;
+
+	snd_iprintf(buffer, "    %s URBs = %u (%u late, max interval %u us)\n",
+		    name, st->urb.urbs, st->urb.late, st->urb.interval_max);
+	snd_iprintf(buffer, "    %s Queue = %u URBs min\n",
+		    name, st->queued_min);
+	if (st->silent)
+		snd_iprintf(buffer, "    %s Silent URBs = %u\n",
+			    name, st->silent);
+	if (st->urb.errors)
+		snd_iprintf(buffer, "    %s Errors = %u (last %d: %s)\n",
+			    name, st->urb.errors, st->urb.last_error,
+			    snd_usb_error_string(st->urb.last_error));
+}
+
 static void proc_dump_ep_status(struct snd_usb_substream *subs,
 				struct snd_usb_endpoint *data_ep,
 				struct snd_usb_endpoint *sync_ep,
@@ -133,6 +152,29 @@ static void proc_dump_ep_status(struct snd_usb_substream *subs,
 		snd_iprintf(buffer, "    Feedback Format = %d.%d\n",
 			    (sync_ep->syncmaxsize > 3 ? 32 : 24) - res, res);
 	}
+	if (sync_ep && data_ep->fb_count) {
+		unsigned int (*hz)(unsigned int) =
+			subs->speed == USB_SPEED_FULL ?
+			get_full_speed_hz : get_high_speed_hz;
+
+		snd_iprintf(buffer, "    Feedback Values = %u (%u - %u Hz)\n",
+			    data_ep->fb_count, hz(data_ep->fb_min),
+			    hz(data_ep->fb_max));
+		snd_iprintf(buffer, "    Feedback Jitter = %u Hz (max %u Hz)\n",
+			    hz(data_ep->fb_jitter >> 4),
+			    hz(data_ep->fb_jitter_max));
+		if (data_ep->chip->feedback_filter)
+			snd_iprintf(buffer, "    Feedback Filter = 2^%u\n",
+				    data_ep->chip->feedback_filter);
+	}
+	if (sync_ep && (data_ep->stats.fb_corrected ||
+			data_ep->stats.fb_rejected))
+		snd_iprintf(buffer, "    Feedback Fixups = %u corrected, %u rejected\n",
+			    data_ep->stats.fb_corrected,
+			    data_ep->stats.fb_rejected);
+	proc_dump_ep_stats("Data", data_ep, buffer);
+	if (sync_ep)
+		proc_dump_ep_stats("Sync", sync_ep, buffer);
 }
 
 static void proc_dump_substream_status(struct snd_usb_substream *subs, struct snd_info_buffer *buffer)
@@ -1113,72 +1113,14 @@ static void set_format_emu_quirk(struct snd_usb_substream *subs,
 void snd_usb_set_format_quirk(struct snd_usb_substream *subs,
 			      struct audioformat *fmt)
 {
-	switch (subs->stream->chip->usb_id) {
-	case USB_ID(0x041e, 0x3f02): /* E-Mu 0202 USB */
-	case USB_ID(0x041e, 0x3f04): /* E-Mu 0404 USB */
-	case USB_ID(0x041e, 0x3f0a): /* E-Mu Tracker Pre */
-	case USB_ID(0x041e, 0x3f19): /* E-Mu 0204 USB */
+	if (subs->stream->chip->quirk_flags & QUIRK_FLAG_EMU_FORMAT)
 		set_format_emu_quirk(subs, fmt);
-		break;
-	}
 }
 
 bool snd_usb_get_sample_rate_quirk(struct snd_usb_audio *chip)
 {
 	/* devices which do not support reading the sample rate. */
-	switch (chip->usb_id) {
-	case USB_ID(0x041E, 0x4080): /* Creative Live Cam VF0610 */
-	case USB_ID(0x045E, 0x075D): /* MS Lifecam Cinema  */
-	case USB_ID(0x045E, 0x076D): /* MS Lifecam HD-5000 */
-	case USB_ID(0x045E, 0x076E): /* MS Lifecam HD-5001 */
-	case USB_ID(0x045E, 0x076F): /* MS Lifecam HD-6000 */
-	case USB_ID(0x045E, 0x0772): /* MS Lifecam Studio */
-	case USB_ID(0x045E, 0x0779): /* MS Lifecam HD-3000 */
-	case USB_ID(0x047F, 0x02F7): /* Plantronics BT-600 */
-	case USB_ID(0x047F, 0x0415): /* Plantronics BT-300 */
-	case USB_ID(0x047F, 0xAA05): /* Plantronics DA45 */
-	case USB_ID(0x047F, 0xC022): /* Plantronics C310 */
-	case USB_ID(0x047F, 0xC02F): /* Plantronics P610 */
-	case USB_ID(0x047F, 0xC036): /* Plantronics C520-M */
-	case USB_ID(0x04D8, 0xFEEA): /* Benchmark DAC1 Pre */
-	case USB_ID(0x0556, 0x0014): /* Phoenix Audio TMX320VC */
-	case USB_ID(0x05A3, 0x9420): /* ELP HD USB Camera */
-	case USB_ID(0x074D, 0x3553): /* Outlaw RR2150 (Micronas UAC3553B) */
-	case USB_ID(0x1395, 0x740a): /* Sennheiser DECT */
-	case USB_ID(0x1901, 0x0191): /* GE B850V3 CP2114 audio interface */
-	case USB_ID(0x1de7, 0x0013): /* Phoenix Audio MT202exe */
-	case USB_ID(0x1de7, 0x0014): /* Phoenix Audio TMX320 */
-	case USB_ID(0x1de7, 0x0114): /* Phoenix Audio MT202pcs */
-	case USB_ID(0x21B4, 0x0081): /* AudioQuest DragonFly */
-		return true;
-	}
-	return false;
-}
-
-/* Marantz/Denon USB DACs need a vendor cmd to switch
- * between PCM and native DSD mode
- */
-static bool is_marantz_denon_dac(unsigned int id)
-{
-	switch (id) {
-	case USB_ID(0x154e, 0x1003): /* Denon DA-300USB */
-	case USB_ID(0x154e, 0x3005): /* Marantz HD-DAC1 */
-	case USB_ID(0x154e, 0x3006): /* Marantz SA-14S1 */
-		return true;
-	}
-	return false;
-}
-
-/* TEAC UD-501/UD-503/NT-503 USB DACs need a vendor cmd to switch
- * between PCM/DOP and native DSD mode
- */
-static bool is_teac_50X_dac(unsigned int id)
-{
-	switch (id) {
-	case USB_ID(0x0644, 0x8043): /* TEAC UD-501/UD-503/NT-503 */
-		return true;
-	}
-	return false;
+	return chip->quirk_flags & QUIRK_FLAG_GET_SAMPLE_RATE;
 }
 
 int snd_usb_select_mode_quirk(struct snd_usb_substream *subs,
@@ -1187,7 +1129,7 @@ int snd_usb_select_mode_quirk(struct snd_usb_substream *subs,
 	struct usb_device *dev = subs->dev;
 	int err;
 
-	if (is_marantz_denon_dac(subs->stream->chip->usb_id)) {
+	if (subs->stream->chip->quirk_flags & QUIRK_FLAG_DSD_MARANTZ) {
 		/* First switch to alt set 0, otherwise the mode switch cmd
 		 * will not be accepted by the DAC
 		 */
@@ -1208,7 +1150,7 @@ int snd_usb_select_mode_quirk(struct snd_usb_substream *subs,
 			break;
 		}
 		mdelay(20);
-	} else if (is_teac_50X_dac(subs->stream->chip->usb_id)) {
+	} else if (subs->stream->chip->quirk_flags & QUIRK_FLAG_DSD_TEAC) {
 		/* Vendor mode switch cmd is required. */
 		switch (fmt->altsetting) {
 		case 3: /* DSD mode (DSD_U32) requested */
@@ -1234,11 +1176,13 @@ int snd_usb_select_mode_quirk(struct snd_usb_substream *subs,
 
 void snd_usb_endpoint_start_quirk(struct snd_usb_endpoint *ep)
 {
+	unsigned int flags = ep->chip->quirk_flags;
+
 	/*
 	 * "Playback Design" products send bogus feedback data at the start
 	 * of the stream. Ignore them.
 	 */
-	if (USB_ID_VENDOR(ep->chip->usb_id) == 0x23ba &&
+	if ((flags & QUIRK_FLAG_START_SKIP_SYNC) &&
 	    ep->type == SND_USB_ENDPOINT_TYPE_SYNC)
 		ep->skip_packets = 4;
 
@@ -1249,15 +1193,12 @@ void snd_usb_endpoint_start_quirk(struct snd_usb_endpoint *ep)
 	 * start up, the real world latency is stable within +/- 1 frame (also
 	 * across power cycles).
 	 */
-	if ((ep->chip->usb_id == USB_ID(0x0763, 0x2030) ||
-	     ep->chip->usb_id == USB_ID(0x0763, 0x2031)) &&
+	if ((flags & QUIRK_FLAG_START_SKIP_DATA) &&
 	    ep->type == SND_USB_ENDPOINT_TYPE_DATA)
 		ep->skip_packets = 16;
 
 	/* Work around devices that report unreasonable feedback data */
-	if ((ep->chip->usb_id == USB_ID(0x0644, 0x8038) ||  /* TEAC UD-H01 */
-	     ep->chip->usb_id == USB_ID(0x1852, 0x5034)) && /* T+A Dac8 */
-	    ep->syncmaxsize == 4)
+	if ((flags & QUIRK_FLAG_TENOR_FB) && ep->syncmaxsize == 4)
 		ep->tenor_fb_quirk = 1;
 }
 
@@ -1268,15 +1209,11 @@ void snd_usb_set_interface_quirk(struct usb_device *dev)
 	if (!chip)
 		return;
 	/*
-	 * "Playback Design" products need a 50ms delay after setting the
-	 * USB interface.
+	 * "Playback Design" and TEAC products need a 50ms delay after
+	 * setting the USB interface.
 	 */
-	switch (USB_ID_VENDOR(chip->usb_id)) {
-	case 0x23ba: /* Playback Design */
-	case 0x0644: /* TEAC Corp. */
+	if (chip->quirk_flags & QUIRK_FLAG_IFACE_DELAY)
 		mdelay(50);
-		break;
-	}
 }
 
 /* quirk applied after snd_usb_ctl_msg(); not applied during boot quirks */
@@ -1286,39 +1223,21 @@ void snd_usb_ctl_msg_quirk(struct usb_device *dev, unsigned int pipe,
 {
 	struct snd_usb_audio *chip = dev_get_drvdata(&dev->dev);
 
-	if (!chip)
+	if (!chip || (requesttype & USB_TYPE_MASK) != USB_TYPE_CLASS)
 		return;
 	/*
-	 * "Playback Design" products need a 20ms delay after each
-	 * class compliant request
-	 */
-	if (USB_ID_VENDOR(chip->usb_id) == 0x23ba &&
-	    (requesttype & USB_TYPE_MASK) == USB_TYPE_CLASS)
-		mdelay(20);
-
-	/*
-	 * "TEAC Corp." products need a 20ms delay after each
-	 * class compliant request
+	 * "Playback Design", "TEAC Corp." and Marantz/Denon devices with
+	 * USB DAC functionality need a 20ms delay after each class
+	 * compliant request
 	 */
-	if (USB_ID_VENDOR(chip->usb_id) == 0x0644 &&
-	    (requesttype & USB_TYPE_MASK) == USB_TYPE_CLASS)
-		mdelay(20);
-
-	/* Marantz/Denon devices with USB DAC functionality need a delay
-	 * after each class compliant request
-	 */
-	if (is_marantz_denon_dac(chip->usb_id)
-	    && (requesttype & USB_TYPE_MASK) == USB_TYPE_CLASS)
+	if (chip->quirk_flags & QUIRK_FLAG_CTL_MSG_DELAY)
 		mdelay(20);
 
 	/* Zoom R16/24, Logitech H650e, Jabra 550a needs a tiny delay here,
 	 * otherwise requests like get/set frequency return as failed despite
 	 * actually succeeding.
 	 */
-	if ((chip->usb_id == USB_ID(0x1686, 0x00dd) ||
-	     chip->usb_id == USB_ID(0x046d, 0x0a46) ||
-	     chip->usb_id == USB_ID(0x0b0e, 0x0349)) &&
-	    (requesttype & USB_TYPE_MASK) == USB_TYPE_CLASS)
+	if (chip->quirk_flags & QUIRK_FLAG_CTL_MSG_DELAY_1M)
 		mdelay(1);
 }
 
@@ -1392,16 +1311,106 @@ u64 snd_usb_interface_dsd_format_quirks(struct snd_usb_audio *chip,
 	}
 
 	/* Denon/Marantz devices with USB DAC functionality */
-	if (is_marantz_denon_dac(chip->usb_id)) {
+	if (chip->quirk_flags & QUIRK_FLAG_DSD_MARANTZ) {
 		if (fp->altsetting == 2)
 			return SNDRV_PCM_FMTBIT_DSD_U32_BE;
 	}
 
 	/* TEAC devices with USB DAC functionality */
-	if (is_teac_50X_dac(chip->usb_id)) {
+	if (chip->quirk_flags & QUIRK_FLAG_DSD_TEAC) {
 		if (fp->altsetting == 3)
 			return SNDRV_PCM_FMTBIT_DSD_U32_BE;
 	}
 
 	return 0;
 }
+
+/*
+ * quirk flags table, resolved once per device at probe; an entry with a
+ * zero product ID applies to all devices of the vendor, and the flags of
+ * all matching entries are combined
+ */
+struct usb_audio_quirk_flags_table {
+	u32 id;
+	unsigned int flags;
+};
+
+#define DEVICE_FLG(vid, pid, _flags) \
+	{ .id = USB_ID(vid, pid), .flags = (_flags) }
+#define VENDOR_FLG(vid, _flags) DEVICE_FLG(vid, 0, _flags)
+
+static const struct usb_audio_quirk_flags_table quirk_flags_table[] = {
+	/* devices which do not support reading the sample rate */
+	DEVICE_FLG(0x041e, 0x4080, QUIRK_FLAG_GET_SAMPLE_RATE), /* Creative Live Cam VF0610 */
+	DEVICE_FLG(0x045e, 0x075d, QUIRK_FLAG_GET_SAMPLE_RATE), /* MS Lifecam Cinema */
+	DEVICE_FLG(0x045e, 0x076d, QUIRK_FLAG_GET_SAMPLE_RATE), /* MS Lifecam HD-5000 */
+	DEVICE_FLG(0x045e, 0x076e, QUIRK_FLAG_GET_SAMPLE_RATE), /* MS Lifecam HD-5001 */
+	DEVICE_FLG(0x045e, 0x076f, QUIRK_FLAG_GET_SAMPLE_RATE), /* MS Lifecam HD-6000 */
+	DEVICE_FLG(0x045e, 0x0772, QUIRK_FLAG_GET_SAMPLE_RATE), /* MS Lifecam Studio */
+	DEVICE_FLG(0x045e, 0x0779, QUIRK_FLAG_GET_SAMPLE_RATE), /* MS Lifecam HD-3000 */
+	DEVICE_FLG(0x047f, 0x02f7, QUIRK_FLAG_GET_SAMPLE_RATE), /* Plantronics BT-600 */
+	DEVICE_FLG(0x047f, 0x0415, QUIRK_FLAG_GET_SAMPLE_RATE), /* Plantronics BT-300 */
+	DEVICE_FLG(0x047f, 0xaa05, QUIRK_FLAG_GET_SAMPLE_RATE), /* Plantronics DA45 */
+	DEVICE_FLG(0x047f, 0xc022, QUIRK_FLAG_GET_SAMPLE_RATE), /* Plantronics C310 */
+	DEVICE_FLG(0x047f, 0xc02f, QUIRK_FLAG_GET_SAMPLE_RATE), /* Plantronics P610 */
+	DEVICE_FLG(0x047f, 0xc036, QUIRK_FLAG_GET_SAMPLE_RATE), /* Plantronics C520-M */
+	DEVICE_FLG(0x04d8, 0xfeea, QUIRK_FLAG_GET_SAMPLE_RATE), /* Benchmark DAC1 Pre */
+	DEVICE_FLG(0x0556, 0x0014, QUIRK_FLAG_GET_SAMPLE_RATE), /* Phoenix Audio TMX320VC */
+	DEVICE_FLG(0x05a3, 0x9420, QUIRK_FLAG_GET_SAMPLE_RATE), /* ELP HD USB Camera */
+	DEVICE_FLG(0x074d, 0x3553, QUIRK_FLAG_GET_SAMPLE_RATE), /* Outlaw RR2150 (Micronas UAC3553B) */
+	DEVICE_FLG(0x1395, 0x740a, QUIRK_FLAG_GET_SAMPLE_RATE), /* Sennheiser DECT */
+	DEVICE_FLG(0x1901, 0x0191, QUIRK_FLAG_GET_SAMPLE_RATE), /* GE B850V3 CP2114 audio interface */
+	DEVICE_FLG(0x1de7, 0x0013, QUIRK_FLAG_GET_SAMPLE_RATE), /* Phoenix Audio MT202exe */
+	DEVICE_FLG(0x1de7, 0x0014, QUIRK_FLAG_GET_SAMPLE_RATE), /* Phoenix Audio TMX320 */
+	DEVICE_FLG(0x1de7, 0x0114, QUIRK_FLAG_GET_SAMPLE_RATE), /* Phoenix Audio MT202pcs */
+	DEVICE_FLG(0x21b4, 0x0081, QUIRK_FLAG_GET_SAMPLE_RATE), /* AudioQuest DragonFly */
+
+	/* E-Mu devices setting up the rate through the vendor controls */
+	DEVICE_FLG(0x041e, 0x3f02, QUIRK_FLAG_EMU_FORMAT), /* E-Mu 0202 USB */
+	DEVICE_FLG(0x041e, 0x3f04, QUIRK_FLAG_EMU_FORMAT), /* E-Mu 0404 USB */
+	DEVICE_FLG(0x041e, 0x3f0a, QUIRK_FLAG_EMU_FORMAT), /* E-Mu Tracker Pre */
+	DEVICE_FLG(0x041e, 0x3f19, QUIRK_FLAG_EMU_FORMAT), /* E-Mu 0204 USB */
+
+	/* devices needing a delay after each class request */
+	DEVICE_FLG(0x046d, 0x0a46, QUIRK_FLAG_CTL_MSG_DELAY_1M), /* Logitech H650e */
+	DEVICE_FLG(0x0b0e, 0x0349, QUIRK_FLAG_CTL_MSG_DELAY_1M), /* Jabra 550a */
+	DEVICE_FLG(0x1686, 0x00dd, QUIRK_FLAG_CTL_MSG_DELAY_1M), /* Zoom R16/24 */
+	VENDOR_FLG(0x0644, /* TEAC Corp. */
+		   QUIRK_FLAG_CTL_MSG_DELAY | QUIRK_FLAG_IFACE_DELAY),
+	VENDOR_FLG(0x23ba, /* Playback Design */
+		   QUIRK_FLAG_CTL_MSG_DELAY | QUIRK_FLAG_IFACE_DELAY |
+		   QUIRK_FLAG_START_SKIP_SYNC),
+
+	/* Marantz/Denon and TEAC DACs switching between PCM and DSD */
+	DEVICE_FLG(0x154e, 0x1003, /* Denon DA-300USB */
+		   QUIRK_FLAG_DSD_MARANTZ | QUIRK_FLAG_CTL_MSG_DELAY),
+	DEVICE_FLG(0x154e, 0x3005, /* Marantz HD-DAC1 */
+		   QUIRK_FLAG_DSD_MARANTZ | QUIRK_FLAG_CTL_MSG_DELAY),
+	DEVICE_FLG(0x154e, 0x3006, /* Marantz SA-14S1 */
+		   QUIRK_FLAG_DSD_MARANTZ | QUIRK_FLAG_CTL_MSG_DELAY),
+	DEVICE_FLG(0x0644, 0x8043, QUIRK_FLAG_DSD_TEAC), /* TEAC UD-501/UD-503/NT-503 */
+
+	/* devices reporting unreasonable feedback data */
+	DEVICE_FLG(0x0644, 0x8038, QUIRK_FLAG_TENOR_FB), /* TEAC UD-H01 */
+	DEVICE_FLG(0x1852, 0x5034, QUIRK_FLAG_TENOR_FB), /* T+A Dac8 */
+
+	/* devices that need the first packets skipped at start */
+	DEVICE_FLG(0x0763, 0x2030, QUIRK_FLAG_START_SKIP_DATA), /* M-Audio Fast Track C400 */
+	DEVICE_FLG(0x0763, 0x2031, QUIRK_FLAG_START_SKIP_DATA), /* M-Audio Fast Track C600 */
+};
+
+void snd_usb_init_quirk_flags(struct snd_usb_audio *chip)
+{
+	const struct usb_audio_quirk_flags_table *p;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(quirk_flags_table); i++) {
+		p = &quirk_flags_table[i];
+		if (p->id == chip->usb_id ||
+		    (!USB_ID_PRODUCT(p->id) &&
+		     USB_ID_VENDOR(p->id) == USB_ID_VENDOR(chip->usb_id)))
+			chip->quirk_flags |= p->flags;
+	}
+	if (chip->quirk_flags)
+		usb_audio_dbg(chip, "quirk flags 0x%x\n", chip->quirk_flags);
+}
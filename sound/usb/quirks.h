@@ -6,6 +6,8 @@ struct audioformat;
 struct snd_usb_endpoint;
 struct snd_usb_substream;
 
+void snd_usb_init_quirk_flags(struct snd_usb_audio *chip);
+
 int snd_usb_create_quirk(struct snd_usb_audio *chip,
 			 struct usb_interface *iface,
 			 struct usb_driver *driver,
@@ -36,6 +36,7 @@
 #include "format.h"
 #include "clock.h"
 #include "stream.h"
+#include "packets.h"
 
 /*
  * free a substream
@@ -52,6 +53,7 @@ static void free_substream(struct snd_usb_substream *subs)
 		kfree(fp);
 	}
 	kfree(subs->rate_list.list);
+	snd_usb_packets_free(subs);
 }
 
 
@@ -105,6 +107,10 @@ static void snd_usb_init_substream(struct snd_usb_stream *as,
 	subs->ep_num = fp->endpoint;
 	if (fp->channels > subs->channels_max)
 		subs->channels_max = fp->channels;
+
+	/* optional; the stream works without its packet ring */
+	if (as->chip->packet_mmap)
+		snd_usb_packets_alloc(subs);
 }
 
 /* kctl callbacks for usb-audio channel maps */
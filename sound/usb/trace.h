@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * tracepoints for the USB audio endpoints
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM snd_usb_audio
+
+#if !defined(__USBAUDIO_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define __USBAUDIO_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(snd_usb_urb_complete,
+	TP_PROTO(const struct snd_usb_endpoint *ep,
+		 const struct snd_urb_ctx *ctx,
+		 unsigned int interval, unsigned int queued),
+	TP_ARGS(ep, ctx, interval, queued),
+	TP_STRUCT__entry(
+		__field(int, card)
+		__field(unsigned int, ep_num)
+		__field(unsigned int, index)
+		__field(unsigned int, packets)
+		__field(unsigned int, interval)
+		__field(unsigned int, queued)
+	),
+	TP_fast_assign(
+		__entry->card = ep->chip->card->number;
+		__entry->ep_num = ep->ep_num;
+		__entry->index = ctx->index;
+		__entry->packets = ctx->packets;
+		__entry->interval = interval;
+		__entry->queued = queued;
+	),
+	TP_printk("card=%d ep=%#x urb=%u packets=%u interval=%uus queued=%u",
+		  __entry->card, __entry->ep_num, __entry->index,
+		  __entry->packets, __entry->interval, __entry->queued)
+);
+
+TRACE_EVENT(snd_usb_urb_error,
+	TP_PROTO(const struct snd_usb_endpoint *ep,
+		 const struct snd_urb_ctx *ctx, int err),
+	TP_ARGS(ep, ctx, err),
+	TP_STRUCT__entry(
+		__field(int, card)
+		__field(unsigned int, ep_num)
+		__field(unsigned int, index)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__entry->card = ep->chip->card->number;
+		__entry->ep_num = ep->ep_num;
+		__entry->index = ctx->index;
+		__entry->err = err;
+	),
+	TP_printk("card=%d ep=%#x urb=%u err=%d",
+		  __entry->card, __entry->ep_num, __entry->index,
+		  __entry->err)
+);
+
+TRACE_EVENT(snd_usb_silent_urb,
+	TP_PROTO(const struct snd_usb_endpoint *ep,
+		 const struct snd_urb_ctx *ctx, unsigned int frames),
+	TP_ARGS(ep, ctx, frames),
+	TP_STRUCT__entry(
+		__field(int, card)
+		__field(unsigned int, ep_num)
+		__field(unsigned int, index)
+		__field(unsigned int, frames)
+	),
+	TP_fast_assign(
+		__entry->card = ep->chip->card->number;
+		__entry->ep_num = ep->ep_num;
+		__entry->index = ctx->index;
+		__entry->frames = frames;
+	),
+	TP_printk("card=%d ep=%#x urb=%u frames=%u",
+		  __entry->card, __entry->ep_num, __entry->index,
+		  __entry->frames)
+);
+
+TRACE_EVENT(snd_usb_feedback,
+	TP_PROTO(const struct snd_usb_endpoint *ep, unsigned int raw,
+		 unsigned int freq, bool accepted),
+	TP_ARGS(ep, raw, freq, accepted),
+	TP_STRUCT__entry(
+		__field(int, card)
+		__field(unsigned int, ep_num)
+		__field(unsigned int, raw)
+		__field(unsigned int, freq)
+		__field(bool, accepted)
+	),
+	TP_fast_assign(
+		__entry->card = ep->chip->card->number;
+		__entry->ep_num = ep->ep_num;
+		__entry->raw = raw;
+		__entry->freq = freq;
+		__entry->accepted = accepted;
+	),
+	TP_printk("card=%d ep=%#x raw=%#x freq=%#x %s",
+		  __entry->card, __entry->ep_num, __entry->raw,
+		  __entry->freq, __entry->accepted ? "accepted" : "rejected")
+);
+
+#endif /* __USBAUDIO_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __USB_URB_STATS_H
+#define __USB_URB_STATS_H
+
+/*
+ * URB counters, kept per endpoint by snd-usb-audio and by the drivers
+ * running their own URB queues (caiaq, hiface, 6fire).
+ * They are updated from the completion handler without locking and are
+ * read as an approximate snapshot through proc.
+ */
+
+#include <linux/ktime.h>
+#include <linux/string.h>
+#include <sound/info.h>
+
+struct snd_usb_urb_stats {
+	unsigned int urbs;		/* completed urbs */
+	unsigned int late;		/* completions later than 1.5 urb periods */
+	unsigned int interval_max;	/* longest gap between completions in us */
+	unsigned int errors;		/* failed urbs and packets */
+	int last_error;			/* status of the last failure */
+	ktime_t last_complete;
+};
+
+static inline void snd_usb_urb_stats_reset(struct snd_usb_urb_stats *st)
+{
+	memset(st, 0, sizeof(*st));
+}
+
+/* count a completion; period_us is the duration of one urb, if known.
+ * Returns the gap since the previous completion in us, 0 for the first.
+ */
+static inline unsigned int
+snd_usb_urb_stats_complete(struct snd_usb_urb_stats *st,
+			   unsigned int period_us)
+{
+	ktime_t now = ktime_get();
+	unsigned int interval = 0;
+
+	if (st->urbs++) {
+		interval = ktime_us_delta(now, st->last_complete);
+		if (period_us && interval > period_us + period_us / 2)
+			st->late++;
+		if (interval > st->interval_max)
+			st->interval_max = interval;
+	}
+	st->last_complete = now;
+	return interval;
+}
+
+static inline void snd_usb_urb_stats_error(struct snd_usb_urb_stats *st,
+					   int err)
+{
+	st->errors++;
+	st->last_error = err;
+}
+
+static inline void snd_usb_urb_stats_print(struct snd_info_buffer *buffer,
+					   const char *name, unsigned int nurbs,
+					   const struct snd_usb_urb_stats *st)
+{
+	snd_iprintf(buffer, "%s URBs = %u queued, %u completed (%u late, max interval %u us)\n",
+		    name, nurbs, st->urbs, st->late, st->interval_max);
+	if (st->errors)
+		snd_iprintf(buffer, "%s Errors = %u (last %d)\n",
+			    name, st->errors, st->last_error);
+}
+
+#endif /* __USB_URB_STATS_H */
@@ -36,6 +36,7 @@ struct snd_usb_audio {
 	struct snd_card *card;
 	struct usb_interface *pm_intf;
 	u32 usb_id;
+	unsigned int quirk_flags;	/* QUIRK_FLAG_*, resolved at probe */
 	struct mutex mutex;
 	unsigned int autosuspended:1;	
 	atomic_t active;
@@ -59,6 +60,20 @@ struct snd_usb_audio {
 
 	int setup;			/* from the 'device_setup' module param */
 	bool autoclock;			/* from the 'autoclock' module param */
+	bool zerocopy;			/* from the 'zerocopy' module param */
+	bool lowlatency;		/* from the 'lowlatency' module param */
+	bool packet_mmap;		/* from the 'packet_mmap' module param */
+	struct snd_hwdep *packets_hwdep; /* maps the packet rings */
+	unsigned int feedback_filter;	/* from the 'feedback_filter' module param */
+	bool lazy_mixer;		/* from the 'lazy_mixer' module param */
+	bool mixer_cache;		/* from the 'mixer_cache' module param */
+	bool reinit_clock;		/* from the 'reinit_clock' module param */
+	atomic_t clock_gen;		/* bumped at each clock setup */
+	unsigned int max_urbs;		/* URBs per endpoint, at most */
+	unsigned int max_queue;		/* playback queue length in ms, at most */
+	struct kthread_worker *urb_worker; /* URB completions, see 'urb_cpu' */
+	int urb_cpu;			/* CPU of urb_worker, from 'urb_cpu' */
+	int clock_follow;		/* card number to take the clock of, or -1 */
 
 	struct usb_host_interface *ctrl_intf;	/* the audio control interface */
 };
@@ -72,6 +87,22 @@ struct snd_usb_audio {
 #define usb_audio_dbg(chip, fmt, args...) \
 	dev_dbg(&(chip)->dev->dev, fmt, ##args)
 
+/*
+ * Per-device quirks resolved from the USB ID once at probe time by
+ * snd_usb_init_quirk_flags(), so that the streaming and control paths
+ * only need to test a bit
+ */
+#define QUIRK_FLAG_GET_SAMPLE_RATE	(1U << 0)  /* skip reading back the sample rate */
+#define QUIRK_FLAG_CTL_MSG_DELAY	(1U << 1)  /* 20ms delay after class requests */
+#define QUIRK_FLAG_CTL_MSG_DELAY_1M	(1U << 2)  /* 1ms delay after class requests */
+#define QUIRK_FLAG_IFACE_DELAY		(1U << 3)  /* 50ms delay after usb_set_interface() */
+#define QUIRK_FLAG_START_SKIP_SYNC	(1U << 4)  /* drop the first feedback packets */
+#define QUIRK_FLAG_START_SKIP_DATA	(1U << 5)  /* skip data packets at stream start */
+#define QUIRK_FLAG_TENOR_FB		(1U << 6)  /* bogus 4-byte feedback format */
+#define QUIRK_FLAG_DSD_MARANTZ		(1U << 7)  /* Marantz/Denon DSD mode switch */
+#define QUIRK_FLAG_DSD_TEAC		(1U << 8)  /* TEAC DSD mode switch */
+#define QUIRK_FLAG_EMU_FORMAT		(1U << 9)  /* E-Mu sample rate setup */
+
 /*
  * Information about devices with broken descriptors
  */
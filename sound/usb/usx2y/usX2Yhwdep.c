@@ -31,6 +31,9 @@
 #include "usbusx2y.h"
 #include "usX2Yhwdep.h"
 
+/* the loader images of the US-122/224/428 are well below that */
+#define USX2Y_DSP_BUFFER_BYTES	(128 * 1024)
+
 static int snd_us428ctls_vm_fault(struct vm_fault *vmf)
 {
 	unsigned long offset;
@@ -201,20 +204,25 @@ static int snd_usX2Y_hwdep_dsp_load(struct snd_hwdep *hw,
 	int	lret, err = -EINVAL;
 	snd_printdd( "dsp_load %s\n", dsp->name);
 
-	if (access_ok(VERIFY_READ, dsp->image, dsp->length)) {
+	if (!dsp->image || access_ok(VERIFY_READ, dsp->image, dsp->length)) {
 		struct usb_device* dev = priv->dev;
 		char *buf;
 
-		buf = memdup_user(dsp->image, dsp->length);
-		if (IS_ERR(buf))
-			return PTR_ERR(buf);
+		/* an image in the mapped buffer is sent from there */
+		if (dsp->image) {
+			buf = memdup_user(dsp->image, dsp->length);
+			if (IS_ERR(buf))
+				return PTR_ERR(buf);
+		} else
+			buf = hw->dsp_buffer.area;
 
 		err = usb_set_interface(dev, 0, 1);
 		if (err)
 			snd_printk(KERN_ERR "usb_set_interface error \n");
 		else
 			err = usb_bulk_msg(dev, usb_sndbulkpipe(dev, 2), buf, dsp->length, &lret, 6000);
-		kfree(buf);
+		if (dsp->image)
+			kfree(buf);
 	}
 	if (err)
 		return err;
@@ -258,6 +266,9 @@ int usX2Y_hwdep_new(struct snd_card *card, struct usb_device* device)
 	hw->ops.mmap = snd_us428ctls_mmap;
 	hw->ops.poll = snd_us428ctls_poll;
 	hw->exclusive = 1;
+	snd_hwdep_set_dsp_buffer(hw, SNDRV_DMA_TYPE_CONTINUOUS,
+				 snd_dma_continuous_data(GFP_KERNEL),
+				 USX2Y_DSP_BUFFER_BYTES);
 	sprintf(hw->name, "/dev/bus/usb/%03d/%03d", device->bus->busnum, device->devnum);
 	return 0;
 }
@@ -141,7 +141,8 @@ static const struct snd_pcm_hardware had_pcm_hardware = {
 	.info =	(SNDRV_PCM_INFO_INTERLEAVED |
 		SNDRV_PCM_INFO_MMAP |
 		SNDRV_PCM_INFO_MMAP_VALID |
-		SNDRV_PCM_INFO_NO_PERIOD_WAKEUP),
+		SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
+		SNDRV_PCM_INFO_HAS_LINK_ESTIMATED_ATIME),
 	.formats = (SNDRV_PCM_FMTBIT_S16_LE |
 		    SNDRV_PCM_FMTBIT_S24_LE |
 		    SNDRV_PCM_FMTBIT_S32_LE),
@@ -929,6 +930,10 @@ static void had_init_ringbuf(struct snd_pcm_substream *substream,
 	}
 
 	intelhaddata->bd_head = 0; /* reset at head again before starting */
+
+	intelhaddata->periods_done = 0;
+	intelhaddata->period_stamp = 0;
+	intelhaddata->paused_ns = 0;
 }
 
 /* process a bd, advance to the next */
@@ -943,6 +948,9 @@ static void had_advance_ringbuf(struct snd_pcm_substream *substream,
 	/* proceed to next */
 	intelhaddata->pcmbuf_head++;
 	intelhaddata->pcmbuf_head %= num_periods;
+
+	intelhaddata->periods_done++;
+	intelhaddata->period_stamp = ktime_get();
 }
 
 /* process the current BD(s);
@@ -1204,12 +1212,20 @@ static int had_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		/* Enable Audio */
 		had_ack_irqs(intelhaddata); /* FIXME: do we need this? */
 		had_enable_audio(intelhaddata, true);
+		/* restart the position estimate where it was frozen */
+		intelhaddata->period_stamp =
+			ktime_sub_ns(ktime_get(), intelhaddata->paused_ns);
 		break;
 
 	case SNDRV_PCM_TRIGGER_STOP:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 		/* Disable Audio */
 		had_enable_audio(intelhaddata, false);
+		if (intelhaddata->period_stamp)
+			intelhaddata->paused_ns =
+				ktime_to_ns(ktime_sub(ktime_get(),
+						      intelhaddata->period_stamp));
+		intelhaddata->period_stamp = 0;
 		intelhaddata->need_reset = true;
 		break;
 
@@ -1300,6 +1316,55 @@ static snd_pcm_uframes_t had_pcm_pointer(struct snd_pcm_substream *substream)
 	return len;
 }
 
+/*
+ * ALSA PCM get_time_info callback
+ *
+ * The BD length registers only tell how far the DMA has fetched, and the
+ * period interrupt is the only point where the link position is known.
+ * Estimate the link time by interpolating from the last consumed period
+ * at the stream rate, never beyond the end of the current period.
+ */
+static int had_pcm_get_time_info(struct snd_pcm_substream *substream,
+			struct timespec *system_ts, struct timespec *audio_ts,
+			struct snd_pcm_audio_tstamp_config *audio_tstamp_config,
+			struct snd_pcm_audio_tstamp_report *audio_tstamp_report)
+{
+	struct snd_intelhad *intelhaddata = snd_pcm_substream_chip(substream);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	unsigned long flags;
+	u64 frames;
+	s64 elapsed = 0;
+
+	if (audio_tstamp_config->type_requested !=
+	    SNDRV_PCM_AUDIO_TSTAMP_TYPE_LINK_ESTIMATED) {
+		audio_tstamp_report->actual_type =
+			SNDRV_PCM_AUDIO_TSTAMP_TYPE_DEFAULT;
+		return 0;
+	}
+
+	spin_lock_irqsave(&intelhaddata->had_spinlock, flags);
+	snd_pcm_gettime(runtime, system_ts);
+	if (intelhaddata->period_stamp)
+		elapsed = ktime_to_ns(ktime_sub(ktime_get(),
+						intelhaddata->period_stamp));
+	else
+		elapsed = intelhaddata->paused_ns;
+	frames = intelhaddata->periods_done * runtime->period_size;
+	spin_unlock_irqrestore(&intelhaddata->had_spinlock, flags);
+
+	if (elapsed > 0)
+		frames += min_t(u64, div_u64((u64)elapsed * runtime->rate,
+					     NSEC_PER_SEC),
+				runtime->period_size);
+
+	*audio_ts = ns_to_timespec(div_u64(frames * NSEC_PER_SEC,
+					   runtime->rate));
+	audio_tstamp_report->actual_type =
+		SNDRV_PCM_AUDIO_TSTAMP_TYPE_LINK_ESTIMATED;
+	audio_tstamp_report->accuracy_report = 0;
+	return 0;
+}
+
 /*
  * ALSA PCM mmap callback
  */
@@ -1324,6 +1389,7 @@ static const struct snd_pcm_ops had_pcm_ops = {
 	.prepare =	had_pcm_prepare,
 	.trigger =	had_pcm_trigger,
 	.pointer =	had_pcm_pointer,
+	.get_time_info = had_pcm_get_time_info,
 	.mmap =		had_pcm_mmap,
 };
 
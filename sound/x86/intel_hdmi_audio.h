@@ -123,6 +123,11 @@ struct snd_intelhad {
 	unsigned int num_bds;		/* number of BDs */
 	unsigned int period_bytes;	/* PCM period size in bytes */
 
+	/* estimated link position, interpolated between period updates */
+	u64 periods_done;		/* periods consumed since prepare */
+	ktime_t period_stamp;		/* when the last period was consumed */
+	s64 paused_ns;			/* progress into the period at pause */
+
 	/* internal stuff */
 	union aud_cfg aud_config;	/* AUD_CONFIG reg value cache */
 	struct work_struct hdmi_audio_wq;
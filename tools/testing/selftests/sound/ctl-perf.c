@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Control performance test: ELEM_LIST, ELEM_INFO, ELEM_READ and ELEM_WRITE
+ * throughput on a snd-dummy card made large with user controls, each of
+ * which holds a set of elements.
+ */
+
+#include "sound_perf.h"
+
+#define USER_CONTROLS	32	/* MAX_USER_CONTROLS of the core */
+#define USER_ELEMENTS	64	/* elements per user control */
+#define ROUNDS		20
+
+static int ctl_fd;
+static unsigned int user_controls;
+
+static void user_control_id(struct snd_ctl_elem_id *id, unsigned int i)
+{
+	memset(id, 0, sizeof(*id));
+	id->iface = SNDRV_CTL_ELEM_IFACE_MIXER;
+	snprintf((char *)id->name, sizeof(id->name), "Perf Synthetic %u", i);
+}
+
+static int add_user_controls(void)
+{
+	struct snd_ctl_elem_info info;
+	unsigned int i;
+
+	for (i = 0; i < USER_CONTROLS; i++) {
+		memset(&info, 0, sizeof(info));
+		user_control_id(&info.id, i);
+		/* left over by an interrupted run */
+		ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_REMOVE, &info.id);
+		info.type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+		info.access = SNDRV_CTL_ELEM_ACCESS_READWRITE;
+		info.count = 2;
+		info.value.integer.min = 0;
+		info.value.integer.max = 100;
+		info.value.integer.step = 1;
+		info.owner = USER_ELEMENTS;
+		if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_ADD, &info) < 0)
+			break;	/* the card limit is shared with others */
+		user_controls++;
+	}
+	return user_controls ? 0 : -errno;
+}
+
+static void remove_user_controls(void)
+{
+	struct snd_ctl_elem_id id;
+	unsigned int i;
+
+	for (i = 0; i < user_controls; i++) {
+		user_control_id(&id, i);
+		ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_REMOVE, &id);
+	}
+}
+
+static struct snd_ctl_elem_id *list_elems(unsigned int *count)
+{
+	struct snd_ctl_elem_list list;
+	struct snd_ctl_elem_id *ids;
+
+	memset(&list, 0, sizeof(list));
+	if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) < 0)
+		return NULL;
+	ids = calloc(list.count, sizeof(*ids));
+	if (!ids)
+		ksft_exit_fail_msg("out of memory\n");
+	list.space = list.count;
+	list.pids = ids;
+	if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) < 0) {
+		free(ids);
+		return NULL;
+	}
+	*count = list.used;
+	return ids;
+}
+
+static void test_list(unsigned int count)
+{
+	struct snd_ctl_elem_list list;
+	struct snd_ctl_elem_id *ids;
+	long long t;
+	int i;
+
+	ids = calloc(count, sizeof(*ids));
+	if (!ids)
+		ksft_exit_fail_msg("out of memory\n");
+	t = perf_now();
+	for (i = 0; i < ROUNDS; i++) {
+		memset(&list, 0, sizeof(list));
+		list.space = count;
+		list.pids = ids;
+		if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) < 0) {
+			ksft_test_result_fail("ctl elem list: %s\n",
+					      strerror(errno));
+			free(ids);
+			return;
+		}
+	}
+	perf_report_rate("ctl.elem_list", (unsigned long long)ROUNDS * count,
+			 perf_now() - t);
+	ksft_test_result_pass("ctl elem list\n");
+	free(ids);
+}
+
+static void test_info(const struct snd_ctl_elem_id *ids, unsigned int count)
+{
+	struct snd_ctl_elem_info info;
+	unsigned int i, r;
+	long long t;
+
+	t = perf_now();
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < count; i++) {
+			memset(&info, 0, sizeof(info));
+			info.id.numid = ids[i].numid;
+			if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_INFO, &info) < 0) {
+				ksft_test_result_fail("ctl elem info: %s\n",
+						      strerror(errno));
+				return;
+			}
+		}
+	}
+	perf_report_rate("ctl.elem_info", (unsigned long long)ROUNDS * count,
+			 perf_now() - t);
+	ksft_test_result_pass("ctl elem info\n");
+}
+
+static void test_read(const struct snd_ctl_elem_id *ids, unsigned int count)
+{
+	struct snd_ctl_elem_value *val;
+	unsigned int i, r;
+	long long t;
+
+	val = malloc(sizeof(*val));
+	if (!val)
+		ksft_exit_fail_msg("out of memory\n");
+	t = perf_now();
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < count; i++) {
+			memset(val, 0, sizeof(*val));
+			val->id.numid = ids[i].numid;
+			if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_READ, val) < 0 &&
+			    errno != EPERM) {	/* write-only elements */
+				ksft_test_result_fail("ctl elem read: %s\n",
+						      strerror(errno));
+				goto out;
+			}
+		}
+	}
+	perf_report_rate("ctl.elem_read", (unsigned long long)ROUNDS * count,
+			 perf_now() - t);
+	ksft_test_result_pass("ctl elem read\n");
+ out:
+	free(val);
+}
+
+/* writes of the user elements, changing the value each time */
+static void test_write(void)
+{
+	struct snd_ctl_elem_value *val;
+	unsigned int i, r, n = 0;
+	long long t;
+
+	val = malloc(sizeof(*val));
+	if (!val)
+		ksft_exit_fail_msg("out of memory\n");
+	t = perf_now();
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < user_controls * USER_ELEMENTS; i++) {
+			memset(val, 0, sizeof(*val));
+			user_control_id(&val->id, i / USER_ELEMENTS);
+			val->id.index = i % USER_ELEMENTS;
+			val->value.integer.value[0] = r % 100;
+			val->value.integer.value[1] = r % 100;
+			if (ioctl(ctl_fd, SNDRV_CTL_IOCTL_ELEM_WRITE, val) < 0) {
+				ksft_test_result_fail("ctl elem write: %s\n",
+						      strerror(errno));
+				goto out;
+			}
+			n++;
+		}
+	}
+	perf_report_rate("ctl.elem_write", n, perf_now() - t);
+	ksft_test_result_pass("ctl elem write\n");
+ out:
+	free(val);
+}
+
+int main(void)
+{
+	struct snd_ctl_elem_id *ids;
+	unsigned int count;
+	char path[32];
+	int card, err;
+
+	ksft_print_header();
+	card = perf_find_card("Dummy");
+	if (card < 0)
+		ksft_exit_skip("no Dummy card\n");
+	snprintf(path, sizeof(path), "/dev/snd/controlC%d", card);
+	ctl_fd = open(path, O_RDWR);
+	if (ctl_fd < 0)
+		ksft_exit_fail_msg("%s: %s\n", path, strerror(errno));
+
+	err = add_user_controls();
+	if (err < 0)
+		ksft_exit_fail_msg("no user control: %s\n", strerror(-err));
+	ids = list_elems(&count);
+	if (!ids) {
+		remove_user_controls();
+		ksft_exit_fail_msg("elem list: %s\n", strerror(errno));
+	}
+	ksft_print_msg("perf ctl.elems count=%u unit=elements\n", count);
+
+	test_list(count);
+	test_info(ids, count);
+	test_read(ids, count);
+	test_write();
+
+	free(ids);
+	remove_user_controls();
+	close(ctl_fd);
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PCM hot path cost: plays silence on device 0 of the first card of the
+ * given driver and reports the CPU cycles per call of the paths counted
+ * in the "stats" proc file of the substream (CONFIG_SND_PCM_STATS):
+ * snd_pcm_period_elapsed(), snd_pcm_update_hw_ptr0(), the read/write
+ * transfers and poll, as well as the cycles spent per period.
+ *
+ *	pcm-cycles <driver> [rate] [channels] [period frames]
+ *
+ * The driver is "Dummy" (snd-dummy) or "Loopback" (snd-aloop); the
+ * defaults are 48000Hz, 2 channels and 480 frames.
+ */
+
+#include <limits.h>
+#include <poll.h>
+
+#include "sound_perf.h"
+
+#define PERIODS		4
+#define RUN_PERIODS	500
+
+static unsigned int rate = 48000;
+static unsigned int channels = 2;
+static unsigned int period_frames = 480;
+
+static void params_set_mask(struct snd_pcm_hw_params *p, int var,
+			    unsigned int val)
+{
+	struct snd_mask *m = &p->masks[var - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+
+	memset(m, 0, sizeof(*m));
+	m->bits[val >> 5] |= 1U << (val & 31);
+}
+
+static void params_set_int(struct snd_pcm_hw_params *p, int var,
+			   unsigned int val)
+{
+	struct snd_interval *i =
+		&p->intervals[var - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+
+	i->min = i->max = val;
+	i->integer = 1;
+}
+
+static int pcm_setup(int fd)
+{
+	struct snd_pcm_hw_params hw;
+	struct snd_pcm_sw_params sw;
+	int i;
+
+	memset(&hw, 0, sizeof(hw));
+	for (i = 0; i <= SNDRV_PCM_HW_PARAM_LAST_MASK - SNDRV_PCM_HW_PARAM_FIRST_MASK; i++)
+		memset(&hw.masks[i], 0xff, sizeof(hw.masks[i]));
+	for (i = 0; i <= SNDRV_PCM_HW_PARAM_LAST_INTERVAL - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL; i++)
+		hw.intervals[i].max = UINT_MAX;
+	hw.rmask = ~0U;
+	params_set_mask(&hw, SNDRV_PCM_HW_PARAM_ACCESS,
+			SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+	params_set_mask(&hw, SNDRV_PCM_HW_PARAM_FORMAT, SNDRV_PCM_FORMAT_S16_LE);
+	params_set_int(&hw, SNDRV_PCM_HW_PARAM_CHANNELS, channels);
+	params_set_int(&hw, SNDRV_PCM_HW_PARAM_RATE, rate);
+	params_set_int(&hw, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, period_frames);
+	params_set_int(&hw, SNDRV_PCM_HW_PARAM_PERIODS, PERIODS);
+	if (ioctl(fd, SNDRV_PCM_IOCTL_HW_PARAMS, &hw) < 0)
+		return -1;
+
+	memset(&sw, 0, sizeof(sw));
+	sw.proto = SNDRV_PCM_VERSION;
+	sw.period_step = 1;
+	sw.avail_min = period_frames;
+	sw.start_threshold = period_frames * PERIODS;
+	sw.stop_threshold = period_frames * PERIODS;
+	if (ioctl(fd, SNDRV_PCM_IOCTL_SW_PARAMS, &sw) < 0 ||
+	    ioctl(fd, SNDRV_PCM_IOCTL_PREPARE) < 0)
+		return -1;
+	return 0;
+}
+
+/* write one period, restarting the stream after an xrun */
+static int pcm_write_period(int fd, void *buf)
+{
+	struct snd_xferi xfer = {
+		.buf = buf,
+		.frames = period_frames,
+	};
+
+	if (!ioctl(fd, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &xfer))
+		return 0;
+	if (errno != EPIPE || ioctl(fd, SNDRV_PCM_IOCTL_PREPARE) < 0)
+		return -1;
+	return ioctl(fd, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &xfer);
+}
+
+static int pcm_run(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+	void *buf;
+	int i, err = -1;
+
+	buf = calloc(period_frames, channels * 2);
+	if (!buf)
+		ksft_exit_fail_msg("out of memory\n");
+	for (i = 0; i < PERIODS + RUN_PERIODS; i++) {
+		if (i >= PERIODS && poll(&pfd, 1, 1000) <= 0)
+			goto out;
+		if (pcm_write_period(fd, buf) < 0)
+			goto out;
+	}
+	err = 0;
+ out:
+	ioctl(fd, SNDRV_PCM_IOCTL_DROP);
+	free(buf);
+	return err;
+}
+
+/* print the cost lines of the stats file as perf metrics */
+static int report_stats(FILE *f, const char *tag)
+{
+	unsigned long long calls, cycles, avg, per_period;
+	char line[256], name[32];
+	int found = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "cost_%31[a-z_]: calls %llu cycles %llu avg %llu",
+			   name, &calls, &cycles, &avg) == 4) {
+			ksft_print_msg("perf pcm.cycles.%s.%s calls=%llu total=%llu avg=%llu unit=cycles\n",
+				       tag, name, calls, cycles, avg);
+			found++;
+		}
+		if (sscanf(line, "cycles_per_period: %llu", &per_period) == 1) {
+			ksft_print_msg("perf pcm.cycles.%s.per_period value=%llu unit=cycles\n",
+				       tag, per_period);
+			found++;
+		}
+	}
+	return found ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *driver = argc > 1 ? argv[1] : "Dummy";
+	struct snd_pcm_info info;
+	char path[64], tag[64];
+	FILE *stats;
+	int card, fd, err;
+
+	if (argc > 2)
+		rate = atoi(argv[2]);
+	if (argc > 3)
+		channels = atoi(argv[3]);
+	if (argc > 4)
+		period_frames = atoi(argv[4]);
+
+	ksft_print_header();
+	card = perf_find_card(driver);
+	if (card < 0)
+		ksft_exit_skip("no %s card\n", driver);
+	snprintf(path, sizeof(path), "/dev/snd/pcmC%dD0p", card);
+	fd = open(path, O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+		ksft_exit_fail_msg("%s: %s\n", path, strerror(errno));
+	memset(&info, 0, sizeof(info));
+	if (ioctl(fd, SNDRV_PCM_IOCTL_INFO, &info) < 0)
+		ksft_exit_fail_msg("pcm info: %s\n", strerror(errno));
+
+	snprintf(path, sizeof(path), "/proc/asound/card%d/pcm0p/sub%u/stats",
+		 card, info.subdevice);
+	if (access(path, W_OK) < 0)
+		ksft_exit_skip("%s: %s (CONFIG_SND_PCM_STATS=n?)\n", path,
+			       strerror(errno));
+	snprintf(tag, sizeof(tag), "%s.%u.%u.%u", driver, rate, channels,
+		 period_frames);
+	ksft_print_msg("%s at %uHz, %u channels, %u frames per period\n",
+		       driver, rate, channels, period_frames);
+
+	if (pcm_setup(fd) < 0) {
+		ksft_test_result_skip("pcm cycles %s: %s\n", tag, strerror(errno));
+		goto out;
+	}
+	/* clear the counters, which happens when the file is closed */
+	stats = fopen(path, "w");
+	if (!stats || fputs("0\n", stats) < 0 || fclose(stats))
+		goto error;
+	if (pcm_run(fd) < 0)
+		goto error;
+	stats = fopen(path, "r");
+	if (!stats)
+		goto error;
+	err = report_stats(stats, tag);
+	fclose(stats);
+	if (err < 0)
+		ksft_test_result_fail("pcm cycles %s: no cost counters\n", tag);
+	else
+		ksft_test_result_pass("pcm cycles %s\n", tag);
+	goto out;
+
+ error:
+	ksft_test_result_fail("pcm cycles %s: %s\n", tag, strerror(errno));
+ out:
+	close(fd);
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PCM performance test: open, HW_REFINE and HW_PARAMS latencies, status
+ * reads through SYNC_PTR and through the mmapped status page, and the
+ * wakeup jitter of poll() on a running playback stream.
+ *
+ * Runs on device 0 of the first card of the given driver, "Dummy" by
+ * default (snd-dummy); "Loopback" selects snd-aloop.
+ */
+
+#include <limits.h>
+#include <poll.h>
+#include <sys/mman.h>
+
+#include "sound_perf.h"
+
+#define ITERATIONS	1000
+#define RATE		48000
+#define PERIOD_FRAMES	480	/* 10ms */
+#define PERIODS		4
+#define POLL_PERIODS	300
+
+static char pcm_path[32];
+static const char *driver = "Dummy";
+
+static int pcm_open(void)
+{
+	return open(pcm_path, O_RDWR | O_NONBLOCK);
+}
+
+static void params_any(struct snd_pcm_hw_params *p)
+{
+	int i;
+
+	memset(p, 0, sizeof(*p));
+	for (i = 0; i <= SNDRV_PCM_HW_PARAM_LAST_MASK - SNDRV_PCM_HW_PARAM_FIRST_MASK; i++)
+		memset(&p->masks[i], 0xff, sizeof(p->masks[i]));
+	for (i = 0; i <= SNDRV_PCM_HW_PARAM_LAST_INTERVAL - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL; i++) {
+		p->intervals[i].min = 0;
+		p->intervals[i].max = UINT_MAX;
+	}
+	p->rmask = ~0U;
+	p->info = ~0U;
+}
+
+static void params_set_mask(struct snd_pcm_hw_params *p, int var,
+			    unsigned int val)
+{
+	struct snd_mask *m = &p->masks[var - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+
+	memset(m, 0, sizeof(*m));
+	m->bits[val >> 5] |= 1U << (val & 31);
+}
+
+static void params_set_int(struct snd_pcm_hw_params *p, int var,
+			   unsigned int val)
+{
+	struct snd_interval *i =
+		&p->intervals[var - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+
+	i->min = i->max = val;
+	i->integer = 1;
+}
+
+static void params_setup(struct snd_pcm_hw_params *p)
+{
+	params_any(p);
+	params_set_mask(p, SNDRV_PCM_HW_PARAM_ACCESS,
+			SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+	params_set_mask(p, SNDRV_PCM_HW_PARAM_FORMAT, SNDRV_PCM_FORMAT_S16_LE);
+	params_set_int(p, SNDRV_PCM_HW_PARAM_CHANNELS, 2);
+	params_set_int(p, SNDRV_PCM_HW_PARAM_RATE, RATE);
+	params_set_int(p, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, PERIOD_FRAMES);
+	params_set_int(p, SNDRV_PCM_HW_PARAM_PERIODS, PERIODS);
+}
+
+/* open, configure and prepare a stream; returns the fd or -errno */
+static int pcm_setup(void)
+{
+	struct snd_pcm_hw_params hw;
+	struct snd_pcm_sw_params sw;
+	int fd, err;
+
+	fd = pcm_open();
+	if (fd < 0)
+		return -errno;
+	params_setup(&hw);
+	if (ioctl(fd, SNDRV_PCM_IOCTL_HW_PARAMS, &hw) < 0)
+		goto error;
+
+	memset(&sw, 0, sizeof(sw));
+	sw.proto = SNDRV_PCM_VERSION;
+	sw.period_step = 1;
+	sw.avail_min = PERIOD_FRAMES;
+	sw.start_threshold = PERIOD_FRAMES * PERIODS;
+	sw.stop_threshold = PERIOD_FRAMES * PERIODS;
+	if (ioctl(fd, SNDRV_PCM_IOCTL_SW_PARAMS, &sw) < 0 ||
+	    ioctl(fd, SNDRV_PCM_IOCTL_PREPARE) < 0)
+		goto error;
+	return fd;
+
+ error:
+	err = -errno;
+	close(fd);
+	return err;
+}
+
+static void test_open(void)
+{
+	struct perf_samples open_ns, close_ns;
+	long long t;
+	int i, fd;
+
+	perf_samples_init(&open_ns, ITERATIONS);
+	perf_samples_init(&close_ns, ITERATIONS);
+	for (i = 0; i < ITERATIONS; i++) {
+		t = perf_now();
+		fd = pcm_open();
+		if (fd < 0) {
+			ksft_test_result_fail("pcm open: %s\n", strerror(errno));
+			goto out;
+		}
+		perf_sample(&open_ns, perf_now() - t);
+		t = perf_now();
+		close(fd);
+		perf_sample(&close_ns, perf_now() - t);
+	}
+	ksft_test_result_pass("pcm open\n");
+ out:
+	perf_report("pcm.open", &open_ns);
+	perf_report("pcm.close", &close_ns);
+}
+
+static void test_params(void)
+{
+	struct perf_samples refine_ns, params_ns;
+	struct snd_pcm_hw_params p;
+	long long t;
+	int i, fd;
+
+	fd = pcm_open();
+	if (fd < 0) {
+		ksft_test_result_fail("pcm params: %s\n", strerror(errno));
+		return;
+	}
+	perf_samples_init(&refine_ns, ITERATIONS);
+	perf_samples_init(&params_ns, ITERATIONS);
+	for (i = 0; i < ITERATIONS; i++) {
+		params_any(&p);
+		t = perf_now();
+		if (ioctl(fd, SNDRV_PCM_IOCTL_HW_REFINE, &p) < 0)
+			goto error;
+		perf_sample(&refine_ns, perf_now() - t);
+	}
+	for (i = 0; i < ITERATIONS; i++) {
+		params_setup(&p);
+		t = perf_now();
+		if (ioctl(fd, SNDRV_PCM_IOCTL_HW_PARAMS, &p) < 0)
+			goto error;
+		perf_sample(&params_ns, perf_now() - t);
+		if (ioctl(fd, SNDRV_PCM_IOCTL_HW_FREE) < 0)
+			goto error;
+	}
+	ksft_test_result_pass("pcm params\n");
+	goto out;
+
+ error:
+	ksft_test_result_fail("pcm params: %s\n", strerror(errno));
+ out:
+	perf_report("pcm.hw_refine", &refine_ns);
+	perf_report("pcm.hw_params", &params_ns);
+	close(fd);
+}
+
+/* reading the position with SYNC_PTR versus the mmapped status page */
+static void test_status(void)
+{
+	volatile struct snd_pcm_mmap_status *status;
+	struct snd_pcm_sync_ptr sync;
+	long long t;
+	int i, fd;
+
+	fd = pcm_setup();
+	if (fd < 0) {
+		ksft_test_result_fail("pcm status: %s\n", strerror(-fd));
+		return;
+	}
+
+	t = perf_now();
+	for (i = 0; i < ITERATIONS; i++) {
+		memset(&sync, 0, sizeof(sync));
+		sync.flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+		if (ioctl(fd, SNDRV_PCM_IOCTL_SYNC_PTR, &sync) < 0) {
+			ksft_test_result_fail("pcm sync_ptr: %s\n",
+					      strerror(errno));
+			goto out;
+		}
+	}
+	perf_report_rate("pcm.sync_ptr", ITERATIONS, perf_now() - t);
+	ksft_test_result_pass("pcm sync_ptr\n");
+
+	status = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd,
+		      SNDRV_PCM_MMAP_OFFSET_STATUS);
+	if (status == MAP_FAILED) {
+		/* not available on all architectures */
+		ksft_test_result_skip("pcm mmap status: %s\n", strerror(errno));
+		goto out;
+	}
+	t = perf_now();
+	for (i = 0; i < ITERATIONS * 1000; i++)
+		(void)status->hw_ptr;
+	perf_report_rate("pcm.mmap_status", ITERATIONS * 1000, perf_now() - t);
+	munmap((void *)status, sysconf(_SC_PAGESIZE));
+	ksft_test_result_pass("pcm mmap status\n");
+ out:
+	close(fd);
+}
+
+static int pcm_write_period(int fd, void *buf)
+{
+	struct snd_xferi xfer = {
+		.buf = buf,
+		.frames = PERIOD_FRAMES,
+	};
+
+	return ioctl(fd, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &xfer);
+}
+
+/* fill the buffer, which starts the stream */
+static int pcm_fill(int fd, void *buf)
+{
+	int i;
+
+	for (i = 0; i < PERIODS; i++) {
+		if (pcm_write_period(fd, buf) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* deviation of the poll() wakeups from the period time */
+static void test_poll(void)
+{
+	const long long period_ns = 1000000000LL * PERIOD_FRAMES / RATE;
+	struct perf_samples jitter;
+	struct pollfd pfd;
+	long long t, last = 0;
+	unsigned int xruns = 0;
+	void *buf;
+	int i, fd, err;
+
+	fd = pcm_setup();
+	if (fd < 0) {
+		ksft_test_result_fail("pcm poll: %s\n", strerror(-fd));
+		return;
+	}
+	buf = calloc(PERIOD_FRAMES, 4);
+	if (!buf)
+		ksft_exit_fail_msg("out of memory\n");
+	perf_samples_init(&jitter, POLL_PERIODS);
+
+	if (pcm_fill(fd, buf) < 0)
+		goto error;
+
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
+	for (i = 0; i < POLL_PERIODS; i++) {
+		err = poll(&pfd, 1, 1000);
+		if (err <= 0) {
+			if (!err)
+				errno = ETIMEDOUT;
+			goto error;
+		}
+		t = perf_now();
+		if (last)
+			perf_sample(&jitter, llabs(t - last - period_ns));
+		last = t;
+		if (pcm_write_period(fd, buf) < 0) {
+			if (errno != EPIPE)
+				goto error;
+			xruns++;
+			last = 0;
+			if (ioctl(fd, SNDRV_PCM_IOCTL_PREPARE) < 0 ||
+			    pcm_fill(fd, buf) < 0)
+				goto error;
+		}
+	}
+	ksft_print_msg("perf pcm.poll_xruns count=%u unit=xruns\n", xruns);
+	ksft_test_result_pass("pcm poll\n");
+	goto out;
+
+ error:
+	ksft_test_result_fail("pcm poll: %s\n", strerror(errno));
+ out:
+	perf_report("pcm.poll_jitter", &jitter);
+	free(buf);
+	close(fd);
+}
+
+int main(int argc, char **argv)
+{
+	int card;
+
+	if (argc > 1)
+		driver = argv[1];
+
+	ksft_print_header();
+	card = perf_find_card(driver);
+	if (card < 0)
+		ksft_exit_skip("no %s card\n", driver);
+	snprintf(pcm_path, sizeof(pcm_path), "/dev/snd/pcmC%dD0p", card);
+	ksft_print_msg("%s on %s\n", driver, pcm_path);
+
+	test_open();
+	test_params();
+	test_status();
+	test_poll();
+
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
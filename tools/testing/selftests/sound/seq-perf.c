@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sequencer performance test: dispatch latency and event rate between two
+ * user clients, directly, through the "Midi Through" port of snd-seq-dummy,
+ * and from the rawmidi side of a snd-virmidi device.
+ */
+
+#include <poll.h>
+#include <sound/asequencer.h>
+
+#include "sound_perf.h"
+
+#define EVENTS		1000
+#define BATCH		64
+#define ROUNDS		200
+
+struct seq_client {
+	int fd;
+	int id;
+	int port;
+};
+
+static struct seq_client sender, receiver;
+
+static int seq_open(struct seq_client *c, unsigned int caps)
+{
+	struct snd_seq_port_info port;
+
+	c->fd = open("/dev/snd/seq", O_RDWR | O_NONBLOCK);
+	if (c->fd < 0)
+		return -errno;
+	if (ioctl(c->fd, SNDRV_SEQ_IOCTL_CLIENT_ID, &c->id) < 0)
+		return -errno;
+	memset(&port, 0, sizeof(port));
+	port.addr.client = c->id;
+	snprintf(port.name, sizeof(port.name), "perf");
+	port.capability = caps;
+	port.type = SNDRV_SEQ_PORT_TYPE_APPLICATION;
+	if (ioctl(c->fd, SNDRV_SEQ_IOCTL_CREATE_PORT, &port) < 0)
+		return -errno;
+	c->port = port.addr.port;
+	return 0;
+}
+
+static int seq_connect(int client, int port, int dest_client, int dest_port)
+{
+	struct snd_seq_port_subscribe sub;
+
+	memset(&sub, 0, sizeof(sub));
+	sub.sender.client = client;
+	sub.sender.port = port;
+	sub.dest.client = dest_client;
+	sub.dest.port = dest_port;
+	return ioctl(sender.fd, SNDRV_SEQ_IOCTL_SUBSCRIBE_PORT, &sub);
+}
+
+static int seq_find_client(const char *name, int card)
+{
+	struct snd_seq_client_info info;
+
+	memset(&info, 0, sizeof(info));
+	info.client = -1;
+	while (!ioctl(sender.fd, SNDRV_SEQ_IOCTL_QUERY_NEXT_CLIENT, &info)) {
+		if (name ? !strcmp(info.name, name) : info.card == card)
+			return info.client;
+	}
+	return -1;
+}
+
+/* send events from the sender port to the receiver, or to its subscribers */
+static int seq_send(int subscribers, unsigned int count)
+{
+	struct snd_seq_event ev[BATCH];
+	unsigned int i;
+
+	memset(ev, 0, sizeof(ev));
+	for (i = 0; i < count; i++) {
+		ev[i].type = SNDRV_SEQ_EVENT_USR0;
+		ev[i].flags = SNDRV_SEQ_EVENT_LENGTH_FIXED;
+		ev[i].queue = SNDRV_SEQ_QUEUE_DIRECT;
+		ev[i].source.client = sender.id;
+		ev[i].source.port = sender.port;
+		ev[i].dest.client = subscribers ? SNDRV_SEQ_ADDRESS_SUBSCRIBERS :
+						  receiver.id;
+		ev[i].dest.port = subscribers ? 0 : receiver.port;
+		ev[i].data.raw32.d[0] = i;
+	}
+	if (write(sender.fd, ev, count * sizeof(ev[0])) !=
+	    (ssize_t)(count * sizeof(ev[0])))
+		return -1;
+	return 0;
+}
+
+static int seq_send_direct(unsigned int count)
+{
+	return seq_send(0, count);
+}
+
+static int seq_send_subscribers(unsigned int count)
+{
+	return seq_send(1, count);
+}
+
+/* wait for count events on the receiver */
+static int seq_receive(unsigned int count)
+{
+	struct snd_seq_event ev[BATCH];
+	struct pollfd pfd = { .fd = receiver.fd, .events = POLLIN };
+	unsigned int got = 0;
+	ssize_t len;
+	int err;
+
+	while (got < count) {
+		err = poll(&pfd, 1, 1000);
+		if (err <= 0) {
+			if (!err)
+				errno = ETIMEDOUT;
+			return -1;
+		}
+		len = read(receiver.fd, ev, sizeof(ev));
+		if (len < 0) {
+			if (errno == EAGAIN)
+				continue;
+			return -1;
+		}
+		got += len / sizeof(ev[0]);
+	}
+	return 0;
+}
+
+/*
+ * latency of single events and rate of batches; send() queues count
+ * events on the path being measured
+ */
+static void test_path(const char *name, int (*send)(unsigned int))
+{
+	struct perf_samples latency;
+	char metric[64];
+	long long t;
+	int i;
+
+	perf_samples_init(&latency, EVENTS);
+	for (i = 0; i < EVENTS; i++) {
+		t = perf_now();
+		if (send(1) < 0 || seq_receive(1) < 0)
+			goto error;
+		perf_sample(&latency, perf_now() - t);
+	}
+	snprintf(metric, sizeof(metric), "seq.%s.latency", name);
+	perf_report(metric, &latency);
+
+	t = perf_now();
+	for (i = 0; i < ROUNDS; i++) {
+		if (send(BATCH) < 0 || seq_receive(BATCH) < 0)
+			goto error;
+	}
+	snprintf(metric, sizeof(metric), "seq.%s.events", name);
+	perf_report_rate(metric, (unsigned long long)ROUNDS * BATCH,
+			 perf_now() - t);
+	ksft_test_result_pass("seq %s\n", name);
+	return;
+
+ error:
+	free(latency.val);
+	ksft_test_result_fail("seq %s: %s\n", name, strerror(errno));
+}
+
+static int midi_fd;
+
+/* note-ons written to the virmidi rawmidi device */
+static int midi_send(unsigned int count)
+{
+	unsigned char buf[BATCH * 3];
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		buf[i * 3] = 0x90;
+		buf[i * 3 + 1] = i & 0x7f;
+		buf[i * 3 + 2] = 100;
+	}
+	if (write(midi_fd, buf, count * 3) != (ssize_t)(count * 3))
+		return -1;
+	return 0;
+}
+
+static void test_virmidi(void)
+{
+	char path[32];
+	int card, client;
+
+	card = perf_find_card("VirMIDI");
+	if (card < 0) {
+		ksft_test_result_skip("seq virmidi: no VirMIDI card\n");
+		return;
+	}
+	client = seq_find_client(NULL, card);
+	snprintf(path, sizeof(path), "/dev/snd/midiC%dD0", card);
+	midi_fd = open(path, O_WRONLY);
+	if (client < 0 || midi_fd < 0 ||
+	    seq_connect(client, 0, receiver.id, receiver.port) < 0) {
+		ksft_test_result_fail("seq virmidi: %s\n", strerror(errno));
+		if (midi_fd >= 0)
+			close(midi_fd);
+		return;
+	}
+	test_path("virmidi", midi_send);
+	close(midi_fd);
+}
+
+int main(void)
+{
+	int err, through;
+
+	ksft_print_header();
+	err = seq_open(&sender, SNDRV_SEQ_PORT_CAP_READ |
+			       SNDRV_SEQ_PORT_CAP_SUBS_READ);
+	if (!err)
+		err = seq_open(&receiver, SNDRV_SEQ_PORT_CAP_WRITE |
+					  SNDRV_SEQ_PORT_CAP_SUBS_WRITE);
+	if (err < 0)
+		ksft_exit_skip("/dev/snd/seq: %s\n", strerror(-err));
+	/* blocking writes, the output pool may fill up */
+	fcntl(sender.fd, F_SETFL, 0);
+
+	test_path("direct", seq_send_direct);
+
+	through = seq_find_client("Midi Through", -1);
+	if (through < 0) {
+		ksft_test_result_skip("seq through: no Midi Through client\n");
+	} else if (seq_connect(sender.id, sender.port, through, 0) < 0 ||
+		   seq_connect(through, 0, receiver.id, receiver.port) < 0) {
+		ksft_test_result_fail("seq through: %s\n", strerror(errno));
+	} else {
+		test_path("through", seq_send_subscribers);
+	}
+
+	test_virmidi();
+
+	close(receiver.fd);
+	close(sender.fd);
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Loads the virtual sound drivers and runs the sound performance tests on
+# them.  The results are the "# perf <metric> key=value ..." lines of the
+# output; see sound_perf.h.  The modules loaded here are removed again.
+
+ksft_skip=4
+dir=$(dirname "$0")
+loaded=
+rc=0
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "skip: must be run as root"
+	exit $ksft_skip
+fi
+
+for mod in snd-dummy snd-aloop snd-virmidi snd-seq-dummy snd-hrtimer; do
+	name=$(echo $mod | tr - _)
+	if ! grep -q "^$name " /proc/modules && modprobe $mod 2> /dev/null; then
+		loaded="$name $loaded"
+	fi
+done
+# let udev create the device nodes
+udevadm settle 2> /dev/null
+
+run()
+{
+	echo "# $*"
+	"$dir/$@"
+	ret=$?
+	if [ $ret -ne 0 ] && [ $ret -ne $ksft_skip ]; then
+		rc=1
+	fi
+}
+
+run pcm-perf Dummy
+run pcm-perf Loopback
+# hot path cycles at a common and at a demanding setup; the default
+# snd-dummy model stops at 2 channels and 48kHz
+run pcm-cycles Dummy 48000 2 480
+run pcm-cycles Dummy 48000 2 64
+run pcm-cycles Loopback 48000 2 480
+run pcm-cycles Loopback 192000 8 64
+run ctl-perf
+run timer-perf
+run seq-perf
+
+for name in $loaded; do
+	rmmod $name
+done
+exit $rc
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Helpers shared by the sound performance tests.
+ *
+ * Every measurement is printed as a single TAP comment line,
+ *
+ *	# perf <metric> key=value ... unit=<unit>
+ *
+ * so that a pipeline can grep "^# perf " and compare the values against
+ * a baseline.  Latencies are in ns, with count, min, median, p99 and max;
+ * throughputs have ops, time (ns) and rate (ops/s).
+ */
+#ifndef __SOUND_PERF_H
+#define __SOUND_PERF_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sound/asound.h>
+
+#include "../kselftest.h"
+
+#define PERF_MAX_CARDS	32
+
+static inline long long perf_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct perf_samples {
+	unsigned int count;
+	unsigned int size;
+	long long *val;
+};
+
+static inline void perf_samples_init(struct perf_samples *s, unsigned int size)
+{
+	s->count = 0;
+	s->size = size;
+	s->val = calloc(size, sizeof(*s->val));
+	if (!s->val)
+		ksft_exit_fail_msg("out of memory\n");
+}
+
+static inline void perf_sample(struct perf_samples *s, long long val)
+{
+	if (s->count < s->size)
+		s->val[s->count++] = val;
+}
+
+static inline int perf_cmp(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* print the distribution of the samples and free them */
+static inline void perf_report(const char *metric, struct perf_samples *s)
+{
+	unsigned int n = s->count;
+	long long *v = s->val;
+
+	if (n) {
+		qsort(v, n, sizeof(*v), perf_cmp);
+		ksft_print_msg("perf %s count=%u min=%lld median=%lld p99=%lld max=%lld unit=ns\n",
+			       metric, n, v[0], v[n / 2], v[(n - 1) * 99 / 100],
+			       v[n - 1]);
+	}
+	free(v);
+	s->val = NULL;
+}
+
+static inline void perf_report_rate(const char *metric,
+				    unsigned long long ops, long long ns)
+{
+	ksft_print_msg("perf %s ops=%llu time=%lld rate=%.0f unit=ops/s\n",
+		       metric, ops, ns, ns > 0 ? ops * 1e9 / ns : 0.0);
+}
+
+/* the index of the first card of the given driver, or -1 */
+static inline int perf_find_card(const char *driver)
+{
+	struct snd_ctl_card_info info;
+	char path[32];
+	int card, fd, err;
+
+	for (card = 0; card < PERF_MAX_CARDS; card++) {
+		snprintf(path, sizeof(path), "/dev/snd/controlC%d", card);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		memset(&info, 0, sizeof(info));
+		err = ioctl(fd, SNDRV_CTL_IOCTL_CARD_INFO, &info);
+		close(fd);
+		if (!err && !strcmp((const char *)info.driver, driver))
+			return card;
+	}
+	return -1;
+}
+
+#endif /* __SOUND_PERF_H */
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Timer performance test: event rate and wakeup jitter of the global
+ * ALSA timers, read as tread events.  The period is the whole number of
+ * timer ticks closest below 1ms, and at least one tick: about 1ms on
+ * the hrtimer, but one jiffy (1/HZ) on the system timer when HZ < 1000.
+ */
+
+#include <poll.h>
+
+#include "sound_perf.h"
+
+#define EVENTS		500
+#define PERIOD_NS	1000000
+
+static void test_timer(const char *name, int device)
+{
+	struct snd_timer_select sel;
+	struct snd_timer_info info;
+	struct snd_timer_params params;
+	struct snd_timer_tread ev;
+	struct perf_samples jitter;
+	unsigned long long ticks = 0;
+	long long t, start, last = 0, period;
+	char metric[64];
+	struct pollfd pfd;
+	int fd, one = 1, i, err;
+
+	fd = open("/dev/snd/timer", O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		ksft_exit_skip("/dev/snd/timer: %s\n", strerror(errno));
+
+	memset(&sel, 0, sizeof(sel));
+	sel.id.dev_class = SNDRV_TIMER_CLASS_GLOBAL;
+	sel.id.dev_sclass = SNDRV_TIMER_SCLASS_NONE;
+	sel.id.card = -1;
+	sel.id.device = device;
+	if (ioctl(fd, SNDRV_TIMER_IOCTL_TREAD, &one) < 0 ||
+	    ioctl(fd, SNDRV_TIMER_IOCTL_SELECT, &sel) < 0) {
+		ksft_test_result_skip("timer %s: %s\n", name, strerror(errno));
+		close(fd);
+		return;
+	}
+
+	memset(&info, 0, sizeof(info));
+	if (ioctl(fd, SNDRV_TIMER_IOCTL_INFO, &info) < 0 || !info.resolution)
+		goto error;
+	memset(&params, 0, sizeof(params));
+	params.flags = SNDRV_TIMER_PSFLG_AUTO;
+	params.ticks = PERIOD_NS / info.resolution ? : 1;
+	params.queue_size = 128;
+	params.filter = 1 << SNDRV_TIMER_EVENT_TICK;
+	if (ioctl(fd, SNDRV_TIMER_IOCTL_PARAMS, &params) < 0)
+		goto error;
+	period = (long long)params.ticks * info.resolution;
+
+	perf_samples_init(&jitter, EVENTS);
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	if (ioctl(fd, SNDRV_TIMER_IOCTL_START) < 0)
+		goto error_samples;
+	start = perf_now();
+	for (i = 0; i < EVENTS; i++) {
+		err = poll(&pfd, 1, 1000);
+		if (err <= 0) {
+			if (!err)
+				errno = ETIMEDOUT;
+			goto error_samples;
+		}
+		t = perf_now();
+		/* a late wakeup may find more than one event */
+		while (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+			if (ev.event == SNDRV_TIMER_EVENT_TICK)
+				ticks += ev.val;
+		}
+		if (last)
+			perf_sample(&jitter, llabs(t - last - period));
+		last = t;
+	}
+	ioctl(fd, SNDRV_TIMER_IOCTL_STOP);
+
+	snprintf(metric, sizeof(metric), "timer.%s.ticks", name);
+	perf_report_rate(metric, ticks, perf_now() - start);
+	snprintf(metric, sizeof(metric), "timer.%s.jitter", name);
+	perf_report(metric, &jitter);
+	ksft_test_result_pass("timer %s: period %lld ns\n", name, period);
+	close(fd);
+	return;
+
+ error_samples:
+	free(jitter.val);
+ error:
+	ksft_test_result_fail("timer %s: %s\n", name, strerror(errno));
+	close(fd);
+}
+
+int main(void)
+{
+	ksft_print_header();
+	test_timer("system", SNDRV_TIMER_GLOBAL_SYSTEM);
+	test_timer("hrtimer", SNDRV_TIMER_GLOBAL_HRTIMER);
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}